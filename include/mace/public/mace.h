@@ -124,6 +124,23 @@ enum CPUAffinityPolicy {
   AFFINITY_POWER_SAVE = 4,
 };
 
+// Instruction set used by the x86 CPU kernels.
+// CPU_ISA_AUTO: use the best instruction set supported by the host.
+// CPU_ISA_NONE: do not use SIMD kernels, run the reference implementations.
+// CPU_ISA_SSE42, CPU_ISA_AVX2, CPU_ISA_AVX512 and CPU_ISA_AVX512_VNNI: use
+// kernels up to the given instruction set. A level higher than the host
+// supports is lowered to the best supported one.
+// The environment variable MACE_CPU_ISA (none, sse4.2, avx2, avx512 or
+// avx512_vnni) takes precedence over this setting.
+enum CPUIsa {
+  CPU_ISA_AUTO = 0,
+  CPU_ISA_NONE = 1,
+  CPU_ISA_SSE42 = 2,
+  CPU_ISA_AVX2 = 3,
+  CPU_ISA_AVX512 = 4,
+  CPU_ISA_AVX512_VNNI = 5,
+};
+
 enum class OpenCLCacheReusePolicy {
   REUSE_NONE = 0,
   REUSE_SAME_GPU = 1,
@@ -202,6 +219,17 @@ class RunMetadata {
   std::vector<OperatorStats> op_stats;
 };
 
+/// Counters of the memory plans cached per input shapes, see
+/// MaceEngineConfig::SetShapePlanCacheSize.
+struct ShapePlanStats {
+  // runs whose input shapes had a cached plan
+  int64_t hits;
+  // runs whose input shapes had none, a plan is made after the run
+  int64_t misses;
+  // plans dropped to keep the cache within its size
+  int64_t evictions;
+};
+
 /// Consistent with Android NNAPI
 struct PerformanceInfo {
   // Time of executing some workload(millisecond).
@@ -271,6 +299,22 @@ class MACE_API MaceStatus {
   std::unique_ptr<Impl> impl_;
 };
 
+/// Start recording a timeline of the runs of all engines in the process: the
+/// ops, the tiles run by each thread of the thread pools, the mappings of
+/// buffers and the memory obtained for tensors. Each thread keeps its latest
+/// `events_per_thread` spans. While tracing is stopped, recording costs a
+/// branch per span.
+///
+/// \param events_per_thread spans kept per thread
+MACE_API void StartTracing(int events_per_thread = 65536);
+
+/// Stop recording and write the timeline in the Chrome trace JSON format,
+/// which chrome://tracing and Perfetto open. Call it when no engine runs.
+///
+/// \param trace_file path of the JSON file
+/// \return MaceStatus::MACE_SUCCESS for success, other for failed.
+MACE_API MaceStatus StopTracing(const std::string &trace_file);
+
 /// \brief GPU context contain the status used for GPU device.
 ///
 /// There are some data in common between different MaceEngines using GPU,
@@ -432,6 +476,108 @@ class MACE_API MaceEngineConfig {
   MaceStatus SetCPUThreadPolicy(int num_threads_hint,
                                 CPUAffinityPolicy policy);
 
+  /// \brief Set the instruction set of the x86 CPU kernels.
+  ///
+  /// By default the best instruction set supported by the host is detected
+  /// at runtime, this is mainly useful to force a lower level for
+  /// debugging or benchmarking. It has no effect on non-x86 builds.
+  ///
+  /// \param isa one of CPUIsa
+  /// \return MaceStatus::MACE_SUCCESS for success, other for failure.
+  MaceStatus SetCPUIsa(CPUIsa isa);
+
+  /// \brief Set the path of the CPU tuned parameters file.
+  ///
+  /// The file is generated by running the model with the environment
+  /// variable MACE_TUNING=1 and MACE_CPU_RUN_PARAMETER_PATH set to the file
+  /// to write. It keeps the kernel, the number of threads and the tile
+  /// sizes that ran fastest for every layer shape of the model on the
+  /// device, which are then used instead of the default choices. Layers are
+  /// tuned for each shape they run with while tuning, and remember their
+  /// choices for the shapes they ran with last, so that switching shapes
+  /// does not pick the kernels again. A layer whose filter was prepacked at
+  /// init keeps the kernel it was packed for, only its number of threads
+  /// and tile sizes follow the shape.
+  ///
+  /// \param path the path of the CPU tuned parameters file
+  /// \return MaceStatus::MACE_SUCCESS for success, other for failure.
+  MaceStatus SetCPUParameterPath(const std::string &path);
+
+  /// \brief Set the number of CPU ops allowed to run at the same time.
+  ///
+  /// Ops without a data dependency between them, such as the branches of
+  /// an Inception block, are dispatched concurrently and the threads set
+  /// by SetCPUThreadPolicy are split evenly between them. It only helps
+  /// models with parallel branches of small ops, and is ignored when the
+  /// model runs on a device other than CPU or when run metadata is
+  /// collected.
+  ///
+  /// \param num_parallel_ops 1 (default) runs ops one after another.
+  /// \return MaceStatus::MACE_SUCCESS for success, other for failure.
+  MaceStatus SetCPUParallelOps(int num_parallel_ops);
+
+  /// \brief Bind input and output buffers of MaceEngine::Run directly.
+  ///
+  /// When enabled, a CPU input or output MaceTensor whose data type and
+  /// data format already match the model's tensor, and whose data is
+  /// aligned like MACE's own allocations (64 bytes is enough except on
+  /// Hexagon, which needs 128), is used as the model tensor's memory
+  /// instead of being copied, so outputs are written in place into caller
+  /// memory. Other tensors still take the copy path. An input and an
+  /// output must not share memory.
+  ///
+  /// \param enable false (default) always copies inputs and outputs.
+  /// \return MaceStatus::MACE_SUCCESS for success, other for failure.
+  MaceStatus SetZeroCopyIO(bool enable);
+
+  /// \brief Set the directory of the CPU packed weight cache.
+  ///
+  /// Constant filters of CPU convolutions are converted to the layout their
+  /// kernels consume (e.g. winograd transformed, gemm packed) while the
+  /// engine is initialized, instead of on the first run. With a cache
+  /// directory, the converted weights are also written to a file keyed by
+  /// the model data checksum and the CPU instruction set, which later
+  /// engines map instead of converting the weights again. The directory
+  /// must exist and be writable.
+  ///
+  /// \param dir empty (default) disables the cache.
+  /// \return MaceStatus::MACE_SUCCESS for success, other for failure.
+  MaceStatus SetPackedWeightCacheDir(const std::string &dir);
+
+  /// \brief Keep the fp16 and uint8 weights of a float model compressed
+  ///
+  /// By default, the weights a model stores as fp16 or uint8 (converted
+  /// with quantize_large_weights) are converted to float copies when a CPU
+  /// engine is initialized. When enabled, they stay in the model data in
+  /// their stored form instead, so they take half or a quarter of the
+  /// memory and the pages of a mapped model file may be shared by several
+  /// processes. FullyConnected and DynamicLSTM convert the weight rows to
+  /// float while multiplying them, which also streams fewer bytes in these
+  /// memory bound ops, and the weights of the other ops are still converted
+  /// once. The model data must then outlive the engine. It is ignored when
+  /// the model runs on a device other than CPU.
+  ///
+  /// \param enable false (default) converts all the weights to float.
+  /// \return MaceStatus::MACE_SUCCESS for success, other for failure.
+  MaceStatus SetCompressedWeights(bool enable);
+
+  /// \brief Set the number of memory plans cached per input shapes.
+  ///
+  /// The intermediate buffers of a CPU model are planned for the input
+  /// shapes seen at initialization. When the inputs of a run have other
+  /// shapes, the buffers which become too small are reallocated during the
+  /// run and a plan for the new shapes is made after it. Up to `max_plans`
+  /// plans are kept, the least recently used being dropped first, so
+  /// switching back to cached shapes only swaps the buffers of the tensors.
+  /// Each cached plan keeps its own memory, the default only keeps the
+  /// plan of the last shapes, so that more plans cost memory only when
+  /// asked for. It is ignored when the model runs on a device other than
+  /// CPU.
+  ///
+  /// \param max_plans 1 by default, 0 disables the cache.
+  /// \return MaceStatus::MACE_SUCCESS for success, other for failure.
+  MaceStatus SetShapePlanCacheSize(int max_plans);
+
   /// \brief Set Hexagon NN to run on unsigned PD
   ///
   /// Caution: This function must be called before any Hexagon related
@@ -591,6 +737,58 @@ class MACE_API MaceEngine {
 
   std::vector<RuntimeType> GetRuntimeTypes();
 
+  /// \brief Create an engine sharing the weights of this engine
+  ///
+  /// The replica runs the model of this engine on its own runtimes, thread
+  /// pool and intermediate buffers, but reads the weights of this engine,
+  /// the ones prepacked for the CPU kernels included. The engine and its
+  /// replicas can then run concurrently from different threads with a
+  /// single copy of the weights. Only models running on CPU are supported.
+  /// This engine must be initialized and must outlive its replicas.
+  ///
+  /// \param config[in]: configurations for the replica, e.g. its number of
+  ///                    threads. It must select the runtimes and the CPU
+  ///                    instruction set of this engine.
+  /// \param replica[out]: the replica engine
+  /// \return MaceStatus::MACE_SUCCESS for success,
+  ///         MaceStatus::MACE_INVALID_ARGS for wrong arguments,
+  ///         MaceStatus::MACE_UNSUPPORTED if the model can not be replicated.
+  MaceStatus CreateReplica(const MaceEngineConfig &config,
+                           std::shared_ptr<MaceEngine> *replica);
+
+  /// \brief Get the counters of the memory plans cached per input shapes
+  ///
+  /// \param stats[out]: the counters summed over the CPU sub graphs
+  /// \return MaceStatus::MACE_SUCCESS for success, other for failure.
+  MaceStatus GetShapePlanStats(ShapePlanStats *stats);
+
+  /// \brief Empty the states of the model to start a new sequence
+  ///
+  /// States are the tensors which keep their content from one Run() to the
+  /// next, e.g. the keys and values KVCacheAppend ops cache for a decoder,
+  /// so that a run only computes the entries of the new tokens. They are
+  /// empty after Init(), and keep the buffers reserved for their capacity.
+  /// \return MaceStatus::MACE_SUCCESS for success, other for failure.
+  MaceStatus ResetStates();
+
+  /// \brief Copy the states of the model into `states`, keyed by their names
+  ///
+  /// Only the entries appended so far are copied, not the whole capacity.
+  /// Restore them with RestoreStates() to continue the sequence later, or on
+  /// another engine, e.g. a replica, to fork it, such as decoding several
+  /// continuations of a shared prompt.
+  /// \return MaceStatus::MACE_SUCCESS for success, other for failure.
+  MaceStatus SnapshotStates(std::map<std::string, MaceTensor> *states);
+
+  /// \brief Replace the states of the model with the ones in `states`
+  ///
+  /// \param states[in]: states copied by SnapshotStates(), the ones missing
+  ///                    in it are unchanged.
+  /// \return MaceStatus::MACE_SUCCESS for success,
+  ///         MaceStatus::MACE_INVALID_ARGS for unknown states, or states of
+  ///         another type or beyond their capacity.
+  MaceStatus RestoreStates(const std::map<std::string, MaceTensor> &states);
+
   // @Deprecated, will be removed in future version
   MaceStatus Init(const NetDef *net_def,
                   const std::vector<std::string> &input_nodes,
@@ -613,6 +811,12 @@ class MACE_API MaceEngine {
                   bool *model_data_unused = nullptr);
 
  private:
+  friend class MaceStreamingSession;
+
+  MaceStatus GetInputInfo(const std::string &name,
+                          std::vector<int64_t> *shape,
+                          DataFormat *data_format);
+
   class Impl;
   std::unique_ptr<Impl> impl_;
 
@@ -620,6 +824,79 @@ class MACE_API MaceEngine {
   MaceEngine &operator=(const MaceEngine &) = delete;
 };
 
+/// \brief Runs a streaming model, e.g. a Kaldi speech model, chunk by chunk
+///
+/// Streaming models carry their recurrent state from one chunk to the next
+/// as pairs of model outputs and inputs, e.g. the caches of DynamicLSTM or
+/// the cache input of IfDefined, and need some frames of the previous chunk
+/// as left context of Splice. The session keeps both between Run() calls,
+/// so that the caller only feeds the new frames of every chunk instead of
+/// overlapping chunks.
+///
+/// The session does not make a chunk compute only its new frames. The
+/// context frames are prepended to the model input and every layer computes
+/// them again on each chunk, because the frame indexes of Splice,
+/// DynamicLSTM and ExtractPooling are fixed for the whole chunk when the
+/// model is converted. Only the intermediate outputs the model itself
+/// exports as state pairs (e.g. IfDefined caches) are carried over instead
+/// of being recomputed.
+///
+/// A session holds the state of one stream at a time. Use Reset() when a
+/// new stream starts, and Snapshot()/Restore() to interleave several
+/// streams on one session, or create one session per stream. Sessions on
+/// the same engine must not run concurrently, use engine replicas to run
+/// streams in parallel.
+class MACE_API MaceStreamingSession {
+ public:
+  MaceStreamingSession();
+  ~MaceStreamingSession();
+
+  /// \brief Initialize the session
+  ///
+  /// \param engine[in]: the initialized engine running the model, it must
+  ///                    outlive the session. The state inputs and outputs
+  ///                    should be in the engine's input and output nodes.
+  /// \param states[in]: map from the model output holding the new state to
+  ///                    the model input that takes it on the next run. The
+  ///                    state inputs are zeros on the first run of a stream.
+  /// \param context_frames[in]: map from a model input to the number of
+  ///                            frames (its second last dimension) of the
+  ///                            previous chunk prepended to the new frames.
+  ///                            The first chunk of a stream repeats its first
+  ///                            frame instead.
+  /// \return MaceStatus::MACE_SUCCESS for success,
+  ///         MaceStatus::MACE_INVALID_ARGS for wrong arguments.
+  MaceStatus Init(MaceEngine *engine,
+                  const std::map<std::string, std::string> &states,
+                  const std::map<std::string, int> &context_frames = {});
+
+  /// \brief Run the model on the next chunk
+  ///
+  /// \param inputs[in]: the model inputs except the state inputs. Inputs
+  ///                    with context frames hold the new frames only.
+  /// \param outputs[in/out]: the model outputs except the state outputs.
+  MaceStatus Run(const std::map<std::string, MaceTensor> &inputs,
+                 std::map<std::string, MaceTensor> *outputs,
+                 RunMetadata *run_metadata = nullptr);
+
+  /// \brief Start a new stream, the states and context frames are cleared
+  void Reset();
+
+  /// \brief Copy the state of the current stream, including its context
+  /// frames, into `snapshot`, keyed by the model inputs they feed.
+  MaceStatus Snapshot(std::map<std::string, MaceTensor> *snapshot) const;
+
+  /// \brief Continue the stream saved in `snapshot` by Snapshot()
+  MaceStatus Restore(const std::map<std::string, MaceTensor> &snapshot);
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+
+  MaceStreamingSession(const MaceStreamingSession &) = delete;
+  MaceStreamingSession &operator=(const MaceStreamingSession &) = delete;
+};
+
 /// \brief Create MaceEngine from model graph proto and weights data
 ///
 /// Create MaceEngine object
@@ -38,6 +38,20 @@ class MaceEngineCfgImpl {
   MaceStatus SetCPUThreadPolicy(int num_threads_hint,
                                 CPUAffinityPolicy policy);
 
+  MaceStatus SetCPUIsa(CPUIsa isa);
+
+  MaceStatus SetCPUParameterPath(const std::string &path);
+
+  MaceStatus SetCPUParallelOps(int num_parallel_ops);
+
+  MaceStatus SetZeroCopyIO(bool enable);
+
+  MaceStatus SetPackedWeightCacheDir(const std::string &dir);
+
+  MaceStatus SetCompressedWeights(bool enable);
+
+  MaceStatus SetShapePlanCacheSize(int max_plans);
+
   MaceStatus SetHexagonToUnsignedPD();
 
   MaceStatus SetHexagonPower(HexagonNNCornerType corner,
@@ -57,6 +71,20 @@ class MaceEngineCfgImpl {
 
   CPUAffinityPolicy cpu_affinity_policy() const;
 
+  CPUIsa cpu_isa() const;
+
+  std::string cpu_parameter_path() const;
+
+  int cpu_parallel_ops() const;
+
+  bool zero_copy_io() const;
+
+  std::string packed_weight_cache_dir() const;
+
+  bool compressed_weights() const;
+
+  int shape_plan_cache_size() const;
+
   std::shared_ptr<OpenclContext> opencl_context() const;
 
   GPUPriorityHint gpu_priority_hint() const;
@@ -86,6 +114,13 @@ class MaceEngineCfgImpl {
  private:
   int num_threads_;
   CPUAffinityPolicy cpu_affinity_policy_;
+  CPUIsa cpu_isa_;
+  std::string cpu_parameter_path_;
+  int cpu_parallel_ops_;
+  bool zero_copy_io_;
+  std::string packed_weight_cache_dir_;
+  bool compressed_weights_;
+  int shape_plan_cache_size_;
   std::shared_ptr<OpenclContext> opencl_context_;
   GPUPriorityHint gpu_priority_hint_;
   GPUPerfHint gpu_perf_hint_;
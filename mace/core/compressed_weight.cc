@@ -0,0 +1,68 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/core/compressed_weight.h"
+
+#if defined(MACE_ENABLE_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include <vector>
+
+#include "mace/utils/logging.h"
+
+namespace mace {
+
+bool IsCompressedWeight(const Tensor *tensor) {
+  return tensor->is_weight() &&
+      (tensor->dtype() == DT_HALF || tensor->dtype() == DT_UINT8);
+}
+
+void DecompressWeight(const Tensor *weight, const index_t offset,
+                      const index_t count, float *output) {
+  MACE_CHECK(offset >= 0 && offset + count <= weight->size());
+  if (weight->dtype() == DT_HALF) {
+    const half *input = weight->data<half>() + offset;
+    index_t i = 0;
+#if defined(MACE_ENABLE_NEON) && defined(__aarch64__)
+    const uint16_t *input_bits = reinterpret_cast<const uint16_t *>(input);
+    for (; i + 4 <= count; i += 4) {
+      vst1q_f32(output + i,
+                vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(input_bits + i))));
+    }
+#endif
+    for (; i < count; ++i) {
+      output[i] = half_float::half_cast<float>(input[i]);
+    }
+  } else {
+    MACE_CHECK(weight->dtype() == DT_UINT8, weight->name(),
+               " is not a compressed weight");
+    const uint8_t *input = weight->data<uint8_t>() + offset;
+    const float scale = weight->scale();
+    const int32_t zero_point = weight->zero_point();
+    for (index_t i = 0; i < count; ++i) {
+      output[i] = scale * (input[i] - zero_point);
+    }
+  }
+}
+
+float *DecompressScratch(const index_t size) {
+  thread_local std::vector<float> buffer;
+  if (static_cast<index_t>(buffer.size()) < size) {
+    buffer.resize(size);
+  }
+  return buffer.data();
+}
+
+}  // namespace mace
@@ -0,0 +1,41 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_CORE_COMPRESSED_WEIGHT_H_
+#define MACE_CORE_COMPRESSED_WEIGHT_H_
+
+#include "mace/core/tensor.h"
+
+namespace mace {
+
+// With MaceEngineConfig::SetCompressedWeights, the fp16 and uint8 weights of
+// a float model on CPU are slices of the model data in their stored form.
+// The kernels reading such a weight convert the values they use to float,
+// the weights of the other ops are converted once while the net is set up.
+
+// Whether `tensor` is a weight kept in its stored fp16 or uint8 form.
+bool IsCompressedWeight(const Tensor *tensor);
+
+// Converts the values [offset, offset + count) of the compressed `weight` to
+// float, dequantizing uint8 values with the scale and zero point of it.
+void DecompressWeight(const Tensor *weight, const index_t offset,
+                      const index_t count, float *output);
+
+// Scratch buffer of the calling thread for the converted values of a
+// compressed weight, allocated by the first call and kept for the next ones.
+float *DecompressScratch(const index_t size);
+
+}  // namespace mace
+
+#endif  // MACE_CORE_COMPRESSED_WEIGHT_H_
@@ -15,17 +15,51 @@
 
 #include "mace/core/flow/base_flow.h"
 
+#include <cstdint>
+#include <cstring>
 #include <functional>
+#include <memory>
+#include <numeric>
 
 #include "mace/core/mace_tensor_impl.h"
+#include "mace/core/memory/external_buffer.h"
 #include "mace/core/net_def_adapter.h"
 #include "mace/core/proto/net_def_helper.h"
+#include "mace/utils/mace_engine_config.h"
 #include "mace/utils/math.h"
 #include "mace/utils/stl_util.h"
 #include "mace/utils/transpose.h"
 
 namespace mace {
 
+namespace {
+bool IsSameDataType(const DataType dt, const IDataType idt) {
+  switch (dt) {
+    case DT_FLOAT: return idt == IDT_FLOAT;
+    case DT_UINT8: return idt == IDT_UINT8;
+    case DT_INT32: return idt == IDT_INT32;
+    case DT_FLOAT16: return idt == IDT_FLOAT16;
+    case DT_BFLOAT16: return idt == IDT_BFLOAT16;
+    case DT_INT16: return idt == IDT_INT16;
+    case DT_INT8: return idt == IDT_INT8;
+    default: return false;
+  }
+}
+
+IDataType ToIDataType(const DataType dt) {
+  switch (dt) {
+    case DT_FLOAT: return IDT_FLOAT;
+    case DT_UINT8: return IDT_UINT8;
+    case DT_INT32: return IDT_INT32;
+    case DT_FLOAT16: return IDT_FLOAT16;
+    case DT_BFLOAT16: return IDT_BFLOAT16;
+    case DT_INT16: return IDT_INT16;
+    case DT_INT8: return IDT_INT8;
+    default: return IDT_INVALID;
+  }
+}
+}  // namespace
+
 BaseFlow::BaseFlow(FlowContext *flow_context)
     : net_(nullptr),
       ws_(make_unique<Workspace>(flow_context->op_delegator_registry, this)),
@@ -72,9 +106,26 @@ MaceStatus BaseFlow::Init(const NetDef *net_def,
   return MaceStatus::MACE_SUCCESS;
 }
 
+MaceStatus BaseFlow::InitReplica(const NetDef *net_def,
+                                 const BaseFlow *source) {
+  MACE_UNUSED(source);
+  LOG(ERROR) << "The flow of net " << net_def->name()
+             << " does not support replicas";
+  return MaceStatus::MACE_UNSUPPORTED;
+}
+
 MaceStatus BaseFlow::Run(const std::map<std::string, MaceTensor> &inputs,
                          std::map<std::string, MaceTensor> *outputs,
                          RunMetadata *run_metadata) {
+  MaceStatus status = DoRun(inputs, outputs, run_metadata);
+  UnbindBuffers();
+
+  return status;
+}
+
+MaceStatus BaseFlow::DoRun(const std::map<std::string, MaceTensor> &inputs,
+                           std::map<std::string, MaceTensor> *outputs,
+                           RunMetadata *run_metadata) {
   MACE_CHECK_NOTNULL(outputs);
   TensorMap input_tensors;
   TensorMap output_tensors;
@@ -90,6 +141,9 @@ MaceStatus BaseFlow::Run(const std::map<std::string, MaceTensor> &inputs,
     MACE_RETURN_IF_ERROR(TransposeInput(input, input_tensor));
     input_tensors[input.first] = input_tensor;
   }
+  if (net_ != nullptr) {
+    MACE_RETURN_IF_ERROR(net_->PrepareForInputShapes());
+  }
 
   // Create output tensors
   for (auto &output : *outputs) {
@@ -99,6 +153,9 @@ MaceStatus BaseFlow::Run(const std::map<std::string, MaceTensor> &inputs,
                  << MakeString(MapKeys(output_info_map_));
     }
     Tensor *output_tensor = ws_->GetTensor(output.first);
+    if (GetOutputTransposeDims(*output_tensor, &output).empty()) {
+      BindBuffer(output.second, output_tensor);
+    }
     output_tensors[output.first] = output_tensor;
   }
 
@@ -115,6 +172,32 @@ MaceStatus BaseFlow::Run(const std::map<std::string, MaceTensor> &inputs,
   return MaceStatus::MACE_SUCCESS;
 }
 
+bool BaseFlow::BindBuffer(const MaceTensor &mace_tensor, Tensor *tensor) {
+  void *data = mace_tensor.impl_->data.get();
+  if (!config_impl_->zero_copy_io() || data == nullptr ||
+      mace_tensor.memory_type() != MemoryType::CPU_BUFFER ||
+      tensor->memory_type() != MemoryType::CPU_BUFFER || tensor->is_state() ||
+      !IsSameDataType(tensor->dtype(), mace_tensor.data_type()) ||
+      reinterpret_cast<uintptr_t>(data) % kMaceAlignment != 0) {
+    return false;
+  }
+
+  VLOG(2) << "Bind the caller's buffer to tensor " << tensor->name();
+  auto buffer = std::make_shared<ExternalBuffer>(
+      MemoryType::CPU_BUFFER, tensor->dtype(),
+      std::vector<index_t>({mace_tensor.impl_->buffer_size}), data);
+  buffer->SetHost(data);
+  bound_buffers_.emplace_back(tensor, tensor->SwapBuffer(buffer));
+  return true;
+}
+
+void BaseFlow::UnbindBuffers() {
+  for (auto &bound : bound_buffers_) {
+    bound.first->SwapBuffer(bound.second);
+  }
+  bound_buffers_.clear();
+}
+
 MaceStatus BaseFlow::FakeWarmup() {
   return MaceStatus::MACE_SUCCESS;
 }
@@ -128,6 +211,57 @@ MaceStatus BaseFlow::AllocateIntermediateBuffer() {
   return MaceStatus::MACE_SUCCESS;
 }
 
+void BaseFlow::GetShapePlanStats(ShapePlanStats *stats) const {
+  if (net_ != nullptr) {
+    net_->GetShapePlanStats(stats);
+  }
+}
+
+std::vector<std::string> BaseFlow::States() const {
+  return ws_->States();
+}
+
+void BaseFlow::ResetStates() {
+  ws_->ResetStates();
+}
+
+MaceStatus BaseFlow::SnapshotState(const std::string &name,
+                                   MaceTensor *state) const {
+  MACE_CHECK_NOTNULL(state);
+  const Tensor *tensor = ws_->GetTensor(name);
+  MACE_CHECK(tensor != nullptr && tensor->is_state(), name,
+             " is not a state");
+  // the live entries only, packed
+  const std::vector<index_t> shape = ws_->ReadState(name, nullptr);
+  const size_t bytes = shape.empty() ? 0 :
+      std::accumulate(shape.begin(), shape.end(), tensor->SizeOfType(),
+                      std::multiplies<size_t>());
+  std::shared_ptr<uint8_t> data(new uint8_t[bytes > 0 ? bytes : 1],
+                                std::default_delete<uint8_t[]>());
+  if (bytes > 0) {
+    ws_->ReadState(name, data.get());
+  }
+  *state = MaceTensor(std::vector<int64_t>(shape.begin(), shape.end()),
+                      data, DataFormat::NONE, ToIDataType(tensor->dtype()));
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStatus BaseFlow::RestoreState(const std::string &name,
+                                  const MaceTensor &state) {
+  const Tensor *tensor = ws_->GetTensor(name);
+  MACE_CHECK(tensor != nullptr && tensor->is_state(), name,
+             " is not a state");
+  if (!IsSameDataType(tensor->dtype(), state.data_type()) ||
+      state.impl_->data == nullptr) {
+    LOG(ERROR) << "The data of state " << name << " should be of type "
+               << static_cast<int>(ToIDataType(tensor->dtype()));
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  return ws_->LoadState(name, std::vector<index_t>(state.shape().begin(),
+                                                   state.shape().end()),
+                        state.impl_->data.get());
+}
+
 MaceStatus BaseFlow::TransposeInput(
     const std::pair<const std::string, MaceTensor> &input,
     Tensor *input_tensor) {
@@ -142,10 +276,14 @@ MaceStatus BaseFlow::TransposeInput(
     output_shape = TransposeShape<int64_t, index_t>(input.second.shape(),
                                                     dst_dims);
   }
+  // Use the mace tensor's data in place when it needs no conversion
+  const bool bound = dst_dims.empty() && BindBuffer(input.second,
+                                                    input_tensor);
   MACE_RETURN_IF_ERROR(input_tensor->Resize(output_shape));
 
   // Transpose or copy the mace tensor's data to input tensor
-  auto status = TransposeInputByDims(input.second, input_tensor, dst_dims);
+  auto status = bound ? MaceStatus::MACE_SUCCESS :
+                TransposeInputByDims(input.second, input_tensor, dst_dims);
 
   // Set the data format
   input_tensor->set_data_format(data_format);
@@ -175,6 +313,14 @@ MaceStatus BaseFlow::TransposeOutput(
     << output->second.impl_->buffer_size;
   output->second.impl_->shape = shape;
 
+  // The output has been written in place by the net
+  if (output_tensor.memory_type() == MemoryType::CPU_BUFFER &&
+      output_tensor.raw_data() == output->second.impl_->data.get()) {
+    MACE_CHECK(dst_dims.empty(), "Can not transpose output ",
+               output_tensor.name(), " in place");
+    return MaceStatus::MACE_SUCCESS;
+  }
+
   // Transpose output tensor
   return TransposeOutputByDims(output_tensor, &(output->second), dst_dims);
 }
@@ -35,6 +35,7 @@ namespace utils {
 class ThreadPool;
 }  // namespace utils
 class BaseEngine;
+class Buffer;
 class MaceEngineCfgImpl;
 class Runtime;
 class NetDef;
@@ -73,6 +74,12 @@ class BaseFlow {
                           const int64_t model_data_size,
                           bool *model_data_unused);
 
+  // Initializes the flow to run `net_def` like `source`, which has been
+  // initialized with it, reading the weights of `source` instead of loading
+  // its own. `source` must outlive this flow.
+  virtual MaceStatus InitReplica(const NetDef *net_def,
+                                 const BaseFlow *source);
+
   virtual MaceStatus Run(TensorMap *input_tensors,
                          TensorMap *output_tensors,
                          RunMetadata *run_metadata) = 0;
@@ -84,6 +91,16 @@ class BaseFlow {
 
   MaceStatus AllocateIntermediateBuffer();
 
+  // Adds the counters of the memory plans cached by the net to `stats`.
+  void GetShapePlanStats(ShapePlanStats *stats) const;
+
+  // The states of the net, which keep their content between runs.
+  std::vector<std::string> States() const;
+  void ResetStates();
+  // Copies the state `name` into a new MaceTensor.
+  MaceStatus SnapshotState(const std::string &name, MaceTensor *state) const;
+  MaceStatus RestoreState(const std::string &name, const MaceTensor &state);
+
  protected:
   virtual MaceStatus GetInputTransposeDims(
       const std::pair<const std::string, MaceTensor> &input,
@@ -98,7 +115,19 @@ class BaseFlow {
 
   MaceStatus InitOutputTensor();
 
+  static const Workspace *GetWorkspace(const BaseFlow *flow) {
+    return flow->ws_.get();
+  }
+
  private:
+  MaceStatus DoRun(const std::map<std::string, MaceTensor> &inputs,
+                   std::map<std::string, MaceTensor> *outputs,
+                   RunMetadata *run_metadata);
+  // Use the memory of `mace_tensor` as the tensor's buffer for this run if
+  // zero-copy I/O is enabled and the data needs no conversion.
+  bool BindBuffer(const MaceTensor &mace_tensor, Tensor *tensor);
+  void UnbindBuffers();
+
   MaceStatus InitInputTensors();
   MaceStatus AllocateBufferForInputTensors();
   MaceStatus TransposeInput(
@@ -133,6 +162,10 @@ class BaseFlow {
   Runtime *main_runtime_;
   utils::ThreadPool *thread_pool_;
   BaseEngine *parent_engine_;
+
+ private:
+  // tensors bound to the caller's memory and their own buffers
+  std::vector<std::pair<Tensor *, std::shared_ptr<Buffer>>> bound_buffers_;
 };
 
 }  // namespace mace
@@ -75,6 +75,12 @@ class Buffer : public MemInfo {
     return 0;
   }
 
+  // Size of memory not obtained as a whole from a memory manager (caller
+  // memory, arena slices), 0 otherwise.
+  virtual index_t external_bytes() const {
+    return 0;
+  }
+
  private:
   void *buf_;
   void *host_;
@@ -0,0 +1,43 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_CORE_MEMORY_EXTERNAL_BUFFER_H_
+#define MACE_CORE_MEMORY_EXTERNAL_BUFFER_H_
+
+#include <vector>
+
+#include "mace/core/memory/buffer.h"
+
+namespace mace {
+
+// Memory owned by the caller of the engine, e.g. the data of a MaceTensor.
+class ExternalBuffer : public Buffer {
+ public:
+  explicit ExternalBuffer(
+      const MemoryType buffer_mt, DataType dt,
+      const std::vector<index_t> buffer_dims, void *ptr)
+      : Buffer(buffer_mt, dt, buffer_dims, ptr),
+        capacity_bytes_(bytes()) {}
+
+  index_t external_bytes() const override {
+    return capacity_bytes_;
+  }
+
+ private:
+  index_t capacity_bytes_;
+};
+
+}  // namespace mace
+
+#endif  // MACE_CORE_MEMORY_EXTERNAL_BUFFER_H_
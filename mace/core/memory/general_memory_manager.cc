@@ -18,6 +18,7 @@
 
 #include "mace/core/memory/allocator.h"
 #include "mace/utils/logging.h"
+#include "mace/utils/tracer.h"
 
 namespace mace {
 
@@ -28,6 +29,12 @@ GeneralMemoryManager::~GeneralMemoryManager() {}
 
 void *GeneralMemoryManager::ObtainMemory(const MemInfo &info,
                                          const BufRentType rent_type) {
+  utils::TraceSpan trace_span("memory", "ObtainMemory");
+  if (trace_span.active()) {
+    trace_span.AddArg("bytes", info.bytes());
+    trace_span.AddArg("rent_type", rent_type);
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
   if (shared_pools_.count(rent_type) == 0) {
     shared_pools_.emplace(rent_type, make_unique<MemoryPool>(allocator_));
   }
@@ -36,6 +43,7 @@ void *GeneralMemoryManager::ObtainMemory(const MemInfo &info,
 
 void GeneralMemoryManager::ReleaseMemory(void *ptr,
                                          const BufRentType rent_type) {
+  std::lock_guard<std::mutex> lock(mutex_);
   if (shared_pools_.count(rent_type) == 0) {
     LOG(WARNING) << "There is no memory in the rent pool: " << rent_type;
     return;
@@ -44,6 +52,7 @@ void GeneralMemoryManager::ReleaseMemory(void *ptr,
 }
 
 std::vector<index_t> GeneralMemoryManager::GetMemoryRealSize(const void *ptr) {
+  std::lock_guard<std::mutex> lock(mutex_);
   for (auto i = shared_pools_.begin(); i != shared_pools_.end(); ++i) {
     auto real_shape = i->second->GetMemoryRealSize(ptr);
     if (real_shape.size() == 0) {
@@ -57,6 +66,7 @@ std::vector<index_t> GeneralMemoryManager::GetMemoryRealSize(const void *ptr) {
 
 void GeneralMemoryManager::ReleaseAllMemory(const BufRentType rent_type,
                                             bool del_buf) {
+  std::lock_guard<std::mutex> lock(mutex_);
   if (shared_pools_.count(rent_type) > 0) {
     shared_pools_.at(rent_type)->ReleaseAllMemory(del_buf);
   }
@@ -91,6 +101,10 @@ void *GeneralMemoryManager::MemoryPool::ObtainMemory(const MemInfo &mem_info) {
   auto iter = mem_free_blocks_.lower_bound(bytes);
   void *ptr = nullptr;
   if (iter == mem_free_blocks_.end()) {
+    utils::TraceSpan trace_span("memory", "Allocate");
+    if (trace_span.active()) {
+      trace_span.AddArg("bytes", bytes);
+    }
     MACE_CHECK_SUCCESS(allocator_->New(mem_info, &ptr));
     mem_used_blocks_.emplace(bytes, ptr);
     VLOG(2) << "GeneralMemoryManager::MemoryPool::ObtainMemory New memory: "
@@ -19,6 +19,7 @@
 
 #include <map>
 #include <memory>
+#include <mutex>  // NOLINT(build/c++11)
 #include <unordered_map>
 #include <vector>
 
@@ -63,6 +64,8 @@ class GeneralMemoryManager : public MemoryManager {
   // namespace and buffer pool
   typedef std::unordered_map<int, std::unique_ptr<MemoryPool>> SharedPools;
   SharedPools shared_pools_;
+  // ops running concurrently may resize their outputs
+  std::mutex mutex_;
 };
 
 }  // namespace mace
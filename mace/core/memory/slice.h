@@ -26,16 +26,24 @@ class Slice : public Buffer {
   explicit Slice(
       const MemoryType buffer_mt, DataType dt,
       const std::vector<index_t> buffer_dims = std::vector<index_t>(),
-      void *base_ptr = nullptr, index_t offset_bytes = 0)
+      void *base_ptr = nullptr, index_t offset_bytes = 0,
+      index_t capacity_bytes = 0)
       : Buffer(buffer_mt, dt, buffer_dims, base_ptr),
-        buf_offset(offset_bytes) {}
+        buf_offset(offset_bytes), capacity(capacity_bytes) {}
 
   index_t offset() override {
     return buf_offset;
   }
 
+  // A slice of an arena shared with other tensors may only be resized within
+  // its capacity, which is 0 for slices never resized (e.g. weights).
+  index_t external_bytes() const override {
+    return capacity;
+  }
+
  private:
   index_t buf_offset;
+  index_t capacity;
 };
 
 }  // namespace mace
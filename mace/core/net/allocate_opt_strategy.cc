@@ -14,10 +14,18 @@
 
 #include "mace/core/net/allocate_strategy.h"
 
+#include <algorithm>
+#include <functional>
 #include <list>
+#include <map>
 
+#include "mace/core/memory/slice.h"
+#include "mace/core/net/arena_planner.h"
+#include "mace/core/net/op_dependency.h"
+#include "mace/core/net/shape_plan_cache.h"
 #include "mace/core/tensor.h"
 #include "mace/utils/logging.h"
+#include "mace/utils/math.h"
 
 namespace mace {
 
@@ -28,9 +36,16 @@ struct TensorRef {
   Tensor *tensor;
   int refs;
   Buffer *buffer;
+  // ops reading the buffer
+  std::vector<int> consumers;
+  // the op writing the buffer first, -1 for the model's inputs
+  int producer;
+  // whether the buffer is planned in an arena instead of a Buffer
+  bool in_arena;
 
   explicit TensorRef(Tensor *tensor_ptr)
-      : tensor(tensor_ptr), refs(1), buffer(nullptr) {}
+      : tensor(tensor_ptr), refs(1), buffer(nullptr), producer(-1),
+        in_arena(false) {}
 };
 
 // If *monotonous return false, the compare result is meaningless
@@ -58,8 +73,44 @@ int CompareShape(const std::vector<index_t> &shape1,
   return area1 - area2;
 }
 
+// Whether an op has finished when another one starts.
+class OpOrder {
+ public:
+  // Serial execution: every earlier op has finished.
+  OpOrder() : words_(0) {}
+
+  // Concurrent execution: only the transitive predecessors have finished.
+  explicit OpOrder(const OpDependency &dependency)
+      : words_((dependency.predecessors.size() + 63) / 64),
+        ancestors_(dependency.predecessors.size() * words_, 0) {
+    const size_t op_count = dependency.predecessors.size();
+    for (size_t idx = 0; idx < op_count; ++idx) {
+      uint64_t *ancestors = &ancestors_[idx * words_];
+      for (int pred : dependency.predecessors[idx]) {
+        const uint64_t *pred_ancestors = &ancestors_[pred * words_];
+        for (size_t w = 0; w < words_; ++w) {
+          ancestors[w] |= pred_ancestors[w];
+        }
+        ancestors[pred / 64] |= (1ULL << (pred % 64));
+      }
+    }
+  }
+
+  bool FinishedBefore(int op_idx, int other_idx) const {
+    if (words_ == 0) {
+      return op_idx < other_idx;
+    }
+    return (ancestors_[other_idx * words_ + op_idx / 64] >> (op_idx % 64)) & 1;
+  }
+
+ private:
+  size_t words_;
+  std::vector<uint64_t> ancestors_;
+};
+
 BufferList::iterator FindBestFreeBuffer(
     const MemInfo &mem_info,
+    const std::function<bool(const Buffer *)> &reusable,
     BufferList *free_buf_list, bool *need_expand) {
   index_t best_waste_area = LLONG_MAX;
   index_t best_lack_area = LLONG_MIN;
@@ -67,7 +118,7 @@ BufferList::iterator FindBestFreeBuffer(
   BufferList::iterator best_idx = free_buf_list->end();
   for (auto i = free_buf_list->begin(); i != free_buf_list->end(); ++i) {
     if ((*i)->mem_type != mem_info.mem_type ||
-        (*i)->data_type != mem_info.data_type) {
+        (*i)->data_type != mem_info.data_type || !reusable(i->get())) {
       continue;
     }
 
@@ -100,9 +151,11 @@ BufferList::iterator FindBestFreeBuffer(
   return best_idx;
 }
 
-void SimulateAllocateBuffer(std::shared_ptr<TensorRef> tensor_ref,
-                            BufferList *used_buf_list,
-                            BufferList *free_buf_list) {
+void SimulateAllocateBuffer(
+    std::shared_ptr<TensorRef> tensor_ref,
+    const std::function<bool(const Buffer *)> &reusable,
+    BufferList *used_buf_list,
+    BufferList *free_buf_list) {
   const Tensor *tensor = tensor_ref->tensor;
   Runtime *runtime = tensor->GetCurRuntime();
   BufferContentType content_type = BufferContentType::IN_OUT_CHANNEL;
@@ -115,7 +168,8 @@ void SimulateAllocateBuffer(std::shared_ptr<TensorRef> tensor_ref,
       tensor_dims, mem_type, content_type, content_param);
   bool need_expand = false;
   MemInfo buf_info(mem_type, data_type, buf_dims);
-  auto idx = FindBestFreeBuffer(buf_info, free_buf_list, &need_expand);
+  auto idx = FindBestFreeBuffer(buf_info, reusable, free_buf_list,
+                                &need_expand);
 
   std::unique_ptr<Buffer> buffer;
   if (idx == free_buf_list->end()) {
@@ -157,6 +211,9 @@ void SimulateDeleteBuffer(std::shared_ptr<TensorRef> tensor_ref,
 void ReallyAllocateBuffer(
     std::unordered_map<std::string, std::shared_ptr<TensorRef>> tensor_refs) {
   for (auto i = tensor_refs.begin(); i != tensor_refs.end(); ++i) {
+    if (i->second->in_arena) {
+      continue;
+    }
     Buffer *buffer = i->second->buffer;
     if (buffer == nullptr) {
       VLOG(3) << "ReallyAllocateBuffer, tensor " << i->second->tensor->name()
@@ -176,17 +233,125 @@ void ReallyAllocateBuffer(
     runtime->SetBufferToTensor(make_unique<Buffer>(*buffer), tensor);
   }
 }
-}  // namespace
 
-template<>
-MaceStatus AllocateTensorMemory<SERIAL_OPT>(const OperationArray &operators) {
+std::vector<index_t> BufferDims(const Tensor *tensor) {
+  BufferContentType content_type = BufferContentType::IN_OUT_CHANNEL;
+  unsigned int content_param = 0;
+  tensor->GetContentType(&content_type, &content_param);
+  return tensor->GetCurRuntime()->ComputeBufDimFromTensorDim(
+      tensor->shape(), tensor->memory_type(), content_type, content_param);
+}
+
+// The buffer of `ref` is free for `op_idx` once all its readers finished.
+bool FreedBefore(const TensorRef &ref, const int op_idx,
+                 const OpOrder &order) {
+  // never read in the net, it is a model's output
+  if (ref.consumers.empty()) {
+    return false;
+  }
+  for (int consumer : ref.consumers) {
+    if (!order.FinishedBefore(consumer, op_idx)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Places the CPU buffers of each runtime at offsets of one arena, buffers
+// alive at the same time do not overlap. With a plan, the arenas and the
+// slices go to the plan instead of the tensors.
+void ReallyAllocateArena(
+    const std::unordered_map<std::string, std::shared_ptr<TensorRef>>
+        &tensor_refs, const int op_count, const OpOrder &order,
+    MemoryPlan *plan) {
+  // Tensors reusing the buffer of another tensor share its TensorRef, only
+  // the owner gets a buffer. Sorted by name so the plan is reproducible.
+  std::map<std::string, TensorRef *> owner_refs;
+  for (auto &tensor_ref : tensor_refs) {
+    TensorRef *ref = tensor_ref.second.get();
+    if (ref->in_arena && tensor_ref.first == ref->tensor->name()) {
+      owner_refs.emplace(tensor_ref.first, ref);
+    }
+  }
+  std::map<Runtime *, std::vector<TensorRef *>> runtime_refs;
+  for (auto &owner_ref : owner_refs) {
+    TensorRef *ref = owner_ref.second;
+    runtime_refs[ref->tensor->GetCurRuntime()].push_back(ref);
+  }
+
+  for (auto &runtime_ref : runtime_refs) {
+    Runtime *runtime = runtime_ref.first;
+    const std::vector<TensorRef *> &refs = runtime_ref.second;
+    std::vector<index_t> bytes(refs.size());
+    index_t naive_bytes = 0;
+    // bytes alive while each op runs, in serial order
+    std::vector<index_t> live_bytes(op_count, 0);
+    for (size_t i = 0; i < refs.size(); ++i) {
+      const Tensor *tensor = refs[i]->tensor;
+      bytes[i] = MemInfo(tensor->memory_type(), tensor->dtype(),
+                         BufferDims(tensor)).bytes();
+      naive_bytes += bytes[i];
+      const auto &consumers = refs[i]->consumers;
+      const int last_use = consumers.empty() ? op_count - 1 :
+          *std::max_element(consumers.begin(), consumers.end());
+      for (int op_idx = refs[i]->producer; op_idx <= last_use; ++op_idx) {
+        live_bytes[op_idx] += bytes[i];
+      }
+    }
+    auto conflict = [&](size_t i, size_t j) -> bool {
+      return !FreedBefore(*refs[i], refs[j]->producer, order) &&
+          !FreedBefore(*refs[j], refs[i]->producer, order);
+    };
+    std::vector<index_t> offsets;
+    const index_t arena_bytes =
+        PlanArena(bytes, kMaceAlignment, conflict, &offsets);
+    VLOG(1) << "Plan " << refs.size() << " tensors of runtime "
+            << runtime->GetRuntimeType() << " in a "
+            << arena_bytes << " bytes arena, peak of live tensors: "
+            << *std::max_element(live_bytes.begin(), live_bytes.end())
+            << " bytes, without reuse: " << naive_bytes << " bytes";
+    if (arena_bytes == 0) {
+      continue;
+    }
+
+    auto arena = runtime->ObtainBuffer(
+        MemInfo(MemoryType::CPU_BUFFER, DataType::DT_UINT8, {arena_bytes}),
+        plan == nullptr ? RENT_SHARE : plan->rent_type());
+    void *arena_ptr = arena->mutable_memory<void>();
+    for (size_t i = 0; i < refs.size(); ++i) {
+      Tensor *tensor = refs[i]->tensor;
+      VLOG(3) << "tensor " << tensor->name() << " at arena offset "
+              << offsets[i] << ", bytes: " << bytes[i];
+      auto slice = make_unique<Slice>(
+          MemoryType::CPU_BUFFER, tensor->dtype(), BufferDims(tensor),
+          arena_ptr, offsets[i], RoundUp<index_t>(bytes[i], kMaceAlignment));
+      if (plan == nullptr) {
+        runtime->SetBufferToTensor(std::move(slice), tensor);
+      } else {
+        slice->SetHost(static_cast<uint8_t *>(arena_ptr) + offsets[i]);
+        plan->AddTensorBuffer(tensor, std::move(slice));
+      }
+    }
+    if (plan != nullptr) {
+      plan->AddArena(runtime, std::move(arena));
+    }
+  }
+}
+
+MaceStatus AllocateOptimized(const OperationArray &operators,
+                             const OpOrder &order, const bool use_arena,
+                             MemoryPlan *plan) {
+  MACE_CHECK(plan == nullptr || use_arena,
+             "Only the arena strategies make memory plans");
   std::unordered_map<std::string, std::shared_ptr<TensorRef>> tensor_refs;
+  const int op_count = static_cast<int>(operators.size());
   // Collect the refs of input tensor
-  for (auto &op : operators) {
+  for (int op_idx = 0; op_idx < op_count; ++op_idx) {
+    auto &op = operators[op_idx];
     size_t input_size = static_cast<size_t>(op->InputSize());
     for (size_t i = 0; i < input_size; ++i) {
       const Tensor *tensor = op->Input(i);
-      if (tensor->is_weight()) {
+      if (tensor->is_weight() || tensor->is_state()) {
         continue;
       }
       auto tensor_name = tensor->name();
@@ -196,6 +361,7 @@ MaceStatus AllocateTensorMemory<SERIAL_OPT>(const OperationArray &operators) {
       } else {
         tensor_refs[tensor_name]->refs++;
       }
+      tensor_refs[tensor_name]->consumers.push_back(op_idx);
     }
   }
 
@@ -208,7 +374,7 @@ MaceStatus AllocateTensorMemory<SERIAL_OPT>(const OperationArray &operators) {
       int reuse_input_idx = op->ReuseTensorMapId(i);
       if (reuse_input_idx >= 0) {
         const Tensor *reuse_in_tensor = op->Input(reuse_input_idx);
-        if (reuse_in_tensor->is_weight()) {
+        if (reuse_in_tensor->is_weight() || reuse_in_tensor->is_state()) {
           continue;
         }
         if (tensor_refs.count(out_tensor_name) == 0) {
@@ -220,6 +386,10 @@ MaceStatus AllocateTensorMemory<SERIAL_OPT>(const OperationArray &operators) {
         auto reuse_in_tensor_name = reuse_in_tensor->name();
         tensor_refs[reuse_in_tensor_name]->refs +=
             tensor_refs.at(out_tensor_name)->refs;
+        auto &consumers = tensor_refs[reuse_in_tensor_name]->consumers;
+        const auto &out_consumers = tensor_refs.at(out_tensor_name)->consumers;
+        consumers.insert(consumers.end(), out_consumers.begin(),
+                         out_consumers.end());
         tensor_refs[out_tensor_name] = tensor_refs.at(reuse_in_tensor_name);
       }
     }
@@ -227,15 +397,31 @@ MaceStatus AllocateTensorMemory<SERIAL_OPT>(const OperationArray &operators) {
 
   BufferList used_buf_list;
   BufferList free_buf_list;
+  // the ops which read each free buffer last
+  std::unordered_map<const Buffer *, std::vector<int>> buffer_consumers;
 
   // Simulate the execution of net and allocate memory for tensor
-  for (auto &op : operators) {
+  for (int op_idx = 0; op_idx < op_count; ++op_idx) {
+    auto &op = operators[op_idx];
+    // A free buffer is only reusable once all its readers have finished
+    auto reusable = [&](const Buffer *buffer) -> bool {
+      for (int consumer : buffer_consumers[buffer]) {
+        if (!order.FinishedBefore(consumer, op_idx)) {
+          return false;
+        }
+      }
+      return true;
+    };
     VLOG(2) << "Operator " << op->debug_def().name() << "<"
             << op->runtime_type() << ", " << op->debug_def().type() << ">";
     size_t output_size = static_cast<size_t>(op->OutputSize());
     for (size_t i = 0; i < output_size; ++i) {
       Tensor *tensor = op->Output(i);
       auto tensor_name = tensor->name();
+      // states keep the buffers reserved for their capacities
+      if (tensor->is_state()) {
+        continue;
+      }
 
       if (tensor_refs.count(tensor_name) == 0) {
         tensor_refs.emplace(tensor_name, std::make_shared<TensorRef>(tensor));
@@ -245,8 +431,14 @@ MaceStatus AllocateTensorMemory<SERIAL_OPT>(const OperationArray &operators) {
       std::shared_ptr<TensorRef> tensor_ref = tensor_refs.at(tensor_name);
       // The reused tensor does not need to allocate buffer
       auto essential_tensor_name = tensor_ref->tensor->name();
-      if (tensor_name == essential_tensor_name) {
-        SimulateAllocateBuffer(tensor_refs.at(tensor_name),
+      if (use_arena && tensor->memory_type() == MemoryType::CPU_BUFFER) {
+        // planned after the simulation, when all live ranges are known
+        if (tensor_name == essential_tensor_name && !tensor_ref->in_arena) {
+          tensor_ref->in_arena = true;
+          tensor_ref->producer = op_idx;
+        }
+      } else if (tensor_name == essential_tensor_name) {
+        SimulateAllocateBuffer(tensor_refs.at(tensor_name), reusable,
                                &used_buf_list, &free_buf_list);
       } else {
         VLOG(2) << "tensor " << tensor_name << " reuse the "
@@ -262,7 +454,7 @@ MaceStatus AllocateTensorMemory<SERIAL_OPT>(const OperationArray &operators) {
     for (size_t i = 0; i < input_size; ++i) {
       const Tensor *tensor = op->Input(i);
       auto tensor_name = tensor->name();
-      if (tensor->is_weight()) {
+      if (tensor->is_weight() || tensor->is_state()) {
         continue;
       }
       MACE_CHECK(tensor_refs.count(tensor_name) > 0);
@@ -274,6 +466,8 @@ MaceStatus AllocateTensorMemory<SERIAL_OPT>(const OperationArray &operators) {
         continue;
       }
       if (ref_num == 1) {
+        buffer_consumers[tensor_refs[tensor_name]->buffer] =
+            tensor_refs[tensor_name]->consumers;
         SimulateDeleteBuffer(tensor_refs[tensor_name],
                              &used_buf_list, &free_buf_list);
       }
@@ -281,8 +475,41 @@ MaceStatus AllocateTensorMemory<SERIAL_OPT>(const OperationArray &operators) {
   }
 
   ReallyAllocateBuffer(tensor_refs);
+  if (use_arena) {
+    ReallyAllocateArena(tensor_refs, op_count, order, plan);
+  }
 
   return MaceStatus::MACE_SUCCESS;
 }
 
+}  // namespace
+
+template<>
+MaceStatus AllocateTensorMemory<SERIAL_OPT>(const OperationArray &operators,
+                                            MemoryPlan *plan) {
+  return AllocateOptimized(operators, OpOrder(), false, plan);
+}
+
+template<>
+MaceStatus AllocateTensorMemory<PARALLEL_OPT>(
+    const OperationArray &operators, MemoryPlan *plan) {
+  OpDependency dependency;
+  BuildOpDependency(operators, &dependency);
+  return AllocateOptimized(operators, OpOrder(dependency), false, plan);
+}
+
+template<>
+MaceStatus AllocateTensorMemory<SERIAL_ARENA>(
+    const OperationArray &operators, MemoryPlan *plan) {
+  return AllocateOptimized(operators, OpOrder(), true, plan);
+}
+
+template<>
+MaceStatus AllocateTensorMemory<PARALLEL_ARENA>(
+    const OperationArray &operators, MemoryPlan *plan) {
+  OpDependency dependency;
+  BuildOpDependency(operators, &dependency);
+  return AllocateOptimized(operators, OpOrder(dependency), true, plan);
+}
+
 }  // namespace mace
@@ -47,14 +47,16 @@ struct MemBlock {
 
 
 template <>
-MaceStatus AllocateTensorMemory<SERIAL_REF>(const OperationArray &operators) {
+MaceStatus AllocateTensorMemory<SERIAL_REF>(const OperationArray &operators,
+                                            MemoryPlan *plan) {
+  MACE_CHECK(plan == nullptr, "SERIAL_REF does not make memory plans");
   std::unordered_map<std::string, std::shared_ptr<MemBlock>> tensor_refs;
   // Collect the refs of input tensor
   for (auto &op : operators) {
     size_t input_size = static_cast<size_t>(op->InputSize());
     for (size_t i = 0; i < input_size; ++i) {
       const Tensor *tensor = op->Input(i);
-      if (tensor->is_weight()) {
+      if (tensor->is_weight() || tensor->is_state()) {
         continue;
       }
       auto tensor_name = tensor->name();
@@ -76,7 +78,7 @@ MaceStatus AllocateTensorMemory<SERIAL_REF>(const OperationArray &operators) {
       int reuse_input_idx = op->ReuseTensorMapId(i);
       if (reuse_input_idx >= 0) {
         const Tensor *reuse_in_tensor = op->Input(reuse_input_idx);
-        if (reuse_in_tensor->is_weight()) {
+        if (reuse_in_tensor->is_weight() || reuse_in_tensor->is_state()) {
           continue;
         }
         if (tensor_refs.count(out_tensor_name) == 0) {
@@ -100,6 +102,10 @@ MaceStatus AllocateTensorMemory<SERIAL_REF>(const OperationArray &operators) {
     size_t output_size = static_cast<size_t>(op->OutputSize());
     for (size_t i = 0; i < output_size; ++i) {
       Tensor *tensor = op->Output(i);
+      // states keep the buffers reserved for their capacities
+      if (tensor->is_state()) {
+        continue;
+      }
       auto *runtime = tensor->GetCurRuntime();
       auto tensor_name = tensor->name();
       VLOG(2) << "allocate buffer for tensor: " << tensor_name << ", "
@@ -122,7 +128,7 @@ MaceStatus AllocateTensorMemory<SERIAL_REF>(const OperationArray &operators) {
     for (size_t i = 0; i < input_size; ++i) {
       const Tensor *tensor = op->Input(i);
       auto tensor_name = tensor->name();
-      if (tensor->is_weight()) {
+      if (tensor->is_weight() || tensor->is_state()) {
         continue;
       }
       MACE_CHECK(tensor_refs.count(tensor_name) > 0);
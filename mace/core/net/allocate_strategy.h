@@ -21,15 +21,31 @@
 #include "mace/core/ops/operator.h"
 
 namespace mace {
+
+class MemoryPlan;
+
 enum AllocateStrategy {
   SERIAL_REF = 0,
   SERIAL_OPT = 1,
+  // Like SERIAL_OPT, but only shares a buffer between tensors whose
+  // lifetimes are ordered by data dependencies, so that independent ops
+  // may run concurrently.
+  PARALLEL_OPT = 2,
+  // Like SERIAL_OPT and PARALLEL_OPT, but CPU buffers are placed at offsets
+  // of one arena per runtime, planned from the live ranges of the tensors,
+  // instead of reusing whole buffers of similar shapes.
+  SERIAL_ARENA = 3,
+  PARALLEL_ARENA = 4,
 };
 
 typedef std::vector<std::unique_ptr<Operation>> OperationArray;
 
+// Allocates the buffers of the intermediate tensors for their current
+// shapes. With a `plan`, the CPU buffers of the arena strategies are put in
+// the plan instead of being given to the tensors.
 template <AllocateStrategy S>
-MaceStatus AllocateTensorMemory(const OperationArray &operators_);
+MaceStatus AllocateTensorMemory(const OperationArray &operators_,
+                                MemoryPlan *plan = nullptr);
 
 }  // namespace mace
 
@@ -0,0 +1,69 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "mace/core/net/arena_planner.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "mace/utils/math.h"
+
+namespace mace {
+
+index_t PlanArena(const std::vector<index_t> &bytes, const index_t alignment,
+                  const std::function<bool(size_t, size_t)> &conflict,
+                  std::vector<index_t> *offsets) {
+  const size_t count = bytes.size();
+  std::vector<size_t> order(count);
+  for (size_t i = 0; i < count; ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return bytes[a] > bytes[b];
+  });
+
+  offsets->assign(count, -1);
+  index_t arena_bytes = 0;
+  // (offset, end) of the placed blocks conflicting with the current one
+  std::vector<std::pair<index_t, index_t>> occupied;
+  for (size_t i = 0; i < count; ++i) {
+    const size_t block = order[i];
+    const index_t size = RoundUp<index_t>(bytes[block], alignment);
+    occupied.clear();
+    for (size_t j = 0; j < i; ++j) {
+      const size_t placed = order[j];
+      if (conflict(block, placed)) {
+        const index_t offset = (*offsets)[placed];
+        occupied.emplace_back(
+            offset, offset + RoundUp<index_t>(bytes[placed], alignment));
+      }
+    }
+    std::sort(occupied.begin(), occupied.end());
+
+    index_t offset = 0;
+    for (auto &range : occupied) {
+      if (range.first - offset >= size) {
+        break;
+      }
+      offset = std::max(offset, range.second);
+    }
+    (*offsets)[block] = offset;
+    arena_bytes = std::max(arena_bytes, offset + size);
+  }
+
+  return arena_bytes;
+}
+
+}  // namespace mace
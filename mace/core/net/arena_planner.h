@@ -0,0 +1,37 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef MACE_CORE_NET_ARENA_PLANNER_H_
+#define MACE_CORE_NET_ARENA_PLANNER_H_
+
+#include <functional>
+#include <vector>
+
+#include "mace/core/types.h"
+
+namespace mace {
+
+// Assigns each block an offset in one arena so that blocks alive at the same
+// time, as told by `conflict(i, j)`, do not overlap. Greedy by size: the
+// largest block is placed first, every block then takes the lowest gap left
+// between the placed blocks it conflicts with. Offsets are multiples of
+// `alignment`. Returns the arena size in bytes.
+index_t PlanArena(const std::vector<index_t> &bytes, index_t alignment,
+                  const std::function<bool(size_t, size_t)> &conflict,
+                  std::vector<index_t> *offsets);
+
+}  // namespace mace
+
+#endif  // MACE_CORE_NET_ARENA_PLANNER_H_
@@ -46,6 +46,17 @@ class BaseNet {
 
   virtual MaceStatus AllocateIntermediateBuffer() = 0;
 
+  // Called once the inputs of a run have their shapes, before the outputs
+  // are bound to the caller's memory.
+  virtual MaceStatus PrepareForInputShapes() {
+    return MaceStatus::MACE_SUCCESS;
+  }
+
+  // Adds the counters of the memory plans cached per input shapes.
+  virtual void GetShapePlanStats(ShapePlanStats *stats) const {
+    MACE_UNUSED(stats);
+  }
+
  protected:
   MACE_DISABLE_COPY_AND_ASSIGN(BaseNet);
 };
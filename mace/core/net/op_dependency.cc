@@ -0,0 +1,72 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/core/net/op_dependency.h"
+
+#include <set>
+#include <unordered_map>
+
+#include "mace/core/tensor.h"
+
+namespace mace {
+
+void BuildOpDependency(const OperationArray &operators,
+                       OpDependency *dependency) {
+  const int op_count = static_cast<int>(operators.size());
+  std::unordered_map<const Tensor *, int> last_writer;
+  std::unordered_map<const Tensor *, std::vector<int>> readers;
+  std::vector<std::set<int>> predecessors(op_count);
+
+  for (int idx = 0; idx < op_count; ++idx) {
+    const auto &op = operators[idx];
+    std::set<int> &preds = predecessors[idx];
+    for (int i = 0; i < op->InputSize(); ++i) {
+      const Tensor *tensor = op->Input(i);
+      if (tensor->is_weight()) {
+        continue;
+      }
+      auto writer = last_writer.find(tensor);
+      if (writer != last_writer.end()) {
+        preds.insert(writer->second);
+      }
+      readers[tensor].push_back(idx);
+    }
+    for (int i = 0; i < op->OutputSize(); ++i) {
+      const Tensor *tensor = op->Output(i);
+      auto writer = last_writer.find(tensor);
+      if (writer != last_writer.end()) {
+        preds.insert(writer->second);
+      }
+      std::vector<int> &tensor_readers = readers[tensor];
+      for (int reader : tensor_readers) {
+        if (reader != idx) {
+          preds.insert(reader);
+        }
+      }
+      tensor_readers.clear();
+      last_writer[tensor] = idx;
+    }
+  }
+
+  dependency->predecessors.assign(op_count, std::vector<int>());
+  dependency->successors.assign(op_count, std::vector<int>());
+  for (int idx = 0; idx < op_count; ++idx) {
+    for (int pred : predecessors[idx]) {
+      dependency->predecessors[idx].push_back(pred);
+      dependency->successors[pred].push_back(idx);
+    }
+  }
+}
+
+}  // namespace mace
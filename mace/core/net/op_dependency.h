@@ -0,0 +1,40 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_CORE_NET_OP_DEPENDENCY_H_
+#define MACE_CORE_NET_OP_DEPENDENCY_H_
+
+#include <vector>
+
+#include "mace/core/net/allocate_strategy.h"
+
+namespace mace {
+
+// Data dependencies between the ops of a net. An op depends on the
+// producers of its inputs, and on the earlier readers and writers of its
+// outputs if a tensor is written more than once. The order of
+// `operators` is always a valid execution order.
+struct OpDependency {
+  // ops that must finish before each op starts, in ascending order
+  std::vector<std::vector<int>> predecessors;
+  // ops waiting for each op, in ascending order
+  std::vector<std::vector<int>> successors;
+};
+
+void BuildOpDependency(const OperationArray &operators,
+                       OpDependency *dependency);
+
+}  // namespace mace
+
+#endif  // MACE_CORE_NET_OP_DEPENDENCY_H_
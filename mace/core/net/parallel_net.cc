@@ -0,0 +1,248 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/core/net/parallel_net.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "mace/core/net/allocate_strategy.h"
+#include "mace/core/net/op_dependency.h"
+#include "mace/core/ops/op_context.h"
+#include "mace/port/env.h"
+#include "mace/utils/conf_util.h"
+#include "mace/utils/logging.h"
+#include "mace/utils/memory.h"
+#include "mace/utils/tracer.h"
+#include "mace/utils/tuner.h"
+
+namespace mace {
+
+ParallelNet::ParallelNet(const OpRegistry *op_registry,
+                         const NetDef *net_def,
+                         Workspace *ws,
+                         Runtime *target_runtime,
+                         Runtime *cpu_runtime,
+                         int num_lanes,
+                         int num_threads,
+                         int shape_plan_cache_size)
+    : SerialNet(op_registry, net_def, ws, target_runtime, cpu_runtime,
+                shape_plan_cache_size),
+      num_lanes_(num_lanes),
+      num_threads_(num_threads),
+      parallel_(false),
+      run_id_(0),
+      stop_(false),
+      busy_lanes_(0),
+      finished_ops_(0),
+      status_(MaceStatus::MACE_SUCCESS) {}
+
+ParallelNet::~ParallelNet() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cond_.notify_all();
+  for (auto &thread : lane_threads_) {
+    thread.join();
+  }
+  VLOG(1) << "Destroy ParallelNet";
+}
+
+MaceStatus ParallelNet::Init() {
+  MACE_LATENCY_LOGGER(1, "Initializing ParallelNet");
+  MACE_RETURN_IF_ERROR(InitOperators());
+  MACE_RETURN_IF_ERROR(PrepackOperators());
+
+  parallel_ = num_lanes_ > 1 && operators_.size() > 1 &&
+      target_runtime_->GetRuntimeType() == RuntimeType::RT_CPU;
+  for (auto &op : operators_) {
+    parallel_ = parallel_ && op->runtime_type() == RuntimeType::RT_CPU;
+  }
+  // the ops are timed one at a time while tuning
+  parallel_ = parallel_ && !GetTuningFromEnv();
+  if (parallel_) {
+    MACE_RETURN_IF_ERROR(CreateLanes());
+  }
+  InitShapePlanCache();
+  if (!parallel_) {
+    VLOG(1) << "Run ops of the net one after another";
+    return AllocateIntermediateBuffer();
+  }
+
+  OpDependency dependency;
+  BuildOpDependency(operators_, &dependency);
+  successors_ = std::move(dependency.successors);
+  num_predecessors_.clear();
+  for (auto &predecessors : dependency.predecessors) {
+    num_predecessors_.push_back(static_cast<int>(predecessors.size()));
+  }
+
+  for (size_t i = 1; i < lanes_.size(); ++i) {
+    lane_threads_.emplace_back(&ParallelNet::LaneLoop, this, lanes_[i].get());
+  }
+
+  return AllocateIntermediateBuffer();
+}
+
+MaceStatus ParallelNet::CreateLanes() {
+  int num_threads = num_threads_;
+  if (num_threads <= 0) {
+    std::vector<float> cpu_max_freqs;
+    if (GetCPUMaxFreq(&cpu_max_freqs) == MaceStatus::MACE_SUCCESS) {
+      num_threads = static_cast<int>(cpu_max_freqs.size());
+    } else {
+      num_threads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+  }
+  const int lane_threads = std::max(1, num_threads / num_lanes_);
+  VLOG(1) << "Run up to " << num_lanes_ << " ops concurrently, "
+          << lane_threads << " threads each";
+
+  for (int i = 0; i < num_lanes_; ++i) {
+    auto lane = make_unique<Lane>();
+    lane->thread_pool = make_unique<utils::ThreadPool>(
+        lane_threads, CPUAffinityPolicy::AFFINITY_NONE);
+    lane->thread_pool->Init();
+    lane->runtime_context =
+        make_unique<RuntimeContext>(lane->thread_pool.get());
+    lane->runtime =
+        cpu_runtime_->CreateConcurrentRuntime(lane->runtime_context.get());
+    if (lane->runtime == nullptr) {
+      LOG(WARNING) << "CPU runtime can not run ops concurrently";
+      lanes_.clear();
+      parallel_ = false;
+      return MaceStatus::MACE_SUCCESS;
+    }
+    lanes_.emplace_back(std::move(lane));
+  }
+
+  return MaceStatus::MACE_SUCCESS;
+}
+
+void ParallelNet::LaneLoop(Lane *lane) {
+  int64_t last_run_id = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait(lock, [&] { return stop_ || run_id_ != last_run_id; });
+      if (stop_) {
+        return;
+      }
+      last_run_id = run_id_;
+    }
+    RunReadyOps(lane->runtime.get());
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --busy_lanes_;
+    }
+    cond_.notify_all();
+  }
+}
+
+void ParallelNet::RunReadyOps(Runtime *runtime) {
+  const int op_count = static_cast<int>(operators_.size());
+  OpContext context(ws_, runtime);
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    cond_.wait(lock, [&] {
+      return !ready_ops_.empty() || finished_ops_ == op_count ||
+          status_ != MaceStatus::MACE_SUCCESS;
+    });
+    if (finished_ops_ == op_count || status_ != MaceStatus::MACE_SUCCESS) {
+      return;
+    }
+    const int idx = ready_ops_.top();
+    ready_ops_.pop();
+    lock.unlock();
+
+    auto &op = operators_[idx];
+    VLOG(3) << "Running operator " << op->debug_def().name() << "<"
+            << op->debug_def().type() << ">";
+    MaceStatus status;
+    {
+      utils::TraceSpan trace_span("op", op->debug_def().name().c_str(),
+                                  "type", op->debug_def().type().c_str());
+      status = op->Forward(&context);
+    }
+
+    lock.lock();
+    if (status != MaceStatus::MACE_SUCCESS) {
+      status_ = status;
+      cond_.notify_all();
+      return;
+    }
+    ++finished_ops_;
+    int new_ready_ops = 0;
+    for (int successor : successors_[idx]) {
+      if (--pending_predecessors_[successor] == 0) {
+        ready_ops_.push(successor);
+        ++new_ready_ops;
+      }
+    }
+    // this thread takes the first ready op itself
+    if (new_ready_ops > 1 || finished_ops_ == op_count) {
+      cond_.notify_all();
+    }
+  }
+}
+
+MaceStatus ParallelNet::Run(RunMetadata *run_metadata, bool fake_warmup) {
+  if (!parallel_ || run_metadata != nullptr || fake_warmup ||
+      EnvConfEnabled("MACE_LOG_TENSOR_RANGE")) {
+    return SerialNet::Run(run_metadata, fake_warmup);
+  }
+
+  MACE_MEMORY_LOGGING_GUARD();
+  MACE_LATENCY_LOGGER(1, "Running net in parallel");
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_predecessors_ = num_predecessors_;
+    for (size_t i = 0; i < num_predecessors_.size(); ++i) {
+      if (num_predecessors_[i] == 0) {
+        ready_ops_.push(static_cast<int>(i));
+      }
+    }
+    finished_ops_ = 0;
+    status_ = MaceStatus::MACE_SUCCESS;
+    busy_lanes_ = static_cast<int>(lane_threads_.size());
+    ++run_id_;
+  }
+  cond_.notify_all();
+
+  // the calling thread works as the first lane
+  RunReadyOps(lanes_[0]->runtime.get());
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  cond_.wait(lock, [&] { return busy_lanes_ == 0; });
+  // left over by a failed op
+  while (!ready_ops_.empty()) {
+    ready_ops_.pop();
+  }
+  MaceStatus run_status = status_;
+  lock.unlock();
+  if (run_status != MaceStatus::MACE_SUCCESS) {
+    return run_status;
+  }
+  return CachePendingPlan();
+}
+
+MaceStatus ParallelNet::PlanTensorMemory(MemoryPlan *plan) {
+  if (parallel_) {
+    return AllocateTensorMemory<PARALLEL_ARENA>(operators_, plan);
+  }
+  return AllocateTensorMemory<SERIAL_ARENA>(operators_, plan);
+}
+
+}  // namespace mace
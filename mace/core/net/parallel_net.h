@@ -0,0 +1,94 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_CORE_NET_PARALLEL_NET_H_
+#define MACE_CORE_NET_PARALLEL_NET_H_
+
+#include <condition_variable>  // NOLINT(build/c++11)
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <queue>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "mace/core/net/serial_net.h"
+#include "mace/core/runtime/runtime_context.h"
+#include "mace/utils/thread_pool.h"
+
+namespace mace {
+
+// Runs the ops whose inputs are ready concurrently, up to `num_lanes` at a
+// time. Each lane owns a share of the CPU threads and its own scratch
+// memory, and the intermediate buffers are planned so that ops which may
+// run at the same time never share one. Profiling, tensor range logging and
+// non-CPU nets fall back to the serial execution of SerialNet.
+class ParallelNet : public SerialNet {
+ public:
+  ParallelNet(const OpRegistry *op_registry,
+              const NetDef *net_def,
+              Workspace *ws,
+              Runtime *target_runtime,
+              Runtime *cpu_runtime,
+              int num_lanes,
+              int num_threads,
+              int shape_plan_cache_size = 0);
+  ~ParallelNet();
+
+  MaceStatus Init() override;
+
+  MaceStatus Run(RunMetadata *run_metadata = nullptr,
+                 bool fake_warmup = false) override;
+
+ protected:
+  MaceStatus PlanTensorMemory(MemoryPlan *plan) override;
+
+ private:
+  struct Lane {
+    std::unique_ptr<utils::ThreadPool> thread_pool;
+    std::unique_ptr<RuntimeContext> runtime_context;
+    std::unique_ptr<Runtime> runtime;
+  };
+
+  MaceStatus CreateLanes();
+  void LaneLoop(Lane *lane);
+  // Run ready ops until the net finishes or fails.
+  void RunReadyOps(Runtime *runtime);
+
+  int num_lanes_;
+  int num_threads_;
+  bool parallel_;
+  std::vector<std::unique_ptr<Lane>> lanes_;
+  std::vector<std::thread> lane_threads_;
+  std::vector<std::vector<int>> successors_;
+  std::vector<int> num_predecessors_;
+
+  std::mutex mutex_;
+  // signals new ready ops, finished ops and the start of a run
+  std::condition_variable cond_;
+  int64_t run_id_;
+  bool stop_;
+  int busy_lanes_;
+  std::vector<int> pending_predecessors_;
+  // lowest index first, to stay close to the serial order
+  std::priority_queue<int, std::vector<int>, std::greater<int>> ready_ops_;
+  int finished_ops_;
+  MaceStatus status_;
+
+  MACE_DISABLE_COPY_AND_ASSIGN(ParallelNet);
+};
+
+}  // namespace mace
+
+#endif  // MACE_CORE_NET_PARALLEL_NET_H_
@@ -17,14 +17,18 @@
 #include <algorithm>
 #include <limits>
 #include <set>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include "mace/core/future.h"
+#include "mace/core/memory/buffer.h"
 #include "mace/core/net/allocate_strategy.h"
 #include "mace/core/ops/op_init_context.h"
 #include "mace/core/ops/op_context.h"
 #include "mace/core/registry/ops_registry.h"
+#include "mace/core/workspace.h"
 #include "mace/public/mace.h"
 #include "mace/port/env.h"
 #include "mace/utils/conf_util.h"
@@ -33,6 +37,7 @@
 #include "mace/utils/math.h"
 #include "mace/utils/memory.h"
 #include "mace/utils/timer.h"
+#include "mace/utils/tracer.h"
 
 
 namespace mace {
@@ -41,13 +46,23 @@ SerialNet::SerialNet(const OpRegistry *op_registry,
                      const NetDef *net_def,
                      Workspace *ws,
                      Runtime *target_runtime,
-                     Runtime *cpu_runtime)
+                     Runtime *cpu_runtime,
+                     int shape_plan_cache_size)
     : BaseNet(),
       ws_(ws),
       target_runtime_(target_runtime),
-      cpu_runtime_(cpu_runtime) {
+      cpu_runtime_(cpu_runtime),
+      shape_plan_cache_size_(shape_plan_cache_size),
+      plan_pending_(false),
+      run_without_plan_(false) {
   MACE_LATENCY_LOGGER(1, "Constructing SerialNet");
 
+  for (auto &input_info : net_def->input_info()) {
+    declared_input_shapes_.emplace(
+        input_info.name(), std::vector<index_t>(input_info.dims().begin(),
+                                                input_info.dims().end()));
+  }
+
   OpConstructContext construct_context(ws_);
   for (int idx = 0; idx < net_def->op_size(); ++idx) {
     std::shared_ptr<OperatorDef> op_def(new OperatorDef(net_def->op(idx)));
@@ -75,6 +90,15 @@ SerialNet::~SerialNet() {
 
 MaceStatus SerialNet::Init() {
   MACE_LATENCY_LOGGER(1, "Initializing SerialNet");
+  MACE_RETURN_IF_ERROR(InitOperators());
+  MACE_RETURN_IF_ERROR(PrepackOperators());
+  InitShapePlanCache();
+  MACE_RETURN_IF_ERROR(AllocateIntermediateBuffer());
+
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStatus SerialNet::InitOperators() {
   OpInitContext init_context(ws_);
   for (auto iter = operators_.begin(); iter != operators_.end(); ++iter) {
     auto &op = *iter;
@@ -85,11 +109,177 @@ MaceStatus SerialNet::Init() {
     MACE_RETURN_IF_ERROR(op->Init(&init_context));
   }
 
-  MACE_RETURN_IF_ERROR(AllocateTensorMemory<SERIAL_OPT>(operators_));
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStatus SerialNet::PrepackOperators() {
+  if (target_runtime_->GetRuntimeType() != RuntimeType::RT_CPU) {
+    return MaceStatus::MACE_SUCCESS;
+  }
+  MACE_LATENCY_LOGGER(1, "Prepacking weights");
+  std::unordered_map<const Tensor *, int> weight_readers;
+  for (auto &op : operators_) {
+    for (const Tensor *input : op->Inputs()) {
+      if (input->is_weight()) {
+        ++weight_readers[input];
+      }
+    }
+  }
+
+  OpContext context(ws_, cpu_runtime_);
+  std::vector<int> released_inputs;
+  for (auto &op : operators_) {
+    released_inputs.clear();
+    MACE_RETURN_IF_ERROR(op->Prepack(&context, &released_inputs));
+    for (int idx : released_inputs) {
+      const Tensor *weight = op->Input(idx);
+      auto iter = weight_readers.find(weight);
+      if (iter == weight_readers.end() || --iter->second > 0) {
+        continue;
+      }
+      // Only weights copied into the workspace are dropped, weights sliced
+      // from the caller's model data may be shared with other engines.
+      if (ws_->diffused_buffer() &&
+          weight->memory_type() == MemoryType::CPU_BUFFER) {
+        VLOG(2) << "Drop the data of prepacked weight " << weight->name();
+        AdviseFree(const_cast<void *>(weight->raw_data()),
+                   weight->raw_size());
+      }
+    }
+  }
 
   return MaceStatus::MACE_SUCCESS;
 }
 
+void SerialNet::InitShapePlanCache() {
+  if (shape_plan_cache_size_ <= 0 ||
+      target_runtime_->GetRuntimeType() != RuntimeType::RT_CPU) {
+    return;
+  }
+  std::unordered_set<const Tensor *> outputs;
+  std::unordered_set<const Tensor *> reused_outputs;
+  for (auto &op : operators_) {
+    for (int i = 0; i < op->OutputSize(); ++i) {
+      const Tensor *output = op->Output(i);
+      // states are not planned, nor are their shapes part of the signature
+      if (output->is_state()) {
+        continue;
+      }
+      // the plans only hold slices of CPU arenas
+      if (output->memory_type() != MemoryType::CPU_BUFFER) {
+        VLOG(1) << "Tensor " << output->name()
+                << " is not in CPU memory, do not cache memory plans";
+        return;
+      }
+      outputs.insert(output);
+      if (op->ReuseTensorMapId(i) >= 0) {
+        reused_outputs.insert(output);
+      }
+    }
+  }
+
+  std::unordered_set<const Tensor *> inputs;
+  for (auto &op : operators_) {
+    for (const Tensor *input : op->Inputs()) {
+      if (!input->is_weight() && !input->is_state() &&
+          outputs.count(input) == 0 &&
+          inputs.insert(input).second) {
+        input_tensors_.push_back(input);
+      }
+    }
+  }
+  for (const Tensor *output : outputs) {
+    if (reused_outputs.count(output) == 0) {
+      resizable_outputs_.insert(output);
+    }
+  }
+  // The intermediate tensors are shaped for the declared input shapes until
+  // the first run.
+  for (const Tensor *input : input_tensors_) {
+    auto iter = declared_input_shapes_.find(input->name());
+    AppendShapeSignature(iter == declared_input_shapes_.end() ?
+                         input->shape() : iter->second, &declared_signature_);
+  }
+  shape_plan_cache_.reset(
+      new ShapePlanCache(static_cast<size_t>(shape_plan_cache_size_)));
+}
+
+MaceStatus SerialNet::PlanTensorMemory(MemoryPlan *plan) {
+  return AllocateTensorMemory<SERIAL_ARENA>(operators_, plan);
+}
+
+ShapeSignature SerialNet::InputShapeSignature() const {
+  ShapeSignature signature;
+  for (const Tensor *input : input_tensors_) {
+    AppendShapeSignature(input->shape(), &signature);
+  }
+  return signature;
+}
+
+void SerialNet::InstallPlan(std::shared_ptr<MemoryPlan> plan) {
+  std::unordered_map<const Tensor *, const Buffer *> installed_buffers;
+  if (installed_plan_ != nullptr) {
+    for (auto &tensor_buffer : installed_plan_->tensor_buffers()) {
+      installed_buffers[tensor_buffer.first] = tensor_buffer.second.get();
+    }
+  }
+  for (auto &tensor_buffer : plan->tensor_buffers()) {
+    Tensor *tensor = tensor_buffer.first;
+    std::shared_ptr<Buffer> old = tensor->SwapBuffer(tensor_buffer.second);
+    // Buffers of other plans are released with their plans, the others were
+    // rented by Tensor::Resize for shapes without a plan.
+    auto iter = installed_buffers.find(tensor);
+    if (old != nullptr && resizable_outputs_.count(tensor) > 0 &&
+        (iter == installed_buffers.end() || iter->second != old.get()) &&
+        old->memory<void>() != nullptr && old->external_bytes() == 0) {
+      VLOG(3) << "Release the buffer resized for tensor " << tensor->name();
+      tensor->GetCurRuntime()->ReleaseBuffer(old.get(), RENT_PRIVATE);
+    }
+  }
+  installed_plan_ = std::move(plan);
+  run_without_plan_ = false;
+}
+
+MaceStatus SerialNet::PrepareForInputShapes() {
+  if (shape_plan_cache_ == nullptr) {
+    return MaceStatus::MACE_SUCCESS;
+  }
+  ShapeSignature signature = InputShapeSignature();
+  std::shared_ptr<MemoryPlan> plan = shape_plan_cache_->Get(signature);
+  if (plan == nullptr) {
+    VLOG(2) << "No memory plan for input shapes " << MakeString(signature);
+    plan_pending_ = true;
+    pending_signature_ = std::move(signature);
+    run_without_plan_ = true;
+  } else if (plan != installed_plan_ || run_without_plan_) {
+    InstallPlan(std::move(plan));
+  }
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStatus SerialNet::CachePendingPlan() {
+  if (!plan_pending_) {
+    return MaceStatus::MACE_SUCCESS;
+  }
+  plan_pending_ = false;
+  // Installed by the next run with these shapes, the outputs of this run are
+  // still to be read.
+  auto plan = std::make_shared<MemoryPlan>(RENT_PRIVATE);
+  MACE_RETURN_IF_ERROR(PlanTensorMemory(plan.get()));
+  shape_plan_cache_->Put(pending_signature_, std::move(plan));
+  return MaceStatus::MACE_SUCCESS;
+}
+
+void SerialNet::GetShapePlanStats(ShapePlanStats *stats) const {
+  if (shape_plan_cache_ == nullptr) {
+    return;
+  }
+  const ShapePlanStats &cache_stats = shape_plan_cache_->stats();
+  stats->hits += cache_stats.hits;
+  stats->misses += cache_stats.misses;
+  stats->evictions += cache_stats.evictions;
+}
+
 MaceStatus SerialNet::Run(RunMetadata *run_metadata,
                           bool fake_warmup) {
   const char *profiling = getenv("MACE_OPENCL_PROFILING");
@@ -119,6 +309,8 @@ MaceStatus SerialNet::Run(RunMetadata *run_metadata,
       context.set_runtime(cpu_runtime_);
     }
 
+    utils::TraceSpan trace_span("op", op->debug_def().name().c_str(),
+                                "type", op->debug_def().type().c_str());
     CallStats call_stats;
     if (run_metadata == nullptr) {
       MACE_RETURN_IF_ERROR(op->Forward(&context));
@@ -224,11 +416,24 @@ MaceStatus SerialNet::Run(RunMetadata *run_metadata,
     }
   }
 
-  return MaceStatus::MACE_SUCCESS;
+  return CachePendingPlan();
 }
 
 MaceStatus SerialNet::AllocateIntermediateBuffer() {
-  MACE_RETURN_IF_ERROR(AllocateTensorMemory<SERIAL_OPT>(operators_));
+  if (shape_plan_cache_ == nullptr) {
+    return PlanTensorMemory(nullptr);
+  }
+  // The shared buffers are planned again for the current shapes, the plans
+  // of other shapes rented before are given back.
+  shape_plan_cache_->Clear();
+  plan_pending_ = false;
+  auto plan = std::make_shared<MemoryPlan>(RENT_SHARE);
+  MACE_RETURN_IF_ERROR(PlanTensorMemory(plan.get()));
+  const bool first_plan = installed_plan_ == nullptr;
+  InstallPlan(plan);
+  shape_plan_cache_->Put(
+      first_plan ? declared_signature_ : InputShapeSignature(),
+      std::move(plan));
   return MaceStatus::MACE_SUCCESS;
 }
 
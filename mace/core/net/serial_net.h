@@ -19,10 +19,12 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <sstream>
 
 #include "mace/core/ops/operator.h"
 #include "mace/core/net/base_net.h"
+#include "mace/core/net/shape_plan_cache.h"
 
 namespace mace {
 
@@ -35,7 +37,8 @@ class SerialNet : public BaseNet {
             const NetDef *net_def,
             Workspace *ws,
             Runtime *target_runtime,
-            Runtime *cpu_runtime);
+            Runtime *cpu_runtime,
+            int shape_plan_cache_size = 0);
   virtual ~SerialNet();
 
   MaceStatus Init() override;
@@ -45,13 +48,50 @@ class SerialNet : public BaseNet {
 
   MaceStatus AllocateIntermediateBuffer() override;
 
+  MaceStatus PrepareForInputShapes() override;
+
+  void GetShapePlanStats(ShapePlanStats *stats) const override;
+
  protected:
+  MaceStatus InitOperators();
+  // Lets CPU ops prepack their constant inputs, then drops the data of the
+  // weights every reader has its own packed copy of.
+  MaceStatus PrepackOperators();
+  // Caches the memory plans of CPU nets per input shapes, the shapes of the
+  // intermediate tensors being a function of them.
+  void InitShapePlanCache();
+  // Allocates the intermediate buffers for the current shapes, or puts them
+  // in `plan`.
+  virtual MaceStatus PlanTensorMemory(MemoryPlan *plan);
+  // Plans the input shapes of a run which had no plan, once the run gave
+  // the intermediate tensors their shapes.
+  MaceStatus CachePendingPlan();
+
   Workspace *ws_;
   Runtime *target_runtime_;
   // CPU is base device.
   Runtime *cpu_runtime_;
   std::vector<std::unique_ptr<Operation>> operators_;
 
+ private:
+  ShapeSignature InputShapeSignature() const;
+  void InstallPlan(std::shared_ptr<MemoryPlan> plan);
+
+  int shape_plan_cache_size_;
+  std::unique_ptr<ShapePlanCache> shape_plan_cache_;
+  // the inputs of the net, which are not written by any op
+  std::vector<const Tensor *> input_tensors_;
+  // the outputs whose buffers are only replaced by Tensor::Resize, never
+  // shared with an input
+  std::unordered_set<const Tensor *> resizable_outputs_;
+  std::unordered_map<std::string, std::vector<index_t>> declared_input_shapes_;
+  ShapeSignature declared_signature_;
+  std::shared_ptr<MemoryPlan> installed_plan_;
+  bool plan_pending_;
+  ShapeSignature pending_signature_;
+  // some tensors have buffers rented by Tensor::Resize
+  bool run_without_plan_;
+
  protected:
   MACE_DISABLE_COPY_AND_ASSIGN(SerialNet);
 };
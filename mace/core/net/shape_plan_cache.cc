@@ -0,0 +1,88 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/core/net/shape_plan_cache.h"
+
+#include "mace/core/memory/buffer.h"
+#include "mace/core/runtime/runtime.h"
+#include "mace/utils/logging.h"
+
+namespace mace {
+
+MemoryPlan::MemoryPlan(BufRentType rent_type) : rent_type_(rent_type) {}
+
+MemoryPlan::~MemoryPlan() {
+  if (rent_type_ == BufRentType::RENT_SHARE) {
+    return;
+  }
+  for (auto &arena : arenas_) {
+    arena.first->ReleaseBuffer(arena.second.get(), rent_type_);
+  }
+}
+
+void MemoryPlan::AddArena(Runtime *runtime, std::unique_ptr<Buffer> arena) {
+  arenas_.emplace_back(runtime, std::move(arena));
+}
+
+void MemoryPlan::AddTensorBuffer(Tensor *tensor,
+                                 std::shared_ptr<Buffer> buffer) {
+  tensor_buffers_.emplace_back(tensor, std::move(buffer));
+}
+
+void AppendShapeSignature(const std::vector<index_t> &shape,
+                          ShapeSignature *signature) {
+  signature->push_back(static_cast<index_t>(shape.size()));
+  signature->insert(signature->end(), shape.begin(), shape.end());
+}
+
+ShapePlanCache::ShapePlanCache(size_t capacity)
+    : capacity_(capacity), stats_{0, 0, 0} {
+  MACE_CHECK(capacity_ > 0);
+}
+
+std::shared_ptr<MemoryPlan> ShapePlanCache::Get(
+    const ShapeSignature &signature) {
+  for (auto iter = plans_.begin(); iter != plans_.end(); ++iter) {
+    if (iter->first == signature) {
+      plans_.splice(plans_.begin(), plans_, iter);
+      ++stats_.hits;
+      return plans_.front().second;
+    }
+  }
+  ++stats_.misses;
+  return nullptr;
+}
+
+void ShapePlanCache::Put(const ShapeSignature &signature,
+                         std::shared_ptr<MemoryPlan> plan) {
+  for (auto iter = plans_.begin(); iter != plans_.end(); ++iter) {
+    if (iter->first == signature) {
+      plans_.erase(iter);
+      break;
+    }
+  }
+  plans_.emplace_front(signature, std::move(plan));
+  while (plans_.size() > capacity_) {
+    VLOG(2) << "Evict the memory plan of input shapes "
+            << MakeString(plans_.back().first);
+    plans_.pop_back();
+    ++stats_.evictions;
+  }
+}
+
+void ShapePlanCache::Clear() {
+  plans_.clear();
+}
+
+}  // namespace mace
@@ -0,0 +1,92 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_CORE_NET_SHAPE_PLAN_CACHE_H_
+#define MACE_CORE_NET_SHAPE_PLAN_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "mace/core/memory/allocator.h"
+#include "mace/core/types.h"
+#include "mace/public/mace.h"
+#include "mace/utils/macros.h"
+
+namespace mace {
+
+class Buffer;
+class Runtime;
+class Tensor;
+
+// The buffers of the intermediate tensors of a net planned for some shapes
+// of its inputs. They are slices of arenas owned by the plan, the arenas
+// rented as RENT_PRIVATE are given back to their runtime with the plan, the
+// RENT_SHARE ones are left to the runtime like any shared buffer.
+class MemoryPlan {
+ public:
+  explicit MemoryPlan(BufRentType rent_type);
+  ~MemoryPlan();
+
+  BufRentType rent_type() const { return rent_type_; }
+
+  void AddArena(Runtime *runtime, std::unique_ptr<Buffer> arena);
+  void AddTensorBuffer(Tensor *tensor, std::shared_ptr<Buffer> buffer);
+
+  const std::vector<std::pair<Tensor *, std::shared_ptr<Buffer>>> &
+  tensor_buffers() const {
+    return tensor_buffers_;
+  }
+
+ private:
+  BufRentType rent_type_;
+  std::vector<std::pair<Runtime *, std::unique_ptr<Buffer>>> arenas_;
+  std::vector<std::pair<Tensor *, std::shared_ptr<Buffer>>> tensor_buffers_;
+
+  MACE_DISABLE_COPY_AND_ASSIGN(MemoryPlan);
+};
+
+// The shapes of the inputs of a net, rank followed by the dims of each.
+typedef std::vector<index_t> ShapeSignature;
+
+void AppendShapeSignature(const std::vector<index_t> &shape,
+                          ShapeSignature *signature);
+
+// Memory plans of the input shapes seen last, at most `capacity` of them,
+// the least recently used plan is evicted first.
+class ShapePlanCache {
+ public:
+  explicit ShapePlanCache(size_t capacity);
+
+  // Returns the plan of `signature` and makes it the most recently used,
+  // nullptr if there is none. Counted as a hit or a miss.
+  std::shared_ptr<MemoryPlan> Get(const ShapeSignature &signature);
+  void Put(const ShapeSignature &signature, std::shared_ptr<MemoryPlan> plan);
+  void Clear();
+
+  const ShapePlanStats &stats() const { return stats_; }
+
+ private:
+  size_t capacity_;
+  // most recently used first
+  std::list<std::pair<ShapeSignature, std::shared_ptr<MemoryPlan>>> plans_;
+  ShapePlanStats stats_;
+
+  MACE_DISABLE_COPY_AND_ASSIGN(ShapePlanCache);
+};
+
+}  // namespace mace
+
+#endif  // MACE_CORE_NET_SHAPE_PLAN_CACHE_H_
@@ -157,7 +157,7 @@ void BuildTransposeOpDef(
 }  // namespace
 
 NetDefAdapter::NetDefAdapter(const OpRegistry *op_registry,
-                             const Workspace *ws)
+                             Workspace *ws)
     : op_registry_(op_registry), ws_(ws) {}
 
 MaceStatus NetDefAdapter::AdaptNetDef(const NetDef *net_def,
@@ -374,6 +374,9 @@ MaceStatus NetDefAdapter::AdaptNetDef(const NetDef *net_def,
     }
   }
 
+  MACE_RETURN_IF_ERROR(net_optimizer_.OptimizeNetDef(
+      ws_, target_runtime_type, target_net_def));
+
   VLOG(3) << DebugString(target_net_def);
   return MaceStatus::MACE_SUCCESS;
 }
@@ -52,7 +52,7 @@ class Workspace;
 class NetDefAdapter {
  public:
   NetDefAdapter(const OpRegistry *op_registry,
-                const Workspace *ws);
+                Workspace *ws);
   // Adapt original net_def to a better net.
   // 1. Adapt device: choose best device for every op in the net.
   // 2. Adapt data type: Add data type related transform ops
@@ -61,6 +61,8 @@ class NetDefAdapter {
   //                       and add transpose if necessary.
   // 4. Adapt memory type: Add BufferTransform if necessary
   //                       for transforming memory type between ops.
+  // 5. Optimize graph: remove the transposes, reshapes and activations
+  //                    the net can do without, see NetOptimizer.
   MaceStatus AdaptNetDef(const NetDef *net_def,
                          Runtime *target_runtime,
                          Runtime *cpu_runtime,
@@ -140,7 +142,7 @@ class NetDefAdapter {
 
  private:
   const OpRegistry *op_registry_;
-  const Workspace *ws_;
+  Workspace *ws_;
   NetOptimizer net_optimizer_;
 };
 
@@ -14,10 +14,471 @@
 
 #include "mace/core/net_optimizer.h"
 
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <numeric>
 #include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "mace/core/proto/arg_helper.h"
+#include "mace/core/tensor.h"
+#include "mace/core/workspace.h"
+#include "mace/utils/logging.h"
+#include "mace/utils/memory.h"
 
 namespace mace {
 
+namespace {
+
+// Producers and consumers of the tensors of a net, built again after each
+// rewrite of the net.
+class GraphView {
+ public:
+  explicit GraphView(const NetDef *net_def) {
+    for (auto &output_info : net_def->output_info()) {
+      net_outputs_.insert(output_info.name());
+    }
+    for (auto &input_info : net_def->input_info()) {
+      formats_[input_info.name()] =
+          static_cast<DataFormat>(input_info.data_format());
+    }
+    for (int idx = 0; idx < net_def->op_size(); ++idx) {
+      auto &op_def = net_def->op(idx);
+      DataFormat data_format = static_cast<DataFormat>(
+          ProtoArgHelper::GetOptionalArg<OperatorDef, int>(
+              op_def, "data_format", static_cast<int>(DataFormat::NONE)));
+      for (auto &output : op_def.output()) {
+        producers_[output] = idx;
+        formats_[output] = data_format;
+      }
+      for (auto &input : op_def.input()) {
+        auto &consumers = consumers_[input];
+        if (consumers.empty() || consumers.back() != idx) {
+          consumers.push_back(idx);
+        }
+      }
+    }
+  }
+
+  // -1 for the inputs of the net and the weights
+  int Producer(const std::string &name) const {
+    auto iter = producers_.find(name);
+    return iter == producers_.end() ? -1 : iter->second;
+  }
+
+  size_t NumConsumers(const std::string &name) const {
+    auto iter = consumers_.find(name);
+    return iter == consumers_.end() ? 0 : iter->second.size();
+  }
+
+  // -1 if the tensor is read by more ops or is an output of the net
+  int SoleConsumer(const std::string &name) const {
+    if (net_outputs_.count(name) > 0 || NumConsumers(name) != 1) {
+      return -1;
+    }
+    return consumers_.at(name)[0];
+  }
+
+  bool IsNetOutput(const std::string &name) const {
+    return net_outputs_.count(name) > 0;
+  }
+
+  // the data format the tensor is tagged with when the net runs
+  DataFormat Format(const std::string &name) const {
+    auto iter = formats_.find(name);
+    return iter == formats_.end() ? DataFormat::NONE : iter->second;
+  }
+
+ private:
+  std::unordered_map<std::string, int> producers_;
+  std::unordered_map<std::string, std::vector<int>> consumers_;
+  std::unordered_map<std::string, DataFormat> formats_;
+  std::set<std::string> net_outputs_;
+};
+
+DataType OpDataType(const OperatorDef &op_def) {
+  return static_cast<DataType>(ProtoArgHelper::GetOptionalArg<OperatorDef, int>(
+      op_def, "T", static_cast<int>(DT_FLOAT)));
+}
+
+DataFormat OpDataFormat(const OperatorDef &op_def) {
+  return static_cast<DataFormat>(
+      ProtoArgHelper::GetOptionalArg<OperatorDef, int>(
+          op_def, "data_format", static_cast<int>(DataFormat::NONE)));
+}
+
+bool IsCpuOp(const OperatorDef &op_def, const std::string &type) {
+  return op_def.type() == type &&
+      static_cast<RuntimeType>(op_def.device_type()) == RuntimeType::RT_CPU;
+}
+
+int64_t OutputBytes(const OperatorDef &op_def, int idx) {
+  if (op_def.output_shape_size() <= idx) {
+    return 0;
+  }
+  DataType dt = op_def.output_type_size() > idx ?
+                op_def.output_type(idx) : OpDataType(op_def);
+  auto &dims = op_def.output_shape(idx).dims();
+  return std::accumulate(dims.begin(), dims.end(),
+                         static_cast<int64_t>(GetEnumTypeSize(dt)),
+                         std::multiplies<int64_t>());
+}
+
+void RemoveOp(int idx, NetDef *net_def) {
+  VLOG(2) << "Remove op " << net_def->op(idx).name() << "<"
+          << net_def->op(idx).type() << ">";
+  net_def->mutable_op()->DeleteSubrange(idx, 1);
+}
+
+void RenameInputs(const std::string &from, const std::string &to,
+                  NetDef *net_def) {
+  for (auto &op_def : *net_def->mutable_op()) {
+    for (int i = 0; i < op_def.input_size(); ++i) {
+      if (op_def.input(i) == from) {
+        op_def.set_input(i, to);
+      }
+    }
+  }
+}
+
+std::vector<int> TransposeDims(const OperatorDef &op_def) {
+  return ProtoArgHelper::GetRepeatedArgs<OperatorDef, int>(op_def, "dims");
+}
+
+void SetTransposeDims(const std::vector<int> &dims, OperatorDef *op_def) {
+  for (auto &arg : *op_def->mutable_arg()) {
+    if (arg.name() == "dims") {
+      arg.clear_ints();
+      for (int dim : dims) {
+        arg.add_ints(dim);
+      }
+    }
+  }
+}
+
+bool IsIdentityPermutation(const std::vector<int> &dims) {
+  for (size_t i = 0; i < dims.size(); ++i) {
+    if (dims[i] != static_cast<int>(i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void CopyArg(const OperatorDef &src, const std::string &name,
+             OperatorDef *dst) {
+  for (auto &arg : src.arg()) {
+    if (arg.name() == name) {
+      dst->add_arg()->CopyFrom(arg);
+    }
+  }
+}
+
+// Unary ops which compute each element on its own, so they give the same
+// result before and after a transpose.
+bool IsLayoutAgnostic(const OperatorDef &op_def) {
+  if (op_def.input_size() != 1 || op_def.output_size() != 1 ||
+      OpDataType(op_def) != DT_FLOAT) {
+    return false;
+  }
+  if (IsCpuOp(op_def, "Activation")) {
+    return ProtoArgHelper::GetOptionalArg<OperatorDef, std::string>(
+        op_def, "activation", "NOOP") != "PRELU";
+  }
+  // Eltwise with a scalar
+  return IsCpuOp(op_def, "Eltwise");
+}
+
+// Whether `name` only flows through layout agnostic ops to a transpose.
+bool ReachesTranspose(const GraphView &view, const NetDef &net_def,
+                      const std::string &name) {
+  int consumer = view.SoleConsumer(name);
+  if (consumer < 0) {
+    return false;
+  }
+  auto &op_def = net_def.op(consumer);
+  if (IsCpuOp(op_def, "Transpose")) {
+    return true;
+  }
+  return IsLayoutAgnostic(op_def) &&
+      ReachesTranspose(view, net_def, op_def.output(0));
+}
+
+MaceStatus FoldConstant(Workspace *ws, NetDef *net_def,
+                        GraphPassReport *report) {
+  static const std::set<std::string> kViewOps = {
+      "Reshape", "Squeeze", "ExpandDims", "Unsqueeze", "Identity"};
+  for (bool changed = true; changed;) {
+    changed = false;
+    GraphView view(net_def);
+    for (int idx = 0; idx < net_def->op_size() && !changed; ++idx) {
+      auto &op_def = net_def->op(idx);
+      if (kViewOps.count(op_def.type()) == 0 ||
+          !IsCpuOp(op_def, op_def.type()) || op_def.input_size() == 0 ||
+          op_def.output_size() != 1 || op_def.output_shape_size() != 1 ||
+          view.IsNetOutput(op_def.output(0))) {
+        continue;
+      }
+      bool weight_inputs = true;
+      for (auto &input : op_def.input()) {
+        const Tensor *tensor = ws->GetTensor(input);
+        weight_inputs = weight_inputs && tensor != nullptr &&
+            tensor->is_weight();
+      }
+      // the data of a weight read by other ops may be dropped once they
+      // prepacked it
+      if (!weight_inputs || view.NumConsumers(op_def.input(0)) != 1) {
+        continue;
+      }
+      const Tensor *weight = ws->GetTensor(op_def.input(0));
+      std::vector<index_t> shape(op_def.output_shape(0).dims().begin(),
+                                 op_def.output_shape(0).dims().end());
+      index_t size = std::accumulate(shape.begin(), shape.end(),
+                                     static_cast<index_t>(1),
+                                     std::multiplies<index_t>());
+      // 4D weights are transposed later for the CPU ops running in NCHW
+      if (weight->dtype() != OpDataType(op_def) ||
+          weight->memory_type() != MemoryType::CPU_BUFFER ||
+          weight->dim_size() == 4 || shape.size() == 4 ||
+          size != weight->size()) {
+        continue;
+      }
+      const std::string &output = op_def.output(0);
+      const Tensor *folded = ws->GetTensor(output);
+      if (folded == nullptr) {
+        auto tensor = make_unique<Tensor>(
+            weight->GetCurRuntime(), weight->dtype(), weight->memory_type(),
+            shape, true, output);
+        tensor->ReuseTensorBuffer(*weight);
+        MACE_RETURN_IF_ERROR(ws->AddTensor(output, std::move(tensor)));
+      } else if (!folded->is_weight() || folded->shape() != shape) {
+        // folded by the engine this one shares the weights of
+        continue;
+      }
+      VLOG(2) << "Fold " << op_def.name() << " into weight " << output;
+      RemoveOp(idx, net_def);
+      ++report->removed_ops;
+      changed = true;
+    }
+  }
+  return MaceStatus::MACE_SUCCESS;
+}
+
+// Whether the output shape of a Reshape does not copy dims of its input.
+bool HasStaticShape(const Workspace *ws, const OperatorDef &op_def) {
+  std::vector<int> dims =
+      ProtoArgHelper::GetRepeatedArgs<OperatorDef, int>(op_def, "dim");
+  if (dims.empty()) {
+    if (op_def.input_size() < 2) {
+      return false;
+    }
+    const Tensor *shape = ws->GetTensor(op_def.input(1));
+    if (shape == nullptr || !shape->is_weight() ||
+        shape->dtype() != DT_INT32 ||
+        shape->memory_type() != MemoryType::CPU_BUFFER) {
+      return false;
+    }
+    const int32_t *shape_data = shape->data<int32_t>();
+    dims.assign(shape_data, shape_data + shape->size());
+  }
+  return std::find(dims.begin(), dims.end(), 0) == dims.end();
+}
+
+void FoldReshape(const Workspace *ws, NetDef *net_def,
+                 GraphPassReport *report) {
+  for (bool changed = true; changed;) {
+    changed = false;
+    GraphView view(net_def);
+    for (int idx = 0; idx < net_def->op_size() && !changed; ++idx) {
+      auto *op_def = net_def->mutable_op(idx);
+      if (!IsCpuOp(*op_def, "Reshape") || op_def->input_size() == 0) {
+        continue;
+      }
+      int producer = view.Producer(op_def->input(0));
+      if (producer < 0 ||
+          !IsCpuOp(net_def->op(producer), "Reshape") ||
+          OpDataType(net_def->op(producer)) != OpDataType(*op_def) ||
+          view.SoleConsumer(op_def->input(0)) != idx ||
+          !HasStaticShape(ws, *op_def)) {
+        continue;
+      }
+      // a reshape is a view, the first one writes nothing
+      op_def->set_input(0, net_def->op(producer).input(0));
+      RemoveOp(producer, net_def);
+      ++report->removed_ops;
+      changed = true;
+    }
+  }
+}
+
+// Merges a transpose into the one reading its output, or removes both when
+// they cancel out.
+bool MergeTranspose(const GraphView &view, int idx, NetDef *net_def,
+                    GraphPassReport *report) {
+  auto *op_def = net_def->mutable_op(idx);
+  const std::string input = op_def->input(0);
+  const std::string output = op_def->output(0);
+  int producer = view.Producer(input);
+  std::vector<int> dims = TransposeDims(*op_def);
+  std::string src;
+  if (producer >= 0 && IsCpuOp(net_def->op(producer), "Transpose") &&
+      OpDataType(net_def->op(producer)) == OpDataType(*op_def) &&
+      view.SoleConsumer(input) == idx) {
+    const std::vector<int> producer_dims =
+        TransposeDims(net_def->op(producer));
+    if (producer_dims.size() != dims.size()) {
+      return false;
+    }
+    // output dim i is dim dims[i] of the input of this op, which is dim
+    // producer_dims[dims[i]] of the input of the producer
+    for (size_t i = 0; i < dims.size(); ++i) {
+      dims[i] = producer_dims[dims[i]];
+    }
+    src = net_def->op(producer).input(0);
+  } else if (IsIdentityPermutation(dims)) {
+    producer = -1;
+    src = input;
+  } else {
+    return false;
+  }
+
+  if (IsIdentityPermutation(dims) && !view.IsNetOutput(output) &&
+      view.Format(src) == view.Format(output)) {
+    report->saved_bytes += OutputBytes(*op_def, 0);
+    RenameInputs(output, src, net_def);
+    RemoveOp(idx, net_def);
+    ++report->removed_ops;
+  } else if (producer < 0) {
+    return false;
+  } else {
+    op_def->set_input(0, src);
+    SetTransposeDims(dims, op_def);
+  }
+  if (producer >= 0) {
+    report->saved_bytes += OutputBytes(net_def->op(producer), 0);
+    RemoveOp(producer, net_def);
+    ++report->removed_ops;
+  }
+  return true;
+}
+
+// Moves a transpose after the layout agnostic op reading its output, on
+// the way to another transpose it will be merged with.
+bool SinkTranspose(const GraphView &view, int idx, NetDef *net_def) {
+  auto &transpose_def = net_def->op(idx);
+  int consumer = view.SoleConsumer(transpose_def.output(0));
+  if (consumer < 0 || !IsLayoutAgnostic(net_def->op(consumer)) ||
+      !ReachesTranspose(view, *net_def, net_def->op(consumer).output(0))) {
+    return false;
+  }
+  VLOG(2) << "Sink " << transpose_def.name() << " past "
+          << net_def->op(consumer).name();
+  OperatorDef transpose(transpose_def);
+  OperatorDef unary(net_def->op(consumer));
+  // the unary op reads the input of the transpose and writes the tensor
+  // the transpose wrote in the layout of its input
+  OperatorDef sunk_unary(unary);
+  sunk_unary.set_input(0, transpose.input(0));
+  sunk_unary.set_output(0, transpose.output(0));
+  sunk_unary.clear_output_shape();
+  if (transpose.output_shape_size() > 0) {
+    const std::vector<int> dims = TransposeDims(transpose);
+    auto &transposed_dims = transpose.output_shape(0).dims();
+    std::vector<int64_t> shape(transposed_dims.size());
+    for (size_t i = 0; i < dims.size() && i < shape.size(); ++i) {
+      shape[dims[i]] = transposed_dims[i];
+    }
+    auto *output_shape = sunk_unary.add_output_shape();
+    for (auto dim : shape) {
+      output_shape->add_dims(dim);
+    }
+  }
+  SetProtoArg<int>(&sunk_unary, "data_format",
+                   static_cast<int>(view.Format(transpose.input(0))));
+  OperatorDef sunk_transpose(transpose);
+  sunk_transpose.set_input(0, transpose.output(0));
+  sunk_transpose.set_output(0, unary.output(0));
+  sunk_transpose.mutable_output_shape()->CopyFrom(unary.output_shape());
+  SetProtoArg<int>(&sunk_transpose, "data_format",
+                   static_cast<int>(OpDataFormat(unary)));
+  // the ops in between read neither of the two tensors
+  net_def->mutable_op(idx)->Swap(&sunk_unary);
+  net_def->mutable_op(consumer)->Swap(&sunk_transpose);
+  return true;
+}
+
+void FoldTranspose(NetDef *net_def, GraphPassReport *report) {
+  for (bool changed = true; changed;) {
+    changed = false;
+    GraphView view(net_def);
+    for (int idx = 0; idx < net_def->op_size() && !changed; ++idx) {
+      if (IsCpuOp(net_def->op(idx), "Transpose")) {
+        changed = MergeTranspose(view, idx, net_def, report);
+      }
+    }
+    for (int idx = 0; idx < net_def->op_size() && !changed; ++idx) {
+      if (IsCpuOp(net_def->op(idx), "Transpose")) {
+        changed = SinkTranspose(view, idx, net_def);
+      }
+    }
+  }
+}
+
+void FoldEltwiseActivation(NetDef *net_def, GraphPassReport *report) {
+  // EltwiseType::EQUAL and NOT_EQUAL, which write int32 tensors
+  static const std::set<int> kLogicalTypes = {10, 15};
+  static const char *kActivationArgs[] = {
+      "activation", "max_limit", "activation_coefficient",
+      "hardsigmoid_alpha", "hardsigmoid_beta"};
+  for (bool changed = true; changed;) {
+    changed = false;
+    GraphView view(net_def);
+    for (int idx = 0; idx < net_def->op_size() && !changed; ++idx) {
+      auto *op_def = net_def->mutable_op(idx);
+      if (!IsCpuOp(*op_def, "Eltwise") || OpDataType(*op_def) != DT_FLOAT ||
+          op_def->output_size() != 1 ||
+          ProtoArgHelper::ExistArg(*op_def, "activation") ||
+          kLogicalTypes.count(ProtoArgHelper::GetOptionalArg<OperatorDef, int>(
+              *op_def, "type", 0)) > 0) {
+        continue;
+      }
+      int consumer = view.SoleConsumer(op_def->output(0));
+      if (consumer < 0) {
+        continue;
+      }
+      auto &activation_def = net_def->op(consumer);
+      const std::string activation =
+          ProtoArgHelper::GetOptionalArg<OperatorDef, std::string>(
+              activation_def, "activation", "NOOP");
+      if (!IsCpuOp(activation_def, "Activation") ||
+          OpDataType(activation_def) != DT_FLOAT ||
+          activation_def.input_size() != 1 || activation == "PRELU" ||
+          activation == "NOOP" ||
+          OpDataFormat(activation_def) != OpDataFormat(*op_def)) {
+        continue;
+      }
+      VLOG(2) << "Fuse " << activation_def.name() << " into "
+              << op_def->name();
+      report->saved_bytes += OutputBytes(*op_def, 0);
+      for (const char *arg : kActivationArgs) {
+        CopyArg(activation_def, arg, op_def);
+      }
+      op_def->set_output(0, activation_def.output(0));
+      if (activation_def.output_shape_size() > 0) {
+        op_def->mutable_output_shape()->CopyFrom(
+            activation_def.output_shape());
+      }
+      RemoveOp(consumer, net_def);
+      ++report->removed_ops;
+      changed = true;
+    }
+  }
+}
+
+}  // namespace
+
 RuntimeType NetOptimizer::SelectBestRuntime(
     const OperatorDef *op_def,
     RuntimeType target_runtime_type,
@@ -47,4 +508,33 @@ RuntimeType NetOptimizer::SelectBestRuntime(
   }
   return RuntimeType::RT_CPU;
 }
+
+MaceStatus NetOptimizer::OptimizeNetDef(
+    Workspace *ws,
+    RuntimeType target_runtime_type,
+    NetDef *net_def,
+    std::vector<GraphPassReport> *reports) {
+  MACE_LATENCY_LOGGER(1, "Optimizing NetDef");
+  std::vector<GraphPassReport> pass_reports = {
+      {"fold_constant", 0, 0}, {"fold_reshape", 0, 0},
+      {"fold_transpose", 0, 0}, {"fold_eltwise_activation", 0, 0}};
+  // the weights of other runtimes may not be mapped to the host yet
+  if (target_runtime_type == RuntimeType::RT_CPU) {
+    MACE_RETURN_IF_ERROR(FoldConstant(ws, net_def, &pass_reports[0]));
+  }
+  FoldReshape(ws, net_def, &pass_reports[1]);
+  FoldTranspose(net_def, &pass_reports[2]);
+  FoldEltwiseActivation(net_def, &pass_reports[3]);
+
+  for (auto &report : pass_reports) {
+    VLOG(1) << "Graph pass " << report.pass << " removed "
+            << report.removed_ops << " ops, saving " << report.saved_bytes
+            << " bytes of intermediate tensors";
+  }
+  if (reports != nullptr) {
+    *reports = std::move(pass_reports);
+  }
+  return MaceStatus::MACE_SUCCESS;
+}
+
 }  // namespace mace
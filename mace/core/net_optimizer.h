@@ -16,6 +16,7 @@
 #define MACE_CORE_NET_OPTIMIZER_H_
 
 #include <set>
+#include <string>
 #include <vector>
 
 #include "mace/core/runtime/runtime.h"
@@ -24,6 +25,17 @@
 
 namespace mace {
 
+class Workspace;
+
+/// What a graph pass did to the net.
+struct GraphPassReport {
+  std::string pass;
+  int removed_ops;
+  /// bytes of the intermediate tensors no longer written by the net,
+  /// estimated from the output shapes of the removed ops
+  int64_t saved_bytes;
+};
+
 /// Any optimization for Net could be put in here in the future.
 class NetOptimizer {
  public:
@@ -43,6 +55,29 @@ class NetOptimizer {
       const OperatorDef *op_def, RuntimeType target_device,
       const std::set<RuntimeType> &available_devices,
       const std::vector<RuntimeType> &inputs_op_devices);
+
+  /// Rewrites the adapted net with the graph passes below, which only touch
+  /// float ops placed on CPU, so models converted by older tools which
+  /// did not fuse them benefit as well:
+  /// 1. fold_constant: views (Reshape, Squeeze...) of weights become weights
+  ///    sharing the buffer of the original one.
+  /// 2. fold_reshape: a Reshape of a Reshape reads the first input directly.
+  /// 3. fold_transpose: sinks transposes past layout agnostic unary ops when
+  ///    they meet another transpose, merges back-to-back transposes and
+  ///    removes the ones which cancel out.
+  /// 4. fold_eltwise_activation: fuses an Activation into the Eltwise
+  ///    producing its input.
+  /// The outputs of the net are always kept.
+  ///
+  /// \param ws workspace holding the weights, folded weights are added to it
+  /// \param target_runtime_type runtime the net runs on
+  /// \param net_def the adapted net, rewritten in place
+  /// \param reports what each pass did, could be nullptr
+  /// \return MACE_SUCCESS, or the error of a failed pass
+  MaceStatus OptimizeNetDef(Workspace *ws,
+                            RuntimeType target_runtime_type,
+                            NetDef *net_def,
+                            std::vector<GraphPassReport> *reports = nullptr);
 };
 
 }  // namespace mace
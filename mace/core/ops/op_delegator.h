@@ -25,10 +25,13 @@ namespace mace {
 enum ImplType {
   REF = 0,
   NEON,
+  X86,
 };
 
-#ifdef MACE_ENABLE_NEON
+#if defined(MACE_ENABLE_NEON)
 const ImplType kCpuImplType = ImplType::NEON;
+#elif defined(MACE_ENABLE_X86)
+const ImplType kCpuImplType = ImplType::X86;
 #else
 const ImplType kCpuImplType = ImplType::REF;
 #endif
@@ -29,6 +29,12 @@ MaceStatus Operation::Init(OpInitContext *context) {
     const Tensor *tensor = ws->GetTensor(input_str);
     MACE_CHECK(tensor != nullptr, "op ", operator_def_->type(),
                ": Encountered a non-existing input tensor: ", input_str);
+    if (tensor->is_state() && !ReadsStates()) {
+      LOG(ERROR) << "op " << operator_def_->type() << ": input " << input_str
+                 << " is a state, whose capacity past its live entries"
+                 << " the op would read";
+      return MaceStatus::MACE_INVALID_ARGS;
+    }
     inputs_.push_back(tensor);
   }
   auto runtime = context->runtime();
@@ -128,6 +134,17 @@ int Operation::ReuseTensorMapId(size_t output_idx) const {
   return -1;
 }
 
+MaceStatus Operation::Prepack(OpContext *context,
+                              std::vector<int> *released_inputs) {
+  MACE_UNUSED(context);
+  MACE_UNUSED(released_inputs);
+  return MaceStatus::MACE_SUCCESS;
+}
+
+bool Operation::ReadsStates() const {
+  return false;
+}
+
 BufferContentType Operation::GetInputTensorContentType(size_t idx) const {
   MACE_UNUSED(idx);
   return BufferContentType::IN_OUT_CHANNEL;
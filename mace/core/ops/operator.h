@@ -90,6 +90,15 @@ class Operation {
   virtual MaceStatus Forward(OpContext *context);
   virtual MaceStatus Run(OpContext *context) = 0;
   virtual int ReuseTensorMapId(size_t output_idx) const;
+  // Converts constant inputs to the layout Run consumes ahead of the first
+  // Run, and appends the indices of the inputs Run no longer reads to
+  // `released_inputs`, so that their data can be dropped.
+  virtual MaceStatus Prepack(OpContext *context,
+                             std::vector<int> *released_inputs);
+  // Whether Run reads only the first Workspace::StateLength() entries of the
+  // states among its inputs. The rest of their capacity holds no entries, so
+  // Init rejects the ops taking a state as input which do not.
+  virtual bool ReadsStates() const;
 
   const OperatorDef &debug_def() const {
     MACE_CHECK(has_debug_def(), "operator_def was null!");
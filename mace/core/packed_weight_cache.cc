@@ -0,0 +1,280 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/core/packed_weight_cache.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "mace/core/memory/external_buffer.h"
+#include "mace/core/runtime/runtime.h"
+#include "mace/port/env.h"
+#include "mace/utils/logging.h"
+#include "mace/utils/math.h"
+#include "mace/utils/memory.h"
+
+namespace mace {
+
+namespace {
+constexpr uint32_t kMagic = 0x4350574d;  // "MWPC"
+constexpr uint32_t kFormatVersion = 1;
+constexpr uint64_t kDataAlignment = 64;
+
+template<typename T>
+void AppendValue(const T value, std::vector<unsigned char> *out) {
+  const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&value);
+  out->insert(out->end(), bytes, bytes + sizeof(T));
+}
+
+template<typename T>
+bool ReadValue(const unsigned char *data, const uint64_t size,
+               uint64_t *pos, T *value) {
+  if (*pos + sizeof(T) > size) {
+    return false;
+  }
+  memcpy(value, data + *pos, sizeof(T));
+  *pos += sizeof(T);
+  return true;
+}
+
+// Unique among the processes and the flushes of this process sharing a
+// cache directory.
+std::string TempFilePath(const std::string &file_path) {
+  static std::atomic<uint32_t> flush_count(0);
+#ifdef _WIN32
+  const int pid = _getpid();
+#else
+  const int pid = static_cast<int>(getpid());
+#endif
+  return MakeString(file_path, ".", pid, ".", flush_count++, ".tmp");
+}
+
+void MapWeight(const void *cached, Tensor *tensor) {
+  void *data = const_cast<void *>(cached);
+  auto buffer = std::make_shared<ExternalBuffer>(
+      MemoryType::CPU_BUFFER, tensor->dtype(), tensor->shape(), data);
+  buffer->SetHost(data);
+  tensor->SwapBuffer(buffer);
+}
+}  // namespace
+
+PackedWeightCache::PackedWeightCache(const std::string &file_path,
+                                     const std::string &isa)
+    : file_path_(file_path), isa_(isa) {}
+
+PackedWeightCache::~PackedWeightCache() = default;
+
+MaceStatus PackedWeightCache::Load() {
+  if (in_memory()) {
+    return MaceStatus::MACE_SUCCESS;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  pending_.clear();
+
+  std::unique_ptr<port::ReadOnlyMemoryRegion> region;
+  if (GetFileSystem()->NewReadOnlyMemoryRegionFromFile(
+      file_path_.c_str(), &region) != MaceStatus::MACE_SUCCESS) {
+    VLOG(1) << "No packed weight cache at " << file_path_;
+    return MaceStatus::MACE_SUCCESS;
+  }
+
+  const unsigned char *data =
+      static_cast<const unsigned char *>(region->data());
+  const uint64_t size = region->length();
+  std::map<std::string, std::pair<const void *, index_t>> entries;
+  uint64_t pos = 0;
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  uint32_t isa_size = 0;
+  uint32_t count = 0;
+  bool valid = ReadValue(data, size, &pos, &magic) && magic == kMagic &&
+      ReadValue(data, size, &pos, &version) && version == kFormatVersion &&
+      ReadValue(data, size, &pos, &isa_size) && isa_size == isa_.size() &&
+      pos + isa_size <= size &&
+      memcmp(data + pos, isa_.data(), isa_size) == 0;
+  if (valid) {
+    pos += isa_size;
+    valid = ReadValue(data, size, &pos, &count);
+  }
+  for (uint32_t i = 0; valid && i < count; ++i) {
+    uint32_t key_size = 0;
+    uint64_t offset = 0;
+    uint64_t bytes = 0;
+    valid = ReadValue(data, size, &pos, &key_size) && pos + key_size <= size;
+    if (!valid) break;
+    std::string key(reinterpret_cast<const char *>(data + pos), key_size);
+    pos += key_size;
+    valid = ReadValue(data, size, &pos, &offset) &&
+        ReadValue(data, size, &pos, &bytes) &&
+        offset % kDataAlignment == 0 && offset <= size &&
+        bytes <= size - offset;
+    if (valid) {
+      entries[key] = std::make_pair(data + offset,
+                                    static_cast<index_t>(bytes));
+    }
+  }
+  valid = valid && pos + CRC32SIZE <= size &&
+      CheckArrayCRC32(data, pos + CRC32SIZE);
+  if (!valid) {
+    LOG(WARNING) << "Invalid packed weight cache " << file_path_
+                 << ", it will be rebuilt";
+    return MaceStatus::MACE_SUCCESS;
+  }
+
+  VLOG(1) << "Load " << entries.size() << " packed weights from "
+          << file_path_;
+  // earlier mappings stay alive, tensors may still point into them
+  regions_.push_back(std::move(region));
+  entries_ = std::move(entries);
+  return MaceStatus::MACE_SUCCESS;
+}
+
+const void *PackedWeightCache::Find(const std::string &key,
+                                    const index_t size) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto iter = entries_.find(key);
+  if (iter == entries_.end() || iter->second.second != size) {
+    return nullptr;
+  }
+  return iter->second.first;
+}
+
+const void *PackedWeightCache::Insert(const std::string &key,
+                                     const void *data, const index_t size) {
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  return Insert(key, std::vector<unsigned char>(bytes, bytes + size));
+}
+
+const void *PackedWeightCache::Insert(const std::string &key,
+                                     std::vector<unsigned char> &&data) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<unsigned char> &blob = pending_[key];
+  blob = std::move(data);
+  entries_[key] = std::make_pair(blob.data(),
+                                 static_cast<index_t>(blob.size()));
+  return blob.data();
+}
+
+MaceStatus PackedWeightCache::Flush() {
+  if (in_memory() || pending_.empty()) {
+    return MaceStatus::MACE_SUCCESS;
+  }
+
+  uint64_t header_size = 4 * sizeof(uint32_t) + isa_.size() + CRC32SIZE;
+  for (auto &entry : entries_) {
+    header_size += sizeof(uint32_t) + entry.first.size() + 2 * sizeof(uint64_t);
+  }
+  std::vector<unsigned char> header;
+  header.reserve(header_size);
+  AppendValue(kMagic, &header);
+  AppendValue(kFormatVersion, &header);
+  AppendValue(static_cast<uint32_t>(isa_.size()), &header);
+  header.insert(header.end(), isa_.begin(), isa_.end());
+  AppendValue(static_cast<uint32_t>(entries_.size()), &header);
+  uint64_t offset = RoundUp<uint64_t>(header_size, kDataAlignment);
+  for (auto &entry : entries_) {
+    AppendValue(static_cast<uint32_t>(entry.first.size()), &header);
+    header.insert(header.end(), entry.first.begin(), entry.first.end());
+    AppendValue(offset, &header);
+    AppendValue(static_cast<uint64_t>(entry.second.second), &header);
+    offset = RoundUp<uint64_t>(offset + entry.second.second, kDataAlignment);
+  }
+  AppendValue(CalculateCRC32(header.data(), header.size()), &header);
+
+  // Readers may have the file mapped and other processes may be writing it,
+  // write a file of our own and rename it over.
+  const std::string tmp_path = TempFilePath(file_path_);
+  std::unique_ptr<port::WritableFile> file;
+  MACE_RETURN_IF_ERROR(GetFileSystem()->NewWritableFile(tmp_path.c_str(),
+                                                         &file));
+  const std::vector<char> padding(kDataAlignment, 0);
+  uint64_t written = header.size();
+  MaceStatus status = file->Append(
+      reinterpret_cast<const char *>(header.data()), header.size());
+  for (auto iter = entries_.begin();
+       status == MaceStatus::MACE_SUCCESS && iter != entries_.end(); ++iter) {
+    const uint64_t pad = RoundUp(written, kDataAlignment) - written;
+    status = file->Append(padding.data(), pad);
+    if (status == MaceStatus::MACE_SUCCESS) {
+      status = file->Append(static_cast<const char *>(iter->second.first),
+                            iter->second.second);
+    }
+    written += pad + iter->second.second;
+  }
+  const MaceStatus close_status = file->Close();
+  if (status != MaceStatus::MACE_SUCCESS ||
+      close_status != MaceStatus::MACE_SUCCESS ||
+      std::rename(tmp_path.c_str(), file_path_.c_str()) != 0) {
+    LOG(WARNING) << "Failed to write packed weight cache " << file_path_;
+    std::remove(tmp_path.c_str());
+    return MaceStatus::MACE_RUNTIME_ERROR;
+  }
+
+  VLOG(1) << "Write " << entries_.size() << " packed weights to "
+          << file_path_;
+  // map the new file to release the copies of the inserted entries
+  return Load();
+}
+
+std::string PackedWeightCacheFilePath(const std::string &dir,
+                                      const unsigned char *model_data,
+                                      const int64_t model_data_size,
+                                      const char *isa) {
+  const uint32_t crc = model_data == nullptr || model_data_size <= 0 ? 0 :
+      CalculateCRC32(model_data, static_cast<uint64_t>(model_data_size));
+  return MakeString(dir, "/mace_packed_weights_", crc, "_", isa,
+                    "_v", kFormatVersion, ".bin");
+}
+
+std::unique_ptr<Tensor> LoadOrPackWeight(
+    PackedWeightCache *cache, Runtime *runtime, const std::string &key,
+    const DataType dt, const std::vector<index_t> &shape,
+    const std::function<void(void *packed)> &pack) {
+  auto tensor = make_unique<Tensor>(runtime, dt, MemoryType::CPU_BUFFER,
+                                    shape);
+  const index_t bytes = tensor->raw_size();
+  const void *cached =
+      cache == nullptr ? nullptr : cache->Find(key, bytes);
+  if (cached != nullptr) {
+    VLOG(2) << "Map packed weight " << key;
+    MapWeight(cached, tensor.get());
+    return tensor;
+  }
+
+  if (cache != nullptr && cache->in_memory()) {
+    std::vector<unsigned char> packed(bytes);
+    pack(packed.data());
+    MapWeight(cache->Insert(key, std::move(packed)), tensor.get());
+    return tensor;
+  }
+
+  runtime->AllocateBufferForTensor(tensor.get(), RENT_PRIVATE);
+  pack(tensor->raw_mutable_data());
+  if (cache != nullptr) {
+    // the entries of a file cache move when it is flushed, the weight keeps
+    // its own buffer
+    cache->Insert(key, tensor->raw_data(), bytes);
+  }
+  return tensor;
+}
+
+}  // namespace mace
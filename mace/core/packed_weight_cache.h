@@ -0,0 +1,106 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_CORE_PACKED_WEIGHT_CACHE_H_
+#define MACE_CORE_PACKED_WEIGHT_CACHE_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mace/core/tensor.h"
+#include "mace/port/file_system.h"
+#include "mace/public/mace.h"
+
+namespace mace {
+
+class Runtime;
+
+// Weights converted to the layout of their CPU kernels, persisted in one file
+// per model and instruction set so later processes map them instead of
+// converting them again.
+//
+// File layout (native endianness, the file is not portable across hosts):
+//   uint32 magic, uint32 format version, uint32 ISA size, ISA name,
+//   uint32 entry count,
+//   per entry: uint32 key size, key, uint64 offset, uint64 size,
+//   uint32 CRC32 of all the above,
+//   the entry data, each at a 64-byte aligned offset.
+// Only the header is checksummed so that loading does not touch the data.
+// A file of another format version or ISA is dropped and rebuilt; bump
+// kFormatVersion whenever a kernel changes the layout it packs weights to
+// without changing its keys.
+//
+// With an empty file path the cache only lives in memory, its entries are
+// then the storage of the packed weights, shared by the replicas of a net.
+//
+// Find and Insert are thread-safe, Load and Flush are only called by the
+// flow owning the cache while it is initialized.
+class PackedWeightCache {
+ public:
+  // `isa` names the instruction set the weights are packed for.
+  PackedWeightCache(const std::string &file_path, const std::string &isa);
+  ~PackedWeightCache();
+
+  // A missing file is not an error, the cache starts empty.
+  MaceStatus Load();
+  // Returns nullptr unless `key` holds exactly `size` bytes.
+  const void *Find(const std::string &key, index_t size) const;
+  // Returns the copy of `data` kept by the cache.
+  const void *Insert(const std::string &key, const void *data, index_t size);
+  // Takes `data` as the entry of `key`, returns where the cache keeps it.
+  const void *Insert(const std::string &key,
+                     std::vector<unsigned char> &&data);
+  // Rewrites the file if entries were inserted since the last Load/Flush.
+  MaceStatus Flush();
+
+  bool in_memory() const { return file_path_.empty(); }
+
+  size_t size() const { return entries_.size(); }
+  const std::string &file_path() const { return file_path_; }
+
+ private:
+  std::string file_path_;
+  std::string isa_;
+  std::vector<std::unique_ptr<port::ReadOnlyMemoryRegion>> regions_;
+  // key => (data, size), pointing into the last region or pending_
+  std::map<std::string, std::pair<const void *, index_t>> entries_;
+  std::map<std::string, std::vector<unsigned char>> pending_;
+  mutable std::mutex mutex_;
+
+  MACE_DISABLE_COPY_AND_ASSIGN(PackedWeightCache);
+};
+
+// "<dir>/mace_packed_weights_<model crc32>_<isa>_v<format version>.bin"
+std::string PackedWeightCacheFilePath(const std::string &dir,
+                                      const unsigned char *model_data,
+                                      const int64_t model_data_size,
+                                      const char *isa);
+
+// Returns a CPU tensor of `shape` holding a packed weight: the bytes cached
+// under `key` when `cache` has them, otherwise a new buffer filled by `pack`,
+// which is then added to `cache`. `cache` may be nullptr. Weights are packed
+// straight into the entries of an in-memory cache, which are their storage.
+std::unique_ptr<Tensor> LoadOrPackWeight(
+    PackedWeightCache *cache, Runtime *runtime, const std::string &key,
+    const DataType dt, const std::vector<index_t> &shape,
+    const std::function<void(void *packed)> &pack);
+
+}  // namespace mace
+
+#endif  // MACE_CORE_PACKED_WEIGHT_CACHE_H_
@@ -125,6 +125,31 @@ inline void GetOutputMultiplierAndShift(
   MACE_CHECK(*right_shift >= 0);
 }
 
+// Computes round(value * multiplier * 2^(exponent - 31)) in fixed point, with
+// multiplier and exponent from QuantizeMultiplier. It matches gemmlowp's
+// SaturatingRoundingDoublingHighMul followed by RoundingDivideByPOT, and
+// also accepts the positive exponents of real multipliers greater than one.
+inline int32_t MultiplyByQuantizedMultiplier(const int32_t value,
+                                             const int32_t multiplier,
+                                             const int32_t exponent) {
+  const int left_shift = exponent > 0 ? std::min(exponent, 31) : 0;
+  const int right_shift = exponent > 0 ? 0 : std::min(-exponent, 31);
+  const int64_t shifted = static_cast<int64_t>(value) * (1ll << left_shift);
+  const int64_t product = std::max<int64_t>(
+      std::numeric_limits<int32_t>::min(),
+      std::min<int64_t>(std::numeric_limits<int32_t>::max(), shifted)) *
+      multiplier;
+  const int64_t nudge = product >= 0 ? (1ll << 30) : (1 - (1ll << 30));
+  const int64_t high = (product + nudge) / (1ll << 31);
+  const int32_t high32 = static_cast<int32_t>(std::max<int64_t>(
+      std::numeric_limits<int32_t>::min(),
+      std::min<int64_t>(std::numeric_limits<int32_t>::max(), high)));
+  const int32_t mask = static_cast<int32_t>((1ll << right_shift) - 1);
+  const int32_t remainder = high32 & mask;
+  const int32_t threshold = (mask >> 1) + (high32 < 0 ? 1 : 0);
+  return (high32 >> right_shift) + (remainder > threshold ? 1 : 0);
+}
+
 template<typename F, typename Q>
 class QuantizeUtil {
  public:
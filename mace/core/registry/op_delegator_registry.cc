@@ -17,6 +17,7 @@
 #include <utility>
 #include <sstream>
 
+#include "mace/utils/cpu_isa.h"
 #include "mace/utils/logging.h"
 
 namespace mace {
@@ -49,11 +50,22 @@ bool DelegatorInfo::operator==(const DelegatorInfo &info) const {
       delegator_name == info.delegator_name && tag == info.tag;
 }
 
+OpDelegatorRegistry::OpDelegatorRegistry()
+    : cpu_isa_(utils::ResolveCPUIsa(CPUIsa::CPU_ISA_AUTO)) {}
+
 MaceStatus OpDelegatorRegistry::Register(const DelegatorInfo &key,
                                          DelegatorCreator creator) {
-  MACE_CHECK(registry_.count(key) == 0,
-             "Register an exist key: ", key.ToString());
-  registry_[key] = std::move(creator);
+  return Register(key, std::move(creator), CPUIsa::CPU_ISA_NONE);
+}
+
+MaceStatus OpDelegatorRegistry::Register(const DelegatorInfo &key,
+                                         DelegatorCreator creator,
+                                         CPUIsa isa) {
+  IsaCreators &creators = registry_[key];
+  MACE_CHECK(creators.count(isa) == 0,
+             "Register an exist key: ", key.ToString(),
+             ", isa: ", utils::CPUIsaToString(isa));
+  creators[isa] = std::move(creator);
   return MaceStatus::MACE_SUCCESS;
 }
 
@@ -61,40 +73,68 @@ OpDelegatorRegistry::~OpDelegatorRegistry() {
   VLOG(2) << "Destroy OpDelegatorRegistry";
 }
 
+void OpDelegatorRegistry::SetCPUIsa(CPUIsa isa) {
+  MACE_CHECK(isa != CPUIsa::CPU_ISA_AUTO, "CPU ISA should be resolved");
+  cpu_isa_ = isa;
+}
+
+CPUIsa OpDelegatorRegistry::cpu_isa() const {
+  return cpu_isa_;
+}
+
+const DelegatorCreator *OpDelegatorRegistry::Find(
+    const DelegatorInfo &key) const {
+  auto iter = registry_.find(key);
+  if (iter == registry_.end()) {
+    return nullptr;
+  }
+  const IsaCreators &creators = iter->second;
+  auto creator = creators.upper_bound(cpu_isa_);
+  if (creator == creators.begin()) {
+    return nullptr;
+  }
+  --creator;
+  return &creator->second;
+}
+
 DelegatorCreator OpDelegatorRegistry::GetCreator(
     const DelegatorInfo &key) const {
-  if (registry_.count(key) > 0) {
+  const DelegatorCreator *creator = Find(key);
+  if (creator != nullptr) {
     VLOG(3) << "find delegator creator: " << key.ToString();
-    return registry_.at(key);
+    return *creator;
   }
 
   DelegatorInfo info = key;
-  if (key.impl_type == ImplType::NEON) {
+  if (key.impl_type != ImplType::REF) {
     if (info.tag != kDefaultTag) {
       info.tag = kDefaultTag;
-      if (registry_.count(info) > 0) {
+      creator = Find(info);
+      if (creator != nullptr) {
         VLOG(1) << key.ToString()
                 << " delegator fall back to " << info.ToString();
-        return registry_.at(info);
+        return *creator;
       }
       info.tag = key.tag;
     }
 
     info.impl_type = ImplType::REF;
-    if (registry_.count(info) > 0) {
+    creator = Find(info);
+    if (creator != nullptr) {
       VLOG(1) << key.ToString()
               << " delegator fall back to " << info.ToString();
-      return registry_.at(info);
+      return *creator;
     }
   }
 
   // for REF
   if (info.tag != kDefaultTag) {
     info.tag = kDefaultTag;
-    if (registry_.count(info) > 0) {
+    creator = Find(info);
+    if (creator != nullptr) {
       VLOG(1) << key.ToString()
               << " delegator fall back to " << info.ToString();
-      return registry_.at(info);
+      return *creator;
     }
   }
 
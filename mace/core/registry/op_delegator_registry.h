@@ -16,6 +16,7 @@
 #define MACE_CORE_REGISTRY_OP_DELEGATOR_REGISTRY_H_
 
 #include <functional>
+#include <map>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -57,19 +58,32 @@ struct DelegatorInfo {
 
 class OpDelegatorRegistry {
  public:
-  OpDelegatorRegistry() = default;
+  OpDelegatorRegistry();
   ~OpDelegatorRegistry();
 
   MaceStatus Register(const DelegatorInfo &key, DelegatorCreator creator);
+  // Register an implementation which needs the `isa` instruction set. One
+  // key may have several implementations, GetCreator picks the one with
+  // the highest ISA not above the current CPU ISA.
+  MaceStatus Register(const DelegatorInfo &key, DelegatorCreator creator,
+                      CPUIsa isa);
   DelegatorCreator GetCreator(const DelegatorInfo &key) const;
 
+  void SetCPUIsa(CPUIsa isa);
+  CPUIsa cpu_isa() const;
+
  private:
+  typedef std::map<CPUIsa, DelegatorCreator> IsaCreators;
+
+  const DelegatorCreator *Find(const DelegatorInfo &key) const;
+
   struct HashName {
     size_t operator()(const DelegatorInfo &delegator_info) const {
       return std::hash<std::string>()(delegator_info.ToString());
     }
   };
-  std::unordered_map<DelegatorInfo, DelegatorCreator, HashName> registry_;
+  std::unordered_map<DelegatorInfo, IsaCreators, HashName> registry_;
+  CPUIsa cpu_isa_;
 };
 
 }  // namespace mace
@@ -94,6 +108,13 @@ class OpDelegatorRegistry {
   registry->Register(key, OpDelegator::DefaultCreator<class_name, param_name>)
 #endif  // MACE_REGISTER_DELEGATOR
 
+#ifndef MACE_REGISTER_ISA_DELEGATOR
+#define MACE_REGISTER_ISA_DELEGATOR(registry, class_name, param_name, \
+                                    key, isa)                         \
+  registry->Register(                                                 \
+      key, OpDelegator::DefaultCreator<class_name, param_name>, isa)
+#endif  // MACE_REGISTER_ISA_DELEGATOR
+
 #ifndef MACE_REGISTER_BF16_DELEGATOR
 #ifdef MACE_ENABLE_BFLOAT16
 #define MACE_REGISTER_BF16_DELEGATOR(registry, class_name, param_name, key) \
@@ -56,6 +56,12 @@ MaceStatus Runtime::AfterRun() {
   return MaceStatus::MACE_SUCCESS;
 }
 
+std::unique_ptr<Runtime> Runtime::CreateConcurrentRuntime(
+    RuntimeContext *runtime_context) {
+  MACE_UNUSED(runtime_context);
+  return nullptr;
+}
+
 MaceStatus Runtime::MapBuffer(Buffer *buffer, bool wait_for_finish) {
   MACE_UNUSED(wait_for_finish);
   buffer->SetHost(buffer->mutable_memory<uint8_t>() + buffer->offset());
@@ -68,9 +74,16 @@ bool Runtime::CanReuseBuffer(
     const BufferContentType content_type, const unsigned int content_param) {
   MACE_UNUSED(content_type);
   MACE_UNUSED(content_param);
-  auto size_bytes = std::accumulate(shape.begin(), shape.end(),
-                                    1, std::multiplies<index_t>());
+  const auto type_size =
+      static_cast<index_t>(GetEnumTypeSize(buffer->data_type));
+  const index_t size_bytes = std::accumulate(shape.begin(), shape.end(),
+                                             type_size,
+                                             std::multiplies<index_t>());
+  if (buffer->external_bytes() > 0) {
+    return size_bytes <= buffer->external_bytes();
+  }
   MemoryManager *memory_manager = GetMemoryManager(buffer->mem_type);
+  // the real size of a block is in bytes
   auto real_shape = memory_manager->GetMemoryRealSize(buffer->memory<void>());
   MACE_CHECK(real_shape.size() == 1, "Only support dim 1");
   return (size_bytes <= real_shape[0]);
@@ -86,6 +86,12 @@ class Runtime {
 
   virtual MemoryManager *GetMemoryManager(const MemoryType mem_type) = 0;
 
+  // Create a runtime of the same device with its own thread pool and
+  // scratch memory, so that ops can run concurrently with this runtime.
+  // Return nullptr if the device does not support it.
+  virtual std::unique_ptr<Runtime> CreateConcurrentRuntime(
+      RuntimeContext *runtime_context);
+
   void SetBufferToTensor(std::unique_ptr<Buffer> buffer, Tensor *tensor);
 
   // for inter buffers' release and re-allocate
@@ -15,6 +15,8 @@
 
 #include "mace/core/tensor.h"
 
+#include "mace/utils/tracer.h"
+
 namespace mace {
 
 namespace numerical_chars {
@@ -189,6 +191,12 @@ void Tensor::ReuseTensorBuffer(const Tensor &other) {
   buffer_ = other.buffer_;
 }
 
+std::shared_ptr<Buffer> Tensor::SwapBuffer(std::shared_ptr<Buffer> buffer) {
+  MACE_CHECK_NOTNULL(buffer);
+  buffer_.swap(buffer);
+  return buffer;
+}
+
 MaceStatus Tensor::ResizeLike(const Tensor &other) {
   return ResizeLike(&other);
 }
@@ -239,10 +247,12 @@ void Tensor::DebugPrint() const {
 }
 
 void Tensor::Map(bool wait_for_finish) const {
+  utils::TraceSpan trace_span("memory", "Map", "tensor", name_.c_str());
   runtime_->MapBuffer(buffer_.get(), wait_for_finish);
 }
 
 void Tensor::UnMap() const {
+  utils::TraceSpan trace_span("memory", "UnMap", "tensor", name_.c_str());
   runtime_->UnMapBuffer(buffer_.get());
 }
 
@@ -269,6 +279,10 @@ bool Tensor::is_weight() const {
   return is_weight_;
 }
 
+bool Tensor::is_state() const {
+  return is_state_;
+}
+
 float Tensor::scale() const {
   return scale_;
 }
@@ -286,6 +300,10 @@ float Tensor::maxval() const {
   return maxval_;
 }
 
+const std::vector<float> &Tensor::scales() const {
+  return scales_;
+}
+
 void Tensor::SetScale(float scale) {
   scale_ = scale;
 }
@@ -294,10 +312,18 @@ void Tensor::SetZeroPoint(int32_t zero_point) {
   zero_point_ = zero_point;
 }
 
+void Tensor::SetScales(const std::vector<float> &scales) {
+  scales_ = scales;
+}
+
 void Tensor::SetIsWeight(bool is_weight) {
   is_weight_ = is_weight;
 }
 
+void Tensor::SetIsState(bool is_state) {
+  is_state_ = is_state;
+}
+
 void Tensor::SetMinVal(float minval) {
   minval_ = minval;
 }
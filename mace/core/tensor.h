@@ -113,6 +113,7 @@ class Tensor {
         unused_(false),
         name_(name),
         is_weight_(is_weight),
+        is_state_(false),
         scale_(0.f),
         zero_point_(0),
         minval_(0.f),
@@ -132,6 +133,7 @@ class Tensor {
         unused_(false),
         name_(name),
         is_weight_(is_weight),
+        is_state_(false),
         scale_(0.f),
         zero_point_(0),
         minval_(0.f),
@@ -203,6 +205,9 @@ class Tensor {
   // This tensor has the same dtype, shape and buffer shape.
   // It could be reshaped later (with buffer shape unchanged).
   void ReuseTensorBuffer(const Tensor &other);
+  // Replace the buffer and return the previous one, used to bind the
+  // caller's memory to the tensor for a run.
+  std::shared_ptr<Buffer> SwapBuffer(std::shared_ptr<Buffer> buffer);
   MaceStatus ResizeLike(const Tensor &other);
   MaceStatus ResizeLike(const Tensor *other);
   void CopyBytes(const void *src, size_t bytes);
@@ -232,15 +237,23 @@ class Tensor {
   };
 
   bool is_weight() const;
+  // a state tensor keeps its content between the runs of a net, e.g. the
+  // KV cache of a decoder, so it is never planned into the shared buffers
+  bool is_state() const;
   float scale() const;
   int32_t zero_point() const;
 
   // hexagon now uses min/max instead of scale and zero
   float minval() const;
   float maxval() const;
+  // per output channel scales of symmetric int8 weights, empty if the tensor
+  // is quantized per tensor
+  const std::vector<float> &scales() const;
   void SetScale(float scale);
   void SetZeroPoint(int32_t zero_point);
+  void SetScales(const std::vector<float> &scales);
   void SetIsWeight(bool is_weight);
+  void SetIsState(bool is_state);
   void SetMinVal(float minval);
   void SetMaxVal(float maxval);
 
@@ -252,10 +265,12 @@ class Tensor {
   bool unused_;
   std::string name_;
   bool is_weight_;
+  bool is_state_;
   float scale_;
   int32_t zero_point_;
   float minval_;
   float maxval_;
+  std::vector<float> scales_;
   DataFormat data_format_;  // used for 4D input/output tensor
   BufferContentType content_type_;
   unsigned int content_param_;  // TODO(luxuhui): remove it
@@ -24,6 +24,7 @@ bool DataTypeCanUseMemcpy(DataType dt) {
   switch (dt) {
     case DT_FLOAT:
     case DT_UINT8:
+    case DT_INT8:
     case DT_INT32:
     case DT_BFLOAT16:
     case DT_FLOAT16:
@@ -38,6 +39,7 @@ std::string DataTypeToString(const DataType dt) {
       {DT_FLOAT, "DT_FLOAT"},
       {DT_HALF, "DT_HALF"},
       {DT_UINT8, "DT_UINT8"},
+      {DT_INT8, "DT_INT8"},
       {DT_INT32, "DT_INT32"},
       {DT_BFLOAT16, "DT_BFLOAT16"},
       {DT_FLOAT16, "DT_FLOAT16"}};
@@ -62,6 +64,8 @@ size_t GetEnumTypeSize(const DataType dt) {
 #endif
     case DT_UINT8:
       return sizeof(uint8_t);
+    case DT_INT8:
+      return sizeof(int8_t);
     case DT_UINT16:
       return sizeof(uint16_t);
     case DT_INT32:
@@ -68,6 +68,7 @@ MACE_MAPPING_DATA_TYPE_AND_ENUM(int16_t, DT_INT16);
 #endif  // MACE_ENABLE_MTK_APU
 MACE_MAPPING_DATA_TYPE_AND_ENUM(float, DT_FLOAT);
 MACE_MAPPING_DATA_TYPE_AND_ENUM(uint8_t, DT_UINT8);
+MACE_MAPPING_DATA_TYPE_AND_ENUM(int8_t, DT_INT8);
 MACE_MAPPING_DATA_TYPE_AND_ENUM(uint16_t, DT_UINT16);
 MACE_MAPPING_DATA_TYPE_AND_ENUM(int32_t, DT_INT32);
 MACE_MAPPING_DATA_TYPE_AND_ENUM(uint32_t, DT_UINT32);
@@ -14,6 +14,9 @@
 
 #include "mace/core/workspace.h"
 
+#include <cstring>
+#include <functional>
+#include <numeric>
 #include <unordered_set>
 #include <utility>
 
@@ -45,6 +48,7 @@ void DequantizeTensor(Runtime *runtime,
 }  // namespace
 
 Workspace::Workspace(const OpDelegatorRegistry *registry, BaseFlow *flow) :
+    diffused_buffer_(false),
     op_delegator_registry_(registry),
     parent_flow_(flow) {}
 
@@ -139,6 +143,8 @@ MaceStatus Workspace::LoadModelTensor(const NetDef &net_def, Runtime *runtime,
       auto tensor = make_unique<Tensor>(
           runtime, dst_data_type, dims, true, const_tensor.name());
       runtime->AllocateBufferForTensor(tensor.get(), BufRentType::RENT_PRIVATE);
+      tensor->SetScales({const_tensor.scales().begin(),
+                         const_tensor.scales().end()});
 
       const index_t tensor_end = const_tensor.offset() +
           tensor->size() * GetEnumTypeSize(const_tensor.data_type());
@@ -191,6 +197,8 @@ MaceStatus Workspace::LoadModelTensor(const NetDef &net_def, Runtime *runtime,
           runtime, const_tensor.data_type(), dims, true, const_tensor.name());
       tensor->SetScale(const_tensor.scale());
       tensor->SetZeroPoint(const_tensor.zero_point());
+      tensor->SetScales({const_tensor.scales().begin(),
+                         const_tensor.scales().end()});
       MACE_CHECK_SUCCESS(runtime->AllocateBufferForTensor(
           tensor.get(), RENT_SLICE, slice_parent.get(), const_tensor.offset()));
 
@@ -201,6 +209,35 @@ MaceStatus Workspace::LoadModelTensor(const NetDef &net_def, Runtime *runtime,
   return MaceStatus::MACE_SUCCESS;
 }
 
+MaceStatus Workspace::ShareModelTensors(const Workspace &source) {
+  for (auto &entry : source.tensor_map_) {
+    const Tensor *weight = entry.second.get();
+    if (!weight->is_weight() || HasTensor(entry.first)) {
+      continue;
+    }
+    VLOG(3) << "Share tensor " << entry.first;
+    auto tensor = make_unique<Tensor>(
+        weight->GetCurRuntime(), weight->dtype(), weight->memory_type(),
+        weight->shape(), true, weight->name());
+    tensor->ReuseTensorBuffer(*weight);
+    tensor->SetScale(weight->scale());
+    tensor->SetZeroPoint(weight->zero_point());
+    tensor->SetScales(weight->scales());
+    tensor->SetMinVal(weight->minval());
+    tensor->SetMaxVal(weight->maxval());
+    tensor->set_data_format(weight->data_format());
+    BufferContentType content_type;
+    unsigned int content_param = 0;
+    weight->GetContentType(&content_type, &content_param);
+    tensor->SetContentType(content_type, content_param);
+    tensor_map_.emplace(entry.first, std::move(tensor));
+  }
+  diffused_buffer_ = source.diffused_buffer_;
+  packed_weight_cache_ = source.packed_weight_cache_;
+
+  return MaceStatus::MACE_SUCCESS;
+}
+
 MaceStatus Workspace::AddQuantizeInfoForOutputTensor(
     const mace::NetDef &net_def, Runtime *runtime) {
   // add quantize info for output tensors.
@@ -304,4 +341,190 @@ const OpDelegatorRegistry *Workspace::GetDelegatorRegistry() const {
   return op_delegator_registry_;
 }
 
+Tensor *Workspace::CreateState(const std::string &name, Runtime *runtime,
+                               DataType type, int axis, index_t capacity) {
+  MACE_CHECK(capacity > 0, "The capacity of state ", name,
+             " should be positive");
+  auto iter = states_.find(name);
+  if (iter != states_.end()) {
+    MACE_CHECK(iter->second.axis == axis &&
+                   iter->second.capacity == capacity,
+               "State ", name, " is declared twice differently");
+    if (HasTensor(name) && GetTensor(name)->is_state()) {
+      return GetTensor(name);
+    }
+    // the tensor of the state was removed or replaced, start it again
+    RemoveTensor(name);
+  }
+  Tensor *state = CreateTensor(name, runtime, type, false,
+                               MemoryType::CPU_BUFFER);
+  MACE_CHECK(!state->is_weight() && state->dtype() == type &&
+                 state->memory_type() == MemoryType::CPU_BUFFER,
+             "Tensor ", name, " already exists and can not be a state");
+  state->SetIsState(true);
+  states_[name] = {axis, capacity, 0};
+  return state;
+}
+
+MaceStatus Workspace::ReserveState(const std::string &name,
+                                   const std::vector<index_t> &shape,
+                                   int axis) {
+  const index_t rank = static_cast<index_t>(shape.size());
+  StateInfo &info = states_.at(name);
+  Tensor *state = GetTensor(name);
+  if (state->dim_size() == rank) {
+    bool same_entries = true;
+    for (index_t i = 0; i < rank; ++i) {
+      same_entries &= (i == axis || state->dim(i) == shape[i]);
+    }
+    if (same_entries) {
+      return MaceStatus::MACE_SUCCESS;
+    }
+  }
+  if (info.length > 0) {
+    std::vector<index_t> live_shape(state->shape());
+    live_shape[axis] = info.length;
+    LOG(ERROR) << "State " << name << " holds entries of shape "
+               << MakeString(live_shape) << ", can not append "
+               << MakeString(shape) << " to it";
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+
+  std::vector<index_t> state_shape(shape);
+  state_shape[axis] = info.capacity;
+  MACE_RETURN_IF_ERROR(state->Resize(state_shape));
+  state->Clear();
+  return MaceStatus::MACE_SUCCESS;
+}
+
+int Workspace::StateAxis(const std::string &name, index_t rank) const {
+  auto iter = states_.find(name);
+  if (iter == states_.end()) {
+    return -1;
+  }
+  const int axis = iter->second.axis < 0 ?
+                   iter->second.axis + static_cast<int>(rank) :
+                   iter->second.axis;
+  return (axis >= 0 && axis < rank) ? axis : -1;
+}
+
+index_t Workspace::StateCapacity(const std::string &name) const {
+  auto iter = states_.find(name);
+  return iter == states_.end() ? 0 : iter->second.capacity;
+}
+
+index_t Workspace::StateLength(const std::string &name) const {
+  auto iter = states_.find(name);
+  return iter == states_.end() ? 0 : iter->second.length;
+}
+
+std::vector<std::string> Workspace::States() const {
+  std::vector<std::string> names;
+  for (auto &state : states_) {
+    names.push_back(state.first);
+  }
+  return names;
+}
+
+MaceStatus Workspace::AppendState(const std::string &name,
+                                  const std::vector<index_t> &shape,
+                                  const void *data) {
+  const index_t rank = static_cast<index_t>(shape.size());
+  const int axis = StateAxis(name, rank);
+  if (axis < 0) {
+    LOG(ERROR) << "Tensor " << name << " is not a state of rank " << rank;
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  MACE_RETURN_IF_ERROR(ReserveState(name, shape, axis));
+  StateInfo &info = states_.at(name);
+  if (info.length + shape[axis] > info.capacity) {
+    LOG(ERROR) << "State " << name << " holds " << info.length
+               << " entries, can not append " << shape[axis]
+               << " more to its capacity " << info.capacity;
+    return MaceStatus::MACE_OUT_OF_RESOURCES;
+  }
+
+  Tensor *state = GetTensor(name);
+  const index_t outer = std::accumulate(shape.begin(), shape.begin() + axis,
+                                        1, std::multiplies<index_t>());
+  const index_t entry_bytes = std::accumulate(
+      shape.begin() + axis + 1, shape.end(),
+      static_cast<index_t>(state->SizeOfType()), std::multiplies<index_t>());
+  const index_t input_block = shape[axis] * entry_bytes;
+  const index_t state_block = info.capacity * entry_bytes;
+  Tensor::MappingGuard guard(state);
+  const uint8_t *input = static_cast<const uint8_t *>(data);
+  uint8_t *output = static_cast<uint8_t *>(state->raw_mutable_data()) +
+      info.length * entry_bytes;
+  for (index_t o = 0; o < outer; ++o) {
+    memcpy(output + o * state_block, input + o * input_block, input_block);
+  }
+  info.length += shape[axis];
+  return MaceStatus::MACE_SUCCESS;
+}
+
+std::vector<index_t> Workspace::ReadState(const std::string &name,
+                                          void *data) const {
+  const Tensor *state = GetTensor(name);
+  const int axis = StateAxis(name, state->dim_size());
+  if (axis < 0) {
+    // nothing was appended yet
+    return state->shape();
+  }
+  const StateInfo &info = states_.at(name);
+  std::vector<index_t> shape(state->shape());
+  shape[axis] = info.length;
+  if (data != nullptr) {
+    const index_t outer = std::accumulate(
+        shape.begin(), shape.begin() + axis, 1, std::multiplies<index_t>());
+    const index_t entry_bytes = std::accumulate(
+        shape.begin() + axis + 1, shape.end(),
+        static_cast<index_t>(state->SizeOfType()),
+        std::multiplies<index_t>());
+    const index_t output_block = info.length * entry_bytes;
+    const index_t state_block = info.capacity * entry_bytes;
+    Tensor::MappingGuard guard(state);
+    const uint8_t *input = static_cast<const uint8_t *>(state->raw_data());
+    uint8_t *output = static_cast<uint8_t *>(data);
+    for (index_t o = 0; o < outer; ++o) {
+      memcpy(output + o * output_block, input + o * state_block,
+             output_block);
+    }
+  }
+  return shape;
+}
+
+void Workspace::ResetStates() {
+  for (auto &state : states_) {
+    if (state.second.length > 0) {
+      GetTensor(state.first)->Clear();
+      state.second.length = 0;
+    }
+  }
+}
+
+MaceStatus Workspace::LoadState(const std::string &name,
+                                const std::vector<index_t> &shape,
+                                const void *data) {
+  auto iter = states_.find(name);
+  if (iter == states_.end()) {
+    LOG(ERROR) << "Tensor " << name << " is not a state";
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  const int axis = StateAxis(name, static_cast<index_t>(shape.size()));
+  if (axis < 0 || shape[axis] > iter->second.capacity) {
+    LOG(ERROR) << "State " << name << " can not take entries of shape "
+               << MakeString(shape) << ", its capacity is "
+               << iter->second.capacity;
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  // the content is replaced, so the state may take entries of other shapes
+  StateInfo &info = iter->second;
+  if (info.length > 0) {
+    GetTensor(name)->Clear();
+    info.length = 0;
+  }
+  return AppendState(name, shape, data);
+}
+
 }  // namespace mace
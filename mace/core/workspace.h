@@ -17,9 +17,11 @@
 
 #include <map>
 #include <string>
+#include <utility>
 #include <vector>
 #include <memory>
 
+#include "mace/core/packed_weight_cache.h"
 #include "mace/core/runtime/runtime.h"
 #include "mace/core/tensor.h"
 #include "mace/public/mace.h"
@@ -60,6 +62,10 @@ class Workspace {
                              const unsigned char *model_data,
                              const index_t model_data_size);
 
+  // Adds the weights of `source`, which must outlive this workspace, as
+  // tensors reading the same buffers, and shares its packed weight cache.
+  MaceStatus ShareModelTensors(const Workspace &source);
+
   MaceStatus AddQuantizeInfoForOutputTensor(const NetDef &net_def,
                                             Runtime *runtime);
 
@@ -73,16 +79,62 @@ class Workspace {
 
   const OpDelegatorRegistry *GetDelegatorRegistry() const;
 
+  // Cache of the weights CPU kernels prepack, nullptr when disabled.
+  PackedWeightCache *packed_weight_cache() const {
+    return packed_weight_cache_.get();
+  }
+
+  void SetPackedWeightCache(std::shared_ptr<PackedWeightCache> cache) {
+    packed_weight_cache_ = std::move(cache);
+  }
+
   MaceStatus ReleaseIntermediateBuffer(Runtime **runtimes, size_t size,
                                        Runtime *cpu_runtime);
 
+  // States keep their content between the runs of the net. The tensor of a
+  // state holds `capacity` entries along `axis` in a private buffer, each
+  // block of the dims before `axis` at capacity stride, so appending to it
+  // copies only the new entries. The first StateLength() entries of each
+  // block are the live ones, the others are 0.
+  Tensor *CreateState(const std::string &name, Runtime *runtime,
+                      DataType type, int axis, index_t capacity);
+  // Returns the axis of the state `name` for `rank` dims, -1 if no state.
+  int StateAxis(const std::string &name, index_t rank) const;
+  index_t StateCapacity(const std::string &name) const;
+  index_t StateLength(const std::string &name) const;
+  std::vector<std::string> States() const;
+  // Appends the entries at `data` of `shape`, which is the shape of the
+  // state but on `axis`. An empty state may take entries of any shape.
+  MaceStatus AppendState(const std::string &name,
+                         const std::vector<index_t> &shape, const void *data);
+  // Returns the shape of the live entries of the state and copies them
+  // packed to `data` if it is not nullptr.
+  std::vector<index_t> ReadState(const std::string &name, void *data) const;
+  // Empties the states, their buffers are kept for the next sequence.
+  void ResetStates();
+  // Replaces the content of the state `name` with `shape` entries at `data`.
+  MaceStatus LoadState(const std::string &name,
+                       const std::vector<index_t> &shape, const void *data);
+
  private:
+  struct StateInfo {
+    int axis;
+    index_t capacity;
+    index_t length;
+  };
+
+  // Shapes the state for entries of `shape` on the dims but `axis`.
+  MaceStatus ReserveState(const std::string &name,
+                          const std::vector<index_t> &shape, int axis);
+
   TensorMap tensor_map_;
+  std::map<std::string, StateInfo> states_;
   std::unique_ptr<Buffer> tensor_buffer_;
   bool diffused_buffer_;
 
   const OpDelegatorRegistry *op_delegator_registry_;
   BaseFlow *parent_flow_;
+  std::shared_ptr<PackedWeightCache> packed_weight_cache_;
 
   MACE_DISABLE_COPY_AND_ASSIGN(Workspace);
 };
@@ -18,9 +18,14 @@
 
 #include "mace/core/flow/flow_registry.h"
 #include "mace/core/net_def_adapter.h"
+#include "mace/core/net/parallel_net.h"
 #include "mace/core/net/serial_net.h"
+#include "mace/core/packed_weight_cache.h"
+#include "mace/core/registry/op_delegator_registry.h"
 #include "mace/core/workspace.h"
 #include "mace/proto/mace.pb.h"
+#include "mace/utils/cpu_isa.h"
+#include "mace/utils/memory.h"
 
 namespace mace {
 
@@ -39,19 +44,68 @@ MaceStatus CpuRefFlow::Init(const NetDef *net_def,
   MACE_RETURN_IF_ERROR(ws_->LoadModelTensor(
       *net_def, main_runtime_, model_data, model_data_size));
 
+  if (main_runtime_->GetRuntimeType() == RuntimeType::RT_CPU) {
+    // without a directory the cache only holds the packed weights for the
+    // replicas of this flow
+    const std::string cache_dir = config_impl_->packed_weight_cache_dir();
+    const char *isa =
+        utils::CPUIsaToString(ws_->GetDelegatorRegistry()->cpu_isa());
+    std::string cache_path;
+    if (!cache_dir.empty()) {
+      cache_path = PackedWeightCacheFilePath(cache_dir, model_data,
+                                             model_data_size, isa);
+    }
+    auto cache = std::make_shared<PackedWeightCache>(cache_path, isa);
+    MACE_RETURN_IF_ERROR(cache->Load());
+    ws_->SetPackedWeightCache(std::move(cache));
+  }
+
+  MACE_RETURN_IF_ERROR(InitNet(net_def, model_data, model_data_unused));
+  if (ws_->packed_weight_cache() != nullptr &&
+      ws_->packed_weight_cache()->Flush() != MaceStatus::MACE_SUCCESS) {
+    LOG(WARNING) << "Prepacked weights are not cached";
+  }
+
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStatus CpuRefFlow::InitReplica(const NetDef *net_def,
+                                   const BaseFlow *source) {
+  if (main_runtime_->GetRuntimeType() != RuntimeType::RT_CPU) {
+    return BaseFlow::InitReplica(net_def, source);
+  }
+  MACE_RETURN_IF_ERROR(BaseFlow::Init(net_def, nullptr, 0, nullptr));
+  MACE_RETURN_IF_ERROR(ws_->ShareModelTensors(*GetWorkspace(source)));
+
+  return InitNet(net_def, nullptr, nullptr);
+}
+
+MaceStatus CpuRefFlow::InitNet(const NetDef *net_def,
+                               const unsigned char *model_data,
+                               bool *model_data_unused) {
   NetDef adapted_net_def;
   NetDefAdapter net_def_adapter(op_registry_, ws_.get());
   net_def_adapter.AdaptNetDef(net_def, main_runtime_,
                               cpu_runtime_, &adapted_net_def);
 
+  // the constants shared by a replica are already decompressed and
+  // transposed
+  MACE_RETURN_IF_ERROR(DecompressConstForCPU(&cpu_runtime_->thread_pool(),
+                                             ws_.get(), cpu_runtime_,
+                                             &adapted_net_def));
   TransposeConstForCPU(&cpu_runtime_->thread_pool(), ws_.get(), cpu_runtime_,
                        &adapted_net_def);
   // Init model
-  net_ = std::unique_ptr<BaseNet>(new SerialNet(op_registry_,
-                                                &adapted_net_def,
-                                                ws_.get(),
-                                                main_runtime_,
-                                                cpu_runtime_));
+  if (config_impl_->cpu_parallel_ops() > 1) {
+    net_ = std::unique_ptr<BaseNet>(new ParallelNet(
+        op_registry_, &adapted_net_def, ws_.get(), main_runtime_,
+        cpu_runtime_, config_impl_->cpu_parallel_ops(),
+        config_impl_->num_threads(), config_impl_->shape_plan_cache_size()));
+  } else {
+    net_ = std::unique_ptr<BaseNet>(new SerialNet(
+        op_registry_, &adapted_net_def, ws_.get(), main_runtime_,
+        cpu_runtime_, config_impl_->shape_plan_cache_size()));
+  }
   if (model_data_unused != nullptr) {
     *model_data_unused = ws_->diffused_buffer();
   }
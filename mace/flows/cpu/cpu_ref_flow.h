@@ -34,6 +34,9 @@ class CpuRefFlow : public CommonFp32Flow {
                   const int64_t model_data_size,
                   bool *model_data_unused) override;
 
+  MaceStatus InitReplica(const NetDef *net_def,
+                         const BaseFlow *source) override;
+
   MaceStatus Run(TensorMap *input_tensors, TensorMap *output_tensors,
                  RunMetadata *run_metadata) override;
  protected:
@@ -43,6 +46,10 @@ class CpuRefFlow : public CommonFp32Flow {
       DataFormat *data_format) override;
 
  private:
+  // Creates and initializes the net once the weights are in the workspace.
+  MaceStatus InitNet(const NetDef *net_def, const unsigned char *model_data,
+                     bool *model_data_unused);
+
   MACE_DISABLE_COPY_AND_ASSIGN(CpuRefFlow);
 };
 
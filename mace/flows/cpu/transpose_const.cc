@@ -12,17 +12,23 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <utility>
 #include <unordered_set>
 #include <vector>
 
+#include "mace/core/compressed_weight.h"
 #include "mace/core/workspace.h"
 #include "mace/core/proto/arg_helper.h"
+#include "mace/core/proto/net_def_helper.h"
 #include "mace/flows/cpu/transpose_const.h"
 #include "mace/proto/mace.pb.h"
 #include "mace/public/mace.h"
+#include "mace/utils/math.h"
 #include "mace/utils/thread_pool.h"
 
 namespace mace {
@@ -227,4 +233,74 @@ MaceStatus TransposeConstForCPU(
   return MaceStatus::MACE_SUCCESS;
 }
 
+MaceStatus DecompressConstForCPU(
+    mace::utils::ThreadPool *thread_pool,
+    Workspace *ws,
+    Runtime *runtime,
+    NetDef *net_def) {
+  // The weights read through Gemv, which converts the rows it multiplies.
+  static const std::map<std::string, std::set<int>> kCompressedInputs = {
+      {"DynamicLSTM", {3, 5}},
+      {"FullyConnected", {1}},
+  };
+  // uint8 weights are only compressed in float models
+  const bool is_quantized_model = NetDefHelper::IsQuantizedModel(*net_def);
+  int num_ops = net_def->op_size();
+
+  for (int idx = 0; idx < num_ops; ++idx) {
+    OperatorDef *op_def = net_def->mutable_op(idx);
+    RuntimeType op_device_type = static_cast<RuntimeType>(
+        op_def->device_type());
+    if (RuntimeType::RT_CPU != op_device_type) {
+      continue;
+    }
+    DataType op_dt = static_cast<DataType>(
+        ProtoArgHelper::GetOptionalArg<OperatorDef, int>(
+            *op_def, "T", static_cast<int>(DataType::DT_FLOAT)));
+    auto compressed_inputs = kCompressedInputs.find(op_def->type());
+    for (int input_idx = 0; input_idx < op_def->input_size(); ++input_idx) {
+      const std::string &input_name = op_def->input(input_idx);
+      Tensor *input = ws->GetTensor(input_name);
+      if (input == nullptr || !IsCompressedWeight(input) ||
+          (is_quantized_model && input->dtype() == DT_UINT8)) {
+        continue;
+      }
+      if (op_dt == DT_FLOAT && compressed_inputs != kCompressedInputs.end() &&
+          compressed_inputs->second.count(input_idx) > 0) {
+        continue;
+      }
+
+      std::string output_name = input_name + std::string("_float");
+      Tensor *output = ws->GetTensor(output_name);
+      // decompressed for another op, or by the engine sharing the weights
+      if (output == nullptr) {
+        VLOG(2) << "Decompress weight " << input_name << " for "
+                << op_def->name();
+        std::unique_ptr<Tensor> output_tensor =
+            make_unique<Tensor>(runtime, DT_FLOAT, CPU_BUFFER,
+                                input->shape(), true, output_name);
+        output = output_tensor.get();
+        MACE_RETURN_IF_ERROR(
+            runtime->AllocateBufferForTensor(output, RENT_PRIVATE));
+        const Tensor *weight = input;
+        float *output_data = output->mutable_data<float>();
+        const index_t size = input->size();
+        const index_t block_size = 4096;
+        thread_pool->Compute1D([=](index_t start, index_t end, index_t step) {
+          for (index_t i = start; i < end; i += step) {
+            const index_t offset = i * block_size;
+            DecompressWeight(weight, offset,
+                             std::min(block_size, size - offset),
+                             output_data + offset);
+          }
+        }, 0, RoundUpDiv(size, block_size), 1);
+        MACE_RETURN_IF_ERROR(ws->AddTensor(output_name,
+                                           std::move(output_tensor)));
+      }
+      op_def->set_input(input_idx, output_name);
+    }
+  }
+  return MaceStatus::MACE_SUCCESS;
+}
+
 }  // namespace mace
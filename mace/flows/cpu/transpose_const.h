@@ -26,6 +26,14 @@ MaceStatus TransposeConstForCPU(
     Runtime *runtime,
     NetDef *net_def);
 
+// Replaces the fp16 and uint8 weights kept compressed by the CPU runtime with
+// float copies, except for the inputs whose kernels convert them on the fly.
+MaceStatus DecompressConstForCPU(
+    mace::utils::ThreadPool *thread_pool,
+    Workspace *ws,
+    Runtime *runtime,
+    NetDef *net_def);
+
 }  // namespace mace
 
 #endif  // MACE_FLOWS_CPU_TRANSPOSE_CONST_H_
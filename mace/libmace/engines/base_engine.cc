@@ -145,6 +145,47 @@ MaceStatus BaseEngine::Init(
 }
 
 
+MaceStatus BaseEngine::InitReplica(BaseEngine *source) {
+  thread_pool_->Init();
+  // register ops and delegators
+  ops::RegisterAllOps(op_registry_.get());
+  ops::RegisterAllOpDelegators(op_delegator_registry_.get());
+
+  MACE_UNUSED(source);
+
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStatus BaseEngine::GetInputInfo(const std::string &name,
+                                    std::vector<int64_t> *shape,
+                                    DataFormat *data_format) {
+  MACE_UNUSED(name);
+  MACE_UNUSED(shape);
+  MACE_UNUSED(data_format);
+  return MaceStatus::MACE_UNSUPPORTED;
+}
+
+MaceStatus BaseEngine::GetShapePlanStats(ShapePlanStats *stats) {
+  MACE_UNUSED(stats);
+  return MaceStatus::MACE_UNSUPPORTED;
+}
+
+MaceStatus BaseEngine::ResetStates() {
+  return MaceStatus::MACE_UNSUPPORTED;
+}
+
+MaceStatus BaseEngine::SnapshotStates(
+    std::map<std::string, MaceTensor> *states) {
+  MACE_UNUSED(states);
+  return MaceStatus::MACE_UNSUPPORTED;
+}
+
+MaceStatus BaseEngine::RestoreStates(
+    const std::map<std::string, MaceTensor> &states) {
+  MACE_UNUSED(states);
+  return MaceStatus::MACE_UNSUPPORTED;
+}
+
 MaceStatus BaseEngine::BeforeInit() {
   return MaceStatus::MACE_SUCCESS;
 }
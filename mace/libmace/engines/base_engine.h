@@ -68,6 +68,10 @@ class BaseEngine {
                           const std::vector<std::string> &output_nodes,
                           const std::string &model_data_file);
 
+  // Initializes the engine to run the model of `source`, which has been
+  // initialized, on the weights of `source`.
+  virtual MaceStatus InitReplica(BaseEngine *source);
+
   virtual MaceStatus Forward(const std::map<std::string, MaceTensor> &inputs,
                              std::map<std::string, MaceTensor> *outputs,
                              RunMetadata *run_metadata);
@@ -79,6 +83,20 @@ class BaseEngine {
   RuntimesMap &GetRuntimesOfTutor(BaseEngine *tutor);
   std::vector<RuntimeType> GetRuntimeTypes();
 
+  // Shape and data format of the model input `name`.
+  virtual MaceStatus GetInputInfo(const std::string &name,
+                                  std::vector<int64_t> *shape,
+                                  DataFormat *data_format);
+
+  // Adds the counters of the memory plans cached by the flows to `stats`.
+  virtual MaceStatus GetShapePlanStats(ShapePlanStats *stats);
+
+  // The states of the flows, which keep their content between runs.
+  virtual MaceStatus ResetStates();
+  virtual MaceStatus SnapshotStates(std::map<std::string, MaceTensor> *states);
+  virtual MaceStatus RestoreStates(
+      const std::map<std::string, MaceTensor> &states);
+
  protected:
   virtual MaceStatus BeforeRun();
   virtual MaceStatus Run(const std::map<std::string, MaceTensor> &inputs,
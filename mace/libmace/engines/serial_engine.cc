@@ -15,6 +15,7 @@
 
 #include "mace/libmace/engines/serial_engine.h"
 
+#include <algorithm>
 #include <functional>
 #include <map>
 #include <memory>
@@ -25,6 +26,7 @@
 
 #include "mace/core/runtime/runtime.h"
 #include "mace/core/runtime/runtime_registry.h"
+#include "mace/runtimes/cpu/cpu_runtime.h"
 
 namespace mace {
 SerialEngine::SerialEngine(const MaceEngineConfig &config)
@@ -73,6 +75,18 @@ MaceStatus SerialEngine::Init(const MultiNetDef *multi_net_def,
   return MaceStatus::MACE_SUCCESS;
 }
 
+MaceStatus SerialEngine::InitReplica(BaseEngine *source) {
+  MACE_RETURN_IF_ERROR(BaseEngine::InitReplica(source));
+
+  // all the engines are created by SmartCreateEngine
+  auto *serial_source = static_cast<SerialEngine *>(source);
+  MACE_CHECK(serial_source->multi_net_def_ != nullptr,
+             "The source engine should be initialized first.");
+  return DoInit(serial_source->multi_net_def_.get(),
+                serial_source->input_nodes_, serial_source->output_nodes_,
+                nullptr, 0, nullptr, nullptr, serial_source);
+}
+
 MaceStatus SerialEngine::BeforeRun() {
   if (inter_mem_released_) {
     MACE_RETURN_IF_ERROR(AllocateIntermediateBuffer());
@@ -129,6 +143,71 @@ MaceStatus SerialEngine::FakeWarmup() {
   return MaceStatus::MACE_SUCCESS;
 }
 
+MaceStatus SerialEngine::GetInputInfo(const std::string &name,
+                                      std::vector<int64_t> *shape,
+                                      DataFormat *data_format) {
+  if (multi_net_def_ == nullptr || std::find(input_nodes_.begin(),
+      input_nodes_.end(), name) == input_nodes_.end()) {
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  for (auto &net_def : multi_net_def_->net_def()) {
+    for (auto &input_info : net_def.input_info()) {
+      if (input_info.name() == name) {
+        shape->assign(input_info.dims().begin(), input_info.dims().end());
+        *data_format = static_cast<DataFormat>(input_info.data_format());
+        return MaceStatus::MACE_SUCCESS;
+      }
+    }
+  }
+  return MaceStatus::MACE_INVALID_ARGS;
+}
+
+MaceStatus SerialEngine::GetShapePlanStats(ShapePlanStats *stats) {
+  for (auto &flow : flows_) {
+    flow->GetShapePlanStats(stats);
+  }
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStatus SerialEngine::ResetStates() {
+  for (auto &flow : flows_) {
+    flow->ResetStates();
+  }
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStatus SerialEngine::SnapshotStates(
+    std::map<std::string, MaceTensor> *states) {
+  states->clear();
+  for (auto &flow : flows_) {
+    for (const std::string &name : flow->States()) {
+      MACE_RETURN_IF_ERROR(flow->SnapshotState(name, &(*states)[name]));
+    }
+  }
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStatus SerialEngine::RestoreStates(
+    const std::map<std::string, MaceTensor> &states) {
+  std::unordered_map<std::string, BaseFlow *> state_flows;
+  for (auto &flow : flows_) {
+    for (const std::string &name : flow->States()) {
+      state_flows[name] = flow.get();
+    }
+  }
+  for (auto &state : states) {
+    if (state_flows.count(state.first) == 0) {
+      LOG(ERROR) << state.first << " is not a state of the model";
+      return MaceStatus::MACE_INVALID_ARGS;
+    }
+  }
+  for (auto &state : states) {
+    MACE_RETURN_IF_ERROR(
+        state_flows.at(state.first)->RestoreState(state.first, state.second));
+  }
+  return MaceStatus::MACE_SUCCESS;
+}
+
 MaceStatus SerialEngine::ReleaseIntermediateBuffer() {
   if (inter_mem_released_) {
     return MaceStatus::MACE_SUCCESS;
@@ -176,6 +255,8 @@ MaceStatus SerialEngine::CreateAndInitRuntimes(
     cpu_runtime_ = std::move(cpu_runtime);
   }
   runtimes_.emplace(cpu_rt_key, cpu_runtime_);
+  op_delegator_registry_->SetCPUIsa(
+      static_cast<CpuRuntime *>(cpu_runtime_.get())->cpu_isa());
 
   // Create other runtimes
   for (auto i = net_defs.begin(); i != net_defs.end(); ++i) {
@@ -237,7 +318,8 @@ MaceStatus SerialEngine::CreateAndInitRuntimes(
 MaceStatus SerialEngine::CreateAndInitFlows(
     const NetDefMap &net_defs, const NetRuntimeMap &runtime_map,
     const unsigned char *model_data,
-    const int64_t model_data_size, bool *model_data_unused) {
+    const int64_t model_data_size, bool *model_data_unused,
+    const SerialEngine *source) {
   // create FlowRegistry
   auto flow_registry = make_unique<FlowRegistry>();
   RegisterAllFlows(flow_registry.get());
@@ -260,15 +342,22 @@ MaceStatus SerialEngine::CreateAndInitFlows(
     RuntimeType runtime_type = runtime->GetRuntimeType();
     auto flow = flow_registry->CreateFlow(runtime_type, sub_type,
                                           flow_context.get());
-    bool data_unused = false;
-    const auto data_offset = net_def->data_offset();
-    auto data_size = net_def->data_size();
-    if (data_size == 0) {  // Compatible with old version of NetDef
-      data_size = model_data_size;
+    bool data_unused = true;
+    if (source != nullptr) {
+      // the flows of the source are created in the same order
+      MACE_RETURN_IF_ERROR(flow->InitReplica(
+          net_def, source->flows_[flows_.size()].get()));
+    } else {
+      data_unused = false;
+      const auto data_offset = net_def->data_offset();
+      auto data_size = net_def->data_size();
+      if (data_size == 0) {  // Compatible with old version of NetDef
+        data_size = model_data_size;
+      }
+      MACE_CHECK(data_offset + data_size <= model_data_size);
+      MACE_RETURN_IF_ERROR(flow->Init(
+          net_def, model_data + data_offset, data_size, &data_unused));
     }
-    MACE_CHECK(data_offset + data_size <= model_data_size);
-    MACE_RETURN_IF_ERROR(flow->Init(
-        net_def, model_data + data_offset, data_size, &data_unused));
     // In serial engine, we can reuse buffers between flows
     runtime->ReleaseAllBuffer(RENT_SHARE, false);
     if (runtime != cpu_runtime_) {
@@ -415,14 +504,17 @@ MaceStatus SerialEngine::DoInit(
     const std::vector<std::string> &input_nodes,
     const std::vector<std::string> &output_nodes,
     const unsigned char *model_data, const int64_t model_data_size,
-    bool *model_data_unused, BaseEngine *tutor) {
+    bool *model_data_unused, BaseEngine *tutor, const SerialEngine *source) {
   VLOG(1) << "Initializing SerialEngine";
+  multi_net_def_ = make_unique<MultiNetDef>(*multi_net_def);
+  input_nodes_ = input_nodes;
+  output_nodes_ = output_nodes;
 
   // sort the net_def
   NetDefMap net_defs;
-  const auto net_def_num = multi_net_def->net_def_size();
+  const auto net_def_num = multi_net_def_->net_def_size();
   for (int i = 0; i < net_def_num; ++i) {
-    const NetDef &net_def = multi_net_def->net_def(i);
+    const NetDef &net_def = multi_net_def_->net_def(i);
     net_defs.emplace(net_def.infer_order(), &net_def);
   }
 
@@ -430,10 +522,16 @@ MaceStatus SerialEngine::DoInit(
   std::unordered_map<const NetDef *, std::shared_ptr<Runtime>> runtime_map;
   MaceStatus ret = CreateAndInitRuntimes(net_defs, &runtime_map, tutor);
   MACE_RETURN_IF_ERROR(ret);
+  if (source != nullptr && op_delegator_registry_->cpu_isa() !=
+      source->op_delegator_registry_->cpu_isa()) {
+    LOG(ERROR) << "A replica should use the CPU instruction set of its "
+                  "source engine";
+    return MaceStatus::MACE_UNSUPPORTED;
+  }
 
   // create and init flows
   ret = CreateAndInitFlows(net_defs, runtime_map, model_data,
-                           model_data_size, model_data_unused);
+                           model_data_size, model_data_unused, source);
   MACE_RETURN_IF_ERROR(ret);
 
   // create flows'output tensors
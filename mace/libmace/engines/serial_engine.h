@@ -48,8 +48,19 @@ class SerialEngine : public BaseEngine {
                   const int64_t model_data_size,
                   bool *model_data_unused = nullptr) override;
 
+  MaceStatus InitReplica(BaseEngine *source) override;
+
   MaceStatus ReleaseIntermediateBuffer() override;
   MaceStatus AllocateIntermediateBuffer() override;
+  MaceStatus GetInputInfo(const std::string &name,
+                          std::vector<int64_t> *shape,
+                          DataFormat *data_format) override;
+  MaceStatus GetShapePlanStats(ShapePlanStats *stats) override;
+  MaceStatus ResetStates() override;
+  MaceStatus SnapshotStates(
+      std::map<std::string, MaceTensor> *states) override;
+  MaceStatus RestoreStates(
+      const std::map<std::string, MaceTensor> &states) override;
 
  protected:
   MaceStatus BeforeRun() override;
@@ -72,7 +83,8 @@ class SerialEngine : public BaseEngine {
                     const std::vector<std::string> &output_nodes,
                     const unsigned char *model_data,
                     const int64_t model_data_size,
-                    bool *model_data_unused, BaseEngine *tutor);
+                    bool *model_data_unused, BaseEngine *tutor,
+                    const SerialEngine *source = nullptr);
 
   MaceStatus CreateAndInitRuntimes(const NetDefMap &net_defs,
                                    NetRuntimeMap *runtime_map,
@@ -81,7 +93,7 @@ class SerialEngine : public BaseEngine {
   MaceStatus CreateAndInitFlows(
       const NetDefMap &net_defs, const NetRuntimeMap &runtime_map,
       const unsigned char *model_data, const int64_t model_data_size,
-      bool *model_data_unused);
+      bool *model_data_unused, const SerialEngine *source);
 
   std::unordered_map<std::string, int> AllocOutTensors(
       const NetDefMap &net_defs, const std::vector<std::string> &glb_out_nodes);
@@ -92,6 +104,10 @@ class SerialEngine : public BaseEngine {
 
  private:
   std::shared_ptr<Runtime> cpu_runtime_;
+  // the model, kept to initialize replicas
+  std::unique_ptr<MultiNetDef> multi_net_def_;
+  std::vector<std::string> input_nodes_;
+  std::vector<std::string> output_nodes_;
   FlowArray flows_;
 
   FlowTensorMap input_tensors_;
@@ -19,6 +19,7 @@
 #include "mace/core/flow/flow_registry.h"
 #include "mace/core/runtime/runtime_registry.h"
 #include "mace/proto/mace.pb.h"
+#include "mace/runtimes/cpu/cpu_runtime.h"
 
 namespace mace {
 SingleFlowEngine::SingleFlowEngine(const MaceEngineConfig &config)
@@ -54,6 +55,8 @@ MaceStatus SingleFlowEngine::CreateAndInitRuntimes(const NetDef *net_def,
     cpu_runtime_ = std::move(cpu_runtime);
   }
   runtimes_.emplace(cpu_rt_key, cpu_runtime_);
+  op_delegator_registry_->SetCPUIsa(
+      static_cast<CpuRuntime *>(cpu_runtime_.get())->cpu_isa());
 
   if (target_runtime_type == RT_CPU) {
     runtime_ = cpu_runtime_;
@@ -68,6 +68,21 @@ class MaceEngine::Impl {
 
   std::vector<RuntimeType> GetRuntimeTypes();
 
+  MaceStatus CreateReplica(const MaceEngineConfig &config,
+                           std::shared_ptr<MaceEngine> *replica);
+
+  MaceStatus GetInputInfo(const std::string &name,
+                          std::vector<int64_t> *shape,
+                          DataFormat *data_format);
+
+  MaceStatus GetShapePlanStats(ShapePlanStats *stats);
+
+  MaceStatus ResetStates();
+
+  MaceStatus SnapshotStates(std::map<std::string, MaceTensor> *states);
+
+  MaceStatus RestoreStates(const std::map<std::string, MaceTensor> &states);
+
  private:
   std::unique_ptr<BaseEngine> engine_;
 
@@ -150,6 +165,51 @@ std::vector<RuntimeType> MaceEngine::Impl::GetRuntimeTypes() {
   return engine_->GetRuntimeTypes();
 }
 
+MaceStatus MaceEngine::Impl::CreateReplica(
+    const MaceEngineConfig &config, std::shared_ptr<MaceEngine> *replica) {
+  if (replica == nullptr) {
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  auto engine = std::make_shared<MaceEngine>(config);
+  BaseEngine *base_engine = engine->impl_->engine_.get();
+  MACE_RETURN_IF_ERROR(base_engine->BeforeInit());
+  MACE_RETURN_IF_ERROR(base_engine->InitReplica(engine_.get()));
+  MACE_RETURN_IF_ERROR(base_engine->AfterInit());
+  *replica = std::move(engine);
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStatus MaceEngine::Impl::GetInputInfo(const std::string &name,
+                                          std::vector<int64_t> *shape,
+                                          DataFormat *data_format) {
+  return engine_->GetInputInfo(name, shape, data_format);
+}
+
+MaceStatus MaceEngine::Impl::GetShapePlanStats(ShapePlanStats *stats) {
+  if (stats == nullptr) {
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  *stats = {0, 0, 0};
+  return engine_->GetShapePlanStats(stats);
+}
+
+MaceStatus MaceEngine::Impl::ResetStates() {
+  return engine_->ResetStates();
+}
+
+MaceStatus MaceEngine::Impl::SnapshotStates(
+    std::map<std::string, MaceTensor> *states) {
+  if (states == nullptr) {
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  return engine_->SnapshotStates(states);
+}
+
+MaceStatus MaceEngine::Impl::RestoreStates(
+    const std::map<std::string, MaceTensor> &states) {
+  return engine_->RestoreStates(states);
+}
+
 MaceEngine::MaceEngine(const MaceEngineConfig &config) :
     impl_(make_unique<MaceEngine::Impl>(config)) {}
 
@@ -230,6 +290,35 @@ std::vector<RuntimeType> MaceEngine::GetRuntimeTypes() {
   return impl_->GetRuntimeTypes();
 }
 
+MaceStatus MaceEngine::CreateReplica(const MaceEngineConfig &config,
+                                     std::shared_ptr<MaceEngine> *replica) {
+  return impl_->CreateReplica(config, replica);
+}
+
+MaceStatus MaceEngine::GetInputInfo(const std::string &name,
+                                    std::vector<int64_t> *shape,
+                                    DataFormat *data_format) {
+  return impl_->GetInputInfo(name, shape, data_format);
+}
+
+MaceStatus MaceEngine::GetShapePlanStats(ShapePlanStats *stats) {
+  return impl_->GetShapePlanStats(stats);
+}
+
+MaceStatus MaceEngine::ResetStates() {
+  return impl_->ResetStates();
+}
+
+MaceStatus MaceEngine::SnapshotStates(
+    std::map<std::string, MaceTensor> *states) {
+  return impl_->SnapshotStates(states);
+}
+
+MaceStatus MaceEngine::RestoreStates(
+    const std::map<std::string, MaceTensor> &states) {
+  return impl_->RestoreStates(states);
+}
+
 
 MaceStatus CreateMaceEngineFromProto(
     const unsigned char *model_graph_proto,
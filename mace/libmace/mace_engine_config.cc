@@ -15,6 +15,7 @@
 #include "mace/utils/mace_engine_config.h"
 
 #include "mace/core/runtime/runtime.h"
+#include "mace/utils/logging.h"
 
 #ifdef MACE_ENABLE_HEXAGON
 #include "mace/runtimes/hexagon/dsp/hexagon_dsp_wrapper.h"
@@ -25,6 +26,13 @@ namespace mace {
 MaceEngineCfgImpl::MaceEngineCfgImpl()
     : num_threads_(-1),
       cpu_affinity_policy_(CPUAffinityPolicy::AFFINITY_NONE),
+      cpu_isa_(CPUIsa::CPU_ISA_AUTO),
+      cpu_parameter_path_(""),
+      cpu_parallel_ops_(1),
+      zero_copy_io_(false),
+      packed_weight_cache_dir_(""),
+      compressed_weights_(false),
+      shape_plan_cache_size_(1),
       opencl_context_(nullptr),
       gpu_priority_hint_(GPUPriorityHint::PRIORITY_LOW),
       gpu_perf_hint_(GPUPerfHint::PERF_NORMAL),
@@ -52,6 +60,34 @@ CPUAffinityPolicy MaceEngineCfgImpl::cpu_affinity_policy() const {
   return cpu_affinity_policy_;
 }
 
+CPUIsa MaceEngineCfgImpl::cpu_isa() const {
+  return cpu_isa_;
+}
+
+std::string MaceEngineCfgImpl::cpu_parameter_path() const {
+  return cpu_parameter_path_;
+}
+
+int MaceEngineCfgImpl::cpu_parallel_ops() const {
+  return cpu_parallel_ops_;
+}
+
+bool MaceEngineCfgImpl::zero_copy_io() const {
+  return zero_copy_io_;
+}
+
+std::string MaceEngineCfgImpl::packed_weight_cache_dir() const {
+  return packed_weight_cache_dir_;
+}
+
+bool MaceEngineCfgImpl::compressed_weights() const {
+  return compressed_weights_;
+}
+
+int MaceEngineCfgImpl::shape_plan_cache_size() const {
+  return shape_plan_cache_size_;
+}
+
 std::shared_ptr<OpenclContext> MaceEngineCfgImpl::opencl_context() const {
   return opencl_context_;
 }
@@ -133,6 +169,50 @@ MaceStatus MaceEngineCfgImpl::SetCPUThreadPolicy(
   return MaceStatus::MACE_SUCCESS;
 }
 
+MaceStatus MaceEngineCfgImpl::SetCPUIsa(CPUIsa isa) {
+  cpu_isa_ = isa;
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStatus MaceEngineCfgImpl::SetCPUParameterPath(const std::string &path) {
+  cpu_parameter_path_ = path;
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStatus MaceEngineCfgImpl::SetCPUParallelOps(int num_parallel_ops) {
+  if (num_parallel_ops < 1) {
+    LOG(ERROR) << "num_parallel_ops should be at least 1, got "
+               << num_parallel_ops;
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  cpu_parallel_ops_ = num_parallel_ops;
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStatus MaceEngineCfgImpl::SetZeroCopyIO(bool enable) {
+  zero_copy_io_ = enable;
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStatus MaceEngineCfgImpl::SetPackedWeightCacheDir(const std::string &dir) {
+  packed_weight_cache_dir_ = dir;
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStatus MaceEngineCfgImpl::SetCompressedWeights(bool enable) {
+  compressed_weights_ = enable;
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStatus MaceEngineCfgImpl::SetShapePlanCacheSize(int max_plans) {
+  if (max_plans < 0) {
+    LOG(ERROR) << "max_plans should not be negative, got " << max_plans;
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  shape_plan_cache_size_ = max_plans;
+  return MaceStatus::MACE_SUCCESS;
+}
+
 MaceStatus MaceEngineCfgImpl::SetHexagonToUnsignedPD() {
   bool ret = false;
 #ifdef MACE_ENABLE_HEXAGON
@@ -222,6 +302,34 @@ MaceStatus MaceEngineConfig::SetCPUThreadPolicy(
   return impl_->SetCPUThreadPolicy(num_threads_hint, policy);
 }
 
+MaceStatus MaceEngineConfig::SetCPUIsa(CPUIsa isa) {
+  return impl_->SetCPUIsa(isa);
+}
+
+MaceStatus MaceEngineConfig::SetCPUParameterPath(const std::string &path) {
+  return impl_->SetCPUParameterPath(path);
+}
+
+MaceStatus MaceEngineConfig::SetCPUParallelOps(int num_parallel_ops) {
+  return impl_->SetCPUParallelOps(num_parallel_ops);
+}
+
+MaceStatus MaceEngineConfig::SetZeroCopyIO(bool enable) {
+  return impl_->SetZeroCopyIO(enable);
+}
+
+MaceStatus MaceEngineConfig::SetPackedWeightCacheDir(const std::string &dir) {
+  return impl_->SetPackedWeightCacheDir(dir);
+}
+
+MaceStatus MaceEngineConfig::SetCompressedWeights(bool enable) {
+  return impl_->SetCompressedWeights(enable);
+}
+
+MaceStatus MaceEngineConfig::SetShapePlanCacheSize(int max_plans) {
+  return impl_->SetShapePlanCacheSize(max_plans);
+}
+
 MaceStatus MaceEngineConfig::SetHexagonToUnsignedPD() {
   return impl_->SetHexagonToUnsignedPD();
 }
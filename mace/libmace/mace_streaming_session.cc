@@ -0,0 +1,366 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <numeric>
+#include <utility>
+
+#include "mace/public/mace.h"
+#include "mace/utils/logging.h"
+#include "mace/utils/memory.h"
+
+namespace mace {
+
+namespace {
+
+int64_t ShapeSize(const std::vector<int64_t> &shape) {
+  return std::accumulate(shape.begin(), shape.end(), static_cast<int64_t>(1),
+                         std::multiplies<int64_t>());
+}
+
+std::shared_ptr<float> AllocateFloats(const int64_t size) {
+  return std::shared_ptr<float>(new float[size](),
+                                std::default_delete<float[]>());
+}
+
+}  // namespace
+
+class MaceStreamingSession::Impl {
+ public:
+  Impl() : engine_(nullptr) {}
+
+  MaceStatus Init(MaceEngine *engine,
+                  const std::map<std::string, std::string> &states,
+                  const std::map<std::string, int> &context_frames);
+
+  MaceStatus Run(const std::map<std::string, MaceTensor> &inputs,
+                 std::map<std::string, MaceTensor> *outputs,
+                 RunMetadata *run_metadata);
+
+  void Reset();
+
+  MaceStatus Snapshot(std::map<std::string, MaceTensor> *snapshot) const;
+
+  MaceStatus Restore(const std::map<std::string, MaceTensor> &snapshot);
+
+ private:
+  // A model input fed by the model output `output` of the previous run.
+  struct State {
+    std::string output;
+    std::vector<int64_t> shape;
+    DataFormat data_format;
+    // fed to the input, and written by the output
+    std::shared_ptr<float> data;
+    std::shared_ptr<float> next_data;
+  };
+
+  // A model input whose leading `frames` frames are the last ones of the
+  // previous chunk.
+  struct Context {
+    int frames;
+    std::vector<int64_t> shape;
+    DataFormat data_format;
+    std::shared_ptr<float> data;
+    // whether the leading frames hold the previous chunk
+    bool has_history;
+
+    int64_t batch() const {
+      return std::accumulate(shape.begin(), shape.end() - 2,
+                             static_cast<int64_t>(1),
+                             std::multiplies<int64_t>());
+    }
+    int64_t chunk() const { return shape[shape.size() - 2]; }
+    int64_t dim() const { return shape.back(); }
+    std::vector<int64_t> history_shape() const {
+      std::vector<int64_t> history(shape);
+      history[history.size() - 2] = frames;
+      return history;
+    }
+  };
+
+  MaceStatus FillContext(const MaceTensor &new_frames, Context *context);
+
+  MaceEngine *engine_;
+  // keyed by the model inputs
+  std::map<std::string, State> states_;
+  std::map<std::string, Context> contexts_;
+};
+
+MaceStatus MaceStreamingSession::Impl::Init(
+    MaceEngine *engine,
+    const std::map<std::string, std::string> &states,
+    const std::map<std::string, int> &context_frames) {
+  if (engine == nullptr) {
+    LOG(ERROR) << "The streaming session needs an engine";
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  engine_ = engine;
+  states_.clear();
+  contexts_.clear();
+
+  for (auto &state_pair : states) {
+    const std::string &input_name = state_pair.second;
+    State state;
+    state.output = state_pair.first;
+    if (engine->GetInputInfo(input_name, &state.shape, &state.data_format)
+        != MaceStatus::MACE_SUCCESS) {
+      LOG(ERROR) << "State " << input_name << " is not a model input";
+      return MaceStatus::MACE_INVALID_ARGS;
+    }
+    if (states_.count(input_name) > 0) {
+      LOG(ERROR) << "State " << input_name << " is fed by two outputs";
+      return MaceStatus::MACE_INVALID_ARGS;
+    }
+    const int64_t size = ShapeSize(state.shape);
+    state.data = AllocateFloats(size);
+    state.next_data = AllocateFloats(size);
+    states_.emplace(input_name, std::move(state));
+  }
+
+  for (auto &frames : context_frames) {
+    const std::string &input_name = frames.first;
+    Context context;
+    context.frames = frames.second;
+    context.has_history = false;
+    if (engine->GetInputInfo(input_name, &context.shape,
+                             &context.data_format)
+        != MaceStatus::MACE_SUCCESS) {
+      LOG(ERROR) << "Input " << input_name << " is not a model input";
+      return MaceStatus::MACE_INVALID_ARGS;
+    }
+    if (states_.count(input_name) > 0 || context.shape.size() < 2
+        || context.frames <= 0 || context.frames >= context.chunk()) {
+      LOG(ERROR) << "Input " << input_name << " can not keep "
+                 << context.frames << " context frames";
+      return MaceStatus::MACE_INVALID_ARGS;
+    }
+    context.data = AllocateFloats(ShapeSize(context.shape));
+    contexts_.emplace(input_name, std::move(context));
+  }
+
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStatus MaceStreamingSession::Impl::FillContext(const MaceTensor &new_frames,
+                                                   Context *context) {
+  const std::vector<int64_t> &shape = context->shape;
+  const size_t rank = shape.size();
+  const int64_t new_chunk = context->chunk() - context->frames;
+  const std::vector<int64_t> &new_shape = new_frames.shape();
+  if (new_shape.size() != rank || new_shape[rank - 2] != new_chunk
+      || !std::equal(shape.begin(), shape.end() - 2, new_shape.begin())
+      || new_shape[rank - 1] != shape[rank - 1]) {
+    LOG(ERROR) << "A chunk should have " << new_chunk << " new frames";
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+
+  const int64_t batch = context->batch();
+  const int64_t chunk = context->chunk();
+  const int64_t dim = context->dim();
+  const int64_t frames = context->frames;
+  const float *src = new_frames.data().get();
+  float *data = context->data.get();
+  for (int64_t b = 0; b < batch; ++b) {
+    const float *src_base = src + b * new_chunk * dim;
+    float *dst_base = data + b * chunk * dim;
+    if (!context->has_history) {
+      for (int64_t f = 0; f < frames; ++f) {
+        memcpy(dst_base + f * dim, src_base, dim * sizeof(float));
+      }
+    }
+    memcpy(dst_base + frames * dim, src_base,
+           new_chunk * dim * sizeof(float));
+  }
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStatus MaceStreamingSession::Impl::Run(
+    const std::map<std::string, MaceTensor> &inputs,
+    std::map<std::string, MaceTensor> *outputs,
+    RunMetadata *run_metadata) {
+  if (engine_ == nullptr || outputs == nullptr) {
+    LOG(ERROR) << "The streaming session should be initialized first";
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+
+  std::map<std::string, MaceTensor> engine_inputs(inputs);
+  for (auto &context : contexts_) {
+    auto iter = inputs.find(context.first);
+    if (iter == inputs.end()) {
+      LOG(ERROR) << "Input " << context.first << " is missing";
+      return MaceStatus::MACE_INVALID_ARGS;
+    }
+    MACE_RETURN_IF_ERROR(FillContext(iter->second, &context.second));
+    engine_inputs[context.first] = MaceTensor(
+        context.second.shape, context.second.data,
+        context.second.data_format);
+  }
+  std::map<std::string, MaceTensor> engine_outputs(*outputs);
+  for (auto &state : states_) {
+    engine_inputs[state.first] = MaceTensor(
+        state.second.shape, state.second.data, state.second.data_format);
+    engine_outputs[state.second.output] = MaceTensor(
+        state.second.shape, state.second.next_data,
+        state.second.data_format);
+  }
+
+  MACE_RETURN_IF_ERROR(engine_->Run(engine_inputs, &engine_outputs,
+                                    run_metadata));
+
+  for (auto &output : *outputs) {
+    output.second = engine_outputs.at(output.first);
+  }
+  for (auto &state : states_) {
+    if (engine_outputs.at(state.second.output).shape() != state.second.shape) {
+      LOG(ERROR) << "Output " << state.second.output
+                 << " does not fit state " << state.first;
+      return MaceStatus::MACE_RUNTIME_ERROR;
+    }
+    std::swap(state.second.data, state.second.next_data);
+  }
+  // the last frames of this chunk lead the next one
+  for (auto &iter : contexts_) {
+    Context &context = iter.second;
+    const int64_t chunk = context.chunk();
+    const int64_t dim = context.dim();
+    const int64_t frames = context.frames;
+    float *data = context.data.get();
+    for (int64_t b = 0; b < context.batch(); ++b) {
+      float *base = data + b * chunk * dim;
+      memmove(base, base + (chunk - frames) * dim,
+              frames * dim * sizeof(float));
+    }
+    context.has_history = true;
+  }
+
+  return MaceStatus::MACE_SUCCESS;
+}
+
+void MaceStreamingSession::Impl::Reset() {
+  for (auto &state : states_) {
+    std::fill_n(state.second.data.get(), ShapeSize(state.second.shape), 0.f);
+  }
+  for (auto &context : contexts_) {
+    context.second.has_history = false;
+  }
+}
+
+MaceStatus MaceStreamingSession::Impl::Snapshot(
+    std::map<std::string, MaceTensor> *snapshot) const {
+  if (snapshot == nullptr) {
+    return MaceStatus::MACE_INVALID_ARGS;
+  }
+  snapshot->clear();
+  for (auto &state : states_) {
+    const int64_t size = ShapeSize(state.second.shape);
+    std::shared_ptr<float> data = AllocateFloats(size);
+    memcpy(data.get(), state.second.data.get(), size * sizeof(float));
+    snapshot->emplace(state.first, MaceTensor(state.second.shape, data,
+                                              state.second.data_format));
+  }
+  for (auto &iter : contexts_) {
+    const Context &context = iter.second;
+    if (!context.has_history) {
+      continue;
+    }
+    const int64_t batch = context.batch();
+    const int64_t history_size = context.frames * context.dim();
+    std::shared_ptr<float> data = AllocateFloats(batch * history_size);
+    for (int64_t b = 0; b < batch; ++b) {
+      memcpy(data.get() + b * history_size,
+             context.data.get() + b * context.chunk() * context.dim(),
+             history_size * sizeof(float));
+    }
+    snapshot->emplace(iter.first, MaceTensor(context.history_shape(), data,
+                                             context.data_format));
+  }
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStatus MaceStreamingSession::Impl::Restore(
+    const std::map<std::string, MaceTensor> &snapshot) {
+  for (auto &state : states_) {
+    auto iter = snapshot.find(state.first);
+    if (iter == snapshot.end() || iter->second.shape() != state.second.shape) {
+      LOG(ERROR) << "The snapshot does not fit state " << state.first;
+      return MaceStatus::MACE_INVALID_ARGS;
+    }
+  }
+  for (auto &context : contexts_) {
+    auto iter = snapshot.find(context.first);
+    if (iter != snapshot.end()
+        && iter->second.shape() != context.second.history_shape()) {
+      LOG(ERROR) << "The snapshot does not fit input " << context.first;
+      return MaceStatus::MACE_INVALID_ARGS;
+    }
+  }
+
+  for (auto &state : states_) {
+    memcpy(state.second.data.get(), snapshot.at(state.first).data().get(),
+           ShapeSize(state.second.shape) * sizeof(float));
+  }
+  for (auto &iter : contexts_) {
+    Context &context = iter.second;
+    auto history = snapshot.find(iter.first);
+    // a stream snapshotted before its first chunk has no history
+    context.has_history = history != snapshot.end();
+    if (!context.has_history) {
+      continue;
+    }
+    const int64_t history_size = context.frames * context.dim();
+    for (int64_t b = 0; b < context.batch(); ++b) {
+      memcpy(context.data.get() + b * context.chunk() * context.dim(),
+             history->second.data().get() + b * history_size,
+             history_size * sizeof(float));
+    }
+  }
+  return MaceStatus::MACE_SUCCESS;
+}
+
+MaceStreamingSession::MaceStreamingSession()
+    : impl_(make_unique<MaceStreamingSession::Impl>()) {}
+
+MaceStreamingSession::~MaceStreamingSession() = default;
+
+MaceStatus MaceStreamingSession::Init(
+    MaceEngine *engine,
+    const std::map<std::string, std::string> &states,
+    const std::map<std::string, int> &context_frames) {
+  return impl_->Init(engine, states, context_frames);
+}
+
+MaceStatus MaceStreamingSession::Run(
+    const std::map<std::string, MaceTensor> &inputs,
+    std::map<std::string, MaceTensor> *outputs,
+    RunMetadata *run_metadata) {
+  return impl_->Run(inputs, outputs, run_metadata);
+}
+
+void MaceStreamingSession::Reset() {
+  impl_->Reset();
+}
+
+MaceStatus MaceStreamingSession::Snapshot(
+    std::map<std::string, MaceTensor> *snapshot) const {
+  return impl_->Snapshot(snapshot);
+}
+
+MaceStatus MaceStreamingSession::Restore(
+    const std::map<std::string, MaceTensor> &snapshot) {
+  return impl_->Restore(snapshot);
+}
+
+}  // namespace mace
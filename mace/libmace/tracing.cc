@@ -0,0 +1,34 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "mace/public/mace.h"
+#include "mace/utils/logging.h"
+#include "mace/utils/tracer.h"
+
+namespace mace {
+
+void StartTracing(int events_per_thread) {
+  MACE_CHECK(events_per_thread > 0,
+             "events_per_thread should be > 0, got ", events_per_thread);
+  utils::Tracer::Start(static_cast<size_t>(events_per_thread));
+}
+
+MaceStatus StopTracing(const std::string &trace_file) {
+  utils::Tracer::Stop();
+  return utils::Tracer::WriteChromeTrace(trace_file);
+}
+
+}  // namespace mace
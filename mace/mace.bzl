@@ -60,6 +60,12 @@ def if_neon_enabled(a, default_value = []):
         "//conditions:default": default_value,
     })
 
+def if_x86_enabled(a, default_value = []):
+    return select({
+        "//mace:x86_enabled": a,
+        "//conditions:default": default_value,
+    })
+
 def if_hexagon_enabled(a, default_value = []):
     return select({
         "//mace:hexagon_enabled": a,
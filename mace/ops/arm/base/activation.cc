@@ -17,6 +17,7 @@
 #include <algorithm>
 
 #include "mace/ops/arm/base/common_neon.h"
+#include "mace/ops/common/vector_math.h"
 
 namespace mace {
 namespace ops {
@@ -292,6 +293,35 @@ void Activation<T>::ActivateElu(utils::ThreadPool *thread_pool,
       0, input_size, 1);
 }
 
+// float runs the polynomial approximations of vector_math on NEON registers
+template<>
+void Activation<float>::ActivateTanh(utils::ThreadPool *thread_pool,
+                                     const Tensor *input,
+                                     Tensor *output) {
+  vector_math::ParallelMap<VecNeon>(
+      thread_pool, input->data<float>(), input->size(),
+      output->mutable_data<float>(), vector_math::TanhFunc<VecNeon>());
+}
+
+template<>
+void Activation<float>::ActivateSigmoid(utils::ThreadPool *thread_pool,
+                                        const Tensor *input,
+                                        Tensor *output) {
+  vector_math::ParallelMap<VecNeon>(
+      thread_pool, input->data<float>(), input->size(),
+      output->mutable_data<float>(), vector_math::SigmoidFunc<VecNeon>());
+}
+
+template<>
+void Activation<float>::ActivateElu(utils::ThreadPool *thread_pool,
+                                    const Tensor *input,
+                                    Tensor *output) {
+  vector_math::ParallelMap<VecNeon>(
+      thread_pool, input->data<float>(), input->size(),
+      output->mutable_data<float>(),
+      vector_math::EluFunc<VecNeon>(activation_coefficient_));
+}
+
 void RegisterActivationDelegator(OpDelegatorRegistry *registry) {
   MACE_REGISTER_DELEGATOR(
       registry, Activation<float>, delegator::ActivationParam,
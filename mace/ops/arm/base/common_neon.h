@@ -375,6 +375,71 @@ inline void vst1o(BFloat16 *ptr, const float32x8_t v) {
 
 #endif  // MACE_ENABLE_BFLOAT16
 
+// Vector traits of float32x4_t for the templates of
+// mace/ops/common/vector_math.h.
+struct VecNeon {
+  typedef float32x4_t Vec;
+  static const int kWidth = 4;
+
+  static inline Vec Zero() { return vdupq_n_f32(0.f); }
+  static inline Vec Set1(const float v) { return vdupq_n_f32(v); }
+  static inline Vec Load(const float *p) { return vld1q_f32(p); }
+  static inline void Store(float *p, Vec v) { vst1q_f32(p, v); }
+  static inline Vec Add(Vec a, Vec b) { return vaddq_f32(a, b); }
+  static inline Vec Sub(Vec a, Vec b) { return vsubq_f32(a, b); }
+  static inline Vec Mul(Vec a, Vec b) { return vmulq_f32(a, b); }
+  // a * b + c
+  static inline Vec Fma(Vec a, Vec b, Vec c) {
+#ifdef __aarch64__
+    return vfmaq_f32(c, a, b);
+#else
+    return vmlaq_f32(c, a, b);
+#endif
+  }
+  static inline Vec Div(Vec a, Vec b) {
+#ifdef __aarch64__
+    return vdivq_f32(a, b);
+#else
+    // reciprocal estimate refined by two Newton-Raphson steps
+    float32x4_t r = vrecpeq_f32(b);
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    return vmulq_f32(a, r);
+#endif
+  }
+  static inline Vec Max(Vec a, Vec b) { return vmaxq_f32(a, b); }
+  static inline Vec Min(Vec a, Vec b) { return vminq_f32(a, b); }
+  // to the nearest integer, ties to even on armv8 and away from zero before
+  static inline Vec Round(Vec v) {
+#ifdef __aarch64__
+    return vrndnq_f32(v);
+#else
+    const uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(v),
+                                      vdupq_n_u32(0x80000000));
+    const float32x4_t half = vreinterpretq_f32_u32(
+        vorrq_u32(vreinterpretq_u32_f32(vdupq_n_f32(0.5f)), sign));
+    return vcvtq_f32_s32(vcvtq_s32_f32(vaddq_f32(v, half)));
+#endif
+  }
+  // v * 2^n for integral n in [-126, 127]
+  static inline Vec Ldexp(Vec v, Vec n) {
+    const int32x4_t e = vaddq_s32(vcvtq_s32_f32(n), vdupq_n_s32(127));
+    return vmulq_f32(v, vreinterpretq_f32_s32(vshlq_n_s32(e, 23)));
+  }
+  // z * 2^k = v with z in [sqrt(0.5), sqrt(2)), for positive normal v
+  static inline Vec Frexp(Vec v, Vec *k) {
+    const int32x4_t bits = vreinterpretq_s32_f32(v);
+    const int32x4_t offset = vsubq_s32(bits, vdupq_n_s32(0x3f3504f3));
+    *k = vcvtq_f32_s32(vshrq_n_s32(offset, 23));
+    return vreinterpretq_f32_s32(vsubq_s32(
+        bits, vandq_s32(offset, vdupq_n_s32(~0x7fffff))));
+  }
+  // a < b ? x : y
+  static inline Vec SelectLess(Vec a, Vec b, Vec x, Vec y) {
+    return vbslq_f32(vcltq_f32(a, b), x, y);
+  }
+};
+
 }  // namespace arm
 }  // namespace ops
 }  // namespace mace
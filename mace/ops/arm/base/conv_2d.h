@@ -20,7 +20,9 @@
 
 #include "mace/core/ops/op_context.h"
 #include "mace/core/tensor.h"
+#include "mace/ops/arm/base/common_neon.h"
 #include "mace/ops/arm/base/gemm.h"
+#include "mace/ops/common/apply_epilogue.h"
 #include "mace/ops/common/conv_pool_2d_util.h"
 #include "mace/ops/delegator/conv_2d.h"
 #include "mace/public/mace.h"
@@ -106,6 +108,8 @@ class Conv2dBase : public delegator::Conv2d {
 
   virtual ~Conv2dBase() = default;
 
+  bool FusesEpilogue() const override { return true; }
+
  protected:
   void CalOutputShapeAndInputPadSize(const std::vector<index_t> &input_shape,
                                      const std::vector<index_t> &filter_shape,
@@ -142,6 +146,33 @@ class Conv2dBase : public delegator::Conv2d {
                 Tensor *dst);
   void UnPadOutput(const Tensor &src, Tensor *dst);
 
+  // Applies epilogue_ to the valid region of `out_tensor`, the possibly
+  // padded output, one plane per task before it is unpadded. Float planes
+  // go through NEON, the others through scalar code.
+  template<typename T>
+  void ApplyEpilogueToOutput(const OpContext *context,
+                             const std::vector<index_t> &out_shape,
+                             Tensor *out_tensor) {
+    if (epilogue_.empty()) {
+      return;
+    }
+    T *out_data = out_tensor->mutable_data<T>();
+    const index_t padded_width = out_tensor->dim(3);
+    const index_t padded_image_size = out_tensor->dim(2) * padded_width;
+    utils::ThreadPool &thread_pool = context->runtime()->thread_pool();
+    thread_pool.Compute2D([=, &out_shape](index_t start0, index_t end0,
+                                          index_t step0, index_t start1,
+                                          index_t end1, index_t step1) {
+      for (index_t b = start0; b < end0; b += step0) {
+        for (index_t c = start1; c < end1; c += step1) {
+          ApplyEpilogueToPlane<VecNeon>(
+              epilogue_, out_shape, c, padded_width,
+              out_data + (b * out_shape[1] + c) * padded_image_size);
+        }  // c
+      }  // b
+    }, 0, out_shape[0], 1, 0, out_shape[1], 1);
+  }
+
   ConvComputeParam PreWorkAndGetConv2DParam(
       const OpContext *context, const Tensor *in_tensor, Tensor *out_tensor);
   DepthwiseConvComputeParam PreWorkAndGetDepthwiseConv2DParam(
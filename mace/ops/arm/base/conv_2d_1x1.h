@@ -27,7 +27,7 @@ class Conv2dK1x1 : public Conv2dBase {
  public:
   explicit Conv2dK1x1(const delegator::Conv2dParam &param)
       : Conv2dBase(param, sizeof(T)),
-        gemm_(delegator::GemmParam()) {}
+        gemm_(delegator::GemmParam(false, param.epilogue_)) {}
   virtual ~Conv2dK1x1() {}
 
   MaceStatus Compute(
@@ -36,6 +36,11 @@ class Conv2dK1x1 : public Conv2dBase {
       const Tensor *filter,
       Tensor *output) override;
 
+  bool Prepack(const OpContext *context, const Tensor *filter) override {
+    return gemm_.PrepackLhs(context, filter, filter->dim(0), filter->dim(1),
+                            RowMajor);
+  }
+
  private:
   Gemm<T> gemm_;
 };
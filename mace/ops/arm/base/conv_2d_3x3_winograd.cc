@@ -227,6 +227,7 @@ MaceStatus Conv2dK3x3Winograd<T>::Compute(const OpContext *context,
       break;
     default:MACE_NOT_IMPLEMENTED;
   }
+  ApplyEpilogueToOutput<T>(context, output->shape(), padded_out);
   UnPadOutput(*padded_out, output);
 
   return MaceStatus::MACE_SUCCESS;
@@ -51,6 +51,7 @@ MaceStatus Conv2dGeneral<T>::Compute(const OpContext *context,
 
   DoCompute(p, filter_data, input_data, output_data, filter_shape);
 
+  ApplyEpilogueToOutput<T>(context, output->shape(), out_tensor);
   UnPadOutput(*out_tensor, output);
   return MaceStatus::MACE_SUCCESS;
 }
@@ -62,6 +62,7 @@ class Conv2dKMxN : public Conv2dBase {
 
     DoCompute(p, filter_data, input_data, output_data);
 
+    ApplyEpilogueToOutput<T>(context, output->shape(), out_tensor);
     UnPadOutput(*out_tensor, output);
     return MaceStatus::MACE_SUCCESS;
   }
@@ -45,6 +45,7 @@ class DepthwiseConv2dKMxN : public Conv2dBase {
 
     DoCompute(p, filter_data, input_data, output_data);
 
+    ApplyEpilogueToOutput<T>(context, output->shape(), output);
     return MaceStatus::MACE_SUCCESS;
   }
 
@@ -15,14 +15,26 @@
 #include "mace/ops/arm/base/gemm.h"
 
 #include <algorithm>
+#include <string>
 #include <utility>
 
+#include "mace/core/workspace.h"
 #include "mace/ops/arm/base/common_neon.h"
+#include "mace/ops/common/apply_epilogue.h"
 
 namespace mace {
 namespace ops {
 namespace arm {
 
+namespace {
+#ifdef __aarch64__
+constexpr index_t kRowBlockSize = 8;
+#else
+constexpr index_t kRowBlockSize = 4;
+#endif
+constexpr index_t kDepthBlockSize = 4;
+}  // namespace
+
 template<typename T>
 void Gemm<T>::Pack4x4(const MatrixMap<const T> &matrix,
                       MatrixMajor dst_major, T *packed_matrix) {
@@ -502,6 +514,50 @@ void Gemm<T>::PackLhs(const MatrixMap<const T> &lhs, T *packed_lhs) {
 #endif
 }
 
+template<typename T>
+void Gemm<T>::PackLhsBlocks(const OpContext *context,
+                            const MatrixMap<const T> &lhs,
+                            const index_t depth_padded,
+                            T *packed_lhs) {
+  const index_t rows = lhs.rows();
+  const index_t depth = lhs.cols();
+  const index_t row_block_size = kRowBlockSize;
+  utils::ThreadPool &thread_pool = context->runtime()->thread_pool();
+  thread_pool.Compute1D([=, &lhs](index_t start, index_t end, index_t step) {
+    for (index_t row_block_idx = start; row_block_idx < end;
+         row_block_idx += step) {
+      const index_t start_row = row_block_idx * row_block_size;
+      const index_t row_block_len = std::min(row_block_size, rows - start_row);
+      PackLhs(lhs.block(start_row, 0, row_block_len, depth),
+              packed_lhs + row_block_idx * row_block_size * depth_padded);
+    }
+  }, 0, RoundUpDiv(rows, row_block_size), 1);
+}
+
+template<typename T>
+bool Gemm<T>::PrepackLhs(const OpContext *context, const Tensor *lhs,
+                         const index_t rows, const index_t depth,
+                         const MatrixMajor lhs_major) {
+  if (!lhs->is_weight()) {
+    return false;
+  }
+  const index_t depth_padded = RoundUp(depth, kDepthBlockSize);
+  const MatrixMap<const T> lhs_matrix(lhs->data<T>(), lhs_major, rows, depth);
+  const std::string key = MakeString(lhs->name(), "/arm_gemm_lhs_",
+                                     kRowBlockSize, "x", kDepthBlockSize, "_",
+                                     lhs_major, "_", rows, "x", depth);
+  pack_cache_ = LoadOrPackWeight(
+      context->workspace()->packed_weight_cache(), context->runtime(), key,
+      DataTypeToEnum<T>::value,
+      {RoundUp(rows, kRowBlockSize) * depth_padded},
+      [&](void *packed) {
+        PackLhsBlocks(context, lhs_matrix, depth_padded,
+                      static_cast<T *>(packed));
+      });
+  cached_ = kCacheLhs;
+  return true;
+}
+
 template<typename T>
 void Gemm<T>::PackRhs(const MatrixMap<const T> &rhs, T *packed_rhs) {
   Pack8x4(rhs, RowMajor, packed_rhs);
@@ -525,17 +581,15 @@ MaceStatus Gemm<T>::Compute(
     const bool lhs_batched, const bool rhs_batched, Tensor *output) {
   MACE_CHECK(output->size() == batch * rows * cols,
              "Need resize output tensor before call gemm.");
+  MACE_CHECK(epilogue_.empty() || output_major == RowMajor,
+             "Gemm epilogue needs a row-major output");
   const T *lhs_data = lhs->data<T>();
   const T *rhs_data = rhs->data<T>();
   T *output_data = output->mutable_data<T>();
 
-#ifdef __aarch64__
-  const index_t row_block_size = 8;
-#else
-  const index_t row_block_size = 4;
-#endif
+  const index_t row_block_size = kRowBlockSize;
   const index_t col_block_size = 8;
-  const index_t depth_block_size = 4;
+  const index_t depth_block_size = kDepthBlockSize;
   const index_t row_block_count = RoundUpDiv(rows, row_block_size);
   const index_t col_block_count = RoundUpDiv(cols, col_block_size);
   const index_t rows_padded = RoundUp(rows, row_block_size);
@@ -559,10 +613,14 @@ MaceStatus Gemm<T>::Compute(
 
   int cache_side = kNoCache;
   if (cached_ == kCacheLhs) {
+    MACE_CHECK(pack_cache_->size() == rows_padded * depth_padded,
+               "Packed lhs does not match the gemm shape");
     packed_lhs_data = pack_cache_->mutable_data<T>();
   } else if (cached_ == kCacheRhs) {
     packed_rhs_data = pack_cache_->mutable_data<T>();
   } else if (should_cache_pack_) {
+    pack_cache_.reset(new Tensor(runtime, DataTypeToEnum<T>::value,
+                                 output->memory_type()));
     if (lhs->is_weight() && (!lhs_batched || batch == 1)) {
       cache_side = kCacheLhs;
       pack_cache_->Resize({packed_lhs_buffer->size()});
@@ -595,20 +653,7 @@ MaceStatus Gemm<T>::Compute(
 
     // pack lhs
     if (cached_ != kCacheLhs) {
-      thread_pool.Compute1D([=, &lhs_matrix](index_t start,
-                                             index_t end,
-                                             index_t step) {
-        for (index_t row_block_idx = start; row_block_idx < end;
-             row_block_idx += step) {
-          const index_t start_row = row_block_idx * row_block_size;
-          const index_t
-              row_block_len = std::min(row_block_size, rows - start_row);
-          T *packed_lhs_data_block =
-              packed_lhs_data + row_block_idx * row_block_size * depth_padded;
-          PackLhs(lhs_matrix.block(start_row, 0, row_block_len, depth),
-                  packed_lhs_data_block);
-        }
-      }, 0, row_block_count, 1);
+      PackLhsBlocks(context, lhs_matrix, depth_padded, packed_lhs_data);
 
       if (cache_side == kCacheLhs) {
         cached_ = kCacheLhs;
@@ -674,6 +719,14 @@ MaceStatus Gemm<T>::Compute(
                                                           row_block_len,
                                                           col_block_len);
           UnpackOutput(packed_output_data_block, &output_block);
+          // finish the block while it is still in L1
+          if (!epilogue_.empty()) {
+            for (index_t r = 0; r < row_block_len; ++r) {
+              const index_t row = start_row + r;
+              ApplyEpilogue<VecNeon>(epilogue_, row, col_block_len,
+                                     output_block.data(r, 0));
+            }  // r
+          }
         }  // col_block_idx
       }  // row_block_idx
     }, 0, row_block_count, 1);
@@ -18,6 +18,7 @@
 #include <memory>
 
 #include "mace/core/ops/op_context.h"
+#include "mace/core/packed_weight_cache.h"
 #include "mace/core/tensor.h"
 #include "mace/ops/common/matrix.h"
 #include "mace/ops/delegator/gemm.h"
@@ -98,6 +99,12 @@ class Gemm : public delegator::Gemm {
                    output);
   }
 
+  bool PrepackLhs(const OpContext *context,
+                  const Tensor *lhs,
+                  const index_t rows,
+                  const index_t depth,
+                  const MatrixMajor lhs_major) override;
+
  protected:
   void ComputeBlock(const T *packed_lhs_data,
                     const T *packed_rhs_data,
@@ -107,6 +114,12 @@ class Gemm : public delegator::Gemm {
   void PackLhs(const MatrixMap<const T> &lhs,
                T *packed_lhs);
 
+  // Packs all the row blocks of `lhs`, `depth_padded` apart.
+  void PackLhsBlocks(const OpContext *context,
+                     const MatrixMap<const T> &lhs,
+                     const index_t depth_padded,
+                     T *packed_lhs);
+
   void PackRhs(const MatrixMap<const T> &rhs,
                T *packed_rhs);
 
@@ -124,7 +137,7 @@ class Gemm : public delegator::Gemm {
                T *packed_matrix);
 
  private:
-  std::unique_ptr<Buffer> pack_cache_;
+  std::unique_ptr<Tensor> pack_cache_;
   bool should_cache_pack_;
   int cached_;
 };
@@ -21,7 +21,7 @@ namespace arm {
 
 void RegisterGemvDelegator(OpDelegatorRegistry *registry) {
   MACE_REGISTER_DELEGATOR(
-      registry, Gemv<float>, DelegatorParam,
+      registry, Gemv<float>, delegator::GemvParam,
       MACE_DELEGATOR_KEY(Gemv, RuntimeType::RT_CPU, float, ImplType::NEON));
 }
 
@@ -27,7 +27,8 @@ namespace arm {
 template<typename T>
 class Gemv : public delegator::Gemv {
  public:
-  explicit Gemv(const DelegatorParam &param) : delegator::Gemv(param) {}
+  explicit Gemv(const delegator::GemvParam &param)
+      : delegator::Gemv(param) {}
   ~Gemv() {}
   // Always row-major after transpose
   MaceStatus Compute(
@@ -571,6 +571,21 @@ void Gemm<float16_t>::ComputeBlock(const float16_t *packed_lhs_data,
   }
 }
 
+// fp16 packs the lhs with its own block sizes in Compute, keep it lazy.
+template<>
+bool Gemm<float16_t>::PrepackLhs(const OpContext *context,
+                                 const Tensor *lhs,
+                                 const index_t rows,
+                                 const index_t depth,
+                                 const MatrixMajor lhs_major) {
+  MACE_UNUSED(context);
+  MACE_UNUSED(lhs);
+  MACE_UNUSED(rows);
+  MACE_UNUSED(depth);
+  MACE_UNUSED(lhs_major);
+  return false;
+}
+
 template<>
 MaceStatus Gemm<float16_t>::Compute(const OpContext *context,
                                     const Tensor *lhs,
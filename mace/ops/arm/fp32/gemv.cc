@@ -15,7 +15,10 @@
 #include <arm_neon.h>
 #include <algorithm>
 
+#include "mace/core/compressed_weight.h"
+#include "mace/ops/arm/base/common_neon.h"
 #include "mace/ops/arm/base/gemv.h"
+#include "mace/ops/common/apply_epilogue.h"
 #include "mace/utils/math.h"
 
 #if !defined(__aarch64__)
@@ -49,7 +52,10 @@ MaceStatus Gemv<float>::Compute(const OpContext *context,
   MACE_CHECK(output->size() == batch * lhs_height,
              "Need resize output tensor before call gemv.");
 
-  const float *lhs_data = lhs->data<float>();
+  // the rows of a compressed weight are converted block by block, an
+  // unbatched block once for all the batches of a tile
+  const bool compressed = IsCompressedWeight(lhs);
+  const float *lhs_data = compressed ? nullptr : lhs->data<float>();
   const float *rhs_data = rhs->data<float>();
   const float *bias_data = nullptr;
   if (bias) {
@@ -67,22 +73,32 @@ MaceStatus Gemv<float>::Compute(const OpContext *context,
 
   thread_pool.Compute2D([=](index_t start0, index_t end0, index_t step0,
                             index_t start1, index_t end1, index_t step1) {
-    for (index_t b = start0; b < end0; b += step0) {
-      for (index_t h_block_idx = start1; h_block_idx < end1;
-           h_block_idx += step1) {
-        const index_t h_start = h_block_idx * h_block_size;
-        const float
-            *lhs_ptr = lhs_data
-            + static_cast<index_t>(lhs_batched) * b * lhs_height * lhs_width
+    float *lhs_buf =
+        compressed ? DecompressScratch(h_block_size * lhs_width) : nullptr;
+    for (index_t h_block_idx = start0; h_block_idx < end0;
+         h_block_idx += step0) {
+      const index_t h_start = h_block_idx * h_block_size;
+      const index_t h_block_len =
+          std::min(h_block_size, lhs_height - h_start);
+      for (index_t b = start1; b < end1; b += step1) {
+        const index_t lhs_offset =
+            static_cast<index_t>(lhs_batched) * b * lhs_height * lhs_width
             + lhs_width * h_start;
+        const float *lhs_ptr = nullptr;
+        if (compressed) {
+          if (lhs_batched || b == start1) {
+            DecompressWeight(lhs, lhs_offset, h_block_len * lhs_width,
+                             lhs_buf);
+          }
+          lhs_ptr = lhs_buf;
+        } else {
+          lhs_ptr = lhs_data + lhs_offset;
+        }
         const float *rhs_ptr =
             rhs_data + static_cast<index_t>(rhs_batched) * b * lhs_width;
         float
             *ret_ptr = output_data + b * lhs_height + h_start;
 
-        const index_t h_block_len =
-            std::min(h_block_size, lhs_height - h_start);
-
 #ifdef MACE_GEMV_UNROLL
         if (h_block_len == 4) {
         float32x4_t vo0 = vdupq_n_f32(0);
@@ -359,9 +375,12 @@ MaceStatus Gemv<float>::Compute(const OpContext *context,
 #ifdef MACE_GEMV_UNROLL
         }  // if
 #endif  // MACE_GEMV_UNROLL
-      }  // h_block_idx
-    }  // b
-  }, 0, batch, 1, 0, h_block_count, 1);
+        if (!epilogue_.empty()) {
+          ApplyEpilogue<VecNeon>(epilogue_, h_start, h_block_len, ret_ptr);
+        }
+      }  // b
+    }  // h_block_idx
+  }, 0, h_block_count, 1, 0, batch, 1);
 
   return MaceStatus::MACE_SUCCESS;
 }
@@ -0,0 +1,127 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <arm_neon.h>
+
+#include "mace/ops/common/q8_conv_2d.h"
+#include "mace/ops/common/q8_gemm.h"
+#include "mace/utils/cpu_isa.h"
+
+namespace mace {
+namespace ops {
+namespace arm {
+namespace q8 {
+
+#if defined(__aarch64__)
+
+// udot by element: acc[i] += dot(rhs[4i..4i+3], lhs[4lane..4lane+3]).
+// Written in asm to build without -march=armv8.2-a+dotprod, it is only
+// executed after HostHasArmDotProduct().
+#define MACE_Q8_UDOT(acc, rhs, lhs, lane)                     \
+  asm(".arch_extension dotprod\n"                             \
+      "udot %0.4s, %1.16b, %2.4b[" #lane "]"                  \
+      : "+w"(acc) : "w"(rhs), "w"(lhs))
+
+// 8 x 8 tile of the ARMv8.2 dot product instructions.
+struct GemmKernelDotProd {
+  static constexpr index_t kRows = 8;
+  static constexpr index_t kCols = 8;
+  static constexpr int32_t kRhsOffset = 0;
+
+  static void Run(const uint8_t *packed_lhs,
+                  const uint8_t *packed_rhs,
+                  const index_t depth_groups,
+                  int32_t *tile) {
+    uint32x4_t c[kRows][2];
+    for (index_t r = 0; r < kRows; ++r) {
+      c[r][0] = vdupq_n_u32(0);
+      c[r][1] = vdupq_n_u32(0);
+    }
+
+    for (index_t g = 0; g < depth_groups; ++g) {
+      const uint8x16_t a0 = vld1q_u8(packed_lhs);
+      const uint8x16_t a1 = vld1q_u8(packed_lhs + 16);
+      const uint8x16_t b0 = vld1q_u8(packed_rhs);
+      const uint8x16_t b1 = vld1q_u8(packed_rhs + 16);
+
+#define MACE_Q8_GEMM_DOT_ROW(r, a, lane)        \
+      MACE_Q8_UDOT(c[r][0], b0, a, lane);       \
+      MACE_Q8_UDOT(c[r][1], b1, a, lane)
+
+      MACE_Q8_GEMM_DOT_ROW(0, a0, 0);
+      MACE_Q8_GEMM_DOT_ROW(1, a0, 1);
+      MACE_Q8_GEMM_DOT_ROW(2, a0, 2);
+      MACE_Q8_GEMM_DOT_ROW(3, a0, 3);
+      MACE_Q8_GEMM_DOT_ROW(4, a1, 0);
+      MACE_Q8_GEMM_DOT_ROW(5, a1, 1);
+      MACE_Q8_GEMM_DOT_ROW(6, a1, 2);
+      MACE_Q8_GEMM_DOT_ROW(7, a1, 3);
+
+#undef MACE_Q8_GEMM_DOT_ROW
+
+      packed_lhs += kRows * ops::q8::kGemmDepthGroup;
+      packed_rhs += kCols * ops::q8::kGemmDepthGroup;
+    }  // g
+
+    for (index_t r = 0; r < kRows; ++r) {
+      vst1q_s32(tile + r * kCols, vreinterpretq_s32_u32(c[r][0]));
+      vst1q_s32(tile + r * kCols + 4, vreinterpretq_s32_u32(c[r][1]));
+    }
+  }
+};
+
+#undef MACE_Q8_UDOT
+
+typedef ops::q8::Gemm<GemmKernelDotProd, uint8_t> GemmUint8;
+typedef ops::q8::Gemm<GemmKernelDotProd, int32_t> GemmInt32;
+typedef ops::q8::Conv2d<GemmKernelDotProd> Conv2dUint8;
+
+#endif  // __aarch64__
+
+// Without the dot product instructions the portable gemm registered under
+// ImplType::REF is used.
+void RegisterGemmDelegator(OpDelegatorRegistry *registry) {
+#if defined(__aarch64__)
+  if (utils::HostHasArmDotProduct()) {
+    MACE_REGISTER_DELEGATOR(
+        registry, GemmUint8, delegator::GemmParam,
+        MACE_DELEGATOR_KEY(Gemm, RuntimeType::RT_CPU, uint8_t,
+                           ImplType::NEON));
+    MACE_REGISTER_DELEGATOR(
+        registry, GemmInt32, delegator::GemmParam,
+        MACE_DELEGATOR_KEY(Gemm, RuntimeType::RT_CPU, int32_t,
+                           ImplType::NEON));
+  }
+#else
+  MACE_UNUSED(registry);
+#endif  // __aarch64__
+}
+
+void RegisterConv2dDelegator(OpDelegatorRegistry *registry) {
+#if defined(__aarch64__)
+  if (utils::HostHasArmDotProduct()) {
+    MACE_REGISTER_DELEGATOR(
+        registry, Conv2dUint8, delegator::Conv2dParam,
+        MACE_DELEGATOR_KEY(Conv2d, RuntimeType::RT_CPU, uint8_t,
+                           ImplType::NEON));
+  }
+#else
+  MACE_UNUSED(registry);
+#endif  // __aarch64__
+}
+
+}  // namespace q8
+}  // namespace arm
+}  // namespace ops
+}  // namespace mace
@@ -172,10 +172,10 @@ MaceStatus Gemv<OUTPUT_TYPE>::Compute(const OpContext *context,
 
 void RegisterGemvDelegator(OpDelegatorRegistry *registry) {
   MACE_REGISTER_DELEGATOR(
-      registry, Gemv<uint8_t>, DelegatorParam,
+      registry, Gemv<uint8_t>, delegator::GemvParam,
       MACE_DELEGATOR_KEY(Gemv, RuntimeType::RT_CPU, uint8_t, ImplType::NEON));
   MACE_REGISTER_DELEGATOR(
-      registry, Gemv<int32_t>, DelegatorParam,
+      registry, Gemv<int32_t>, delegator::GemvParam,
       MACE_DELEGATOR_KEY(Gemv, RuntimeType::RT_CPU, int32_t, ImplType::NEON));
 }
 
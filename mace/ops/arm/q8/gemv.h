@@ -25,7 +25,7 @@ namespace q8 {
 template<typename OUTPUT_TYPE>
 class Gemv : public delegator::Gemv {
  public:
-  explicit Gemv(const DelegatorParam &param)
+  explicit Gemv(const delegator::GemvParam &param)
       : delegator::Gemv(param), is_output_type_uint8_(
       DataTypeToEnum<OUTPUT_TYPE>::value == DataType::DT_UINT8) {}
   ~Gemv() {}
@@ -0,0 +1,365 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include "mace/core/memory/external_buffer.h"
+#include "mace/core/ops/operator.h"
+#include "mace/core/registry/ops_registry.h"
+#include "mace/core/tensor.h"
+#include "mace/core/workspace.h"
+#include "mace/ops/delegator/gemm.h"
+#include "mace/ops/delegator/vector_math.h"
+#include "mace/utils/memory.h"
+
+namespace mace {
+namespace ops {
+
+namespace {
+// rows of queries and keys per tile, the scores of a tile take 64KB
+constexpr index_t kQueryTileSize = 128;
+constexpr index_t kKeyTileSize = 128;
+
+// Points `tile` to `data` of `shape`, to pass the tiles of the inputs and
+// of the scratch to the Gemm delegator.
+void MapTile(const float *data, const std::vector<index_t> &shape,
+             Tensor *tile) {
+  void *ptr = const_cast<float *>(data);
+  auto buffer = std::make_shared<ExternalBuffer>(
+      MemoryType::CPU_BUFFER, DT_FLOAT, shape, ptr);
+  buffer->SetHost(ptr);
+  tile->SwapBuffer(buffer);
+  tile->Reshape(shape);
+}
+}  // namespace
+
+template<RuntimeType D, class T>
+class AttentionOp;
+
+// output = softmax(scale * Q x K^T + mask) x V over the last two dims, the
+// others are batch dims. The keys are visited in tiles with an online
+// softmax: the running max and sum of each query row rescale what was
+// accumulated for the previous tiles, so the scores are never kept for more
+// than one tile of queries and keys.
+template<>
+class AttentionOp<RuntimeType::RT_CPU, float> : public Operation {
+ public:
+  explicit AttentionOp(OpConstructContext *context)
+      : Operation(context),
+        scale_(Operation::GetOptionalArg<float>("scale", 0.f)),
+        causal_(Operation::GetOptionalArg<bool>("causal", false)),
+        transpose_k_(Operation::GetOptionalArg<bool>("transpose_k", false)),
+        gemm_(delegator::Gemm::Create(
+            context->workspace(),
+            MACE_DELEGATOR_KEY(Gemm, RuntimeType::RT_CPU, float,
+                               kCpuImplType),
+            delegator::GemmParam())),
+        vector_math_(delegator::VectorMath::Create(
+            context->workspace(),
+            MACE_DELEGATOR_KEY(VectorMath, RuntimeType::RT_CPU, float,
+                               kCpuImplType),
+            DelegatorParam())) {}
+
+  // The keys and values may be states of KVCacheAppend, see LiveLength().
+  bool ReadsStates() const override {
+    return true;
+  }
+
+  MaceStatus Run(OpContext *context) override {
+    const Tensor *query = this->Input(QUERY);
+    const Tensor *key = this->Input(KEY);
+    const Tensor *value = this->Input(VALUE);
+    const Tensor *mask = this->InputSize() > MASK ? this->Input(MASK) : nullptr;
+    Tensor *output = this->Output(OUTPUT);
+
+    const index_t rank = query->dim_size();
+    MACE_CHECK(rank >= 2 && key->dim_size() == rank &&
+                   value->dim_size() == rank,
+               "Attention needs query, key and value of the same rank >= 2");
+    for (index_t i = 0; i < rank - 2; ++i) {
+      MACE_CHECK(key->dim(i) == query->dim(i) &&
+                     value->dim(i) == query->dim(i),
+                 "batch dimensions are not equal: ",
+                 MakeString(query->shape()), ", ", MakeString(key->shape()),
+                 ", ", MakeString(value->shape()));
+    }
+    const index_t q_len = query->dim(rank - 2);
+    const index_t depth = query->dim(rank - 1);
+    const index_t key_rows = key->dim(transpose_k_ ? rank - 2 : rank - 1);
+    const index_t value_rows = value->dim(rank - 2);
+    Workspace *ws = context->workspace();
+    const index_t k_len =
+        LiveLength(ws, key, transpose_k_ ? rank - 2 : rank - 1);
+    const index_t v_len = LiveLength(ws, value, rank - 2);
+    const index_t k_depth = key->dim(transpose_k_ ? rank - 1 : rank - 2);
+    MACE_CHECK(k_depth == depth, "the depth of query ", depth,
+               " must be equal to the depth of key ", k_depth);
+    MACE_CHECK(v_len == k_len, "the length of value ", v_len,
+               " must be equal to the length of key ", k_len);
+    const index_t v_depth = value->dim(rank - 1);
+    const index_t batch = std::accumulate(query->shape().begin(),
+                                          query->shape().end() - 2, 1,
+                                          std::multiplies<index_t>());
+
+    std::vector<index_t> output_shape = query->shape();
+    output_shape[rank - 1] = v_depth;
+    MACE_RETURN_IF_ERROR(output->Resize(output_shape));
+
+    std::vector<index_t> scores_shape = query->shape();
+    scores_shape[rank - 1] = k_len;
+    std::vector<index_t> mask_strides(rank, 0);
+    std::vector<index_t> mask_offsets(batch, 0);
+    if (mask != nullptr) {
+      MaskStrides(mask, scores_shape, &mask_strides);
+      for (index_t b = 0; b < batch; ++b) {
+        index_t index = b;
+        for (index_t i = rank - 3; i >= 0; --i) {
+          mask_offsets[b] += index % scores_shape[i] * mask_strides[i];
+          index /= scores_shape[i];
+        }
+      }
+    }
+
+    const index_t q_tile_size = std::min(q_len, kQueryTileSize);
+    const index_t k_tile_size = std::min(k_len, kKeyTileSize);
+    Runtime *runtime = context->runtime();
+    if (scratch_ == nullptr) {
+      scratch_ = make_unique<Tensor>(runtime, DT_FLOAT,
+                                     MemoryType::CPU_BUFFER);
+    }
+    // scores, products with the values, running max, sum and rescaling of
+    // the rows, their sums over a tile, and the packed keys when they are not
+    // transposed
+    MACE_RETURN_IF_ERROR(scratch_->Resize(
+        {q_tile_size * (k_tile_size + v_depth + 4) +
+            (transpose_k_ ? 0 : depth * k_tile_size)}));
+    float *scores = scratch_->mutable_data<float>();
+    float *partial = scores + q_tile_size * k_tile_size;
+    float *row_max = partial + q_tile_size * v_depth;
+    float *row_sum = row_max + q_tile_size;
+    float *row_scale = row_sum + q_tile_size;
+    float *tile_sum = row_scale + q_tile_size;
+    float *packed_key = tile_sum + q_tile_size;
+
+    const float *query_data = query->data<float>();
+    const float *key_data = key->data<float>();
+    const float *value_data = value->data<float>();
+    const float *mask_data = mask == nullptr ? nullptr : mask->data<float>();
+    float *output_data = output->mutable_data<float>();
+    const float scale =
+        scale_ != 0.f ? scale_ : 1.f / std::sqrt(static_cast<float>(depth));
+    // with a causal mask, query i sees the keys up to i + causal_offset,
+    // i.e. the last query sees all keys like when decoding with a cache
+    const index_t causal_offset = k_len - q_len;
+
+    Tensor query_tile(runtime, DT_FLOAT, MemoryType::CPU_BUFFER);
+    Tensor key_tile(runtime, DT_FLOAT, MemoryType::CPU_BUFFER);
+    Tensor value_tile(runtime, DT_FLOAT, MemoryType::CPU_BUFFER);
+    Tensor scores_tile(runtime, DT_FLOAT, MemoryType::CPU_BUFFER);
+    Tensor output_tile(runtime, DT_FLOAT, MemoryType::CPU_BUFFER);
+    utils::ThreadPool &thread_pool = runtime->thread_pool();
+    const float lowest = -std::numeric_limits<float>::infinity();
+    const index_t mask_row_stride = mask_strides[rank - 2];
+    const index_t mask_col_stride = mask_strides[rank - 1];
+
+    for (index_t b = 0; b < batch; ++b) {
+      const float *query_b = query_data + b * q_len * depth;
+      const float *key_b = key_data + b * key_rows * depth;
+      const float *value_b = value_data + b * value_rows * v_depth;
+      float *output_b = output_data + b * q_len * v_depth;
+      for (index_t q0 = 0; q0 < q_len; q0 += q_tile_size) {
+        const index_t q_size = std::min(q_tile_size, q_len - q0);
+        float *output_q = output_b + q0 * v_depth;
+        const index_t k_end = causal_ ?
+            std::max<index_t>(0, std::min(k_len, q0 + q_size + causal_offset))
+            : k_len;
+        if (k_end == 0) {
+          std::fill_n(output_q, q_size * v_depth, 0.f);
+          continue;
+        }
+        std::fill_n(row_max, q_size, lowest);
+        std::fill_n(row_sum, q_size, 0.f);
+        MapTile(query_b + q0 * depth, {q_size, depth}, &query_tile);
+
+        for (index_t k0 = 0; k0 < k_end; k0 += k_tile_size) {
+          const index_t k_size = std::min(k_tile_size, k_end - k0);
+          // scores = Q x K^T of the tile
+          if (transpose_k_) {
+            MapTile(key_b + k0 * depth, {k_size, depth}, &key_tile);
+          } else {
+            for (index_t d = 0; d < depth; ++d) {
+              std::copy_n(key_b + d * key_rows + k0, k_size,
+                          packed_key + d * k_size);
+            }
+            MapTile(packed_key, {depth, k_size}, &key_tile);
+          }
+          MapTile(scores, {q_size, k_size}, &scores_tile);
+          // the delegator rents its packing buffers for each call, give them
+          // back before they pile up over the tiles
+          runtime->ReleaseAllBuffer(RENT_SCRATCH);
+          MACE_RETURN_IF_ERROR(gemm_->Compute(
+              context, &query_tile, &key_tile, 1, q_size, k_size, depth,
+              RowMajor, transpose_k_ ? ColMajor : RowMajor, RowMajor,
+              false, false, &scores_tile));
+
+          // scores = exp(scale * scores + mask - max) with the max of the rows
+          // updated, row_scale is the log of the rescaling of their sums
+          const float *mask_b =
+              mask_data == nullptr ? nullptr : mask_data + mask_offsets[b];
+          thread_pool.Compute1D([=](index_t start, index_t end, index_t step) {
+            for (index_t i = start; i < end; i += step) {
+              float *scores_row = scores + i * k_size;
+              const index_t q = q0 + i;
+              const index_t row_end =
+                  causal_ ? std::min(k_size, q + causal_offset + 1 - k0)
+                          : k_size;
+              float max = row_max[i];
+              for (index_t j = 0; j < row_end; ++j) {
+                float score = scores_row[j] * scale;
+                if (mask_b != nullptr) {
+                  score += mask_b[q * mask_row_stride +
+                                  (k0 + j) * mask_col_stride];
+                }
+                scores_row[j] = score;
+                max = std::max(max, score);
+              }
+              if (max == lowest) {
+                // all keys so far are masked out
+                std::fill_n(scores_row, k_size, 0.f);
+                row_scale[i] = 0.f;
+                tile_sum[i] = 0.f;
+                continue;
+              }
+              for (index_t j = 0; j < row_end; ++j) {
+                scores_row[j] -= max;
+              }
+              if (row_end > 0) {
+                vector_math_->Exp(scores_row, row_end, scores_row);
+              }
+              float sum = 0.f;
+              for (index_t j = 0; j < row_end; ++j) {
+                sum += scores_row[j];
+              }
+              for (index_t j = std::max<index_t>(row_end, 0); j < k_size;
+                   ++j) {
+                scores_row[j] = 0.f;
+              }
+              row_scale[i] = row_max[i] - max;
+              tile_sum[i] = sum;
+              row_max[i] = max;
+            }
+          }, 0, q_size, 1);
+          vector_math_->Exp(row_scale, q_size, row_scale);
+          for (index_t i = 0; i < q_size; ++i) {
+            row_sum[i] = row_sum[i] * row_scale[i] + tile_sum[i];
+          }
+
+          // output = output * rescaling + scores x V of the tile, the first
+          // tile is written to the output directly
+          MapTile(value_b + k0 * v_depth, {k_size, v_depth}, &value_tile);
+          MapTile(k0 == 0 ? output_q : partial, {q_size, v_depth},
+                  &output_tile);
+          runtime->ReleaseAllBuffer(RENT_SCRATCH);
+          MACE_RETURN_IF_ERROR(gemm_->Compute(
+              context, &scores_tile, &value_tile, 1, q_size, v_depth, k_size,
+              RowMajor, RowMajor, RowMajor, false, false, &output_tile));
+          if (k0 == 0) {
+            continue;
+          }
+          thread_pool.Compute1D([=](index_t start, index_t end, index_t step) {
+            for (index_t i = start; i < end; i += step) {
+              float *output_row = output_q + i * v_depth;
+              const float *partial_row = partial + i * v_depth;
+              const float row_scale_i = row_scale[i];
+              for (index_t j = 0; j < v_depth; ++j) {
+                output_row[j] = output_row[j] * row_scale_i + partial_row[j];
+              }
+            }
+          }, 0, q_size, 1);
+        }
+
+        // fully masked rows are 0
+        thread_pool.Compute1D([=](index_t start, index_t end, index_t step) {
+          for (index_t i = start; i < end; i += step) {
+            float *output_row = output_q + i * v_depth;
+            const float inv_sum = row_sum[i] > 0.f ? 1.f / row_sum[i] : 0.f;
+            for (index_t j = 0; j < v_depth; ++j) {
+              output_row[j] *= inv_sum;
+            }
+          }
+        }, 0, q_size, 1);
+      }
+    }
+
+    return MaceStatus::MACE_SUCCESS;
+  }
+
+ private:
+  // The keys and values appended to a state by KVCacheAppend take its
+  // capacity along `dim`, of which only the first StateLength() are live.
+  index_t LiveLength(const Workspace *ws, const Tensor *tensor,
+                     const index_t dim) {
+    if (!tensor->is_state()) {
+      return tensor->dim(dim);
+    }
+    MACE_CHECK(ws->StateAxis(tensor->name(), tensor->dim_size()) == dim,
+               "State ", tensor->name(), " should grow along dim ", dim);
+    return ws->StateLength(tensor->name());
+  }
+
+  // Element strides of the mask in the dims of the scores, 0 where it is
+  // broadcast. The shape of the mask is aligned to the back of the scores.
+  void MaskStrides(const Tensor *mask,
+                   const std::vector<index_t> &scores_shape,
+                   std::vector<index_t> *strides) {
+    const index_t rank = static_cast<index_t>(scores_shape.size());
+    const index_t rank_diff = rank - mask->dim_size();
+    MACE_CHECK(rank_diff >= 0, "the rank of mask ", mask->dim_size(),
+               " is larger than the rank of scores ", rank);
+    strides->resize(rank);
+    index_t stride = 1;
+    for (index_t i = rank - 1; i >= 0; --i) {
+      const index_t dim = i < rank_diff ? 1 : mask->dim(i - rank_diff);
+      MACE_CHECK(dim == 1 || dim == scores_shape[i], "Can not broadcast mask ",
+                 MakeString(mask->shape()), " to scores ",
+                 MakeString(scores_shape));
+      (*strides)[i] = dim == 1 ? 0 : stride;
+      stride *= dim;
+    }
+  }
+
+  float scale_;
+  bool causal_;
+  bool transpose_k_;
+  std::unique_ptr<delegator::Gemm> gemm_;
+  std::unique_ptr<delegator::VectorMath> vector_math_;
+  std::unique_ptr<Tensor> scratch_;
+
+  MACE_OP_INPUT_TAGS(QUERY, KEY, VALUE, MASK);
+  MACE_OP_OUTPUT_TAGS(OUTPUT);
+};
+
+void RegisterAttention(OpRegistry *op_registry) {
+  MACE_REGISTER_OP(op_registry, "Attention", AttentionOp,
+                   RuntimeType::RT_CPU, float);
+}
+
+}  // namespace ops
+}  // namespace mace
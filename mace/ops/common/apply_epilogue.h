@@ -0,0 +1,201 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_COMMON_APPLY_EPILOGUE_H_
+#define MACE_OPS_COMMON_APPLY_EPILOGUE_H_
+
+#include <vector>
+
+#include "mace/ops/common/epilogue.h"
+#include "mace/ops/common/vector_math.h"
+
+// Applies an Epilogue to the outputs of a delegator a vector of the traits V
+// at a time: VecNeon on ARM, the traits of the ISA for x86 kernels, which
+// include this header inside their target region, and vector_math::VecRef
+// for the reference delegators. Outputs of types other than float go
+// through VecRef.
+
+namespace mace {
+namespace ops {
+
+template<class V>
+struct EpilogueBias {
+  typedef typename V::Vec Vec;
+  EpilogueBias(const Epilogue &epilogue, const float bias)
+      : bias(V::Set1(bias)) {
+    MACE_UNUSED(epilogue);
+  }
+  Vec operator()(const Vec x) const { return V::Add(x, bias); }
+  const Vec bias;
+};
+
+template<class V>
+struct EpilogueRelu : EpilogueBias<V> {
+  typedef typename V::Vec Vec;
+  EpilogueRelu(const Epilogue &epilogue, const float bias)
+      : EpilogueBias<V>(epilogue, bias) {}
+  Vec operator()(const Vec x) const {
+    return V::Max(V::Add(x, this->bias), V::Zero());
+  }
+};
+
+template<class V>
+struct EpilogueRelux : EpilogueBias<V> {
+  typedef typename V::Vec Vec;
+  EpilogueRelux(const Epilogue &epilogue, const float bias)
+      : EpilogueBias<V>(epilogue, bias), limit(V::Set1(epilogue.max_limit)) {}
+  Vec operator()(const Vec x) const {
+    return V::Min(V::Max(V::Add(x, this->bias), V::Zero()), limit);
+  }
+  const Vec limit;
+};
+
+template<class V>
+struct EpilogueLeakyRelu : EpilogueBias<V> {
+  typedef typename V::Vec Vec;
+  EpilogueLeakyRelu(const Epilogue &epilogue, const float bias)
+      : EpilogueBias<V>(epilogue, bias),
+        coefficient(V::Set1(epilogue.activation_coefficient)) {}
+  Vec operator()(const Vec x) const {
+    const Vec y = V::Add(x, this->bias);
+    return V::Fma(V::Min(y, V::Zero()), coefficient, V::Max(y, V::Zero()));
+  }
+  const Vec coefficient;
+};
+
+template<class V>
+struct EpilogueTanh : EpilogueBias<V> {
+  typedef typename V::Vec Vec;
+  EpilogueTanh(const Epilogue &epilogue, const float bias)
+      : EpilogueBias<V>(epilogue, bias) {}
+  Vec operator()(const Vec x) const {
+    return vector_math::Tanh<V>(V::Add(x, this->bias));
+  }
+};
+
+template<class V>
+struct EpilogueSigmoid : EpilogueBias<V> {
+  typedef typename V::Vec Vec;
+  EpilogueSigmoid(const Epilogue &epilogue, const float bias)
+      : EpilogueBias<V>(epilogue, bias) {}
+  Vec operator()(const Vec x) const {
+    return vector_math::Sigmoid<V>(V::Add(x, this->bias));
+  }
+};
+
+template<class V>
+struct EpilogueElu : EpilogueBias<V> {
+  typedef typename V::Vec Vec;
+  EpilogueElu(const Epilogue &epilogue, const float bias)
+      : EpilogueBias<V>(epilogue, bias),
+        alpha(V::Set1(epilogue.activation_coefficient)) {}
+  Vec operator()(const Vec x) const {
+    return vector_math::Elu<V>(V::Add(x, this->bias), alpha);
+  }
+  const Vec alpha;
+};
+
+template<class V>
+struct EpilogueHardSigmoid : EpilogueBias<V> {
+  typedef typename V::Vec Vec;
+  EpilogueHardSigmoid(const Epilogue &epilogue, const float bias)
+      : EpilogueBias<V>(epilogue, bias),
+        alpha(V::Set1(epilogue.hardsigmoid_alpha)),
+        beta(V::Set1(epilogue.hardsigmoid_beta)) {}
+  Vec operator()(const Vec x) const {
+    const Vec y = V::Fma(alpha, V::Add(x, this->bias), beta);
+    return V::Max(V::Min(y, V::Set1(1.f)), V::Zero());
+  }
+  const Vec alpha;
+  const Vec beta;
+};
+
+// Runs Func<V> over output[0, size) in place.
+template<class V, template<class> class Func>
+inline void MapEpilogue(const Epilogue &epilogue, const float bias,
+                        const index_t size, float *output) {
+  vector_math::Map<V>(output, size, output, Func<V>(epilogue, bias));
+}
+
+template<class V, template<class> class Func, typename T>
+inline void MapEpilogue(const Epilogue &epilogue, const float bias,
+                        const index_t size, T *output) {
+  const Func<vector_math::VecRef> func(epilogue, bias);
+  for (index_t i = 0; i < size; ++i) {
+    output[i] = func(static_cast<float>(output[i]));
+  }
+}
+
+// Applies `epilogue` to `size` contiguous outputs of `channel`.
+template<class V, typename T>
+void ApplyEpilogue(const Epilogue &epilogue, const index_t channel,
+                   const index_t size, T *output) {
+  const float bias = epilogue.bias == nullptr ?
+                     0.f : epilogue.bias->data<T>()[channel];
+  switch (epilogue.activation) {
+    case NOOP:
+      if (epilogue.bias != nullptr) {
+        MapEpilogue<V, EpilogueBias>(epilogue, bias, size, output);
+      }
+      break;
+    case RELU:
+      MapEpilogue<V, EpilogueRelu>(epilogue, bias, size, output);
+      break;
+    case RELUX:
+      MapEpilogue<V, EpilogueRelux>(epilogue, bias, size, output);
+      break;
+    case LEAKYRELU:
+      MapEpilogue<V, EpilogueLeakyRelu>(epilogue, bias, size, output);
+      break;
+    case TANH:
+      MapEpilogue<V, EpilogueTanh>(epilogue, bias, size, output);
+      break;
+    case SIGMOID:
+      MapEpilogue<V, EpilogueSigmoid>(epilogue, bias, size, output);
+      break;
+    case ELU:
+      MapEpilogue<V, EpilogueElu>(epilogue, bias, size, output);
+      break;
+    case HARDSIGMOID:
+      MapEpilogue<V, EpilogueHardSigmoid>(epilogue, bias, size, output);
+      break;
+    default:
+      LOG(FATAL) << "Unsupported epilogue activation: "
+                 << epilogue.activation;
+  }
+}
+
+// Applies `epilogue` to the plane of `channel` of an NCHW output of `shape`.
+// `data` points at the plane, whose rows are `row_stride` apart, which is
+// larger than the width for padded outputs.
+template<class V, typename T>
+void ApplyEpilogueToPlane(const Epilogue &epilogue,
+                          const std::vector<index_t> &shape,
+                          const index_t channel, const index_t row_stride,
+                          T *data) {
+  const index_t height = shape[2];
+  const index_t width = shape[3];
+  if (row_stride == width) {
+    ApplyEpilogue<V>(epilogue, channel, height * width, data);
+    return;
+  }
+  for (index_t h = 0; h < height; ++h) {
+    ApplyEpilogue<V>(epilogue, channel, width, data + h * row_stride);
+  }  // h
+}
+
+}  // namespace ops
+}  // namespace mace
+
+#endif  // MACE_OPS_COMMON_APPLY_EPILOGUE_H_
@@ -0,0 +1,83 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/ops/common/broadcast.h"
+
+#include "mace/utils/logging.h"
+
+namespace mace {
+namespace ops {
+
+BroadcastShape CollapseBroadcastShape(
+    const std::vector<index_t> &input0_shape,
+    const std::vector<index_t> &input1_shape,
+    const std::vector<index_t> &output_shape) {
+  const size_t rank = output_shape.size();
+  MACE_CHECK(input0_shape.size() <= rank && input1_shape.size() <= rank);
+  const size_t rank_diff0 = rank - input0_shape.size();
+  const size_t rank_diff1 = rank - input1_shape.size();
+
+  // dims and whether each input is broadcast in them, without the 1s
+  std::vector<index_t> dims;
+  std::vector<bool> broadcast0;
+  std::vector<bool> broadcast1;
+  for (size_t i = 0; i < rank; ++i) {
+    const index_t dim = output_shape[i];
+    const index_t dim0 = i < rank_diff0 ? 1 : input0_shape[i - rank_diff0];
+    const index_t dim1 = i < rank_diff1 ? 1 : input1_shape[i - rank_diff1];
+    MACE_CHECK((dim0 == dim || dim0 == 1) && (dim1 == dim || dim1 == 1),
+               "Can not broadcast ", MakeString(input0_shape), " and ",
+               MakeString(input1_shape), " to ", MakeString(output_shape));
+    if (dim == 1) {
+      continue;
+    }
+    const bool is_broadcast0 = dim0 == 1;
+    const bool is_broadcast1 = dim1 == 1;
+    if (!dims.empty() && broadcast0.back() == is_broadcast0 &&
+        broadcast1.back() == is_broadcast1) {
+      dims.back() *= dim;
+    } else {
+      dims.push_back(dim);
+      broadcast0.push_back(is_broadcast0);
+      broadcast1.push_back(is_broadcast1);
+    }
+  }
+  if (dims.empty()) {
+    dims.push_back(1);
+    broadcast0.push_back(false);
+    broadcast1.push_back(false);
+  }
+
+  BroadcastShape shape;
+  shape.dims = dims;
+  shape.input0_strides.resize(dims.size());
+  shape.input1_strides.resize(dims.size());
+  index_t stride0 = 1;
+  index_t stride1 = 1;
+  for (size_t i = dims.size(); i > 0; --i) {
+    const size_t d = i - 1;
+    shape.input0_strides[d] = broadcast0[d] ? 0 : stride0;
+    shape.input1_strides[d] = broadcast1[d] ? 0 : stride1;
+    if (!broadcast0[d]) {
+      stride0 *= dims[d];
+    }
+    if (!broadcast1[d]) {
+      stride1 *= dims[d];
+    }
+  }
+  return shape;
+}
+
+}  // namespace ops
+}  // namespace mace
@@ -0,0 +1,129 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_COMMON_BROADCAST_H_
+#define MACE_OPS_COMMON_BROADCAST_H_
+
+#include <vector>
+
+#include "mace/core/ops/op_context.h"
+#include "mace/core/types.h"
+#include "mace/utils/thread_pool.h"
+
+namespace mace {
+namespace ops {
+
+// The output of a binary op with broadcast inputs, with the dims of size 1
+// dropped and the neighbouring dims merged where both inputs are either
+// broadcast or not in both of them. E.g. [N,H,W,C] + [1,1,1,C] becomes
+// [N*H*W, C] with strides [C, 1] + [0, 1], while [N,1,W,C] + [1,H,1,C]
+// keeps its 4 dims.
+struct BroadcastShape {
+  std::vector<index_t> dims;
+  // element strides of the inputs in each of `dims`, 0 if broadcast, so the
+  // strides of the last dim are 0 or 1
+  std::vector<index_t> input0_strides;
+  std::vector<index_t> input1_strides;
+};
+
+// The input shapes are aligned to the back of `output_shape`, their dims
+// are either 1 or the dim of the output.
+BroadcastShape CollapseBroadcastShape(
+    const std::vector<index_t> &input0_shape,
+    const std::vector<index_t> &input1_shape,
+    const std::vector<index_t> &output_shape);
+
+// output[i] = op(input0[i], input1[i]) for `count` elements, in which the
+// inputs either advance or stay, written per case so that the compiler
+// vectorizes the loops.
+template<typename T, typename DstType, typename Op>
+inline void BroadcastRun(const T *input0, const index_t input0_stride,
+                         const T *input1, const index_t input1_stride,
+                         const index_t count, DstType *output, Op op) {
+  if (input0_stride == 1 && input1_stride == 1) {
+    for (index_t i = 0; i < count; ++i) {
+      output[i] = op(input0[i], input1[i]);
+    }
+  } else if (input0_stride == 1) {
+    const T value1 = input1[0];
+    for (index_t i = 0; i < count; ++i) {
+      output[i] = op(input0[i], value1);
+    }
+  } else if (input1_stride == 1) {
+    const T value0 = input0[0];
+    for (index_t i = 0; i < count; ++i) {
+      output[i] = op(value0, input1[i]);
+    }
+  } else {
+    const DstType value = op(input0[0], input1[0]);
+    for (index_t i = 0; i < count; ++i) {
+      output[i] = value;
+    }
+  }
+}
+
+// Computes output = op(input0, input1) over `shape`. The rows of the last
+// dim are split over the thread pool, together with the last dim itself
+// when there are few of them.
+template<typename T, typename DstType, typename Op>
+void BroadcastEltwise(const OpContext *context, const BroadcastShape &shape,
+                      const T *input0, const T *input1, DstType *output,
+                      Op op) {
+  const index_t outer_rank = static_cast<index_t>(shape.dims.size()) - 1;
+  const index_t inner_size = shape.dims.back();
+  const index_t inner_stride0 = shape.input0_strides.back();
+  const index_t inner_stride1 = shape.input1_strides.back();
+  index_t rows = 1;
+  for (index_t d = 0; d < outer_rank; ++d) {
+    rows *= shape.dims[d];
+  }
+
+  utils::ThreadPool &thread_pool = context->runtime()->thread_pool();
+  thread_pool.Compute2D([&](index_t start0, index_t end0, index_t step0,
+                            index_t start1, index_t end1, index_t step1) {
+    MACE_UNUSED(step0);
+    MACE_UNUSED(step1);
+    // index and offsets of the first row, then stepped row by row
+    std::vector<index_t> index(outer_rank);
+    index_t offset0 = 0;
+    index_t offset1 = 0;
+    index_t row = start0;
+    for (index_t d = outer_rank - 1; d >= 0; --d) {
+      index[d] = row % shape.dims[d];
+      row /= shape.dims[d];
+      offset0 += index[d] * shape.input0_strides[d];
+      offset1 += index[d] * shape.input1_strides[d];
+    }
+    for (index_t r = start0; r < end0; ++r) {
+      BroadcastRun(input0 + offset0 + start1 * inner_stride0, inner_stride0,
+                   input1 + offset1 + start1 * inner_stride1, inner_stride1,
+                   end1 - start1, output + r * inner_size + start1, op);
+      for (index_t d = outer_rank - 1; d >= 0; --d) {
+        offset0 += shape.input0_strides[d];
+        offset1 += shape.input1_strides[d];
+        if (++index[d] < shape.dims[d]) {
+          break;
+        }
+        offset0 -= shape.input0_strides[d] * shape.dims[d];
+        offset1 -= shape.input1_strides[d] * shape.dims[d];
+        index[d] = 0;
+      }
+    }
+  }, 0, rows, 1, 0, inner_size, 1, 0, 0, 1);
+}
+
+}  // namespace ops
+}  // namespace mace
+
+#endif  // MACE_OPS_COMMON_BROADCAST_H_
@@ -0,0 +1,56 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_COMMON_EPILOGUE_H_
+#define MACE_OPS_COMMON_EPILOGUE_H_
+
+#include "mace/core/tensor.h"
+#include "mace/ops/common/activation_type.h"
+
+namespace mace {
+namespace ops {
+
+// Element-wise tail of a conv/gemm delegator, applied to the output while it
+// is still in cache instead of by separate BiasAdd/Activation passes:
+//   output = activation(output + bias[channel])
+// `bias` holds one value per output channel (per output row for gemm), it is
+// referenced, not owned, and must stay alive as long as the delegator. See
+// apply_epilogue.h for the vectorized application.
+struct Epilogue {
+  Epilogue()
+      : bias(nullptr), activation(NOOP), max_limit(0.f),
+        activation_coefficient(0.f), hardsigmoid_alpha(0.f),
+        hardsigmoid_beta(0.f) {}
+
+  bool empty() const {
+    return bias == nullptr && activation == NOOP;
+  }
+
+  const Tensor *bias;
+  ActivationType activation;
+  float max_limit;
+  float activation_coefficient;
+  float hardsigmoid_alpha;
+  float hardsigmoid_beta;
+};
+
+// PRELU needs a per-channel alpha tensor, which the epilogue does not carry.
+inline bool CanFuseActivation(const ActivationType type) {
+  return type != PRELU;
+}
+
+}  // namespace ops
+}  // namespace mace
+
+#endif  // MACE_OPS_COMMON_EPILOGUE_H_
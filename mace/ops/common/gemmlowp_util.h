@@ -15,14 +15,43 @@
 #ifndef MACE_OPS_COMMON_GEMMLOWP_UTIL_H_
 #define MACE_OPS_COMMON_GEMMLOWP_UTIL_H_
 
+#include <string>
 #include <tuple>
 
 #include "public/gemmlowp.h"
 #include "mace/core/types.h"
 #include "mace/core/quantize.h"
+#include "mace/port/env.h"
+#include "mace/utils/cpu_isa.h"
+#include "mace/utils/string_util.h"
 
 namespace mace {
 
+// Whether the uint8 Conv2D, FullyConnected and MatMul ops go through
+// gemmlowp instead of the quantized gemm delegator. MACE_QUANTIZE_GEMM set to
+// "gemmlowp" or "mace" picks one, by default gemmlowp is only kept on arm
+// CPUs without the dot product instructions, where its NEON kernels are
+// faster than the portable gemm.
+inline bool UseGemmlowp() {
+  std::string gemm;
+  if (GetEnv("MACE_QUANTIZE_GEMM", &gemm) == MaceStatus::MACE_SUCCESS
+      && !gemm.empty()) {
+    gemm = ToLower(gemm);
+    if (gemm == "gemmlowp") {
+      return true;
+    } else if (gemm == "mace") {
+      return false;
+    }
+    LOG(WARNING) << "Unknown MACE_QUANTIZE_GEMM value: " << gemm
+                 << ", expect gemmlowp or mace";
+  }
+#ifdef MACE_ENABLE_NEON
+  return !utils::HostHasArmDotProduct();
+#else
+  return false;
+#endif  // MACE_ENABLE_NEON
+}
+
 struct GemmlowpOutputPipeline {
   typedef gemmlowp::VectorMap<const int32_t, gemmlowp::VectorShape::Col>
       ColVectorMap;
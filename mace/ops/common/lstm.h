@@ -19,15 +19,20 @@
 #ifndef MACE_OPS_COMMON_LSTM_H_
 #define MACE_OPS_COMMON_LSTM_H_
 
+#include <algorithm>
+
 #include "mace/core/ops/op_context.h"
 #include "mace/core/types.h"
+#include "mace/ops/delegator/vector_math.h"
 #include "mace/utils/math.h"
 
 namespace mace {
 namespace ops {
 
+// The gate activations go through `vector_math` a block of cells at a time.
 template <typename T>
 void LSTMNonlinearKernel(const OpContext *context,
+                         delegator::VectorMath *vector_math,
                          const T *input_data,
                          const T *prev_data,
                          const T *scale_data,
@@ -45,42 +50,57 @@ void LSTMNonlinearKernel(const OpContext *context,
       (embed_scales && scale_data) ? static_cast<float>(scale_data[2]) : 1.0f;
 
   utils::ThreadPool &thread_pool = context->runtime()->thread_pool();
+  const index_t block_size = 64;
 
   thread_pool.Compute1D([=](index_t start, index_t end, index_t step) {
-    if (prev_data == nullptr) {
-      for (index_t c = start; c < end; c += step) {
-        float i_part = input_data[c];
-        float c_part = input_data[c + 2 * cell_dim];
-        float o_part = input_data[c + 3 * cell_dim];
-        float w_oc = params_data[c + params_stride * 2];
-        float i_t = ScalarSigmoid(i_part);
-        float c_t = i_t * i_scale * std::tanh(c_part);
-        float o_t = ScalarSigmoid(o_part + w_oc * c_t);
-        float m_t = o_t * o_scale * std::tanh(c_t);
-        output_cell[c] = c_t;
-        output_data[c] = m_t;
+    float i_t[block_size];
+    float f_t[block_size];
+    float c_t[block_size];
+    float o_t[block_size];
+    float tanh_t[block_size];
+    for (index_t b = start; b < end; b += step) {
+      const index_t c_begin = b * block_size;
+      const index_t size = std::min(block_size, cell_dim - c_begin);
+      for (index_t k = 0; k < size; ++k) {
+        const index_t c = c_begin + k;
+        i_t[k] = static_cast<float>(input_data[c]);
+        tanh_t[k] = static_cast<float>(input_data[c + 2 * cell_dim]);
+        if (prev_data != nullptr) {
+          const float c_prev = static_cast<float>(prev_data[c]);
+          const float w_ic = static_cast<float>(params_data[c]);
+          const float w_fc = static_cast<float>(params_data[c + params_stride]);
+          i_t[k] += w_ic * c_prev;
+          f_t[k] = static_cast<float>(input_data[c + cell_dim]) + w_fc * c_prev;
+        }
+      }
+      vector_math->Sigmoid(i_t, size, i_t);
+      vector_math->Tanh(tanh_t, size, tanh_t);
+      if (prev_data != nullptr) {
+        vector_math->Sigmoid(f_t, size, f_t);
+        for (index_t k = 0; k < size; ++k) {
+          c_t[k] = f_t[k] * f_scale * static_cast<float>(prev_data[c_begin + k])
+              + i_t[k] * i_scale * tanh_t[k];
+        }
+      } else {
+        for (index_t k = 0; k < size; ++k) {
+          c_t[k] = i_t[k] * i_scale * tanh_t[k];
+        }
+      }
+      for (index_t k = 0; k < size; ++k) {
+        const index_t c = c_begin + k;
+        const float o_part = static_cast<float>(input_data[c + 3 * cell_dim]);
+        const float w_oc =
+            static_cast<float>(params_data[c + params_stride * 2]);
+        o_t[k] = o_part + w_oc * c_t[k];
       }
-    } else {
-      for (index_t c = start; c < end; c += step) {
-        float i_part = input_data[c];
-        float f_part = input_data[c + cell_dim];
-        float c_part = input_data[c + 2 * cell_dim];
-        float o_part = input_data[c + 3 * cell_dim];
-        float c_prev = prev_data[c];
-        float w_ic = params_data[c];
-        float w_fc = params_data[c + params_stride];
-        float w_oc = params_data[c + params_stride * 2];
-        float i_t = ScalarSigmoid(i_part + w_ic * c_prev);
-        float f_t = ScalarSigmoid(f_part + w_fc * c_prev);
-        float c_t =
-            f_t * f_scale * c_prev + i_t * i_scale * std::tanh(c_part);
-        float o_t = ScalarSigmoid(o_part + w_oc * c_t);
-        float m_t = o_t * o_scale * std::tanh(c_t);
-        output_cell[c] = c_t;
-        output_data[c] = m_t;
+      vector_math->Sigmoid(o_t, size, o_t);
+      vector_math->Tanh(c_t, size, tanh_t);
+      for (index_t k = 0; k < size; ++k) {
+        output_cell[c_begin + k] = c_t[k];
+        output_data[c_begin + k] = o_t[k] * o_scale * tanh_t[k];
       }
     }
-  }, 0, cell_dim, 1);
+  }, 0, RoundUpDiv(cell_dim, block_size), 1);
 }
 
 }  // namespace ops
@@ -0,0 +1,279 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_COMMON_Q8_CONV_2D_H_
+#define MACE_OPS_COMMON_Q8_CONV_2D_H_
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "mace/ops/common/conv_pool_2d_util.h"
+#include "mace/ops/common/q8_gemm.h"
+#include "mace/ops/delegator/conv_2d.h"
+
+// Quantized convolution of an uint8 NHWC input by an uint8 OHWI filter, or an
+// int8 one quantized per output channel, as an implicit gemm with the
+// kernels of common/q8_gemm.h:
+//   filter [out_channels, depth] * im2col [depth, batch * out_h * out_w]
+// where depth = filter_h * filter_w * in_channels. im2col is never built,
+// each task packs the col block it computes straight from the input, so the
+// scratch memory is one block per task instead of depth * columns bytes.
+// Padded taps read the input zero point and dilation only moves the taps, so
+// neither copies the input.
+
+namespace mace {
+namespace ops {
+namespace q8 {
+
+template<class K>
+class Conv2d : public delegator::Conv2d {
+ public:
+  explicit Conv2d(const delegator::Conv2dParam &param)
+      : delegator::Conv2d(param) {
+    CheckEpilogue(epilogue_);
+  }
+  ~Conv2d() {}
+
+  MaceStatus Compute(const OpContext *context,
+                     const Tensor *input,
+                     const Tensor *filter,
+                     Tensor *output) override;
+
+  bool FusesEpilogue() const override { return true; }
+
+  bool Prepack(const OpContext *context, const Tensor *filter) override {
+    PackFilter(context, filter);
+    return true;
+  }
+
+ private:
+  void PackFilter(const OpContext *context, const Tensor *filter);
+
+  // Geometry of the virtual im2col matrix.
+  struct Im2colShape {
+    index_t in_height;
+    index_t in_width;
+    index_t in_channels;
+    index_t out_height;
+    index_t out_width;
+    index_t filter_height;
+    index_t filter_width;
+    index_t stride_height;
+    index_t stride_width;
+    index_t dilation_height;
+    index_t dilation_width;
+    index_t pad_top;
+    index_t pad_left;
+  };
+
+  // Packs the im2col cols [start_col, start_col + block_cols) like PackRhs
+  // and stores their -filter_zero * col_sum in `col_terms`.
+  static void PackInputBlock(const uint8_t *input,
+                             const uint8_t input_zero,
+                             const int32_t filter_zero,
+                             const Im2colShape &shape,
+                             const index_t start_col,
+                             const index_t block_cols,
+                             const index_t depth_padded,
+                             uint8_t *packed,
+                             int32_t *col_terms);
+
+  std::vector<uint8_t> packed_filter_;
+  std::vector<int32_t> filter_sums_;
+  OutputStage output_stage_;
+};
+
+template<class K>
+void Conv2d<K>::PackFilter(const OpContext *context, const Tensor *filter) {
+  const index_t channels = filter->dim(0);
+  const index_t depth = filter->dim(1) * filter->dim(2) * filter->dim(3);
+  const index_t row_block_size = K::kRows;
+  const index_t rows_padded = RoundUp(channels, row_block_size);
+  packed_filter_.resize(rows_padded * RoundUp(depth, kGemmDepthGroup));
+  filter_sums_.resize(rows_padded);
+  MatrixMap<const uint8_t> filter_matrix(filter->data<uint8_t>(), RowMajor,
+                                         channels, depth);
+  PackLhs<K>(context, filter_matrix, filter->dtype() == DT_INT8,
+             packed_filter_.data(), filter_sums_.data());
+}
+
+template<class K>
+void Conv2d<K>::PackInputBlock(const uint8_t *input,
+                               const uint8_t input_zero,
+                               const int32_t filter_zero,
+                               const Im2colShape &shape,
+                               const index_t start_col,
+                               const index_t block_cols,
+                               const index_t depth_padded,
+                               uint8_t *packed,
+                               int32_t *col_terms) {
+  const index_t block_size = K::kCols;
+  const index_t group_stride = block_size * kGemmDepthGroup;
+  const index_t in_channels = shape.in_channels;
+  const uint8_t packed_zero = static_cast<uint8_t>(input_zero - K::kRhsOffset);
+  // the depth padding meets zeros of the filter, any value would do
+  memset(packed, 0, block_size * depth_padded);
+  for (index_t c = 0; c < block_cols; ++c) {
+    const index_t col = start_col + c;
+    const index_t w = col % shape.out_width;
+    const index_t h = (col / shape.out_width) % shape.out_height;
+    const index_t b = col / (shape.out_width * shape.out_height);
+    const index_t ih_begin = h * shape.stride_height - shape.pad_top;
+    const index_t iw_begin = w * shape.stride_width - shape.pad_left;
+    uint8_t *packed_col = packed + c * kGemmDepthGroup;
+    int32_t sum = 0;
+    index_t d = 0;
+    for (index_t kh = 0; kh < shape.filter_height; ++kh) {
+      const index_t ih = ih_begin + kh * shape.dilation_height;
+      for (index_t kw = 0; kw < shape.filter_width; ++kw) {
+        const index_t iw = iw_begin + kw * shape.dilation_width;
+        if (ih < 0 || ih >= shape.in_height || iw < 0
+            || iw >= shape.in_width) {
+          for (index_t i = 0; i < in_channels; ++i, ++d) {
+            packed_col[(d / kGemmDepthGroup) * group_stride
+                + d % kGemmDepthGroup] = packed_zero;
+          }
+          sum += input_zero * static_cast<int32_t>(in_channels);
+          continue;
+        }
+        const uint8_t *in_ptr = input
+            + ((b * shape.in_height + ih) * shape.in_width + iw) * in_channels;
+        for (index_t i = 0; i < in_channels; ++i, ++d) {
+          packed_col[(d / kGemmDepthGroup) * group_stride
+              + d % kGemmDepthGroup] =
+              static_cast<uint8_t>(in_ptr[i] - K::kRhsOffset);
+          sum += in_ptr[i];
+        }  // i
+      }  // kw
+    }  // kh
+    col_terms[c] = -filter_zero * sum;
+  }  // c
+}
+
+template<class K>
+MaceStatus Conv2d<K>::Compute(const OpContext *context,
+                              const Tensor *input,
+                              const Tensor *filter,
+                              Tensor *output) {
+  std::vector<index_t> out_shape(4);
+  std::vector<int> paddings(2);
+  if (paddings_.empty()) {
+    CalcPaddingAndOutputSize(input->shape().data(),
+                             DataFormat::NHWC,
+                             filter->shape().data(),
+                             DataFormat::OHWI,
+                             dilations_.data(),
+                             strides_.data(),
+                             padding_type_,
+                             out_shape.data(),
+                             paddings.data());
+  } else {
+    paddings = paddings_;
+    CalcOutputSize(input->shape().data(),
+                   DataFormat::NHWC,
+                   filter->shape().data(),
+                   DataFormat::OHWI,
+                   paddings_.data(),
+                   dilations_.data(),
+                   strides_.data(),
+                   RoundType::FLOOR,
+                   out_shape.data());
+  }
+  MACE_RETURN_IF_ERROR(output->Resize(out_shape));
+  MACE_CHECK(filter->dim(3) == input->dim(3), filter->dim(3), " != ",
+             input->dim(3));
+
+  Im2colShape shape;
+  shape.in_height = input->dim(1);
+  shape.in_width = input->dim(2);
+  shape.in_channels = input->dim(3);
+  shape.out_height = out_shape[1];
+  shape.out_width = out_shape[2];
+  shape.filter_height = filter->dim(1);
+  shape.filter_width = filter->dim(2);
+  shape.stride_height = strides_[0];
+  shape.stride_width = strides_[1];
+  shape.dilation_height = dilations_[0];
+  shape.dilation_width = dilations_[1];
+  shape.pad_top = paddings[0] >> 1;
+  shape.pad_left = paddings[1] >> 1;
+
+  const index_t channels = out_shape[3];
+  const index_t columns = out_shape[0] * out_shape[1] * out_shape[2];
+  const index_t depth =
+      shape.filter_height * shape.filter_width * shape.in_channels;
+  const index_t depth_padded = RoundUp(depth, kGemmDepthGroup);
+  const index_t depth_groups = depth_padded / kGemmDepthGroup;
+  const index_t row_block_size = K::kRows;
+  const index_t col_block_size = K::kCols;
+  const index_t row_block_count = RoundUpDiv(channels, row_block_size);
+  const index_t col_block_count = RoundUpDiv(columns, col_block_size);
+
+  if (packed_filter_.empty() || !filter->is_weight()) {
+    PackFilter(context, filter);
+  }
+
+  const int32_t input_zero = input->zero_point();
+  const int32_t filter_zero = LhsZeroPoint(filter);
+  output_stage_.Update(filter, input, output, epilogue_, channels, true);
+  const Requantization &requantization = output_stage_.requantization();
+  const std::vector<int32_t> &bias = output_stage_.bias();
+  std::vector<int32_t> row_terms(row_block_count * row_block_size, 0);
+  for (index_t r = 0; r < channels; ++r) {
+    row_terms[r] = bias[r] + (K::kRhsOffset - input_zero) * filter_sums_[r]
+        + static_cast<int32_t>(depth) * filter_zero * input_zero;
+  }
+
+  const uint8_t *input_data = input->data<uint8_t>();
+  const uint8_t *packed_filter = packed_filter_.data();
+  const int32_t *row_terms_data = row_terms.data();
+  MatrixMap<uint8_t> output_matrix(output->mutable_data<uint8_t>(), ColMajor,
+                                   channels, columns);
+
+  utils::ThreadPool &thread_pool = context->runtime()->thread_pool();
+  thread_pool.Compute1D([=, &output_matrix, &requantization, &shape](
+      index_t start, index_t end, index_t step) {
+    std::vector<uint8_t> packed_input(col_block_size * depth_padded);
+    std::vector<int32_t> col_terms(col_block_size);
+    int32_t tile[K::kRows * K::kCols];
+    for (index_t col_block = start; col_block < end; col_block += step) {
+      const index_t start_col = col_block * col_block_size;
+      const index_t block_cols = std::min(col_block_size, columns - start_col);
+      PackInputBlock(input_data, static_cast<uint8_t>(input_zero),
+                     filter_zero, shape, start_col, block_cols, depth_padded,
+                     packed_input.data(), col_terms.data());
+      for (index_t row_block = 0; row_block < row_block_count; ++row_block) {
+        const index_t start_row = row_block * row_block_size;
+        const index_t block_rows = std::min(row_block_size,
+                                            channels - start_row);
+        K::Run(packed_filter + start_row * depth_padded, packed_input.data(),
+               depth_groups, tile);
+        MatrixMap<uint8_t> output_block = output_matrix.block(
+            start_row, start_col, block_rows, block_cols);
+        StoreTile<K>(requantization, start_row, tile,
+                     row_terms_data + start_row, col_terms.data(),
+                     &output_block);
+      }  // row_block
+    }  // col_block
+  }, 0, col_block_count, 1);
+
+  return MaceStatus::MACE_SUCCESS;
+}
+
+}  // namespace q8
+}  // namespace ops
+}  // namespace mace
+
+#endif  // MACE_OPS_COMMON_Q8_CONV_2D_H_
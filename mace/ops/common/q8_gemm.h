@@ -0,0 +1,545 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_COMMON_Q8_GEMM_H_
+#define MACE_OPS_COMMON_Q8_GEMM_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "mace/core/ops/op_context.h"
+#include "mace/core/quantize.h"
+#include "mace/core/tensor.h"
+#include "mace/ops/common/matrix.h"
+#include "mace/ops/delegator/gemm.h"
+#include "mace/utils/math.h"
+
+// Quantized matrix multiplication of uint8 matrices with per tensor zero
+// points, accumulated in int32, without gemmlowp. The kernel K only computes
+//   acc(r, c) = sum_d lhs(r, d) * (rhs(d, c) - K::kRhsOffset)
+// on packed blocks, the zero points are folded in afterwards with the row
+// sums of lhs and the column sums of rhs:
+//   sum_d (lhs - lz) * (rhs - rz) = acc + (kRhsOffset - rz) * row_sum(r)
+//                                   - lz * col_sum(c) + depth * lz * rz
+// An int32 output gets this plus the epilogue bias, an uint8 output is
+// requantized to its scale and zero point and clamped by RELU/RELUX.
+//
+// A kernel provides:
+//   kRows, kCols: its register tile of kRows lhs rows by kCols rhs cols.
+//   kRhsOffset: subtracted from rhs while packing, 128 for the kernels which
+//     read rhs as int8 (x86 VNNI), 0 otherwise.
+//   Run(packed_lhs, packed_rhs, depth_groups, tile): computes the
+//     kRows x kCols row-major int32 tile. The packed blocks store the depth
+//     in groups of kGemmDepthGroup, a group holds kGemmDepthGroup consecutive
+//     depth values of each row (lhs) or col (rhs) in turn, zero padded.
+//
+// The epilogue bias is an int32 tensor with one value per output row,
+// scaled by lhs_scale * rhs_scale (rescaled otherwise).
+//
+// lhs may also be an int8 weight quantized symmetrically, with one scale per
+// row (Tensor::scales(), per output channel) or per tensor. Its values are
+// packed as w + 128, which is w as an uint8 of zero point 128, so that the
+// kernels and the sums above apply unchanged, and each row is requantized
+// with its own scale.
+
+namespace mace {
+namespace ops {
+namespace q8 {
+
+constexpr index_t kGemmDepthGroup = 4;
+// The zero point of an int8 lhs once packed, see PackLhs.
+constexpr int32_t kInt8LhsZero = 128;
+
+// Checks that `epilogue` only holds what the quantized gemm fuses.
+inline void CheckEpilogue(const Epilogue &epilogue) {
+  MACE_CHECK(epilogue.activation == NOOP || epilogue.activation == RELU
+                 || epilogue.activation == RELUX,
+             "Quantized gemm only fuses RELU and RELUX");
+}
+
+// The zero point of `lhs` as packed by PackLhs.
+inline int32_t LhsZeroPoint(const Tensor *lhs) {
+  if (lhs->dtype() == DT_INT8) {
+    MACE_CHECK(lhs->zero_point() == 0, "int8 weight ", lhs->name(),
+               " should be quantized symmetrically");
+    return kInt8LhsZero;
+  }
+  return lhs->zero_point();
+}
+
+// The scale of the int32 accumulators of each of the `rows` rows.
+inline std::vector<float> GetAccumulatorScales(const Tensor *lhs,
+                                               const Tensor *rhs,
+                                               const index_t rows) {
+  const std::vector<float> &lhs_scales = lhs->scales();
+  if (lhs->dtype() != DT_INT8 || lhs_scales.empty()) {
+    return std::vector<float>(rows, lhs->scale() * rhs->scale());
+  }
+  MACE_CHECK(static_cast<index_t>(lhs_scales.size()) == rows, "int8 weight ",
+             lhs->name(), " has ", lhs_scales.size(), " scales for ", rows,
+             " rows");
+  std::vector<float> scales(rows);
+  for (index_t r = 0; r < rows; ++r) {
+    scales[r] = lhs_scales[r] * rhs->scale();
+  }
+  return scales;
+}
+
+// Requantization of the int32 accumulators of each row, of the scales
+// `acc_scales`, to an uint8 `output`, clamped by the RELU/RELUX of
+// `epilogue`.
+struct Requantization {
+  Requantization() : zero(0), min(0), max(255) {}
+
+  void Init(const std::vector<float> &acc_scales, const Tensor *output,
+            const Epilogue &epilogue) {
+    MACE_CHECK(output->scale() > 0, "output scale must not be zero");
+    const size_t rows = acc_scales.size();
+    multipliers.resize(rows);
+    exponents.resize(rows);
+    for (size_t r = 0; r < rows; ++r) {
+      QuantizeMultiplier(acc_scales[r] / output->scale(), &multipliers[r],
+                         &exponents[r]);
+    }
+    zero = output->zero_point();
+    min = 0;
+    max = 255;
+    if (epilogue.activation == RELU || epilogue.activation == RELUX) {
+      min = std::max(min, zero);
+    }
+    if (epilogue.activation == RELUX) {
+      max = std::min(max, zero + static_cast<int32_t>(
+          std::roundf(epilogue.max_limit / output->scale())));
+    }
+  }
+
+  uint8_t operator()(const int32_t value, const index_t row) const {
+    const int32_t quantized = zero + MultiplyByQuantizedMultiplier(
+        value, multipliers[row], exponents[row]);
+    return static_cast<uint8_t>(std::max(min, std::min(max, quantized)));
+  }
+
+  std::vector<int32_t> multipliers;
+  std::vector<int32_t> exponents;
+  int32_t zero;
+  int32_t min;
+  int32_t max;
+};
+
+// The epilogue bias of each row in the scale of its accumulators.
+inline std::vector<int32_t> GetAccumulatorBias(
+    const Epilogue &epilogue, const std::vector<float> &acc_scales) {
+  const index_t rows = static_cast<index_t>(acc_scales.size());
+  std::vector<int32_t> bias(rows, 0);
+  if (epilogue.bias != nullptr) {
+    const Tensor *bias_tensor = epilogue.bias;
+    MACE_CHECK(bias_tensor->size() == rows, "bias size ", bias_tensor->size(),
+               " does not match gemm rows ", rows);
+    const int32_t *bias_data = bias_tensor->data<int32_t>();
+    const std::vector<float> &bias_scales = bias_tensor->scales();
+    for (index_t r = 0; r < rows; ++r) {
+      const float acc_scale = acc_scales[r];
+      const float bias_scale =
+          bias_scales.empty() ? bias_tensor->scale() : bias_scales[r];
+      const bool adjust_bias = bias_scale > 0 && acc_scale > 0
+          && std::fabs(acc_scale - bias_scale) > 1e-6f * acc_scale;
+      bias[r] = adjust_bias ? static_cast<int32_t>(
+          std::roundf(bias_data[r] * bias_scale / acc_scale)) : bias_data[r];
+    }
+  }
+  return bias;
+}
+
+// The per row bias and requantization of a gemm. They only depend on the
+// scales and the output zero point, so the delegators keep them across runs
+// and Update() only recomputes them when one of those changed.
+class OutputStage {
+ public:
+  OutputStage()
+      : lhs_(nullptr), lhs_scale_(0.f), rhs_scale_(0.f), output_scale_(0.f),
+        output_zero_(0) {}
+
+  void Update(const Tensor *lhs, const Tensor *rhs, const Tensor *output,
+              const Epilogue &epilogue, const index_t rows,
+              const bool requantize) {
+    if (lhs == lhs_ && lhs->scale() == lhs_scale_
+        && rhs->scale() == rhs_scale_ && output->scale() == output_scale_
+        && output->zero_point() == output_zero_
+        && static_cast<index_t>(bias_.size()) == rows) {
+      return;
+    }
+    lhs_ = lhs;
+    lhs_scale_ = lhs->scale();
+    rhs_scale_ = rhs->scale();
+    output_scale_ = output->scale();
+    output_zero_ = output->zero_point();
+    const std::vector<float> acc_scales =
+        GetAccumulatorScales(lhs, rhs, rows);
+    bias_ = GetAccumulatorBias(epilogue, acc_scales);
+    if (requantize) {
+      requantization_.Init(acc_scales, output, epilogue);
+    }
+  }
+
+  const Requantization &requantization() const { return requantization_; }
+  const std::vector<int32_t> &bias() const { return bias_; }
+
+ private:
+  Requantization requantization_;
+  std::vector<int32_t> bias_;
+  const Tensor *lhs_;
+  float lhs_scale_;
+  float rhs_scale_;
+  float output_scale_;
+  int32_t output_zero_;
+};
+
+// Packs all the row blocks of lhs and sums their rows. `lhs_int8` tells that
+// lhs holds int8 values, which are packed as uint8 of zero point
+// kInt8LhsZero.
+template<class K>
+void PackLhs(const OpContext *context,
+             const MatrixMap<const uint8_t> &lhs,
+             const bool lhs_int8,
+             uint8_t *packed_lhs,
+             int32_t *row_sums) {
+  const index_t rows = lhs.rows();
+  const index_t depth = lhs.cols();
+  const index_t block_size = K::kRows;
+  const index_t depth_padded = RoundUp(depth, kGemmDepthGroup);
+  const uint8_t offset = lhs_int8 ? static_cast<uint8_t>(kInt8LhsZero) : 0;
+  utils::ThreadPool &thread_pool = context->runtime()->thread_pool();
+  thread_pool.Compute1D([=, &lhs](index_t start, index_t end, index_t step) {
+    for (index_t block = start; block < end; block += step) {
+      const index_t start_row = block * block_size;
+      const index_t block_rows = std::min(block_size, rows - start_row);
+      uint8_t *packed = packed_lhs + start_row * depth_padded;
+      memset(packed, 0, block_size * depth_padded);
+      for (index_t r = 0; r < block_rows; ++r) {
+        const uint8_t *data = lhs.data(start_row + r, 0);
+        const index_t depth_stride = lhs.cols_stride();
+        int32_t sum = 0;
+        for (index_t d = 0; d < depth; ++d) {
+          const uint8_t value =
+              static_cast<uint8_t>(data[d * depth_stride] + offset);
+          packed[(d / kGemmDepthGroup) * block_size * kGemmDepthGroup
+              + r * kGemmDepthGroup + d % kGemmDepthGroup] = value;
+          sum += value;
+        }  // d
+        row_sums[start_row + r] = sum;
+      }  // r
+    }  // block
+  }, 0, RoundUpDiv(rows, block_size), 1);
+}
+
+// Packs all the col blocks of rhs and sums their cols.
+template<class K>
+void PackRhs(const OpContext *context,
+             const MatrixMap<const uint8_t> &rhs,
+             uint8_t *packed_rhs,
+             int32_t *col_sums) {
+  const index_t depth = rhs.rows();
+  const index_t cols = rhs.cols();
+  const index_t block_size = K::kCols;
+  const index_t depth_padded = RoundUp(depth, kGemmDepthGroup);
+  utils::ThreadPool &thread_pool = context->runtime()->thread_pool();
+  thread_pool.Compute1D([=, &rhs](index_t start, index_t end, index_t step) {
+    for (index_t block = start; block < end; block += step) {
+      const index_t start_col = block * block_size;
+      const index_t block_cols = std::min(block_size, cols - start_col);
+      uint8_t *packed = packed_rhs + start_col * depth_padded;
+      // the depth padding meets zeros of lhs, any value would do
+      memset(packed, 0, block_size * depth_padded);
+      for (index_t c = 0; c < block_cols; ++c) {
+        const uint8_t *data = rhs.data(0, start_col + c);
+        const index_t depth_stride = rhs.rows_stride();
+        int32_t sum = 0;
+        for (index_t d = 0; d < depth; ++d) {
+          const uint8_t value = data[d * depth_stride];
+          packed[(d / kGemmDepthGroup) * block_size * kGemmDepthGroup
+              + c * kGemmDepthGroup + d % kGemmDepthGroup] =
+              static_cast<uint8_t>(value - K::kRhsOffset);
+          sum += value;
+        }  // d
+        col_sums[start_col + c] = sum;
+      }  // c
+    }  // block
+  }, 0, RoundUpDiv(cols, block_size), 1);
+}
+
+// Adds the row and col terms to the kernel `tile`, requantizes it for an
+// uint8 output and stores the part inside `output`, which starts at row
+// `start_row` of the gemm.
+template<class K, typename OUTPUT_TYPE>
+void StoreTile(const Requantization &requantization,
+               const index_t start_row,
+               const int32_t *tile,
+               const int32_t *row_terms,
+               const int32_t *col_terms,
+               MatrixMap<OUTPUT_TYPE> *output) {
+  const index_t rows = output->rows();
+  const index_t cols = output->cols();
+  const bool requantize = DataTypeToEnum<OUTPUT_TYPE>::value == DT_UINT8;
+  for (index_t r = 0; r < rows; ++r) {
+    for (index_t c = 0; c < cols; ++c) {
+      const int32_t value = tile[r * K::kCols + c] + row_terms[r]
+          + col_terms[c];
+      if (requantize) {
+        *output->data(r, c) =
+            static_cast<OUTPUT_TYPE>(requantization(value, start_row + r));
+      } else {
+        *output->data(r, c) = static_cast<OUTPUT_TYPE>(value);
+      }
+    }  // c
+  }  // r
+}
+
+template<class K, typename OUTPUT_TYPE>
+class Gemm : public delegator::Gemm {
+ public:
+  explicit Gemm(const delegator::GemmParam &param)
+      : delegator::Gemm(param),
+        should_cache_pack_(param.should_cache_pack_),
+        cached_(kNoCache) {
+    CheckEpilogue(epilogue_);
+  }
+  ~Gemm() {}
+
+  MaceStatus Compute(
+      const OpContext *context,
+      const Tensor *lhs,
+      const Tensor *rhs,
+      const index_t batch,
+      const index_t rows,
+      const index_t cols,
+      const index_t depth,
+      const MatrixMajor lhs_major,
+      const MatrixMajor rhs_major,
+      const MatrixMajor output_major,
+      const bool lhs_batched,
+      const bool rhs_batched,
+      Tensor *output) override;
+
+  // Original matrix before transpose has row-major
+  MaceStatus Compute(
+      const OpContext *context,
+      const Tensor *lhs,
+      const Tensor *rhs,
+      const index_t batch,
+      const index_t lhs_rows,
+      const index_t lhs_cols,
+      const index_t rhs_rows,
+      const index_t rhs_cols,
+      const bool transpose_lhs,
+      const bool transpose_rhs,
+      const bool transpose_out,
+      const bool lhs_batched,
+      const bool rhs_batched,
+      Tensor *output) override {
+    index_t rows = transpose_lhs ? lhs_cols : lhs_rows;
+    index_t depth = transpose_lhs ? lhs_rows : lhs_cols;
+    index_t cols = transpose_rhs ? rhs_rows : rhs_cols;
+    index_t depth2 = transpose_rhs ? rhs_cols : rhs_rows;
+    MACE_CHECK(depth == depth2,
+               "Matrices that multiply have inconsistent depth dim: ",
+               depth,
+               " vs. ",
+               depth2);
+
+    return Compute(context,
+                   lhs,
+                   rhs,
+                   batch,
+                   rows,
+                   cols,
+                   depth,
+                   transpose_lhs ? ColMajor : RowMajor,
+                   transpose_rhs ? ColMajor : RowMajor,
+                   transpose_out ? ColMajor : RowMajor,
+                   lhs_batched,
+                   rhs_batched,
+                   output);
+  }
+
+ private:
+  enum { kNoCache, kCacheLhs, kCacheRhs };
+
+  std::vector<uint8_t> packed_cache_;
+  std::vector<int32_t> sums_cache_;
+  bool should_cache_pack_;
+  int cached_;
+  OutputStage output_stage_;
+};
+
+template<class K, typename OUTPUT_TYPE>
+MaceStatus Gemm<K, OUTPUT_TYPE>::Compute(
+    const OpContext *context, const Tensor *lhs, const Tensor *rhs,
+    const index_t batch, const index_t rows, const index_t cols,
+    const index_t depth, const MatrixMajor lhs_major,
+    const MatrixMajor rhs_major, const MatrixMajor output_major,
+    const bool lhs_batched, const bool rhs_batched, Tensor *output) {
+  MACE_CHECK(output->size() == batch * rows * cols,
+             "Need resize output tensor before call gemm.");
+  const uint8_t *lhs_data = lhs->data<uint8_t>();
+  const uint8_t *rhs_data = rhs->data<uint8_t>();
+  OUTPUT_TYPE *output_data = output->mutable_data<OUTPUT_TYPE>();
+
+  const bool lhs_int8 = lhs->dtype() == DT_INT8;
+  const int32_t lhs_zero = LhsZeroPoint(lhs);
+  const int32_t rhs_zero = rhs->zero_point();
+  output_stage_.Update(lhs, rhs, output, epilogue_, rows,
+                       DataTypeToEnum<OUTPUT_TYPE>::value == DT_UINT8);
+  const Requantization &requantization = output_stage_.requantization();
+
+  // Per row: bias + (kRhsOffset - rz) * row_sum + depth * lz * rz, per col:
+  // -lz * col_sum.
+  const std::vector<int32_t> &bias = output_stage_.bias();
+
+  const index_t row_block_size = K::kRows;
+  const index_t col_block_size = K::kCols;
+  const index_t row_block_count = RoundUpDiv(rows, row_block_size);
+  const index_t col_block_count = RoundUpDiv(cols, col_block_size);
+  const index_t rows_padded = row_block_count * row_block_size;
+  const index_t cols_padded = col_block_count * col_block_size;
+  const index_t depth_padded = RoundUp(depth, kGemmDepthGroup);
+  const index_t depth_groups = depth_padded / kGemmDepthGroup;
+
+  auto *runtime = context->runtime();
+  MemInfo mem_info(output->memory_type(), DataType::DT_UINT8,
+                   {rows_padded * depth_padded});
+  auto packed_lhs_buffer = runtime->ObtainBuffer(mem_info, RENT_SCRATCH);
+  mem_info.dims = {depth_padded * cols_padded};
+  auto packed_rhs_buffer = runtime->ObtainBuffer(mem_info, RENT_SCRATCH);
+  mem_info.data_type = DataType::DT_INT32;
+  mem_info.dims = {rows_padded + cols_padded};
+  auto sums_buffer = runtime->ObtainBuffer(mem_info, RENT_SCRATCH);
+
+  uint8_t *packed_lhs_data = packed_lhs_buffer->mutable_data<uint8_t>();
+  uint8_t *packed_rhs_data = packed_rhs_buffer->mutable_data<uint8_t>();
+  int32_t *row_sums = sums_buffer->mutable_data<int32_t>();
+  int32_t *col_sums = row_sums + rows_padded;
+
+  // A constant, unbatched side is packed once and kept with its sums.
+  int cache_side = kNoCache;
+  if (cached_ == kCacheLhs) {
+    MACE_CHECK(static_cast<index_t>(packed_cache_.size())
+                   == rows_padded * depth_padded,
+               "Packed lhs does not match the gemm shape");
+    packed_lhs_data = packed_cache_.data();
+    row_sums = sums_cache_.data();
+  } else if (cached_ == kCacheRhs) {
+    MACE_CHECK(static_cast<index_t>(packed_cache_.size())
+                   == depth_padded * cols_padded,
+               "Packed rhs does not match the gemm shape");
+    packed_rhs_data = packed_cache_.data();
+    col_sums = sums_cache_.data();
+  } else if (should_cache_pack_) {
+    if (lhs->is_weight() && (!lhs_batched || batch == 1)) {
+      cache_side = kCacheLhs;
+      packed_cache_.resize(rows_padded * depth_padded);
+      sums_cache_.resize(rows_padded);
+      packed_lhs_data = packed_cache_.data();
+      row_sums = sums_cache_.data();
+    } else if (rhs->is_weight() && (!rhs_batched || batch == 1)) {
+      cache_side = kCacheRhs;
+      packed_cache_.resize(depth_padded * cols_padded);
+      sums_cache_.resize(cols_padded);
+      packed_rhs_data = packed_cache_.data();
+      col_sums = sums_cache_.data();
+    }
+  }
+
+  std::vector<int32_t> row_terms(rows_padded, 0);
+  std::vector<int32_t> col_terms(cols_padded, 0);
+  utils::ThreadPool &thread_pool = context->runtime()->thread_pool();
+
+  for (index_t b = 0; b < batch; ++b) {
+    MatrixMap<const uint8_t>
+        lhs_matrix
+        (lhs_data + static_cast<index_t>(lhs_batched) * b * rows * depth,
+         lhs_major,
+         rows,
+         depth);
+    MatrixMap<const uint8_t>
+        rhs_matrix
+        (rhs_data + static_cast<index_t>(rhs_batched) * b * depth * cols,
+         rhs_major,
+         depth,
+         cols);
+    MatrixMap<OUTPUT_TYPE> output_matrix
+        (output_data + b * rows * cols, output_major, rows, cols);
+
+    if (cached_ != kCacheLhs) {
+      PackLhs<K>(context, lhs_matrix, lhs_int8, packed_lhs_data, row_sums);
+      if (cache_side == kCacheLhs) {
+        cached_ = kCacheLhs;
+      }
+    }
+    if (cached_ != kCacheRhs) {
+      PackRhs<K>(context, rhs_matrix, packed_rhs_data, col_sums);
+      if (cache_side == kCacheRhs) {
+        cached_ = kCacheRhs;
+      }
+    }
+
+    const int32_t zero_term = static_cast<int32_t>(depth) * lhs_zero * rhs_zero;
+    for (index_t r = 0; r < rows; ++r) {
+      row_terms[r] = bias[r] + (K::kRhsOffset - rhs_zero) * row_sums[r]
+          + zero_term;
+    }
+    for (index_t c = 0; c < cols; ++c) {
+      col_terms[c] = -lhs_zero * col_sums[c];
+    }
+
+    const int32_t *row_terms_data = row_terms.data();
+    const int32_t *col_terms_data = col_terms.data();
+    thread_pool.Compute2D([=, &output_matrix, &requantization](index_t start0,
+                                              index_t end0,
+                                              index_t step0,
+                                              index_t start1,
+                                              index_t end1,
+                                              index_t step1) {
+      int32_t tile[K::kRows * K::kCols];
+      for (index_t col_block = start0; col_block < end0;
+           col_block += step0) {
+        const index_t start_col = col_block * col_block_size;
+        const index_t block_cols = std::min(col_block_size, cols - start_col);
+        const uint8_t *packed_rhs = packed_rhs_data + start_col * depth_padded;
+        for (index_t row_block = start1; row_block < end1;
+             row_block += step1) {
+          const index_t start_row = row_block * row_block_size;
+          const index_t block_rows = std::min(row_block_size,
+                                              rows - start_row);
+          K::Run(packed_lhs_data + start_row * depth_padded, packed_rhs,
+                 depth_groups, tile);
+          MatrixMap<OUTPUT_TYPE> output_block = output_matrix.block(
+              start_row, start_col, block_rows, block_cols);
+          StoreTile<K>(requantization, start_row, tile,
+                       row_terms_data + start_row, col_terms_data + start_col,
+                       &output_block);
+        }  // row_block
+      }  // col_block
+    }, 0, col_block_count, 1, 0, row_block_count, 1);
+  }  // b
+
+  return MaceStatus::MACE_SUCCESS;
+}
+
+}  // namespace q8
+}  // namespace ops
+}  // namespace mace
+
+#endif  // MACE_OPS_COMMON_Q8_GEMM_H_
@@ -0,0 +1,334 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_COMMON_VECTOR_MATH_H_
+#define MACE_OPS_COMMON_VECTOR_MATH_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "mace/ops/delegator/vector_math.h"
+#include "mace/utils/thread_pool.h"
+
+// Polynomial approximations of exp, log, tanh, sigmoid and erf, written once
+// over vector traits like the ones of x86/common_x86.h and instantiated for
+// NEON, SSE4.2, AVX2, AVX-512 and portable scalar code (VecRef). Besides the
+// arithmetic of the traits they use Max, Min, Div, Round, Ldexp, Frexp and
+// SelectLess. Max and Min of x86 return their second operand when either is
+// NaN, so the clamps below are written as Max(bound, x) to let NaN through.
+//
+// Max errors measured over all the floats of the ranges, with and without
+// fused multiply-add:
+//   Exp      1 ulp   0 below -104, inf above 88.72
+//   Log      1 ulp   -inf for 0, NaN for negative inputs, denormals handled
+//   Expm1    2 ulp   for inputs <= 0, as used by Tanh and Elu
+//   Tanh     3 ulp
+//   Sigmoid  3 ulp   down to its denormal results
+//   Erf      8 ulp   absolute error below 5e-7
+// NaN inputs give NaN. ARMv7 has no vector division, the refined reciprocal
+// estimate it uses adds up to 2 ulp to Tanh, Sigmoid and Erf.
+
+namespace mace {
+namespace ops {
+namespace vector_math {
+
+// exp(r) - 1 for r in [-ln2 / 2, ln2 / 2], the minimax polynomial of Cephes'
+// expf.
+template<class V>
+inline typename V::Vec Expm1Reduced(const typename V::Vec r) {
+  typename V::Vec p = V::Set1(1.9875691500E-4f);
+  p = V::Fma(p, r, V::Set1(1.3981999507E-3f));
+  p = V::Fma(p, r, V::Set1(8.3334519073E-3f));
+  p = V::Fma(p, r, V::Set1(4.1665795894E-2f));
+  p = V::Fma(p, r, V::Set1(1.6666665459E-1f));
+  p = V::Fma(p, r, V::Set1(5.0000001201E-1f));
+  return V::Fma(p, V::Mul(r, r), r);
+}
+
+// x = n * ln2 + r with integral n and r in [-ln2 / 2, ln2 / 2]. ln2 is split
+// in two so that n * ln2_hi is exact.
+template<class V>
+inline typename V::Vec ReduceLn2(const typename V::Vec x,
+                                 typename V::Vec *n) {
+  *n = V::Round(V::Mul(x, V::Set1(1.44269504088896341f)));
+  const typename V::Vec r = V::Fma(*n, V::Set1(-0.693359375f), x);
+  return V::Fma(*n, V::Set1(2.12194440e-4f), r);
+}
+
+template<class V>
+inline typename V::Vec Exp(typename V::Vec x) {
+  x = V::Min(V::Set1(89.f), V::Max(V::Set1(-104.f), x));
+  typename V::Vec n;
+  const typename V::Vec r = ReduceLn2<V>(x, &n);
+  const typename V::Vec p = V::Add(Expm1Reduced<V>(r), V::Set1(1.f));
+  // n is in [-150, 128], 2^n is applied in two steps to keep both normal
+  const typename V::Vec n1 = V::Round(V::Mul(n, V::Set1(0.5f)));
+  return V::Ldexp(V::Ldexp(p, n1), V::Sub(n, n1));
+}
+
+// exp(x) - 1 for x <= 0, accurate near 0 where exp(x) - 1 cancels.
+template<class V>
+inline typename V::Vec Expm1(typename V::Vec x) {
+  x = V::Min(V::Zero(), V::Max(V::Set1(-87.f), x));
+  typename V::Vec n;
+  const typename V::Vec r = ReduceLn2<V>(x, &n);
+  const typename V::Vec q = Expm1Reduced<V>(r);
+  // 2^n * (q + 1) - 1, exact when n is 0
+  const typename V::Vec e = V::Ldexp(V::Set1(1.f), n);
+  return V::Fma(e, q, V::Sub(e, V::Set1(1.f)));
+}
+
+template<class V>
+inline typename V::Vec Log(const typename V::Vec x) {
+  const typename V::Vec min_normal = V::Set1(1.17549435e-38f);
+  // scale denormals up by 2^23
+  const typename V::Vec scaled =
+      V::SelectLess(x, min_normal, V::Mul(x, V::Set1(8388608.f)), x);
+  typename V::Vec k;
+  typename V::Vec z = V::Frexp(scaled, &k);
+  k = V::SelectLess(x, min_normal, V::Sub(k, V::Set1(23.f)), k);
+  // log(1 + z) for z in [sqrt(0.5) - 1, sqrt(2) - 1], Cephes' logf
+  z = V::Sub(z, V::Set1(1.f));
+  const typename V::Vec z2 = V::Mul(z, z);
+  typename V::Vec p = V::Set1(7.0376836292E-2f);
+  p = V::Fma(p, z, V::Set1(-1.1514610310E-1f));
+  p = V::Fma(p, z, V::Set1(1.1676998740E-1f));
+  p = V::Fma(p, z, V::Set1(-1.2420140846E-1f));
+  p = V::Fma(p, z, V::Set1(1.4249322787E-1f));
+  p = V::Fma(p, z, V::Set1(-1.6668057665E-1f));
+  p = V::Fma(p, z, V::Set1(2.0000714765E-1f));
+  p = V::Fma(p, z, V::Set1(-2.4999993993E-1f));
+  p = V::Fma(p, z, V::Set1(3.3333331174E-1f));
+  typename V::Vec y = V::Mul(V::Mul(p, z), z2);
+  y = V::Fma(k, V::Set1(-2.12194440e-4f), y);
+  y = V::Fma(z2, V::Set1(-0.5f), y);
+  y = V::Add(z, y);
+  y = V::Fma(k, V::Set1(0.693359375f), y);
+  // NaN stays NaN, then inf, 0 and negative inputs
+  y = V::Add(y, V::Sub(x, x));
+  y = V::SelectLess(V::Set1(3.40282347e+38f), x, x, y);
+  y = V::SelectLess(x, V::Set1(1.40129846e-45f), V::Set1(-INFINITY), y);
+  return V::SelectLess(x, V::Zero(), V::Set1(NAN), y);
+}
+
+// tanh(|x|) = -t / (t + 2) with t = expm1(-2|x|), which saturates to 1 from
+// |x| = 9 on.
+template<class V>
+inline typename V::Vec Tanh(const typename V::Vec x) {
+  const typename V::Vec abs_x = V::Max(V::Sub(V::Zero(), x), x);
+  const typename V::Vec t =
+      Expm1<V>(V::Max(V::Set1(-18.f), V::Mul(abs_x, V::Set1(-2.f))));
+  const typename V::Vec y =
+      V::Div(V::Sub(V::Zero(), t), V::Add(t, V::Set1(2.f)));
+  return V::SelectLess(x, V::Zero(), V::Sub(V::Zero(), y), y);
+}
+
+// 1 / (1 + e) for x >= 0 and e / (1 + e) otherwise, with e = exp(-|x|), so
+// that small results keep their relative accuracy.
+template<class V>
+inline typename V::Vec Sigmoid(const typename V::Vec x) {
+  const typename V::Vec abs_x = V::Max(V::Sub(V::Zero(), x), x);
+  const typename V::Vec e = Exp<V>(V::Sub(V::Zero(), abs_x));
+  const typename V::Vec d = V::Div(V::Set1(1.f), V::Add(V::Set1(1.f), e));
+  return V::SelectLess(x, V::Zero(), V::Mul(e, d), d);
+}
+
+// x * p(x^2) / q(x^2) on [-4, 4], the rational approximation of Eigen's
+// erf, erf(x) rounds to +-1 beyond.
+template<class V>
+inline typename V::Vec Erf(typename V::Vec x) {
+  x = V::Min(V::Set1(4.f), V::Max(V::Set1(-4.f), x));
+  const typename V::Vec x2 = V::Mul(x, x);
+  typename V::Vec p = V::Set1(-2.72614225801306e-10f);
+  p = V::Fma(x2, p, V::Set1(2.77068142495902e-08f));
+  p = V::Fma(x2, p, V::Set1(-2.10102402082508e-06f));
+  p = V::Fma(x2, p, V::Set1(-5.69250639462346e-05f));
+  p = V::Fma(x2, p, V::Set1(-7.34990630326855e-04f));
+  p = V::Fma(x2, p, V::Set1(-2.95459980854025e-03f));
+  p = V::Fma(x2, p, V::Set1(-1.60960333262415e-02f));
+  typename V::Vec q = V::Set1(-1.45660718464996e-05f);
+  q = V::Fma(x2, q, V::Set1(-2.13374055278905e-04f));
+  q = V::Fma(x2, q, V::Set1(-1.68282697438203e-03f));
+  q = V::Fma(x2, q, V::Set1(-7.37332916720468e-03f));
+  q = V::Fma(x2, q, V::Set1(-1.42647390514189e-02f));
+  // x * (p / q) rather than x * p / q, x * p underflows for tiny x
+  return V::Mul(x, V::Div(p, q));
+}
+
+template<class V>
+inline typename V::Vec Elu(const typename V::Vec x,
+                           const typename V::Vec alpha) {
+  return V::SelectLess(x, V::Zero(), V::Mul(alpha, Expm1<V>(x)), x);
+}
+
+// Applies `func` to input[0, size) a vector at a time. The tail goes through
+// a padded vector, so every element gets the same result whatever its
+// position. `input` may be the same array as `output`.
+template<class V, class Func>
+inline void Map(const float *input, const index_t size, float *output,
+                const Func &func) {
+  const index_t width = V::kWidth;
+  index_t i = 0;
+  for (; i + width <= size; i += width) {
+    V::Store(output + i, func(V::Load(input + i)));
+  }
+  if (i < size) {
+    float tail[V::kWidth] = {0.f};
+    std::copy(input + i, input + size, tail);
+    V::Store(tail, func(V::Load(tail)));
+    std::copy(tail, tail + (size - i), output + i);
+  }
+}
+
+// Map over the thread pool, in blocks of whole vectors.
+template<class V, class Func>
+inline void ParallelMap(utils::ThreadPool *thread_pool, const float *input,
+                        const index_t size, float *output, const Func &func) {
+  const index_t block_size = 64 * V::kWidth;
+  const index_t block_count = (size + block_size - 1) / block_size;
+  thread_pool->Compute1D(
+      [=, &func](index_t start, index_t end, index_t step) {
+        for (index_t b = start; b < end; b += step) {
+          const index_t offset = b * block_size;
+          Map<V>(input + offset, std::min(block_size, size - offset),
+                 output + offset, func);
+        }
+      },
+      0, block_count, 1);
+}
+
+template<class V>
+struct ExpFunc {
+  typename V::Vec operator()(const typename V::Vec x) const {
+    return Exp<V>(x);
+  }
+};
+
+template<class V>
+struct LogFunc {
+  typename V::Vec operator()(const typename V::Vec x) const {
+    return Log<V>(x);
+  }
+};
+
+template<class V>
+struct TanhFunc {
+  typename V::Vec operator()(const typename V::Vec x) const {
+    return Tanh<V>(x);
+  }
+};
+
+template<class V>
+struct SigmoidFunc {
+  typename V::Vec operator()(const typename V::Vec x) const {
+    return Sigmoid<V>(x);
+  }
+};
+
+template<class V>
+struct ErfFunc {
+  typename V::Vec operator()(const typename V::Vec x) const {
+    return Erf<V>(x);
+  }
+};
+
+template<class V>
+struct EluFunc {
+  explicit EluFunc(const float alpha) : alpha(V::Set1(alpha)) {}
+  typename V::Vec operator()(const typename V::Vec x) const {
+    return Elu<V>(x, alpha);
+  }
+  const typename V::Vec alpha;
+};
+
+// Portable scalar traits, for CPUs without SIMD kernels.
+struct VecRef {
+  typedef float Vec;
+  static const int kWidth = 1;
+
+  static inline Vec Zero() { return 0.f; }
+  static inline Vec Set1(const float v) { return v; }
+  static inline Vec Load(const float *p) { return *p; }
+  static inline void Store(float *p, Vec v) { *p = v; }
+  static inline Vec Add(Vec a, Vec b) { return a + b; }
+  static inline Vec Sub(Vec a, Vec b) { return a - b; }
+  static inline Vec Mul(Vec a, Vec b) { return a * b; }
+  static inline Vec Div(Vec a, Vec b) { return a / b; }
+  // a * b + c
+  static inline Vec Fma(Vec a, Vec b, Vec c) { return a * b + c; }
+  static inline Vec Max(Vec a, Vec b) { return a > b ? a : b; }
+  static inline Vec Min(Vec a, Vec b) { return a < b ? a : b; }
+  static inline Vec Round(Vec v) { return std::nearbyint(v); }
+  // v * 2^n for integral n in [-126, 127]
+  static inline Vec Ldexp(Vec v, Vec n) {
+    const int32_t bits = (static_cast<int32_t>(n) + 127) << 23;
+    float scale;
+    memcpy(&scale, &bits, sizeof(scale));
+    return v * scale;
+  }
+  // z * 2^k = v with z in [sqrt(0.5), sqrt(2)), for positive normal v
+  static inline Vec Frexp(Vec v, Vec *k) {
+    int32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    const int32_t offset = bits - 0x3f3504f3;
+    *k = static_cast<float>(offset >> 23);
+    bits -= offset & static_cast<int32_t>(0xff800000);
+    float z;
+    memcpy(&z, &bits, sizeof(z));
+    return z;
+  }
+  // a < b ? x : y
+  static inline Vec SelectLess(Vec a, Vec b, Vec x, Vec y) {
+    return a < b ? x : y;
+  }
+};
+
+}  // namespace vector_math
+
+// The vector math delegator of the traits V.
+template<class V>
+class VectorMath : public delegator::VectorMath {
+ public:
+  explicit VectorMath(const DelegatorParam &param)
+      : delegator::VectorMath(param) {}
+  ~VectorMath() {}
+
+  void Exp(const float *input, const index_t size, float *output) override {
+    vector_math::Map<V>(input, size, output, vector_math::ExpFunc<V>());
+  }
+  void Log(const float *input, const index_t size, float *output) override {
+    vector_math::Map<V>(input, size, output, vector_math::LogFunc<V>());
+  }
+  void Tanh(const float *input, const index_t size, float *output) override {
+    vector_math::Map<V>(input, size, output, vector_math::TanhFunc<V>());
+  }
+  void Sigmoid(const float *input, const index_t size,
+               float *output) override {
+    vector_math::Map<V>(input, size, output, vector_math::SigmoidFunc<V>());
+  }
+  void Erf(const float *input, const index_t size, float *output) override {
+    vector_math::Map<V>(input, size, output, vector_math::ErfFunc<V>());
+  }
+  void Elu(const float *input, const index_t size, const float alpha,
+           float *output) override {
+    vector_math::Map<V>(input, size, output,
+                        vector_math::EluFunc<V>(alpha));
+  }
+};
+
+}  // namespace ops
+}  // namespace mace
+
+#endif  // MACE_OPS_COMMON_VECTOR_MATH_H_
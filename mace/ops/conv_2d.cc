@@ -18,6 +18,8 @@
 #include <algorithm>
 #include <functional>
 #include <limits>
+#include <list>
+#include <map>
 #include <memory>
 #include <string>
 #include <tuple>
@@ -33,13 +35,16 @@
 #include "mace/ops/delegator/activation.h"
 #include "mace/ops/delegator/bias_add.h"
 #include "mace/ops/delegator/conv_2d.h"
+#include "mace/runtimes/cpu/cpu_runtime.h"
 #include "mace/utils/memory.h"
 #include "mace/utils/math.h"
+#include "mace/utils/thread_pool.h"
+#include "mace/utils/timer.h"
+#include "mace/utils/tuner.h"
 
 #ifdef MACE_ENABLE_QUANTIZE
 #include "mace/ops/common/gemmlowp_util.h"
 #include "mace/ops/arm/q8/quantization_util.h"
-#include "mace/runtimes/cpu/cpu_runtime.h"
 #endif  // MACE_ENABLE_QUANTIZE
 
 #ifdef MACE_ENABLE_OPENCL
@@ -55,6 +60,28 @@ namespace ops {
 template<RuntimeType D, class T>
 class Conv2dOp;
 
+namespace {
+// Kernels the CPU tuner picks from, the tuned parameters of a layer are
+// {kernel, max threads, tiles per thread}.
+enum Conv2dKernel : uint32_t {
+  // picked by the filter shape
+  CONV2D_KERNEL_DEFAULT = 0,
+  CONV2D_KERNEL_GENERAL = 1,
+  CONV2D_KERNEL_3X3_WINOGRAD = 2,
+  CONV2D_KERNEL_3X3_S1 = 3,
+};
+constexpr size_t kConv2dTunedParamCount = 3;
+// output shapes a layer remembers its choice of kernel, threads and tiles
+// for, the least recently used is dropped first
+constexpr size_t kConv2dMaxShapeChoices = 8;
+
+struct Conv2dChoice {
+  uint32_t kernel;
+  int max_threads;
+  int tiles_per_thread;
+};
+}  // namespace
+
 template<class T>
 class Conv2dOp<RuntimeType::RT_CPU, T> : public ConvPool2dOpBase {
  public:
@@ -79,106 +106,345 @@ class Conv2dOp<RuntimeType::RT_CPU, T> : public ConvPool2dOpBase {
             MACE_DELEGATOR_KEY(BiasAdd, RuntimeType::RT_CPU, T, kCpuImplType),
             DelegatorParam())) {}
 
+  MaceStatus Prepack(OpContext *context,
+                     std::vector<int> *released_inputs) override {
+    const Tensor *filter = this->Input(FILTER);
+    if (!filter->is_weight()) {
+      return MaceStatus::MACE_SUCCESS;
+    }
+    if (IsTuning(context)) {
+      // the kernels timed at the first run need the filter
+      return MaceStatus::MACE_SUCCESS;
+    }
+    // prepacks the kernel chosen for the output shape of the model, which
+    // the first run likely has
+    SelectForShape(context, ModelOutputShape());
+    if (conv2d_delegator_->Prepack(context, filter)) {
+      filter_released_ = true;
+      released_inputs->push_back(FILTER);
+    }
+    return MaceStatus::MACE_SUCCESS;
+  }
+
   MaceStatus Run(OpContext *context) override {
     const Tensor *input = this->Input(INPUT);
     const Tensor *filter = this->Input(FILTER);
     const Tensor *bias = this->InputSize() >= 3 ? this->Input(BIAS) : nullptr;
     Tensor *output = this->Output(OUTPUT);
 
-    if (conv2d_delegator_ == nullptr) {
-      auto tag = MACE_DELEGATOR_KEY(Conv2d,
-                                    RuntimeType::RT_CPU, T, kCpuImplType);
-      if (kCpuImplType == NEON) {
-        // the following params are used to decide which conv delegator to use
-        const index_t stride_h = strides_[0];
-        const index_t stride_w = strides_[1];
-        const index_t dilation_h = dilations_[0];
-        const index_t dilation_w = dilations_[1];
-        const index_t filter_h = filter->dim(2);
-        const index_t filter_w = filter->dim(3);
-        const index_t input_channels = input->dim(1);
-        const index_t channels = filter->dim(0);
-        // NOTE: delegator is fixed after first round of running,
-        // although winograd depends on input params.
-        // We do not support changeable filter for now.
-        if (filter_h == 1 && filter_w == 1 && stride_h == 1 && stride_w == 1
-            && dilation_h == 1 && dilation_w == 1) {
-          tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
-                                      kCpuImplType, K1x1);
-        } else if (filter_h == 3 && filter_w == 3
-            && stride_h == 1 && stride_w == 1 && dilation_h == 1
-            && dilation_w == 1) {
-          if (input_channels >= 8 && channels >= 8) {
-            tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
-                                        kCpuImplType, K3x3Winograd);
-          } else {
-            tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
-                                        kCpuImplType, K3x3S1);
+    const std::vector<index_t> output_shape = OutputShape(input, filter);
+    if (IsTuning(context) &&
+        Tune(context, input, filter, bias, output_shape, output)) {
+      return MaceStatus::MACE_SUCCESS;
+    }
+    SelectForShape(context, output_shape);
+
+    utils::ScopedJobLimits job_limits(max_threads_, tiles_per_thread_);
+    Compute(context, conv2d_delegator_, input, filter, bias, output);
+
+    return MaceStatus::MACE_SUCCESS;
+  }
+
+ private:
+  void Compute(OpContext *context, delegator::Conv2d *conv2d_delegator,
+               const Tensor *input, const Tensor *filter, const Tensor *bias,
+               Tensor *output) {
+    conv2d_delegator->Compute(context, input, filter, output);
+    if (!conv2d_delegator->FusesEpilogue()) {
+      bias_add_delegator_->Compute(context, output, bias, output);
+      activation_delegator_->Compute(context, output, output);
+    } else if (!FusesActivation()) {
+      activation_delegator_->Compute(context, output, output);
+    }
+  }
+
+  bool IsTuning(OpContext *context) const {
+    Tuner<uint32_t> *tuner = CpuRuntime::Get(context)->tuner();
+    return tuner != nullptr && tuner->IsTuning();
+  }
+
+  std::vector<index_t> ModelOutputShape() const {
+    std::vector<index_t> output_shape;
+    if (this->has_debug_def() && this->debug_def().output_shape_size() > 0) {
+      const auto &dims = this->debug_def().output_shape(0).dims();
+      output_shape.assign(dims.begin(), dims.end());
+    }
+    return output_shape;
+  }
+
+  // The output shape of a run with `input`, NHWC like the output shapes of
+  // the model.
+  std::vector<index_t> OutputShape(const Tensor *input,
+                                   const Tensor *filter) const {
+    std::vector<index_t> output_shape(4);
+    std::vector<int> paddings(2);
+    if (paddings_.empty()) {
+      CalcNCHWPaddingAndOutputSize(input->shape().data(),
+                                   filter->shape().data(), dilations_.data(),
+                                   strides_.data(), padding_type_,
+                                   output_shape.data(), paddings.data());
+    } else {
+      CalcNCHWOutputSize(input->shape().data(), filter->shape().data(),
+                         paddings_.data(), dilations_.data(), strides_.data(),
+                         RoundType::FLOOR, output_shape.data());
+    }
+    return {output_shape[0], output_shape[2], output_shape[3],
+            output_shape[1]};
+  }
+
+  // Layers of the same shape share their tuned parameters, which are tuned
+  // for each output shape a layer runs with. The kernels picked at init use
+  // the output shape of the model.
+  std::string TuningKey(const std::vector<index_t> &output_shape) {
+    const Tensor *filter = this->Input(FILTER);
+    return MakeString("Conv2dCpu_", static_cast<int>(DataTypeToEnum<T>::value),
+                      "_", MakeString(filter->shape()), "_",
+                      MakeString(strides_), "_", MakeString(dilations_), "_",
+                      static_cast<int>(padding_type_), "_",
+                      MakeString(paddings_), "_", MakeString(output_shape));
+  }
+
+  // Times the candidate kernels, thread counts and tiles per thread at the
+  // first run with `output_shape`, leaving the output of the last candidate.
+  // Returns false if the shape was tuned already, e.g. by another layer.
+  bool Tune(OpContext *context, const Tensor *input, const Tensor *filter,
+            const Tensor *bias, const std::vector<index_t> &output_shape,
+            Tensor *output) {
+    Tuner<uint32_t> *tuner = CpuRuntime::Get(context)->tuner();
+    const std::string key = TuningKey(output_shape);
+    if (tuner->Find(key) != nullptr) {
+      return false;
+    }
+
+    const int thread_count = context->runtime()->thread_pool().thread_count();
+    auto params_generator = [&]() -> std::vector<std::vector<uint32_t>> {
+      std::vector<uint32_t> kernels = {CONV2D_KERNEL_DEFAULT};
+      if (kCpuImplType != REF) {
+        if (Is3x3S1(filter)) {
+          kernels = {CONV2D_KERNEL_3X3_WINOGRAD, CONV2D_KERNEL_3X3_S1};
+        }
+        kernels.push_back(CONV2D_KERNEL_GENERAL);
+      }
+      std::vector<uint32_t> threads = {static_cast<uint32_t>(thread_count)};
+      std::vector<uint32_t> tiles = {0};
+      if (thread_count > 1) {
+        if (thread_count / 2 > 1) {
+          threads.push_back(static_cast<uint32_t>(thread_count / 2));
+        }
+        threads.push_back(1);
+        tiles = {0, 1, 16};
+      }
+      std::vector<std::vector<uint32_t>> results;
+      for (uint32_t kernel : kernels) {
+        for (uint32_t thread : threads) {
+          for (uint32_t tile : tiles) {
+            // tiles per thread do not matter to a single thread
+            if (thread > 1 || tile == 0) {
+              results.push_back({kernel, thread, tile});
+            }
           }
-        } else if (filter_h == 3 && filter_w == 3
-            && stride_h == 2 && stride_w == 2 && dilation_h == 1
-            && dilation_w == 1) {
-          tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
-                                      kCpuImplType, K3x3S2);
-        } else if (filter_h == 5 && filter_w == 5
-            && stride_h == 1 && stride_w == 1 && dilation_h == 1
-            && dilation_w == 1) {
-          tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
-                                      kCpuImplType, K5x5S1);
-        } else if (filter_h == 7 && filter_w == 7
-            && stride_h == 1 && stride_w == 1 && dilation_h == 1
-            && dilation_w == 1) {
-          tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
-                                      kCpuImplType, K7x7S1);
-        } else if (filter_h == 7 && filter_w == 7
-            && stride_h == 2 && stride_w == 2 && dilation_h == 1
-            && dilation_w == 1) {
-          tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
-                                      kCpuImplType, K7x7S2);
-        } else if (filter_h == 7 && filter_w == 7
-            && stride_h == 3 && stride_w == 3 && dilation_h == 1
-            && dilation_w == 1) {
-          tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
-                                      kCpuImplType, K7x7S3);
-        } else if (filter_h == 1 && filter_w == 7
-            && stride_h == 1 && stride_w == 1 && dilation_h == 1
-            && dilation_w == 1) {
-          tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
-                                      kCpuImplType, K1x7S1);
-        } else if (filter_h == 7 && filter_w == 1
-            && stride_h == 1 && stride_w == 1 && dilation_h == 1
-            && dilation_w == 1) {
-          tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
-                                      kCpuImplType, K7x1S1);
-        } else if (filter_h == 1 && filter_w == 15
-            && stride_h == 1 && stride_w == 1 && dilation_h == 1
-            && dilation_w == 1) {
-          tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
-                                      kCpuImplType, K1x15S1);
-        } else if (filter_h == 15 && filter_w == 1
-            && stride_h == 1 && stride_w == 1 && dilation_h == 1
-            && dilation_w == 1) {
-          tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
-                                      kCpuImplType, K15x1S1);
         }
       }
-      delegator::Conv2dParam param(strides_, dilations_,
-                                   paddings_, padding_type_);
-      conv2d_delegator_ = delegator::Conv2d::Create(context->workspace(),
-                                                    tag, param);
+      return results;
+    };
+
+    // the candidates keep their transformed filters between the runs
+    auto func = [&](const std::vector<uint32_t> &params, Timer *timer,
+                    std::vector<uint32_t> *tuning_result) -> int {
+      std::unique_ptr<delegator::Conv2d> &delegator = delegators_[params[0]];
+      if (delegator == nullptr) {
+        delegator = CreateDelegator(context, params[0]);
+      }
+      utils::ScopedJobLimits job_limits(static_cast<int>(params[1]),
+                                        static_cast<int>(params[2]));
+      timer->ClearTiming();
+      timer->StartTiming();
+      Compute(context, delegator.get(), input, filter, bias, output);
+      timer->AccumulateTiming();
+      *tuning_result = params;
+      return 0;
+    };
+
+    WallClockTimer timer;
+    tuner->template TuneOrRun<int>(key, {CONV2D_KERNEL_DEFAULT, 0, 0},
+                                   params_generator, func, &timer);
+    // the losing candidates are dropped with their transformed filters
+    shape_choices_.clear();
+    const Conv2dChoice &choice = SelectForShape(context, output_shape);
+    for (auto iter = delegators_.begin(); iter != delegators_.end();) {
+      iter = iter->first == choice.kernel ? std::next(iter)
+                                          : delegators_.erase(iter);
     }
+    return true;
+  }
 
-    conv2d_delegator_->Compute(context, input, filter, output);
-    bias_add_delegator_->Compute(context, output, bias, output);
-    activation_delegator_->Compute(context, output, output);
+  // Picks the kernel, threads and tiles per thread for `output_shape`: the
+  // tuned parameters if there are, the kernel picked by the filter shape
+  // and all threads otherwise. The choices of the shapes seen last are kept,
+  // so that switching between them does not look the tuned parameters up
+  // again. Once the filter is released, the kernel it was prepacked for is
+  // kept whatever the shape.
+  const Conv2dChoice &SelectForShape(OpContext *context,
+                                     const std::vector<index_t> &shape) {
+    auto iter = shape_choices_.begin();
+    while (iter != shape_choices_.end() && iter->first != shape) {
+      ++iter;
+    }
+    if (iter != shape_choices_.end()) {
+      shape_choices_.splice(shape_choices_.begin(), shape_choices_, iter);
+    } else {
+      Conv2dChoice choice = {CONV2D_KERNEL_DEFAULT, 0, 0};
+      Tuner<uint32_t> *tuner = CpuRuntime::Get(context)->tuner();
+      const std::vector<uint32_t> *params =
+          tuner == nullptr ? nullptr : tuner->Find(TuningKey(shape));
+      if (params != nullptr && params->size() == kConv2dTunedParamCount) {
+        choice.kernel = (*params)[0];
+        choice.max_threads = static_cast<int>((*params)[1]);
+        choice.tiles_per_thread = static_cast<int>((*params)[2]);
+        VLOG(2) << "Tuned " << debug_def().name() << " for "
+                << MakeString(shape) << ": kernel " << choice.kernel
+                << ", threads " << choice.max_threads
+                << ", tiles per thread " << choice.tiles_per_thread;
+      }
+      if (filter_released_ && delegators_.count(choice.kernel) == 0) {
+        choice.kernel = delegators_.begin()->first;
+      }
+      shape_choices_.emplace_front(shape, choice);
+      if (shape_choices_.size() > kConv2dMaxShapeChoices) {
+        shape_choices_.pop_back();
+      }
+    }
 
-    return MaceStatus::MACE_SUCCESS;
+    const Conv2dChoice &choice = shape_choices_.front().second;
+    std::unique_ptr<delegator::Conv2d> &delegator = delegators_[choice.kernel];
+    if (delegator == nullptr) {
+      delegator = CreateDelegator(context, choice.kernel);
+    }
+    conv2d_delegator_ = delegator.get();
+    max_threads_ = choice.max_threads;
+    tiles_per_thread_ = choice.tiles_per_thread;
+    return choice;
   }
 
- private:
+  bool Is3x3S1(const Tensor *filter) const {
+    return filter->dim(2) == 3 && filter->dim(3) == 3
+        && strides_[0] == 1 && strides_[1] == 1
+        && dilations_[0] == 1 && dilations_[1] == 1;
+  }
+
+  std::unique_ptr<delegator::Conv2d> CreateDelegator(OpContext *context,
+                                                     uint32_t kernel) {
+    const Tensor *bias = this->InputSize() >= 3 ? this->Input(BIAS) : nullptr;
+    DelegatorInfo tag = DefaultTag();
+    if (kCpuImplType != REF) {
+      if (kernel == CONV2D_KERNEL_GENERAL) {
+        tag = MACE_DELEGATOR_KEY(Conv2d, RuntimeType::RT_CPU, T, kCpuImplType);
+      } else if (kernel == CONV2D_KERNEL_3X3_WINOGRAD) {
+        tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
+                                    kCpuImplType, K3x3Winograd);
+      } else if (kernel == CONV2D_KERNEL_3X3_S1) {
+        tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
+                                    kCpuImplType, K3x3S1);
+      }
+    }
+    delegator::Conv2dParam param(strides_, dilations_,
+                                 paddings_, padding_type_,
+                                 GetFusedEpilogue(bias));
+    return delegator::Conv2d::Create(context->workspace(), tag, param);
+  }
+
+  DelegatorInfo DefaultTag() {
+    const Tensor *filter = this->Input(FILTER);
+    auto tag = MACE_DELEGATOR_KEY(Conv2d,
+                                  RuntimeType::RT_CPU, T, kCpuImplType);
+    if (kCpuImplType != REF) {
+      // the following params are used to decide which conv delegator to use
+      const index_t stride_h = strides_[0];
+      const index_t stride_w = strides_[1];
+      const index_t dilation_h = dilations_[0];
+      const index_t dilation_w = dilations_[1];
+      const index_t filter_h = filter->dim(2);
+      const index_t filter_w = filter->dim(3);
+      const index_t input_channels = filter->dim(1);
+      const index_t channels = filter->dim(0);
+      // NOTE: delegator is fixed once created at prepack or first run,
+      // although winograd depends on input params.
+      // We do not support changeable filter for now.
+      if (filter_h == 1 && filter_w == 1 && stride_h == 1 && stride_w == 1
+          && dilation_h == 1 && dilation_w == 1) {
+        tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
+                                    kCpuImplType, K1x1);
+      } else if (filter_h == 3 && filter_w == 3
+          && stride_h == 1 && stride_w == 1 && dilation_h == 1
+          && dilation_w == 1) {
+        if (input_channels >= 8 && channels >= 8) {
+          tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
+                                      kCpuImplType, K3x3Winograd);
+        } else {
+          tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
+                                      kCpuImplType, K3x3S1);
+        }
+      } else if (filter_h == 3 && filter_w == 3
+          && stride_h == 2 && stride_w == 2 && dilation_h == 1
+          && dilation_w == 1) {
+        tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
+                                    kCpuImplType, K3x3S2);
+      } else if (filter_h == 5 && filter_w == 5
+          && stride_h == 1 && stride_w == 1 && dilation_h == 1
+          && dilation_w == 1) {
+        tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
+                                    kCpuImplType, K5x5S1);
+      } else if (filter_h == 7 && filter_w == 7
+          && stride_h == 1 && stride_w == 1 && dilation_h == 1
+          && dilation_w == 1) {
+        tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
+                                    kCpuImplType, K7x7S1);
+      } else if (filter_h == 7 && filter_w == 7
+          && stride_h == 2 && stride_w == 2 && dilation_h == 1
+          && dilation_w == 1) {
+        tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
+                                    kCpuImplType, K7x7S2);
+      } else if (filter_h == 7 && filter_w == 7
+          && stride_h == 3 && stride_w == 3 && dilation_h == 1
+          && dilation_w == 1) {
+        tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
+                                    kCpuImplType, K7x7S3);
+      } else if (filter_h == 1 && filter_w == 7
+          && stride_h == 1 && stride_w == 1 && dilation_h == 1
+          && dilation_w == 1) {
+        tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
+                                    kCpuImplType, K1x7S1);
+      } else if (filter_h == 7 && filter_w == 1
+          && stride_h == 1 && stride_w == 1 && dilation_h == 1
+          && dilation_w == 1) {
+        tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
+                                    kCpuImplType, K7x1S1);
+      } else if (filter_h == 1 && filter_w == 15
+          && stride_h == 1 && stride_w == 1 && dilation_h == 1
+          && dilation_w == 1) {
+        tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
+                                    kCpuImplType, K1x15S1);
+      } else if (filter_h == 15 && filter_w == 1
+          && stride_h == 1 && stride_w == 1 && dilation_h == 1
+          && dilation_w == 1) {
+        tag = MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, T,
+                                    kCpuImplType, K15x1S1);
+      }
+    }
+    return tag;
+  }
+
+  int max_threads_ = 0;
+  int tiles_per_thread_ = 0;
+  bool filter_released_ = false;
   std::unique_ptr<delegator::Activation> activation_delegator_;
   std::unique_ptr<delegator::BiasAdd> bias_add_delegator_;
-  std::unique_ptr<delegator::Conv2d> conv2d_delegator_;
+  // the delegators of the kernels chosen so far, each with its own packed
+  // filter, by kernel
+  std::map<uint32_t, std::unique_ptr<delegator::Conv2d>> delegators_;
+  // most recently used first
+  std::list<std::pair<std::vector<index_t>, Conv2dChoice>> shape_choices_;
+  delegator::Conv2d *conv2d_delegator_ = nullptr;
 
  private:
   MACE_OP_INPUT_TAGS(INPUT, FILTER, BIAS);
@@ -196,7 +462,21 @@ class Conv2dOp<RuntimeType::RT_CPU, uint8_t> : public ConvPool2dOpBase {
                                                    "NOOP"))),
         relux_max_limit_(Operation::GetOptionalArg<float>("max_limit", 0.0f)),
         activation_coefficient_(Operation::GetOptionalArg<float>(
-            "activation_coefficient", 0.0f)) {}
+            "activation_coefficient", 0.0f)),
+        use_gemmlowp_(UseGemmlowp()) {}
+
+  MaceStatus Prepack(OpContext *context,
+                     std::vector<int> *released_inputs) override {
+    const Tensor *filter = this->Input(FILTER);
+    if (!filter->is_weight() || !UseConv2dDelegator(filter)) {
+      return MaceStatus::MACE_SUCCESS;
+    }
+    CreateConv2dDelegator(context);
+    if (conv2d_delegator_->Prepack(context, filter)) {
+      released_inputs->push_back(FILTER);
+    }
+    return MaceStatus::MACE_SUCCESS;
+  }
 
   MaceStatus Run(OpContext *context) override {
     const Tensor *input = this->Input(INPUT);
@@ -204,11 +484,12 @@ class Conv2dOp<RuntimeType::RT_CPU, uint8_t> : public ConvPool2dOpBase {
     const Tensor *bias = this->InputSize() >= 3 ? this->Input(BIAS) : nullptr;
     Tensor *output = this->Output(OUTPUT);
 
-    MACE_CHECK(dilations_[0] == 1 && dilations_[1] == 1,
-               "Quantization convolution does not support dilation > 1 yet.");
-
-    auto gemm_context = CpuRuntime::Get(context)->GetGemmlowpContext();
-    MACE_CHECK_NOTNULL(gemm_context);
+    if (UseConv2dDelegator(filter)) {
+      if (conv2d_delegator_ == nullptr) {
+        CreateConv2dDelegator(context);
+      }
+      return conv2d_delegator_->Compute(context, input, filter, output);
+    }
 
     std::vector<index_t> output_shape(4);
     std::vector<int> paddings(2);
@@ -266,13 +547,7 @@ class Conv2dOp<RuntimeType::RT_CPU, uint8_t> : public ConvPool2dOpBase {
     MACE_CHECK(batch == input_batch, "Input/Output batch size mismatch");
 
     auto input_data = input->data<uint8_t>();
-    auto filter_data = filter->data<uint8_t>();
     auto output_data = output->mutable_data<uint8_t>();
-    auto bias_data = GetBiasData(bias,
-                                 input->scale(),
-                                 filter->scale(),
-                                 channels,
-                                 &bias_);
 
     auto gemm_input_data = input_data;
     std::unique_ptr<Tensor> im2col;
@@ -287,11 +562,21 @@ class Conv2dOp<RuntimeType::RT_CPU, uint8_t> : public ConvPool2dOpBase {
       runtime->AllocateBufferForTensor(im2col.get(), BufRentType::RENT_SCRATCH);
       uint8_t *im2col_data = im2col->mutable_data<uint8_t>();
       Im2col(context, input_data, input->shape(), filter_h, filter_w, stride_h,
-             stride_w, static_cast<uint8_t>(input->zero_point()),
+             stride_w, dilations_[0], dilations_[1],
+             static_cast<uint8_t>(input->zero_point()),
              paddings[0], paddings[1], output->shape(), depth, im2col_data);
       gemm_input_data = im2col_data;
     }
 
+    auto gemm_context = CpuRuntime::Get(context)->GetGemmlowpContext();
+    MACE_CHECK_NOTNULL(gemm_context);
+    auto filter_data = filter->data<uint8_t>();
+    auto bias_data = GetBiasData(bias,
+                                 input->scale(),
+                                 filter->scale(),
+                                 channels,
+                                 &bias_);
+
     const int gemm_filter_rows = static_cast<int>(channels);
     const int gemm_filter_cols = static_cast<int>(depth);
     const int gemm_input_rows = static_cast<int>(depth);
@@ -318,12 +603,35 @@ class Conv2dOp<RuntimeType::RT_CPU, uint8_t> : public ConvPool2dOpBase {
   }
 
  private:
+  // The filter runs on the implicit gemm of common/q8_conv_2d.h, which needs
+  // no im2col buffer, unless gemmlowp is picked for an uint8 one. gemmlowp
+  // has no int8 filter quantized per channel.
+  bool UseConv2dDelegator(const Tensor *filter) const {
+    return filter->dtype() == DT_INT8
+        || (!use_gemmlowp_ && filter->dtype() == DT_UINT8);
+  }
+
+  void CreateConv2dDelegator(OpContext *context) {
+    Epilogue epilogue;
+    epilogue.bias = this->InputSize() >= 3 ? this->Input(BIAS) : nullptr;
+    if (this->Input(FILTER)->dtype() == DT_INT8) {
+      epilogue.activation = activation_;
+      epilogue.max_limit = relux_max_limit_;
+    }
+    conv2d_delegator_ = delegator::Conv2d::Create(
+        context->workspace(),
+        MACE_DELEGATOR_KEY(Conv2d, RuntimeType::RT_CPU, uint8_t, kCpuImplType),
+        delegator::Conv2dParam(strides_, dilations_, paddings_, padding_type_,
+                               epilogue));
+  }
+
   template<typename T>
   inline void Im2col(
       const OpContext *context,
       const T *in_data, const std::vector<index_t> &in_shape,
       const index_t filter_h, const index_t filter_w, const index_t stride_h,
-      const index_t stride_w, const T zero_point, const int pad_height,
+      const index_t stride_w, const index_t dilation_h,
+      const index_t dilation_w, const T zero_point, const int pad_height,
       const int pad_width, const std::vector<index_t> &out_shape,
       const index_t depth, T *im2col_data) {
     const index_t input_row_size = in_shape[2] * in_shape[3];
@@ -343,6 +651,30 @@ class Conv2dOp<RuntimeType::RT_CPU, uint8_t> : public ConvPool2dOpBase {
             const index_t ih_end = ih_begin + filter_h;
             const index_t iw_begin = w * stride_w - (pad_width >> 1);
             const index_t iw_end = iw_begin + filter_w;
+            index_t im2col_column_offset =
+                ((b * out_shape[1] + h) * out_shape[2] + w) * depth;
+
+            if (dilation_h != 1 || dilation_w != 1) {
+              // the taps are not adjacent, copy them one by one
+              T *im2col_ptr = im2col_data + im2col_column_offset;
+              for (index_t kh = 0; kh < filter_h; ++kh) {
+                const index_t ih = ih_begin + kh * dilation_h;
+                for (index_t kw = 0; kw < filter_w; ++kw) {
+                  const index_t iw = iw_begin + kw * dilation_w;
+                  if (ih < 0 || ih >= in_shape[1] || iw < 0
+                      || iw >= in_shape[2]) {
+                    std::fill_n(im2col_ptr, in_shape[3], zero_point);
+                  } else {
+                    std::copy_n(in_data + ((b * in_shape[1] + ih) * in_shape[2]
+                                    + iw) * in_shape[3],
+                                in_shape[3], im2col_ptr);
+                  }
+                  im2col_ptr += in_shape[3];
+                }
+              }
+              continue;
+            }
+
             // gate height and width to separate padding
             const index_t ih_begin_gated = std::max<index_t>(0, ih_begin);
             const index_t ih_end_gated = std::min<index_t>(ih_end, in_shape[1]);
@@ -352,8 +684,6 @@ class Conv2dOp<RuntimeType::RT_CPU, uint8_t> : public ConvPool2dOpBase {
             const index_t pad_bottom = ih_end - ih_end_gated;
             const index_t pad_left = std::max<index_t>(0, -iw_begin);
             const index_t pad_right = iw_end - iw_end_gated;
-            index_t im2col_column_offset =
-                ((b * out_shape[1] + h) * out_shape[2] + w) * depth;
 
             // fill in padding top
             if (pad_top > 0) {
@@ -415,6 +745,8 @@ class Conv2dOp<RuntimeType::RT_CPU, uint8_t> : public ConvPool2dOpBase {
   const ActivationType activation_;
   const float relux_max_limit_;
   const float activation_coefficient_;
+  const bool use_gemmlowp_;
+  std::unique_ptr<delegator::Conv2d> conv2d_delegator_;
   std::vector<int32_t> bias_;
 
  private:
@@ -15,10 +15,13 @@
 #ifndef MACE_OPS_CONV_POOL_2D_BASE_H_
 #define MACE_OPS_CONV_POOL_2D_BASE_H_
 
+#include <string>
 #include <vector>
 
 #include "mace/core/ops/operator.h"
+#include "mace/ops/activation.h"
 #include "mace/ops/common/conv_pool_2d_util.h"
+#include "mace/ops/common/epilogue.h"
 
 namespace mace {
 namespace ops {
@@ -34,6 +37,34 @@ class ConvPool2dOpBase : public Operation {
         dilations_(Operation::GetRepeatedArgs<int>("dilations", {1, 1})) {}
 
  protected:
+  // The bias add and activation of a CPU conv, for delegators which fuse
+  // them into their output stage. The activation is left out if it can't be
+  // fused, see FusesActivation.
+  Epilogue GetFusedEpilogue(const Tensor *bias) const {
+    Epilogue epilogue;
+    epilogue.bias = bias;
+    if (!FusesActivation()) {
+      return epilogue;
+    }
+    epilogue.activation = StringToActivationType(
+        Operation::GetOptionalArg<std::string>("activation", "NOOP"));
+    epilogue.max_limit = Operation::GetOptionalArg<float>("max_limit", 0.0f);
+    epilogue.activation_coefficient =
+        Operation::GetOptionalArg<float>("activation_coefficient", 0.0f);
+    epilogue.hardsigmoid_alpha =
+        Operation::GetOptionalArg<float>("hardsigmoid_alpha", 0.f);
+    epilogue.hardsigmoid_beta =
+        Operation::GetOptionalArg<float>("hardsigmoid_beta", 0.f);
+    return epilogue;
+  }
+
+  // Whether GetFusedEpilogue carries the activation, otherwise the op still
+  // has to run it after a delegator which fuses the epilogue.
+  bool FusesActivation() const {
+    return CanFuseActivation(StringToActivationType(
+        Operation::GetOptionalArg<std::string>("activation", "NOOP")));
+  }
+
   std::vector<int> strides_;
   Padding padding_type_;
   std::vector<int> paddings_;
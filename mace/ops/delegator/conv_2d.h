@@ -22,6 +22,7 @@
 #include "mace/core/ops/op_delegator.h"
 #include "mace/core/registry/op_delegator_registry.h"
 #include "mace/ops/common/conv_pool_2d_util.h"
+#include "mace/ops/common/epilogue.h"
 
 namespace mace {
 namespace ops {
@@ -47,14 +48,17 @@ struct Conv2dParam : public DelegatorParam {
   explicit Conv2dParam(const std::vector<int> &strides,
                        const std::vector<int> &dilations,
                        const std::vector<int> &paddings,
-                       const Padding padding_type)
+                       const Padding padding_type,
+                       const Epilogue &epilogue = Epilogue())
       : strides_(strides), dilations_(dilations),
-        paddings_(paddings), padding_type_(padding_type) {}
+        paddings_(paddings), padding_type_(padding_type),
+        epilogue_(epilogue) {}
 
   const std::vector<int> &strides_;
   const std::vector<int> &dilations_;
   const std::vector<int> &paddings_;
   const Padding padding_type_;
+  const Epilogue epilogue_;
 };
 
 class Conv2d : public OpDelegator {
@@ -64,7 +68,8 @@ class Conv2d : public OpDelegator {
         strides_(param.strides_),
         dilations_(param.dilations_),
         paddings_(param.paddings_),
-        padding_type_(param.padding_type_) {}
+        padding_type_(param.padding_type_),
+        epilogue_(param.epilogue_) {}
   virtual ~Conv2d() = default;
 
   MACE_DEFINE_DELEGATOR_CREATOR(Conv2d)
@@ -74,11 +79,24 @@ class Conv2d : public OpDelegator {
                              const Tensor *filter,
                              Tensor *output) = 0;
 
+  // Whether Compute applies epilogue_, otherwise the caller has to add the
+  // bias and activation itself.
+  virtual bool FusesEpilogue() const { return false; }
+
+  // Converts the constant `filter` to the kernel's own layout ahead of the
+  // first Compute. Returns true if Compute no longer reads the filter data.
+  virtual bool Prepack(const OpContext *context, const Tensor *filter) {
+    MACE_UNUSED(context);
+    MACE_UNUSED(filter);
+    return false;
+  }
+
  protected:
   const std::vector<int> strides_;
   const std::vector<int> dilations_;
   const std::vector<int> paddings_;
   const Padding padding_type_;
+  const Epilogue epilogue_;
 };
 
 }  // namespace delegator
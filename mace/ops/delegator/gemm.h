@@ -19,6 +19,7 @@
 #include "mace/core/ops/op_context.h"
 #include "mace/core/ops/op_delegator.h"
 #include "mace/core/registry/op_delegator_registry.h"
+#include "mace/ops/common/epilogue.h"
 #include "mace/ops/common/matrix.h"
 
 namespace mace {
@@ -26,15 +27,19 @@ namespace ops {
 namespace delegator {
 
 struct GemmParam : public DelegatorParam {
-  explicit GemmParam(const bool should_cache_pack = false)
-      : should_cache_pack_(should_cache_pack) {}
+  explicit GemmParam(const bool should_cache_pack = false,
+                     const Epilogue &epilogue = Epilogue())
+      : should_cache_pack_(should_cache_pack), epilogue_(epilogue) {}
 
   const bool should_cache_pack_;
+  // Applied per output row, only supported with row-major outputs.
+  const Epilogue epilogue_;
 };
 
 class Gemm : public OpDelegator {
  public:
-  explicit Gemm(const GemmParam &param) : OpDelegator(param) {}
+  explicit Gemm(const GemmParam &param)
+      : OpDelegator(param), epilogue_(param.epilogue_) {}
   virtual ~Gemm() = default;
 
   MACE_DEFINE_DELEGATOR_CREATOR(Gemm)
@@ -67,6 +72,24 @@ class Gemm : public OpDelegator {
                              const bool lhs_batched,
                              const bool rhs_batched,
                              Tensor *output) = 0;
+
+  // Packs the constant, unbatched `lhs` ahead of the first Compute, which
+  // then reads the packed copy instead. Returns false if not supported.
+  virtual bool PrepackLhs(const OpContext *context,
+                          const Tensor *lhs,
+                          const index_t rows,
+                          const index_t depth,
+                          const MatrixMajor lhs_major) {
+    MACE_UNUSED(context);
+    MACE_UNUSED(lhs);
+    MACE_UNUSED(rows);
+    MACE_UNUSED(depth);
+    MACE_UNUSED(lhs_major);
+    return false;
+  }
+
+ protected:
+  const Epilogue epilogue_;
 };
 
 }  // namespace delegator
@@ -19,14 +19,25 @@
 #include "mace/core/ops/op_context.h"
 #include "mace/core/ops/op_delegator.h"
 #include "mace/core/registry/op_delegator_registry.h"
+#include "mace/ops/common/epilogue.h"
 
 namespace mace {
 namespace ops {
 namespace delegator {
 
+struct GemvParam : public DelegatorParam {
+  explicit GemvParam(const Epilogue &epilogue = Epilogue())
+      : epilogue_(epilogue) {}
+
+  // Applied to each output row after the bias passed to Compute, so only its
+  // activation is used. Ignored by the quantized delegators.
+  const Epilogue epilogue_;
+};
+
 class Gemv : public OpDelegator {
  public:
-  explicit Gemv(const DelegatorParam &param) : OpDelegator(param) {}
+  explicit Gemv(const GemvParam &param)
+      : OpDelegator(param), epilogue_(param.epilogue_) {}
   virtual ~Gemv() = default;
 
   MACE_DEFINE_DELEGATOR_CREATOR(Gemv)
@@ -42,6 +53,9 @@ class Gemv : public OpDelegator {
                              const bool lhs_batched,
                              const bool rhs_batched,
                              Tensor *output) = 0;
+
+ protected:
+  const Epilogue epilogue_;
 };
 
 }  // namespace delegator
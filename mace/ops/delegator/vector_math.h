@@ -0,0 +1,51 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_DELEGATOR_VECTOR_MATH_H_
+#define MACE_OPS_DELEGATOR_VECTOR_MATH_H_
+
+#include "mace/core/ops/op_context.h"
+#include "mace/core/ops/op_delegator.h"
+#include "mace/core/registry/op_delegator_registry.h"
+
+namespace mace {
+namespace ops {
+namespace delegator {
+
+// Element-wise transcendental functions of float arrays, the accuracy of each
+// function is documented in mace/ops/common/vector_math.h. They run on the
+// calling thread, and `input` may be the same array as `output`.
+class VectorMath : public OpDelegator {
+ public:
+  explicit VectorMath(const DelegatorParam &param) : OpDelegator(param) {}
+  virtual ~VectorMath() = default;
+
+  MACE_DEFINE_DELEGATOR_CREATOR(VectorMath)
+
+  virtual void Exp(const float *input, const index_t size, float *output) = 0;
+  virtual void Log(const float *input, const index_t size, float *output) = 0;
+  virtual void Tanh(const float *input, const index_t size, float *output) = 0;
+  virtual void Sigmoid(const float *input, const index_t size,
+                       float *output) = 0;
+  virtual void Erf(const float *input, const index_t size, float *output) = 0;
+  // x < 0 ? alpha * (exp(x) - 1) : x
+  virtual void Elu(const float *input, const index_t size, const float alpha,
+                   float *output) = 0;
+};
+
+}  // namespace delegator
+}  // namespace ops
+}  // namespace mace
+
+#endif  // MACE_OPS_DELEGATOR_VECTOR_MATH_H_
@@ -19,6 +19,7 @@
 
 #ifdef MACE_ENABLE_QUANTIZE
 #include "mace/ops/arm/q8/quantization_util.h"
+#include "mace/ops/ref/q8/int8_per_channel.h"
 // We reuse TensorFlow Lite's optimized depthwiseconv_uint8 and parallelized it
 // using thread pool for MACE's quantized depthwise_conv2d.
 #include "tensorflow/contrib/lite/kernels/internal/optimized/depthwiseconv_uint8.h"
@@ -119,14 +120,19 @@ class DepthwiseConv2dOp<RuntimeType::RT_CPU, T> : public DepthwiseConv2dOpBase {
         }
       }
       delegator::Conv2dParam param(strides_, dilations_,
-                                   paddings_, padding_type_);
+                                   paddings_, padding_type_,
+                                   GetFusedEpilogue(bias));
       depthwise_conv2d_delegator_ = delegator::DepthwiseConv2d::Create(
           context->workspace(), tag, param);
     }
 
     depthwise_conv2d_delegator_->Compute(context, input, filter, output);
-    bias_add_delegator_->Compute(context, output, bias, output);
-    activation_delegator_->Compute(context, output, output);
+    if (!depthwise_conv2d_delegator_->FusesEpilogue()) {
+      bias_add_delegator_->Compute(context, output, bias, output);
+      activation_delegator_->Compute(context, output, output);
+    } else if (!FusesActivation()) {
+      activation_delegator_->Compute(context, output, output);
+    }
 
     return MaceStatus::MACE_SUCCESS;
   }
@@ -207,6 +213,21 @@ class DepthwiseConv2dOp<RuntimeType::RT_CPU, uint8_t>
     int pad_top = paddings[0] >> 1;
     int pad_left = paddings[1] >> 1;
 
+    if (filter->dtype() == DT_INT8) {
+      // the scales are constant, the multipliers are computed once
+      if (output_stage_.channels() == 0) {
+        output_stage_.Init(input, filter, bias, output, activation_,
+                           relux_max_limit_);
+      }
+      const int pad_hw[2] = {pad_top, pad_left};
+      ref::q8::PerChannelDepthwiseConv2d(
+          context, input->data<uint8_t>(), filter->data<int8_t>(),
+          input->shape().data(), filter->shape().data(), output_shape.data(),
+          strides_.data(), dilations_.data(), pad_hw, input->zero_point(),
+          output_stage_, output->mutable_data<uint8_t>());
+      return MaceStatus::MACE_SUCCESS;
+    }
+
     auto input_data = input->data<uint8_t>();
     auto filter_data = filter->data<uint8_t>();
     auto output_data = output->mutable_data<uint8_t>();
@@ -342,6 +363,7 @@ class DepthwiseConv2dOp<RuntimeType::RT_CPU, uint8_t>
 
  private:
   std::vector<int32_t> bias_;
+  ref::q8::PerChannelOutputStage output_stage_;
 };
 #endif  // MACE_ENABLE_QUANTIZE
 
@@ -14,20 +14,21 @@
 
 
 #include <algorithm>
-#include <cmath>
 #include <functional>
 #include <memory>
-#include <utility>
 #include <vector>
 
 #include "mace/core/ops/operator.h"
-#include "mace/core/quantize.h"
 #include "mace/core/registry/ops_registry.h"
+#include "mace/ops/delegator/vector_math.h"
 #include "mace/utils/logging.h"
+#include "mace/utils/math.h"
 #include "mace/utils/memory.h"
 
-
 namespace mace {
+namespace ops {
+
+namespace {
 
 struct BBox {
   float xmin;
@@ -38,137 +39,90 @@ struct BBox {
   float confidence;
 };
 
-namespace {
-inline float overlap(const BBox &a, const BBox &b) {
-  if (a.xmin > b.xmax || a.xmax < b.xmin || a.ymin > b.ymax ||
-      a.ymax < b.ymin) {
-    return 0.f;
-  }
-  float overlap_w = std::min(a.xmax, b.xmax) - std::max(a.xmin, b.xmin);
-  float overlap_h = std::min(a.ymax, b.ymax) - std::max(a.ymin, b.ymin);
-  return overlap_w * overlap_h;
-}
-
-void NmsSortedBboxes(const std::vector<BBox> &bboxes,
-                     const float nms_threshold,
-                     const int top_k,
-                     std::vector<BBox> *sorted_boxes) {
-  const int n = std::min(top_k, static_cast<int>(bboxes.size()));
-  std::vector<int> picked;
-
-  std::vector<float> areas(n);
-  for (int i = 0; i < n; ++i) {
-    const BBox &r = bboxes[i];
-    float width = std::max(0.f, r.xmax - r.xmin);
-    float height = std::max(0.f, r.ymax - r.ymin);
-    areas[i] = width * height;
+// Decoded boxes, one array per coordinate so that the IoU loops vectorize.
+struct Boxes {
+  std::vector<float> xmin;
+  std::vector<float> ymin;
+  std::vector<float> xmax;
+  std::vector<float> ymax;
+
+  void Resize(const int size) {
+    xmin.resize(size);
+    ymin.resize(size);
+    xmax.resize(size);
+    ymax.resize(size);
   }
+};
 
-  for (int i = 0; i < n; ++i) {
-    const BBox &a = bboxes[i];
-    int keep = 1;
-    for (size_t j = 0; j < picked.size(); ++j) {
-      const BBox &b = bboxes[picked[j]];
-
-      float inter_area = overlap(a, b);
-      float union_area = areas[i] + areas[picked[j]] - inter_area;
-      MACE_CHECK(union_area > 0, "union_area should be greater than 0");
-      if (inter_area / union_area > nms_threshold) {
-        keep = 0;
-        break;
-      }
-    }
+struct Candidate {
+  float confidence;
+  int prior;
+};
 
-    if (keep) {
-      picked.push_back(i);
-      sorted_boxes->push_back(bboxes[i]);
-    }
-  }
+// By decreasing confidence, ties broken by prior index to keep the results
+// deterministic.
+inline bool CandidateGreater(const Candidate &a, const Candidate &b) {
+  return a.confidence > b.confidence
+      || (a.confidence == b.confidence && a.prior < b.prior);
 }
 
-inline bool cmp(const BBox &a, const BBox &b) {
-  return a.confidence > b.confidence;
+inline bool BBoxGreater(const BBox &a, const BBox &b) {
+  return a.confidence > b.confidence
+      || (a.confidence == b.confidence && a.label < b.label);
 }
-}  // namespace
 
-int DetectionOutput_CLA(const float *loc_ptr,
-                        const float *conf_ptr,
-                        const float *pbox_ptr,
-                        const int num_prior,
-                        const int num_classes,
-                        const float nms_threshold,
-                        const int top_k,
-                        const int keep_top_k,
-                        const float confidence_threshold,
-                        std::vector<BBox> *bbox_rects) {
-  MACE_CHECK(keep_top_k > 0, "keep_top_k should be greater than 0");
-  std::vector<float> bboxes(4 * num_prior);
-  for (int i = 0; i < num_prior; ++i) {
-    int index = i * 4;
-    const float *lc = loc_ptr + index;
-    const float *pb = pbox_ptr + index;
-    const float *var = pb + num_prior * 4;
-
-    float pb_w = pb[2] - pb[0];
-    float pb_h = pb[3] - pb[1];
-    float pb_cx = (pb[0] + pb[2]) * 0.5f;
-    float pb_cy = (pb[1] + pb[3]) * 0.5f;
-
-    float bbox_cx = var[0] * lc[0] * pb_w + pb_cx;
-    float bbox_cy = var[1] * lc[1] * pb_h + pb_cy;
-    float bbox_w = std::exp(var[2] * lc[2]) * pb_w;
-    float bbox_h = std::exp(var[3] * lc[3]) * pb_h;
-
-    bboxes[0 + index] = bbox_cx - bbox_w * 0.5f;
-    bboxes[1 + index] = bbox_cy - bbox_h * 0.5f;
-    bboxes[2 + index] = bbox_cx + bbox_w * 0.5f;
-    bboxes[3 + index] = bbox_cy + bbox_h * 0.5f;
-  }
-  // Start from 1 to ignore background class
-
-  for (int i = 1; i < num_classes; ++i) {
-    // Filter by confidence threshold
-    std::vector<BBox> class_bbox_rects;
-    for (int j = 0; j < num_prior; ++j) {
-      float confidence = conf_ptr[j * num_classes + i];
-      if (confidence > confidence_threshold) {
-        BBox c = {bboxes[0 + j * 4],
-                  bboxes[1 + j * 4],
-                  bboxes[2 + j * 4],
-                  bboxes[3 + j * 4],
-                  i,
-                  confidence};
-        class_bbox_rects.push_back(c);
+// Greedy NMS over candidates sorted by decreasing confidence: a box is kept
+// unless its IoU with a kept box exceeds the threshold. The kept boxes are
+// compared a chunk at a time, without branches inside a chunk.
+void NmsSortedCandidates(const Boxes &boxes,
+                         const std::vector<Candidate> &candidates,
+                         const float nms_threshold,
+                         const int label,
+                         std::vector<BBox> *picked) {
+  const int chunk_size = 16;
+  const size_t n = candidates.size();
+  std::vector<float> kept_xmin(n), kept_ymin(n), kept_xmax(n), kept_ymax(n),
+      kept_area(n);
+  int kept = 0;
+  for (const Candidate &candidate : candidates) {
+    const int p = candidate.prior;
+    const float xmin = boxes.xmin[p];
+    const float ymin = boxes.ymin[p];
+    const float xmax = boxes.xmax[p];
+    const float ymax = boxes.ymax[p];
+    const float area =
+        std::max(0.f, xmax - xmin) * std::max(0.f, ymax - ymin);
+
+    bool suppressed = false;
+    for (int j0 = 0; j0 < kept && !suppressed; j0 += chunk_size) {
+      const int j1 = std::min(kept, j0 + chunk_size);
+      int hit = 0;
+      for (int j = j0; j < j1; ++j) {
+        const float w = std::max(
+            0.f, std::min(xmax, kept_xmax[j]) - std::max(xmin, kept_xmin[j]));
+        const float h = std::max(
+            0.f, std::min(ymax, kept_ymax[j]) - std::max(ymin, kept_ymin[j]));
+        const float inter = w * h;
+        // inter / union > threshold
+        hit |= inter > nms_threshold * (area + kept_area[j] - inter);
       }
+      suppressed = hit != 0;
     }
-    std::sort(class_bbox_rects.begin(), class_bbox_rects.end(), cmp);
-
-    // Apply nms
-    std::vector<BBox> sorted_boxes;
-    NmsSortedBboxes(class_bbox_rects, nms_threshold,
-                    std::min(top_k, static_cast<int>(class_bbox_rects.size())),
-                    &sorted_boxes);
-    // Gather
-    bbox_rects->insert(bbox_rects->end(), sorted_boxes.begin(),
-                       sorted_boxes.end());
-  }
-
-  std::sort(bbox_rects->begin(), bbox_rects->end(), cmp);
-
-  // Output
-  int num_detected = keep_top_k < static_cast<int>(bbox_rects->size())
-                         ? keep_top_k
-                         : static_cast<int>(bbox_rects->size());
-  bbox_rects->resize(num_detected);
 
-  return num_detected;
+    if (!suppressed) {
+      kept_xmin[kept] = xmin;
+      kept_ymin[kept] = ymin;
+      kept_xmax[kept] = xmax;
+      kept_ymax[kept] = ymax;
+      kept_area[kept] = area;
+      ++kept;
+      picked->push_back({xmin, ymin, xmax, ymax, label,
+                         candidate.confidence});
+    }
+  }
 }
-}  // namespace mace
-
-
 
-namespace mace {
-namespace ops {
+}  // namespace
 
 class DetectionOutput : public Operation {
  public:
@@ -188,18 +142,23 @@ class DetectionOutputOp<RuntimeType::RT_CPU, T> : public DetectionOutput {
         nms_top_k_(Operation::GetOptionalArg<int>("nms_top_k", 100)),
         keep_top_k_(Operation::GetOptionalArg<int>("keep_top_k", 100)),
         confidence_threshold_(
-            Operation::GetOptionalArg<float>("confidence_threshold", 0.05f)) {}
+            Operation::GetOptionalArg<float>("confidence_threshold", 0.05f)),
+        vector_math_(delegator::VectorMath::Create(
+            context->workspace(),
+            MACE_DELEGATOR_KEY(VectorMath, RuntimeType::RT_CPU,
+                               float, kCpuImplType),
+            DelegatorParam())) {}
 
   MaceStatus Run(OpContext *context) override {
-    MACE_UNUSED(context);
     Tensor *output = this->Output(0);
 
     auto *loc_t = this->Input(0);
     auto *conf_t = this->Input(1);
     auto *pbox_t = this->Input(2);
 
-    auto num_prior = loc_t->shape()[1] / 4;
+    auto num_prior = static_cast<int>(loc_t->shape()[1] / 4);
 
+    MACE_CHECK(keep_top_k_ > 0, "keep_top_k should be greater than 0");
     MACE_CHECK(num_prior == conf_t->shape()[1] / num_classes_,
                "conf tensor shape miss match");
     MACE_CHECK(num_prior == pbox_t->shape()[2] / 4,
@@ -209,11 +168,47 @@ class DetectionOutputOp<RuntimeType::RT_CPU, T> : public DetectionOutput {
     const float *conf_ptr = conf_t->template data<float>();
     const float *pbox_ptr = pbox_t->template data<float>();
 
-    std::vector<BBox> bbox_rects;
+    utils::ThreadPool &thread_pool = context->runtime()->thread_pool();
+    DecodeBoxes(&thread_pool, loc_ptr, conf_ptr, pbox_ptr, num_prior);
+
+    // NMS of the classes in parallel, from 1 to skip the background class
+    class_boxes_.resize(std::max(num_classes_, 1));
+    thread_pool.Compute1D([=](index_t start, index_t end, index_t step) {
+      std::vector<Candidate> candidates;
+      for (index_t c = start; c < end; c += step) {
+        const int label = static_cast<int>(c);
+        candidates.clear();
+        for (int p : active_priors_) {
+          const float confidence = conf_ptr[p * num_classes_ + label];
+          if (confidence > confidence_threshold_) {
+            candidates.push_back({confidence, p});
+          }
+        }
+        // only the top k candidates go through NMS
+        if (static_cast<int>(candidates.size()) > nms_top_k_) {
+          std::partial_sort(candidates.begin(),
+                            candidates.begin() + std::max(nms_top_k_, 0),
+                            candidates.end(), CandidateGreater);
+          candidates.resize(std::max(nms_top_k_, 0));
+        } else {
+          std::sort(candidates.begin(), candidates.end(), CandidateGreater);
+        }
+        class_boxes_[label].clear();
+        NmsSortedCandidates(boxes_, candidates, nms_threshold_, label,
+                            &class_boxes_[label]);
+      }
+    }, 1, num_classes_, 1);
 
-    DetectionOutput_CLA(loc_ptr, conf_ptr, pbox_ptr, num_prior, num_classes_,
-                        nms_threshold_, nms_top_k_, keep_top_k_,
-                        confidence_threshold_, &bbox_rects);
+    std::vector<BBox> bbox_rects;
+    for (int c = 1; c < num_classes_; ++c) {
+      bbox_rects.insert(bbox_rects.end(), class_boxes_[c].begin(),
+                        class_boxes_[c].end());
+    }
+    const int num_detected =
+        std::min(keep_top_k_, static_cast<int>(bbox_rects.size()));
+    std::partial_sort(bbox_rects.begin(), bbox_rects.begin() + num_detected,
+                      bbox_rects.end(), BBoxGreater);
+    bbox_rects.resize(num_detected);
 
     output->Clear();
     std::vector<index_t> output_shape = {1, 1,
@@ -226,6 +221,7 @@ class DetectionOutputOp<RuntimeType::RT_CPU, T> : public DetectionOutput {
     for (int i = 0; i < output_len; ++i) {
       auto *row = output_ptr + i * 7;
       auto &b = bbox_rects[i];
+      row[0] = 0;  // image id
       row[1] = b.label;
       row[2] = b.confidence;
       row[3] = b.xmin;
@@ -238,11 +234,94 @@ class DetectionOutputOp<RuntimeType::RT_CPU, T> : public DetectionOutput {
   }
 
  private:
+  // Decodes the boxes of the priors which score above the confidence
+  // threshold in some class, in the same pass that finds them. The boxes of
+  // the other priors are never looked at.
+  void DecodeBoxes(utils::ThreadPool *thread_pool,
+                   const float *loc_ptr,
+                   const float *conf_ptr,
+                   const float *pbox_ptr,
+                   const int num_prior) {
+    boxes_.Resize(num_prior);
+    active_.resize(num_prior);
+    float *xmin = boxes_.xmin.data();
+    float *ymin = boxes_.ymin.data();
+    float *xmax = boxes_.xmax.data();
+    float *ymax = boxes_.ymax.data();
+    uint8_t *active = active_.data();
+    const float *var_ptr = pbox_ptr + num_prior * 4;
+
+    thread_pool->Compute1D([=](index_t start, index_t end, index_t step) {
+      int priors[kDecodeBlockSize];
+      float exp_w[kDecodeBlockSize];
+      float exp_h[kDecodeBlockSize];
+      for (index_t b = start; b < end; b += step) {
+        const int begin = static_cast<int>(b) * kDecodeBlockSize;
+        const int block_end = std::min(begin + kDecodeBlockSize, num_prior);
+        int count = 0;
+        for (int i = begin; i < block_end; ++i) {
+          const float *conf = conf_ptr + i * num_classes_;
+          int is_active = 0;
+          for (int c = 1; c < num_classes_; ++c) {
+            is_active |= conf[c] > confidence_threshold_;
+          }
+          active[i] = static_cast<uint8_t>(is_active);
+          if (is_active) {
+            const float *lc = loc_ptr + i * 4;
+            const float *var = var_ptr + i * 4;
+            exp_w[count] = var[2] * lc[2];
+            exp_h[count] = var[3] * lc[3];
+            priors[count++] = i;
+          }
+        }
+        vector_math_->Exp(exp_w, count, exp_w);
+        vector_math_->Exp(exp_h, count, exp_h);
+        for (int k = 0; k < count; ++k) {
+          const int i = priors[k];
+          const float *lc = loc_ptr + i * 4;
+          const float *pb = pbox_ptr + i * 4;
+          const float *var = var_ptr + i * 4;
+
+          const float pb_w = pb[2] - pb[0];
+          const float pb_h = pb[3] - pb[1];
+          const float pb_cx = (pb[0] + pb[2]) * 0.5f;
+          const float pb_cy = (pb[1] + pb[3]) * 0.5f;
+
+          const float bbox_cx = var[0] * lc[0] * pb_w + pb_cx;
+          const float bbox_cy = var[1] * lc[1] * pb_h + pb_cy;
+          const float bbox_w = exp_w[k] * pb_w;
+          const float bbox_h = exp_h[k] * pb_h;
+
+          xmin[i] = bbox_cx - bbox_w * 0.5f;
+          ymin[i] = bbox_cy - bbox_h * 0.5f;
+          xmax[i] = bbox_cx + bbox_w * 0.5f;
+          ymax[i] = bbox_cy + bbox_h * 0.5f;
+        }
+      }
+    }, 0, RoundUpDiv(num_prior, kDecodeBlockSize), 1);
+
+    active_priors_.clear();
+    for (int i = 0; i < num_prior; ++i) {
+      if (active[i]) {
+        active_priors_.push_back(i);
+      }
+    }
+  }
+
+  static const int kDecodeBlockSize = 256;
+
   int num_classes_;
   float nms_threshold_;
   int nms_top_k_;
   int keep_top_k_;
   float confidence_threshold_;
+  std::unique_ptr<delegator::VectorMath> vector_math_;
+
+  // reused across runs
+  Boxes boxes_;
+  std::vector<uint8_t> active_;
+  std::vector<int> active_priors_;
+  std::vector<std::vector<BBox>> class_boxes_;
 };
 
 
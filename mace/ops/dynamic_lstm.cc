@@ -76,6 +76,11 @@ class DynamicLSTMOp<RuntimeType::RT_CPU, T> : public Operation {
         gemv_(delegator::Gemv::Create(
             context->workspace(),
             MACE_DELEGATOR_KEY(Gemv, RuntimeType::RT_CPU, T, kCpuImplType),
+            delegator::GemvParam())),
+        vector_math_(delegator::VectorMath::Create(
+            context->workspace(),
+            MACE_DELEGATOR_KEY(VectorMath, RuntimeType::RT_CPU,
+                               float, kCpuImplType),
             DelegatorParam())) {}
 
   inline void Validate() {
@@ -314,6 +319,7 @@ class DynamicLSTMOp<RuntimeType::RT_CPU, T> : public Operation {
         T *curr_cell_ptr = lstm_cell_ptr;
         // LSTMNonlinear
         LSTMNonlinearKernel<T>(context,
+                               vector_math_.get(),
                                affine_a_out_data,
                                lstm_cell_ptr,
                                nullptr,
@@ -387,6 +393,7 @@ class DynamicLSTMOp<RuntimeType::RT_CPU, T> : public Operation {
   std::vector<index_t> cell_cache_indexes_;
   std::vector<index_t> out_cache_indexes_;
   std::unique_ptr<delegator::Gemv> gemv_;
+  std::unique_ptr<delegator::VectorMath> vector_math_;
 
   MACE_OP_INPUT_TAGS(INPUT, PREV_OUT, PREV_CELL, WEIGHTS_A, PARAMS, WEIGHTS_B);
   MACE_OP_OUTPUT_TAGS(OUTPUT, OUT_CACHE, CELL_CACHE);
@@ -32,6 +32,9 @@
 #include "mace/core/tensor.h"
 #include "mace/utils/memory.h"
 #include "mace/core/quantize.h"
+#include "mace/ops/activation.h"
+#include "mace/ops/common/broadcast.h"
+#include "mace/ops/delegator/activation.h"
 #ifdef MACE_ENABLE_OPENCL
 #include "mace/ops/opencl/image/eltwise.h"
 #include "mace/runtimes/opencl/transform/buffer_transformer.h"
@@ -40,29 +43,6 @@
 namespace mace {
 namespace ops {
 
-inline index_t GetIndex(const std::vector<index_t> &shape,
-                        const std::vector<index_t> &index) {
-  index_t idx = 0;
-  for (size_t i = 0; i < shape.size(); ++i) {
-    if (shape[i] > 1) {
-      idx = idx * shape[i] + index[i];
-    }
-  }
-  return idx;
-}
-
-inline void IncreaseIndex(const std::vector<index_t> &shape,
-                          std::vector<index_t> *index) {
-  for (index_t i = static_cast<index_t>(shape.size()) - 1; i >= 0; --i) {
-    ++(*index)[i];
-    if ((*index)[i] >= shape[i]) {
-      (*index)[i] -= shape[i];
-    } else {
-      break;
-    }
-  }
-}
-
 template<typename T, typename DstType>
 inline void TensorGeneralBroadcastEltwise(
     const OpContext *context,
@@ -75,149 +55,101 @@ inline void TensorGeneralBroadcastEltwise(
     const std::vector<index_t> &input1_shape,
     const std::vector<index_t> &output_shape,
     DstType *output) {
-  MACE_UNUSED(context);
-
-  const index_t output_size = std::accumulate(
-      output_shape.begin(), output_shape.end(), 1, std::multiplies<index_t>());
-  std::vector<index_t> out_index(output_shape.size(), 0);
+  const BroadcastShape shape =
+      CollapseBroadcastShape(input0_shape, input1_shape, output_shape);
   switch (type) {
     case SUM:
       if (coeff.empty()) {
-        for (index_t i = 0; i < output_size; ++i) {
-          const index_t idx0 = GetIndex(input0_shape, out_index);
-          const index_t idx1 = GetIndex(input1_shape, out_index);
-          output[i] = input0[idx0] + input1[idx1];
-          IncreaseIndex(output_shape, &out_index);
-        }
+        BroadcastEltwise(context, shape, input0, input1, output,
+                         [](T a, T b) { return a + b; });
       } else {
-        std::vector<float> coeff_copy = coeff;
-        if (swapped) {
-          std::swap(coeff_copy[0], coeff_copy[1]);
-        }
-        for (index_t i = 0; i < output_size; ++i) {
-          const index_t idx0 = GetIndex(input0_shape, out_index);
-          const index_t idx1 = GetIndex(input1_shape, out_index);
-          output[i] =
-              input0[idx0] * coeff_copy[0] + input1[idx1] * coeff_copy[1];
-          IncreaseIndex(output_shape, &out_index);
-        }
+        const float coeff0 = swapped ? coeff[1] : coeff[0];
+        const float coeff1 = swapped ? coeff[0] : coeff[1];
+        BroadcastEltwise(context, shape, input0, input1, output,
+                         [=](T a, T b) { return a * coeff0 + b * coeff1; });
       }
       break;
     case SUB:
       if (!swapped) {
-        for (index_t i = 0; i < output_size; ++i) {
-          const index_t idx0 = GetIndex(input0_shape, out_index);
-          const index_t idx1 = GetIndex(input1_shape, out_index);
-          output[i] = input0[idx0] - input1[idx1];
-          IncreaseIndex(output_shape, &out_index);
-        }
+        BroadcastEltwise(context, shape, input0, input1, output,
+                         [](T a, T b) { return a - b; });
       } else {
-        for (index_t i = 0; i < output_size; ++i) {
-          const index_t idx0 = GetIndex(input0_shape, out_index);
-          const index_t idx1 = GetIndex(input1_shape, out_index);
-          output[i] = input1[idx1] - input0[idx0];
-          IncreaseIndex(output_shape, &out_index);
-        }
+        BroadcastEltwise(context, shape, input0, input1, output,
+                         [](T a, T b) { return b - a; });
       }
       break;
     case PROD:
-      for (index_t i = 0; i < output_size; ++i) {
-        const index_t idx0 = GetIndex(input0_shape, out_index);
-        const index_t idx1 = GetIndex(input1_shape, out_index);
-        output[i] = input0[idx0] * input1[idx1];
-        IncreaseIndex(output_shape, &out_index);
-      }
+      BroadcastEltwise(context, shape, input0, input1, output,
+                       [](T a, T b) { return a * b; });
       break;
     case DIV:
       if (!swapped) {
-        for (index_t i = 0; i < output_size; ++i) {
-          const index_t idx0 = GetIndex(input0_shape, out_index);
-          const index_t idx1 = GetIndex(input1_shape, out_index);
-          output[i] = input0[idx0] / input1[idx1];
-          IncreaseIndex(output_shape, &out_index);
-        }
+        BroadcastEltwise(context, shape, input0, input1, output,
+                         [](T a, T b) { return a / b; });
       } else {
-        for (index_t i = 0; i < output_size; ++i) {
-          const index_t idx0 = GetIndex(input0_shape, out_index);
-          const index_t idx1 = GetIndex(input1_shape, out_index);
-          output[i] = input1[idx1] / input0[idx0];
-          IncreaseIndex(output_shape, &out_index);
-        }
+        BroadcastEltwise(context, shape, input0, input1, output,
+                         [](T a, T b) { return b / a; });
       }
       break;
     case FLOOR_DIV:
       if (!swapped) {
-        for (index_t i = 0; i < output_size; ++i) {
-          const index_t idx0 = GetIndex(input0_shape, out_index);
-          const index_t idx1 = GetIndex(input1_shape, out_index);
-          output[i] = std::floor(input0[idx0] / input1[idx1]);
-          IncreaseIndex(output_shape, &out_index);
-        }
+        BroadcastEltwise(context, shape, input0, input1, output,
+                         [](T a, T b) { return std::floor(a / b); });
       } else {
-        for (index_t i = 0; i < output_size; ++i) {
-          const index_t idx0 = GetIndex(input0_shape, out_index);
-          const index_t idx1 = GetIndex(input1_shape, out_index);
-          output[i] = std::floor(input1[idx1] / input0[idx0]);
-          IncreaseIndex(output_shape, &out_index);
-        }
+        BroadcastEltwise(context, shape, input0, input1, output,
+                         [](T a, T b) { return std::floor(b / a); });
       }
       break;
     case MIN:
-      for (index_t i = 0; i < output_size; ++i) {
-        const index_t idx0 = GetIndex(input0_shape, out_index);
-        const index_t idx1 = GetIndex(input1_shape, out_index);
-        output[i] = std::min(input1[idx1], input0[idx0]);
-        IncreaseIndex(output_shape, &out_index);
-      }
+      BroadcastEltwise(context, shape, input0, input1, output,
+                       [](T a, T b) { return std::min(a, b); });
       break;
     case MAX:
-      for (index_t i = 0; i < output_size; ++i) {
-        const index_t idx0 = GetIndex(input0_shape, out_index);
-        const index_t idx1 = GetIndex(input1_shape, out_index);
-        output[i] = std::max(input1[idx1], input0[idx0]);
-        IncreaseIndex(output_shape, &out_index);
-      }
+      BroadcastEltwise(context, shape, input0, input1, output,
+                       [](T a, T b) { return std::max(a, b); });
       break;
     case SQR_DIFF:
-      for (index_t i = 0; i < output_size; ++i) {
-        const index_t idx0 = GetIndex(input0_shape, out_index);
-        const index_t idx1 = GetIndex(input1_shape, out_index);
-        output[i] = std::pow(input1[idx1] - input0[idx0], 2.f);
-        IncreaseIndex(output_shape, &out_index);
-      }
+      BroadcastEltwise(context, shape, input0, input1, output,
+                       [](T a, T b) { return (a - b) * (a - b); });
       break;
     case POW:
       if (!swapped) {
-        for (index_t i = 0; i < output_size; ++i) {
-          const index_t idx0 = GetIndex(input0_shape, out_index);
-          const index_t idx1 = GetIndex(input1_shape, out_index);
-          output[i] = std::pow(input0[idx0], input1[idx1]);
-          IncreaseIndex(output_shape, &out_index);
-        }
+        BroadcastEltwise(context, shape, input0, input1, output,
+                         [](T a, T b) { return std::pow(a, b); });
       } else {
-        for (index_t i = 0; i < output_size; ++i) {
-          const index_t idx0 = GetIndex(input0_shape, out_index);
-          const index_t idx1 = GetIndex(input1_shape, out_index);
-          output[i] = std::pow(input1[idx1], input0[idx0]);
-          IncreaseIndex(output_shape, &out_index);
-        }
+        BroadcastEltwise(context, shape, input0, input1, output,
+                         [](T a, T b) { return std::pow(b, a); });
       }
       break;
+    case NEG:
+      BroadcastEltwise(context, shape, input0, input1, output,
+                       [](T a, T) { return -a; });
+      break;
+    case ABS:
+      BroadcastEltwise(context, shape, input0, input1, output,
+                       [](T a, T) { return std::fabs(a); });
+      break;
     case EQUAL:
-      for (index_t i = 0; i < output_size; ++i) {
-        const index_t idx0 = GetIndex(input0_shape, out_index);
-        const index_t idx1 = GetIndex(input1_shape, out_index);
-        output[i] = input1[idx1] == input0[idx0];
-        IncreaseIndex(output_shape, &out_index);
-      }
+      BroadcastEltwise(context, shape, input0, input1, output,
+                       [](T a, T b) { return a == b; });
       break;
     case NOT_EQUAL:
-      for (index_t i = 0; i < output_size; ++i) {
-        const index_t idx0 = GetIndex(input0_shape, out_index);
-        const index_t idx1 = GetIndex(input1_shape, out_index);
-        output[i] = input1[idx1] != input0[idx0];
-        IncreaseIndex(output_shape, &out_index);
-      }
+      BroadcastEltwise(context, shape, input0, input1, output,
+                       [](T a, T b) { return a != b; });
+      break;
+    case CLIP: {
+      const float min_value = coeff[0];
+      const float max_value = coeff[1];
+      BroadcastEltwise(context, shape, input0, input1, output,
+                       [=](T a, T) {
+                         return std::fmaxf(min_value,
+                                           std::fminf(max_value, a));
+                       });
+      break;
+    }
+    case SIGN:
+      BroadcastEltwise(context, shape, input0, input1, output,
+                       [](T a, T) { return Sign(a); });
       break;
     default:LOG(FATAL) << "Eltwise op not support type " << type;
   }
@@ -960,6 +892,21 @@ class EltwiseOp : public Operation {
         has_data_format_(Operation::GetOptionalArg<int>(
             "has_data_format", 0)) {
     is_fallback_ = context->IsFallback();
+    // fused by the graph passes of NetOptimizer
+    ActivationType activation = ops::StringToActivationType(
+        Operation::GetOptionalArg<std::string>("activation", "NOOP"));
+    if (activation != ActivationType::NOOP) {
+      activation_delegator_ = delegator::Activation::Create(
+          context->workspace(),
+          MACE_DELEGATOR_KEY(Activation, RuntimeType::RT_CPU,
+                             T, kCpuImplType),
+          delegator::ActivationParam(
+              activation,
+              Operation::GetOptionalArg<float>("max_limit", 0.f),
+              Operation::GetOptionalArg<float>("activation_coefficient", 0.f),
+              Operation::GetOptionalArg<float>("hardsigmoid_alpha", 0.f),
+              Operation::GetOptionalArg<float>("hardsigmoid_beta", 0.f)));
+    }
   }
 
   MaceStatus Run(OpContext *context) override {
@@ -990,9 +937,12 @@ class EltwiseOp : public Operation {
     if (IsLogicalType(type_)) {
       // as we do not have bool-type tensor, we use int type
       return DoEltwise<int32_t>(context, input0, input1, output);
-    } else {
-      return DoEltwise<T>(context, input0, input1, output);
     }
+    MACE_RETURN_IF_ERROR(DoEltwise<T>(context, input0, input1, output));
+    if (activation_delegator_ != nullptr) {
+      activation_delegator_->Compute(context, output, output);
+    }
+    return MaceStatus::MACE_SUCCESS;
   }
 
  private:
@@ -1062,7 +1012,13 @@ class EltwiseOp : public Operation {
     const T *input0_ptr = input0->data<T>();
     const T *input1_ptr = input1->data<T>();
     if (has_data_format_ && input0->dim_size() == 4 && input1->dim_size() > 0) {
-      MACE_RETURN_IF_ERROR(output->ResizeLike(input0));
+      std::vector<index_t> output_shape = input0->shape();
+      if (input1->dim_size() == 4 && input1->size() < input0->size()) {
+        for (size_t i = 0; i < output_shape.size(); ++i) {
+          output_shape[i] = std::max(output_shape[i], input1->dim(i));
+        }
+      }
+      MACE_RETURN_IF_ERROR(output->Resize(output_shape));
       DstType *output_ptr = output->mutable_data<DstType>();
       if (input1->dim_size() < input0->dim_size()) {
         TensorEltwisePerChannel(context,
@@ -1141,6 +1097,7 @@ class EltwiseOp : public Operation {
   int has_data_format_;
   bool is_fallback_;
   std::unique_ptr<Tensor> scalar_tensor_;
+  std::unique_ptr<delegator::Activation> activation_delegator_;
 };
 
 #ifdef MACE_ENABLE_QUANTIZE
@@ -1166,20 +1123,52 @@ class EltwiseOp<RuntimeType::RT_CPU, uint8_t> : public Operation {
                         static_cast<int>(ops::EltwiseType::NONE)))))) {}
 
   MaceStatus Run(OpContext *context) override {
-    MACE_UNUSED(context);
     const Tensor *input0 = this->Input(0);
     MACE_CHECK(this->InputSize() == 2,
-               "Quantized Elementwise don't support broadcast now.");
+               "Quantized Elementwise needs two inputs.");
     const Tensor *input1 = this->Input(1);
     Tensor *output = this->Output(0);
     MACE_CHECK(type_ == SUM || type_ == SUB,
                "Quantized Elementwise only support SUM and SUB now.");
-    MACE_CHECK(input0->size() == input1->size(),
-               "input0 and input1 must have the same shape.");
     MACE_CHECK(output->scale() != 0);
-    MACE_RETURN_IF_ERROR(output->Resize(input0->shape()));
+    if (input0->shape() == input1->shape()) {
+      MACE_RETURN_IF_ERROR(output->Resize(input0->shape()));
+      return eltwise_delegator_->Compute(context, input0, input1, output);
+    }
 
-    return eltwise_delegator_->Compute(context, input0, input1, output);
+    const index_t rank = std::max(input0->dim_size(), input1->dim_size());
+    std::vector<index_t> output_shape(rank, 1);
+    for (index_t i = 0; i < rank; ++i) {
+      const index_t back = rank - i;
+      if (back <= input0->dim_size()) {
+        output_shape[i] = input0->dim(input0->dim_size() - back);
+      }
+      if (back <= input1->dim_size()) {
+        output_shape[i] = std::max(output_shape[i],
+                                   input1->dim(input1->dim_size() - back));
+      }
+    }
+    const BroadcastShape shape = CollapseBroadcastShape(
+        input0->shape(), input1->shape(), output_shape);
+    MACE_RETURN_IF_ERROR(output->Resize(output_shape));
+
+    const float scale0 = input0->scale();
+    const int32_t zero_point0 = input0->zero_point();
+    // SUB is SUM with the second input negated
+    const float scale1 = type_ == SUM ? input1->scale() : -input1->scale();
+    const int32_t zero_point1 = input1->zero_point();
+    const float output_scale = output->scale();
+    const int32_t output_zero_point = output->zero_point();
+    BroadcastEltwise(context, shape, input0->data<uint8_t>(),
+                     input1->data<uint8_t>(),
+                     output->mutable_data<uint8_t>(),
+                     [=](uint8_t a, uint8_t b) {
+                       return Quantize<uint8_t>(
+                           scale0 * (a - zero_point0) +
+                               scale1 * (b - zero_point1),
+                           output_scale, output_zero_point);
+                     });
+    return MaceStatus::MACE_SUCCESS;
   }
 
  private:
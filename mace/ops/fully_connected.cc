@@ -21,9 +21,15 @@
 #include "mace/core/registry/ops_registry.h"
 #include "mace/core/tensor.h"
 #include "mace/ops/activation.h"
+#include "mace/ops/common/epilogue.h"
 #include "mace/ops/delegator/activation.h"
 #include "mace/ops/delegator/gemv.h"
 
+#ifdef MACE_ENABLE_QUANTIZE
+#include "mace/ops/common/gemmlowp_util.h"
+#include "mace/ops/delegator/gemm.h"
+#endif  // MACE_ENABLE_QUANTIZE
+
 #ifdef MACE_ENABLE_OPENCL
 #include "mace/ops/opencl/image/fully_connected.h"
 #include "mace/runtimes/opencl/transform/buffer_transformer.h"
@@ -46,6 +52,22 @@ class FullyConnectedOpBase : public Operation {
         activation_coefficient_(Operation::GetOptionalArg<float>(
             "activation_coefficient", 0.0f)) {}
  protected:
+  // The activation for the gemv to fuse, empty if it can't be fused.
+  Epilogue GetFusedEpilogue() const {
+    Epilogue epilogue;
+    if (!CanFuseActivation(activation_)) {
+      return epilogue;
+    }
+    epilogue.activation = activation_;
+    epilogue.max_limit = relux_max_limit_;
+    epilogue.activation_coefficient = activation_coefficient_;
+    epilogue.hardsigmoid_alpha =
+        Operation::GetOptionalArg<float>("hardsigmoid_alpha", 0.f);
+    epilogue.hardsigmoid_beta =
+        Operation::GetOptionalArg<float>("hardsigmoid_beta", 0.f);
+    return epilogue;
+  }
+
   const ActivationType activation_;
   const float relux_max_limit_;
   const float activation_coefficient_;
@@ -77,7 +99,7 @@ class FullyConnectedOp<RuntimeType::RT_CPU, T> : public FullyConnectedOpBase {
         gemv_(delegator::Gemv::Create(
             context->workspace(),
             MACE_DELEGATOR_KEY(Gemv, RuntimeType::RT_CPU, T, kCpuImplType),
-            DelegatorParam())) {}
+            delegator::GemvParam(GetFusedEpilogue()))) {}
 
   MaceStatus Run(OpContext *context) override {
     MACE_UNUSED(context);
@@ -115,7 +137,9 @@ class FullyConnectedOp<RuntimeType::RT_CPU, T> : public FullyConnectedOpBase {
                    true,
                    output);
 
-    activation_delegator_->Compute(context, output, output);
+    if (!CanFuseActivation(activation_)) {
+      activation_delegator_->Compute(context, output, output);
+    }
 
     return MaceStatus::MACE_SUCCESS;
   }
@@ -136,7 +160,8 @@ class FullyConnectedOp<RuntimeType::RT_CPU, uint8_t>
             context->workspace(),
             MACE_DELEGATOR_KEY(Gemv, RuntimeType::RT_CPU,
                                uint8_t, kCpuImplType),
-            DelegatorParam())) {}
+            delegator::GemvParam())),
+        use_gemm_(!UseGemmlowp()) {}
 
   MaceStatus Run(OpContext *context) override {
     const Tensor *input = this->Input(INPUT);
@@ -165,6 +190,27 @@ class FullyConnectedOp<RuntimeType::RT_CPU, uint8_t>
     const int input_size =
         static_cast<int>(weight->dim(1) * weight->dim(2) * weight->dim(3));
     const int output_size = static_cast<int>(weight->dim(0));
+    // gemv and gemmlowp have no int8 weight quantized per channel
+    const bool int8_weight = weight->dtype() == DT_INT8;
+    if (int8_weight || (batch > 1 && use_gemm_)) {
+      // weight [output_size, input_size] * input^T [input_size, batch]
+      if (gemm_ == nullptr) {
+        Epilogue epilogue;
+        epilogue.bias = bias;
+        if (int8_weight) {
+          epilogue.activation = activation_;
+          epilogue.max_limit = relux_max_limit_;
+        }
+        gemm_ = delegator::Gemm::Create(
+            context->workspace(),
+            MACE_DELEGATOR_KEY(Gemm, RuntimeType::RT_CPU, uint8_t,
+                               kCpuImplType),
+            delegator::GemmParam(true, epilogue));
+      }
+      return gemm_->Compute(context, weight, input, 1, output_size, batch,
+                            input_size, RowMajor, ColMajor, ColMajor, false,
+                            false, output);
+    }
     gemv_->Compute(context,
                   weight,
                   input,
@@ -180,6 +226,10 @@ class FullyConnectedOp<RuntimeType::RT_CPU, uint8_t>
 
  private:
   std::unique_ptr<delegator::Gemv> gemv_;
+  // Used for int8 weights, and for batch > 1 unless running on gemmlowp,
+  // see UseGemmlowp()
+  const bool use_gemm_;
+  std::unique_ptr<delegator::Gemm> gemm_;
 };
 #endif  // MACE_ENABLE_QUANTIZE
 
@@ -0,0 +1,78 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// KVCacheAppend appends its input along `axis` to its output, a state of
+// the workspace which keeps the entries of the previous runs, e.g. the keys
+// or values of the tokens a decoder has seen. The output always has
+// `capacity` entries along `axis`, the blocks of the dims before it at
+// capacity stride, so a run copies only the new entries. The number of live
+// entries is Workspace::StateLength(), which Attention reads to skip the
+// others. The ops which would read them, i.e. which do not override
+// Operation::ReadsStates(), may not take the output as input.
+
+#include "mace/core/ops/op_init_context.h"
+#include "mace/core/ops/operator.h"
+#include "mace/core/registry/ops_registry.h"
+
+namespace mace {
+namespace ops {
+
+template<RuntimeType D, class T>
+class KVCacheAppendOp;
+
+template<class T>
+class KVCacheAppendOp<RuntimeType::RT_CPU, T> : public Operation {
+ public:
+  explicit KVCacheAppendOp(OpConstructContext *context)
+      : Operation(context),
+        axis_(Operation::GetOptionalArg<int>("axis", -2)),
+        capacity_(Operation::GetOptionalArg<int>("capacity", 0)) {}
+
+  MaceStatus Init(OpInitContext *context) override {
+    MACE_CHECK(capacity_ > 0, "KVCacheAppend needs a positive capacity");
+    context->workspace()->CreateState(
+        operator_def_->output(OUTPUT),
+        context->GetRuntimeByMemType(MemoryType::CPU_BUFFER),
+        DataTypeToEnum<T>::value, axis_, capacity_);
+    return Operation::Init(context);
+  }
+
+  MaceStatus Run(OpContext *context) override {
+    const Tensor *input = this->Input(INPUT);
+    Tensor *output = this->Output(OUTPUT);
+
+    Tensor::MappingGuard input_guard(input);
+    return context->workspace()->AppendState(output->name(), input->shape(),
+                                             input->raw_data());
+  }
+
+ private:
+  int axis_;
+  index_t capacity_;
+
+  MACE_OP_INPUT_TAGS(INPUT);
+  MACE_OP_OUTPUT_TAGS(OUTPUT);
+};
+
+void RegisterKVCacheAppend(OpRegistry *op_registry) {
+  MACE_REGISTER_OP(op_registry, "KVCacheAppend", KVCacheAppendOp,
+                   RuntimeType::RT_CPU, float);
+  MACE_REGISTER_BF16_OP(op_registry, "KVCacheAppend", KVCacheAppendOp,
+                        RuntimeType::RT_CPU);
+  MACE_REGISTER_FP16_OP(op_registry, "KVCacheAppend", KVCacheAppendOp,
+                        RuntimeType::RT_CPU);
+}
+
+}  // namespace ops
+}  // namespace mace
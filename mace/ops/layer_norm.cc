@@ -0,0 +1,211 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// LayerNorm normalizes every row of the dims from `axis` to the last one:
+//   y = (x - mean) / sqrt(variance + epsilon) * gamma + beta,
+// and with `rms` set, as RMSNorm does, without centering:
+//   y = x / sqrt(mean(x^2) + epsilon) * gamma + beta.
+// gamma and beta are optional inputs of the size of a row.
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include "mace/core/ops/operator.h"
+#include "mace/core/registry/ops_registry.h"
+
+namespace mace {
+namespace ops {
+
+namespace {
+// interleaved parts of a row accumulated apart, so that they vectorize
+constexpr index_t kLanes = 8;
+
+// Mean and (biased) variance of a row with Welford's algorithm on each lane,
+// the lanes merged at the end with the formula of Chan et al.
+template<typename T>
+void RowMoments(const T *data, const index_t size,
+                float *mean, float *variance) {
+  float lane_mean[kLanes] = {0.f};
+  float lane_m2[kLanes] = {0.f};
+  const index_t steps = size / kLanes;
+  for (index_t s = 0; s < steps; ++s) {
+    const T *block = data + s * kLanes;
+    const float inv_count = 1.f / static_cast<float>(s + 1);
+    for (index_t l = 0; l < kLanes; ++l) {
+      const float x = static_cast<float>(block[l]);
+      const float delta = x - lane_mean[l];
+      lane_mean[l] += delta * inv_count;
+      lane_m2[l] += delta * (x - lane_mean[l]);
+    }
+  }
+
+  // the lanes have the same count
+  float row_mean = 0.f;
+  float row_m2 = 0.f;
+  if (steps > 0) {
+    for (index_t l = 0; l < kLanes; ++l) {
+      row_mean += lane_mean[l];
+    }
+    row_mean /= kLanes;
+    for (index_t l = 0; l < kLanes; ++l) {
+      const float delta = lane_mean[l] - row_mean;
+      row_m2 += lane_m2[l] + delta * delta * steps;
+    }
+  }
+  for (index_t i = steps * kLanes; i < size; ++i) {
+    const float x = static_cast<float>(data[i]);
+    const float delta = x - row_mean;
+    row_mean += delta / static_cast<float>(i + 1);
+    row_m2 += delta * (x - row_mean);
+  }
+  *mean = row_mean;
+  *variance = row_m2 / size;
+}
+
+template<typename T>
+float RowMeanSquare(const T *data, const index_t size) {
+  float lane_sum[kLanes] = {0.f};
+  const index_t steps = size / kLanes;
+  for (index_t s = 0; s < steps; ++s) {
+    const T *block = data + s * kLanes;
+    for (index_t l = 0; l < kLanes; ++l) {
+      const float x = static_cast<float>(block[l]);
+      lane_sum[l] += x * x;
+    }
+  }
+  float sum = 0.f;
+  for (index_t l = 0; l < kLanes; ++l) {
+    sum += lane_sum[l];
+  }
+  for (index_t i = steps * kLanes; i < size; ++i) {
+    const float x = static_cast<float>(data[i]);
+    sum += x * x;
+  }
+  return sum / size;
+}
+
+// output = (input - mean) * scale * gamma + beta, centered before it is
+// scaled so that a large mean does not cost the precision of the output
+template<typename T>
+void NormalizeRow(const T *input, const index_t size, const float mean,
+                  const float scale, const T *gamma, const T *beta,
+                  T *output) {
+  if (gamma != nullptr && beta != nullptr) {
+    for (index_t i = 0; i < size; ++i) {
+      output[i] = (static_cast<float>(input[i]) - mean) * scale *
+          static_cast<float>(gamma[i]) + static_cast<float>(beta[i]);
+    }
+  } else if (gamma != nullptr) {
+    for (index_t i = 0; i < size; ++i) {
+      output[i] = (static_cast<float>(input[i]) - mean) * scale *
+          static_cast<float>(gamma[i]);
+    }
+  } else if (beta != nullptr) {
+    for (index_t i = 0; i < size; ++i) {
+      output[i] = (static_cast<float>(input[i]) - mean) * scale +
+          static_cast<float>(beta[i]);
+    }
+  } else {
+    for (index_t i = 0; i < size; ++i) {
+      output[i] = (static_cast<float>(input[i]) - mean) * scale;
+    }
+  }
+}
+}  // namespace
+
+template<RuntimeType D, class T>
+class LayerNormOp;
+
+template<class T>
+class LayerNormOp<RuntimeType::RT_CPU, T> : public Operation {
+ public:
+  explicit LayerNormOp(OpConstructContext *context)
+      : Operation(context),
+        axis_(Operation::GetOptionalArg<int>("axis", -1)),
+        epsilon_(Operation::GetOptionalArg<float>("epsilon", 1e-5f)),
+        rms_(Operation::GetOptionalArg<bool>("rms", false)) {}
+
+  MaceStatus Run(OpContext *context) override {
+    const Tensor *input = this->Input(INPUT);
+    const Tensor *gamma =
+        this->InputSize() > GAMMA ? this->Input(GAMMA) : nullptr;
+    const Tensor *beta = this->InputSize() > BETA ? this->Input(BETA) : nullptr;
+    Tensor *output = this->Output(OUTPUT);
+
+    const index_t rank = input->dim_size();
+    const index_t axis = axis_ < 0 ? axis_ + rank : axis_;
+    MACE_CHECK(axis >= 0 && axis < rank, "LayerNorm axis ", axis_,
+               " is out of the range of rank ", rank);
+    const std::vector<index_t> &shape = input->shape();
+    const index_t rows = std::accumulate(shape.begin(), shape.begin() + axis,
+                                         1, std::multiplies<index_t>());
+    const index_t size = std::accumulate(shape.begin() + axis, shape.end(),
+                                         1, std::multiplies<index_t>());
+    MACE_CHECK(gamma == nullptr || gamma->size() == size,
+               "LayerNorm gamma should have ", size, " elements");
+    MACE_CHECK(beta == nullptr || beta->size() == size,
+               "LayerNorm beta should have ", size, " elements");
+    MACE_RETURN_IF_ERROR(output->ResizeLike(input));
+
+    const T *input_data = input->data<T>();
+    const T *gamma_data = gamma == nullptr ? nullptr : gamma->data<T>();
+    const T *beta_data = beta == nullptr ? nullptr : beta->data<T>();
+    T *output_data = output->mutable_data<T>();
+    const float epsilon = epsilon_;
+    const bool rms = rms_;
+
+    utils::ThreadPool &thread_pool = context->runtime()->thread_pool();
+    thread_pool.Compute1D([=](index_t start, index_t end, index_t step) {
+      for (index_t r = start; r < end; r += step) {
+        const T *input_row = input_data + r * size;
+        float mean = 0.f;
+        float variance = 0.f;
+        if (rms) {
+          variance = RowMeanSquare(input_row, size);
+        } else {
+          RowMoments(input_row, size, &mean, &variance);
+        }
+        const float scale = 1.f / std::sqrt(variance + epsilon);
+        NormalizeRow(input_row, size, mean, scale, gamma_data,
+                     beta_data, output_data + r * size);
+      }
+    }, 0, rows, 1);
+
+    return MaceStatus::MACE_SUCCESS;
+  }
+
+ private:
+  int axis_;
+  float epsilon_;
+  bool rms_;
+
+  MACE_OP_INPUT_TAGS(INPUT, GAMMA, BETA);
+  MACE_OP_OUTPUT_TAGS(OUTPUT);
+};
+
+void RegisterLayerNorm(OpRegistry *op_registry) {
+  MACE_REGISTER_OP(op_registry, "LayerNorm", LayerNormOp,
+                   RuntimeType::RT_CPU, float);
+  MACE_REGISTER_BF16_OP(op_registry, "LayerNorm", LayerNormOp,
+                        RuntimeType::RT_CPU);
+  MACE_REGISTER_FP16_OP(op_registry, "LayerNorm", LayerNormOp,
+                        RuntimeType::RT_CPU);
+}
+
+}  // namespace ops
+}  // namespace mace
@@ -32,7 +32,12 @@ template<typename T>
 class LSTMNonlinearOp<RuntimeType::RT_CPU, T> : public Operation {
  public:
   explicit LSTMNonlinearOp(OpConstructContext *context)
-      : Operation(context) {}
+      : Operation(context),
+        vector_math_(delegator::VectorMath::Create(
+            context->workspace(),
+            MACE_DELEGATOR_KEY(VectorMath, RuntimeType::RT_CPU,
+                               float, kCpuImplType),
+            DelegatorParam())) {}
 
   MaceStatus Run(OpContext *context) override {
     MACE_UNUSED(context);
@@ -79,6 +84,7 @@ class LSTMNonlinearOp<RuntimeType::RT_CPU, T> : public Operation {
       T *output_cell = output_data + r * output_dim;
       T *output_row = output_cell + cell_dim;
       LSTMNonlinearKernel<T>(context,
+                             vector_math_.get(),
                              input_row,
                              prev_row,
                              scale_data,
@@ -94,6 +100,8 @@ class LSTMNonlinearOp<RuntimeType::RT_CPU, T> : public Operation {
   }
 
  protected:
+  std::unique_ptr<delegator::VectorMath> vector_math_;
+
   MACE_OP_INPUT_TAGS(INPUT, PARAMS);
   MACE_OP_OUTPUT_TAGS(OUTPUT);
 };
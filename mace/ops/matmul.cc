@@ -105,7 +105,7 @@ class MatMulOp<RT_CPU, T> : public MatMulOpBase {
         gemv_(delegator::Gemv::Create(
             context->workspace(),
             MACE_DELEGATOR_KEY(Gemv, RuntimeType::RT_CPU, T, kCpuImplType),
-            DelegatorParam())) {}
+            delegator::GemvParam())) {}
 
   MaceStatus Run(OpContext *context) override {
     Validate();
@@ -397,7 +397,19 @@ template<>
 class MatMulOp<RuntimeType::RT_CPU, uint8_t> : public MatMulOpBase {
  public:
   explicit MatMulOp(OpConstructContext *context)
-      : MatMulOpBase(context) {}
+      : MatMulOpBase(context),
+        output_int32_(!operator_def_->output_type().empty()
+                          && operator_def_->output_type()[0] == DT_INT32) {
+    if (!UseGemmlowp()) {
+      const auto key = output_int32_ ?
+          MACE_DELEGATOR_KEY(Gemm, RuntimeType::RT_CPU, int32_t,
+                             kCpuImplType) :
+          MACE_DELEGATOR_KEY(Gemm, RuntimeType::RT_CPU, uint8_t,
+                             kCpuImplType);
+      gemm_ = delegator::Gemm::Create(context->workspace(), key,
+                                      delegator::GemmParam(true));
+    }
+  }
 
   MaceStatus Run(OpContext *context) override {
     Validate();
@@ -446,6 +458,20 @@ class MatMulOp<RuntimeType::RT_CPU, uint8_t> : public MatMulOpBase {
 
     MACE_RETURN_IF_ERROR(C->Resize(output_shape));
 
+    if (rhs->dtype() == DT_INT8) {
+      return RunPerChannel(context, lhs, rhs, batch, rows, depth, cols, C);
+    }
+
+    if (gemm_ != nullptr) {
+      if (output_int32_) {
+        C->SetScale(lhs->scale() * rhs->scale());
+        C->SetZeroPoint(0);
+      }
+      return gemm_->Compute(context, lhs, rhs, batch, lhs_rows, lhs_cols,
+                            rhs_rows, rhs_cols, transpose_a_, transpose_b_,
+                            false, lhs_batched, rhs_batched, C);
+    }
+
     constexpr gemmlowp::MapOrder kRowMajor = gemmlowp::MapOrder::RowMajor;
     constexpr gemmlowp::MapOrder kColMajor = gemmlowp::MapOrder::ColMajor;
 
@@ -468,8 +494,7 @@ class MatMulOp<RuntimeType::RT_CPU, uint8_t> : public MatMulOpBase {
       }                                                         \
     }
 
-    if (!operator_def_->output_type().empty()
-        && operator_def_->output_type()[0] == DT_INT32) {
+    if (output_int32_) {
       MATMUL_FIXPOINT_IMPL_TRANSPOSE_OR_NOT(int32_t);
     } else {
       MATMUL_FIXPOINT_IMPL_TRANSPOSE_OR_NOT(uint8_t);
@@ -480,6 +505,50 @@ class MatMulOp<RuntimeType::RT_CPU, uint8_t> : public MatMulOpBase {
 
     return MaceStatus::MACE_SUCCESS;
   }
+
+ private:
+  // rhs is a 2D weight quantized per output column, computed as
+  // rhs^T [cols, depth] * lhs^T [depth, rows] so that its columns are the
+  // per channel rows of the gemm, the output is then C^T in col-major.
+  MaceStatus RunPerChannel(OpContext *context,
+                           const Tensor *lhs,
+                           const Tensor *rhs,
+                           const index_t batch,
+                           const index_t rows,
+                           const index_t depth,
+                           const index_t cols,
+                           Tensor *C) {
+    MACE_CHECK(rhs->dim_size() == 2,
+               "int8 rhs of MatMul should be a 2D weight");
+    MACE_CHECK(operator_def_->output_type().empty()
+                   || operator_def_->output_type()[0] == DT_UINT8,
+               "MatMul with int8 rhs only outputs uint8");
+    if (per_channel_gemm_ == nullptr) {
+      Epilogue epilogue;
+      epilogue.bias = this->InputSize() >= 3 ? this->Input(BIAS) : nullptr;
+      per_channel_gemm_ = delegator::Gemm::Create(
+          context->workspace(),
+          MACE_DELEGATOR_KEY(Gemm, RuntimeType::RT_CPU, uint8_t,
+                             kCpuImplType),
+          delegator::GemmParam(true, epilogue));
+    }
+    const MatrixMajor rhs_major = transpose_b_ ? RowMajor : ColMajor;
+    if (transpose_a_) {
+      return per_channel_gemm_->Compute(context, rhs, lhs, batch, cols, rows,
+                                        depth, rhs_major, RowMajor, ColMajor,
+                                        false, true, C);
+    }
+    // the batches of lhs are consecutive columns of lhs^T
+    return per_channel_gemm_->Compute(context, rhs, lhs, 1, cols,
+                                      batch * rows, depth, rhs_major,
+                                      ColMajor, ColMajor, false, false, C);
+  }
+
+  const bool output_int32_;
+  // nullptr when running on gemmlowp, see UseGemmlowp()
+  std::unique_ptr<delegator::Gemm> gemm_;
+  // for an int8 rhs, whatever the gemmlowp choice
+  std::unique_ptr<delegator::Gemm> per_channel_gemm_;
 };
 #endif  // MACE_ENABLE_QUANTIZE
 
@@ -14,12 +14,61 @@
 
 #include <algorithm>
 
+#include "mace/ops/common/vector_math.h"
 #include "mace/ops/delegator/activation.h"
 
 namespace mace {
 namespace ops {
 namespace ref {
 
+namespace {
+
+// float goes through the polynomial approximations of vector_math, which are
+// faster than the libm calls
+template<typename T>
+void Tanh(const T *input, const index_t size, T *output) {
+  for (index_t i = 0; i < size; ++i) {
+    output[i] = std::tanh(input[i]);
+  }
+}
+
+void Tanh(const float *input, const index_t size, float *output) {
+  vector_math::Map<vector_math::VecRef>(
+      input, size, output, vector_math::TanhFunc<vector_math::VecRef>());
+}
+
+template<typename T>
+void Sigmoid(const T *input, const index_t size, T *output) {
+  for (index_t i = 0; i < size; ++i) {
+    output[i] = 1 / (1 + std::exp(-input[i]));
+  }
+}
+
+void Sigmoid(const float *input, const index_t size, float *output) {
+  vector_math::Map<vector_math::VecRef>(
+      input, size, output, vector_math::SigmoidFunc<vector_math::VecRef>());
+}
+
+template<typename T>
+void Elu(const T *input, const index_t size, const float alpha, T *output) {
+  for (index_t i = 0; i < size; ++i) {
+    const auto in_val = input[i];
+    if (in_val < 0) {
+      output[i] = (std::exp(in_val) - 1) * alpha;
+    } else {
+      output[i] = in_val;
+    }
+  }
+}
+
+void Elu(const float *input, const index_t size, const float alpha,
+         float *output) {
+  vector_math::Map<vector_math::VecRef>(
+      input, size, output, vector_math::EluFunc<vector_math::VecRef>(alpha));
+}
+
+}  // namespace
+
 template<typename T>
 class Activation : public delegator::Activation {
  public:
@@ -88,17 +137,12 @@ void Activation<T>::DoActivation(const OpContext *context,
     }
 
     case TANH: {
-      for (index_t i = 0; i < size; ++i) {
-        *output_ptr++ = std::tanh(*input_ptr++);
-      }
-
+      Tanh(input_ptr, size, output_ptr);
       break;
     }
 
     case SIGMOID: {
-      for (index_t i = 0; i < size; ++i) {
-        *output_ptr++ = 1 / (1 + std::exp(-(*input_ptr++)));
-      }
+      Sigmoid(input_ptr, size, output_ptr);
       break;
     }
 
@@ -111,15 +155,7 @@ void Activation<T>::DoActivation(const OpContext *context,
     }
 
     case ELU: {
-      for (index_t i = 0; i < input->size(); ++i) {
-        const auto in_val = *input_ptr++;
-        if (in_val < 0) {
-          *output_ptr = (std::exp(in_val) - 1) * activation_coefficient_;
-        } else {
-          *output_ptr = in_val;
-        }
-        output_ptr++;
-      }
+      Elu(input_ptr, size, activation_coefficient_, output_ptr);
       break;
     }
 
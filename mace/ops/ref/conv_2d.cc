@@ -14,6 +14,7 @@
 
 #include <vector>
 
+#include "mace/ops/common/apply_epilogue.h"
 #include "mace/ops/delegator/conv_2d.h"
 
 namespace mace {
@@ -31,6 +32,8 @@ class Conv2d : public delegator::Conv2d {
       const Tensor *input,
       const Tensor *filter,
       Tensor *output) override;
+
+  bool FusesEpilogue() const override { return true; }
 };
 
 template<typename T>
@@ -116,6 +119,11 @@ MaceStatus Conv2d<T>::Compute(const OpContext *context,
           out_ptr_base[h * out_width + w] = sum;
         }  // w
       }  // h
+
+      if (!epilogue_.empty()) {
+        ApplyEpilogueToPlane<vector_math::VecRef>(epilogue_, out_shape, m,
+                                                  out_width, out_ptr_base);
+      }
     }  // m
   }  // b
   return MaceStatus::MACE_SUCCESS;
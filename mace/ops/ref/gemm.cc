@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "mace/ops/common/apply_epilogue.h"
 #include "mace/ops/delegator/gemm.h"
 
 namespace mace {
@@ -69,6 +70,8 @@ MaceStatus Gemm<T>::Compute(const OpContext *context,
                             const bool rhs_batched,
                             Tensor *output) {
   MACE_UNUSED(context);
+  MACE_CHECK(epilogue_.empty() || output_major == RowMajor,
+             "Gemm epilogue needs a row-major output");
   const T *lhs_data = lhs->data<T>();
   const T *rhs_data = rhs->data<T>();
   T *output_data = output->mutable_data<T>();
@@ -99,6 +102,10 @@ MaceStatus Gemm<T>::Compute(const OpContext *context,
 
         *output_matrix.data(r, c) = sum;
       }  // c
+      if (!epilogue_.empty()) {
+        ApplyEpilogue<vector_math::VecRef>(epilogue_, r, cols,
+                                           output_matrix.data(r, 0));
+      }
     }  // r
   }   // b
 
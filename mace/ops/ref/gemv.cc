@@ -13,6 +13,10 @@
 // limitations under the License.
 
 
+#include <vector>
+
+#include "mace/core/compressed_weight.h"
+#include "mace/ops/common/apply_epilogue.h"
 #include "mace/ops/delegator/gemv.h"
 
 #if defined(MACE_ENABLE_QUANTIZE)
@@ -26,7 +30,8 @@ namespace ref {
 template<typename T>
 class Gemv : public delegator::Gemv {
  public:
-  explicit Gemv(const DelegatorParam &param) : delegator::Gemv(param) {}
+  explicit Gemv(const delegator::GemvParam &param)
+      : delegator::Gemv(param) {}
   ~Gemv() {}
   // Always row-major after transpose
   MaceStatus Compute(
@@ -54,6 +59,9 @@ MaceStatus Gemv<T>::Compute(const OpContext *context,
                                 const bool rhs_batched,
                                 Tensor *output) {
   MACE_UNUSED(context);
+  // a compressed weight is converted row by row
+  const bool compressed = IsCompressedWeight(lhs);
+  std::vector<float> lhs_row(compressed ? lhs_width : 0);
   const T *lhs_data = lhs->data<T>();
   const T *rhs_data = rhs->data<T>();
   const T *bias_data = nullptr;
@@ -66,15 +74,25 @@ MaceStatus Gemv<T>::Compute(const OpContext *context,
   for (index_t b = 0; b < batch; ++b) {
     for (index_t h = 0; h < lhs_height; ++h) {
       float sum = bias ? static_cast<float>(bias_data[h]) : 0.f;
+      const index_t lhs_offset =
+          static_cast<index_t>(lhs_batched) * b * lhs_height * lhs_width
+              + h * lhs_width;
+      if (compressed) {
+        DecompressWeight(lhs, lhs_offset, lhs_width, lhs_row.data());
+      }
       for (index_t w = 0; w < lhs_width; ++w) {
-        sum += lhs_data[
-            static_cast<index_t>(lhs_batched) * b * lhs_height * lhs_width
-                + h * lhs_width + w]
-            * rhs_data[static_cast<index_t>(rhs_batched) * b * lhs_width + w];
+        const float lhs_value = compressed ?
+            lhs_row[w] : static_cast<float>(lhs_data[lhs_offset + w]);
+        sum += lhs_value * static_cast<float>(
+            rhs_data[static_cast<index_t>(rhs_batched) * b * lhs_width + w]);
       }  // w
 
       output_data[b * lhs_height + h] = sum;
     }  // h
+    if (!epilogue_.empty()) {
+      ApplyEpilogue<vector_math::VecRef>(epilogue_, 0, lhs_height,
+                                         output_data + b * lhs_height);
+    }
   }   // b
 
   return MaceStatus::MACE_SUCCESS;
@@ -82,14 +100,14 @@ MaceStatus Gemv<T>::Compute(const OpContext *context,
 
 void RegisterGemvDelegator(OpDelegatorRegistry *registry) {
   MACE_REGISTER_DELEGATOR(
-      registry, Gemv<float>, DelegatorParam,
+      registry, Gemv<float>, delegator::GemvParam,
       MACE_DELEGATOR_KEY(Gemv, RuntimeType::RT_CPU, float, ImplType::REF));
   MACE_REGISTER_BF16_DELEGATOR(
-      registry, Gemv<BFloat16>, DelegatorParam,
+      registry, Gemv<BFloat16>, delegator::GemvParam,
       MACE_DELEGATOR_KEY(Gemv, RuntimeType::RT_CPU, BFloat16, ImplType::REF));
 
   MACE_REGISTER_FP16_DELEGATOR(
-      registry, Gemv<float16_t>, DelegatorParam,
+      registry, Gemv<float16_t>, delegator::GemvParam,
       MACE_DELEGATOR_KEY(Gemv, RuntimeType::RT_CPU, float16_t, ImplType::REF));
 }
 
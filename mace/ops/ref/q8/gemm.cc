@@ -0,0 +1,74 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/ops/common/q8_conv_2d.h"
+#include "mace/ops/common/q8_gemm.h"
+
+namespace mace {
+namespace ops {
+namespace ref {
+namespace q8 {
+
+// Portable kernel of the quantized gemm, used when no SIMD kernel is
+// available for the CPU.
+struct GemmKernel {
+  static constexpr index_t kRows = 4;
+  static constexpr index_t kCols = 4;
+  static constexpr int32_t kRhsOffset = 0;
+
+  static void Run(const uint8_t *packed_lhs,
+                  const uint8_t *packed_rhs,
+                  const index_t depth_groups,
+                  int32_t *tile) {
+    const index_t group = ops::q8::kGemmDepthGroup;
+    int32_t acc[kRows * kCols] = {0};
+    for (index_t g = 0; g < depth_groups; ++g) {
+      for (index_t r = 0; r < kRows; ++r) {
+        const uint8_t *a = packed_lhs + r * group;
+        for (index_t c = 0; c < kCols; ++c) {
+          const uint8_t *b = packed_rhs + c * group;
+          acc[r * kCols + c] += a[0] * b[0] + a[1] * b[1]
+              + a[2] * b[2] + a[3] * b[3];
+        }  // c
+      }  // r
+      packed_lhs += kRows * group;
+      packed_rhs += kCols * group;
+    }  // g
+    std::copy_n(acc, kRows * kCols, tile);
+  }
+};
+
+typedef ops::q8::Gemm<GemmKernel, uint8_t> GemmUint8;
+typedef ops::q8::Gemm<GemmKernel, int32_t> GemmInt32;
+typedef ops::q8::Conv2d<GemmKernel> Conv2dUint8;
+
+void RegisterGemmDelegator(OpDelegatorRegistry *registry) {
+  MACE_REGISTER_DELEGATOR(
+      registry, GemmUint8, delegator::GemmParam,
+      MACE_DELEGATOR_KEY(Gemm, RuntimeType::RT_CPU, uint8_t, ImplType::REF));
+  MACE_REGISTER_DELEGATOR(
+      registry, GemmInt32, delegator::GemmParam,
+      MACE_DELEGATOR_KEY(Gemm, RuntimeType::RT_CPU, int32_t, ImplType::REF));
+}
+
+void RegisterConv2dDelegator(OpDelegatorRegistry *registry) {
+  MACE_REGISTER_DELEGATOR(
+      registry, Conv2dUint8, delegator::Conv2dParam,
+      MACE_DELEGATOR_KEY(Conv2d, RuntimeType::RT_CPU, uint8_t, ImplType::REF));
+}
+
+}  // namespace q8
+}  // namespace ref
+}  // namespace ops
+}  // namespace mace
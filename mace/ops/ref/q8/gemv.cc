@@ -23,7 +23,8 @@ namespace q8 {
 template<typename T>
 class Gemv : public delegator::Gemv {
  public:
-  explicit Gemv(const DelegatorParam &param) : delegator::Gemv(param) {}
+  explicit Gemv(const delegator::GemvParam &param)
+      : delegator::Gemv(param) {}
   ~Gemv() {}
   // Always row-major after transpose
   MaceStatus Compute(
@@ -42,7 +43,8 @@ class Gemv : public delegator::Gemv {
 template<>
 class Gemv<uint8_t> : public delegator::Gemv {
  public:
-  explicit Gemv(const DelegatorParam &param) : delegator::Gemv(param) {}
+  explicit Gemv(const delegator::GemvParam &param)
+      : delegator::Gemv(param) {}
   ~Gemv() {}
   // Always row-major after transpose
   MaceStatus Compute(
@@ -61,7 +63,8 @@ class Gemv<uint8_t> : public delegator::Gemv {
 template<>
 class Gemv<int32_t> : public delegator::Gemv {
  public:
-  explicit Gemv(const DelegatorParam &param) : delegator::Gemv(param) {}
+  explicit Gemv(const delegator::GemvParam &param)
+      : delegator::Gemv(param) {}
   ~Gemv() {}
   // Always row-major after transpose
   MaceStatus Compute(
@@ -163,10 +166,10 @@ MaceStatus Gemv<int32_t>::Compute(const OpContext *context,
 
 void RegisterGemvDelegator(OpDelegatorRegistry *registry) {
   MACE_REGISTER_DELEGATOR(
-      registry, Gemv<uint8_t>, DelegatorParam,
+      registry, Gemv<uint8_t>, delegator::GemvParam,
       MACE_DELEGATOR_KEY(Gemv, RuntimeType::RT_CPU, uint8_t, ImplType::REF));
   MACE_REGISTER_DELEGATOR(
-      registry, Gemv<int32_t>, DelegatorParam,
+      registry, Gemv<int32_t>, delegator::GemvParam,
       MACE_DELEGATOR_KEY(Gemv, RuntimeType::RT_CPU, int32_t, ImplType::REF));
 }
 
@@ -0,0 +1,161 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/ops/ref/q8/int8_per_channel.h"
+
+#include <cmath>
+
+#include "mace/utils/logging.h"
+#include "mace/utils/thread_pool.h"
+
+namespace mace {
+namespace ops {
+namespace ref {
+namespace q8 {
+
+void PerChannelOutputStage::Init(const Tensor *input,
+                                 const Tensor *weight,
+                                 const Tensor *bias,
+                                 const Tensor *output,
+                                 const ActivationType activation,
+                                 const float relux_max_limit) {
+  const std::vector<float> &weight_scales = weight->scales();
+  const index_t channels = static_cast<index_t>(weight_scales.size());
+  MACE_CHECK(channels > 0, "int8 weight ", weight->name(),
+             " has no per channel scales");
+  MACE_CHECK(weight->zero_point() == 0, "int8 weight ", weight->name(),
+             " should be quantized symmetrically");
+  const int32_t *bias_data = nullptr;
+  if (bias != nullptr) {
+    MACE_CHECK(bias->size() == channels, "bias size ", bias->size(),
+               " != ", channels);
+    bias_data = bias->data<int32_t>();
+  }
+
+  offsets_.resize(channels);
+  multipliers_.resize(channels);
+  exponents_.resize(channels);
+  for (index_t c = 0; c < channels; ++c) {
+    const float acc_scale = input->scale() * weight_scales[c];
+    int32_t offset = 0;
+    if (bias_data != nullptr) {
+      const float bias_scale =
+          bias->scales().empty() ? bias->scale() : bias->scales()[c];
+      offset = bias_data[c];
+      if (bias_scale > 0.f && acc_scale > 0.f &&
+          std::fabs(bias_scale - acc_scale) > 1e-6f * acc_scale) {
+        offset = static_cast<int32_t>(
+            std::roundf(bias_data[c] * bias_scale / acc_scale));
+      }
+    }
+    offsets_[c] = offset;
+    QuantizeMultiplier(acc_scale / output->scale(), &multipliers_[c],
+                       &exponents_[c]);
+  }
+
+  output_zero_ = output->zero_point();
+  min_ = 0;
+  max_ = 255;
+  if (activation == RELU || activation == RELUX) {
+    min_ = std::max(min_, output_zero_);
+  }
+  if (activation == RELUX) {
+    max_ = std::min(max_, output_zero_ + static_cast<int32_t>(
+        std::roundf(relux_max_limit / output->scale())));
+  } else {
+    MACE_CHECK(activation == NOOP || activation == RELU,
+               "int8 output stage only fuses RELU and RELUX");
+  }
+}
+
+void PerChannelDepthwiseConv2d(const OpContext *context,
+                               const uint8_t *input,
+                               const int8_t *filter,
+                               const index_t *in_shape,
+                               const index_t *filter_shape,
+                               const index_t *out_shape,
+                               const int *stride_hw,
+                               const int *dilation_hw,
+                               const int *pad_hw,
+                               const int32_t input_zero,
+                               const PerChannelOutputStage &stage,
+                               uint8_t *output) {
+  MACE_CHECK(stage.channels() == out_shape[3], stage.channels(), " != ",
+             out_shape[3]);
+  const PerChannelOutputStage *output_stage = &stage;
+  utils::ThreadPool &thread_pool = context->runtime()->thread_pool();
+
+  thread_pool.Compute2D([=](index_t start0, index_t end0, index_t step0,
+                            index_t start1, index_t end1, index_t step1) {
+    const index_t in_height = in_shape[1];
+    const index_t in_width = in_shape[2];
+    const index_t in_channels = in_shape[3];
+    const index_t filter_height = filter_shape[0];
+    const index_t filter_width = filter_shape[1];
+    const index_t multiplier = filter_shape[3];
+    const index_t out_height = out_shape[1];
+    const index_t out_width = out_shape[2];
+    const index_t out_channels = out_shape[3];
+    std::vector<int32_t> acc(out_channels);
+
+    for (index_t b = start0; b < end0; b += step0) {
+      for (index_t h = start1; h < end1; h += step1) {
+        for (index_t w = 0; w < out_width; ++w) {
+          std::fill(acc.begin(), acc.end(), 0);
+          const index_t ih_base = h * stride_hw[0] - pad_hw[0];
+          const index_t iw_base = w * stride_hw[1] - pad_hw[1];
+          for (index_t kh = 0; kh < filter_height; ++kh) {
+            const index_t ih = ih_base + kh * dilation_hw[0];
+            if (ih < 0 || ih >= in_height) {
+              continue;
+            }
+            for (index_t kw = 0; kw < filter_width; ++kw) {
+              const index_t iw = iw_base + kw * dilation_hw[1];
+              if (iw < 0 || iw >= in_width) {
+                continue;
+              }
+              const uint8_t *in =
+                  input + ((b * in_height + ih) * in_width + iw) * in_channels;
+              const int8_t *f =
+                  filter + (kh * filter_width + kw) * out_channels;
+              if (multiplier == 1) {
+                for (index_t m = 0; m < out_channels; ++m) {
+                  acc[m] += (in[m] - input_zero) * f[m];
+                }
+              } else {
+                for (index_t c = 0; c < in_channels; ++c) {
+                  const int32_t value = in[c] - input_zero;
+                  for (index_t o = 0; o < multiplier; ++o) {
+                    const index_t m = c * multiplier + o;
+                    acc[m] += value * f[m];
+                  }
+                }
+              }
+            }
+          }
+          uint8_t *out =
+              output + ((b * out_height + h) * out_width + w) * out_channels;
+          for (index_t m = 0; m < out_channels; ++m) {
+            out[m] = (*output_stage)(acc[m], m);
+          }
+        }
+      }
+    }
+  }, 0, out_shape[0], 1, 0, out_shape[1], 1);
+}
+
+}  // namespace q8
+}  // namespace ref
+}  // namespace ops
+}  // namespace mace
@@ -0,0 +1,87 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_REF_Q8_INT8_PER_CHANNEL_H_
+#define MACE_OPS_REF_Q8_INT8_PER_CHANNEL_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "mace/core/ops/op_context.h"
+#include "mace/core/quantize.h"
+#include "mace/core/tensor.h"
+#include "mace/ops/common/activation_type.h"
+
+namespace mace {
+namespace ops {
+namespace ref {
+namespace q8 {
+
+// Depthwise convolution of uint8 activations (asymmetric, per tensor) by int8
+// weights (symmetric, per output channel, see Tensor::scales()), which
+// gemmlowp doesn't do. The other int8 ops run on the gemm of
+// common/q8_gemm.h. The int32 accumulator of channel c is requantized by
+//   output = output_zero + (acc + offset[c]) * M[c]
+// where M[c] = input_scale * weight_scale[c] / output_scale is a fixed-point
+// multiplier, and clamped to the range of the fused activation.
+class PerChannelOutputStage {
+ public:
+  PerChannelOutputStage() : output_zero_(0), min_(0), max_(255) {}
+
+  // offset[c] is the bias in the accumulator scale, the input zero point is
+  // left to the kernel.
+  void Init(const Tensor *input, const Tensor *weight, const Tensor *bias,
+            const Tensor *output, const ActivationType activation,
+            const float relux_max_limit);
+
+  index_t channels() const {
+    return static_cast<index_t>(offsets_.size());
+  }
+
+  uint8_t operator()(const int32_t acc, const index_t channel) const {
+    const int32_t value = output_zero_ + MultiplyByQuantizedMultiplier(
+        acc + offsets_[channel], multipliers_[channel], exponents_[channel]);
+    return static_cast<uint8_t>(std::max(min_, std::min(max_, value)));
+  }
+
+ private:
+  std::vector<int32_t> offsets_;
+  std::vector<int32_t> multipliers_;
+  std::vector<int32_t> exponents_;
+  int32_t output_zero_;
+  int32_t min_;
+  int32_t max_;
+};
+
+// Depthwise convolution of NHWC input with HWIM filter, padding is skipped,
+// not zero-filled.
+void PerChannelDepthwiseConv2d(const OpContext *context,
+                               const uint8_t *input,
+                               const int8_t *filter,
+                               const index_t *in_shape,
+                               const index_t *filter_shape,
+                               const index_t *out_shape,
+                               const int *stride_hw,
+                               const int *dilation_hw,
+                               const int *pad_hw,
+                               const int32_t input_zero,
+                               const PerChannelOutputStage &stage,
+                               uint8_t *output);
+
+}  // namespace q8
+}  // namespace ref
+}  // namespace ops
+}  // namespace mace
+
+#endif  // MACE_OPS_REF_Q8_INT8_PER_CHANNEL_H_
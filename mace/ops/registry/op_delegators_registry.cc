@@ -26,10 +26,13 @@ extern void RegisterDepthwiseConv2dDelegator(OpDelegatorRegistry *registry);
 extern void RegisterDepthwiseDeconv2dDelegator(OpDelegatorRegistry *registry);
 extern void RegisterGemmDelegator(OpDelegatorRegistry *registry);
 extern void RegisterGemvDelegator(OpDelegatorRegistry *registry);
+extern void RegisterVectorMathDelegator(OpDelegatorRegistry *registry);
 
 #ifdef MACE_ENABLE_QUANTIZE
 namespace q8 {
+extern void RegisterConv2dDelegator(OpDelegatorRegistry *registry);
 extern void RegisterEltwiseDelegator(OpDelegatorRegistry *registry);
+extern void RegisterGemmDelegator(OpDelegatorRegistry *registry);
 extern void RegisterGemvDelegator(OpDelegatorRegistry *registry);
 }  // namespace q8
 #endif  // MACE_ENABLE_QUANTIZE
@@ -69,6 +72,7 @@ extern void RegisterGroupDeconv2dGeneralDelegator(
 
 extern void RegisterGemmDelegator(OpDelegatorRegistry *registry);
 extern void RegisterGemvDelegator(OpDelegatorRegistry *registry);
+extern void RegisterVectorMathDelegator(OpDelegatorRegistry *registry);
 #ifdef MACE_ENABLE_FP16
 extern void RegisterFP16DepthwiseConv2dK3x3Delegator(
     OpDelegatorRegistry *registry);
@@ -76,7 +80,9 @@ extern void RegisterFP16GemmDelegator(OpDelegatorRegistry *registry);
 #endif
 #ifdef MACE_ENABLE_QUANTIZE
 namespace q8 {
+extern void RegisterConv2dDelegator(OpDelegatorRegistry *registry);
 extern void RegisterEltwiseDelegator(OpDelegatorRegistry *registry);
+extern void RegisterGemmDelegator(OpDelegatorRegistry *registry);
 extern void RegisterGemvDelegator(OpDelegatorRegistry *registry);
 }  // namespace q8
 #endif  // MACE_ENABLE_QUANTIZE
@@ -84,6 +90,15 @@ extern void RegisterGemvDelegator(OpDelegatorRegistry *registry);
 }  // namespace arm
 #endif  // MACE_ENABLE_NEON
 
+#ifdef MACE_ENABLE_X86
+namespace x86 {
+extern void RegisterSse42Delegators(OpDelegatorRegistry *registry);
+extern void RegisterAvx2Delegators(OpDelegatorRegistry *registry);
+extern void RegisterAvx512Delegators(OpDelegatorRegistry *registry);
+extern void RegisterAvx512VnniDelegators(OpDelegatorRegistry *registry);
+}  // namespace x86
+#endif  // MACE_ENABLE_X86
+
 void RegisterAllOpDelegators(OpDelegatorRegistry *registry) {
 #ifdef MACE_ENABLE_CPU
   ref::RegisterActivationDelegator(registry);
@@ -94,8 +109,11 @@ void RegisterAllOpDelegators(OpDelegatorRegistry *registry) {
   ref::RegisterDepthwiseDeconv2dDelegator(registry);
   ref::RegisterGemmDelegator(registry);
   ref::RegisterGemvDelegator(registry);
+  ref::RegisterVectorMathDelegator(registry);
 #ifdef MACE_ENABLE_QUANTIZE
+  ref::q8::RegisterConv2dDelegator(registry);
   ref::q8::RegisterEltwiseDelegator(registry);
+  ref::q8::RegisterGemmDelegator(registry);
   ref::q8::RegisterGemvDelegator(registry);
 #endif  // MACE_ENABLE_QUANTIZE
 
@@ -127,16 +145,27 @@ void RegisterAllOpDelegators(OpDelegatorRegistry *registry) {
 
   arm::RegisterGemmDelegator(registry);
   arm::RegisterGemvDelegator(registry);
+  arm::RegisterVectorMathDelegator(registry);
 #ifdef MACE_ENABLE_FP16
   arm::RegisterFP16DepthwiseConv2dK3x3Delegator(registry);
   arm::RegisterFP16GemmDelegator(registry);
 #endif
 #ifdef MACE_ENABLE_QUANTIZE
+  arm::q8::RegisterConv2dDelegator(registry);
   arm::q8::RegisterEltwiseDelegator(registry);
+  arm::q8::RegisterGemmDelegator(registry);
   arm::q8::RegisterGemvDelegator(registry);
 #endif  // MACE_ENABLE_QUANTIZE
 
 #endif  // MACE_ENABLE_NEON
+
+#ifdef MACE_ENABLE_X86
+  // One implementation per ISA and key, picked by the registry's CPU ISA
+  x86::RegisterSse42Delegators(registry);
+  x86::RegisterAvx2Delegators(registry);
+  x86::RegisterAvx512Delegators(registry);
+  x86::RegisterAvx512VnniDelegators(registry);
+#endif  // MACE_ENABLE_X86
 #else
   MACE_UNUSED(registry);
 #endif  // MACE_ENABLE_CPU
@@ -22,6 +22,7 @@ namespace ops {
 extern void RegisterActivation(OpRegistry *op_registry);
 extern void RegisterAddN(OpRegistry *op_registry);
 extern void RegisterArgMax(OpRegistry *op_registry);
+extern void RegisterAttention(OpRegistry *op_registry);
 extern void RegisterBatchNorm(OpRegistry *op_registry);
 extern void RegisterBatchToSpaceND(OpRegistry *op_registry);
 extern void RegisterBiasAdd(OpRegistry *op_registry);
@@ -49,6 +50,8 @@ extern void RegisterIfDefined(OpRegistry *op_registry);
 extern void RegisterInferConv2dShape(OpRegistry *op_registry);
 extern void RegisterInstanceNorm(OpRegistry *op_registry);
 extern void RegisterKaldiBatchNorm(OpRegistry *op_registry);
+extern void RegisterKVCacheAppend(OpRegistry *op_registry);
+extern void RegisterLayerNorm(OpRegistry *op_registry);
 extern void RegisterLocalResponseNorm(OpRegistry *op_registry);
 extern void RegisterLpNorm(OpRegistry *op_registry);
 extern void RegisterLSTMNonlinear(OpRegistry *op_registry);
@@ -109,6 +112,7 @@ void RegisterAllOps(OpRegistry *registry) {
   ops::RegisterActivation(registry);
   ops::RegisterAddN(registry);
   ops::RegisterArgMax(registry);
+  ops::RegisterAttention(registry);
   ops::RegisterBatchNorm(registry);
   ops::RegisterBatchToSpaceND(registry);
   ops::RegisterBiasAdd(registry);
@@ -136,6 +140,8 @@ void RegisterAllOps(OpRegistry *registry) {
   ops::RegisterInferConv2dShape(registry);
   ops::RegisterInstanceNorm(registry);
   ops::RegisterKaldiBatchNorm(registry);
+  ops::RegisterKVCacheAppend(registry);
+  ops::RegisterLayerNorm(registry);
   ops::RegisterLocalResponseNorm(registry);
   ops::RegisterLpNorm(registry);
   ops::RegisterLSTMNonlinear(registry);
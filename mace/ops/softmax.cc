@@ -20,6 +20,7 @@
 
 #include "mace/core/ops/operator.h"
 #include "mace/core/registry/ops_registry.h"
+#include "mace/ops/delegator/vector_math.h"
 
 #ifdef MACE_ENABLE_QUANTIZE
 #include "mace/ops/fixpoint.h"
@@ -31,6 +32,7 @@
 #include "mace/ops/opencl/buffer/softmax.h"
 #endif  // MACE_ENABLE_OPENCL
 
+#include "mace/utils/math.h"
 #include "mace/utils/memory.h"
 
 namespace mace {
@@ -249,7 +251,12 @@ class SoftmaxOp<RuntimeType::RT_CPU, float> : public Operation {
       : Operation(context),
         use_log_(Operation::GetOptionalArg<bool>("use_log", false)),
         has_df_(Operation::GetOptionalArg<int>("has_data_format", 0)),
-        axis_(Operation::GetOptionalArg<int>("axis", 1)) {}
+        axis_(Operation::GetOptionalArg<int>("axis", 1)),
+        vector_math_(delegator::VectorMath::Create(
+            context->workspace(),
+            MACE_DELEGATOR_KEY(VectorMath, RuntimeType::RT_CPU,
+                               float, kCpuImplType),
+            DelegatorParam())) {}
 
   MaceStatus Run(OpContext *context) override {
     MACE_UNUSED(context);
@@ -268,6 +275,7 @@ class SoftmaxOp<RuntimeType::RT_CPU, float> : public Operation {
   bool use_log_;
   bool has_df_;
   int32_t axis_;
+  std::unique_ptr<delegator::VectorMath> vector_math_;
   MACE_OP_INPUT_TAGS(INPUT);
   MACE_OP_OUTPUT_TAGS(OUTPUT);
 
@@ -328,8 +336,9 @@ class SoftmaxOp<RuntimeType::RT_CPU, float> : public Operation {
             float *output_ptr = output_c_base + k;
             float *cache_k_ptr = cache_ptr + k;
             for (index_t i = 0; i < step; ++i) {
-              output_ptr[i] = std::exp(input_ptr[i] - cache_k_ptr[i]);
+              output_ptr[i] = input_ptr[i] - cache_k_ptr[i];
             }
+            vector_math_->Exp(output_ptr, step, output_ptr);
           }
         }
 
@@ -367,9 +376,7 @@ class SoftmaxOp<RuntimeType::RT_CPU, float> : public Operation {
             float *output_c_base = output_b_base + c_offset;
             for (index_t k = start; k < end; k += step) {
               float *output_ptr = output_c_base + k;
-              for (index_t i = 0; i < step; ++i) {
-                output_ptr[i] = std::log(output_ptr[i]);
-              }
+              vector_math_->Log(output_ptr, step, output_ptr);
             }
           }
         }  // use_log_
@@ -450,11 +457,15 @@ class SoftmaxOp<RuntimeType::RT_CPU, float> : public Operation {
       }, 0, hw_size, hw_stride);
     }
 
+    const index_t exp_block_size = 1024;
     thread_pool.Compute1D([=](index_t start, index_t end, index_t step) {
         for (index_t k = start; k < end; k += step) {
-          output_data[k] = std::exp(output_data[k]);
+          const index_t offset = k * exp_block_size;
+          vector_math_->Exp(output_data + offset,
+                            std::min(exp_block_size, batch_size - offset),
+                            output_data + offset);
         }
-    }, 0, batch_size, 1);
+    }, 0, RoundUpDiv(batch_size, exp_block_size), 1);
 
     for (index_t b_offset = 0; b_offset < batch_size;
          b_offset += batch_stride) {
@@ -479,9 +490,9 @@ class SoftmaxOp<RuntimeType::RT_CPU, float> : public Operation {
           }
           if (use_log_) {
             for (index_t c = 0; c < class_size; ++c) {
-              float output = (static_cast<float>(output_ptr[c])) / sum;
-              output_ptr[c] = std::log(output);
+              output_ptr[c] /= sum;
             }
+            vector_math_->Log(output_ptr, class_size, output_ptr);
           } else {
             index_t c = 0;
 #if defined(MACE_ENABLE_NEON)
@@ -0,0 +1,140 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_X86_ACTIVATION_H_
+#define MACE_OPS_X86_ACTIVATION_H_
+
+#include "mace/core/ops/op_context.h"
+#include "mace/core/tensor.h"
+#include "mace/ops/common/vector_math.h"
+#include "mace/ops/delegator/activation.h"
+#include "mace/ops/x86/common_x86.h"
+
+namespace mace {
+namespace ops {
+namespace x86 {
+
+template<class V>
+class Activation : public delegator::Activation {
+ public:
+  explicit Activation(const delegator::ActivationParam &param)
+      : delegator::Activation(param) {}
+  ~Activation() {}
+
+  MaceStatus Compute(const OpContext *context,
+                     const Tensor *input, Tensor *output) override;
+
+ private:
+  typedef typename V::Vec Vec;
+
+  struct ReluFunc {
+    Vec operator()(const Vec x) const { return V::Max(V::Zero(), x); }
+  };
+
+  struct ReluxFunc {
+    explicit ReluxFunc(const float limit) : limit(V::Set1(limit)) {}
+    Vec operator()(const Vec x) const {
+      return V::Max(V::Zero(), V::Min(limit, x));
+    }
+    const Vec limit;
+  };
+
+  struct LeakyReluFunc {
+    explicit LeakyReluFunc(const float alpha) : alpha(V::Set1(alpha)) {}
+    Vec operator()(const Vec x) const {
+      return V::Fma(V::Min(x, V::Zero()), alpha, V::Max(x, V::Zero()));
+    }
+    const Vec alpha;
+  };
+
+  struct HardSigmoidFunc {
+    HardSigmoidFunc(const float alpha, const float beta)
+        : alpha(V::Set1(alpha)), beta(V::Set1(beta)) {}
+    Vec operator()(const Vec x) const {
+      return V::Max(V::Zero(),
+                    V::Min(V::Set1(1.f), V::Fma(alpha, x, beta)));
+    }
+    const Vec alpha;
+    const Vec beta;
+  };
+};
+
+template<class V>
+MaceStatus Activation<V>::Compute(const OpContext *context,
+                                  const Tensor *input, Tensor *output) {
+  if (input != output) {
+    MACE_RETURN_IF_ERROR(output->ResizeLike(input));
+  }
+  const float *input_data = input->data<float>();
+  float *output_data = output->mutable_data<float>();
+  const index_t size = input->size();
+  utils::ThreadPool *thread_pool = &context->runtime()->thread_pool();
+
+  switch (type_) {
+    case RELU: {
+      vector_math::ParallelMap<V>(thread_pool, input_data, size, output_data,
+                                  ReluFunc());
+      break;
+    }
+    case RELUX: {
+      vector_math::ParallelMap<V>(thread_pool, input_data, size, output_data,
+                                  ReluxFunc(limit_));
+      break;
+    }
+    case LEAKYRELU: {
+      vector_math::ParallelMap<V>(thread_pool, input_data, size, output_data,
+                                  LeakyReluFunc(activation_coefficient_));
+      break;
+    }
+    case TANH: {
+      vector_math::ParallelMap<V>(thread_pool, input_data, size, output_data,
+                                  vector_math::TanhFunc<V>());
+      break;
+    }
+    case SIGMOID: {
+      vector_math::ParallelMap<V>(thread_pool, input_data, size, output_data,
+                                  vector_math::SigmoidFunc<V>());
+      break;
+    }
+    case HARDSIGMOID: {
+      vector_math::ParallelMap<V>(
+          thread_pool, input_data, size, output_data,
+          HardSigmoidFunc(hardsigmoid_alpha_, hardsigmoid_beta_));
+      break;
+    }
+    case ELU: {
+      vector_math::ParallelMap<V>(
+          thread_pool, input_data, size, output_data,
+          vector_math::EluFunc<V>(activation_coefficient_));
+      break;
+    }
+    case NOOP: {
+      if (input != output) {
+        output->Copy(*input);
+      }
+      break;
+    }
+    default: {
+      MACE_NOT_IMPLEMENTED;
+    }
+  }
+
+  return MaceStatus::MACE_SUCCESS;
+}
+
+}  // namespace x86
+}  // namespace ops
+}  // namespace mace
+
+#endif  // MACE_OPS_X86_ACTIVATION_H_
@@ -0,0 +1,96 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_X86_AVX2_VEC_AVX2_H_
+#define MACE_OPS_X86_AVX2_VEC_AVX2_H_
+
+#include <immintrin.h>
+
+#include "mace/ops/x86/common_x86.h"
+
+namespace mace {
+namespace ops {
+namespace x86 {
+
+// The AVX2/FMA vector traits, see common_x86.h.
+struct VecAvx2 {
+  typedef __m256 Vec;
+  static const int kWidth = 8;
+  static const CPUIsa kIsa = CPUIsa::CPU_ISA_AVX2;
+
+  static inline Vec Zero() { return _mm256_setzero_ps(); }
+  static inline Vec Set1(const float v) { return _mm256_set1_ps(v); }
+  static inline Vec Broadcast(const float *p) {
+    return _mm256_broadcast_ss(p);
+  }
+  static inline Vec Load(const float *p) { return _mm256_loadu_ps(p); }
+  static inline void Store(float *p, Vec v) { _mm256_storeu_ps(p, v); }
+  static inline Vec LoadStrided(const float *p, const int stride) {
+    const __m256i index = _mm256_mullo_epi32(
+        _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+    return _mm256_i32gather_ps(p, index, 4);
+  }
+  static inline Vec Add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+  static inline Vec Sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+  static inline Vec Mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+  // a * b + c
+  static inline Vec Fma(Vec a, Vec b, Vec c) {
+    return _mm256_fmadd_ps(a, b, c);
+  }
+  static inline float ReduceAdd(Vec v) {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v),
+                            _mm256_extractf128_ps(v, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+    return _mm_cvtss_f32(sum);
+  }
+  // F16C comes with every AVX2 CPU, see DetectCPUIsa
+  static inline Vec LoadHalf(const half *p) {
+    return _mm256_cvtph_ps(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+  }
+  static inline Vec Div(Vec a, Vec b) { return _mm256_div_ps(a, b); }
+  // the second operand if either is NaN
+  static inline Vec Max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+  static inline Vec Min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+  // to the nearest integer, ties to even
+  static inline Vec Round(Vec v) {
+    return _mm256_round_ps(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  }
+  // v * 2^n for integral n in [-126, 127]
+  static inline Vec Ldexp(Vec v, Vec n) {
+    const __m256i e =
+        _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127));
+    return _mm256_mul_ps(v, _mm256_castsi256_ps(_mm256_slli_epi32(e, 23)));
+  }
+  // z * 2^k = v with z in [sqrt(0.5), sqrt(2)), for positive normal v
+  static inline Vec Frexp(Vec v, Vec *k) {
+    const __m256i bits = _mm256_castps_si256(v);
+    const __m256i offset =
+        _mm256_sub_epi32(bits, _mm256_set1_epi32(0x3f3504f3));
+    *k = _mm256_cvtepi32_ps(_mm256_srai_epi32(offset, 23));
+    return _mm256_castsi256_ps(_mm256_sub_epi32(
+        bits, _mm256_and_si256(offset, _mm256_set1_epi32(0xff800000))));
+  }
+  // a < b ? x : y
+  static inline Vec SelectLess(Vec a, Vec b, Vec x, Vec y) {
+    return _mm256_blendv_ps(y, x, _mm256_cmp_ps(a, b, _CMP_LT_OQ));
+  }
+};
+
+}  // namespace x86
+}  // namespace ops
+}  // namespace mace
+
+#endif  // MACE_OPS_X86_AVX2_VEC_AVX2_H_
@@ -0,0 +1,37 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Only the kernels are compiled for AVX-512 and only reachable when the CPU
+// supports it, see isa_target.h.
+
+#include "mace/ops/x86/isa_target.h"
+
+MACE_X86_TARGET_BEGIN("avx512f,avx2,fma,f16c")
+#include "mace/ops/x86/avx512/vec_avx512.h"
+#include "mace/ops/x86/kernels.h"
+MACE_X86_TARGET_END
+
+#include "mace/ops/x86/register_delegators.h"
+
+namespace mace {
+namespace ops {
+namespace x86 {
+
+void RegisterAvx512Delegators(OpDelegatorRegistry *registry) {
+  RegisterDelegators<VecAvx512>(registry);
+}
+
+}  // namespace x86
+}  // namespace ops
+}  // namespace mace
@@ -0,0 +1,116 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_X86_AVX512_VEC_AVX512_H_
+#define MACE_OPS_X86_AVX512_VEC_AVX512_H_
+
+#include <immintrin.h>
+
+#include "mace/ops/x86/common_x86.h"
+
+namespace mace {
+namespace ops {
+namespace x86 {
+
+// The AVX-512 vector traits, see common_x86.h.
+struct VecAvx512 {
+  typedef __m512 Vec;
+  static const int kWidth = 16;
+  static const CPUIsa kIsa = CPUIsa::CPU_ISA_AVX512;
+
+  static inline Vec Zero() { return _mm512_setzero_ps(); }
+  static inline Vec Set1(const float v) { return _mm512_set1_ps(v); }
+  static inline Vec Broadcast(const float *p) { return _mm512_set1_ps(*p); }
+  static inline Vec Load(const float *p) { return _mm512_loadu_ps(p); }
+  static inline void Store(float *p, Vec v) { _mm512_storeu_ps(p, v); }
+  static inline Vec LoadStrided(const float *p, const int stride) {
+    const __m512i index = _mm512_mullo_epi32(
+        _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7,
+                          8, 9, 10, 11, 12, 13, 14, 15),
+        _mm512_set1_epi32(stride));
+    // The masked forms avoid the undefined source operand of the plain
+    // intrinsics, which trips -Werror=maybe-uninitialized on gcc 12.
+    return _mm512_mask_i32gather_ps(_mm512_setzero_ps(), 0xFFFF, index, p, 4);
+  }
+  static inline Vec Add(Vec a, Vec b) { return _mm512_add_ps(a, b); }
+  static inline Vec Sub(Vec a, Vec b) { return _mm512_sub_ps(a, b); }
+  static inline Vec Mul(Vec a, Vec b) { return _mm512_mul_ps(a, b); }
+  // a * b + c
+  static inline Vec Fma(Vec a, Vec b, Vec c) {
+    return _mm512_fmadd_ps(a, b, c);
+  }
+  static inline float ReduceAdd(Vec v) {
+    const __m512d vd = _mm512_castps_pd(v);
+    const __m256 low = _mm256_castpd_ps(
+        _mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), 0xF, vd, 0));
+    const __m256 high = _mm256_castpd_ps(
+        _mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), 0xF, vd, 1));
+    const __m256 sum8 = _mm256_add_ps(low, high);
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(sum8),
+                            _mm256_extractf128_ps(sum8, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+    return _mm_cvtss_f32(sum);
+  }
+  // Masked form again, see LoadStrided.
+  static inline Vec LoadHalf(const half *p) {
+    return _mm512_mask_cvtph_ps(
+        _mm512_setzero_ps(), 0xFFFF,
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+  }
+  static inline Vec Div(Vec a, Vec b) { return _mm512_div_ps(a, b); }
+  // Masked forms again, see LoadStrided.
+  // the second operand if either is NaN
+  static inline Vec Max(Vec a, Vec b) {
+    return _mm512_mask_max_ps(_mm512_setzero_ps(), 0xFFFF, a, b);
+  }
+  static inline Vec Min(Vec a, Vec b) {
+    return _mm512_mask_min_ps(_mm512_setzero_ps(), 0xFFFF, a, b);
+  }
+  // to the nearest integer, ties to even
+  static inline Vec Round(Vec v) {
+    return _mm512_mask_roundscale_ps(
+        _mm512_setzero_ps(), 0xFFFF, v,
+        _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  }
+  // v * 2^n for integral n in [-126, 127]
+  static inline Vec Ldexp(Vec v, Vec n) {
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i e = _mm512_add_epi32(
+        _mm512_mask_cvtps_epi32(zero, 0xFFFF, n), _mm512_set1_epi32(127));
+    return _mm512_mul_ps(
+        v, _mm512_castsi512_ps(_mm512_mask_slli_epi32(zero, 0xFFFF, e, 23)));
+  }
+  // z * 2^k = v with z in [sqrt(0.5), sqrt(2)), for positive normal v
+  static inline Vec Frexp(Vec v, Vec *k) {
+    const __m512i bits = _mm512_castps_si512(v);
+    const __m512i offset =
+        _mm512_sub_epi32(bits, _mm512_set1_epi32(0x3f3504f3));
+    *k = _mm512_mask_cvtepi32_ps(
+        _mm512_setzero_ps(), 0xFFFF,
+        _mm512_mask_srai_epi32(_mm512_setzero_si512(), 0xFFFF, offset, 23));
+    return _mm512_castsi512_ps(_mm512_sub_epi32(
+        bits, _mm512_and_si512(offset, _mm512_set1_epi32(0xff800000))));
+  }
+  // a < b ? x : y
+  static inline Vec SelectLess(Vec a, Vec b, Vec x, Vec y) {
+    return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(a, b, _CMP_LT_OQ), y, x);
+  }
+};
+
+}  // namespace x86
+}  // namespace ops
+}  // namespace mace
+
+#endif  // MACE_OPS_X86_AVX512_VEC_AVX512_H_
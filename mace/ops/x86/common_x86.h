@@ -0,0 +1,65 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_X86_COMMON_X86_H_
+#define MACE_OPS_X86_COMMON_X86_H_
+
+#include <immintrin.h>
+
+#include "mace/core/types.h"
+#include "mace/public/mace.h"
+#include "mace/utils/macros.h"
+
+namespace mace {
+namespace ops {
+namespace x86 {
+
+// Thin wrappers over fp32 vector registers, so that kernels are written once
+// as templates over the traits and instantiated per instruction set. The
+// traits of each ISA are defined in x86/<isa>/vec_<isa>.h, which is only
+// included inside the target region of the ISA, see isa_target.h.
+
+// Scalar fallback with the same interface, used for loop tails. It is
+// templated on the vector traits it accompanies so that scalar code compiled
+// for different ISAs never shares a symbol.
+template<class V>
+struct VecScalar {
+  typedef float Vec;
+  static const int kWidth = 1;
+
+  static inline Vec Zero() { return 0.f; }
+  static inline Vec Set1(const float v) { return v; }
+  static inline Vec Broadcast(const float *p) { return *p; }
+  static inline Vec Load(const float *p) { return *p; }
+  static inline void Store(float *p, Vec v) { *p = v; }
+  static inline Vec LoadStrided(const float *p, const int stride) {
+    MACE_UNUSED(stride);
+    return *p;
+  }
+  static inline Vec Add(Vec a, Vec b) { return a + b; }
+  static inline Vec Sub(Vec a, Vec b) { return a - b; }
+  static inline Vec Mul(Vec a, Vec b) { return a * b; }
+  // a * b + c
+  static inline Vec Fma(Vec a, Vec b, Vec c) { return a * b + c; }
+  static inline float ReduceAdd(Vec v) { return v; }
+  static inline Vec LoadHalf(const half *p) {
+    return half_float::half_cast<float>(*p);
+  }
+};
+
+}  // namespace x86
+}  // namespace ops
+}  // namespace mace
+
+#endif  // MACE_OPS_X86_COMMON_X86_H_
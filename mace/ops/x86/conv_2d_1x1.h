@@ -0,0 +1,100 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_X86_CONV_2D_1X1_H_
+#define MACE_OPS_X86_CONV_2D_1X1_H_
+
+#include <vector>
+
+#include "mace/core/runtime/runtime.h"
+#include "mace/ops/x86/conv_2d.h"
+#include "mace/ops/x86/gemm.h"
+
+namespace mace {
+namespace ops {
+namespace x86 {
+
+template<class V>
+class Conv2dK1x1 : public Conv2dBase {
+ public:
+  explicit Conv2dK1x1(const delegator::Conv2dParam &param)
+      : Conv2dBase(param, sizeof(float)),
+        gemm_(delegator::GemmParam(false, param.epilogue_)) {}
+  virtual ~Conv2dK1x1() {}
+
+  MaceStatus Compute(
+      const OpContext *context,
+      const Tensor *input,
+      const Tensor *filter,
+      Tensor *output) override;
+
+  bool Prepack(const OpContext *context, const Tensor *filter) override {
+    return gemm_.PrepackLhs(context, filter, filter->dim(0), filter->dim(1),
+                            RowMajor);
+  }
+
+ private:
+  Gemm<V> gemm_;
+};
+
+template<class V>
+MaceStatus Conv2dK1x1<V>::Compute(const OpContext *context,
+                                  const Tensor *input,
+                                  const Tensor *filter,
+                                  Tensor *output) {
+  index_t batch = input->dim(0);
+  index_t in_height = input->dim(2);
+  index_t in_width = input->dim(3);
+  index_t in_channels = input->dim(1);
+
+  std::vector<index_t> output_shape;
+  std::vector<int> in_pad_size;
+  std::vector<int> out_pad_size;
+  CalOutputShapeAndPadSize(input, filter, 1, 1,
+                           &output_shape, &in_pad_size, &out_pad_size);
+  MACE_RETURN_IF_ERROR(output->Resize(output_shape));
+
+  const index_t out_channels = output_shape[1];
+  const index_t out_height = output_shape[2];
+  const index_t out_width = output_shape[3];
+  const index_t padded_in_height = in_height + in_pad_size[0] + in_pad_size[1];
+  const index_t padded_in_width = in_width + in_pad_size[2] + in_pad_size[3];
+
+  // 1x1 convolution is a plain (out_channels x in_channels) x
+  // (in_channels x out_height * out_width) matrix multiplication per batch
+  if (in_height != padded_in_height || in_width != padded_in_width) {
+    Runtime *runtime = context->runtime();
+    auto mem_type = input->memory_type();
+    auto tensor_shape = {batch, in_channels, padded_in_height, padded_in_width};
+    Tensor padded_in(runtime, DataType::DT_FLOAT, mem_type, tensor_shape);
+    runtime->AllocateBufferForTensor(&padded_in, RENT_SCRATCH);
+
+    PadInput(*input, in_pad_size[0], in_pad_size[2], &padded_in);
+
+    return gemm_.Compute(context, filter, &padded_in,
+                         batch, out_channels, in_channels, in_channels,
+                         out_height * out_width, false, false, false,
+                         false, true, output);
+  }
+
+  return gemm_.Compute(context, filter, input, batch, out_channels,
+                       in_channels, in_channels, out_height * out_width,
+                       false, false, false, false, true, output);
+}
+
+}  // namespace x86
+}  // namespace ops
+}  // namespace mace
+
+#endif  // MACE_OPS_X86_CONV_2D_1X1_H_
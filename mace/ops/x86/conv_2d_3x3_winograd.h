@@ -0,0 +1,567 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_X86_CONV_2D_3X3_WINOGRAD_H_
+#define MACE_OPS_X86_CONV_2D_3X3_WINOGRAD_H_
+
+#include <memory>
+#include <vector>
+
+#include "mace/core/ops/op_context.h"
+#include "mace/core/packed_weight_cache.h"
+#include "mace/core/tensor.h"
+#include "mace/core/workspace.h"
+#include "mace/ops/common/apply_epilogue.h"
+#include "mace/ops/x86/common_x86.h"
+#include "mace/ops/x86/conv_2d.h"
+#include "mace/ops/x86/gemm.h"
+#include "mace/public/mace.h"
+#include "mace/utils/cpu_isa.h"
+#include "mace/utils/memory.h"
+
+namespace mace {
+namespace ops {
+namespace x86 {
+
+// Winograd F(4x4, 3x3): 6x6 input tiles produce 4x4 output tiles, the
+// element-wise products of the 36 tile positions are batched into one gemm.
+template<class V>
+class Conv2dK3x3Winograd : public Conv2dBase {
+ public:
+  explicit Conv2dK3x3Winograd(const delegator::Conv2dParam &param)
+      : Conv2dBase(param, sizeof(float)),
+        gemm_(delegator::GemmParam()),
+        transformed_filter_(nullptr) {}
+
+  virtual ~Conv2dK3x3Winograd() {}
+
+  MaceStatus Compute(
+      const OpContext *context,
+      const Tensor *input,
+      const Tensor *filter,
+      Tensor *output) override;
+
+  bool Prepack(const OpContext *context, const Tensor *filter) override;
+
+ private:
+  static constexpr index_t kOutTileSize = 4;
+  static constexpr index_t kInTileSize = 6;
+  static constexpr index_t kInTileArea = kInTileSize * kInTileSize;
+
+  // The tile helpers work on V::kWidth horizontally adjacent tiles at once,
+  // or on a single tile with W = VecScalar<V>.
+  template<class W>
+  static void MultiplyBT(const typename W::Vec *d, typename W::Vec *r);
+  template<class W>
+  static void MultiplyAT(const typename W::Vec *m, typename W::Vec *o);
+  template<class W>
+  static void TransformInputTiles(const float *input,
+                                  const index_t in_width,
+                                  const index_t stride,
+                                  float *output);
+  template<class W>
+  static void TransformOutputTiles(const float *input,
+                                   const index_t stride,
+                                   const index_t out_width,
+                                   float *output);
+
+  // Sets transformed_filter_, through the packed weight cache for weights.
+  void PrepareFilter(const OpContext *context, const Tensor *filter);
+
+  void TransformFilter(const OpContext *context,
+                       const float *filter,
+                       const index_t in_channels,
+                       const index_t out_channels,
+                       float *output);
+
+  void TransformInput(const OpContext *context,
+                      const float *input,
+                      const index_t batch,
+                      const index_t in_height,
+                      const index_t in_width,
+                      const index_t in_channels,
+                      const index_t tile_count,
+                      float *output);
+
+  // `valid_shape` is the unpadded output shape, for the epilogue.
+  void TransformOutput(const OpContext *context,
+                       const float *input,
+                       const index_t batch,
+                       const index_t out_height,
+                       const index_t out_width,
+                       const index_t out_channels,
+                       const index_t tile_count,
+                       const std::vector<index_t> &valid_shape,
+                       float *output);
+
+  Gemm<V> gemm_;
+  std::unique_ptr<Tensor> transformed_filter_;
+};
+
+template<class V>
+constexpr index_t Conv2dK3x3Winograd<V>::kOutTileSize;
+template<class V>
+constexpr index_t Conv2dK3x3Winograd<V>::kInTileSize;
+template<class V>
+constexpr index_t Conv2dK3x3Winograd<V>::kInTileArea;
+
+// r = BT * d, for one column of a 6x6 tile
+/**
+ * BT =
+⎡4   0   -5   0   1  0⎤
+⎢                     ⎥
+⎢0  -4   -4   1   1  0⎥
+⎢                     ⎥
+⎢0   4   -4  -1   1  0⎥
+⎢                     ⎥
+⎢0  -2   -1   2   1  0⎥
+⎢                     ⎥
+⎢0   2   -1  -2   1  0⎥
+⎢                     ⎥
+⎣0   4    0  -5   0  1⎦
+ */
+template<class V>
+template<class W>
+void Conv2dK3x3Winograd<V>::MultiplyBT(const typename W::Vec *d,
+                                       typename W::Vec *r) {
+  typedef typename W::Vec Vec;
+  const Vec v2 = W::Set1(2.f);
+  const Vec v4 = W::Set1(4.f);
+  const Vec vm5 = W::Set1(-5.f);
+  const Vec d4_m_d2 = W::Sub(d[4], d[2]);
+  const Vec d1_p_d2 = W::Add(d[1], d[2]);
+  const Vec d1_m_d2 = W::Sub(d[1], d[2]);
+  const Vec d1_m_d3 = W::Sub(d[1], d[3]);
+  r[0] = W::Fma(v4, d[0], W::Fma(vm5, d[2], d[4]));
+  r[1] = W::Sub(W::Add(d[3], d[4]), W::Mul(v4, d1_p_d2));
+  r[2] = W::Fma(v4, d1_m_d2, W::Sub(d[4], d[3]));
+  r[3] = W::Sub(d4_m_d2, W::Mul(v2, d1_m_d3));
+  r[4] = W::Fma(v2, d1_m_d3, d4_m_d2);
+  r[5] = W::Fma(v4, d[1], W::Fma(vm5, d[3], d[5]));
+}
+
+// o = AT * m, for one column of a 6x6 tile
+/**
+ * AT =
+⎡1  1   1  1   1  0⎤
+⎢                  ⎥
+⎢0  1  -1  2  -2  0⎥
+⎢                  ⎥
+⎢0  1   1  4   4  0⎥
+⎢                  ⎥
+⎣0  1  -1  8  -8  1⎦
+ */
+template<class V>
+template<class W>
+void Conv2dK3x3Winograd<V>::MultiplyAT(const typename W::Vec *m,
+                                       typename W::Vec *o) {
+  typedef typename W::Vec Vec;
+  const Vec m1_p_m2 = W::Add(m[1], m[2]);
+  const Vec m1_m_m2 = W::Sub(m[1], m[2]);
+  const Vec m3_p_m4 = W::Add(m[3], m[4]);
+  const Vec m3_m_m4 = W::Sub(m[3], m[4]);
+  o[0] = W::Add(W::Add(m[0], m1_p_m2), m3_p_m4);
+  o[1] = W::Fma(W::Set1(2.f), m3_m_m4, m1_m_m2);
+  o[2] = W::Fma(W::Set1(4.f), m3_p_m4, m1_p_m2);
+  o[3] = W::Add(W::Fma(W::Set1(8.f), m3_m_m4, m1_m_m2), m[5]);
+}
+
+template<class V>
+template<class W>
+void Conv2dK3x3Winograd<V>::TransformInputTiles(const float *input,
+                                                const index_t in_width,
+                                                const index_t stride,
+                                                float *output) {
+  typedef typename W::Vec Vec;
+  Vec d[kInTileSize][kInTileSize];
+  Vec t[kInTileSize][kInTileSize];
+  for (index_t i = 0; i < kInTileSize; ++i) {
+    for (index_t j = 0; j < kInTileSize; ++j) {
+      d[j][i] = W::LoadStrided(input + i * in_width + j, kOutTileSize);
+    }  // j
+  }  // i
+
+  // t = BT * d, column by column (d is stored transposed)
+  for (index_t j = 0; j < kInTileSize; ++j) {
+    MultiplyBT<W>(d[j], t[j]);
+  }  // j
+  // s = t * B, row by row
+  for (index_t i = 0; i < kInTileSize; ++i) {
+    Vec row[kInTileSize];
+    Vec s[kInTileSize];
+    for (index_t j = 0; j < kInTileSize; ++j) {
+      row[j] = t[j][i];
+    }  // j
+    MultiplyBT<W>(row, s);
+    for (index_t j = 0; j < kInTileSize; ++j) {
+      W::Store(output + (i * kInTileSize + j) * stride, s[j]);
+    }  // j
+  }  // i
+}
+
+template<class V>
+template<class W>
+void Conv2dK3x3Winograd<V>::TransformOutputTiles(const float *input,
+                                                 const index_t stride,
+                                                 const index_t out_width,
+                                                 float *output) {
+  typedef typename W::Vec Vec;
+  Vec t[kInTileSize][kOutTileSize];
+  for (index_t j = 0; j < kInTileSize; ++j) {
+    Vec m[kInTileSize];
+    for (index_t i = 0; i < kInTileSize; ++i) {
+      m[i] = W::Load(input + (i * kInTileSize + j) * stride);
+    }  // i
+    MultiplyAT<W>(m, t[j]);
+  }  // j
+
+  float tmp[kOutTileSize * kOutTileSize * W::kWidth];
+  for (index_t i = 0; i < kOutTileSize; ++i) {
+    Vec row[kInTileSize];
+    Vec o[kOutTileSize];
+    for (index_t j = 0; j < kInTileSize; ++j) {
+      row[j] = t[j][i];
+    }  // j
+    MultiplyAT<W>(row, o);
+    for (index_t j = 0; j < kOutTileSize; ++j) {
+      W::Store(tmp + (i * kOutTileSize + j) * W::kWidth, o[j]);
+    }  // j
+  }  // i
+
+  for (index_t i = 0; i < kOutTileSize; ++i) {
+    for (index_t k = 0; k < W::kWidth; ++k) {
+      float *out_ptr = output + i * out_width + k * kOutTileSize;
+      for (index_t j = 0; j < kOutTileSize; ++j) {
+        out_ptr[j] = tmp[(i * kOutTileSize + j) * W::kWidth + k];
+      }  // j
+    }  // k
+  }  // i
+}
+
+template<class V>
+MaceStatus Conv2dK3x3Winograd<V>::Compute(const OpContext *context,
+                                          const Tensor *input,
+                                          const Tensor *filter,
+                                          Tensor *output) {
+  const index_t batch = input->dim(0);
+  const index_t in_channels = input->dim(1);
+  const index_t in_height = input->dim(2);
+  const index_t in_width = input->dim(3);
+  const index_t out_channels = filter->dim(0);
+
+  std::vector<index_t> output_shape;
+  std::vector<int> in_pad_size;
+  std::vector<int> out_pad_size;
+  CalOutputShapeAndPadSize(input,
+                           filter,
+                           kOutTileSize,
+                           kOutTileSize,
+                           &output_shape,
+                           &in_pad_size,
+                           &out_pad_size);
+  MACE_RETURN_IF_ERROR(output->Resize(output_shape));
+
+  const index_t out_height = output_shape[2];
+  const index_t out_width = output_shape[3];
+  const index_t padded_in_height = in_height + in_pad_size[0] + in_pad_size[1];
+  const index_t padded_in_width = in_width + in_pad_size[2] + in_pad_size[3];
+  const index_t
+      padded_out_height = out_height + out_pad_size[0] + out_pad_size[1];
+  const index_t
+      padded_out_width = out_width + out_pad_size[2] + out_pad_size[3];
+
+  bool is_in_padded =
+      padded_in_height != in_height || padded_in_width != in_width;
+  bool is_out_padded =
+      padded_out_height != out_height || padded_out_width != out_width;
+
+  const index_t tile_count = (padded_out_height / kOutTileSize) *
+      (padded_out_width / kOutTileSize);
+
+  Runtime *runtime = context->runtime();
+  auto mem_type = MemoryType::CPU_BUFFER;
+
+  const Tensor *padded_in = input;
+  std::unique_ptr<Tensor> tmp_padded_in;
+  if (is_in_padded) {
+    auto tensor_shape = {batch, in_channels, padded_in_height, padded_in_width};
+    tmp_padded_in = make_unique<Tensor>(runtime, DataType::DT_FLOAT,
+                                        mem_type, tensor_shape);
+    runtime->AllocateBufferForTensor(tmp_padded_in.get(), RENT_SCRATCH);
+    PadInput(*input, in_pad_size[0], in_pad_size[2], tmp_padded_in.get());
+    padded_in = tmp_padded_in.get();
+  }
+
+  Tensor *padded_out = output;
+  std::unique_ptr<Tensor> tmp_padded_out;
+  if (is_out_padded) {
+    auto tensor_shape =
+        {batch, out_channels, padded_out_height, padded_out_width};
+    tmp_padded_out = make_unique<Tensor>(runtime, DataType::DT_FLOAT,
+                                         mem_type, tensor_shape);
+    runtime->AllocateBufferForTensor(tmp_padded_out.get(), RENT_SCRATCH);
+    padded_out = tmp_padded_out.get();
+  }
+
+  MemInfo mem_info(mem_type, DataType::DT_FLOAT, {0});
+  mem_info.dims = {batch, kInTileArea, in_channels, tile_count};
+  auto transformed_in = runtime->ObtainBuffer(mem_info, RENT_SCRATCH);
+  mem_info.dims = {batch, kInTileArea, out_channels, tile_count};
+  auto transformed_out = runtime->ObtainBuffer(mem_info, RENT_SCRATCH);
+
+  if (!filter->is_weight() || transformed_filter_ == nullptr) {
+    PrepareFilter(context, filter);
+  }
+
+  TransformInput(context, padded_in->data<float>(), batch, padded_in_height,
+                 padded_in_width, in_channels, tile_count,
+                 transformed_in->mutable_data<float>());
+
+  const index_t transformed_in_bytes_per_batch =
+      kInTileArea * in_channels * tile_count * sizeof(float);
+  const index_t transformed_out_bytes_per_batch =
+      kInTileArea * out_channels * tile_count * sizeof(float);
+  std::vector<index_t> in_shape = {kInTileArea, in_channels, tile_count};
+  std::vector<index_t> out_shape = {kInTileArea, out_channels, tile_count};
+  for (index_t b = 0; b < batch; ++b) {
+    Tensor transformed_in_this_batch(runtime, transformed_in->data_type,
+                                     mem_type, in_shape);
+    runtime->AllocateBufferForTensor(
+        &transformed_in_this_batch, RENT_SLICE,
+        transformed_in.get(), b * transformed_in_bytes_per_batch);
+
+    Tensor transformed_out_this_batch(runtime, transformed_out->data_type,
+                                      mem_type, out_shape);
+    runtime->AllocateBufferForTensor(
+        &transformed_out_this_batch, RENT_SLICE,
+        transformed_out.get(), b * transformed_out_bytes_per_batch);
+
+    gemm_.Compute(context,
+                  transformed_filter_.get(),
+                  &transformed_in_this_batch,
+                  kInTileArea,
+                  out_channels,
+                  in_channels,
+                  in_channels,
+                  tile_count,
+                  false,
+                  false,
+                  false,
+                  true,
+                  true,
+                  &transformed_out_this_batch);
+  }
+
+  TransformOutput(context, transformed_out->data<float>(), batch,
+                  padded_out_height, padded_out_width, out_channels,
+                  tile_count, output_shape, padded_out->mutable_data<float>());
+  UnPadOutput(*padded_out, output);
+
+  return MaceStatus::MACE_SUCCESS;
+}
+
+template<class V>
+bool Conv2dK3x3Winograd<V>::Prepack(const OpContext *context,
+                                   const Tensor *filter) {
+  if (!filter->is_weight()) {
+    return false;
+  }
+  PrepareFilter(context, filter);
+  return true;
+}
+
+template<class V>
+void Conv2dK3x3Winograd<V>::PrepareFilter(const OpContext *context,
+                                         const Tensor *filter) {
+  const index_t out_channels = filter->dim(0);
+  const index_t in_channels = filter->dim(1);
+  PackedWeightCache *cache = filter->is_weight() ?
+      context->workspace()->packed_weight_cache() : nullptr;
+  transformed_filter_ = LoadOrPackWeight(
+      cache, context->runtime(),
+      MakeString(filter->name(), "/x86_winograd_",
+                 utils::CPUIsaToString(V::kIsa), "_", kOutTileSize),
+      DataType::DT_FLOAT, {kInTileArea, out_channels, in_channels},
+      [&](void *packed) {
+        TransformFilter(context, filter->data<float>(), in_channels,
+                        out_channels, static_cast<float *>(packed));
+      });
+}
+
+// OCHW => TOC
+/**
+ * G =
+⎡ 1/4      0      0  ⎤
+⎢                    ⎥
+⎢-1/6    -1/6   -1/6 ⎥
+⎢                    ⎥
+⎢-1/6     1/6   -1/6 ⎥
+⎢                    ⎥
+⎢1/24    1/12    1/6 ⎥
+⎢                    ⎥
+⎢1/24   -1/12    1/6 ⎥
+⎢                    ⎥
+⎣ 0        0      1  ⎦
+ */
+template<class V>
+void Conv2dK3x3Winograd<V>::TransformFilter(const OpContext *context,
+                                            const float *filter,
+                                            const index_t in_channels,
+                                            const index_t out_channels,
+                                            float *output) {
+  const index_t stride = out_channels * in_channels;
+  const float G[kInTileSize][3] = {
+      {1.0f / 4, 0.0f, 0.0f},
+      {-1.0f / 6, -1.0f / 6, -1.0f / 6},
+      {-1.0f / 6, 1.0f / 6, -1.0f / 6},
+      {1.0f / 24, 1.0f / 12, 1.0f / 6},
+      {1.0f / 24, -1.0f / 12, 1.0f / 6},
+      {0.0f, 0.0f, 1.0f}
+  };
+
+  utils::ThreadPool &thread_pool = context->runtime()->thread_pool();
+
+  thread_pool.Compute2D([=](index_t start0, index_t end0, index_t step0,
+                            index_t start1, index_t end1, index_t step1) {
+    for (index_t m = start0; m < end0; m += step0) {
+      for (index_t c = start1; c < end1; c += step1) {
+        const float *g = filter + (m * in_channels + c) * 9;
+        // t = G * g
+        float t[kInTileSize][3];
+        for (index_t i = 0; i < kInTileSize; ++i) {
+          for (index_t j = 0; j < 3; ++j) {
+            t[i][j] = G[i][0] * g[j] + G[i][1] * g[3 + j] + G[i][2] * g[6 + j];
+          }  // j
+        }  // i
+        // s = t * GT
+        float *output_ptr = output + m * in_channels + c;
+        for (index_t i = 0; i < kInTileSize; ++i) {
+          for (index_t j = 0; j < kInTileSize; ++j) {
+            output_ptr[(i * kInTileSize + j) * stride] =
+                t[i][0] * G[j][0] + t[i][1] * G[j][1] + t[i][2] * G[j][2];
+          }  // j
+        }  // i
+      }  // c
+    }  // m
+  }, 0, out_channels, 1, 0, in_channels, 1);
+}
+
+// NCHW => NTCB (T: in tile pixels, B: tile indices)
+template<class V>
+void Conv2dK3x3Winograd<V>::TransformInput(const OpContext *context,
+                                           const float *input,
+                                           const index_t batch,
+                                           const index_t in_height,
+                                           const index_t in_width,
+                                           const index_t in_channels,
+                                           const index_t tile_count,
+                                           float *output) {
+  const index_t stride = in_channels * tile_count;
+  const index_t in_height_width = in_height * in_width;
+  const index_t input_batch_size = in_height_width * in_channels;
+  const index_t output_batch_size = kInTileArea * in_channels * tile_count;
+  const index_t tile_width_count = (in_width - 2) / kOutTileSize;
+  const index_t tile_height_count = (in_height - 2) / kOutTileSize;
+  const index_t vec_tile_count =
+      tile_width_count - tile_width_count % V::kWidth;
+
+  utils::ThreadPool &thread_pool = context->runtime()->thread_pool();
+
+  thread_pool.Compute2D([=](index_t start0, index_t end0, index_t step0,
+                            index_t start1, index_t end1, index_t step1) {
+    for (index_t n = start0; n < end0; n += step0) {
+      for (index_t c = start1; c < end1; c += step1) {
+        const float *input_ptr =
+            input + n * input_batch_size + c * in_height_width;
+        float *output_ptr =
+            output + n * output_batch_size + c * tile_count;
+        for (index_t th = 0; th < tile_height_count; ++th) {
+          const float *in_row = input_ptr + th * kOutTileSize * in_width;
+          float *out_row = output_ptr + th * tile_width_count;
+          index_t tw = 0;
+          for (; tw < vec_tile_count; tw += V::kWidth) {
+            TransformInputTiles<V>(in_row + tw * kOutTileSize,
+                                   in_width, stride, out_row + tw);
+          }  // tw
+          for (; tw < tile_width_count; ++tw) {
+            TransformInputTiles<VecScalar<V>>(in_row + tw * kOutTileSize,
+                                              in_width, stride, out_row + tw);
+          }  // tw
+        }  // th
+      }  // c
+    }  // n
+  }, 0, batch, 1, 0, in_channels, 1);
+}
+
+// NTOB => NToOB => NOHoWo
+template<class V>
+void Conv2dK3x3Winograd<V>::TransformOutput(const OpContext *context,
+                                            const float *input,
+                                            const index_t batch,
+                                            const index_t out_height,
+                                            const index_t out_width,
+                                            const index_t out_channels,
+                                            const index_t tile_count,
+                                            const std::vector<index_t>
+                                            &valid_shape,
+                                            float *output) {
+  const index_t stride = out_channels * tile_count;
+  const index_t input_batch_size = kInTileArea * out_channels * tile_count;
+  const index_t out_image_size = out_height * out_width;
+  const index_t output_batch_size = out_channels * out_image_size;
+  const index_t tile_width_count = out_width / kOutTileSize;
+  const index_t tile_height_count = out_height / kOutTileSize;
+  const index_t vec_tile_count =
+      tile_width_count - tile_width_count % V::kWidth;
+
+  utils::ThreadPool &thread_pool = context->runtime()->thread_pool();
+
+  thread_pool.Compute2D([=, &valid_shape](index_t start0, index_t end0,
+                                          index_t step0, index_t start1,
+                                          index_t end1, index_t step1) {
+    for (index_t n = start0; n < end0; n += step0) {
+      for (index_t m = start1; m < end1; m += step1) {
+        const float *input_ptr =
+            input + n * input_batch_size + m * tile_count;
+        float *output_ptr =
+            output + n * output_batch_size + m * out_image_size;
+        for (index_t th = 0; th < tile_height_count; ++th) {
+          const float *in_row = input_ptr + th * tile_width_count;
+          float *out_row = output_ptr + th * kOutTileSize * out_width;
+          index_t tw = 0;
+          for (; tw < vec_tile_count; tw += V::kWidth) {
+            TransformOutputTiles<V>(in_row + tw, stride, out_width,
+                                    out_row + tw * kOutTileSize);
+          }  // tw
+          for (; tw < tile_width_count; ++tw) {
+            TransformOutputTiles<VecScalar<V>>(in_row + tw, stride,
+                                               out_width,
+                                               out_row + tw * kOutTileSize);
+          }  // tw
+        }  // th
+
+        if (!epilogue_.empty()) {
+          ApplyEpilogueToPlane<V>(epilogue_, valid_shape, m, out_width,
+                                  output_ptr);
+        }
+      }  // m
+    }  // n
+  }, 0, batch, 1, 0, out_channels, 1);
+}
+
+}  // namespace x86
+}  // namespace ops
+}  // namespace mace
+
+#endif  // MACE_OPS_X86_CONV_2D_3X3_WINOGRAD_H_
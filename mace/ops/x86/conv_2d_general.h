@@ -0,0 +1,140 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_X86_CONV_2D_GENERAL_H_
+#define MACE_OPS_X86_CONV_2D_GENERAL_H_
+
+#include <cstring>
+#include <memory>
+
+#include "mace/core/ops/op_context.h"
+#include "mace/core/tensor.h"
+#include "mace/ops/x86/conv_2d.h"
+#include "mace/ops/x86/gemm.h"
+#include "mace/public/mace.h"
+
+namespace mace {
+namespace ops {
+namespace x86 {
+
+// Arbitrary kernel size, stride and dilation: im2col followed by gemm.
+template<class V>
+class Conv2dGeneral : public Conv2dBase {
+ public:
+  explicit Conv2dGeneral(const delegator::Conv2dParam &param)
+      : Conv2dBase(param, sizeof(float)),
+        gemm_(delegator::GemmParam(false, param.epilogue_)) {}
+  virtual ~Conv2dGeneral() {}
+
+  MaceStatus Compute(const OpContext *context, const Tensor *input,
+                     const Tensor *filter, Tensor *output) override;
+
+  bool Prepack(const OpContext *context, const Tensor *filter) override {
+    return gemm_.PrepackLhs(context, filter, filter->dim(0),
+                            filter->dim(1) * filter->dim(2) * filter->dim(3),
+                            RowMajor);
+  }
+
+ private:
+  void Im2Col(const ConvComputeParam &p, const index_t filter_height,
+              const index_t filter_width, const float *input_data,
+              float *col_data);
+
+  Gemm<V> gemm_;
+};
+
+template<class V>
+MaceStatus Conv2dGeneral<V>::Compute(const OpContext *context,
+                                     const Tensor *input,
+                                     const Tensor *filter,
+                                     Tensor *output) {
+  std::unique_ptr<const Tensor> padded_input;
+  std::unique_ptr<Tensor> padded_output;
+  ResizeOutAndPadInOut(context, input, filter, output, 1, 1,
+                       &padded_input, &padded_output);
+  const Tensor *in_tensor = input;
+  if (padded_input != nullptr) {
+    in_tensor = padded_input.get();
+  }
+  MACE_CHECK(padded_output == nullptr);
+
+  const ConvComputeParam p =
+      PreWorkAndGetConv2DParam(context, in_tensor, output);
+  const index_t filter_height = filter->dim(2);
+  const index_t filter_width = filter->dim(3);
+  const index_t depth = p.in_channels * filter_height * filter_width;
+
+  // (out_channels x depth) x (depth x out_height * out_width) per batch
+  Runtime *runtime = context->runtime();
+  Tensor col(runtime, DataType::DT_FLOAT, output->memory_type(),
+             {p.batch, depth, p.out_image_size});
+  runtime->AllocateBufferForTensor(&col, RENT_SCRATCH);
+
+  Im2Col(p, filter_height, filter_width, in_tensor->data<float>(),
+         col.mutable_data<float>());
+
+  return gemm_.Compute(context, filter, &col, p.batch, p.out_channels, depth,
+                       depth, p.out_image_size, false, false, false,
+                       false, true, output);
+}
+
+template<class V>
+void Conv2dGeneral<V>::Im2Col(const ConvComputeParam &p,
+                              const index_t filter_height,
+                              const index_t filter_width,
+                              const float *input_data,
+                              float *col_data) {
+  const int stride_h = strides_[0];
+  const int stride_w = strides_[1];
+  const int dilation_h = dilations_[0];
+  const int dilation_w = dilations_[1];
+  const index_t filter_size = filter_height * filter_width;
+  const index_t col_batch_size =
+      p.in_channels * filter_size * p.out_image_size;
+
+  p.thread_pool.Compute2D([=](index_t start0, index_t end0, index_t step0,
+                              index_t start1, index_t end1, index_t step1) {
+    for (index_t b = start0; b < end0; b += step0) {
+      for (index_t c = start1; c < end1; c += step1) {
+        const float *in_ptr =
+            input_data + b * p.in_batch_size + c * p.in_image_size;
+        float *col_ptr = col_data + b * col_batch_size +
+            c * filter_size * p.out_image_size;
+        for (index_t kh = 0; kh < filter_height; ++kh) {
+          for (index_t kw = 0; kw < filter_width; ++kw) {
+            for (index_t h = 0; h < p.out_height; ++h) {
+              const float *in_row = in_ptr +
+                  (h * stride_h + kh * dilation_h) * p.in_width +
+                  kw * dilation_w;
+              if (stride_w == 1) {
+                memcpy(col_ptr, in_row, p.out_width * sizeof(float));
+              } else {
+                for (index_t w = 0; w < p.out_width; ++w) {
+                  col_ptr[w] = in_row[w * stride_w];
+                }  // w
+              }
+              col_ptr += p.out_width;
+            }  // h
+          }  // kw
+        }  // kh
+      }  // c
+    }  // b
+  }, 0, p.batch, 1, 0, p.in_channels, 1);
+}
+
+}  // namespace x86
+}  // namespace ops
+}  // namespace mace
+
+#endif  // MACE_OPS_X86_CONV_2D_GENERAL_H_
@@ -0,0 +1,240 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_X86_CONV_2D_MXN_H_
+#define MACE_OPS_X86_CONV_2D_MXN_H_
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "mace/core/ops/op_context.h"
+#include "mace/core/tensor.h"
+#include "mace/ops/common/apply_epilogue.h"
+#include "mace/ops/x86/common_x86.h"
+#include "mace/ops/x86/conv_2d.h"
+#include "mace/public/mace.h"
+
+namespace mace {
+namespace ops {
+namespace x86 {
+
+// Direct convolution for a fixed kernel size and stride without dilation,
+// e.g. K3x3S2, K5x5S1, K7x7S2 and K1x15S1. Each step computes a block of
+// 4 output channels x 2 output rows x one vector of output columns.
+template<class V, int KernelH, int KernelW, int StrideH, int StrideW>
+class Conv2dKMxN : public Conv2dBase {
+ public:
+  explicit Conv2dKMxN(const delegator::Conv2dParam &param)
+      : Conv2dBase(param, sizeof(float)) {}
+  virtual ~Conv2dKMxN() {}
+
+  MaceStatus Compute(const OpContext *context,
+                     const Tensor *input,
+                     const Tensor *filter,
+                     Tensor *output) override;
+
+ private:
+  static constexpr int kOutTileHeight = 2;
+  static constexpr int kOutChannelBlock = 4;
+
+  // `out_shape` is the unpadded output shape, for the epilogue.
+  void DoCompute(const ConvComputeParam &p, const float *filter_data,
+                 const float *input_data, const std::vector<index_t> &out_shape,
+                 float *output_data);
+
+  // out tile: kOcBlock channels x 2 rows x V::kWidth cols
+  template<int kOcBlock>
+  static void ConvTile(const float *input,
+                       const index_t in_width,
+                       const index_t in_image_size,
+                       const index_t in_channels,
+                       const float *filter,
+                       const index_t filter_channel_stride,
+                       float *output,
+                       const index_t out_width,
+                       const index_t out_image_size);
+};
+
+template<class V>
+using Conv2dK3x3S1 = Conv2dKMxN<V, 3, 3, 1, 1>;
+template<class V>
+using Conv2dK3x3S2 = Conv2dKMxN<V, 3, 3, 2, 2>;
+template<class V>
+using Conv2dK5x5S1 = Conv2dKMxN<V, 5, 5, 1, 1>;
+template<class V>
+using Conv2dK7x7S1 = Conv2dKMxN<V, 7, 7, 1, 1>;
+template<class V>
+using Conv2dK7x7S2 = Conv2dKMxN<V, 7, 7, 2, 2>;
+template<class V>
+using Conv2dK7x7S3 = Conv2dKMxN<V, 7, 7, 3, 3>;
+template<class V>
+using Conv2dK1x7S1 = Conv2dKMxN<V, 1, 7, 1, 1>;
+template<class V>
+using Conv2dK7x1S1 = Conv2dKMxN<V, 7, 1, 1, 1>;
+template<class V>
+using Conv2dK1x15S1 = Conv2dKMxN<V, 1, 15, 1, 1>;
+template<class V>
+using Conv2dK15x1S1 = Conv2dKMxN<V, 15, 1, 1, 1>;
+
+template<class V, int KernelH, int KernelW, int StrideH, int StrideW>
+constexpr int Conv2dKMxN<V, KernelH, KernelW, StrideH, StrideW>::
+    kOutTileHeight;
+template<class V, int KernelH, int KernelW, int StrideH, int StrideW>
+constexpr int Conv2dKMxN<V, KernelH, KernelW, StrideH, StrideW>::
+    kOutChannelBlock;
+
+template<class V, int KernelH, int KernelW, int StrideH, int StrideW>
+template<int kOcBlock>
+void Conv2dKMxN<V, KernelH, KernelW, StrideH, StrideW>::ConvTile(
+    const float *input,
+    const index_t in_width,
+    const index_t in_image_size,
+    const index_t in_channels,
+    const float *filter,
+    const index_t filter_channel_stride,
+    float *output,
+    const index_t out_width,
+    const index_t out_image_size) {
+  typedef typename V::Vec Vec;
+  const index_t filter_size = KernelH * KernelW;
+
+  Vec vo0[kOcBlock];
+  Vec vo1[kOcBlock];
+  for (int k = 0; k < kOcBlock; ++k) {
+    vo0[k] = V::Zero();
+    vo1[k] = V::Zero();
+  }
+
+  for (index_t c = 0; c < in_channels; ++c) {
+    const float *in_ptr0 = input + c * in_image_size;
+    const float *in_ptr1 = in_ptr0 + StrideH * in_width;
+    const float *filter_ptr = filter + c * filter_size;
+    for (int kh = 0; kh < KernelH; ++kh) {
+      for (int kw = 0; kw < KernelW; ++kw) {
+        const index_t in_offset = kh * in_width + kw;
+        Vec vi0, vi1;
+        if (StrideW == 1) {
+          vi0 = V::Load(in_ptr0 + in_offset);
+          vi1 = V::Load(in_ptr1 + in_offset);
+        } else {
+          vi0 = V::LoadStrided(in_ptr0 + in_offset, StrideW);
+          vi1 = V::LoadStrided(in_ptr1 + in_offset, StrideW);
+        }
+        const float *f = filter_ptr + kh * KernelW + kw;
+        for (int k = 0; k < kOcBlock; ++k) {
+          const Vec vf = V::Broadcast(f + k * filter_channel_stride);
+          vo0[k] = V::Fma(vi0, vf, vo0[k]);
+          vo1[k] = V::Fma(vi1, vf, vo1[k]);
+        }  // k
+      }  // kw
+    }  // kh
+  }  // c
+
+  for (int k = 0; k < kOcBlock; ++k) {
+    float *out_ptr = output + k * out_image_size;
+    V::Store(out_ptr, vo0[k]);
+    V::Store(out_ptr + out_width, vo1[k]);
+  }  // k
+}
+
+template<class V, int KernelH, int KernelW, int StrideH, int StrideW>
+MaceStatus Conv2dKMxN<V, KernelH, KernelW, StrideH, StrideW>::Compute(
+    const OpContext *context,
+    const Tensor *input,
+    const Tensor *filter,
+    Tensor *output) {
+  std::unique_ptr<const Tensor> padded_input;
+  std::unique_ptr<Tensor> padded_output;
+  ResizeOutAndPadInOut(context, input, filter, output, kOutTileHeight,
+                       V::kWidth, &padded_input, &padded_output);
+  const Tensor *in_tensor = input;
+  if (padded_input != nullptr) {
+    in_tensor = padded_input.get();
+  }
+  Tensor *out_tensor = output;
+  if (padded_output != nullptr) {
+    out_tensor = padded_output.get();
+  }
+
+  const float *filter_data = filter->data<float>();
+  const float *input_data = in_tensor->data<float>();
+  float *output_data = out_tensor->mutable_data<float>();
+
+  const ConvComputeParam p =
+      PreWorkAndGetConv2DParam(context, in_tensor, out_tensor);
+
+  DoCompute(p, filter_data, input_data, output->shape(), output_data);
+
+  UnPadOutput(*out_tensor, output);
+  return MaceStatus::MACE_SUCCESS;
+}
+
+template<class V, int KernelH, int KernelW, int StrideH, int StrideW>
+void Conv2dKMxN<V, KernelH, KernelW, StrideH, StrideW>::DoCompute(
+    const ConvComputeParam &p, const float *filter_data,
+    const float *input_data, const std::vector<index_t> &out_shape,
+    float *output_data) {
+  const index_t filter_channel_stride = p.in_channels * KernelH * KernelW;
+
+  p.thread_pool.Compute2D([=, &out_shape](index_t start0, index_t end0,
+                                          index_t step0, index_t start1,
+                                          index_t end1, index_t step1) {
+    for (index_t b = start0; b < end0; b += step0) {
+      for (index_t m = start1; m < end1; m += step1) {
+        const index_t oc_block =
+            std::min<index_t>(kOutChannelBlock, p.out_channels - m);
+        const float *in_base = input_data + b * p.in_batch_size;
+        float *out_base =
+            output_data + b * p.out_batch_size + m * p.out_image_size;
+        for (index_t h = 0; h < p.out_height; h += kOutTileHeight) {
+          for (index_t w = 0; w < p.out_width; w += V::kWidth) {
+            const float *in_ptr =
+                in_base + h * StrideH * p.in_width + w * StrideW;
+            float *out_ptr = out_base + h * p.out_width + w;
+            if (oc_block == kOutChannelBlock) {
+              ConvTile<kOutChannelBlock>(
+                  in_ptr, p.in_width, p.in_image_size, p.in_channels,
+                  filter_data + m * filter_channel_stride,
+                  filter_channel_stride, out_ptr, p.out_width,
+                  p.out_image_size);
+            } else {
+              for (index_t mm = 0; mm < oc_block; ++mm) {
+                ConvTile<1>(
+                    in_ptr, p.in_width, p.in_image_size, p.in_channels,
+                    filter_data + (m + mm) * filter_channel_stride,
+                    filter_channel_stride,
+                    out_ptr + mm * p.out_image_size, p.out_width,
+                    p.out_image_size);
+              }  // mm
+            }
+          }  // w
+        }  // h
+
+        if (!epilogue_.empty()) {
+          for (index_t mm = 0; mm < oc_block; ++mm) {
+            ApplyEpilogueToPlane<V>(epilogue_, out_shape, m + mm, p.out_width,
+                                    out_base + mm * p.out_image_size);
+          }  // mm
+        }
+      }  // m
+    }  // b
+  }, 0, p.batch, 1, 0, p.out_channels, kOutChannelBlock);
+}
+
+}  // namespace x86
+}  // namespace ops
+}  // namespace mace
+
+#endif  // MACE_OPS_X86_CONV_2D_MXN_H_
@@ -0,0 +1,585 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_X86_GEMM_H_
+#define MACE_OPS_X86_GEMM_H_
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "mace/core/ops/op_context.h"
+#include "mace/core/packed_weight_cache.h"
+#include "mace/core/tensor.h"
+#include "mace/core/workspace.h"
+#include "mace/ops/common/apply_epilogue.h"
+#include "mace/ops/common/matrix.h"
+#include "mace/ops/delegator/gemm.h"
+#include "mace/ops/x86/common_x86.h"
+#include "mace/public/mace.h"
+#include "mace/utils/cpu_isa.h"
+#include "mace/utils/math.h"
+
+// This implements matrix-matrix multiplication over the vector traits of
+// common_x86.h, it is instantiated per ISA under x86/sse42, x86/avx2 and
+// x86/avx512.
+// In the case of matrix-vector multiplication, use gemv.h instead
+
+namespace mace {
+namespace ops {
+namespace x86 {
+
+template<class V>
+class Gemm : public delegator::Gemm {
+ public:
+  explicit Gemm(const delegator::GemmParam &param)
+      : delegator::Gemm(param),
+        should_cache_pack_(param.should_cache_pack_),
+        cached_(kNoCache) {}
+  ~Gemm() {}
+
+  MaceStatus Compute(
+      const OpContext *context,
+      const Tensor *lhs,
+      const Tensor *rhs,
+      const index_t batch,
+      const index_t rows,
+      const index_t cols,
+      const index_t depth,
+      const MatrixMajor lhs_major,
+      const MatrixMajor rhs_major,
+      const MatrixMajor output_major,
+      const bool lhs_batched,
+      const bool rhs_batched,
+      Tensor *output) override;
+
+  // Original matrix before transpose has row-major
+  MaceStatus Compute(
+      const OpContext *context,
+      const Tensor *lhs,
+      const Tensor *rhs,
+      const index_t batch,
+      const index_t lhs_rows,
+      const index_t lhs_cols,
+      const index_t rhs_rows,
+      const index_t rhs_cols,
+      const bool transpose_lhs,
+      const bool transpose_rhs,
+      const bool transpose_out,
+      const bool lhs_batched,
+      const bool rhs_batched,
+      Tensor *output) override {
+    index_t rows = transpose_lhs ? lhs_cols : lhs_rows;
+    index_t depth = transpose_lhs ? lhs_rows : lhs_cols;
+    index_t cols = transpose_rhs ? rhs_rows : rhs_cols;
+    index_t depth2 = transpose_rhs ? rhs_cols : rhs_rows;
+    MACE_CHECK(depth == depth2,
+               "Matrices that multiply have inconsistent depth dim: ",
+               depth,
+               " vs. ",
+               depth2);
+
+    return Compute(context,
+                   lhs,
+                   rhs,
+                   batch,
+                   rows,
+                   cols,
+                   depth,
+                   transpose_lhs ? ColMajor : RowMajor,
+                   transpose_rhs ? ColMajor : RowMajor,
+                   transpose_out ? ColMajor : RowMajor,
+                   lhs_batched,
+                   rhs_batched,
+                   output);
+  }
+
+  bool PrepackLhs(const OpContext *context,
+                  const Tensor *lhs,
+                  const index_t rows,
+                  const index_t depth,
+                  const MatrixMajor lhs_major) override;
+
+  // Register block: kRowBlockSize x kColBlockSize output tile, i.e. 6 rows
+  // of two vector accumulators.
+  static constexpr index_t kRowBlockSize = 6;
+  static constexpr index_t kColBlockSize = 2 * V::kWidth;
+  // Cache blocks: a depth slice of one packed rhs panel stays in L1 while
+  // kRowCacheBlock packed lhs rows are streamed from L2.
+  static constexpr index_t kDepthCacheBlock = 256;
+  static constexpr index_t kRowCacheBlock = 72;
+  static constexpr index_t kColCacheBlock = 256;
+
+ private:
+  enum { kNoCache, kCacheLhs, kCacheRhs };
+
+  void PackLhs(const MatrixMap<const float> &lhs, float *packed_lhs);
+  // Packs all the row blocks of `lhs`.
+  void PackLhsBlocks(const OpContext *context,
+                     const MatrixMap<const float> &lhs,
+                     float *packed_lhs);
+  void PackRhs(const MatrixMap<const float> &rhs, float *packed_rhs);
+
+  void ComputeBlock(const float *packed_lhs,
+                    const float *packed_rhs,
+                    const index_t depth,
+                    const bool accumulate,
+                    MatrixMap<float> *output);
+
+  // Register layout: (6 x depth) x (depth x 2 * V::kWidth), the output tile
+  // lives in 12 vector accumulators. packed_lhs is a 6-row panel stored
+  // depth by depth, packed_rhs is a (2 * V::kWidth)-col panel stored depth by
+  // depth.
+  static void Kernel(const float *packed_lhs,
+                     const float *packed_rhs,
+                     const index_t depth,
+                     const bool accumulate,
+                     float *output,
+                     const index_t output_stride);
+
+  std::unique_ptr<Tensor> pack_cache_;
+  bool should_cache_pack_;
+  int cached_;
+};
+
+template<class V>
+constexpr index_t Gemm<V>::kRowBlockSize;
+template<class V>
+constexpr index_t Gemm<V>::kColBlockSize;
+template<class V>
+constexpr index_t Gemm<V>::kDepthCacheBlock;
+template<class V>
+constexpr index_t Gemm<V>::kRowCacheBlock;
+template<class V>
+constexpr index_t Gemm<V>::kColCacheBlock;
+
+template<class V>
+void Gemm<V>::Kernel(const float *packed_lhs,
+                     const float *packed_rhs,
+                     const index_t depth,
+                     const bool accumulate,
+                     float *output,
+                     const index_t output_stride) {
+  typedef typename V::Vec Vec;
+  const int width = V::kWidth;
+  Vec c00 = V::Zero();
+  Vec c01 = V::Zero();
+  Vec c10 = V::Zero();
+  Vec c11 = V::Zero();
+  Vec c20 = V::Zero();
+  Vec c21 = V::Zero();
+  Vec c30 = V::Zero();
+  Vec c31 = V::Zero();
+  Vec c40 = V::Zero();
+  Vec c41 = V::Zero();
+  Vec c50 = V::Zero();
+  Vec c51 = V::Zero();
+
+  const float *a = packed_lhs;
+  const float *b = packed_rhs;
+  for (index_t d = 0; d < depth; ++d) {
+    Vec b0 = V::Load(b);
+    Vec b1 = V::Load(b + width);
+
+    Vec a0 = V::Broadcast(a);
+    Vec a1 = V::Broadcast(a + 1);
+    c00 = V::Fma(a0, b0, c00);
+    c01 = V::Fma(a0, b1, c01);
+    c10 = V::Fma(a1, b0, c10);
+    c11 = V::Fma(a1, b1, c11);
+
+    a0 = V::Broadcast(a + 2);
+    a1 = V::Broadcast(a + 3);
+    c20 = V::Fma(a0, b0, c20);
+    c21 = V::Fma(a0, b1, c21);
+    c30 = V::Fma(a1, b0, c30);
+    c31 = V::Fma(a1, b1, c31);
+
+    a0 = V::Broadcast(a + 4);
+    a1 = V::Broadcast(a + 5);
+    c40 = V::Fma(a0, b0, c40);
+    c41 = V::Fma(a0, b1, c41);
+    c50 = V::Fma(a1, b0, c50);
+    c51 = V::Fma(a1, b1, c51);
+
+    a += 6;
+    b += 2 * width;
+  }  // d
+
+#define MACE_X86_GEMM_STORE_ROW(r)                                   \
+  {                                                                  \
+    float *out = output + r * output_stride;                         \
+    if (accumulate) {                                                \
+      c##r##0 = V::Add(c##r##0, V::Load(out));                       \
+      c##r##1 = V::Add(c##r##1, V::Load(out + width));               \
+    }                                                                \
+    V::Store(out, c##r##0);                                          \
+    V::Store(out + width, c##r##1);                                  \
+  }
+
+  MACE_X86_GEMM_STORE_ROW(0);
+  MACE_X86_GEMM_STORE_ROW(1);
+  MACE_X86_GEMM_STORE_ROW(2);
+  MACE_X86_GEMM_STORE_ROW(3);
+  MACE_X86_GEMM_STORE_ROW(4);
+  MACE_X86_GEMM_STORE_ROW(5);
+
+#undef MACE_X86_GEMM_STORE_ROW
+}
+
+template<class V>
+void Gemm<V>::PackLhs(const MatrixMap<const float> &lhs,
+                      float *packed_lhs) {
+  const index_t rows = lhs.rows();
+  const index_t depth = lhs.cols();
+  const index_t block_size = kRowBlockSize;
+
+  if (rows < block_size) {
+    memset(packed_lhs, 0, sizeof(float) * depth * block_size);
+  }
+  if (lhs.matrix_major() == ColMajor) {
+    const float *data = lhs.data();
+    const index_t depth_stride = lhs.cols_stride();
+    for (index_t d = 0; d < depth; ++d) {
+      memcpy(packed_lhs + d * block_size, data, sizeof(float) * rows);
+      data += depth_stride;
+    }  // d
+  } else {
+    for (index_t r = 0; r < rows; ++r) {
+      const float *data = lhs.data(r, 0);
+      float *packed_ptr = packed_lhs + r;
+      for (index_t d = 0; d < depth; ++d) {
+        *packed_ptr = data[d];
+        packed_ptr += block_size;
+      }  // d
+    }  // r
+  }
+}
+
+template<class V>
+void Gemm<V>::PackLhsBlocks(const OpContext *context,
+                            const MatrixMap<const float> &lhs,
+                            float *packed_lhs) {
+  const index_t rows = lhs.rows();
+  const index_t depth = lhs.cols();
+  const index_t row_block_size = kRowBlockSize;
+  utils::ThreadPool &thread_pool = context->runtime()->thread_pool();
+  thread_pool.Compute1D([=, &lhs](index_t start, index_t end, index_t step) {
+    for (index_t row_block_idx = start; row_block_idx < end;
+         row_block_idx += step) {
+      const index_t start_row = row_block_idx * row_block_size;
+      const index_t row_block_len = std::min(row_block_size, rows - start_row);
+      PackLhs(lhs.block(start_row, 0, row_block_len, depth),
+              packed_lhs + row_block_idx * row_block_size * depth);
+    }
+  }, 0, RoundUpDiv(rows, row_block_size), 1);
+}
+
+template<class V>
+bool Gemm<V>::PrepackLhs(const OpContext *context, const Tensor *lhs,
+                         const index_t rows, const index_t depth,
+                         const MatrixMajor lhs_major) {
+  if (!lhs->is_weight()) {
+    return false;
+  }
+  const MatrixMap<const float> lhs_matrix(lhs->data<float>(), lhs_major,
+                                          rows, depth);
+  // the packed layout depends on the vector width and the register block
+  const std::string key = MakeString(lhs->name(), "/x86_gemm_lhs_",
+                                     utils::CPUIsaToString(V::kIsa), "_",
+                                     kRowBlockSize, "_", lhs_major, "_",
+                                     rows, "x", depth);
+  pack_cache_ = LoadOrPackWeight(
+      context->workspace()->packed_weight_cache(), context->runtime(), key,
+      DataType::DT_FLOAT, {RoundUp(rows, kRowBlockSize) * depth},
+      [&](void *packed) {
+        PackLhsBlocks(context, lhs_matrix, static_cast<float *>(packed));
+      });
+  cached_ = kCacheLhs;
+  return true;
+}
+
+template<class V>
+void Gemm<V>::PackRhs(const MatrixMap<const float> &rhs,
+                      float *packed_rhs) {
+  const index_t depth = rhs.rows();
+  const index_t cols = rhs.cols();
+  const index_t block_size = kColBlockSize;
+
+  if (rhs.matrix_major() == RowMajor) {
+    const float *data = rhs.data();
+    const index_t depth_stride = rhs.rows_stride();
+    if (cols == block_size) {
+      for (index_t d = 0; d < depth; ++d) {
+        V::Store(packed_rhs, V::Load(data));
+        V::Store(packed_rhs + V::kWidth, V::Load(data + V::kWidth));
+        data += depth_stride;
+        packed_rhs += block_size;
+      }  // d
+    } else {
+      const index_t cols_remain = block_size - cols;
+      for (index_t d = 0; d < depth; ++d) {
+        memcpy(packed_rhs, data, sizeof(float) * cols);
+        memset(packed_rhs + cols, 0, sizeof(float) * cols_remain);
+        data += depth_stride;
+        packed_rhs += block_size;
+      }  // d
+    }
+  } else {
+    if (cols < block_size) {
+      memset(packed_rhs, 0, sizeof(float) * depth * block_size);
+    }
+    for (index_t c = 0; c < cols; ++c) {
+      const float *data = rhs.data(0, c);
+      float *packed_ptr = packed_rhs + c;
+      for (index_t d = 0; d < depth; ++d) {
+        *packed_ptr = data[d];
+        packed_ptr += block_size;
+      }  // d
+    }  // c
+  }
+}
+
+template<class V>
+void Gemm<V>::ComputeBlock(const float *packed_lhs,
+                           const float *packed_rhs,
+                           const index_t depth,
+                           const bool accumulate,
+                           MatrixMap<float> *output) {
+  const index_t rows = output->rows();
+  const index_t cols = output->cols();
+  if (rows == kRowBlockSize && cols == kColBlockSize
+      && output->matrix_major() == RowMajor) {
+    Kernel(packed_lhs, packed_rhs, depth, accumulate,
+           output->data(), output->stride());
+    return;
+  }
+
+  // Partial or col-major tile: compute the full tile into a temporary and
+  // scatter the valid part.
+  float tile[kRowBlockSize * kColBlockSize];
+  Kernel(packed_lhs, packed_rhs, depth, false, tile, kColBlockSize);
+  for (index_t r = 0; r < rows; ++r) {
+    for (index_t c = 0; c < cols; ++c) {
+      float *out = output->data(r, c);
+      const float value = tile[r * kColBlockSize + c];
+      *out = accumulate ? *out + value : value;
+    }  // c
+  }  // r
+}
+
+template<class V>
+MaceStatus Gemm<V>::Compute(
+    const OpContext *context, const Tensor *lhs, const Tensor *rhs,
+    const index_t batch, const index_t rows, const index_t cols,
+    const index_t depth, const MatrixMajor lhs_major,
+    const MatrixMajor rhs_major, const MatrixMajor output_major,
+    const bool lhs_batched, const bool rhs_batched, Tensor *output) {
+  MACE_CHECK(output->size() == batch * rows * cols,
+             "Need resize output tensor before call gemm.");
+  MACE_CHECK(epilogue_.empty() || output_major == RowMajor,
+             "Gemm epilogue needs a row-major output");
+  const float *lhs_data = lhs->data<float>();
+  const float *rhs_data = rhs->data<float>();
+  float *output_data = output->mutable_data<float>();
+
+  const index_t row_block_size = kRowBlockSize;
+  const index_t col_block_size = kColBlockSize;
+  const index_t row_block_count = RoundUpDiv(rows, row_block_size);
+  const index_t col_block_count = RoundUpDiv(cols, col_block_size);
+  const index_t rows_padded = RoundUp(rows, row_block_size);
+  const index_t cols_padded = RoundUp(cols, col_block_size);
+
+  // Each cache block holds several register blocks
+  const index_t row_cache_blocks = kRowCacheBlock / row_block_size;
+  const index_t col_cache_blocks = kColCacheBlock / col_block_size;
+  const index_t row_cache_block_count =
+      RoundUpDiv(row_block_count, row_cache_blocks);
+  const index_t col_cache_block_count =
+      RoundUpDiv(col_block_count, col_cache_blocks);
+
+  auto *runtime = context->runtime();
+  MemInfo mem_info(output->memory_type(), DataType::DT_FLOAT,
+                   {rows_padded * depth});
+  auto packed_lhs_buffer = runtime->ObtainBuffer(mem_info, RENT_SCRATCH);
+  mem_info.dims = {depth * cols_padded};
+  auto packed_rhs_buffer = runtime->ObtainBuffer(mem_info, RENT_SCRATCH);
+
+  float *packed_lhs_data = packed_lhs_buffer->mutable_data<float>();
+  float *packed_rhs_data = packed_rhs_buffer->mutable_data<float>();
+
+  int cache_side = kNoCache;
+  if (cached_ == kCacheLhs) {
+    MACE_CHECK(pack_cache_->size() == rows_padded * depth,
+               "Packed lhs does not match the gemm shape");
+    packed_lhs_data = pack_cache_->mutable_data<float>();
+  } else if (cached_ == kCacheRhs) {
+    packed_rhs_data = pack_cache_->mutable_data<float>();
+  } else if (should_cache_pack_) {
+    const MemoryType mem_type = output->memory_type();
+    if (lhs->is_weight() && (!lhs_batched || batch == 1)) {
+      cache_side = kCacheLhs;
+      pack_cache_.reset(new Tensor(runtime, DataType::DT_FLOAT,
+                                   mem_type, {rows_padded * depth}));
+      runtime->AllocateBufferForTensor(pack_cache_.get(), RENT_PRIVATE);
+      packed_lhs_data = pack_cache_->mutable_data<float>();
+    } else if (rhs->is_weight() && (!rhs_batched || batch == 1)) {
+      cache_side = kCacheRhs;
+      pack_cache_.reset(new Tensor(runtime, DataType::DT_FLOAT,
+                                   mem_type, {depth * cols_padded}));
+      runtime->AllocateBufferForTensor(pack_cache_.get(), RENT_PRIVATE);
+      packed_rhs_data = pack_cache_->mutable_data<float>();
+    }
+  }
+
+  utils::ThreadPool &thread_pool = context->runtime()->thread_pool();
+
+  for (index_t b = 0; b < batch; ++b) {
+    MatrixMap<const float>
+        lhs_matrix
+        (lhs_data + static_cast<index_t>(lhs_batched) * b * rows * depth,
+         lhs_major,
+         rows,
+         depth);
+    MatrixMap<const float>
+        rhs_matrix
+        (rhs_data + static_cast<index_t>(rhs_batched) * b * depth * cols,
+         rhs_major,
+         depth,
+         cols);
+    MatrixMap<float> output_matrix
+        (output_data + b * rows * cols, output_major, rows, cols);
+
+    // pack lhs
+    if (cached_ != kCacheLhs) {
+      PackLhsBlocks(context, lhs_matrix, packed_lhs_data);
+
+      if (cache_side == kCacheLhs) {
+        cached_ = kCacheLhs;
+        if (lhs->GetCurRuntime()->GetRuntimeType() == RT_CPU) {
+          AdviseFree(const_cast<float *>(lhs->data<float>()), lhs->raw_size());
+        }
+      }
+    }
+
+    // pack rhs
+    if (cached_ != kCacheRhs) {
+      thread_pool.Compute1D([=, &rhs_matrix](index_t start,
+                                             index_t end,
+                                             index_t step) {
+        for (index_t col_block_idx = start; col_block_idx < end;
+             col_block_idx += step) {
+          const index_t start_col = col_block_idx * col_block_size;
+          const index_t
+              col_block_len = std::min(col_block_size, cols - start_col);
+          float *packed_rhs_data_block =
+              packed_rhs_data + col_block_idx * col_block_size * depth;
+          PackRhs(rhs_matrix.block(0, start_col, depth, col_block_len),
+                  packed_rhs_data_block);
+        }
+      }, 0, col_block_count, 1);
+
+      if (cache_side == kCacheRhs) {
+        cached_ = kCacheRhs;
+        if (rhs->GetCurRuntime()->GetRuntimeType() == RT_CPU) {
+          AdviseFree(const_cast<float *>(rhs->data<float>()), rhs->raw_size());
+        }
+      }
+    }
+
+    // multiply lhs and rhs, one (row cache block, col cache block) per task
+    thread_pool.Compute2D([=, &output_matrix](index_t start0,
+                                              index_t end0,
+                                              index_t step0,
+                                              index_t start1,
+                                              index_t end1,
+                                              index_t step1) {
+      for (index_t col_cache_idx = start0; col_cache_idx < end0;
+           col_cache_idx += step0) {
+        const index_t col_block_start = col_cache_idx * col_cache_blocks;
+        const index_t col_block_end =
+            std::min(col_block_start + col_cache_blocks, col_block_count);
+        for (index_t row_cache_idx = start1; row_cache_idx < end1;
+             row_cache_idx += step1) {
+          const index_t row_block_start = row_cache_idx * row_cache_blocks;
+          const index_t row_block_end =
+              std::min(row_block_start + row_cache_blocks, row_block_count);
+
+          for (index_t depth_start = 0; depth_start < depth;
+               depth_start += kDepthCacheBlock) {
+            const index_t depth_len =
+                std::min(kDepthCacheBlock, depth - depth_start);
+            const bool accumulate = depth_start > 0;
+            const bool last_depth_block = depth_start + depth_len == depth;
+            for (index_t col_block_idx = col_block_start;
+                 col_block_idx < col_block_end; ++col_block_idx) {
+              const index_t start_col = col_block_idx * col_block_size;
+              const index_t
+                  col_block_len = std::min(col_block_size, cols - start_col);
+              const float *packed_rhs_data_block =
+                  packed_rhs_data + col_block_idx * col_block_size * depth
+                      + depth_start * col_block_size;
+              for (index_t row_block_idx = row_block_start;
+                   row_block_idx < row_block_end; ++row_block_idx) {
+                const index_t start_row = row_block_idx * row_block_size;
+                const index_t
+                    row_block_len = std::min(row_block_size, rows - start_row);
+                const float *packed_lhs_data_block =
+                    packed_lhs_data + row_block_idx * row_block_size * depth
+                        + depth_start * row_block_size;
+                MatrixMap<float> output_block = output_matrix.block(start_row,
+                                                                start_col,
+                                                                row_block_len,
+                                                                col_block_len);
+                ComputeBlock(packed_lhs_data_block,
+                             packed_rhs_data_block,
+                             depth_len,
+                             accumulate,
+                             &output_block);
+                // the register tile is final, finish it while it is in L1
+                if (last_depth_block && !epilogue_.empty()) {
+                  for (index_t r = 0; r < row_block_len; ++r) {
+                    const index_t row = start_row + r;
+                    ApplyEpilogue<V>(epilogue_, row, col_block_len,
+                                     output_block.data(r, 0));
+                  }  // r
+                }
+              }  // row_block_idx
+            }  // col_block_idx
+          }  // depth_start
+        }  // row_cache_idx
+      }  // col_cache_idx
+    }, 0, col_cache_block_count, 1, 0, row_cache_block_count, 1);
+
+    if (depth == 0) {
+      for (index_t r = 0; r < rows; ++r) {
+        for (index_t c = 0; c < cols; ++c) {
+          output_matrix(r, c) = 0;
+        }
+        if (!epilogue_.empty()) {
+          ApplyEpilogue<V>(epilogue_, r, cols, output_matrix.data(r, 0));
+        }
+      }
+    }
+  }  // b
+
+  return MaceStatus::MACE_SUCCESS;
+}
+
+}  // namespace x86
+}  // namespace ops
+}  // namespace mace
+
+#endif  // MACE_OPS_X86_GEMM_H_
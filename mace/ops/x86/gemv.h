@@ -0,0 +1,211 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_X86_GEMV_H_
+#define MACE_OPS_X86_GEMV_H_
+
+#include <algorithm>
+
+#include "mace/core/compressed_weight.h"
+#include "mace/core/ops/op_context.h"
+#include "mace/core/tensor.h"
+#include "mace/ops/common/apply_epilogue.h"
+#include "mace/ops/delegator/gemv.h"
+#include "mace/ops/x86/common_x86.h"
+#include "mace/public/mace.h"
+#include "mace/utils/math.h"
+
+namespace mace {
+namespace ops {
+namespace x86 {
+
+// Converts `count` values of the compressed `weight` from `offset` on, the
+// fp16 ones with the conversion instructions of V.
+template<class V>
+void DecompressRows(const Tensor *weight, const index_t offset,
+                    const index_t count, float *output) {
+  if (weight->dtype() != DT_HALF) {
+    DecompressWeight(weight, offset, count, output);
+    return;
+  }
+  const half *input = weight->data<half>() + offset;
+  index_t i = 0;
+  for (; i + V::kWidth <= count; i += V::kWidth) {
+    V::Store(output + i, V::LoadHalf(input + i));
+  }
+  for (; i < count; ++i) {
+    output[i] = half_float::half_cast<float>(input[i]);
+  }
+}
+
+template<class V>
+class Gemv : public delegator::Gemv {
+ public:
+  explicit Gemv(const delegator::GemvParam &param)
+      : delegator::Gemv(param) {}
+  ~Gemv() {}
+  // Always row-major after transpose
+  MaceStatus Compute(
+      const OpContext *context,
+      const Tensor *lhs,
+      const Tensor *rhs,
+      const Tensor *bias,
+      const index_t batch,
+      const index_t lhs_height,
+      const index_t lhs_width,
+      const bool lhs_batched,
+      const bool rhs_batched,
+      Tensor *output) override;
+};
+
+template<class V>
+MaceStatus Gemv<V>::Compute(const OpContext *context,
+                            const Tensor *lhs,
+                            const Tensor *rhs,
+                            const Tensor *bias,
+                            const index_t batch,
+                            const index_t lhs_height,
+                            const index_t lhs_width,
+                            const bool lhs_batched,
+                            const bool rhs_batched,
+                            Tensor *output) {
+  typedef typename V::Vec Vec;
+  MACE_CHECK(output->size() == batch * lhs_height,
+             "Need resize output tensor before call gemv.");
+
+  // the rows of a compressed weight are converted block by block, so only
+  // its stored bytes are streamed from memory, an unbatched block once for
+  // all the batches of a tile
+  const bool compressed = IsCompressedWeight(lhs);
+  const float *lhs_data = compressed ? nullptr : lhs->data<float>();
+  const float *rhs_data = rhs->data<float>();
+  const float *bias_data = nullptr;
+  if (bias) {
+    bias_data = bias->data<float>();
+  }
+  float *output_data = output->mutable_data<float>();
+
+  const index_t h_block_size = 4;
+  const index_t h_block_count = RoundUpDiv(lhs_height, h_block_size);
+  const index_t w_block_size = V::kWidth;
+  const index_t w_block_count = lhs_width / w_block_size;
+  const index_t w_remain = lhs_width - w_block_size * w_block_count;
+
+  utils::ThreadPool &thread_pool = context->runtime()->thread_pool();
+
+  thread_pool.Compute2D([=](index_t start0, index_t end0, index_t step0,
+                            index_t start1, index_t end1, index_t step1) {
+    float *lhs_buf =
+        compressed ? DecompressScratch(h_block_size * lhs_width) : nullptr;
+    for (index_t h_block_idx = start0; h_block_idx < end0;
+         h_block_idx += step0) {
+      const index_t h_start = h_block_idx * h_block_size;
+      const index_t h_block_len =
+          std::min(h_block_size, lhs_height - h_start);
+      for (index_t b = start1; b < end1; b += step1) {
+        const index_t lhs_offset =
+            static_cast<index_t>(lhs_batched) * b * lhs_height * lhs_width
+            + lhs_width * h_start;
+        const float *lhs_ptr = nullptr;
+        if (compressed) {
+          if (lhs_batched || b == start1) {
+            DecompressRows<V>(lhs, lhs_offset, h_block_len * lhs_width,
+                              lhs_buf);
+          }
+          lhs_ptr = lhs_buf;
+        } else {
+          lhs_ptr = lhs_data + lhs_offset;
+        }
+        const float *rhs_ptr =
+            rhs_data + static_cast<index_t>(rhs_batched) * b * lhs_width;
+        float
+            *ret_ptr = output_data + b * lhs_height + h_start;
+
+        if (h_block_len == 4) {
+          // Register layout: (4 x width) x (width, 1), one rhs load feeds
+          // four rows
+          const float *lhs_ptr0 = lhs_ptr;
+          const float *lhs_ptr1 = lhs_ptr0 + lhs_width;
+          const float *lhs_ptr2 = lhs_ptr1 + lhs_width;
+          const float *lhs_ptr3 = lhs_ptr2 + lhs_width;
+          Vec vo0 = V::Zero();
+          Vec vo1 = V::Zero();
+          Vec vo2 = V::Zero();
+          Vec vo3 = V::Zero();
+          for (index_t w = 0; w < w_block_count; ++w) {
+            Vec vr = V::Load(rhs_ptr);
+            vo0 = V::Fma(V::Load(lhs_ptr0), vr, vo0);
+            vo1 = V::Fma(V::Load(lhs_ptr1), vr, vo1);
+            vo2 = V::Fma(V::Load(lhs_ptr2), vr, vo2);
+            vo3 = V::Fma(V::Load(lhs_ptr3), vr, vo3);
+            lhs_ptr0 += w_block_size;
+            lhs_ptr1 += w_block_size;
+            lhs_ptr2 += w_block_size;
+            lhs_ptr3 += w_block_size;
+            rhs_ptr += w_block_size;
+          }  // w
+          float s0 = V::ReduceAdd(vo0);
+          float s1 = V::ReduceAdd(vo1);
+          float s2 = V::ReduceAdd(vo2);
+          float s3 = V::ReduceAdd(vo3);
+          for (index_t w = 0; w < w_remain; ++w) {
+            s0 += lhs_ptr0[w] * rhs_ptr[w];
+            s1 += lhs_ptr1[w] * rhs_ptr[w];
+            s2 += lhs_ptr2[w] * rhs_ptr[w];
+            s3 += lhs_ptr3[w] * rhs_ptr[w];
+          }  // w
+          if (bias_data) {
+            s0 += bias_data[h_start];
+            s1 += bias_data[h_start + 1];
+            s2 += bias_data[h_start + 2];
+            s3 += bias_data[h_start + 3];
+          }
+          ret_ptr[0] = s0;
+          ret_ptr[1] = s1;
+          ret_ptr[2] = s2;
+          ret_ptr[3] = s3;
+        } else {
+          for (index_t h = 0; h < h_block_len; ++h) {
+            const float *lhs_row = lhs_ptr + h * lhs_width;
+            Vec vo = V::Zero();
+            for (index_t w = 0; w < w_block_count; ++w) {
+              vo = V::Fma(V::Load(lhs_row + w * w_block_size),
+                          V::Load(rhs_ptr + w * w_block_size), vo);
+            }  // w
+            float s0 = V::ReduceAdd(vo);
+            const index_t w_offset = w_block_count * w_block_size;
+            for (index_t w = 0; w < w_remain; ++w) {
+              s0 += lhs_row[w_offset + w] * rhs_ptr[w_offset + w];
+            }  // w
+            if (bias_data) {
+              s0 += bias_data[h_start + h];
+            }
+            ret_ptr[h] = s0;
+          }  // h
+        }  // if
+        if (!epilogue_.empty()) {
+          ApplyEpilogue<V>(epilogue_, h_start, h_block_len, ret_ptr);
+        }
+      }  // b
+    }  // h_block_idx
+  }, 0, h_block_count, 1, 0, batch, 1);
+
+  return MaceStatus::MACE_SUCCESS;
+}
+
+}  // namespace x86
+}  // namespace ops
+}  // namespace mace
+
+#endif  // MACE_OPS_X86_GEMV_H_
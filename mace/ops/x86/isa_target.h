@@ -0,0 +1,85 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_X86_ISA_TARGET_H_
+#define MACE_OPS_X86_ISA_TARGET_H_
+
+// The translation units under x86/<isa> are built with the baseline flags
+// like the rest of MACE, only the kernels included between
+// MACE_X86_TARGET_BEGIN(isa) and MACE_X86_TARGET_END are compiled for the
+// ISA. Had the whole unit been built with e.g. -mavx2, every inline function
+// and template of the shared headers it instantiates (Tensor, MatrixMap,
+// std::vector, ...) would be emitted with AVX2 instructions as well, and the
+// linker may keep that copy for all the callers, including those running on
+// CPUs without AVX2.
+//
+// So the shared headers the kernels use are all included here, ahead of the
+// region, and only headers defining ISA specific code, i.e. templates over
+// the vector traits or kernels of the ISA, may be included inside it. The
+// delegators are registered outside of the region, registration runs on
+// every CPU.
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mace/core/compressed_weight.h"
+#include "mace/core/ops/op_context.h"
+#include "mace/core/packed_weight_cache.h"
+#include "mace/core/registry/op_delegator_registry.h"
+#include "mace/core/runtime/runtime.h"
+#include "mace/core/tensor.h"
+#include "mace/core/types.h"
+#include "mace/core/workspace.h"
+#include "mace/ops/common/conv_pool_2d_util.h"
+#include "mace/ops/common/epilogue.h"
+#include "mace/ops/common/matrix.h"
+#include "mace/ops/delegator/activation.h"
+#include "mace/ops/delegator/conv_2d.h"
+#include "mace/ops/delegator/gemm.h"
+#include "mace/ops/delegator/gemv.h"
+#include "mace/ops/delegator/vector_math.h"
+#include "mace/ops/x86/conv_2d.h"
+#include "mace/public/mace.h"
+#include "mace/utils/cpu_isa.h"
+#include "mace/utils/macros.h"
+#include "mace/utils/math.h"
+#include "mace/utils/memory.h"
+#include "mace/utils/thread_pool.h"
+
+#ifdef MACE_ENABLE_QUANTIZE
+#include "mace/ops/common/q8_conv_2d.h"
+#include "mace/ops/common/q8_gemm.h"
+#endif  // MACE_ENABLE_QUANTIZE
+
+#define MACE_X86_PRAGMA(x) _Pragma(#x)
+
+#if defined(__clang__)
+#define MACE_X86_TARGET_BEGIN(isa)                                    \
+  MACE_X86_PRAGMA(clang attribute push(__attribute__((target(isa))), \
+                                       apply_to = function))
+#define MACE_X86_TARGET_END MACE_X86_PRAGMA(clang attribute pop)
+#else
+#define MACE_X86_TARGET_BEGIN(isa) \
+  MACE_X86_PRAGMA(GCC push_options) MACE_X86_PRAGMA(GCC target(isa))
+#define MACE_X86_TARGET_END MACE_X86_PRAGMA(GCC pop_options)
+#endif  // __clang__
+
+#endif  // MACE_OPS_X86_ISA_TARGET_H_
@@ -0,0 +1,32 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_X86_KERNELS_H_
+#define MACE_OPS_X86_KERNELS_H_
+
+// The float kernels templated over the vector traits, included by the
+// x86/<isa> translation units inside their target region, see isa_target.h.
+
+#include "mace/ops/common/apply_epilogue.h"
+#include "mace/ops/common/vector_math.h"
+#include "mace/ops/x86/activation.h"
+#include "mace/ops/x86/common_x86.h"
+#include "mace/ops/x86/conv_2d_1x1.h"
+#include "mace/ops/x86/conv_2d_3x3_winograd.h"
+#include "mace/ops/x86/conv_2d_general.h"
+#include "mace/ops/x86/conv_2d_mxn.h"
+#include "mace/ops/x86/gemm.h"
+#include "mace/ops/x86/gemv.h"
+
+#endif  // MACE_OPS_X86_KERNELS_H_
@@ -0,0 +1,192 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_X86_Q8_GEMM_H_
+#define MACE_OPS_X86_Q8_GEMM_H_
+
+#include <immintrin.h>
+
+#include <cstring>
+
+#include "mace/ops/common/q8_gemm.h"
+
+// Kernels of the quantized gemm in common/q8_gemm.h, compiled in the target
+// regions of x86/avx2 and x86/avx512vnni, see isa_target.h.
+
+namespace mace {
+namespace ops {
+namespace x86 {
+
+namespace q8 {
+
+// The 4 depth values of a packed lhs row as one int32. It is templated on the
+// kernel using it, as code compiled for different ISAs must not share a symbol.
+template<class K>
+inline int32_t LoadDepthGroup(const uint8_t *data) {
+  int32_t group;
+  memcpy(&group, data, sizeof(group));
+  return group;
+}
+
+// 4 x 16 tile. The uint8 values are split into their even and odd depth
+// values as int16, multiplied and added in pairs by vpmaddwd, which is exact
+// as the products are at most 255 * 255.
+struct GemmKernelAvx2 {
+  static constexpr index_t kRows = 4;
+  static constexpr index_t kCols = 16;
+  static constexpr int32_t kRhsOffset = 0;
+
+  static void Run(const uint8_t *packed_lhs,
+                  const uint8_t *packed_rhs,
+                  const index_t depth_groups,
+                  int32_t *tile) {
+    const __m256i even_mask = _mm256_set1_epi32(0x00ff00ff);
+    __m256i c00 = _mm256_setzero_si256();
+    __m256i c01 = _mm256_setzero_si256();
+    __m256i c10 = _mm256_setzero_si256();
+    __m256i c11 = _mm256_setzero_si256();
+    __m256i c20 = _mm256_setzero_si256();
+    __m256i c21 = _mm256_setzero_si256();
+    __m256i c30 = _mm256_setzero_si256();
+    __m256i c31 = _mm256_setzero_si256();
+
+    for (index_t g = 0; g < depth_groups; ++g) {
+      const __m256i b0 = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(packed_rhs));
+      const __m256i b1 = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(packed_rhs + 32));
+      const __m256i b0_even = _mm256_and_si256(b0, even_mask);
+      const __m256i b0_odd = _mm256_srli_epi16(b0, 8);
+      const __m256i b1_even = _mm256_and_si256(b1, even_mask);
+      const __m256i b1_odd = _mm256_srli_epi16(b1, 8);
+
+#define MACE_Q8_GEMM_AVX2_ROW(r)                                          \
+      {                                                                   \
+        const __m256i a = _mm256_set1_epi32(                              \
+            LoadDepthGroup<GemmKernelAvx2>(packed_lhs + r * 4));          \
+        const __m256i a_even = _mm256_and_si256(a, even_mask);            \
+        const __m256i a_odd = _mm256_srli_epi16(a, 8);                    \
+        c##r##0 = _mm256_add_epi32(c##r##0, _mm256_add_epi32(             \
+            _mm256_madd_epi16(a_even, b0_even),                           \
+            _mm256_madd_epi16(a_odd, b0_odd)));                           \
+        c##r##1 = _mm256_add_epi32(c##r##1, _mm256_add_epi32(             \
+            _mm256_madd_epi16(a_even, b1_even),                           \
+            _mm256_madd_epi16(a_odd, b1_odd)));                           \
+      }
+
+      MACE_Q8_GEMM_AVX2_ROW(0);
+      MACE_Q8_GEMM_AVX2_ROW(1);
+      MACE_Q8_GEMM_AVX2_ROW(2);
+      MACE_Q8_GEMM_AVX2_ROW(3);
+
+#undef MACE_Q8_GEMM_AVX2_ROW
+
+      packed_lhs += kRows * 4;
+      packed_rhs += kCols * 4;
+    }  // g
+
+    __m256i *out = reinterpret_cast<__m256i *>(tile);
+    _mm256_storeu_si256(out, c00);
+    _mm256_storeu_si256(out + 1, c01);
+    _mm256_storeu_si256(out + 2, c10);
+    _mm256_storeu_si256(out + 3, c11);
+    _mm256_storeu_si256(out + 4, c20);
+    _mm256_storeu_si256(out + 5, c21);
+    _mm256_storeu_si256(out + 6, c30);
+    _mm256_storeu_si256(out + 7, c31);
+  }
+};
+
+// 8 x 32 tile, one vpdpbusd multiplies 4 depth values of a uint8 lhs row by
+// those of 16 rhs cols, which it takes as int8, hence rhs is packed
+// with an offset of 128.
+struct GemmKernelAvx512Vnni {
+  static constexpr index_t kRows = 8;
+  static constexpr index_t kCols = 32;
+  static constexpr int32_t kRhsOffset = 128;
+
+  static void Run(const uint8_t *packed_lhs,
+                  const uint8_t *packed_rhs,
+                  const index_t depth_groups,
+                  int32_t *tile) {
+    __m512i c00 = _mm512_setzero_si512();
+    __m512i c01 = _mm512_setzero_si512();
+    __m512i c10 = _mm512_setzero_si512();
+    __m512i c11 = _mm512_setzero_si512();
+    __m512i c20 = _mm512_setzero_si512();
+    __m512i c21 = _mm512_setzero_si512();
+    __m512i c30 = _mm512_setzero_si512();
+    __m512i c31 = _mm512_setzero_si512();
+    __m512i c40 = _mm512_setzero_si512();
+    __m512i c41 = _mm512_setzero_si512();
+    __m512i c50 = _mm512_setzero_si512();
+    __m512i c51 = _mm512_setzero_si512();
+    __m512i c60 = _mm512_setzero_si512();
+    __m512i c61 = _mm512_setzero_si512();
+    __m512i c70 = _mm512_setzero_si512();
+    __m512i c71 = _mm512_setzero_si512();
+
+    for (index_t g = 0; g < depth_groups; ++g) {
+      const __m512i b0 = _mm512_loadu_si512(packed_rhs);
+      const __m512i b1 = _mm512_loadu_si512(packed_rhs + 64);
+
+#define MACE_Q8_GEMM_VNNI_ROW(r)                                          \
+      {                                                                   \
+        const __m512i a = _mm512_set1_epi32(                              \
+            LoadDepthGroup<GemmKernelAvx512Vnni>(packed_lhs + r * 4));    \
+        c##r##0 = _mm512_dpbusd_epi32(c##r##0, a, b0);                    \
+        c##r##1 = _mm512_dpbusd_epi32(c##r##1, a, b1);                    \
+      }
+
+      MACE_Q8_GEMM_VNNI_ROW(0);
+      MACE_Q8_GEMM_VNNI_ROW(1);
+      MACE_Q8_GEMM_VNNI_ROW(2);
+      MACE_Q8_GEMM_VNNI_ROW(3);
+      MACE_Q8_GEMM_VNNI_ROW(4);
+      MACE_Q8_GEMM_VNNI_ROW(5);
+      MACE_Q8_GEMM_VNNI_ROW(6);
+      MACE_Q8_GEMM_VNNI_ROW(7);
+
+#undef MACE_Q8_GEMM_VNNI_ROW
+
+      packed_lhs += kRows * 4;
+      packed_rhs += kCols * 4;
+    }  // g
+
+    _mm512_storeu_si512(tile, c00);
+    _mm512_storeu_si512(tile + 16, c01);
+    _mm512_storeu_si512(tile + 32, c10);
+    _mm512_storeu_si512(tile + 48, c11);
+    _mm512_storeu_si512(tile + 64, c20);
+    _mm512_storeu_si512(tile + 80, c21);
+    _mm512_storeu_si512(tile + 96, c30);
+    _mm512_storeu_si512(tile + 112, c31);
+    _mm512_storeu_si512(tile + 128, c40);
+    _mm512_storeu_si512(tile + 144, c41);
+    _mm512_storeu_si512(tile + 160, c50);
+    _mm512_storeu_si512(tile + 176, c51);
+    _mm512_storeu_si512(tile + 192, c60);
+    _mm512_storeu_si512(tile + 208, c61);
+    _mm512_storeu_si512(tile + 224, c70);
+    _mm512_storeu_si512(tile + 240, c71);
+  }
+};
+
+}  // namespace q8
+
+}  // namespace x86
+}  // namespace ops
+}  // namespace mace
+
+#endif  // MACE_OPS_X86_Q8_GEMM_H_
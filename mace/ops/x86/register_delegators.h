@@ -0,0 +1,141 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_X86_REGISTER_DELEGATORS_H_
+#define MACE_OPS_X86_REGISTER_DELEGATORS_H_
+
+#include "mace/core/registry/op_delegator_registry.h"
+#include "mace/ops/delegator/conv_2d.h"
+#include "mace/ops/delegator/gemm.h"
+#include "mace/ops/x86/kernels.h"
+
+#ifdef MACE_ENABLE_QUANTIZE
+#include "mace/ops/common/q8_conv_2d.h"
+#include "mace/ops/common/q8_gemm.h"
+#include "mace/ops/x86/q8_gemm.h"
+#endif  // MACE_ENABLE_QUANTIZE
+
+// Included after the target region of the x86/<isa> translation units, so
+// that registering runs on every CPU, see isa_target.h.
+
+namespace mace {
+namespace ops {
+namespace x86 {
+
+// Registers all x86 delegators instantiated with the vector traits V, the
+// registry only hands them out when the CPU ISA is at least V::kIsa.
+template<class V>
+void RegisterDelegators(OpDelegatorRegistry *registry) {
+  const CPUIsa isa = V::kIsa;
+
+  MACE_REGISTER_ISA_DELEGATOR(
+      registry, Activation<V>, delegator::ActivationParam,
+      MACE_DELEGATOR_KEY(Activation, RuntimeType::RT_CPU,
+                         float, ImplType::X86), isa);
+  MACE_REGISTER_ISA_DELEGATOR(
+      registry, VectorMath<V>, DelegatorParam,
+      MACE_DELEGATOR_KEY(VectorMath, RuntimeType::RT_CPU,
+                         float, ImplType::X86), isa);
+
+  MACE_REGISTER_ISA_DELEGATOR(
+      registry, Gemm<V>, delegator::GemmParam,
+      MACE_DELEGATOR_KEY(Gemm, RuntimeType::RT_CPU, float, ImplType::X86),
+      isa);
+  MACE_REGISTER_ISA_DELEGATOR(
+      registry, Gemv<V>, delegator::GemvParam,
+      MACE_DELEGATOR_KEY(Gemv, RuntimeType::RT_CPU, float, ImplType::X86),
+      isa);
+
+  MACE_REGISTER_ISA_DELEGATOR(
+      registry, Conv2dGeneral<V>, delegator::Conv2dParam,
+      MACE_DELEGATOR_KEY(Conv2d, RuntimeType::RT_CPU, float, ImplType::X86),
+      isa);
+  MACE_REGISTER_ISA_DELEGATOR(
+      registry, Conv2dK1x1<V>, delegator::Conv2dParam,
+      MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU,
+                            float, ImplType::X86, K1x1), isa);
+  MACE_REGISTER_ISA_DELEGATOR(
+      registry, Conv2dK3x3Winograd<V>, delegator::Conv2dParam,
+      MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU,
+                            float, ImplType::X86, K3x3Winograd), isa);
+  MACE_REGISTER_ISA_DELEGATOR(
+      registry, Conv2dK3x3S1<V>, delegator::Conv2dParam,
+      MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU,
+                            float, ImplType::X86, K3x3S1), isa);
+  MACE_REGISTER_ISA_DELEGATOR(
+      registry, Conv2dK3x3S2<V>, delegator::Conv2dParam,
+      MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU,
+                            float, ImplType::X86, K3x3S2), isa);
+  MACE_REGISTER_ISA_DELEGATOR(
+      registry, Conv2dK5x5S1<V>, delegator::Conv2dParam,
+      MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU,
+                            float, ImplType::X86, K5x5S1), isa);
+  MACE_REGISTER_ISA_DELEGATOR(
+      registry, Conv2dK7x7S1<V>, delegator::Conv2dParam,
+      MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU,
+                            float, ImplType::X86, K7x7S1), isa);
+  MACE_REGISTER_ISA_DELEGATOR(
+      registry, Conv2dK7x7S2<V>, delegator::Conv2dParam,
+      MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU,
+                            float, ImplType::X86, K7x7S2), isa);
+  MACE_REGISTER_ISA_DELEGATOR(
+      registry, Conv2dK7x7S3<V>, delegator::Conv2dParam,
+      MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU,
+                            float, ImplType::X86, K7x7S3), isa);
+  MACE_REGISTER_ISA_DELEGATOR(
+      registry, Conv2dK1x7S1<V>, delegator::Conv2dParam,
+      MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU,
+                            float, ImplType::X86, K1x7S1), isa);
+  MACE_REGISTER_ISA_DELEGATOR(
+      registry, Conv2dK7x1S1<V>, delegator::Conv2dParam,
+      MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU,
+                            float, ImplType::X86, K7x1S1), isa);
+  MACE_REGISTER_ISA_DELEGATOR(
+      registry, Conv2dK1x15S1<V>, delegator::Conv2dParam,
+      MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU,
+                            float, ImplType::X86, K1x15S1), isa);
+  MACE_REGISTER_ISA_DELEGATOR(
+      registry, Conv2dK15x1S1<V>, delegator::Conv2dParam,
+      MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU,
+                            float, ImplType::X86, K15x1S1), isa);
+}
+
+#ifdef MACE_ENABLE_QUANTIZE
+// Registers the uint8 and int32 output gemm and the uint8 convolution of
+// kernel K, handed out when the CPU ISA is at least `isa`.
+template<class K>
+void RegisterQ8Delegators(OpDelegatorRegistry *registry, const CPUIsa isa) {
+  typedef ops::q8::Gemm<K, uint8_t> GemmUint8;
+  typedef ops::q8::Gemm<K, int32_t> GemmInt32;
+  typedef ops::q8::Conv2d<K> Conv2dUint8;
+  MACE_REGISTER_ISA_DELEGATOR(
+      registry, GemmUint8, delegator::GemmParam,
+      MACE_DELEGATOR_KEY(Gemm, RuntimeType::RT_CPU, uint8_t, ImplType::X86),
+      isa);
+  MACE_REGISTER_ISA_DELEGATOR(
+      registry, GemmInt32, delegator::GemmParam,
+      MACE_DELEGATOR_KEY(Gemm, RuntimeType::RT_CPU, int32_t, ImplType::X86),
+      isa);
+  MACE_REGISTER_ISA_DELEGATOR(
+      registry, Conv2dUint8, delegator::Conv2dParam,
+      MACE_DELEGATOR_KEY(Conv2d, RuntimeType::RT_CPU, uint8_t, ImplType::X86),
+      isa);
+}
+#endif  // MACE_ENABLE_QUANTIZE
+
+}  // namespace x86
+}  // namespace ops
+}  // namespace mace
+
+#endif  // MACE_OPS_X86_REGISTER_DELEGATORS_H_
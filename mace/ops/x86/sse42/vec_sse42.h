@@ -0,0 +1,90 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_X86_SSE42_VEC_SSE42_H_
+#define MACE_OPS_X86_SSE42_VEC_SSE42_H_
+
+#include <immintrin.h>
+
+#include "mace/ops/x86/common_x86.h"
+
+namespace mace {
+namespace ops {
+namespace x86 {
+
+// The SSE4.2 vector traits, see common_x86.h.
+struct VecSse42 {
+  typedef __m128 Vec;
+  static const int kWidth = 4;
+  static const CPUIsa kIsa = CPUIsa::CPU_ISA_SSE42;
+
+  static inline Vec Zero() { return _mm_setzero_ps(); }
+  static inline Vec Set1(const float v) { return _mm_set1_ps(v); }
+  static inline Vec Broadcast(const float *p) { return _mm_load1_ps(p); }
+  static inline Vec Load(const float *p) { return _mm_loadu_ps(p); }
+  static inline void Store(float *p, Vec v) { _mm_storeu_ps(p, v); }
+  static inline Vec LoadStrided(const float *p, const int stride) {
+    return _mm_setr_ps(p[0], p[stride], p[2 * stride], p[3 * stride]);
+  }
+  static inline Vec Add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+  static inline Vec Sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+  static inline Vec Mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+  // a * b + c, no fused multiply-add before AVX2
+  static inline Vec Fma(Vec a, Vec b, Vec c) {
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+  }
+  static inline float ReduceAdd(Vec v) {
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_movehdup_ps(v));
+    return _mm_cvtss_f32(v);
+  }
+  // SSE has no fp16 conversion
+  static inline Vec LoadHalf(const half *p) {
+    return _mm_setr_ps(half_float::half_cast<float>(p[0]),
+                       half_float::half_cast<float>(p[1]),
+                       half_float::half_cast<float>(p[2]),
+                       half_float::half_cast<float>(p[3]));
+  }
+  static inline Vec Div(Vec a, Vec b) { return _mm_div_ps(a, b); }
+  // the second operand if either is NaN
+  static inline Vec Max(Vec a, Vec b) { return _mm_max_ps(a, b); }
+  static inline Vec Min(Vec a, Vec b) { return _mm_min_ps(a, b); }
+  // to the nearest integer, ties to even
+  static inline Vec Round(Vec v) {
+    return _mm_round_ps(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  }
+  // v * 2^n for integral n in [-126, 127]
+  static inline Vec Ldexp(Vec v, Vec n) {
+    const __m128i e = _mm_add_epi32(_mm_cvtps_epi32(n), _mm_set1_epi32(127));
+    return _mm_mul_ps(v, _mm_castsi128_ps(_mm_slli_epi32(e, 23)));
+  }
+  // z * 2^k = v with z in [sqrt(0.5), sqrt(2)), for positive normal v
+  static inline Vec Frexp(Vec v, Vec *k) {
+    const __m128i bits = _mm_castps_si128(v);
+    const __m128i offset = _mm_sub_epi32(bits, _mm_set1_epi32(0x3f3504f3));
+    *k = _mm_cvtepi32_ps(_mm_srai_epi32(offset, 23));
+    return _mm_castsi128_ps(_mm_sub_epi32(
+        bits, _mm_and_si128(offset, _mm_set1_epi32(0xff800000))));
+  }
+  // a < b ? x : y
+  static inline Vec SelectLess(Vec a, Vec b, Vec x, Vec y) {
+    return _mm_blendv_ps(y, x, _mm_cmplt_ps(a, b));
+  }
+};
+
+}  // namespace x86
+}  // namespace ops
+}  // namespace mace
+
+#endif  // MACE_OPS_X86_SSE42_VEC_SSE42_H_
@@ -32,6 +32,13 @@ CpuRefRuntime::~CpuRefRuntime() {
   VLOG(1) << "Destroy CpuRefRuntime";
 }
 
+std::unique_ptr<Runtime> CpuRefRuntime::CreateConcurrentRuntime(
+    RuntimeContext *runtime_context) {
+  auto *runtime = new CpuRefRuntime(runtime_context);
+  runtime->set_tuner(tuner_);
+  return std::unique_ptr<Runtime>(runtime);
+}
+
 MemoryManager *CpuRefRuntime::GetMemoryManager(MemoryType mem_type) {
   MemoryManager *buffer_manager = nullptr;
   if (mem_type == MemoryType::CPU_BUFFER) {
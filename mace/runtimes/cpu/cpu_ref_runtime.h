@@ -28,6 +28,9 @@ class CpuRefRuntime : public CpuRuntime {
   explicit CpuRefRuntime(RuntimeContext *runtime_context);
   ~CpuRefRuntime();
 
+  std::unique_ptr<Runtime> CreateConcurrentRuntime(
+      RuntimeContext *runtime_context) override;
+
  protected:
   MemoryManager *GetMemoryManager(MemoryType mem_type) override;
 
@@ -14,16 +14,21 @@
 
 #include "mace/runtimes/cpu/cpu_runtime.h"
 
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "mace/core/memory/buffer.h"
 #include "mace/core/proto/net_def_helper.h"
+#include "mace/utils/cpu_isa.h"
 #include "mace/utils/memory.h"
+#include "mace/utils/tuner.h"
 
 namespace mace {
 
 CpuRuntime::CpuRuntime(RuntimeContext *runtime_context)
-    : Runtime(runtime_context) {}
+    : Runtime(runtime_context), cpu_isa_(CPUIsa::CPU_ISA_NONE),
+      compressed_weights_(false) {}
 
 MaceStatus CpuRuntime::Init(const MaceEngineCfgImpl *engine_config,
                             const MemoryType mem_type) {
@@ -33,10 +38,33 @@ MaceStatus CpuRuntime::Init(const MaceEngineCfgImpl *engine_config,
 #endif  // MACE_ENABLE_QUANTIZE
   SetThreadsHintAndAffinityPolicy(engine_config->num_threads(),
                                   engine_config->cpu_affinity_policy());
+  cpu_isa_ = utils::ResolveCPUIsa(engine_config->cpu_isa());
+  VLOG(1) << "CPU ISA: " << utils::CPUIsaToString(cpu_isa_)
+          << ", host supports: "
+          << utils::CPUIsaToString(utils::GetHostCPUIsa());
+  compressed_weights_ = engine_config->compressed_weights();
+
+  const std::string parameter_path = engine_config->cpu_parameter_path();
+  if (GetTuningFromEnv() || !parameter_path.empty()) {
+    tuner_ = std::make_shared<Tuner<uint32_t>>(
+        parameter_path, nullptr, 0, kCpuRunParameterPathEnv);
+  }
 
   return MaceStatus::MACE_SUCCESS;
 }
 
+CPUIsa CpuRuntime::cpu_isa() const {
+  return cpu_isa_;
+}
+
+Tuner<uint32_t> *CpuRuntime::tuner() const {
+  return tuner_.get();
+}
+
+void CpuRuntime::set_tuner(std::shared_ptr<Tuner<uint32_t>> tuner) {
+  tuner_ = std::move(tuner);
+}
+
 RuntimeType CpuRuntime::GetRuntimeType() {
   return RuntimeType::RT_CPU;
 }
@@ -45,13 +73,17 @@ std::unique_ptr<Buffer> CpuRuntime::MakeSliceBuffer(
     const NetDef &net_def,
     const unsigned char *model_data, const index_t model_data_size) {
   MACE_ASSERT(model_data != nullptr && model_data_size > 0);
-  if (NetDefHelper::HasHalfTensor(net_def)) {
-    return nullptr;
-  }
+  // compressed weights are converted by the kernels reading them, or once
+  // by the flow for the others, see DecompressConstForCPU
+  if (!compressed_weights_) {
+    if (NetDefHelper::HasHalfTensor(net_def)) {
+      return nullptr;
+    }
 
-  if (!NetDefHelper::IsQuantizedModel(net_def) &&
-      NetDefHelper::HasQuantizedTensor(net_def)) {
-    return nullptr;
+    if (!NetDefHelper::IsQuantizedModel(net_def) &&
+        NetDefHelper::HasQuantizedTensor(net_def)) {
+      return nullptr;
+    }
   }
 
   MemoryType mem_type = MemoryType::CPU_BUFFER;
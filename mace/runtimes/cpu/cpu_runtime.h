@@ -25,6 +25,10 @@
 #endif  // MACE_ENABLE_QUANTIZE
 
 namespace mace {
+
+template <typename param_type>
+class Tuner;
+
 class CpuRuntime : public Runtime {
  public:
   explicit CpuRuntime(RuntimeContext *runtime_context);
@@ -38,6 +42,15 @@ class CpuRuntime : public Runtime {
   MaceStatus Init(const MaceEngineCfgImpl *engine_config,
                   const MemoryType mem_type) override;
 
+  // Instruction set the CPU kernels are selected for, resolved from the
+  // engine config, the MACE_CPU_ISA environment variable and the host.
+  CPUIsa cpu_isa() const;
+
+  // Tuned parameters of the CPU ops, nullptr if neither tuning nor given a
+  // parameter file. Shared with the runtimes created for concurrent ops.
+  Tuner<uint32_t> *tuner() const;
+  void set_tuner(std::shared_ptr<Tuner<uint32_t>> tuner);
+
   RuntimeType GetRuntimeType() override;
   std::unique_ptr<Buffer> MakeSliceBuffer(
       const NetDef &net_def, const unsigned char *model_data,
@@ -57,6 +70,13 @@ class CpuRuntime : public Runtime {
 #ifdef MACE_ENABLE_QUANTIZE
   std::unique_ptr<gemmlowp::GemmContext> gemm_context_;
 #endif  // MACE_ENABLE_QUANTIZE
+  CPUIsa cpu_isa_;
+  // fp16 and uint8 weights are sliced from the model data as they are
+  // stored, instead of being converted to float copies
+  bool compressed_weights_;
+
+ protected:
+  std::shared_ptr<Tuner<uint32_t>> tuner_;
 };
 
 }  // namespace mace
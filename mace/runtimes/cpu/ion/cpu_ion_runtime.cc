@@ -19,6 +19,7 @@
 #include "mace/core/memory/buffer.h"
 #include "mace/core/runtime/runtime_context.h"
 #include "mace/core/runtime/runtime_registry.h"
+#include "mace/runtimes/cpu/cpu_ref_runtime.h"
 #include "mace/utils/memory.h"
 
 namespace mace {
@@ -38,6 +39,14 @@ RuntimeSubType CpuIonRuntime::GetRuntimeSubType() {
     return RuntimeSubType::RT_SUB_ION;
 }
 
+// Scratch memory of concurrent ops is never shared with other devices.
+std::unique_ptr<Runtime> CpuIonRuntime::CreateConcurrentRuntime(
+    RuntimeContext *runtime_context) {
+  auto *runtime = new CpuRefRuntime(runtime_context);
+  runtime->set_tuner(tuner_);
+  return std::unique_ptr<Runtime>(runtime);
+}
+
 MemoryManager *CpuIonRuntime::GetMemoryManager(MemoryType mem_type) {
   MemoryManager *buffer_manager = nullptr;
   if (mem_type == MemoryType::CPU_BUFFER) {
@@ -29,6 +29,8 @@ class CpuIonRuntime : public CpuRuntime {
   ~CpuIonRuntime() = default;
 
   RuntimeSubType GetRuntimeSubType() override;
+  std::unique_ptr<Runtime> CreateConcurrentRuntime(
+      RuntimeContext *runtime_context) override;
 
  protected:
   MemoryManager *GetMemoryManager(MemoryType mem_type) override;
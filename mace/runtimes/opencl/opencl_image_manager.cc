@@ -16,6 +16,7 @@
 
 #include <string>
 #include "mace/utils/logging.h"
+#include "mace/utils/tracer.h"
 
 namespace mace {
 
@@ -26,6 +27,11 @@ OpenclImageManager::~OpenclImageManager() {}
 
 void *OpenclImageManager::ObtainMemory(const MemInfo &info,
                                        const BufRentType rent_type) {
+  utils::TraceSpan trace_span("memory", "ObtainMemory");
+  if (trace_span.active()) {
+    trace_span.AddArg("bytes", info.bytes());
+    trace_span.AddArg("rent_type", rent_type);
+  }
   if (shared_pools_.count(rent_type) == 0) {
     shared_pools_.emplace(rent_type, make_unique<ImagePool>(allocator_));
   }
@@ -151,6 +151,9 @@ DEFINE_string(opencl_binary_file,
 DEFINE_string(opencl_parameter_file,
               "",
               "tuned OpenCL parameter file path");
+DEFINE_string(cpu_parameter_file,
+              "",
+              "tuned CPU parameter file path");
 DEFINE_string(model_data_file,
               "",
               "model data file name, used when EMBED_MODEL_DATA set to 0 or 2");
@@ -185,6 +188,8 @@ DEFINE_int32(opencl_cache_reuse_policy,
 DEFINE_int32(accelerator_cache_policy, 0, "0:NONE/1:STORE/2:LOAD/3:APU_LOAD_OR_STORE");
 DEFINE_bool(benchmark, false, "enable benchmark op");
 DEFINE_bool(fake_warmup, false, "enable fake warmup");
+DEFINE_string(trace_file, "",
+              "write a Chrome trace of the rounds run to the file");
 
 namespace {
 std::shared_ptr<char> ReadInputDataFromFile(
@@ -341,6 +346,7 @@ bool RunModel(const std::string &model_name,
   if (status != MaceStatus::MACE_SUCCESS) {
     LOG(WARNING) << "Set cpu affinity failed.";
   }
+  config.SetCPUParameterPath(FLAGS_cpu_parameter_file);
 #if defined(MACE_ENABLE_OPENCL) || defined(MACE_ENABLE_HTA)
   std::shared_ptr<OpenclContext> opencl_context;
   const char *storage_path_ptr = getenv("MACE_INTERNAL_STORAGE_PATH");
@@ -598,6 +604,9 @@ bool RunModel(const std::string &model_name,
     benchmark::OpStat op_stat;
     if (FLAGS_round > 0) {
       LOG(INFO) << "Run model";
+      if (!FLAGS_trace_file.empty()) {
+        StartTracing();
+      }
       int64_t total_run_duration = 0;
       for (int i = 0; i < FLAGS_round; ++i) {
         std::unique_ptr<port::Logger> info_log;
@@ -666,6 +675,13 @@ bool RunModel(const std::string &model_name,
       }
       model_run_millis = total_run_duration / 1000.0 / FLAGS_round;
       LOG(INFO) << "Average latency: " << model_run_millis << " ms";
+      if (!FLAGS_trace_file.empty()) {
+        if (StopTracing(FLAGS_trace_file) == MaceStatus::MACE_SUCCESS) {
+          LOG(INFO) << "Write trace file " << FLAGS_trace_file << " done.";
+        } else {
+          LOG(ERROR) << "Failed to write trace file " << FLAGS_trace_file;
+        }
+      }
     }
 
     for (size_t i = 0; i < output_count; ++i) {
@@ -742,6 +758,8 @@ int Main(int argc, char **argv) {
   LOG(INFO) << "gpu_priority_hint: " << FLAGS_gpu_priority_hint;
   LOG(INFO) << "num_threads: " << FLAGS_num_threads;
   LOG(INFO) << "cpu_affinity_policy: " << FLAGS_cpu_affinity_policy;
+  LOG(INFO) << "trace_file: " << FLAGS_trace_file;
+  LOG(INFO) << "cpu_parameter_file: " << FLAGS_cpu_parameter_file;
   auto limit_opencl_kernel_time = getenv("MACE_LIMIT_OPENCL_KERNEL_TIME");
   if (limit_opencl_kernel_time) {
     LOG(INFO) << "limit_opencl_kernel_time: "
@@ -0,0 +1,204 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/utils/cpu_isa.h"
+
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__) || \
+    defined(_M_X64) || defined(_M_IX86)
+#define MACE_CPU_ISA_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(__aarch64__) && (defined(__linux__) || defined(__ANDROID__))
+#define MACE_CPU_ISA_ARM64_LINUX 1
+#include <sys/auxv.h>
+#ifndef HWCAP_ASIMDDP
+#define HWCAP_ASIMDDP (1 << 20)
+#endif
+#endif
+
+#include "mace/port/env.h"
+#include "mace/utils/logging.h"
+#include "mace/utils/string_util.h"
+
+namespace mace {
+namespace utils {
+
+namespace {
+
+#ifdef MACE_CPU_ISA_X86
+void CpuId(int leaf, int sub_leaf, unsigned int regs[4]) {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuidex(info, leaf, sub_leaf);
+  for (int i = 0; i < 4; ++i) {
+    regs[i] = static_cast<unsigned int>(info[i]);
+  }
+#else
+  __cpuid_count(leaf, sub_leaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Register state enabled by the OS in XCR0
+uint64_t XGetBv() {
+#if defined(_MSC_VER)
+  return _xgetbv(0);
+#else
+  unsigned int eax, edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+CPUIsa DetectCPUIsa() {
+  unsigned int regs[4];
+  CpuId(0, 0, regs);
+  const unsigned int max_leaf = regs[0];
+  if (max_leaf < 1) {
+    return CPU_ISA_NONE;
+  }
+
+  CpuId(1, 0, regs);
+  const unsigned int ecx1 = regs[2];
+  const bool has_sse42 = (ecx1 >> 20) & 1;
+  const bool has_fma = (ecx1 >> 12) & 1;
+  const bool has_f16c = (ecx1 >> 29) & 1;
+  const bool has_osxsave = (ecx1 >> 27) & 1;
+  const bool has_avx = (ecx1 >> 28) & 1;
+  if (!has_sse42) {
+    return CPU_ISA_NONE;
+  }
+  if (!has_osxsave || !has_avx || !has_fma || !has_f16c || max_leaf < 7) {
+    return CPU_ISA_SSE42;
+  }
+
+  // XMM | YMM state, plus opmask | ZMM_Hi256 | Hi16_ZMM for AVX-512
+  const uint64_t xcr0 = XGetBv();
+  const bool os_avx = (xcr0 & 0x6) == 0x6;
+  const bool os_avx512 = (xcr0 & 0xe6) == 0xe6;
+
+  CpuId(7, 0, regs);
+  const unsigned int ebx7 = regs[1];
+  const unsigned int ecx7 = regs[2];
+  const bool has_avx2 = (ebx7 >> 5) & 1;
+  const bool has_avx512f = (ebx7 >> 16) & 1;
+  const bool has_avx512bw = (ebx7 >> 30) & 1;
+  const bool has_avx512vnni = (ecx7 >> 11) & 1;
+  if (!os_avx || !has_avx2) {
+    return CPU_ISA_SSE42;
+  }
+  if (!os_avx512 || !has_avx512f) {
+    return CPU_ISA_AVX2;
+  }
+  if (!has_avx512bw || !has_avx512vnni) {
+    return CPU_ISA_AVX512;
+  }
+  return CPU_ISA_AVX512_VNNI;
+}
+#else
+CPUIsa DetectCPUIsa() {
+  return CPU_ISA_NONE;
+}
+#endif  // MACE_CPU_ISA_X86
+
+bool ParseCPUIsa(const std::string &name, CPUIsa *isa) {
+  if (name == "auto") {
+    *isa = CPU_ISA_AUTO;
+  } else if (name == "none" || name == "ref") {
+    *isa = CPU_ISA_NONE;
+  } else if (name == "sse4.2" || name == "sse42") {
+    *isa = CPU_ISA_SSE42;
+  } else if (name == "avx2") {
+    *isa = CPU_ISA_AVX2;
+  } else if (name == "avx512") {
+    *isa = CPU_ISA_AVX512;
+  } else if (name == "avx512_vnni" || name == "avx512vnni") {
+    *isa = CPU_ISA_AVX512_VNNI;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+CPUIsa GetHostCPUIsa() {
+  static const CPUIsa host_isa = DetectCPUIsa();
+  return host_isa;
+}
+
+CPUIsa ResolveCPUIsa(CPUIsa requested) {
+  CPUIsa isa = requested;
+  std::string env_isa;
+  if (GetEnv("MACE_CPU_ISA", &env_isa) == MaceStatus::MACE_SUCCESS
+      && !env_isa.empty()) {
+    if (!ParseCPUIsa(ToLower(env_isa), &isa)) {
+      LOG(WARNING) << "Unknown MACE_CPU_ISA value: " << env_isa
+                   << ", expect one of auto, none, sse4.2, avx2, avx512"
+                   << " and avx512_vnni";
+      isa = requested;
+    }
+  }
+
+  const CPUIsa host_isa = GetHostCPUIsa();
+  if (isa == CPU_ISA_AUTO) {
+    return host_isa;
+  }
+  if (isa > host_isa) {
+    LOG(WARNING) << "CPU ISA " << CPUIsaToString(isa)
+                 << " is not supported by the host, use "
+                 << CPUIsaToString(host_isa);
+    return host_isa;
+  }
+  return isa;
+}
+
+bool HostHasArmDotProduct() {
+#ifdef MACE_CPU_ISA_ARM64_LINUX
+  static const bool has_dot_product =
+      (getauxval(AT_HWCAP) & HWCAP_ASIMDDP) != 0;
+  return has_dot_product;
+#else
+  return false;
+#endif
+}
+
+const char *CPUIsaToString(CPUIsa isa) {
+  switch (isa) {
+    case CPU_ISA_AUTO:
+      return "auto";
+    case CPU_ISA_NONE:
+      return "none";
+    case CPU_ISA_SSE42:
+      return "sse4.2";
+    case CPU_ISA_AVX2:
+      return "avx2";
+    case CPU_ISA_AVX512:
+      return "avx512";
+    case CPU_ISA_AVX512_VNNI:
+      return "avx512_vnni";
+    default:
+      return "unknown";
+  }
+}
+
+}  // namespace utils
+}  // namespace mace
@@ -0,0 +1,41 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_UTILS_CPU_ISA_H_
+#define MACE_UTILS_CPU_ISA_H_
+
+#include "mace/public/mace.h"
+
+namespace mace {
+namespace utils {
+
+// Best instruction set supported by both the CPU and the OS, probed once.
+// Always CPU_ISA_NONE on non-x86 hosts.
+CPUIsa GetHostCPUIsa();
+
+// Resolve the instruction set kernels should use: the MACE_CPU_ISA
+// environment variable overrides `requested`, CPU_ISA_AUTO maps to the host
+// ISA and levels above the host ISA are lowered to it.
+CPUIsa ResolveCPUIsa(CPUIsa requested);
+
+const char *CPUIsaToString(CPUIsa isa);
+
+// Whether the CPU has the Armv8.2 dot product instructions (sdot/udot),
+// probed once. Always false on hosts other than arm64 Linux/Android.
+bool HostHasArmDotProduct();
+
+}  // namespace utils
+}  // namespace mace
+
+#endif  // MACE_UTILS_CPU_ISA_H_
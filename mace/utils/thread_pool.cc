@@ -13,6 +13,8 @@
 // limitations under the License.
 
 #include <algorithm>
+#include <chrono>  // NOLINT(build/c++11)
+#include <limits>
 #include <numeric>
 
 #include "mace/port/port.h"
@@ -21,31 +23,65 @@
 #include "mace/utils/spinlock.h"
 #include "mace/utils/math.h"
 #include "mace/utils/thread_pool.h"
+#include "mace/utils/tracer.h"
 
 namespace mace {
 namespace utils {
 
 constexpr int kThreadPoolSpinWaitTime = 2000000;  // ns
-constexpr int kTileCountPerThread = 2;
+// tiles per thread when the cost of the items is unknown
+constexpr int kTileCountPerThread = 4;
+// fewer tiles per thread leave stealing little to balance, more tiles cost
+// more calls of the kernels
+constexpr int kMaxTileCountPerThread = 16;
 constexpr int kMaxCostUsingSingleThread = 100;
+constexpr int kMinCostPerTile = 4 * kMaxCostUsingSingleThread;
+// an owner claims 1 / kClaimDivisor of its remaining tiles at a time
+constexpr int64_t kClaimDivisor = 4;
+// weight of the last job in the measured speed of a worker
+constexpr float kSpeedUpdateRate = 0.25f;
+constexpr float kMinSpeed = 0.25f;
+constexpr float kMaxSpeed = 4.f;
 constexpr int kMinCpuCoresForPerformance = 3;
 constexpr int kMaxCpuCoresForPerformance = 5;
 
 namespace {
 
-enum {
-  kThreadPoolNone = 0,
-  kThreadPoolInit = 1,
-  kThreadPoolRun = 2,
-  kThreadPoolShutdown = 4,
-  kThreadPoolEventMask = 0x7fffffff
+struct JobLimits {
+  int max_threads;
+  int tiles_per_thread;
 };
 
+// set by ThreadPool::SetJobLimits for the jobs of the calling thread
+thread_local JobLimits job_limits = {0, 0};
+
+// the pool whose tiles the calling thread is running. A Run from inside a
+// tile runs inline: on this pool it can't wait for the job, on any pool the
+// thread local slot of the calling thread is taken.
+thread_local const ThreadPool *tile_pool = nullptr;
+
 struct CPUFreq {
   size_t core_id;
   float freq;
 };
 
+inline uint64_t PackRange(const int64_t begin, const int64_t end) {
+  return (static_cast<uint64_t>(end) << 32) | static_cast<uint64_t>(begin);
+}
+
+inline int64_t RangeBegin(const uint64_t range) {
+  return static_cast<int64_t>(range & 0xffffffffULL);
+}
+
+inline int64_t RangeEnd(const uint64_t range) {
+  return static_cast<int64_t>(range >> 32);
+}
+
+int64_t NowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 int GetCpuCoresForPerfomance(
     const std::vector<CPUFreq> &cpu_freqs,
     const std::function<bool(const float &x, const float &y)> &comp) {
@@ -145,7 +181,7 @@ MaceStatus GetCPUCoresToUse(const std::vector<float> &cpu_max_freqs,
 
 ThreadPool::ThreadPool(const int thread_count_hint,
                        const CPUAffinityPolicy policy)
-    : event_(kThreadPoolNone),
+    : shutdown_(false),
       count_down_latch_(kThreadPoolSpinWaitTime) {
   int thread_count = thread_count_hint;
 
@@ -166,16 +202,17 @@ ThreadPool::ThreadPool(const int thread_count_hint,
     }
   }
 
-  default_tile_count_ = thread_count;
-  if (thread_count > 1) {
-    default_tile_count_ = thread_count * kTileCountPerThread;
-  }
-  MACE_CHECK(default_tile_count_ > 0, "default tile count should > 0");
-
   threads_ = std::vector<std::thread>(static_cast<size_t>(thread_count));
-  thread_infos_ = std::vector<ThreadInfo>(static_cast<size_t>(thread_count));
-  for (auto &thread_info : thread_infos_) {
-    thread_info.cpu_cores = cores_to_use;
+  workers_ = std::vector<Worker, CacheLineAllocator<Worker>>(
+      static_cast<size_t>(thread_count));
+  for (auto &worker : workers_) {
+    worker.slot.range = PackRange(0, 0);
+    worker.slot.tiles = 0;
+    worker.slot.busy_ns = 0;
+    worker.slot.speed = 1.f;
+    worker.job = nullptr;
+    worker.job_slot = 0;
+    worker.cpu_cores = cores_to_use;
   }
 }
 
@@ -197,43 +234,139 @@ void ThreadPool::Init() {
   if (threads_.size() <= 1) {
     return;
   }
+  // the jobs take the idle workers from the back
+  for (size_t i = threads_.size() - 1; i > 0; --i) {
+    idle_workers_.push_back(i);
+  }
   count_down_latch_.Reset(static_cast<int>(threads_.size() - 1));
-  event_ = kThreadPoolInit;
   for (size_t i = 1; i < threads_.size(); ++i) {
     threads_[i] = std::thread(&ThreadPool::ThreadLoop, this, i);
   }
   count_down_latch_.Wait();
 }
 
+void ThreadPool::SetJobLimits(const int max_threads,
+                              const int tiles_per_thread) {
+  job_limits.max_threads = std::max(0, max_threads);
+  job_limits.tiles_per_thread = std::max(0, tiles_per_thread);
+}
+
+size_t ThreadPool::ActiveThreadCount() const {
+  const size_t max_threads = static_cast<size_t>(job_limits.max_threads);
+  if (max_threads > 0 && max_threads < threads_.size()) {
+    return max_threads;
+  }
+  return threads_.size();
+}
+
 void ThreadPool::Run(const std::function<void(const int64_t)> &func,
                      const int64_t iterations) {
-  const size_t thread_count = threads_.size();
-  const int64_t iters_per_thread = iterations / thread_count;
-  const int64_t remainder = iterations % thread_count;
-  int64_t iters_offset = 0;
-
-  std::unique_lock<std::mutex> run_lock(run_mutex_);
+  const size_t thread_count = ActiveThreadCount();
+  if (thread_count <= 1 || iterations <= 1 || tile_pool != nullptr) {
+    for (int64_t i = 0; i < iterations; ++i) {
+      func(i);
+    }
+    return;
+  }
+  MACE_CHECK(iterations <= std::numeric_limits<int32_t>::max(),
+             "too many tiles: ", iterations);
+
+  // The calling thread keeps its slot, and so its measured speed, from job
+  // to job. Inline runs above keep these from being reused by nested jobs.
+  static thread_local Slot caller_slot = {{PackRange(0, 0)}, 0, 0, 1.f};
+  static thread_local std::vector<Slot *> slots;
+  static thread_local std::vector<size_t> job_workers;
+  job_workers.clear();
+  {
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+    while (job_workers.size() + 1 < thread_count && !idle_workers_.empty()) {
+      job_workers.push_back(idle_workers_.back());
+      idle_workers_.pop_back();
+    }
+  }
+  if (job_workers.empty()) {
+    // the jobs of other threads have all the workers
+    for (int64_t i = 0; i < iterations; ++i) {
+      func(i);
+    }
+    return;
+  }
+  slots.clear();
+  slots.push_back(&caller_slot);
+  for (size_t tid : job_workers) {
+    slots.push_back(&workers_[tid].slot);
+  }
 
-  for (size_t i = 0; i < thread_count; ++i) {
-    int64_t range_len =
-        iters_per_thread + (static_cast<int64_t>(i) < remainder);
-    thread_infos_[i].range_start = iters_offset;
-    thread_infos_[i].range_len = range_len;
-    thread_infos_[i].range_end = iters_offset + range_len;
-    thread_infos_[i].func = reinterpret_cast<uintptr_t>(&func);
-    iters_offset = thread_infos_[i].range_end;
+  // split the tiles in proportion to the speed of the threads of the job
+  double total_speed = 0.0;
+  for (const Slot *slot : slots) {
+    total_speed += slot->speed;
+  }
+  double speed_sum = 0.0;
+  int64_t begin = 0;
+  for (size_t i = 0; i < slots.size(); ++i) {
+    speed_sum += slots[i]->speed;
+    const int64_t end = i + 1 == slots.size() ? iterations :
+        std::min(iterations, static_cast<int64_t>(
+            iterations * speed_sum / total_speed + 0.5));
+    slots[i]->range.store(PackRange(begin, end), std::memory_order_relaxed);
+    slots[i]->tiles = 0;
+    slots[i]->busy_ns = 0;
+    begin = end;
   }
 
-  count_down_latch_.Reset(static_cast<int>(thread_count - 1));
+  Job job;
+  job.func = &func;
+  job.slots = &slots;
+  job.pending.store(static_cast<int>(job_workers.size()),
+                    std::memory_order_relaxed);
+  for (size_t i = 0; i < job_workers.size(); ++i) {
+    Worker &worker = workers_[job_workers[i]];
+    worker.job_slot = i + 1;
+    worker.job.store(&job, std::memory_order_release);
+  }
   {
     std::unique_lock<std::mutex> m(event_mutex_);
-    event_.store(kThreadPoolRun | ~(event_ | kThreadPoolEventMask),
-                 std::memory_order::memory_order_release);
     event_cond_.notify_all();
   }
 
-  ThreadRun(0);
-  count_down_latch_.Wait();
+  ThreadRun(&job, 0);
+  SpinWaitUntil(job.pending, 0, kThreadPoolSpinWaitTime);
+  if (job.pending.load(std::memory_order_acquire) != 0) {
+    std::unique_lock<std::mutex> m(done_mutex_);
+    while (job.pending.load(std::memory_order_acquire) != 0) {
+      done_cond_.wait(m);
+    }
+  }
+  if (iterations >= static_cast<int64_t>(slots.size() * kTileCountPerThread)) {
+    UpdateSpeeds(slots);
+  }
+
+  std::lock_guard<std::mutex> lock(idle_mutex_);
+  idle_workers_.insert(idle_workers_.end(), job_workers.rbegin(),
+                       job_workers.rend());
+}
+
+void ThreadPool::UpdateSpeeds(const std::vector<Slot *> &slots) {
+  float rate_sum = 0.f;
+  int rate_count = 0;
+  for (const Slot *slot : slots) {
+    if (slot->tiles > 0 && slot->busy_ns > 0) {
+      rate_sum += static_cast<float>(slot->tiles) / slot->busy_ns;
+      ++rate_count;
+    }
+  }
+  if (rate_count <= 1) {
+    return;
+  }
+  const float mean_rate = rate_sum / rate_count;
+  for (Slot *slot : slots) {
+    if (slot->tiles > 0 && slot->busy_ns > 0) {
+      const float speed = std::max(kMinSpeed, std::min(
+          kMaxSpeed, slot->tiles / (slot->busy_ns * mean_rate)));
+      slot->speed += (speed - slot->speed) * kSpeedUpdateRate;
+    }
+  }
 }
 
 void ThreadPool::Destroy() {
@@ -242,12 +375,9 @@ void ThreadPool::Destroy() {
     return;
   }
 
-  std::unique_lock<std::mutex> run_lock(run_mutex_);
-
-  count_down_latch_.Wait();
   {
     std::unique_lock<std::mutex> m(event_mutex_);
-    event_.store(kThreadPoolShutdown, std::memory_order::memory_order_release);
+    shutdown_.store(true, std::memory_order_release);
     event_cond_.notify_all();
   }
 
@@ -261,79 +391,157 @@ void ThreadPool::Destroy() {
   }
 }
 
-// Event is executed synchronously.
 void ThreadPool::ThreadLoop(size_t tid) {
-  if (!thread_infos_[tid].cpu_cores.empty()) {
-    if (port::Env::Default()->SchedSetAffinity(thread_infos_[tid].cpu_cores)
+  Tracer::SetThreadName(MakeString("ThreadPool worker ", tid));
+  Worker &worker = workers_[tid];
+  if (!worker.cpu_cores.empty()) {
+    if (port::Env::Default()->SchedSetAffinity(worker.cpu_cores)
         != MaceStatus::MACE_SUCCESS) {
       LOG(ERROR) << "Failed to sched set affinity for tid: " << tid;
     }
   }
-
-  int last_event = kThreadPoolNone;
+  count_down_latch_.CountDown();
 
   for (;;) {
-    SpinWait(event_, last_event, kThreadPoolSpinWaitTime);
-    if (event_.load(std::memory_order::memory_order_acquire) == last_event) {
-      std::unique_lock<std::mutex> m(event_mutex_);
-      while (event_ == last_event) {
-        event_cond_.wait(m);
-      }
+    Job *job = WaitForJob(tid);
+    if (job == nullptr) {
+      return;
+    }
+    ThreadRun(job, worker.job_slot);
+    // the job is gone once the caller sees no pending worker
+    worker.job.store(nullptr, std::memory_order_relaxed);
+    if (job->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      std::unique_lock<std::mutex> m(done_mutex_);
+      done_cond_.notify_all();
     }
+  }
+}
 
-    int event = event_.load(std::memory_order::memory_order_acquire);
-    switch (event & kThreadPoolEventMask) {
-      case kThreadPoolInit: {
-        count_down_latch_.CountDown();
-        break;
-      }
+// Returns the job given to worker `tid`, or nullptr once the pool shuts
+// down. Spins for a while before sleeping, jobs often come in bursts.
+ThreadPool::Job *ThreadPool::WaitForJob(size_t tid) {
+  const Worker &worker = workers_[tid];
+  const int64_t start_time = NowNanos();
+  for (size_t k = 1;; ++k) {
+    Job *job = worker.job.load(std::memory_order_acquire);
+    if (job != nullptr || shutdown_.load(std::memory_order_acquire)) {
+      return job;
+    }
+    if (k % 1000 == 0 && NowNanos() - start_time > kThreadPoolSpinWaitTime) {
+      break;
+    }
+  }
+  std::unique_lock<std::mutex> m(event_mutex_);
+  for (;;) {
+    Job *job = worker.job.load(std::memory_order_acquire);
+    if (job != nullptr || shutdown_.load(std::memory_order_acquire)) {
+      return job;
+    }
+    event_cond_.wait(m);
+  }
+}
 
-      case kThreadPoolRun: {
-        ThreadRun(tid);
-        count_down_latch_.CountDown();
-        break;
+void ThreadPool::ThreadRun(Job *job, size_t slot_idx) {
+  Slot &slot = *(*job->slots)[slot_idx];
+  const std::function<void(int64_t)> &func = *job->func;
+  const ThreadPool *outer_pool = tile_pool;
+  tile_pool = this;
+  TraceSpan trace_span("thread_pool", "Run tiles");
+  const int64_t start_time = NowNanos();
+  int64_t tiles = 0;
+  int64_t steals = 0;
+  int64_t begin = 0;
+  int64_t end = 0;
+  for (;;) {
+    while (ClaimTiles(&slot, &begin, &end)) {
+      for (int64_t tile = begin; tile < end; ++tile) {
+        func(tile);
       }
-
-      case kThreadPoolShutdown: return;
-      default: break;
+      tiles += end - begin;
     }
-
-    last_event = event;
+    if (!StealTiles(job, slot_idx)) {
+      break;
+    }
+    ++steals;
   }
+  tile_pool = outer_pool;
+  slot.tiles = tiles;
+  slot.busy_ns = NowNanos() - start_time;
+  trace_span.AddArg("tiles", tiles);
+  trace_span.AddArg("steals", steals);
 }
 
-void ThreadPool::ThreadRun(size_t tid) {
-  ThreadInfo &thread_info = thread_infos_[tid];
-  uintptr_t func_ptr = thread_info.func;
-  const std::function<void(int64_t)> *func =
-      reinterpret_cast<const std::function<void(int64_t)> *>(func_ptr);
-  // do own work
-  int64_t range_len;
-  while ((range_len = thread_info.range_len) > 0) {
-    if (thread_info.range_len.compare_exchange_strong(range_len,
-                                                      range_len - 1)) {
-      func->operator()(thread_info.range_start++);
+// Claims a chunk from the front of the own range, only thieves contend.
+bool ThreadPool::ClaimTiles(Slot *slot, int64_t *begin, int64_t *end) {
+  std::atomic<uint64_t> &range = slot->range;
+  uint64_t current = range.load(std::memory_order_acquire);
+  for (;;) {
+    const int64_t range_begin = RangeBegin(current);
+    const int64_t range_end = RangeEnd(current);
+    if (range_begin >= range_end) {
+      return false;
+    }
+    const int64_t chunk =
+        std::max<int64_t>(1, (range_end - range_begin) / kClaimDivisor);
+    if (range.compare_exchange_weak(
+        current, PackRange(range_begin + chunk, range_end),
+        std::memory_order_acq_rel, std::memory_order_acquire)) {
+      *begin = range_begin;
+      *end = range_begin + chunk;
+      return true;
     }
   }
+}
 
-  // steal other threads' work
-  size_t thread_count = threads_.size();
-  for (size_t t = (tid + 1) % thread_count; t != tid;
-       t = (t + 1) % thread_count) {
-    ThreadInfo &other_thread_info = thread_infos_[t];
-    uintptr_t other_func_ptr = other_thread_info.func;
-    const std::function<void(int64_t)> *other_func =
-        reinterpret_cast<const std::function<void(int64_t)> *>(
-            other_func_ptr);
-    while ((range_len = other_thread_info.range_len) > 0) {
-      if (other_thread_info.range_len.compare_exchange_strong(range_len,
-                                                              range_len
-                                                                  - 1)) {
-        int64_t tail = other_thread_info.range_end--;
-        other_func->operator()(tail - 1);
+// Moves the back half of the largest remaining range of the job to the own
+// range, which is empty, so that it can be stolen again. Returns false if no
+// tile is left.
+bool ThreadPool::StealTiles(Job *job, size_t slot_idx) {
+  const std::vector<Slot *> &slots = *job->slots;
+  const size_t slot_count = slots.size();
+  for (;;) {
+    size_t victim = slot_idx;
+    uint64_t victim_range = 0;
+    int64_t most_tiles = 0;
+    for (size_t t = (slot_idx + 1) % slot_count; t != slot_idx;
+         t = (t + 1) % slot_count) {
+      const uint64_t range = slots[t]->range.load(std::memory_order_acquire);
+      const int64_t tiles = RangeEnd(range) - RangeBegin(range);
+      if (tiles > most_tiles) {
+        victim = t;
+        victim_range = range;
+        most_tiles = tiles;
       }
     }
+    if (victim == slot_idx) {
+      return false;
+    }
+
+    const int64_t range_begin = RangeBegin(victim_range);
+    const int64_t range_end = RangeEnd(victim_range);
+    const int64_t stolen_begin = range_end - (most_tiles + 1) / 2;
+    if (slots[victim]->range.compare_exchange_strong(
+        victim_range, PackRange(range_begin, stolen_begin),
+        std::memory_order_acq_rel, std::memory_order_acquire)) {
+      slots[slot_idx]->range.store(PackRange(stolen_begin, range_end),
+                                   std::memory_order_release);
+      return true;
+    }
+  }
+}
+
+int64_t ThreadPool::TileCount(const int64_t items,
+                              const int cost_per_item) const {
+  const int64_t thread_count = static_cast<int64_t>(ActiveThreadCount());
+  int64_t tile_count = thread_count * kTileCountPerThread;
+  if (job_limits.tiles_per_thread > 0) {
+    tile_count = thread_count * job_limits.tiles_per_thread;
+  } else if (cost_per_item >= 0) {
+    tile_count = std::max(thread_count, std::min(
+        thread_count * kMaxTileCountPerThread,
+        items * cost_per_item / kMinCostPerTile));
   }
+  return std::max<int64_t>(1, std::min(items, tile_count));
 }
 
 void ThreadPool::Compute1D(const std::function<void(int64_t,
@@ -349,14 +557,14 @@ void ThreadPool::Compute1D(const std::function<void(int64_t,
   }
 
   const int64_t items = 1 + (end - start - 1) / step;
-  if (threads_.size() <= 1 || (cost_per_item >= 0
+  if (ActiveThreadCount() <= 1 || (cost_per_item >= 0
       && items * cost_per_item < kMaxCostUsingSingleThread)) {
     func(start, end, step);
     return;
   }
 
   if (tile_size == 0) {
-    tile_size = 1 + (items - 1) / default_tile_count_;
+    tile_size = 1 + (items - 1) / TileCount(items, cost_per_item);
   }
 
   const int64_t step_tile_size = step * tile_size;
@@ -389,19 +597,20 @@ void ThreadPool::Compute2D(const std::function<void(const int64_t,
 
   const int64_t items0 = 1 + (end0 - start0 - 1) / step0;
   const int64_t items1 = 1 + (end1 - start1 - 1) / step1;
-  if (threads_.size() <= 1 || (cost_per_item >= 0
+  if (ActiveThreadCount() <= 1 || (cost_per_item >= 0
       && items0 * items1 * cost_per_item < kMaxCostUsingSingleThread)) {
     func(start0, end0, step0, start1, end1, step1);
     return;
   }
 
   if (tile_size0 == 0 || tile_size1 == 0) {
-    if (items0 >= default_tile_count_) {
-      tile_size0 = 1 + (items0 - 1) / default_tile_count_;
+    const int64_t tile_count = TileCount(items0 * items1, cost_per_item);
+    if (items0 >= tile_count) {
+      tile_size0 = 1 + (items0 - 1) / tile_count;
       tile_size1 = items1;
     } else {
       tile_size0 = 1;
-      tile_size1 = 1 + (items1 * items0 - 1) / default_tile_count_;
+      tile_size1 = 1 + (items1 * items0 - 1) / tile_count;
     }
   }
 
@@ -450,7 +659,7 @@ void ThreadPool::Compute3D(const std::function<void(const int64_t,
   const int64_t items0 = 1 + (end0 - start0 - 1) / step0;
   const int64_t items1 = 1 + (end1 - start1 - 1) / step1;
   const int64_t items2 = 1 + (end2 - start2 - 1) / step2;
-  if (threads_.size() <= 1 || (cost_per_item >= 0
+  if (ActiveThreadCount() <= 1 || (cost_per_item >= 0
       && items0 * items1 * items2 * cost_per_item
           < kMaxCostUsingSingleThread)) {
     func(start0, end0, step0, start1, end1, step1, start2, end2, step2);
@@ -458,19 +667,21 @@ void ThreadPool::Compute3D(const std::function<void(const int64_t,
   }
 
   if (tile_size0 == 0 || tile_size1 == 0 || tile_size2 == 0) {
-    if (items0 >= default_tile_count_) {
-      tile_size0 = 1 + (items0 - 1) / default_tile_count_;
+    const int64_t tile_count =
+        TileCount(items0 * items1 * items2, cost_per_item);
+    if (items0 >= tile_count) {
+      tile_size0 = 1 + (items0 - 1) / tile_count;
       tile_size1 = items1;
       tile_size2 = items2;
     } else {
       tile_size0 = 1;
       const int64_t items01 = items1 * items0;
-      if (items01 >= default_tile_count_) {
-        tile_size1 = 1 + (items01 - 1) / default_tile_count_;
+      if (items01 >= tile_count) {
+        tile_size1 = 1 + (items01 - 1) / tile_count;
         tile_size2 = items2;
       } else {
         tile_size1 = 1;
-        tile_size2 = 1 + (items01 * items2 - 1) / default_tile_count_;
+        tile_size2 = 1 + (items01 * items2 - 1) / tile_count;
       }
     }
   }
@@ -15,6 +15,8 @@
 #ifndef MACE_UTILS_THREAD_POOL_H_
 #define MACE_UTILS_THREAD_POOL_H_
 
+#include <cstdint>
+#include <cstdlib>
 #include <functional>
 #include <condition_variable>  // NOLINT(build/c++11)
 #include <mutex>  // NOLINT(build/c++11)
@@ -23,17 +25,57 @@
 #include <atomic>
 
 #include "mace/public/mace.h"
+#include "mace/port/env.h"
 #include "mace/port/port.h"
 #include "mace/utils/count_down_latch.h"
 
 namespace mace {
 namespace utils {
 
+constexpr size_t kCacheLineSize = 64;
+
+// std::allocator honours an alignment beyond that of max_align_t only
+// since C++17.
+template<typename T>
+struct CacheLineAllocator {
+  typedef T value_type;
+
+  CacheLineAllocator() = default;
+  template<typename U>
+  CacheLineAllocator(const CacheLineAllocator<U> &) {}  // NOLINT
+
+  T *allocate(size_t n) {
+    void *data = nullptr;
+    MACE_CHECK(Memalign(&data, kCacheLineSize, n * sizeof(T))
+                   == MaceStatus::MACE_SUCCESS, "out of memory");
+    return static_cast<T *>(data);
+  }
+  void deallocate(T *data, size_t) { free(data); }
+};
+
+template<typename T, typename U>
+bool operator==(const CacheLineAllocator<T> &, const CacheLineAllocator<U> &) {
+  return true;
+}
+template<typename T, typename U>
+bool operator!=(const CacheLineAllocator<T> &, const CacheLineAllocator<U> &) {
+  return false;
+}
+
 MaceStatus GetCPUCoresToUse(const std::vector<float> &cpu_max_freqs,
                             const CPUAffinityPolicy policy,
                             int *thread_count_hint,
                             std::vector<size_t> *cores);
 
+// Runs tiles of a loop on a fixed set of threads. Each job is split among
+// the workers in proportion to their measured speed, so that big cores of
+// big.LITTLE SoCs or cores less loaded by other processes get more tiles,
+// and idle workers steal what is left from the others.
+//
+// Jobs of several threads run side by side: a job runs on its calling
+// thread and the workers idle when it starts, which no other job gets
+// until it ends. A job started while all the workers are taken runs on its
+// calling thread alone.
 class ThreadPool {
  public:
   ThreadPool(const int thread_count,
@@ -42,6 +84,16 @@ class ThreadPool {
 
   void Init();
 
+  int thread_count() const { return static_cast<int>(threads_.size()); }
+
+  // Caps the threads running the jobs the calling thread starts on any pool
+  // and sets the tiles each thread gets when the tile sizes are not given,
+  // 0 keeps the defaults. Used by the ops with tuned parameters.
+  static void SetJobLimits(int max_threads, int tiles_per_thread);
+
+  // Calls func(0) ... func(iterations - 1) on the pool. Calls from several
+  // threads share the workers, a nested call from inside func runs its
+  // iterations on the calling thread.
   void Run(const std::function<void(const int64_t)> &func,
            const int64_t iterations);
 
@@ -94,29 +146,80 @@ class ThreadPool {
                  int cost_per_item = -1);
 
  private:
+  // Tiles of a running job owned by one of its threads. The threads claim
+  // chunks from the front of their own range and steal halves from the back
+  // of the others'. Each slot starts a cache line, so its `range` shares
+  // none with the fields written by its neighbours.
+  struct alignas(kCacheLineSize) Slot {
+    // [begin, end) of the unclaimed tiles, packed as end << 32 | begin
+    std::atomic<uint64_t> range;
+    // tiles run and nanoseconds spent on them in the last job
+    int64_t tiles;
+    int64_t busy_ns;
+    // measured speed relative to the average thread, decides its share of
+    // the next job
+    float speed;
+  };
+
+  struct Job {
+    const std::function<void(int64_t)> *func;
+    // the slot of the calling thread, then those of the workers
+    const std::vector<Slot *> *slots;
+    // workers still running tiles
+    std::atomic<int> pending;
+  };
+
+  struct Worker {
+    Slot slot;
+    // the job given to the worker, nullptr while it is idle
+    std::atomic<Job *> job;
+    // index of `slot` in the slots of `job`
+    size_t job_slot;
+    std::vector<size_t> cpu_cores;
+  };
+
   void Destroy();
   void ThreadLoop(size_t tid);
-  void ThreadRun(size_t tid);
-
-  std::atomic<int> event_;
+  Job *WaitForJob(size_t tid);
+  void ThreadRun(Job *job, size_t slot_idx);
+  bool ClaimTiles(Slot *slot, int64_t *begin, int64_t *end);
+  bool StealTiles(Job *job, size_t slot_idx);
+  void UpdateSpeeds(const std::vector<Slot *> &slots);
+  int64_t TileCount(int64_t items, int cost_per_item) const;
+  size_t ActiveThreadCount() const;
+
+  std::atomic<bool> shutdown_;
+  // counts down the workers starting up
   CountDownLatch count_down_latch_;
 
+  // wakes the workers given a job, or all of them to shut down
   std::mutex event_mutex_;
   std::condition_variable event_cond_;
-  std::mutex run_mutex_;
-
-  struct ThreadInfo {
-    std::atomic<int64_t> range_start;
-    std::atomic<int64_t> range_end;
-    std::atomic<int64_t> range_len;
-    uintptr_t func;
-    std::vector<size_t> cpu_cores;
-  };
-  std::vector<ThreadInfo> thread_infos_;
+  // wakes the threads waiting for the workers of their job
+  std::mutex done_mutex_;
+  std::condition_variable done_cond_;
+  // indices of the workers with no job
+  std::mutex idle_mutex_;
+  std::vector<size_t> idle_workers_;
+
+  // workers_[0] and threads_[0] are not used, the calling thread of a job
+  // takes their place with a thread local slot
+  std::vector<Worker, CacheLineAllocator<Worker>> workers_;
   std::vector<std::thread> threads_;
   std::vector<float> cpu_max_freqs_;
+};
 
-  int64_t default_tile_count_;
+// Sets the job limits of the calling thread while it is alive.
+class ScopedJobLimits {
+ public:
+  ScopedJobLimits(int max_threads, int tiles_per_thread) {
+    ThreadPool::SetJobLimits(max_threads, tiles_per_thread);
+  }
+  ~ScopedJobLimits() { ThreadPool::SetJobLimits(0, 0); }
+
+ private:
+  ScopedJobLimits(const ScopedJobLimits &) = delete;
+  ScopedJobLimits &operator=(const ScopedJobLimits &) = delete;
 };
 
 }  // namespace utils
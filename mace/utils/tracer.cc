@@ -0,0 +1,261 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/utils/tracer.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT(build/c++11)
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "mace/utils/logging.h"
+#include "mace/utils/memory.h"
+#include "mace/utils/string_util.h"
+
+namespace mace {
+namespace utils {
+
+namespace {
+
+constexpr size_t kMaxThreadNameLength = 32;
+
+// kept trivial, so that the threads do not need to destroy them on exit
+struct ThreadState {
+  void *buffer;
+  int64_t generation;
+  char name[kMaxThreadNameLength];
+};
+
+thread_local ThreadState thread_state = {nullptr, -1, {0}};
+
+void WriteJsonString(const char *str, std::ostream *out) {
+  *out << '"';
+  for (const char *c = str; *c != '\0'; ++c) {
+    switch (*c) {
+      case '"': *out << "\\\""; break;
+      case '\\': *out << "\\\\"; break;
+      case '\n': *out << "\\n"; break;
+      case '\t': *out << "\\t"; break;
+      default:
+        if (static_cast<unsigned char>(*c) < 0x20) {
+          char escaped[8];
+          snprintf(escaped, sizeof(escaped), "\\u%04x", *c);
+          *out << escaped;
+        } else {
+          *out << *c;
+        }
+    }
+  }
+  *out << '"';
+}
+
+// Chrome trace takes microseconds, the fraction keeps short tiles visible
+void WriteMicros(const int64_t nanos, std::ostream *out) {
+  char micros[32];
+  snprintf(micros, sizeof(micros), "%" PRId64 ".%03d", nanos / 1000,
+           static_cast<int>(nanos % 1000));
+  *out << micros;
+}
+
+}  // namespace
+
+struct Tracer::ThreadBuffer {
+  ThreadBuffer(const int thread_id, const char *thread_name,
+               const size_t capacity)
+      : tid(thread_id), name(thread_name), events(capacity), count(0) {}
+
+  const int tid;
+  const std::string name;
+  std::vector<TraceEvent> events;
+  // spans committed so far, the next one goes to events[count % capacity]
+  std::atomic<uint64_t> count;
+};
+
+struct Tracer::Registry {
+  std::mutex mutex;
+  std::atomic<int64_t> generation;
+  size_t events_per_thread;
+  int64_t start_nanos;
+  // buffers of the threads exited are kept until the next Start
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+std::atomic<bool> Tracer::enabled_(false);
+
+Tracer::Registry *Tracer::GetRegistry() {
+  static Registry *registry = [] {
+    auto *registry = new Registry;
+    registry->generation = 0;
+    registry->events_per_thread = kDefaultTraceEventsPerThread;
+    registry->start_nanos = 0;
+    return registry;
+  }();
+  return registry;
+}
+
+int64_t Tracer::NowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Tracer::Start(const size_t events_per_thread) {
+  Registry *registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry->mutex);
+  registry->buffers.clear();
+  registry->events_per_thread = std::max<size_t>(1, events_per_thread);
+  registry->start_nanos = NowNanos();
+  // makes every thread take a new buffer
+  registry->generation.fetch_add(1, std::memory_order_release);
+  enabled_.store(true, std::memory_order_release);
+  VLOG(1) << "Start tracing, keep " << registry->events_per_thread
+          << " spans per thread";
+}
+
+void Tracer::Stop() {
+  enabled_.store(false, std::memory_order_release);
+}
+
+void Tracer::SetThreadName(const std::string &name) {
+  strncpy(thread_state.name, name.c_str(), kMaxThreadNameLength - 1);
+  thread_state.name[kMaxThreadNameLength - 1] = '\0';
+}
+
+Tracer::ThreadBuffer *Tracer::CurrentThreadBuffer() {
+  Registry *registry = GetRegistry();
+  if (thread_state.generation !=
+      registry->generation.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(registry->mutex);
+    const int tid = static_cast<int>(registry->buffers.size());
+    const std::string name = thread_state.name[0] != '\0' ?
+        std::string(thread_state.name) : MakeString("thread ", tid);
+    registry->buffers.emplace_back(make_unique<ThreadBuffer>(
+        tid, name.c_str(), registry->events_per_thread));
+    thread_state.buffer = registry->buffers.back().get();
+    thread_state.generation = registry->generation;
+  }
+  return static_cast<ThreadBuffer *>(thread_state.buffer);
+}
+
+TraceEvent *Tracer::NextEvent() {
+  ThreadBuffer *buffer = CurrentThreadBuffer();
+  const uint64_t count = buffer->count.load(std::memory_order_relaxed);
+  return &buffer->events[count % buffer->events.size()];
+}
+
+void Tracer::CommitEvent() {
+  ThreadBuffer *buffer = CurrentThreadBuffer();
+  buffer->count.fetch_add(1, std::memory_order_release);
+}
+
+MaceStatus Tracer::WriteChromeTrace(const std::string &path) {
+  Registry *registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry->mutex);
+  std::ofstream out(path);
+  if (!out.is_open()) {
+    LOG(ERROR) << "Failed to open trace file " << path;
+    return MaceStatus::MACE_RUNTIME_ERROR;
+  }
+
+  uint64_t written = 0;
+  uint64_t dropped = 0;
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  for (auto &buffer : registry->buffers) {
+    if (!first) {
+      out << ",";
+    }
+    first = false;
+    out << "\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":"
+        << buffer->tid << ",\"args\":{\"name\":";
+    WriteJsonString(buffer->name.c_str(), &out);
+    out << "}}";
+
+    const uint64_t count = buffer->count.load(std::memory_order_acquire);
+    const uint64_t capacity = buffer->events.size();
+    const uint64_t begin = count > capacity ? count - capacity : 0;
+    dropped += begin;
+    for (uint64_t i = begin; i < count; ++i) {
+      const TraceEvent &event = buffer->events[i % capacity];
+      out << ",\n{\"ph\":\"X\",\"cat\":";
+      WriteJsonString(event.category, &out);
+      out << ",\"name\":";
+      WriteJsonString(event.name.c_str(), &out);
+      out << ",\"pid\":0,\"tid\":" << buffer->tid << ",\"ts\":";
+      WriteMicros(event.start_nanos - registry->start_nanos, &out);
+      out << ",\"dur\":";
+      WriteMicros(event.duration_nanos, &out);
+      out << ",\"args\":{";
+      for (int a = 0; a < event.arg_count; ++a) {
+        if (a > 0) {
+          out << ",";
+        }
+        WriteJsonString(event.arg_names[a], &out);
+        out << ":" << event.arg_values[a];
+      }
+      if (event.text_arg_name != nullptr) {
+        if (event.arg_count > 0) {
+          out << ",";
+        }
+        WriteJsonString(event.text_arg_name, &out);
+        out << ":";
+        WriteJsonString(event.text_arg.c_str(), &out);
+      }
+      out << "}}";
+    }
+    written += count - begin;
+  }
+  out << "\n]}\n";
+  out.close();
+  if (out.fail()) {
+    LOG(ERROR) << "Failed to write trace file " << path;
+    return MaceStatus::MACE_RUNTIME_ERROR;
+  }
+
+  if (dropped > 0) {
+    LOG(WARNING) << "Overwrote the " << dropped << " oldest spans, trace more"
+                 << " spans per thread to keep them";
+  }
+  VLOG(1) << "Write " << written << " spans of " << registry->buffers.size()
+          << " threads to " << path;
+  return MaceStatus::MACE_SUCCESS;
+}
+
+void TraceSpan::Finish() {
+  const int64_t end_nanos = Tracer::NowNanos();
+  TraceEvent *event = Tracer::NextEvent();
+  event->category = category_;
+  event->name.assign(name_);
+  event->start_nanos = start_nanos_;
+  event->duration_nanos = end_nanos - start_nanos_;
+  event->arg_count = arg_count_;
+  for (int i = 0; i < arg_count_; ++i) {
+    event->arg_names[i] = arg_names_[i];
+    event->arg_values[i] = arg_values_[i];
+  }
+  event->text_arg_name = text_arg_name_;
+  if (text_arg_ != nullptr) {
+    event->text_arg.assign(text_arg_);
+  } else {
+    event->text_arg.clear();
+  }
+  Tracer::CommitEvent();
+}
+
+}  // namespace utils
+}  // namespace mace
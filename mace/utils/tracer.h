@@ -0,0 +1,131 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_UTILS_TRACER_H_
+#define MACE_UTILS_TRACER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "mace/public/mace.h"
+#include "mace/utils/macros.h"
+
+namespace mace {
+namespace utils {
+
+constexpr int kMaxTraceArgs = 2;
+constexpr size_t kDefaultTraceEventsPerThread = 1 << 16;
+
+struct TraceEvent {
+  const char *category;
+  std::string name;
+  int64_t start_nanos;
+  int64_t duration_nanos;
+  int arg_count;
+  const char *arg_names[kMaxTraceArgs];
+  int64_t arg_values[kMaxTraceArgs];
+  // empty if the span has no text argument
+  const char *text_arg_name;
+  std::string text_arg;
+};
+
+// Records a timeline of spans in all threads of the process. Each thread
+// writes its spans into its own ring buffer without any lock, so the latest
+// `events_per_thread` spans of every thread are kept. While tracing is
+// stopped, a span costs a load of a flag and a branch.
+//
+// Start, Stop and WriteChromeTrace must not be called while nets are running.
+class Tracer {
+ public:
+  static bool Enabled() {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  static void Start(size_t events_per_thread = kDefaultTraceEventsPerThread);
+  static void Stop();
+  // Writes the recorded spans in the Chrome trace JSON format, which
+  // chrome://tracing and Perfetto open.
+  static MaceStatus WriteChromeTrace(const std::string &path);
+
+  // Names the timeline of the calling thread in the trace.
+  static void SetThreadName(const std::string &name);
+
+  // Returns the slot of the next span of the calling thread, which is added
+  // to the trace by CommitEvent. The strings of the slot keep their storage,
+  // so that the spans do not allocate memory once the ring buffer is full.
+  static TraceEvent *NextEvent();
+  static void CommitEvent();
+
+  static int64_t NowNanos();
+
+ private:
+  struct ThreadBuffer;
+  struct Registry;
+
+  static Registry *GetRegistry();
+  static ThreadBuffer *CurrentThreadBuffer();
+
+  static std::atomic<bool> enabled_;
+};
+
+// Adds a span from its construction to its destruction to the trace, if
+// tracing was enabled when it was constructed. The strings must outlive it.
+class TraceSpan {
+ public:
+  TraceSpan(const char *category, const char *name,
+            const char *text_arg_name = nullptr,
+            const char *text_arg = nullptr)
+      : start_nanos_(Tracer::Enabled() ? Tracer::NowNanos() : -1),
+        category_(category),
+        name_(name),
+        arg_count_(0),
+        text_arg_name_(text_arg_name),
+        text_arg_(text_arg) {}
+
+  ~TraceSpan() {
+    if (start_nanos_ >= 0) {
+      Finish();
+    }
+  }
+
+  bool active() const { return start_nanos_ >= 0; }
+
+  void AddArg(const char *name, int64_t value) {
+    if (arg_count_ < kMaxTraceArgs) {
+      arg_names_[arg_count_] = name;
+      arg_values_[arg_count_] = value;
+      ++arg_count_;
+    }
+  }
+
+ private:
+  void Finish();
+
+  const int64_t start_nanos_;
+  const char *category_;
+  const char *name_;
+  int arg_count_;
+  const char *arg_names_[kMaxTraceArgs];
+  int64_t arg_values_[kMaxTraceArgs];
+  const char *text_arg_name_;
+  const char *text_arg_;
+
+  MACE_DISABLE_COPY_AND_ASSIGN(TraceSpan);
+};
+
+}  // namespace utils
+}  // namespace mace
+
+#endif  // MACE_UTILS_TRACER_H_
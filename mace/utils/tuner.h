@@ -38,6 +38,8 @@
 namespace mace {
 
 constexpr const char *kOpenClWindowSize = "MACE_OPENCL_QUEUE_WINDOW_SIZE";
+constexpr const char *kRunParameterPathEnv = "MACE_RUN_PARAMETER_PATH";
+constexpr const char *kCpuRunParameterPathEnv = "MACE_CPU_RUN_PARAMETER_PATH";
 
 inline bool GetTuningFromEnv() {
   std::string tuning;
@@ -58,13 +60,16 @@ inline unsigned int GetOpenclQueueWindowSizeFromEnv() {
 template <typename param_type>
 class Tuner {
  public:
+  // The tuned parameters are written to the file named by the environment
+  // variable `run_parameter_path_env` when the tuner is destroyed.
   explicit Tuner(const std::string tuned_param_file_path = "",
       const unsigned char *param_byte_stream = nullptr,
-      const size_t param_byte_stream_size = 0) :
+      const size_t param_byte_stream_size = 0,
+      const char *run_parameter_path_env = kRunParameterPathEnv) :
       tuned_param_file_path_(tuned_param_file_path) {
     MACE_CHECK(DataTypeToEnum<param_type>::value == DT_UINT32,
                "Only support save uint32_t tuning parameter");
-    GetEnv("MACE_RUN_PARAMETER_PATH", &path_);
+    GetEnv(run_parameter_path_env, &path_);
     is_tuning_ = GetTuningFromEnv();
     if (is_tuning_) {
       unsigned int wnd_size = GetOpenclQueueWindowSizeFromEnv();
@@ -123,6 +128,13 @@ class Tuner {
     }
   }
 
+  // Returns the tuned parameters of `param_key`, or nullptr if it is not
+  // tuned, for the callers picking their parameters without TuneOrRun.
+  const std::vector<param_type> *Find(const std::string &param_key) const {
+    auto iter = param_table_.find(MACE_OBFUSCATE_SYMBOL(param_key));
+    return iter == param_table_.end() ? nullptr : &iter->second;
+  }
+
   unsigned int GetOpenclQueueWindowSize() {
     unsigned int window_size = 0;
     if (!IsTuning()
@@ -12,9 +12,13 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cmath>
+#include <random>
 #include <string>
+#include <vector>
 
 #include "mace/benchmark_utils/test_benchmark.h"
+#include "mace/ops/delegator/vector_math.h"
 #include "mace/ops/ops_test_util.h"
 
 namespace mace {
@@ -444,6 +448,74 @@ MACE_BM_SIGMOID(1, 3, 512, 512);
 MACE_BM_SIGMOID(1, 32, 112, 112);
 MACE_BM_SIGMOID(1, 64, 256, 256);
 
+// The polynomial approximations of delegator::VectorMath against the libm
+// calls they replace, on one thread.
+namespace {
+enum VectorMathFunc { EXP, LOG, TANH, SIGMOID, ERF };
+
+void VectorMathBenchmark(int iters, VectorMathFunc func, bool use_libm,
+                         int size) {
+  mace::testing::StopTiming();
+
+  OpsTestNet net;
+  std::unique_ptr<delegator::VectorMath> vector_math =
+      delegator::VectorMath::Create(
+          net.ws(), MACE_DELEGATOR_KEY(VectorMath, RuntimeType::RT_CPU,
+                                       float, kCpuImplType),
+          DelegatorParam());
+  std::vector<float> input(size);
+  std::vector<float> output(size);
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<float> dist(-8.f, 8.f);
+  for (auto &v : input) {
+    v = func == LOG ? std::abs(dist(gen)) : dist(gen);
+  }
+  const float *in = input.data();
+  float *out = output.data();
+
+  mace::testing::StartTiming();
+  while (iters--) {
+    if (use_libm) {
+      for (int i = 0; i < size; ++i) {
+        switch (func) {
+          case EXP: out[i] = std::exp(in[i]); break;
+          case LOG: out[i] = std::log(in[i]); break;
+          case TANH: out[i] = std::tanh(in[i]); break;
+          case SIGMOID: out[i] = 1 / (1 + std::exp(-in[i])); break;
+          case ERF: out[i] = std::erf(in[i]); break;
+        }
+      }
+    } else {
+      switch (func) {
+        case EXP: vector_math->Exp(in, size, out); break;
+        case LOG: vector_math->Log(in, size, out); break;
+        case TANH: vector_math->Tanh(in, size, out); break;
+        case SIGMOID: vector_math->Sigmoid(in, size, out); break;
+        case ERF: vector_math->Erf(in, size, out); break;
+      }
+    }
+  }
+}
+}  // namespace
+
+#define MACE_BM_VECTOR_MATH_MACRO(FUNC, IMPL, USE_LIBM, SIZE)              \
+  static void MACE_BM_VECTOR_MATH_##FUNC##_##IMPL##_##SIZE(int iters) {    \
+    const int64_t tot = static_cast<int64_t>(iters) * SIZE;                \
+    mace::testing::BytesProcessed(tot *(sizeof(float)));                   \
+    VectorMathBenchmark(iters, FUNC, USE_LIBM, SIZE);                      \
+  }                                                                        \
+  MACE_BENCHMARK(MACE_BM_VECTOR_MATH_##FUNC##_##IMPL##_##SIZE)
+
+#define MACE_BM_VECTOR_MATH(FUNC, SIZE)                  \
+  MACE_BM_VECTOR_MATH_MACRO(FUNC, LIBM, true, SIZE);     \
+  MACE_BM_VECTOR_MATH_MACRO(FUNC, POLY, false, SIZE)
+
+MACE_BM_VECTOR_MATH(EXP, 65536);
+MACE_BM_VECTOR_MATH(LOG, 65536);
+MACE_BM_VECTOR_MATH(TANH, 65536);
+MACE_BM_VECTOR_MATH(SIGMOID, 65536);
+MACE_BM_VECTOR_MATH(ERF, 65536);
+
 }  // namespace test
 }  // namespace ops
 }  // namespace mace
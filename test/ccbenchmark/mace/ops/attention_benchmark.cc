@@ -0,0 +1,82 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "mace/benchmark_utils/test_benchmark.h"
+#include "mace/ops/ops_test_util.h"
+
+namespace mace {
+namespace ops {
+namespace test {
+
+namespace {
+template <RuntimeType D, typename T>
+void AttentionBenchmark(int iters, int batch, int heads, int q_len,
+                        int k_len, int depth, bool causal) {
+  mace::testing::StopTiming();
+
+  OpsTestNet net;
+  // Add input data
+  net.AddRandomInput<D, float>("Query", {batch, heads, q_len, depth});
+  net.AddRandomInput<D, float>("Key", {batch, heads, k_len, depth});
+  net.AddRandomInput<D, float>("Value", {batch, heads, k_len, depth});
+
+  OpDefBuilder("Attention", "AttentionBM")
+      .Input("Query")
+      .Input("Key")
+      .Input("Value")
+      .AddIntArg("causal", causal)
+      .AddIntArg("transpose_k", 1)
+      .Output("Output")
+      .Finalize(net.NewOperatorDef());
+
+  // Warm-up
+  net.Setup(D);
+  for (int i = 0; i < 2; ++i) {
+    net.Run();
+  }
+  net.Sync();
+
+  mace::testing::StartTiming();
+  while (iters--) {
+    net.Run();
+  }
+  net.Sync();
+}
+}  // namespace
+
+#define MACE_BM_ATTENTION_MACRO(N, H, Q, K, D, CAUSAL, DEVICE)             \
+  static void                                                              \
+      MACE_BM_ATTENTION_##N##_##H##_##Q##_##K##_##D##_##CAUSAL##_##DEVICE( \
+          int iters) {                                                     \
+    const int64_t macs =                                                   \
+        static_cast<int64_t>(iters) * N * H * Q * K * D * 2;               \
+    mace::testing::MacsProcessed(macs);                                    \
+    AttentionBenchmark<DEVICE, float>(iters, N, H, Q, K, D, CAUSAL);       \
+  }                                                                        \
+  MACE_BENCHMARK(                                                          \
+      MACE_BM_ATTENTION_##N##_##H##_##Q##_##K##_##D##_##CAUSAL##_##DEVICE)
+
+#define MACE_BM_ATTENTION(N, H, Q, K, D, CAUSAL) \
+  MACE_BM_ATTENTION_MACRO(N, H, Q, K, D, CAUSAL, RT_CPU);
+
+MACE_BM_ATTENTION(1, 8, 128, 128, 64, 0);
+MACE_BM_ATTENTION(1, 8, 512, 512, 64, 0);
+MACE_BM_ATTENTION(1, 8, 512, 512, 64, 1);
+MACE_BM_ATTENTION(1, 8, 1, 512, 64, 1);
+
+}  // namespace test
+}  // namespace ops
+}  // namespace mace
@@ -17,7 +17,9 @@
 #include "mace/utils/statistics.h"
 #include "mace/benchmark_utils/test_benchmark.h"
 #include "mace/ops/common/conv_pool_2d_util.h"
+#include "mace/ops/delegator/conv_2d.h"
 #include "mace/ops/ops_test_util.h"
+#include "mace/ops/testing/test_utils.h"
 
 namespace mace {
 namespace ops {
@@ -147,6 +149,55 @@ void Conv2d<RT_CPU, uint8_t>(int iters,
 }
 #endif
 
+// Runs the conv delegator directly, so that the same shape can be compared
+// across implementations. Tags without a registered kernel fall back to the
+// default delegator of the implementation.
+void Conv2dDelegator(int iters,
+                     ImplType impl_type,
+                     const char *tag,
+                     int batch,
+                     int channels,
+                     int height,
+                     int width,
+                     int kernel_h,
+                     int kernel_w,
+                     int stride,
+                     int dilation,
+                     Padding padding,
+                     int output_channels) {
+  mace::testing::StopTiming();
+  auto *cpu_runtime = OpTestContext::Get()->GetRuntime(RuntimeType::RT_CPU);
+  Tensor input(cpu_runtime, DataType::DT_FLOAT);
+  Tensor filter(cpu_runtime, DataType::DT_FLOAT, {}, true);
+  Tensor output(cpu_runtime, DataType::DT_FLOAT);
+  input.Resize({batch, channels, height, width});
+  filter.Resize({output_channels, channels, kernel_h, kernel_w});
+  GenerateRandomRealTypeData<float>(input.shape(),
+                                    input.mutable_data<float>());
+  GenerateRandomRealTypeData<float>(filter.shape(),
+                                    filter.mutable_data<float>());
+
+  const std::vector<int> strides = {stride, stride};
+  const std::vector<int> dilations = {dilation, dilation};
+  const std::vector<int> paddings;
+  OpsTestNet net;
+  OpContext context(net.ws(), cpu_runtime);
+  std::unique_ptr<delegator::Conv2d> conv2d = delegator::Conv2d::Create(
+      context.workspace(),
+      DelegatorInfo("Conv2d", DataType::DT_FLOAT, RuntimeType::RT_CPU,
+                    impl_type, tag),
+      delegator::Conv2dParam(strides, dilations, paddings, padding));
+
+  // Warm-up
+  for (int i = 0; i < 2; ++i) {
+    conv2d->Compute(&context, &input, &filter, &output);
+  }
+  mace::testing::StartTiming();
+  while (iters--) {
+    conv2d->Compute(&context, &input, &filter, &output);
+  }
+}
+
 }  // namespace
 
 // In common network, there are usually more than 1 layers, this is used to
@@ -211,6 +262,70 @@ void Conv2d<RT_CPU, uint8_t>(int iters,
 
 MACE_BM_CONV_2D(16, 128, 32, 32, 3, 3, 1, 1, SAME, 128);
 
+#define MACE_BM_CONV_2D_DELEGATOR_MACRO(                                      \
+    N, C, H, W, KH, KW, STRIDE, DILATION, P, OC, TAG, IMPL)                   \
+  static void                                                                 \
+      MACE_BM_CONV_2D_DELEGATOR_##N##_##C##_##H##_##W##_K##KH##x##KW##S##\
+        STRIDE##D##DILATION##_##P##_##OC##_##TAG##_##IMPL(int iters) {        \
+    int64_t pad_h = 0, pad_w = 0;                                             \
+    if (P == SAME) {                                                          \
+      pad_h = KH / 2;                                                         \
+      pad_w = KW / 2;                                                         \
+    }                                                                         \
+    int64_t oh =                                                              \
+        (H + 2 * pad_h - KH - (KH - 1) * (DILATION - 1)) / STRIDE + 1;        \
+    int64_t ow =                                                              \
+        (W + 2 * pad_w - KW - (KW - 1) * (DILATION - 1)) / STRIDE + 1;        \
+    const int64_t macs =                                                      \
+        static_cast<int64_t>(iters) * mace::benchmark::StatMACs(              \
+            "Conv2D", {OC, C, KH, KW}, {N, oh, ow, OC});                      \
+    mace::testing::MacsProcessed(macs);                                       \
+    mace::testing::BytesProcessed(                                            \
+        static_cast<int64_t>(iters) * N * C * H * W * sizeof(float));         \
+    Conv2dDelegator(iters, ImplType::IMPL, #TAG, N, C, H, W, KH, KW, STRIDE,  \
+                    DILATION, mace::Padding::P, OC);                          \
+  }                                                                           \
+  MACE_BENCHMARK(                                                             \
+      MACE_BM_CONV_2D_DELEGATOR_##N##_##C##_##H##_##W##_K##KH##x##KW##S##\
+        STRIDE##D##DILATION##_##P##_##OC##_##TAG##_##IMPL)
+
+#ifdef MACE_ENABLE_X86
+#define MACE_BM_CONV_2D_X86_MACRO(N, C, H, W, KH, KW, S, D, P, OC, TAG)       \
+  MACE_BM_CONV_2D_DELEGATOR_MACRO(N, C, H, W, KH, KW, S, D, P, OC, TAG, X86)
+#else
+#define MACE_BM_CONV_2D_X86_MACRO(N, C, H, W, KH, KW, S, D, P, OC, TAG)
+#endif  // MACE_ENABLE_X86
+
+// x86 delegators against the reference implementation
+#define MACE_BM_CONV_2D_DELEGATOR(N, C, H, W, KH, KW, S, D, P, OC, TAG)       \
+  MACE_BM_CONV_2D_DELEGATOR_MACRO(N, C, H, W, KH, KW, S, D, P, OC, TAG, REF); \
+  MACE_BM_CONV_2D_X86_MACRO(N, C, H, W, KH, KW, S, D, P, OC, TAG)
+
+// ResNet-50
+MACE_BM_CONV_2D_DELEGATOR(1, 3, 224, 224, 7, 7, 2, 1, SAME, 64, K7x7S2);
+MACE_BM_CONV_2D_DELEGATOR(1, 64, 56, 56, 1, 1, 1, 1, VALID, 256, K1x1);
+MACE_BM_CONV_2D_DELEGATOR(1, 64, 56, 56, 3, 3, 1, 1, SAME, 64, K3x3Winograd);
+MACE_BM_CONV_2D_DELEGATOR(1, 64, 56, 56, 3, 3, 1, 1, SAME, 64, K3x3S1);
+MACE_BM_CONV_2D_DELEGATOR(1, 128, 28, 28, 3, 3, 1, 1, SAME, 128,
+                          K3x3Winograd);
+MACE_BM_CONV_2D_DELEGATOR(1, 256, 14, 14, 3, 3, 1, 1, SAME, 256,
+                          K3x3Winograd);
+MACE_BM_CONV_2D_DELEGATOR(1, 1024, 14, 14, 1, 1, 1, 1, VALID, 256, K1x1);
+MACE_BM_CONV_2D_DELEGATOR(1, 512, 7, 7, 3, 3, 1, 1, SAME, 512, K3x3Winograd);
+
+// MobileNet
+MACE_BM_CONV_2D_DELEGATOR(1, 3, 224, 224, 3, 3, 2, 1, SAME, 32, K3x3S2);
+MACE_BM_CONV_2D_DELEGATOR(1, 128, 56, 56, 1, 1, 1, 1, VALID, 128, K1x1);
+MACE_BM_CONV_2D_DELEGATOR(1, 1024, 7, 7, 1, 1, 1, 1, VALID, 1024, K1x1);
+
+// Other kernel sizes and the im2col general path
+MACE_BM_CONV_2D_DELEGATOR(1, 32, 64, 64, 5, 5, 1, 1, SAME, 32, K5x5S1);
+MACE_BM_CONV_2D_DELEGATOR(1, 192, 17, 17, 1, 7, 1, 1, SAME, 192, K1x7S1);
+MACE_BM_CONV_2D_DELEGATOR(1, 192, 17, 17, 7, 1, 1, 1, SAME, 192, K7x1S1);
+MACE_BM_CONV_2D_DELEGATOR(1, 32, 256, 256, 1, 15, 1, 1, SAME, 2, K1x15S1);
+MACE_BM_CONV_2D_DELEGATOR(1, 32, 256, 256, 15, 1, 1, 1, SAME, 2, K15x1S1);
+MACE_BM_CONV_2D_DELEGATOR(1, 32, 128, 128, 3, 3, 1, 2, SAME, 32, General);
+
 // Filter sizes and data alignments
 /* MACE_BM_CONV_2D(1, 64, 32, 32, 1, 1, 1, 1, VALID, 128); */
 /* MACE_BM_CONV_2D(1, 64, 33, 31, 1, 1, 1, 1, VALID, 128); */
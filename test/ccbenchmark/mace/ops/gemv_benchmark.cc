@@ -0,0 +1,84 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/benchmark_utils/test_benchmark.h"
+#include "mace/ops/ops_test_util.h"
+
+namespace mace {
+namespace ops {
+namespace test {
+
+namespace {
+// The gemv of a float FullyConnected whose weight is stored as WT, the fp16
+// and uint8 weights are compressed ones converted by the gemv as it reads
+// them.
+template <typename WT>
+void GemvBenchmark(int iters, int batch, int height, int width) {
+  mace::testing::StopTiming();
+
+  OpsTestNet net;
+  net.AddRandomInput<RuntimeType::RT_CPU, float>("Input",
+                                                 {batch, width, 1, 1});
+  net.AddRandomInput<RuntimeType::RT_CPU, WT>("Weight",
+                                              {height, width, 1, 1}, true);
+  if (DataTypeToEnum<WT>::value == DT_UINT8) {
+    net.GetTensor("Weight")->SetScale(0.01f);
+    net.GetTensor("Weight")->SetZeroPoint(128);
+  }
+  net.AddRandomInput<RuntimeType::RT_CPU, float>("Bias", {height}, true);
+
+  OpDefBuilder("FullyConnected", "GemvBM")
+      .Input("Input")
+      .Input("Weight")
+      .Input("Bias")
+      .Output("Output")
+      .Finalize(net.NewOperatorDef());
+
+  // Warm-up
+  net.Setup(RuntimeType::RT_CPU);
+  for (int i = 0; i < 2; ++i) {
+    net.Run();
+  }
+
+  mace::testing::StartTiming();
+  while (iters--) {
+    net.Run();
+  }
+}
+}  // namespace
+
+#define MACE_BM_GEMV_MACRO(N, H, W, WT)                                      \
+  static void MACE_BM_GEMV_##N##_##H##_##W##_##WT(int iters) {               \
+    const int64_t macs = static_cast<int64_t>(iters) * N * H * W;            \
+    const int64_t tot = static_cast<int64_t>(iters) *                        \
+        (H * W * sizeof(WT) + (N * W + N * H + H) * sizeof(float));          \
+    mace::testing::MacsProcessed(macs);                                      \
+    mace::testing::BytesProcessed(tot);                                      \
+    GemvBenchmark<WT>(iters, N, H, W);                                       \
+  }                                                                          \
+  MACE_BENCHMARK(MACE_BM_GEMV_##N##_##H##_##W##_##WT)
+
+#define MACE_BM_GEMV(N, H, W)             \
+  MACE_BM_GEMV_MACRO(N, H, W, float);     \
+  MACE_BM_GEMV_MACRO(N, H, W, half);      \
+  MACE_BM_GEMV_MACRO(N, H, W, uint8_t)
+
+MACE_BM_GEMV(1, 1024, 1024);
+MACE_BM_GEMV(1, 2048, 2048);
+MACE_BM_GEMV(4, 2048, 2048);
+MACE_BM_GEMV(16, 1000, 2048);
+
+}  // namespace test
+}  // namespace ops
+}  // namespace mace
@@ -0,0 +1,135 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "mace/benchmark_utils/test_benchmark.h"
+#include "mace/ops/common/eltwise_type.h"
+#include "mace/ops/common/reduce_type.h"
+#include "mace/ops/ops_test_util.h"
+
+namespace mace {
+namespace ops {
+namespace test {
+
+namespace {
+void AddReduceMean(const std::string &input, const std::string &output,
+                   OpsTestNet *net) {
+  OpDefBuilder("Reduce", output)
+      .Input(input)
+      .AddIntsArg("axis", {-1})
+      .AddIntArg("keepdims", 1)
+      .AddIntArg("reduce_type", static_cast<int>(ReduceType::MEAN))
+      .Output(output)
+      .Finalize(net->AddNewOperatorDef());
+}
+
+void AddEltwise(const std::string &input0, const std::string &input1,
+                EltwiseType type, const std::string &output,
+                OpsTestNet *net) {
+  OpDefBuilder("Eltwise", output)
+      .Input(input0)
+      .Input(input1)
+      .AddIntArg("type", static_cast<int>(type))
+      .Output(output)
+      .Finalize(net->AddNewOperatorDef());
+}
+
+void AddScalarEltwise(const std::string &input, EltwiseType type,
+                      float scalar, const std::string &output,
+                      OpsTestNet *net) {
+  OpDefBuilder("Eltwise", output)
+      .Input(input)
+      .AddIntArg("type", static_cast<int>(type))
+      .AddFloatArg("scalar_input", scalar)
+      .AddIntArg("scalar_input_index", 1)
+      .Output(output)
+      .Finalize(net->AddNewOperatorDef());
+}
+
+// LayerNorm as the converter sees it before the ops are folded
+void AddDecomposedLayerNorm(OpsTestNet *net) {
+  AddReduceMean("Input", "Mean", net);
+  AddEltwise("Input", "Mean", EltwiseType::SUB, "Centered", net);
+  AddScalarEltwise("Centered", EltwiseType::POW, 2.f, "Square", net);
+  AddReduceMean("Square", "Variance", net);
+  AddScalarEltwise("Variance", EltwiseType::SUM, 1e-5f, "VarianceEps", net);
+  AddScalarEltwise("VarianceEps", EltwiseType::POW, 0.5f, "Std", net);
+  AddEltwise("Centered", "Std", EltwiseType::DIV, "Normalized", net);
+  AddEltwise("Normalized", "Gamma", EltwiseType::PROD, "Scaled", net);
+  AddEltwise("Scaled", "Beta", EltwiseType::SUM, "Output", net);
+}
+
+template <RuntimeType D, typename T>
+void LayerNormBenchmark(int iters, int batch, int length, int channels,
+                        bool fused) {
+  mace::testing::StopTiming();
+
+  OpsTestNet net;
+  // Add input data
+  net.AddRandomInput<D, T>("Input", {batch, length, channels});
+  net.AddRandomInput<D, T>("Gamma", {channels}, true);
+  net.AddRandomInput<D, T>("Beta", {channels}, true);
+
+  if (fused) {
+    OpDefBuilder("LayerNorm", "LayerNormBM")
+        .Input("Input")
+        .Input("Gamma")
+        .Input("Beta")
+        .AddFloatArg("epsilon", 1e-5)
+        .AddIntArg("T", static_cast<int>(DataTypeToEnum<T>::value))
+        .Output("Output")
+        .Finalize(net.NewOperatorDef());
+  } else {
+    AddDecomposedLayerNorm(&net);
+  }
+
+  // Warm-up
+  net.Setup(D);
+  for (int i = 0; i < 2; ++i) {
+    net.Run();
+  }
+  net.Sync();
+
+  mace::testing::StartTiming();
+  while (iters--) {
+    net.Run();
+  }
+  net.Sync();
+}
+}  // namespace
+
+#define MACE_BM_LAYER_NORM_MACRO(N, L, C, TYPE, FUSED, DEVICE)             \
+  static void                                                              \
+      MACE_BM_LAYER_NORM_##N##_##L##_##C##_##TYPE##_##FUSED##_##DEVICE(    \
+          int iters) {                                                     \
+    const int64_t tot = static_cast<int64_t>(iters) * N * L * C;           \
+    mace::testing::BytesProcessed(tot *(sizeof(TYPE)));                    \
+    LayerNormBenchmark<DEVICE, TYPE>(iters, N, L, C, FUSED);               \
+  }                                                                        \
+  MACE_BENCHMARK(                                                          \
+      MACE_BM_LAYER_NORM_##N##_##L##_##C##_##TYPE##_##FUSED##_##DEVICE)
+
+#define MACE_BM_LAYER_NORM(N, L, C)                         \
+  MACE_BM_LAYER_NORM_MACRO(N, L, C, float, 1, RT_CPU);      \
+  MACE_BM_LAYER_NORM_MACRO(N, L, C, float, 0, RT_CPU)
+
+MACE_BM_LAYER_NORM(1, 128, 768);
+MACE_BM_LAYER_NORM(1, 512, 768);
+MACE_BM_LAYER_NORM(8, 128, 1024);
+MACE_BM_LAYER_NORM(1, 64, 4096);
+
+}  // namespace test
+}  // namespace ops
+}  // namespace mace
@@ -21,6 +21,7 @@
 
 #include "public/gemmlowp.h"
 #include "mace/benchmark_utils/test_benchmark.h"
+#include "mace/ops/delegator/gemm.h"
 #include "mace/ops/ops_test_util.h"
 #include "mace/runtimes/cpu/cpu_runtime.h"
 #include "mace/utils/statistics.h"
@@ -108,6 +109,45 @@ void MatmulBenchmark_Eigen(int iters, int m, int k, int n) {
   }
 }
 
+void MatmulBenchmark_Delegator(int iters, int m, int k, int n,
+                               ImplType impl_type) {
+  mace::testing::StopTiming();
+  auto *cpu_runtime = OpTestContext::Get()->GetRuntime(RuntimeType::RT_CPU);
+  Tensor lhs(cpu_runtime, DataType::DT_FLOAT);
+  Tensor rhs(cpu_runtime, DataType::DT_FLOAT);
+  Tensor output(cpu_runtime, DataType::DT_FLOAT);
+  lhs.Resize({1, m, k});
+  rhs.Resize({1, k, n});
+  output.Resize({1, m, n});
+  GenerateRandomRealTypeData<float>(lhs.shape(), lhs.mutable_data<float>());
+  GenerateRandomRealTypeData<float>(rhs.shape(), rhs.mutable_data<float>());
+
+  OpsTestNet net;
+  OpContext context(net.ws(), cpu_runtime);
+  std::unique_ptr<delegator::Gemm> gemm = delegator::Gemm::Create(
+      context.workspace(),
+      MACE_DELEGATOR_KEY(Gemm, RuntimeType::RT_CPU, float, impl_type),
+      delegator::GemmParam());
+  // warm up
+  gemm->Compute(&context, &lhs, &rhs, 1, m, n, k,
+                RowMajor, RowMajor, RowMajor, false, false, &output);
+  mace::testing::StartTiming();
+  while (iters--) {
+    gemm->Compute(&context, &lhs, &rhs, 1, m, n, k,
+                  RowMajor, RowMajor, RowMajor, false, false, &output);
+  }
+}
+
+void MatmulBenchmark_ref(int iters, int m, int k, int n) {
+  MatmulBenchmark_Delegator(iters, m, k, n, ImplType::REF);
+}
+
+#ifdef MACE_ENABLE_X86
+void MatmulBenchmark_x86(int iters, int m, int k, int n) {
+  MatmulBenchmark_Delegator(iters, m, k, n, ImplType::X86);
+}
+#endif  // MACE_ENABLE_X86
+
 #ifdef MACE_ENABLE_QUANTIZE
 void MatmulBenchmark_gemmlowp_uint8(int iters, int rows, int depth, int cols) {
   mace::testing::StopTiming();
@@ -186,6 +226,50 @@ void MatmulBenchmark_gemmlowp_int32(int iters, int rows, int depth, int cols) {
         -128, output_pipeline);
   }
 }
+
+// The quantized gemm delegator on the same shapes as gemmlowp above
+template<typename OUTPUT_TYPE>
+void MatmulBenchmark_q8(int iters, int rows, int depth, int cols) {
+  mace::testing::StopTiming();
+  auto *cpu_runtime = OpTestContext::Get()->GetRuntime(RuntimeType::RT_CPU);
+  Tensor lhs(cpu_runtime, DataType::DT_UINT8);
+  Tensor rhs(cpu_runtime, DataType::DT_UINT8);
+  Tensor output(cpu_runtime, DataTypeToEnum<OUTPUT_TYPE>::value);
+  lhs.Resize({rows, depth});
+  rhs.Resize({depth, cols});
+  output.Resize({rows, cols});
+  std::fill_n(lhs.mutable_data<uint8_t>(), lhs.size(), 0);
+  std::fill_n(rhs.mutable_data<uint8_t>(), rhs.size(), 0);
+  lhs.SetScale(0.1f);
+  lhs.SetZeroPoint(128);
+  rhs.SetScale(0.1f);
+  rhs.SetZeroPoint(128);
+  output.SetScale(1.f);
+  output.SetZeroPoint(128);
+
+  OpsTestNet net;
+  OpContext context(net.ws(), cpu_runtime);
+  std::unique_ptr<delegator::Gemm> gemm = delegator::Gemm::Create(
+      context.workspace(),
+      MACE_DELEGATOR_KEY(Gemm, RuntimeType::RT_CPU, OUTPUT_TYPE, kCpuImplType),
+      delegator::GemmParam());
+  // warm up
+  gemm->Compute(&context, &lhs, &rhs, 1, rows, cols, depth,
+                RowMajor, ColMajor, ColMajor, false, false, &output);
+  mace::testing::StartTiming();
+  while (iters--) {
+    gemm->Compute(&context, &lhs, &rhs, 1, rows, cols, depth,
+                  RowMajor, ColMajor, ColMajor, false, false, &output);
+  }
+}
+
+void MatmulBenchmark_q8_uint8(int iters, int rows, int depth, int cols) {
+  MatmulBenchmark_q8<uint8_t>(iters, rows, depth, cols);
+}
+
+void MatmulBenchmark_q8_int32(int iters, int rows, int depth, int cols) {
+  MatmulBenchmark_q8<int32_t>(iters, rows, depth, cols);
+}
 #endif
 
 }  // namespace
@@ -201,14 +285,27 @@ void MatmulBenchmark_gemmlowp_int32(int iters, int rows, int depth, int cols) {
   }                                                                \
   MACE_BENCHMARK(MACE_BM_MATMUL_##M##_##K##_##N##_##FUNC)
 
+#ifdef MACE_ENABLE_X86
+#define MACE_BM_MATMUL_X86(M, K, N)                      \
+  MACE_BM_MATMUL_FUNC(M, K, N, ref, float);              \
+  MACE_BM_MATMUL_FUNC(M, K, N, x86, float)
+#else
+#define MACE_BM_MATMUL_X86(M, K, N)                      \
+  MACE_BM_MATMUL_FUNC(M, K, N, ref, float)
+#endif  // MACE_ENABLE_X86
+
 #ifdef MACE_ENABLE_QUANTIZE
 #define MACE_BM_MATMUL(M, K, N)                          \
   MACE_BM_MATMUL_FUNC(M, K, N, Eigen, float);            \
+  MACE_BM_MATMUL_X86(M, K, N);                           \
   MACE_BM_MATMUL_FUNC(M, K, N, gemmlowp_uint8, uint8_t); \
-  MACE_BM_MATMUL_FUNC(M, K, N, gemmlowp_int32, uint8_t);
+  MACE_BM_MATMUL_FUNC(M, K, N, gemmlowp_int32, uint8_t); \
+  MACE_BM_MATMUL_FUNC(M, K, N, q8_uint8, uint8_t);       \
+  MACE_BM_MATMUL_FUNC(M, K, N, q8_int32, uint8_t);
 #else
 #define MACE_BM_MATMUL(M, K, N)                          \
-  MACE_BM_MATMUL_FUNC(M, K, N, Eigen, float)
+  MACE_BM_MATMUL_FUNC(M, K, N, Eigen, float);            \
+  MACE_BM_MATMUL_X86(M, K, N)
 #endif
 
 
@@ -14,6 +14,9 @@
 
 #ifdef MACE_ENABLE_QUANTIZE
 
+#include <cstdlib>
+#include <string>
+
 #include "mace/core/ops/operator.h"
 #include "mace/benchmark_utils/test_benchmark.h"
 #include "mace/ops/ops_test_util.h"
@@ -79,6 +82,46 @@ void Dequantize(int iters, int count) {
   }
   net.Sync();
 }
+
+// uint8 MatMul on the gemm backend named by `gemm`, "gemmlowp" or "mace",
+// which the op picks from MACE_QUANTIZE_GEMM when it is created.
+void QuantizedMatMul(int iters, int batch, int rows, int depth, int cols,
+                     const std::string &gemm) {
+  mace::testing::StopTiming();
+
+  OpsTestNet net;
+  net.AddRandomInput<RuntimeType::RT_CPU, uint8_t>("A", {batch, rows, depth});
+  net.AddRandomInput<RuntimeType::RT_CPU, uint8_t>("B", {depth, cols}, true);
+  net.GetTensor("A")->SetScale(0.1);
+  net.GetTensor("A")->SetZeroPoint(128);
+  net.GetTensor("B")->SetScale(0.1);
+  net.GetTensor("B")->SetZeroPoint(128);
+
+  OpDefBuilder("MatMul", "QuantizedMatMulBM")
+      .Input("A")
+      .Input("B")
+      .Output("Output")
+      .AddIntArg("T", static_cast<int>(DT_UINT8))
+      .Finalize(net.NewOperatorDef());
+
+  setenv("MACE_QUANTIZE_GEMM", gemm.c_str(), 1);
+  net.Setup(RuntimeType::RT_CPU);
+  unsetenv("MACE_QUANTIZE_GEMM");
+  net.GetTensor("Output")->SetScale(10);
+  net.GetTensor("Output")->SetZeroPoint(128);
+
+  // Warm-up
+  for (int i = 0; i < 2; ++i) {
+    net.Run();
+  }
+  net.Sync();
+
+  mace::testing::StartTiming();
+  while (iters--) {
+    net.Run();
+  }
+  net.Sync();
+}
 }  // namespace
 
 #define MACE_BM_QUANTIZE_MACRO(N, TYPE, DEVICE)            \
@@ -109,11 +152,30 @@ void Dequantize(int iters, int count) {
 #define MACE_BM_DEQUANTIZE(N)                              \
   MACE_BM_DEQUANTIZE_MACRO(N, uint8_t, RT_CPU);
 
+#define MACE_BM_QUANTIZED_MATMUL_MACRO(N, M, K, L, GEMM)                \
+  static void                                                           \
+    MACE_BM_QUANTIZED_MATMUL_##N##_##M##_##K##_##L##_##GEMM(int iters) { \
+    const int64_t macs = static_cast<int64_t>(iters) * N * M * K * L;   \
+    mace::testing::MacsProcessed(macs);                                 \
+    QuantizedMatMul(iters, N, M, K, L, #GEMM);                          \
+  }                                                                     \
+  MACE_BENCHMARK(                                                       \
+    MACE_BM_QUANTIZED_MATMUL_##N##_##M##_##K##_##L##_##GEMM)
+
+#define MACE_BM_QUANTIZED_MATMUL(N, M, K, L)                            \
+  MACE_BM_QUANTIZED_MATMUL_MACRO(N, M, K, L, gemmlowp);                 \
+  MACE_BM_QUANTIZED_MATMUL_MACRO(N, M, K, L, mace)
+
 MACE_BM_QUANTIZE(256);
 MACE_BM_QUANTIZE(1470000);
 MACE_BM_DEQUANTIZE(256);
 MACE_BM_DEQUANTIZE(1470000);
 
+MACE_BM_QUANTIZED_MATMUL(1, 128, 256, 128);
+MACE_BM_QUANTIZED_MATMUL(1, 3136, 128, 128);
+MACE_BM_QUANTIZED_MATMUL(1, 196, 512, 512);
+MACE_BM_QUANTIZED_MATMUL(16, 49, 128, 128);
+
 }  // namespace test
 }  // namespace ops
 }  // namespace mace
@@ -12,9 +12,14 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <cmath>
+#include <random>
 #include <string>
+#include <vector>
 
 #include "mace/benchmark_utils/test_benchmark.h"
+#include "mace/ops/delegator/vector_math.h"
 #include "mace/ops/ops_test_util.h"
 
 namespace mace {
@@ -24,7 +29,8 @@ namespace test {
 namespace {
 template<RuntimeType D, typename T>
 void SoftmaxBenchmark(int iters, int batch, int channels,
-                      int height, int width, DataFormat data_format) {
+                      int height, int width, DataFormat data_format,
+                      bool use_log = false) {
   mace::testing::StopTiming();
 
   OpsTestNet net;
@@ -43,6 +49,7 @@ void SoftmaxBenchmark(int iters, int batch, int channels,
       .Output("Output")
       .AddIntArg("T", static_cast<int>(DataTypeToEnum<T>::value))
       .AddIntArg("has_data_format", data_format == DataFormat::NCHW)
+      .AddIntArg("use_log", use_log)
       .Finalize(net.NewOperatorDef());
 
   // Warm-up
@@ -63,9 +70,10 @@ void SoftmaxBenchmark(int iters, int batch, int channels,
 template<>
 void SoftmaxBenchmark<RT_CPU, uint8_t>(
     int iters, int batch, int channels, int height,
-    int width, DataFormat data_format) {
+    int width, DataFormat data_format, bool use_log) {
   mace::testing::StopTiming();
   MACE_UNUSED(data_format);
+  MACE_UNUSED(use_log);
 
   OpsTestNet net;
 
@@ -144,6 +152,90 @@ MACE_BM_SOFTMAX(1, 3, 512, 512);
 MACE_BM_SOFTMAX(1, 4, 512, 512);
 MACE_BM_SOFTMAX(1, 10, 256, 256);
 MACE_BM_SOFTMAX(1, 1024, 7, 7);
+// the rows of the scores of an attention head, L = 512
+MACE_BM_SOFTMAX(1, 512, 1, 512);
+
+#define MACE_BM_LOG_SOFTMAX_MACRO(N, C, H, W, DF)                          \
+  static void MACE_BM_LOG_SOFTMAX_##N##_##C##_##H##_##W##_##DF(            \
+      int iters) {                                                         \
+    const int64_t tot = static_cast<int64_t>(iters) * N * C * H * W;       \
+    mace::testing::BytesProcessed(tot *(sizeof(float)));                   \
+    SoftmaxBenchmark<RT_CPU, float>(iters, N, C, H, W, (DataFormat::DF),   \
+                                    true);                                 \
+  }                                                                        \
+  MACE_BENCHMARK(MACE_BM_LOG_SOFTMAX_##N##_##C##_##H##_##W##_##DF)
+
+#define MACE_BM_LOG_SOFTMAX(N, C, H, W)              \
+  MACE_BM_LOG_SOFTMAX_MACRO(N, C, H, W, NCHW);       \
+  MACE_BM_LOG_SOFTMAX_MACRO(N, C, H, W, NHWC)
+
+MACE_BM_LOG_SOFTMAX(1, 10, 256, 256);
+MACE_BM_LOG_SOFTMAX(1, 512, 1, 512);
+
+// Rows of `classes` scores normalized with the exp of delegator::VectorMath
+// against the libm calls it replaces, on one thread.
+namespace {
+void SoftmaxRowsBenchmark(int iters, bool use_libm, int rows, int classes) {
+  mace::testing::StopTiming();
+
+  OpsTestNet net;
+  std::unique_ptr<delegator::VectorMath> vector_math =
+      delegator::VectorMath::Create(
+          net.ws(), MACE_DELEGATOR_KEY(VectorMath, RuntimeType::RT_CPU,
+                                       float, kCpuImplType),
+          DelegatorParam());
+  std::vector<float> input(rows * classes);
+  std::vector<float> output(rows * classes);
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<float> dist(-8.f, 8.f);
+  for (auto &v : input) {
+    v = dist(gen);
+  }
+
+  mace::testing::StartTiming();
+  while (iters--) {
+    for (int r = 0; r < rows; ++r) {
+      const float *in = input.data() + r * classes;
+      float *out = output.data() + r * classes;
+      const float max_val = *std::max_element(in, in + classes);
+      for (int c = 0; c < classes; ++c) {
+        out[c] = in[c] - max_val;
+      }
+      if (use_libm) {
+        for (int c = 0; c < classes; ++c) {
+          out[c] = std::exp(out[c]);
+        }
+      } else {
+        vector_math->Exp(out, classes, out);
+      }
+      float sum = 0;
+      for (int c = 0; c < classes; ++c) {
+        sum += out[c];
+      }
+      const float inv_sum = 1.f / sum;
+      for (int c = 0; c < classes; ++c) {
+        out[c] *= inv_sum;
+      }
+    }
+  }
+}
+}  // namespace
+
+#define MACE_BM_SOFTMAX_ROWS_MACRO(IMPL, USE_LIBM, ROWS, CLASSES)         \
+  static void MACE_BM_SOFTMAX_ROWS_##IMPL##_##ROWS##_##CLASSES(           \
+      int iters) {                                                        \
+    const int64_t tot = static_cast<int64_t>(iters) * ROWS * CLASSES;     \
+    mace::testing::BytesProcessed(tot *(sizeof(float)));                  \
+    SoftmaxRowsBenchmark(iters, USE_LIBM, ROWS, CLASSES);                 \
+  }                                                                       \
+  MACE_BENCHMARK(MACE_BM_SOFTMAX_ROWS_##IMPL##_##ROWS##_##CLASSES)
+
+#define MACE_BM_SOFTMAX_ROWS(ROWS, CLASSES)                  \
+  MACE_BM_SOFTMAX_ROWS_MACRO(LIBM, true, ROWS, CLASSES);     \
+  MACE_BM_SOFTMAX_ROWS_MACRO(POLY, false, ROWS, CLASSES)
+
+MACE_BM_SOFTMAX_ROWS(512, 512);
+MACE_BM_SOFTMAX_ROWS(64, 1000);
 
 }  // namespace test
 }  // namespace ops
@@ -97,6 +97,42 @@ void ThreadPoolBenchmark2D(int iters, int size0, int size1) {
   }
 }
 
+// The work of channel c grows with c, an even split of the channels leaves
+// the threads owning the first ones idle.
+index_t ImbalancedImageSize(const index_t c, const index_t size) {
+  return image_size * 2 * (c + 1) / size;
+}
+
+void OpenMPBenchmarkImbalanced1D(int iters, int size) {
+  while (iters--) {
+#pragma omp parallel for schedule(runtime)
+    for (int c = 0; c < size; ++c) {
+      const index_t len = ImbalancedImageSize(c, size);
+      for (index_t i = 0; i < len; ++i) {
+        output_data[c * image_size * 2 + i] += bias_data[c];
+      }
+    }
+  }
+}
+
+void ThreadPoolBenchmarkImbalanced1D(int iters, int size) {
+  mace::testing::StopTiming();
+  utils::ThreadPool thread_pool(4, CPUAffinityPolicy::AFFINITY_BIG_ONLY);
+  thread_pool.Init();
+  mace::testing::StartTiming();
+
+  while (iters--) {
+    thread_pool.Compute1D([=](index_t start0, index_t end0, index_t step0) {
+      for (index_t c = start0; c < end0; c += step0) {
+        const index_t len = ImbalancedImageSize(c, size);
+        for (index_t i = 0; i < len; ++i) {
+          output_data[c * image_size * 2 + i] += bias_data[c];
+        }
+      }
+    }, 0, size, 1);
+  }
+}
+
 }  // namespace
 
 #define MACE_BM_THREADPOOL_OPENMP_1D(SIZE)                               \
@@ -135,6 +171,24 @@ void ThreadPoolBenchmark2D(int iters, int size0, int size1) {
   }                                                                           \
   MACE_BENCHMARK(MACE_BM_THREADPOOL_MACE_2D_##SIZE0##_##SIZE1)
 
+#define MACE_BM_THREADPOOL_OPENMP_IMBALANCED_1D(SIZE)                      \
+  static void MACE_BM_THREADPOOL_OPENMP_IMBALANCED_1D_##SIZE(int iters) {  \
+    const int64_t tot = static_cast<int64_t>(iters) * SIZE;                \
+    mace::testing::MacsProcessed(static_cast<int64_t>(iters) * SIZE);      \
+    mace::testing::BytesProcessed(tot * sizeof(float));                    \
+    OpenMPBenchmarkImbalanced1D(iters, SIZE);                              \
+  }                                                                        \
+  MACE_BENCHMARK(MACE_BM_THREADPOOL_OPENMP_IMBALANCED_1D_##SIZE)
+
+#define MACE_BM_THREADPOOL_MACE_IMBALANCED_1D(SIZE)                        \
+  static void MACE_BM_THREADPOOL_MACE_IMBALANCED_1D_##SIZE(int iters) {    \
+    const int64_t tot = static_cast<int64_t>(iters) * SIZE;                \
+    mace::testing::MacsProcessed(static_cast<int64_t>(iters) * SIZE);      \
+    mace::testing::BytesProcessed(tot * sizeof(float));                    \
+    ThreadPoolBenchmarkImbalanced1D(iters, SIZE);                          \
+  }                                                                        \
+  MACE_BENCHMARK(MACE_BM_THREADPOOL_MACE_IMBALANCED_1D_##SIZE)
+
 // OpenMP and Mace threadpool need to be benchmarked separately.
 
 MACE_BM_THREADPOOL_OPENMP_1D(64);
@@ -149,6 +203,9 @@ MACE_BM_THREADPOOL_OPENMP_2D(1, 256);
 MACE_BM_THREADPOOL_OPENMP_2D(1, 512);
 MACE_BM_THREADPOOL_OPENMP_2D(1, 1024);
 
+MACE_BM_THREADPOOL_OPENMP_IMBALANCED_1D(64);
+MACE_BM_THREADPOOL_OPENMP_IMBALANCED_1D(256);
+MACE_BM_THREADPOOL_OPENMP_IMBALANCED_1D(1024);
 
 MACE_BM_THREADPOOL_MACE_1D(64);
 MACE_BM_THREADPOOL_MACE_1D(128);
@@ -162,6 +219,10 @@ MACE_BM_THREADPOOL_MACE_2D(1, 256);
 MACE_BM_THREADPOOL_MACE_2D(1, 512);
 MACE_BM_THREADPOOL_MACE_2D(1, 1024);
 
+MACE_BM_THREADPOOL_MACE_IMBALANCED_1D(64);
+MACE_BM_THREADPOOL_MACE_IMBALANCED_1D(256);
+MACE_BM_THREADPOOL_MACE_IMBALANCED_1D(1024);
+
 }  // namespace test
 }  // namespace ops
 }  // namespace mace
@@ -0,0 +1,109 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include "mace/core/net/arena_planner.h"
+
+namespace mace {
+namespace test {
+
+namespace {
+
+// Blocks alive during [first[i], last[i]] conflict if the ranges intersect.
+index_t PlanIntervals(const std::vector<index_t> &bytes,
+                      const std::vector<int> &first,
+                      const std::vector<int> &last,
+                      const index_t alignment,
+                      std::vector<index_t> *offsets) {
+  auto conflict = [&](size_t i, size_t j) -> bool {
+    return first[i] <= last[j] && first[j] <= last[i];
+  };
+  const index_t arena_bytes = PlanArena(bytes, alignment, conflict, offsets);
+
+  for (size_t i = 0; i < bytes.size(); ++i) {
+    EXPECT_EQ((*offsets)[i] % alignment, 0);
+    EXPECT_LE((*offsets)[i] + bytes[i], arena_bytes);
+    for (size_t j = i + 1; j < bytes.size(); ++j) {
+      if (conflict(i, j)) {
+        EXPECT_TRUE((*offsets)[i] + bytes[i] <= (*offsets)[j] ||
+                    (*offsets)[j] + bytes[j] <= (*offsets)[i])
+            << "blocks " << i << " and " << j << " overlap";
+      }
+    }
+  }
+  return arena_bytes;
+}
+
+}  // namespace
+
+TEST(ArenaPlannerTest, Chain) {
+  // each op reads the output of the previous one
+  const std::vector<index_t> bytes = {100, 200, 100, 50};
+  const std::vector<int> first = {0, 1, 2, 3};
+  const std::vector<int> last = {1, 2, 3, 4};
+  std::vector<index_t> offsets;
+  EXPECT_EQ(PlanIntervals(bytes, first, last, 1, &offsets), 300);
+  EXPECT_EQ(offsets[0], offsets[2]);
+}
+
+TEST(ArenaPlannerTest, AllAlive) {
+  const std::vector<index_t> bytes = {1, 100, 64, 3};
+  const std::vector<int> first = {0, 0, 0, 0};
+  const std::vector<int> last = {1, 1, 1, 1};
+  std::vector<index_t> offsets;
+  EXPECT_EQ(PlanIntervals(bytes, first, last, 64, &offsets), 4 * 64 + 64);
+}
+
+TEST(ArenaPlannerTest, FillGap) {
+  // the small block fits the gap between the two large ones
+  const std::vector<index_t> bytes = {100, 100, 30, 60};
+  const std::vector<int> first = {0, 0, 2, 3};
+  const std::vector<int> last = {4, 1, 4, 4};
+  std::vector<index_t> offsets;
+  EXPECT_EQ(PlanIntervals(bytes, first, last, 1, &offsets), 200);
+}
+
+TEST(ArenaPlannerTest, Random) {
+  srand(0);
+  for (int round = 0; round < 20; ++round) {
+    const int count = 1 + rand() % 64;
+    const int op_count = 1 + rand() % 32;
+    std::vector<index_t> bytes(count);
+    std::vector<int> first(count);
+    std::vector<int> last(count);
+    std::vector<index_t> live_bytes(op_count, 0);
+    for (int i = 0; i < count; ++i) {
+      bytes[i] = 64 * (1 + rand() % 100);
+      first[i] = rand() % op_count;
+      last[i] = first[i] + rand() % (op_count - first[i]);
+      for (int op = first[i]; op <= last[i]; ++op) {
+        live_bytes[op] += bytes[i];
+      }
+    }
+    std::vector<index_t> offsets;
+    const index_t arena_bytes =
+        PlanIntervals(bytes, first, last, 64, &offsets);
+    EXPECT_GE(arena_bytes,
+              *std::max_element(live_bytes.begin(), live_bytes.end()));
+  }
+}
+
+}  // namespace test
+}  // namespace mace
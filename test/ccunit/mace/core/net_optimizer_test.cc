@@ -0,0 +1,310 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "mace/core/net_optimizer.h"
+#include "mace/ops/ops_test_util.h"
+
+namespace mace {
+namespace test {
+
+class NetOptimizerTest : public ops::test::OpsTestBase {};
+
+namespace {
+
+using ops::test::OpDefBuilder;
+
+const std::vector<index_t> kShape = {1, 3, 4, 2};
+
+void AddInputInfo(const std::string &name, NetDef *net_def) {
+  InputOutputInfo *info = net_def->add_input_info();
+  info->set_name(name);
+  info->set_data_format(static_cast<int>(DataFormat::NONE));
+  for (auto dim : kShape) {
+    info->add_dims(static_cast<int>(dim));
+  }
+}
+
+void AddOutputInfo(const std::string &name, NetDef *net_def) {
+  net_def->add_output_info()->set_name(name);
+}
+
+void AddTranspose(const std::string &input, const std::string &output,
+                  const std::vector<int> &dims, NetDef *net_def) {
+  std::vector<index_t> shape;
+  for (int dim : dims) {
+    shape.push_back(kShape[dim]);
+  }
+  OpDefBuilder("Transpose", output + "_op")
+      .Input(input)
+      .Output(output)
+      .OutputShape(shape)
+      .AddIntsArg("dims", dims)
+      .Finalize(net_def->add_op());
+}
+
+void AddActivation(const std::string &input, const std::string &output,
+                   const char *activation, NetDef *net_def,
+                   const std::vector<index_t> &shape = kShape) {
+  OpDefBuilder("Activation", output + "_op")
+      .Input(input)
+      .Output(output)
+      .OutputShape(shape)
+      .AddStringArg("activation", activation)
+      .AddFloatArg("max_limit", 6)
+      .Finalize(net_def->add_op());
+}
+
+std::vector<GraphPassReport> Optimize(ops::test::OpsTestNet *net,
+                                      NetDef *net_def) {
+  NetOptimizer optimizer;
+  std::vector<GraphPassReport> reports;
+  EXPECT_EQ(optimizer.OptimizeNetDef(net->ws(), RuntimeType::RT_CPU,
+                                     net_def, &reports),
+            MaceStatus::MACE_SUCCESS);
+  return reports;
+}
+
+const GraphPassReport &Report(const std::vector<GraphPassReport> &reports,
+                              const std::string &pass) {
+  auto iter = std::find_if(reports.begin(), reports.end(),
+                           [&](const GraphPassReport &report) {
+                             return report.pass == pass;
+                           });
+  MACE_CHECK(iter != reports.end(), "No report of ", pass);
+  return *iter;
+}
+
+}  // namespace
+
+TEST_F(NetOptimizerTest, CancelTransposes) {
+  NetDef net_def;
+  AddInputInfo("input", &net_def);
+  AddTranspose("input", "nhwc", {0, 2, 3, 1}, &net_def);
+  AddTranspose("nhwc", "nchw", {0, 3, 1, 2}, &net_def);
+  AddActivation("nchw", "output", "TANH", &net_def);
+  AddOutputInfo("output", &net_def);
+
+  ops::test::OpsTestNet net;
+  auto reports = Optimize(&net, &net_def);
+  ASSERT_EQ(net_def.op_size(), 1);
+  EXPECT_EQ(net_def.op(0).input(0), "input");
+  EXPECT_EQ(Report(reports, "fold_transpose").removed_ops, 2);
+  EXPECT_EQ(Report(reports, "fold_transpose").saved_bytes,
+            2 * 24 * static_cast<int64_t>(sizeof(float)));
+}
+
+TEST_F(NetOptimizerTest, MergeTransposes) {
+  NetDef net_def;
+  AddInputInfo("input", &net_def);
+  AddTranspose("input", "nhwc", {0, 2, 3, 1}, &net_def);
+  AddTranspose("nhwc", "nwhc", {0, 2, 1, 3}, &net_def);
+  AddActivation("nwhc", "output", "TANH", &net_def);
+  AddOutputInfo("output", &net_def);
+
+  ops::test::OpsTestNet net;
+  auto reports = Optimize(&net, &net_def);
+  ASSERT_EQ(net_def.op_size(), 2);
+  EXPECT_EQ(net_def.op(0).input(0), "input");
+  EXPECT_EQ(net_def.op(0).output(0), "nwhc");
+  EXPECT_EQ((ProtoArgHelper::GetRepeatedArgs<OperatorDef, int>(
+                net_def.op(0), "dims")),
+            std::vector<int>({0, 3, 2, 1}));
+  EXPECT_EQ(Report(reports, "fold_transpose").removed_ops, 1);
+}
+
+TEST_F(NetOptimizerTest, SinkTransposes) {
+  NetDef net_def;
+  AddInputInfo("input", &net_def);
+  AddTranspose("input", "nhwc", {0, 2, 3, 1}, &net_def);
+  AddActivation("nhwc", "relu", "RELU", &net_def, {1, 4, 2, 3});
+  AddActivation("relu", "tanh", "TANH", &net_def, {1, 4, 2, 3});
+  AddTranspose("tanh", "nchw", {0, 3, 1, 2}, &net_def);
+  AddActivation("nchw", "output", "SIGMOID", &net_def);
+  AddOutputInfo("output", &net_def);
+
+  ops::test::OpsTestNet net;
+  auto reports = Optimize(&net, &net_def);
+  ASSERT_EQ(net_def.op_size(), 3);
+  for (auto &op_def : net_def.op()) {
+    EXPECT_EQ(op_def.type(), "Activation");
+    EXPECT_EQ(std::vector<int64_t>(op_def.output_shape(0).dims().begin(),
+                                   op_def.output_shape(0).dims().end()),
+              kShape);
+  }
+  EXPECT_EQ(net_def.op(0).input(0), "input");
+  EXPECT_EQ(net_def.op(2).output(0), "output");
+  EXPECT_EQ(Report(reports, "fold_transpose").removed_ops, 2);
+}
+
+TEST_F(NetOptimizerTest, KeepOutputs) {
+  NetDef net_def;
+  AddInputInfo("input", &net_def);
+  AddTranspose("input", "nhwc", {0, 2, 3, 1}, &net_def);
+  AddTranspose("nhwc", "output", {0, 3, 1, 2}, &net_def);
+  AddOutputInfo("nhwc", &net_def);
+  AddOutputInfo("output", &net_def);
+
+  ops::test::OpsTestNet net;
+  auto reports = Optimize(&net, &net_def);
+  EXPECT_EQ(net_def.op_size(), 2);
+  EXPECT_EQ(Report(reports, "fold_transpose").removed_ops, 0);
+}
+
+TEST_F(NetOptimizerTest, FoldEltwiseActivation) {
+  NetDef net_def;
+  AddInputInfo("input0", &net_def);
+  AddInputInfo("input1", &net_def);
+  OpDefBuilder("Eltwise", "sum_op")
+      .Input("input0")
+      .Input("input1")
+      .Output("sum")
+      .OutputShape(kShape)
+      .AddIntArg("type", 0)
+      .Finalize(net_def.add_op());
+  AddActivation("sum", "output", "RELUX", &net_def);
+  AddOutputInfo("output", &net_def);
+
+  ops::test::OpsTestNet net;
+  auto reports = Optimize(&net, &net_def);
+  ASSERT_EQ(net_def.op_size(), 1);
+  auto &op_def = net_def.op(0);
+  EXPECT_EQ(op_def.type(), "Eltwise");
+  EXPECT_EQ(op_def.output(0), "output");
+  EXPECT_EQ((ProtoArgHelper::GetOptionalArg<OperatorDef, std::string>(
+                op_def, "activation", "")), "RELUX");
+  EXPECT_EQ((ProtoArgHelper::GetOptionalArg<OperatorDef, float>(
+                op_def, "max_limit", 0.f)), 6.f);
+  EXPECT_EQ(Report(reports, "fold_eltwise_activation").removed_ops, 1);
+  EXPECT_EQ(Report(reports, "fold_eltwise_activation").saved_bytes,
+            24 * static_cast<int64_t>(sizeof(float)));
+}
+
+TEST_F(NetOptimizerTest, FoldReshape) {
+  NetDef net_def;
+  AddInputInfo("input", &net_def);
+  OpDefBuilder("Reshape", "flat_op")
+      .Input("input")
+      .Output("flat")
+      .AddIntsArg("dim", {1, -1})
+      .Finalize(net_def.add_op());
+  OpDefBuilder("Reshape", "matrix_op")
+      .Input("flat")
+      .Output("matrix")
+      .AddIntsArg("dim", {4, 6})
+      .Finalize(net_def.add_op());
+  // copies the first dim of its input
+  OpDefBuilder("Reshape", "output_op")
+      .Input("matrix")
+      .Output("output")
+      .AddIntsArg("dim", {0, 2, 3})
+      .Finalize(net_def.add_op());
+  AddOutputInfo("output", &net_def);
+
+  ops::test::OpsTestNet net;
+  auto reports = Optimize(&net, &net_def);
+  ASSERT_EQ(net_def.op_size(), 2);
+  EXPECT_EQ(net_def.op(0).input(0), "input");
+  EXPECT_EQ(net_def.op(0).output(0), "matrix");
+  EXPECT_EQ(net_def.op(1).input(0), "matrix");
+  EXPECT_EQ(Report(reports, "fold_reshape").removed_ops, 1);
+}
+
+TEST_F(NetOptimizerTest, FoldConstant) {
+  ops::test::OpsTestNet net;
+  net.AddRandomInput<RuntimeType::RT_CPU, float>("weight", {4, 6}, true);
+
+  NetDef net_def;
+  InputOutputInfo *info = net_def.add_input_info();
+  info->set_name("input");
+  info->add_dims(24);
+  OpDefBuilder("Reshape", "vector_op")
+      .Input("weight")
+      .Output("vector")
+      .OutputShape({24})
+      .AddIntsArg("dim", {-1})
+      .Finalize(net_def.add_op());
+  OpDefBuilder("Eltwise", "output_op")
+      .Input("input")
+      .Input("vector")
+      .Output("output")
+      .AddIntArg("type", 0)
+      .Finalize(net_def.add_op());
+  AddOutputInfo("output", &net_def);
+
+  auto reports = Optimize(&net, &net_def);
+  ASSERT_EQ(net_def.op_size(), 1);
+  EXPECT_EQ(Report(reports, "fold_constant").removed_ops, 1);
+  const Tensor *weight = net.ws()->GetTensor("weight");
+  const Tensor *vector = net.ws()->GetTensor("vector");
+  ASSERT_NE(vector, nullptr);
+  EXPECT_TRUE(vector->is_weight());
+  EXPECT_EQ(vector->shape(), std::vector<index_t>({24}));
+  EXPECT_EQ(vector->data<float>(), weight->data<float>());
+}
+
+TEST_F(NetOptimizerTest, RunFoldedNet) {
+  // Eltwise and RELU are fused, the transposes cancel out
+  ops::test::OpsTestNet net;
+  net.AddRandomInput<RuntimeType::RT_CPU, float>("Input0", kShape, false,
+                                                 false);
+  net.AddRandomInput<RuntimeType::RT_CPU, float>("Input1", kShape, false,
+                                                 false);
+  OpDefBuilder("Eltwise", "Sum")
+      .Input("Input0")
+      .Input("Input1")
+      .Output("Sum")
+      .AddIntArg("type", 0)
+      .Finalize(net.NewOperatorDef());
+  OpDefBuilder("Activation", "Relu")
+      .Input("Sum")
+      .Output("Relu")
+      .AddStringArg("activation", "RELU")
+      .Finalize(net.AddNewOperatorDef());
+  OpDefBuilder("Transpose", "NHWC")
+      .Input("Relu")
+      .Output("NHWC")
+      .AddIntsArg("dims", {0, 2, 3, 1})
+      .Finalize(net.AddNewOperatorDef());
+  OpDefBuilder("Transpose", "NCHW")
+      .Input("NHWC")
+      .Output("NCHW")
+      .AddIntsArg("dims", {0, 3, 1, 2})
+      .Finalize(net.AddNewOperatorDef());
+  OpDefBuilder("Activation", "Output")
+      .Input("NCHW")
+      .Output("Output")
+      .AddStringArg("activation", "RELUX")
+      .AddFloatArg("max_limit", 0.5f)
+      .Finalize(net.AddNewOperatorDef());
+  net.RunOp(RuntimeType::RT_CPU);
+
+  const Tensor *input0 = net.GetTensor("Input0");
+  const Tensor *input1 = net.GetTensor("Input1");
+  std::vector<float> expected_data(input0->size());
+  for (index_t i = 0; i < input0->size(); ++i) {
+    expected_data[i] = std::min(
+        std::max(input0->data<float>()[i] + input1->data<float>()[i], 0.f),
+        0.5f);
+  }
+  auto expected = net.CreateTensor<float>(kShape, expected_data);
+  ops::test::ExpectTensorNear<float>(*expected, *net.GetOutput("Output"),
+                                     1e-5);
+}
+
+}  // namespace test
+}  // namespace mace
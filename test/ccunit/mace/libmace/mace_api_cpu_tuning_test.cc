@@ -0,0 +1,135 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+#include "mace/core/proto/arg_helper.h"
+#include "mace/libmace/mace_api_test.h"
+
+namespace mace {
+namespace test {
+
+namespace {
+
+const char kParameterFile[] = "mace_api_cpu_tuning_test.bin";
+
+}  // namespace
+
+class MaceCpuTuningAPITest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // the reference ops share a static runtime, which must not be created
+    // while the tuning variables are set
+    ops::test::OpTestContext::Get();
+  }
+
+  void TearDown() override {
+    unsetenv("MACE_TUNING");
+    unsetenv("MACE_CPU_RUN_PARAMETER_PATH");
+    remove(kParameterFile);
+  }
+
+  // Runs a chain of `depth` convolutions of the same shape, with inputs of
+  // each of `shapes`, the first being the shape of the model.
+  void RunConvs(const int depth, const std::string &parameter_file,
+                const std::vector<std::vector<int64_t>> &shapes =
+                    {{1, 16, 16, 8}}) {
+    const std::vector<int64_t> &shape = shapes[0];
+    const std::vector<int64_t> filter_shape = {8, 8, 3, 3};
+    const std::vector<std::string> input_names = {"input"};
+    const std::vector<std::string> output_names = {"output"};
+
+    std::shared_ptr<MultiNetDef> multi_net_def(new MultiNetDef());
+    NetDef *net_def = multi_net_def->add_net_def();
+
+    std::vector<float> data;
+    ops::test::GenerateRandomRealTypeData<float>(filter_shape, &data);
+    AddTensor<float>("filter", filter_shape, 0, data.size(), net_def);
+
+    InputOutputInfo *input_info = net_def->add_input_info();
+    input_info->set_data_format(static_cast<int>(DataFormat::NHWC));
+    input_info->set_name(input_names[0]);
+    for (auto d : shape) {
+      input_info->add_dims(static_cast<int>(d));
+    }
+    multi_net_def->add_input_tensor(input_names[0]);
+    net_def->add_output_info()->set_name(output_names[0]);
+    multi_net_def->add_output_tensor(output_names[0]);
+    for (int d = 0; d < depth; ++d) {
+      std::string input_name = d == 0 ? input_names[0] : MakeString("conv", d);
+      std::string output_name =
+          d == depth - 1 ? output_names[0] : MakeString("conv", d + 1);
+      Conv3x3<float>(input_name, "filter", output_name, shape, net_def);
+    }
+
+    MaceEngineConfig config;
+    EXPECT_EQ(config.SetCPUParameterPath(parameter_file),
+              MaceStatus::MACE_SUCCESS);
+    SetProtoArg(net_def, "runtime_type", static_cast<int>(RT_CPU));
+    MaceEngine engine(config);
+    EXPECT_EQ(engine.Init(multi_net_def.get(), input_names, output_names,
+                          reinterpret_cast<unsigned char *>(data.data()),
+                          data.size() * sizeof(float)),
+              MaceStatus::MACE_SUCCESS);
+
+    for (int r = 0; r < 2; ++r) {
+      for (auto &run_shape : shapes) {
+        std::map<std::string, mace::MaceTensor> inputs;
+        std::map<std::string, mace::MaceTensor> outputs;
+        GenerateInputs(input_names, run_shape, &inputs);
+        GenerateOutputs(output_names, run_shape, &outputs);
+        EXPECT_EQ(engine.Run(inputs, &outputs), MaceStatus::MACE_SUCCESS);
+        CheckOutputs<RT_CPU, float>(*net_def, inputs, outputs, data);
+      }
+    }
+  }
+};
+
+TEST_F(MaceCpuTuningAPITest, TuneThenRun) {
+  setenv("MACE_TUNING", "1", 1);
+  setenv("MACE_CPU_RUN_PARAMETER_PATH", kParameterFile, 1);
+  // the parameters are written when the engine is destroyed
+  RunConvs(3, "");
+  std::ifstream tuned(kParameterFile, std::ios::binary | std::ios::ate);
+  ASSERT_TRUE(tuned.is_open());
+  EXPECT_GT(tuned.tellg(), 0);
+  tuned.close();
+
+  unsetenv("MACE_TUNING");
+  unsetenv("MACE_CPU_RUN_PARAMETER_PATH");
+  RunConvs(3, kParameterFile);
+}
+
+TEST_F(MaceCpuTuningAPITest, TuneShapes) {
+  // each output shape is tuned at its first run, the runs with the tuned
+  // parameters switch between the kernels picked for the shapes
+  const std::vector<std::vector<int64_t>> shapes = {
+      {1, 16, 16, 8}, {1, 4, 4, 8}, {1, 32, 24, 8}};
+  setenv("MACE_TUNING", "1", 1);
+  setenv("MACE_CPU_RUN_PARAMETER_PATH", kParameterFile, 1);
+  RunConvs(2, "", shapes);
+
+  unsetenv("MACE_TUNING");
+  unsetenv("MACE_CPU_RUN_PARAMETER_PATH");
+  RunConvs(2, kParameterFile, shapes);
+}
+
+TEST_F(MaceCpuTuningAPITest, MissingParameterFile) {
+  RunConvs(2, "no_such_dir/cpu_parameters.bin");
+}
+
+}  // namespace test
+}  // namespace mace
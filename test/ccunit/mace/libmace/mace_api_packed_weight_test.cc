@@ -0,0 +1,167 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+
+#include "mace/core/packed_weight_cache.h"
+#include "mace/core/proto/arg_helper.h"
+#include "mace/libmace/mace_api_test.h"
+#include "mace/utils/cpu_isa.h"
+
+namespace mace {
+namespace test {
+
+class MacePackedWeightAPITest : public ::testing::Test {};
+
+namespace {
+
+const char kCacheDir[] = ".";
+#if defined(MACE_ENABLE_NEON) || defined(MACE_ENABLE_X86)
+// the reference kernels have no packed layout
+const bool kPrepacks = true;
+#else
+const bool kPrepacks = false;
+#endif
+
+// A winograd 3x3 convolution followed by a gemm 1x1 convolution, both have
+// their filter prepacked.
+class PackedWeightModel {
+ public:
+  PackedWeightModel() : multi_net_def_(new MultiNetDef()) {
+    NetDef *net_def = multi_net_def_->add_net_def();
+    const std::vector<int64_t> filter3x3_shape = {8, 8, 3, 3};
+    const std::vector<int64_t> filter1x1_shape = {8, 8, 1, 1};
+    std::vector<float> filter1x1;
+    ops::test::GenerateRandomRealTypeData<float>(filter3x3_shape, &data_);
+    ops::test::GenerateRandomRealTypeData<float>(filter1x1_shape, &filter1x1);
+    AddTensor<float>("filter3x3", filter3x3_shape, 0, data_.size(), net_def);
+    AddTensor<float>("filter1x1", filter1x1_shape,
+                     data_.size() * sizeof(float), filter1x1.size(), net_def);
+    data_.insert(data_.end(), filter1x1.begin(), filter1x1.end());
+
+    InputOutputInfo *input_info = net_def->add_input_info();
+    input_info->set_data_format(static_cast<int>(DataFormat::NHWC));
+    input_info->set_name("input");
+    for (auto d : shape_) {
+      input_info->add_dims(static_cast<int>(d));
+    }
+    multi_net_def_->add_input_tensor("input");
+    net_def->add_output_info()->set_name("output");
+    multi_net_def_->add_output_tensor("output");
+    Conv3x3<float>("input", "filter3x3", "conv", shape_, net_def);
+    Conv3x3<float>("conv", "filter1x1", "output", shape_, net_def);
+    SetProtoArg(net_def, "runtime_type", static_cast<int>(RT_CPU));
+  }
+
+  static const char *CacheIsa() {
+    return utils::CPUIsaToString(utils::ResolveCPUIsa(CPUIsa::CPU_ISA_AUTO));
+  }
+
+  std::string CacheFilePath() const {
+    return PackedWeightCacheFilePath(
+        kCacheDir, reinterpret_cast<const unsigned char *>(data_.data()),
+        data_.size() * sizeof(float), CacheIsa());
+  }
+
+  void Run(const std::string &cache_dir) {
+    MaceEngineConfig config;
+    EXPECT_EQ(config.SetPackedWeightCacheDir(cache_dir),
+              MaceStatus::MACE_SUCCESS);
+    MaceEngine engine(config);
+    const std::vector<std::string> input_names = {"input"};
+    const std::vector<std::string> output_names = {"output"};
+    ASSERT_EQ(engine.Init(multi_net_def_.get(), input_names, output_names,
+                          reinterpret_cast<unsigned char *>(data_.data()),
+                          data_.size() * sizeof(float)),
+              MaceStatus::MACE_SUCCESS);
+
+    for (int i = 0; i < 2; ++i) {
+      std::map<std::string, mace::MaceTensor> inputs;
+      std::map<std::string, mace::MaceTensor> outputs;
+      GenerateInputs(input_names, shape_, &inputs);
+      GenerateOutputs(output_names, shape_, &outputs);
+      ASSERT_EQ(engine.Run(inputs, &outputs), MaceStatus::MACE_SUCCESS);
+      CheckOutputs<RT_CPU, float>(multi_net_def_->net_def(0), inputs, outputs,
+                                  data_);
+    }
+  }
+
+ private:
+  const std::vector<int64_t> shape_ = {1, 16, 16, 8};
+  std::shared_ptr<MultiNetDef> multi_net_def_;
+  std::vector<float> data_;
+};
+
+bool FileExists(const std::string &path) {
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    return false;
+  }
+  fclose(file);
+  return true;
+}
+
+}  // namespace
+
+TEST_F(MacePackedWeightAPITest, WithoutCache) {
+  PackedWeightModel model;
+  model.Run("");
+  EXPECT_FALSE(FileExists(model.CacheFilePath()));
+}
+
+TEST_F(MacePackedWeightAPITest, CacheRoundTrip) {
+  PackedWeightModel model;
+  const std::string path = model.CacheFilePath();
+  remove(path.c_str());
+  // packs and writes the cache
+  model.Run(kCacheDir);
+  ASSERT_EQ(kPrepacks, FileExists(path));
+  // maps the cache
+  model.Run(kCacheDir);
+  remove(path.c_str());
+}
+
+TEST_F(MacePackedWeightAPITest, CorruptedCache) {
+  PackedWeightModel model;
+  const std::string path = model.CacheFilePath();
+  FILE *file = fopen(path.c_str(), "wb");
+  ASSERT_NE(file, nullptr);
+  const char garbage[] = "not a packed weight cache";
+  fwrite(garbage, 1, sizeof(garbage), file);
+  fclose(file);
+
+  // rebuilds the cache
+  model.Run(kCacheDir);
+  PackedWeightCache cache(path, PackedWeightModel::CacheIsa());
+  EXPECT_EQ(cache.Load(), MaceStatus::MACE_SUCCESS);
+  EXPECT_EQ(kPrepacks, cache.size() > 0);
+  model.Run(kCacheDir);
+  remove(path.c_str());
+}
+
+TEST_F(MacePackedWeightAPITest, OtherIsaCache) {
+  PackedWeightModel model;
+  const std::string path = model.CacheFilePath();
+  remove(path.c_str());
+  model.Run(kCacheDir);
+
+  // the weights packed for another ISA are not mapped
+  PackedWeightCache cache(path, "other_isa");
+  EXPECT_EQ(cache.Load(), MaceStatus::MACE_SUCCESS);
+  EXPECT_EQ(0u, cache.size());
+  remove(path.c_str());
+}
+
+}  // namespace test
+}  // namespace mace
@@ -0,0 +1,114 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/core/proto/arg_helper.h"
+#include "mace/libmace/mace_api_test.h"
+
+namespace mace {
+namespace test {
+
+class MaceParallelAPITest : public ::testing::Test {};
+
+namespace {
+
+// Each input goes through its own chain of `depth` convolutions, so the
+// chains have no data dependency on each other and can run concurrently.
+void MaceRunParallel(const int num_branches,
+                     const int depth,
+                     const int num_parallel_ops,
+                     const std::vector<int64_t> &shape,
+                     const std::vector<int64_t> &filter_shape) {
+  std::vector<std::string> input_names;
+  std::vector<std::string> output_names;
+  for (int i = 0; i < num_branches; ++i) {
+    input_names.push_back(MakeString("input", i));
+    output_names.push_back(MakeString("output", i));
+  }
+  std::string filter_tensor_name = "filter";
+
+  std::shared_ptr<MultiNetDef> multi_net_def(new MultiNetDef());
+  NetDef *net_def = multi_net_def->add_net_def();
+
+  std::vector<float> data;
+  ops::test::GenerateRandomRealTypeData<float>(filter_shape, &data);
+  AddTensor<float>(filter_tensor_name, filter_shape, 0, data.size(), net_def);
+
+  for (size_t i = 0; i < input_names.size(); ++i) {
+    InputOutputInfo *info = net_def->add_input_info();
+    info->set_data_format(static_cast<int>(DataFormat::NHWC));
+    info->set_name(input_names[i]);
+    for (auto d : shape) {
+      info->add_dims(static_cast<int>(d));
+    }
+    multi_net_def->add_input_tensor(input_names[i]);
+  }
+  for (size_t i = 0; i < output_names.size(); ++i) {
+    InputOutputInfo *info = net_def->add_output_info();
+    info->set_name(output_names[i]);
+    multi_net_def->add_output_tensor(output_names[i]);
+  }
+  for (int d = 0; d < depth; ++d) {
+    for (int i = 0; i < num_branches; ++i) {
+      std::string input_name =
+          d == 0 ? input_names[i] : MakeString("branch", i, "_", d - 1);
+      std::string output_name =
+          d == depth - 1 ? output_names[i] : MakeString("branch", i, "_", d);
+      Conv3x3<float>(input_name, filter_tensor_name,
+                     output_name, shape, net_def);
+    }
+  }
+
+  MaceEngineConfig config;
+  EXPECT_EQ(config.SetCPUParallelOps(num_parallel_ops),
+            MaceStatus::MACE_SUCCESS);
+  SetProtoArg(net_def, "runtime_type", static_cast<int>(RT_CPU));
+
+  MaceEngine engine(config);
+  MaceStatus status = engine.Init(
+      multi_net_def.get(), input_names, output_names,
+      reinterpret_cast<unsigned char *>(data.data()),
+      data.size() * sizeof(float));
+  ASSERT_EQ(status, MaceStatus::MACE_SUCCESS);
+
+  std::map<std::string, mace::MaceTensor> inputs;
+  std::map<std::string, mace::MaceTensor> outputs;
+  for (int i = 0; i < 5; ++i) {
+    inputs.clear();
+    outputs.clear();
+    GenerateInputs(input_names, shape, &inputs);
+    GenerateOutputs(output_names, shape, &outputs);
+    EXPECT_EQ(engine.Run(inputs, &outputs), MaceStatus::MACE_SUCCESS);
+    CheckOutputs<RT_CPU, float>(*net_def, inputs, outputs, data);
+  }
+}
+
+}  // namespace
+
+TEST_F(MaceParallelAPITest, InvalidParallelOps) {
+  MaceEngineConfig config;
+  EXPECT_EQ(config.SetCPUParallelOps(0), MaceStatus::MACE_INVALID_ARGS);
+}
+
+TEST_F(MaceParallelAPITest, IndependentBranches) {
+  MaceRunParallel(2, 1, 2, {1, 32, 32, 16}, {16, 16, 3, 3});
+  MaceRunParallel(4, 3, 2, {1, 16, 16, 8}, {8, 8, 3, 3});
+  MaceRunParallel(3, 2, 4, {1, 16, 16, 8}, {8, 8, 3, 3});
+}
+
+TEST_F(MaceParallelAPITest, MoreLanesThanBranches) {
+  MaceRunParallel(1, 4, 4, {1, 16, 16, 8}, {8, 8, 3, 3});
+}
+
+}  // namespace test
+}  // namespace mace
@@ -0,0 +1,139 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <thread>  // NOLINT(build/c++11)
+
+#include "mace/core/proto/arg_helper.h"
+#include "mace/libmace/mace_api_test.h"
+
+namespace mace {
+namespace test {
+
+class MaceReplicaAPITest : public ::testing::Test {};
+
+namespace {
+
+const std::vector<int64_t> kShape = {1, 16, 16, 8};
+
+// A winograd 3x3 convolution followed by a gemm 1x1 convolution, both have
+// their filter prepacked.
+void BuildModel(MultiNetDef *multi_net_def, std::vector<float> *data) {
+  NetDef *net_def = multi_net_def->add_net_def();
+  const std::vector<int64_t> filter3x3_shape = {8, 8, 3, 3};
+  const std::vector<int64_t> filter1x1_shape = {8, 8, 1, 1};
+  std::vector<float> filter1x1;
+  ops::test::GenerateRandomRealTypeData<float>(filter3x3_shape, data);
+  ops::test::GenerateRandomRealTypeData<float>(filter1x1_shape, &filter1x1);
+  AddTensor<float>("filter3x3", filter3x3_shape, 0, data->size(), net_def);
+  AddTensor<float>("filter1x1", filter1x1_shape,
+                   data->size() * sizeof(float), filter1x1.size(), net_def);
+  data->insert(data->end(), filter1x1.begin(), filter1x1.end());
+
+  InputOutputInfo *input_info = net_def->add_input_info();
+  input_info->set_data_format(static_cast<int>(DataFormat::NHWC));
+  input_info->set_name("input");
+  for (auto d : kShape) {
+    input_info->add_dims(static_cast<int>(d));
+  }
+  multi_net_def->add_input_tensor("input");
+  net_def->add_output_info()->set_name("output");
+  multi_net_def->add_output_tensor("output");
+  Conv3x3<float>("input", "filter3x3", "conv", kShape, net_def);
+  Conv3x3<float>("conv", "filter1x1", "output", kShape, net_def);
+  SetProtoArg(net_def, "runtime_type", static_cast<int>(RT_CPU));
+}
+
+// Runs all the engines at the same time, each on its own inputs.
+void RunConcurrently(const std::vector<MaceEngine *> &engines,
+                     const MultiNetDef &multi_net_def,
+                     const std::vector<float> &data) {
+  const std::vector<std::string> input_names = {"input"};
+  const std::vector<std::string> output_names = {"output"};
+  const size_t engine_num = engines.size();
+  std::vector<std::map<std::string, MaceTensor>> inputs(engine_num);
+  std::vector<std::map<std::string, MaceTensor>> outputs(engine_num);
+  std::vector<MaceStatus> status(engine_num, MaceStatus::MACE_SUCCESS);
+  for (size_t i = 0; i < engine_num; ++i) {
+    GenerateInputs(input_names, kShape, &inputs[i]);
+    GenerateOutputs(output_names, kShape, &outputs[i]);
+  }
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < engine_num; ++i) {
+    threads.emplace_back([&, i]() {
+      for (int k = 0; k < 10 && status[i] == MaceStatus::MACE_SUCCESS; ++k) {
+        status[i] = engines[i]->Run(inputs[i], &outputs[i]);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  for (size_t i = 0; i < engine_num; ++i) {
+    ASSERT_EQ(status[i], MaceStatus::MACE_SUCCESS);
+    CheckOutputs<RT_CPU, float>(multi_net_def.net_def(0), inputs[i],
+                                outputs[i], data);
+  }
+}
+
+}  // namespace
+
+TEST_F(MaceReplicaAPITest, ConcurrentRuns) {
+  MultiNetDef multi_net_def;
+  std::vector<float> data;
+  BuildModel(&multi_net_def, &data);
+
+  MaceEngineConfig config;
+  MaceEngine engine(config);
+  ASSERT_EQ(engine.Init(&multi_net_def, {"input"}, {"output"},
+                        reinterpret_cast<unsigned char *>(data.data()),
+                        data.size() * sizeof(float)),
+            MaceStatus::MACE_SUCCESS);
+
+  std::vector<std::shared_ptr<MaceEngine>> replicas(3);
+  std::vector<MaceEngine *> engines = {&engine};
+  for (auto &replica : replicas) {
+    MaceEngineConfig replica_config;
+    ASSERT_EQ(engine.CreateReplica(replica_config, &replica),
+              MaceStatus::MACE_SUCCESS);
+    engines.push_back(replica.get());
+  }
+  RunConcurrently(engines, multi_net_def, data);
+}
+
+TEST_F(MaceReplicaAPITest, ReplicaOfReplica) {
+  MultiNetDef multi_net_def;
+  std::vector<float> data;
+  BuildModel(&multi_net_def, &data);
+
+  MaceEngineConfig config;
+  MaceEngine engine(config);
+  ASSERT_EQ(engine.Init(&multi_net_def, {"input"}, {"output"},
+                        reinterpret_cast<unsigned char *>(data.data()),
+                        data.size() * sizeof(float)),
+            MaceStatus::MACE_SUCCESS);
+
+  std::shared_ptr<MaceEngine> replica;
+  ASSERT_EQ(engine.CreateReplica(config, &replica), MaceStatus::MACE_SUCCESS);
+  std::shared_ptr<MaceEngine> second_replica;
+  ASSERT_EQ(replica->CreateReplica(config, &second_replica),
+            MaceStatus::MACE_SUCCESS);
+  EXPECT_EQ(engine.CreateReplica(config, nullptr),
+            MaceStatus::MACE_INVALID_ARGS);
+  RunConcurrently({replica.get(), second_replica.get()}, multi_net_def, data);
+}
+
+}  // namespace test
+}  // namespace mace
@@ -0,0 +1,152 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/core/proto/arg_helper.h"
+#include "mace/libmace/mace_api_test.h"
+
+namespace mace {
+namespace test {
+
+class MaceShapePlanAPITest : public ::testing::Test {};
+
+namespace {
+
+// Runs `num_branches` chains of `depth` convolutions with the input shapes
+// of `shapes` one after another, `rounds` times.
+void MaceRunShapes(const int num_branches,
+                   const int depth,
+                   const int num_parallel_ops,
+                   const int cache_size,
+                   const std::vector<std::vector<int64_t>> &shapes,
+                   const int rounds,
+                   ShapePlanStats *stats) {
+  const int64_t channels = shapes[0][3];
+  const std::vector<int64_t> filter_shape = {channels, channels, 3, 3};
+  std::vector<std::string> input_names;
+  std::vector<std::string> output_names;
+  for (int i = 0; i < num_branches; ++i) {
+    input_names.push_back(MakeString("input", i));
+    output_names.push_back(MakeString("output", i));
+  }
+  std::string filter_tensor_name = "filter";
+
+  std::shared_ptr<MultiNetDef> multi_net_def(new MultiNetDef());
+  NetDef *net_def = multi_net_def->add_net_def();
+
+  std::vector<float> data;
+  ops::test::GenerateRandomRealTypeData<float>(filter_shape, &data);
+  AddTensor<float>(filter_tensor_name, filter_shape, 0, data.size(), net_def);
+
+  for (size_t i = 0; i < input_names.size(); ++i) {
+    InputOutputInfo *info = net_def->add_input_info();
+    info->set_data_format(static_cast<int>(DataFormat::NHWC));
+    info->set_name(input_names[i]);
+    for (auto d : shapes[0]) {
+      info->add_dims(static_cast<int>(d));
+    }
+    multi_net_def->add_input_tensor(input_names[i]);
+  }
+  for (size_t i = 0; i < output_names.size(); ++i) {
+    InputOutputInfo *info = net_def->add_output_info();
+    info->set_name(output_names[i]);
+    multi_net_def->add_output_tensor(output_names[i]);
+  }
+  for (int d = 0; d < depth; ++d) {
+    for (int i = 0; i < num_branches; ++i) {
+      std::string input_name =
+          d == 0 ? input_names[i] : MakeString("branch", i, "_", d - 1);
+      std::string output_name =
+          d == depth - 1 ? output_names[i] : MakeString("branch", i, "_", d);
+      Conv3x3<float>(input_name, filter_tensor_name,
+                     output_name, shapes[0], net_def);
+    }
+  }
+
+  MaceEngineConfig config;
+  EXPECT_EQ(config.SetCPUParallelOps(num_parallel_ops),
+            MaceStatus::MACE_SUCCESS);
+  EXPECT_EQ(config.SetShapePlanCacheSize(cache_size),
+            MaceStatus::MACE_SUCCESS);
+  SetProtoArg(net_def, "runtime_type", static_cast<int>(RT_CPU));
+
+  MaceEngine engine(config);
+  MaceStatus status = engine.Init(
+      multi_net_def.get(), input_names, output_names,
+      reinterpret_cast<unsigned char *>(data.data()),
+      data.size() * sizeof(float));
+  ASSERT_EQ(status, MaceStatus::MACE_SUCCESS);
+
+  std::map<std::string, mace::MaceTensor> inputs;
+  std::map<std::string, mace::MaceTensor> outputs;
+  for (int r = 0; r < rounds; ++r) {
+    for (auto &shape : shapes) {
+      inputs.clear();
+      outputs.clear();
+      GenerateInputs(input_names, shape, &inputs);
+      GenerateOutputs(output_names, shape, &outputs);
+      EXPECT_EQ(engine.Run(inputs, &outputs), MaceStatus::MACE_SUCCESS);
+      CheckOutputs<RT_CPU, float>(*net_def, inputs, outputs, data);
+    }
+  }
+  EXPECT_EQ(engine.GetShapePlanStats(nullptr), MaceStatus::MACE_INVALID_ARGS);
+  EXPECT_EQ(engine.GetShapePlanStats(stats), MaceStatus::MACE_SUCCESS);
+}
+
+const std::vector<std::vector<int64_t>> kShapes = {
+    {1, 16, 16, 8}, {1, 24, 24, 8}, {1, 8, 8, 8}};
+
+}  // namespace
+
+TEST_F(MaceShapePlanAPITest, InvalidCacheSize) {
+  MaceEngineConfig config;
+  EXPECT_EQ(config.SetShapePlanCacheSize(-1), MaceStatus::MACE_INVALID_ARGS);
+  EXPECT_EQ(config.SetShapePlanCacheSize(0), MaceStatus::MACE_SUCCESS);
+}
+
+TEST_F(MaceShapePlanAPITest, CachedPlans) {
+  // The plan of the first shapes is made at init, the others by their
+  // first runs.
+  ShapePlanStats stats;
+  MaceRunShapes(1, 3, 1, 4, kShapes, 3, &stats);
+  EXPECT_EQ(stats.hits, 7);
+  EXPECT_EQ(stats.misses, 2);
+  EXPECT_EQ(stats.evictions, 0);
+}
+
+TEST_F(MaceShapePlanAPITest, EvictedPlans) {
+  ShapePlanStats stats;
+  MaceRunShapes(1, 3, 1, 1, kShapes, 2, &stats);
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 5);
+  EXPECT_EQ(stats.evictions, 5);
+}
+
+TEST_F(MaceShapePlanAPITest, Disabled) {
+  ShapePlanStats stats;
+  MaceRunShapes(1, 3, 1, 0, kShapes, 2, &stats);
+  EXPECT_EQ(stats.hits, 0);
+  EXPECT_EQ(stats.misses, 0);
+  EXPECT_EQ(stats.evictions, 0);
+}
+
+TEST_F(MaceShapePlanAPITest, ParallelOps) {
+  ShapePlanStats stats;
+  MaceRunShapes(3, 2, 2, 4, kShapes, 3, &stats);
+  EXPECT_EQ(stats.hits, 7);
+  EXPECT_EQ(stats.misses, 2);
+  EXPECT_EQ(stats.evictions, 0);
+}
+
+}  // namespace test
+}  // namespace mace
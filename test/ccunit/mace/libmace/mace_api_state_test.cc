@@ -0,0 +1,203 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/core/proto/arg_helper.h"
+#include "mace/libmace/mace_api_test.h"
+#include "mace/ops/eltwise.h"
+
+namespace mace {
+namespace test {
+
+class MaceStateAPITest : public ::testing::Test {};
+
+namespace {
+
+const std::vector<int64_t> kEntryShape = {1, 1, 2};
+const int kCapacity = 4;
+
+// cache = the entries of all the runs so far,
+// mean = the mean of the cached entries, which Attention gives for a zero
+// query, all the entries scoring the same.
+void BuildModel(MultiNetDef *multi_net_def) {
+  NetDef *net_def = multi_net_def->add_net_def();
+  InputOutputInfo *input_info = net_def->add_input_info();
+  input_info->set_data_format(static_cast<int>(DataFormat::NONE));
+  input_info->set_name("entry");
+  for (auto d : kEntryShape) {
+    input_info->add_dims(static_cast<int>(d));
+  }
+  multi_net_def->add_input_tensor("entry");
+  net_def->add_output_info()->set_name("mean");
+  multi_net_def->add_output_tensor("mean");
+
+  OperatorDef operator_def;
+  ops::test::OpDefBuilder("KVCacheAppend", "cache")
+      .Input("entry")
+      .Output("cache")
+      .AddIntArg("axis", 1)
+      .AddIntArg("capacity", kCapacity)
+      .AddIntArg("T", static_cast<int>(DataType::DT_FLOAT))
+      .Finalize(&operator_def);
+  net_def->add_op()->CopyFrom(operator_def);
+  ops::test::OpDefBuilder("Eltwise", "query")
+      .Input("entry")
+      .Output("query")
+      .AddIntArg("type", static_cast<int>(ops::EltwiseType::PROD))
+      .AddFloatArg("scalar_input", 0.f)
+      .AddIntArg("T", static_cast<int>(DataType::DT_FLOAT))
+      .Finalize(&operator_def);
+  net_def->add_op()->CopyFrom(operator_def);
+  ops::test::OpDefBuilder("Attention", "mean")
+      .Input("query")
+      .Input("cache")
+      .Input("cache")
+      .Output("mean")
+      .AddIntArg("transpose_k", 1)
+      .AddIntArg("T", static_cast<int>(DataType::DT_FLOAT))
+      .Finalize(&operator_def);
+  net_def->add_op()->CopyFrom(operator_def);
+  SetProtoArg(net_def, "runtime_type", static_cast<int>(RT_CPU));
+}
+
+MaceTensor MakeTensor(const std::vector<int64_t> &shape,
+                      const std::vector<float> &values) {
+  std::shared_ptr<float> data(new float[values.size()],
+                              std::default_delete<float[]>());
+  std::copy(values.begin(), values.end(), data.get());
+  return MaceTensor(shape, data, DataFormat::NONE);
+}
+
+std::vector<float> ToVector(const MaceTensor &tensor) {
+  const int64_t size = std::accumulate(tensor.shape().begin(),
+                                       tensor.shape().end(), 1,
+                                       std::multiplies<int64_t>());
+  return std::vector<float>(tensor.data().get(), tensor.data().get() + size);
+}
+
+// Appends `entry` to the cache and returns the mean of the cached entries.
+MaceStatus Append(MaceEngine *engine, const std::vector<float> &entry,
+                  std::vector<float> *mean) {
+  std::map<std::string, MaceTensor> inputs = {
+      {"entry", MakeTensor(kEntryShape, entry)}};
+  std::map<std::string, MaceTensor> outputs = {
+      {"mean", MakeTensor(kEntryShape, std::vector<float>(2))}};
+  MaceStatus status = engine->Run(inputs, &outputs);
+  *mean = ToVector(outputs.at("mean"));
+  return status;
+}
+
+void ExpectNear(const std::vector<float> &expected,
+                const std::vector<float> &actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_NEAR(expected[i], actual[i], 1e-5);
+  }
+}
+
+void InitEngine(const MultiNetDef &multi_net_def, MaceEngine *engine) {
+  ASSERT_EQ(engine->Init(&multi_net_def, {"entry"}, {"mean"}, nullptr, 0),
+            MaceStatus::MACE_SUCCESS);
+}
+
+}  // namespace
+
+TEST_F(MaceStateAPITest, KeepsStatesBetweenRuns) {
+  MultiNetDef multi_net_def;
+  BuildModel(&multi_net_def);
+  MaceEngineConfig config;
+  MaceEngine engine(config);
+  InitEngine(multi_net_def, &engine);
+  std::vector<float> mean;
+
+  ASSERT_EQ(Append(&engine, {1, 2}, &mean), MaceStatus::MACE_SUCCESS);
+  ExpectNear(std::vector<float>({1, 2}), mean);
+  ASSERT_EQ(Append(&engine, {3, 4}, &mean), MaceStatus::MACE_SUCCESS);
+  ExpectNear(std::vector<float>({2, 3}), mean);
+
+  // the states are not intermediate buffers
+  ASSERT_EQ(engine.ReleaseIntermediateBuffer(), MaceStatus::MACE_SUCCESS);
+  ASSERT_EQ(Append(&engine, {5, 6}, &mean), MaceStatus::MACE_SUCCESS);
+  ExpectNear(std::vector<float>({3, 4}), mean);
+
+  std::map<std::string, MaceTensor> states;
+  ASSERT_EQ(engine.SnapshotStates(&states), MaceStatus::MACE_SUCCESS);
+  ASSERT_EQ(states.size(), 1u);
+  EXPECT_EQ(states.at("cache").shape(), std::vector<int64_t>({1, 3, 2}));
+  EXPECT_EQ(ToVector(states.at("cache")),
+            std::vector<float>({1, 2, 3, 4, 5, 6}));
+
+  ASSERT_EQ(Append(&engine, {7, 8}, &mean), MaceStatus::MACE_SUCCESS);
+  ExpectNear(std::vector<float>({4, 5}), mean);
+  // the cache is full
+  EXPECT_NE(Append(&engine, {9, 10}, &mean), MaceStatus::MACE_SUCCESS);
+
+  // continue from the snapshot
+  ASSERT_EQ(engine.RestoreStates(states), MaceStatus::MACE_SUCCESS);
+  ASSERT_EQ(Append(&engine, {10, 20}, &mean), MaceStatus::MACE_SUCCESS);
+  ExpectNear(std::vector<float>({4.75, 8}), mean);
+
+  // a new sequence starts from scratch
+  ASSERT_EQ(engine.ResetStates(), MaceStatus::MACE_SUCCESS);
+  ASSERT_EQ(Append(&engine, {1, 1}, &mean), MaceStatus::MACE_SUCCESS);
+  ExpectNear(std::vector<float>({1, 1}), mean);
+}
+
+TEST_F(MaceStateAPITest, ForksToReplica) {
+  MultiNetDef multi_net_def;
+  BuildModel(&multi_net_def);
+  MaceEngineConfig config;
+  MaceEngine engine(config);
+  InitEngine(multi_net_def, &engine);
+  std::vector<float> mean;
+  ASSERT_EQ(Append(&engine, {1, 2}, &mean), MaceStatus::MACE_SUCCESS);
+
+  std::shared_ptr<MaceEngine> replica;
+  ASSERT_EQ(engine.CreateReplica(config, &replica), MaceStatus::MACE_SUCCESS);
+  std::map<std::string, MaceTensor> states;
+  ASSERT_EQ(engine.SnapshotStates(&states), MaceStatus::MACE_SUCCESS);
+  ASSERT_EQ(replica->RestoreStates(states), MaceStatus::MACE_SUCCESS);
+
+  // the sequences go on apart
+  ASSERT_EQ(Append(&engine, {10, 10}, &mean), MaceStatus::MACE_SUCCESS);
+  ExpectNear(std::vector<float>({5.5, 6}), mean);
+  ASSERT_EQ(Append(replica.get(), {20, 20}, &mean),
+            MaceStatus::MACE_SUCCESS);
+  ExpectNear(std::vector<float>({10.5, 11}), mean);
+  ASSERT_EQ(Append(&engine, {100, 99}, &mean), MaceStatus::MACE_SUCCESS);
+  ExpectNear(std::vector<float>({37, 37}), mean);
+}
+
+TEST_F(MaceStateAPITest, InvalidArgs) {
+  MultiNetDef multi_net_def;
+  BuildModel(&multi_net_def);
+  MaceEngineConfig config;
+  MaceEngine engine(config);
+  InitEngine(multi_net_def, &engine);
+
+  EXPECT_EQ(engine.SnapshotStates(nullptr), MaceStatus::MACE_INVALID_ARGS);
+  std::map<std::string, MaceTensor> states = {
+      {"missing", MakeTensor(kEntryShape, {1, 2})}};
+  EXPECT_EQ(engine.RestoreStates(states), MaceStatus::MACE_INVALID_ARGS);
+  states = {{"cache", MakeTensor({1, kCapacity + 1, 2},
+                                 std::vector<float>(2 * kCapacity + 2))}};
+  EXPECT_EQ(engine.RestoreStates(states), MaceStatus::MACE_INVALID_ARGS);
+  std::shared_ptr<int32_t> data(new int32_t[2](),
+                                std::default_delete<int32_t[]>());
+  states = {{"cache", MaceTensor(kEntryShape, data, DataFormat::NONE,
+                                 IDT_INT32)}};
+  EXPECT_EQ(engine.RestoreStates(states), MaceStatus::MACE_INVALID_ARGS);
+}
+
+}  // namespace test
+}  // namespace mace
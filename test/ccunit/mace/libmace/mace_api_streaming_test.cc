@@ -0,0 +1,197 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/core/proto/arg_helper.h"
+#include "mace/libmace/mace_api_test.h"
+#include "mace/ops/eltwise.h"
+
+namespace mace {
+namespace test {
+
+class MaceStreamingAPITest : public ::testing::Test {};
+
+namespace {
+
+// chunk of the model input, the first frame is kept from the previous chunk
+const std::vector<int64_t> kInputShape = {1, 4, 2};
+const std::vector<int64_t> kChunkShape = {1, 3, 2};
+const std::vector<int64_t> kFrameShape = {1, 1, 2};
+
+void AddInputInfo(const std::string &name,
+                  const std::vector<int64_t> &shape,
+                  MultiNetDef *multi_net_def) {
+  NetDef *net_def = multi_net_def->mutable_net_def(0);
+  InputOutputInfo *input_info = net_def->add_input_info();
+  input_info->set_data_format(static_cast<int>(DataFormat::NONE));
+  input_info->set_name(name);
+  for (auto d : shape) {
+    input_info->add_dims(static_cast<int>(d));
+  }
+  multi_net_def->add_input_tensor(name);
+}
+
+void Splice(const std::string &input_name,
+            const std::string &output_name,
+            const std::vector<int> &forward_indexes,
+            NetDef *net_def) {
+  OperatorDef operator_def;
+  ops::test::OpDefBuilder("Splice", output_name)
+      .Input(input_name)
+      .Output(output_name)
+      .AddIntsArg("context", {0})
+      .AddIntsArg("forward_indexes", forward_indexes)
+      .AddIntArg("T", static_cast<int>(DataType::DT_FLOAT))
+      .Finalize(&operator_def);
+  net_def->add_op()->CopyFrom(operator_def);
+}
+
+// window = the input with its context frame,
+// last = the last frame, fed back to the state input "prev",
+// sum = prev + last.
+void BuildModel(MultiNetDef *multi_net_def) {
+  NetDef *net_def = multi_net_def->add_net_def();
+  AddInputInfo("input", kInputShape, multi_net_def);
+  AddInputInfo("prev", kFrameShape, multi_net_def);
+  for (auto name : {"window", "last", "sum"}) {
+    net_def->add_output_info()->set_name(name);
+    multi_net_def->add_output_tensor(name);
+  }
+
+  Splice("input", "window", {0, 1, 2, 3}, net_def);
+  Splice("input", "last", {3}, net_def);
+  OperatorDef operator_def;
+  ops::test::OpDefBuilder("Eltwise", "sum")
+      .Input("prev")
+      .Input("last")
+      .Output("sum")
+      .AddIntArg("type", static_cast<int>(ops::EltwiseType::SUM))
+      .AddIntArg("T", static_cast<int>(DataType::DT_FLOAT))
+      .Finalize(&operator_def);
+  net_def->add_op()->CopyFrom(operator_def);
+  SetProtoArg(net_def, "runtime_type", static_cast<int>(RT_CPU));
+}
+
+MaceTensor MakeTensor(const std::vector<int64_t> &shape,
+                      const std::vector<float> &values) {
+  std::shared_ptr<float> data(new float[values.size()],
+                              std::default_delete<float[]>());
+  std::copy(values.begin(), values.end(), data.get());
+  return MaceTensor(shape, data, DataFormat::NONE);
+}
+
+std::vector<float> ToVector(const MaceTensor &tensor) {
+  const int64_t size = std::accumulate(tensor.shape().begin(),
+                                       tensor.shape().end(), 1,
+                                       std::multiplies<int64_t>());
+  return std::vector<float>(tensor.data().get(), tensor.data().get() + size);
+}
+
+class Streamer {
+ public:
+  explicit Streamer(MaceStreamingSession *session) : session_(session) {}
+
+  // Feeds one chunk of new frames and returns the window and sum outputs.
+  void Run(const std::vector<float> &frames,
+           std::vector<float> *window,
+           std::vector<float> *sum) {
+    std::map<std::string, MaceTensor> inputs = {
+        {"input", MakeTensor(kChunkShape, frames)}};
+    std::map<std::string, MaceTensor> outputs = {
+        {"window", MakeTensor(kInputShape, std::vector<float>(8))},
+        {"sum", MakeTensor(kFrameShape, std::vector<float>(2))}};
+    ASSERT_EQ(session_->Run(inputs, &outputs), MaceStatus::MACE_SUCCESS);
+    *window = ToVector(outputs.at("window"));
+    *sum = ToVector(outputs.at("sum"));
+  }
+
+ private:
+  MaceStreamingSession *session_;
+};
+
+}  // namespace
+
+TEST_F(MaceStreamingAPITest, CarriesStateAndContext) {
+  MultiNetDef multi_net_def;
+  BuildModel(&multi_net_def);
+  MaceEngineConfig config;
+  MaceEngine engine(config);
+  ASSERT_EQ(engine.Init(&multi_net_def, {"input", "prev"},
+                        {"window", "last", "sum"}, nullptr, 0),
+            MaceStatus::MACE_SUCCESS);
+
+  MaceStreamingSession session;
+  ASSERT_EQ(session.Init(&engine, {{"last", "prev"}}, {{"input", 1}}),
+            MaceStatus::MACE_SUCCESS);
+  Streamer streamer(&session);
+  const std::vector<float> chunk0 = {1, 2, 3, 4, 5, 6};
+  const std::vector<float> chunk1 = {7, 8, 9, 10, 11, 12};
+  std::vector<float> window, sum;
+
+  // the first frame is repeated as the context of the first chunk
+  streamer.Run(chunk0, &window, &sum);
+  EXPECT_EQ(window, std::vector<float>({1, 2, 1, 2, 3, 4, 5, 6}));
+  EXPECT_EQ(sum, std::vector<float>({5, 6}));
+
+  std::map<std::string, MaceTensor> snapshot;
+  ASSERT_EQ(session.Snapshot(&snapshot), MaceStatus::MACE_SUCCESS);
+  EXPECT_EQ(ToVector(snapshot.at("prev")), std::vector<float>({5, 6}));
+  EXPECT_EQ(ToVector(snapshot.at("input")), std::vector<float>({5, 6}));
+
+  streamer.Run(chunk1, &window, &sum);
+  EXPECT_EQ(window, std::vector<float>({5, 6, 7, 8, 9, 10, 11, 12}));
+  EXPECT_EQ(sum, std::vector<float>({16, 18}));
+
+  // replay the second chunk from the snapshot
+  ASSERT_EQ(session.Restore(snapshot), MaceStatus::MACE_SUCCESS);
+  streamer.Run(chunk1, &window, &sum);
+  EXPECT_EQ(window, std::vector<float>({5, 6, 7, 8, 9, 10, 11, 12}));
+  EXPECT_EQ(sum, std::vector<float>({16, 18}));
+
+  // a new stream starts from scratch
+  session.Reset();
+  streamer.Run(chunk0, &window, &sum);
+  EXPECT_EQ(window, std::vector<float>({1, 2, 1, 2, 3, 4, 5, 6}));
+  EXPECT_EQ(sum, std::vector<float>({5, 6}));
+}
+
+TEST_F(MaceStreamingAPITest, InvalidArgs) {
+  MultiNetDef multi_net_def;
+  BuildModel(&multi_net_def);
+  MaceEngineConfig config;
+  MaceEngine engine(config);
+  ASSERT_EQ(engine.Init(&multi_net_def, {"input", "prev"},
+                        {"window", "last", "sum"}, nullptr, 0),
+            MaceStatus::MACE_SUCCESS);
+
+  MaceStreamingSession session;
+  EXPECT_EQ(session.Init(nullptr, {}), MaceStatus::MACE_INVALID_ARGS);
+  EXPECT_EQ(session.Init(&engine, {{"last", "missing"}}),
+            MaceStatus::MACE_INVALID_ARGS);
+  EXPECT_EQ(session.Init(&engine, {{"last", "prev"}}, {{"input", 4}}),
+            MaceStatus::MACE_INVALID_ARGS);
+  ASSERT_EQ(session.Init(&engine, {{"last", "prev"}}, {{"input", 1}}),
+            MaceStatus::MACE_SUCCESS);
+
+  // the chunk should exclude the context frame
+  std::map<std::string, MaceTensor> inputs = {
+      {"input", MakeTensor(kInputShape, std::vector<float>(8))}};
+  std::map<std::string, MaceTensor> outputs;
+  EXPECT_EQ(session.Run(inputs, &outputs), MaceStatus::MACE_INVALID_ARGS);
+  std::map<std::string, MaceTensor> snapshot = {
+      {"prev", MakeTensor(kChunkShape, std::vector<float>(6))}};
+  EXPECT_EQ(session.Restore(snapshot), MaceStatus::MACE_INVALID_ARGS);
+}
+
+}  // namespace test
+}  // namespace mace
@@ -130,7 +130,8 @@ void CheckOutputs(const NetDef &net_def,
                                               std::multiplies<int64_t>());
     std::vector<T> data(data_size);
     memcpy(data.data(),
-           reinterpret_cast<const T *>(tensor_data.data()) + tensor.offset(),
+           reinterpret_cast<const unsigned char *>(tensor_data.data()) +
+               tensor.offset(),
            tensor.data_size() * sizeof(T));
     net.AddInputFromArray<D, T>(tensor.name(), shape, data, true);
   }
@@ -0,0 +1,112 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "mace/core/proto/arg_helper.h"
+#include "mace/libmace/mace_api_test.h"
+
+namespace mace {
+namespace test {
+
+class MaceTracingAPITest : public ::testing::Test {};
+
+namespace {
+
+const char kTraceFile[] = "mace_api_tracing_test.json";
+
+// Runs a chain of `depth` convolutions `rounds` times, tracing the runs.
+std::string TraceRuns(const int depth, const int rounds) {
+  const std::vector<int64_t> shape = {1, 16, 16, 8};
+  const std::vector<int64_t> filter_shape = {8, 8, 3, 3};
+  const std::vector<std::string> input_names = {"input"};
+  const std::vector<std::string> output_names = {"output"};
+
+  std::shared_ptr<MultiNetDef> multi_net_def(new MultiNetDef());
+  NetDef *net_def = multi_net_def->add_net_def();
+
+  std::vector<float> data;
+  ops::test::GenerateRandomRealTypeData<float>(filter_shape, &data);
+  AddTensor<float>("filter", filter_shape, 0, data.size(), net_def);
+
+  InputOutputInfo *input_info = net_def->add_input_info();
+  input_info->set_data_format(static_cast<int>(DataFormat::NHWC));
+  input_info->set_name(input_names[0]);
+  for (auto d : shape) {
+    input_info->add_dims(static_cast<int>(d));
+  }
+  multi_net_def->add_input_tensor(input_names[0]);
+  net_def->add_output_info()->set_name(output_names[0]);
+  multi_net_def->add_output_tensor(output_names[0]);
+  for (int d = 0; d < depth; ++d) {
+    std::string input_name = d == 0 ? input_names[0] : MakeString("conv", d);
+    std::string output_name =
+        d == depth - 1 ? output_names[0] : MakeString("conv", d + 1);
+    Conv3x3<float>(input_name, "filter", output_name, shape, net_def);
+  }
+
+  MaceEngineConfig config;
+  SetProtoArg(net_def, "runtime_type", static_cast<int>(RT_CPU));
+  MaceEngine engine(config);
+  EXPECT_EQ(engine.Init(multi_net_def.get(), input_names, output_names,
+                        reinterpret_cast<unsigned char *>(data.data()),
+                        data.size() * sizeof(float)),
+            MaceStatus::MACE_SUCCESS);
+
+  std::map<std::string, mace::MaceTensor> inputs;
+  std::map<std::string, mace::MaceTensor> outputs;
+  GenerateInputs(input_names, shape, &inputs);
+  GenerateOutputs(output_names, shape, &outputs);
+  StartTracing();
+  for (int r = 0; r < rounds; ++r) {
+    EXPECT_EQ(engine.Run(inputs, &outputs), MaceStatus::MACE_SUCCESS);
+  }
+  EXPECT_EQ(StopTracing(kTraceFile), MaceStatus::MACE_SUCCESS);
+  CheckOutputs<RT_CPU, float>(*net_def, inputs, outputs, data);
+
+  std::ifstream in(kTraceFile);
+  std::stringstream trace;
+  trace << in.rdbuf();
+  remove(kTraceFile);
+  return trace.str();
+}
+
+int CountOf(const std::string &text, const std::string &pattern) {
+  int count = 0;
+  for (size_t pos = text.find(pattern); pos != std::string::npos;
+       pos = text.find(pattern, pos + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+}  // namespace
+
+TEST_F(MaceTracingAPITest, OpSpans) {
+  const std::string trace = TraceRuns(3, 2);
+  EXPECT_EQ(trace.compare(0, 1, "{"), 0);
+  EXPECT_EQ(CountOf(trace, "\"cat\":\"op\""), 6);
+  EXPECT_EQ(CountOf(trace, "\"type\":\"Conv2D\""), 6);
+  EXPECT_EQ(CountOf(trace, "\"name\":\"Conv2dOp\""), 6);
+}
+
+TEST_F(MaceTracingAPITest, InvalidFile) {
+  StartTracing();
+  EXPECT_NE(StopTracing("no_such_dir/trace.json"), MaceStatus::MACE_SUCCESS);
+}
+
+}  // namespace test
+}  // namespace mace
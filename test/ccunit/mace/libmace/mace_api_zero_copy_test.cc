@@ -0,0 +1,142 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+
+#include "mace/core/memory/allocator.h"
+#include "mace/core/proto/arg_helper.h"
+#include "mace/libmace/mace_api_test.h"
+#include "mace/port/env.h"
+
+namespace mace {
+namespace test {
+
+class MaceZeroCopyAPITest : public ::testing::Test {};
+
+namespace {
+
+// `offset` floats past an aligned address, to check misaligned buffers.
+std::shared_ptr<float> AlignedBuffer(const int64_t size, const int offset) {
+  void *ptr = nullptr;
+  MACE_CHECK_SUCCESS(Memalign(&ptr, kMaceAlignment,
+                              (size + offset) * sizeof(float)));
+  return std::shared_ptr<float>(static_cast<float *>(ptr) + offset,
+                                [ptr](float *) { free(ptr); });
+}
+
+MaceTensor CreateMaceTensor(const std::vector<int64_t> &shape,
+                            const DataFormat data_format,
+                            const int offset) {
+  const int64_t size = std::accumulate(shape.begin(), shape.end(), 1,
+                                       std::multiplies<int64_t>());
+  std::shared_ptr<float> data = AlignedBuffer(size, offset);
+  std::memset(data.get(), 0, size * sizeof(float));
+  return MaceTensor(shape, data, data_format);
+}
+
+std::shared_ptr<MaceEngine> CreateEngine(const MultiNetDef &multi_net_def,
+                                         const std::vector<float> &data,
+                                         const bool zero_copy) {
+  MaceEngineConfig config;
+  EXPECT_EQ(config.SetZeroCopyIO(zero_copy), MaceStatus::MACE_SUCCESS);
+  auto engine = std::make_shared<MaceEngine>(config);
+  std::vector<std::string> input_names(multi_net_def.input_tensor().begin(),
+                                       multi_net_def.input_tensor().end());
+  std::vector<std::string> output_names(
+      multi_net_def.output_tensor().begin(),
+      multi_net_def.output_tensor().end());
+  MaceStatus status = engine->Init(
+      &multi_net_def, input_names, output_names,
+      reinterpret_cast<const unsigned char *>(data.data()),
+      data.size() * sizeof(float));
+  EXPECT_EQ(status, MaceStatus::MACE_SUCCESS);
+  return engine;
+}
+
+// Runs two convolutions with and without zero-copy I/O on the same inputs.
+void MaceRunZeroCopy(const DataFormat data_format, const int offset) {
+  const std::vector<int64_t> nhwc_shape = {1, 16, 16, 8};
+  const std::vector<int64_t> filter_shape = {8, 8, 3, 3};
+  std::vector<int64_t> shape = nhwc_shape;
+  if (data_format == DataFormat::NCHW) {
+    shape = {nhwc_shape[0], nhwc_shape[3], nhwc_shape[1], nhwc_shape[2]};
+  }
+
+  std::shared_ptr<MultiNetDef> multi_net_def(new MultiNetDef());
+  NetDef *net_def = multi_net_def->add_net_def();
+  std::vector<float> data;
+  ops::test::GenerateRandomRealTypeData<float>(filter_shape, &data);
+  AddTensor<float>("filter", filter_shape, 0, data.size(), net_def);
+  InputOutputInfo *input_info = net_def->add_input_info();
+  input_info->set_data_format(static_cast<int>(DataFormat::NHWC));
+  input_info->set_name("input");
+  for (auto d : nhwc_shape) {
+    input_info->add_dims(static_cast<int>(d));
+  }
+  multi_net_def->add_input_tensor("input");
+  net_def->add_output_info()->set_name("output");
+  multi_net_def->add_output_tensor("output");
+  Conv3x3<float>("input", "filter", "conv", nhwc_shape, net_def);
+  Conv3x3<float>("conv", "filter", "output", nhwc_shape, net_def);
+  SetProtoArg(net_def, "runtime_type", static_cast<int>(RT_CPU));
+
+  auto engine = CreateEngine(*multi_net_def, data, false);
+  auto zero_copy_engine = CreateEngine(*multi_net_def, data, true);
+
+  for (int i = 0; i < 3; ++i) {
+    MaceTensor input = CreateMaceTensor(shape, data_format, offset);
+    const int64_t input_size = std::accumulate(
+        shape.begin(), shape.end(), 1, std::multiplies<int64_t>());
+    std::vector<float> input_data;
+    ops::test::GenerateRandomRealTypeData<float>(shape, &input_data);
+    std::memcpy(input.data<float>().get(), input_data.data(),
+                input_size * sizeof(float));
+
+    std::map<std::string, MaceTensor> inputs = {{"input", input}};
+    std::map<std::string, MaceTensor> outputs = {
+        {"output", CreateMaceTensor(shape, data_format, 0)}};
+    std::map<std::string, MaceTensor> zero_copy_outputs = {
+        {"output", CreateMaceTensor(shape, data_format, offset)}};
+    ASSERT_EQ(engine->Run(inputs, &outputs), MaceStatus::MACE_SUCCESS);
+    ASSERT_EQ(zero_copy_engine->Run(inputs, &zero_copy_outputs),
+              MaceStatus::MACE_SUCCESS);
+
+    // the input is not modified
+    EXPECT_EQ(0, std::memcmp(input.data<float>().get(), input_data.data(),
+                             input_size * sizeof(float)));
+    const MaceTensor &output = outputs.at("output");
+    const MaceTensor &zero_copy_output = zero_copy_outputs.at("output");
+    ASSERT_EQ(output.shape(), zero_copy_output.shape());
+    for (int64_t j = 0; j < input_size; ++j) {
+      EXPECT_NEAR(output.data<float>().get()[j],
+                  zero_copy_output.data<float>().get()[j], 1e-5) << j;
+    }
+  }
+}
+
+}  // namespace
+
+TEST_F(MaceZeroCopyAPITest, BindBuffers) {
+  MaceRunZeroCopy(DataFormat::NCHW, 0);
+}
+
+TEST_F(MaceZeroCopyAPITest, FallbackToCopy) {
+  // needs a transpose
+  MaceRunZeroCopy(DataFormat::NHWC, 0);
+  // misaligned
+  MaceRunZeroCopy(DataFormat::NCHW, 1);
+}
+
+}  // namespace test
+}  // namespace mace
@@ -56,7 +56,7 @@ void TestGemvFloat32(const index_t batch,
   std::unique_ptr<delegator::Gemv> gemv = delegator::Gemv::Create(
       context.workspace(),
       MACE_DELEGATOR_KEY(Gemv, RuntimeType::RT_CPU, float, ImplType::NEON),
-      DelegatorParam());
+      delegator::GemvParam());
   gemv->Compute(&context,
                 &lhs,
                 &rhs,
@@ -72,7 +72,7 @@ void TestGemvFloat32(const index_t batch,
   expected_output.Resize({batch, height});
   std::unique_ptr<delegator::Gemv> gemv_ref = delegator::Gemv::Create(
       context.workspace(), MACE_DELEGATOR_KEY(
-      Gemv, RuntimeType::RT_CPU, float, ImplType::REF), DelegatorParam());
+      Gemv, RuntimeType::RT_CPU, float, ImplType::REF), delegator::GemvParam());
   gemv_ref->Compute(&context,
                     &lhs,
                     &rhs,
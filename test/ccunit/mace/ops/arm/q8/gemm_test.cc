@@ -0,0 +1,115 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+
+#include "mace/core/ops/op_context.h"
+#include "mace/core/tensor.h"
+#include "mace/ops/delegator/gemm.h"
+#include "mace/ops/ops_test_util.h"
+#include "mace/ops/testing/test_utils.h"
+
+namespace mace {
+namespace ops {
+namespace test {
+
+// Without the dot product instructions the NEON key resolves to the
+// portable gemm, with them the dot product kernel is checked against it.
+template<typename OUTPUT_TYPE>
+void TestGemmQ8(const index_t batch,
+                const index_t rows,
+                const index_t cols,
+                const index_t depth,
+                const MatrixMajor lhs_major,
+                const MatrixMajor rhs_major,
+                const MatrixMajor output_major,
+                const bool lhs_batched,
+                const bool rhs_batched) {
+  auto *cpu_runtime = OpTestContext::Get()->GetRuntime(RuntimeType::RT_CPU);
+  Tensor lhs(cpu_runtime, DataType::DT_UINT8);
+  Tensor rhs(cpu_runtime, DataType::DT_UINT8);
+  Tensor bias(cpu_runtime, DataType::DT_INT32);
+  Tensor output(cpu_runtime, DataTypeToEnum<OUTPUT_TYPE>::value);
+  lhs.SetScale(0.05);
+  lhs.SetZeroPoint(121);
+  rhs.SetScale(0.02);
+  rhs.SetZeroPoint(135);
+  bias.SetScale(lhs.scale() * rhs.scale());
+  output.SetScale(0.15);
+  output.SetZeroPoint(97);
+  lhs.Resize({lhs_batched ? batch : 1, rows, depth});
+  rhs.Resize({rhs_batched ? batch : 1, depth, cols});
+  bias.Resize({rows});
+  output.Resize({batch, rows, cols});
+  {
+    Tensor::MappingGuard lhs_guard(&lhs);
+    Tensor::MappingGuard rhs_guard(&rhs);
+    Tensor::MappingGuard bias_guard(&bias);
+    GenerateRandomIntTypeData<uint8_t>(lhs.shape(),
+                                       lhs.mutable_data<uint8_t>());
+    GenerateRandomIntTypeData<uint8_t>(rhs.shape(),
+                                       rhs.mutable_data<uint8_t>());
+    GenerateRandomIntTypeData<int32_t>(bias.shape(),
+                                       bias.mutable_data<int32_t>(),
+                                       -10000, 10000);
+  }
+
+  Epilogue epilogue;
+  epilogue.bias = &bias;
+  OpsTestNet net;
+  OpContext context(net.ws(), cpu_runtime);
+  std::unique_ptr<delegator::Gemm> gemm = delegator::Gemm::Create(
+      context.workspace(),
+      MACE_DELEGATOR_KEY(Gemm, RuntimeType::RT_CPU, OUTPUT_TYPE,
+                         ImplType::NEON),
+      delegator::GemmParam(false, epilogue));
+  gemm->Compute(&context, &lhs, &rhs, batch, rows, cols, depth, lhs_major,
+                rhs_major, output_major, lhs_batched, rhs_batched, &output);
+
+  Tensor expected_output(cpu_runtime, DataTypeToEnum<OUTPUT_TYPE>::value);
+  expected_output.SetScale(output.scale());
+  expected_output.SetZeroPoint(output.zero_point());
+  expected_output.Resize({batch, rows, cols});
+  std::unique_ptr<delegator::Gemm> gemm_ref = delegator::Gemm::Create(
+      context.workspace(),
+      MACE_DELEGATOR_KEY(Gemm, RuntimeType::RT_CPU, OUTPUT_TYPE,
+                         ImplType::REF),
+      delegator::GemmParam(false, epilogue));
+  gemm_ref->Compute(&context, &lhs, &rhs, batch, rows, cols, depth,
+                    lhs_major, rhs_major, output_major, lhs_batched,
+                    rhs_batched, &expected_output);
+
+  ExpectTensorNear<OUTPUT_TYPE>(expected_output, output);
+}
+
+TEST(ArmGemmQ8, TestGemmInt32) {
+  TestGemmQ8<int32_t>(1, 47, 69, 37, RowMajor, RowMajor, RowMajor, true, true);
+  TestGemmQ8<int32_t>(1, 47, 69, 37, ColMajor, ColMajor, ColMajor, true, true);
+  TestGemmQ8<int32_t>(3, 47, 69, 37, RowMajor, ColMajor, RowMajor, true,
+                      false);
+  TestGemmQ8<int32_t>(2, 130, 7, 259, RowMajor, RowMajor, ColMajor, false,
+                      true);
+}
+
+TEST(ArmGemmQ8, TestGemmUint8) {
+  TestGemmQ8<uint8_t>(1, 47, 69, 37, RowMajor, RowMajor, RowMajor, true, true);
+  TestGemmQ8<uint8_t>(1, 47, 69, 37, RowMajor, ColMajor, ColMajor, true, true);
+  TestGemmQ8<uint8_t>(3, 64, 33, 96, ColMajor, RowMajor, RowMajor, true,
+                      false);
+}
+
+}  // namespace test
+}  // namespace ops
+}  // namespace mace
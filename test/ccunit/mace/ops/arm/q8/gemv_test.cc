@@ -60,7 +60,7 @@ void TestGemvInt32(const index_t batch,
   std::unique_ptr<delegator::Gemv> gemv = delegator::Gemv::Create(
       context.workspace(),
       MACE_DELEGATOR_KEY(Gemv, RuntimeType::RT_CPU, int32_t, ImplType::NEON),
-      DelegatorParam());
+      delegator::GemvParam());
   gemv->Compute(&context,
                 &lhs,
                 &rhs,
@@ -76,7 +76,8 @@ void TestGemvInt32(const index_t batch,
   expected_output.Resize({batch, height});
   std::unique_ptr<delegator::Gemv> gemv_ref = delegator::Gemv::Create(
       context.workspace(), MACE_DELEGATOR_KEY(
-      Gemv, RuntimeType::RT_CPU, int32_t, ImplType::REF), DelegatorParam());
+      Gemv, RuntimeType::RT_CPU, int32_t, ImplType::REF),
+      delegator::GemvParam());
   gemv_ref->Compute(&context,
                     &lhs,
                     &rhs,
@@ -136,7 +137,7 @@ void TestGemvUint8(const index_t batch,
   std::unique_ptr<delegator::Gemv> gemv = delegator::Gemv::Create(
       context.workspace(),
       MACE_DELEGATOR_KEY(Gemv, RuntimeType::RT_CPU, uint8_t, ImplType::NEON),
-      DelegatorParam());
+      delegator::GemvParam());
   gemv->Compute(&context,
                 &lhs,
                 &rhs,
@@ -154,7 +155,8 @@ void TestGemvUint8(const index_t batch,
   expected_output.Resize({batch, height});
   std::unique_ptr<delegator::Gemv> gemv_ref = delegator::Gemv::Create(
       context.workspace(), MACE_DELEGATOR_KEY(
-      Gemv, RuntimeType::RT_CPU, uint8_t, ImplType::REF), DelegatorParam());
+      Gemv, RuntimeType::RT_CPU, uint8_t, ImplType::REF),
+      delegator::GemvParam());
   gemv_ref->Compute(&context,
                     &lhs,
                     &rhs,
@@ -0,0 +1,230 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#include "mace/ops/ops_test_util.h"
+
+namespace mace {
+namespace ops {
+namespace test {
+
+class AttentionOpTest : public OpsTestBase {};
+
+namespace {
+
+// softmax(scale * Q x K^T + mask) x V row by row, K is [batch, k_len, depth]
+// and mask is [batch, q_len, k_len] here.
+std::vector<float> ReferenceAttention(const std::vector<float> &query,
+                                      const std::vector<float> &key,
+                                      const std::vector<float> &value,
+                                      const std::vector<float> &mask,
+                                      const index_t batch,
+                                      const index_t q_len,
+                                      const index_t k_len,
+                                      const index_t depth,
+                                      const index_t v_depth,
+                                      const float scale,
+                                      const bool causal) {
+  std::vector<float> output(batch * q_len * v_depth, 0.f);
+  std::vector<float> scores(k_len);
+  for (index_t b = 0; b < batch; ++b) {
+    for (index_t i = 0; i < q_len; ++i) {
+      float max = -std::numeric_limits<float>::infinity();
+      for (index_t j = 0; j < k_len; ++j) {
+        float score = 0.f;
+        for (index_t d = 0; d < depth; ++d) {
+          score += query[(b * q_len + i) * depth + d] *
+              key[(b * k_len + j) * depth + d];
+        }
+        score *= scale;
+        if (!mask.empty()) {
+          score += mask[(b * q_len + i) * k_len + j];
+        }
+        if (causal && j > i + k_len - q_len) {
+          score = -std::numeric_limits<float>::infinity();
+        }
+        scores[j] = score;
+        max = std::max(max, score);
+      }
+      if (std::isinf(max)) {
+        continue;
+      }
+      float sum = 0.f;
+      for (index_t j = 0; j < k_len; ++j) {
+        scores[j] = std::exp(scores[j] - max);
+        sum += scores[j];
+      }
+      for (index_t j = 0; j < k_len; ++j) {
+        for (index_t d = 0; d < v_depth; ++d) {
+          output[(b * q_len + i) * v_depth + d] +=
+              scores[j] / sum * value[(b * k_len + j) * v_depth + d];
+        }
+      }
+    }
+  }
+  return output;
+}
+
+// Runs Attention on random inputs of the batch dims `batch_shape`, with a
+// mask of `mask_shape` broadcast to the scores if it is not empty.
+void RandomAttention(const std::vector<index_t> &batch_shape,
+                     const index_t q_len,
+                     const index_t k_len,
+                     const index_t depth,
+                     const index_t v_depth,
+                     const std::vector<index_t> &mask_shape,
+                     const bool causal,
+                     const bool transpose_k) {
+  const index_t batch = std::accumulate(batch_shape.begin(),
+                                        batch_shape.end(), 1,
+                                        std::multiplies<index_t>());
+  auto shape_of = [&batch_shape](index_t rows, index_t cols) {
+    std::vector<index_t> shape = batch_shape;
+    shape.push_back(rows);
+    shape.push_back(cols);
+    return shape;
+  };
+  std::vector<float> query;
+  std::vector<float> key;
+  std::vector<float> value;
+  GenerateRandomRealTypeData<float>(shape_of(q_len, depth), &query);
+  GenerateRandomRealTypeData<float>(shape_of(k_len, depth), &key);
+  GenerateRandomRealTypeData<float>(shape_of(k_len, v_depth), &value);
+
+  OpsTestNet net;
+  net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "Query", shape_of(q_len, depth), query);
+  net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "Value", shape_of(k_len, v_depth), value);
+  if (transpose_k) {
+    net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+        "Key", shape_of(k_len, depth), key);
+  } else {
+    std::vector<float> key_t(key.size());
+    for (index_t b = 0; b < batch; ++b) {
+      for (index_t j = 0; j < k_len; ++j) {
+        for (index_t d = 0; d < depth; ++d) {
+          key_t[(b * depth + d) * k_len + j] = key[(b * k_len + j) * depth + d];
+        }
+      }
+    }
+    net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+        "Key", shape_of(depth, k_len), key_t);
+  }
+
+  // the mask broadcast to [batch, q_len, k_len] for the reference
+  std::vector<float> full_mask;
+  if (!mask_shape.empty()) {
+    std::vector<float> mask;
+    GenerateRandomRealTypeData<float>(mask_shape, &mask);
+    net.AddInputFromArray<RuntimeType::RT_CPU, float>("Mask", mask_shape,
+                                                      mask);
+    const std::vector<index_t> scores_shape = shape_of(q_len, k_len);
+    const index_t rank = static_cast<index_t>(scores_shape.size());
+    const index_t rank_diff = rank - static_cast<index_t>(mask_shape.size());
+    full_mask.resize(batch * q_len * k_len);
+    for (index_t i = 0; i < static_cast<index_t>(full_mask.size()); ++i) {
+      index_t index = i;
+      index_t offset = 0;
+      index_t stride = 1;
+      for (index_t d = rank - 1; d >= 0; --d) {
+        const index_t coord = index % scores_shape[d];
+        index /= scores_shape[d];
+        if (d >= rank_diff && mask_shape[d - rank_diff] != 1) {
+          offset += coord * stride;
+          stride *= mask_shape[d - rank_diff];
+        }
+      }
+      full_mask[i] = mask[offset];
+    }
+  }
+
+  OpDefBuilder builder("Attention", "AttentionTest");
+  builder.Input("Query").Input("Key").Input("Value");
+  if (!mask_shape.empty()) {
+    builder.Input("Mask");
+  }
+  builder.AddIntArg("causal", causal)
+      .AddIntArg("transpose_k", transpose_k)
+      .Output("Output")
+      .Finalize(net.NewOperatorDef());
+  net.RunOp(RuntimeType::RT_CPU);
+
+  const float scale = 1.f / std::sqrt(static_cast<float>(depth));
+  net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "Expected", shape_of(q_len, v_depth),
+      ReferenceAttention(query, key, value, full_mask, batch, q_len, k_len,
+                         depth, v_depth, scale, causal));
+  ExpectTensorNear<float>(*net.GetOutput("Expected"),
+                          *net.GetOutput("Output"), 1e-4, 1e-5);
+}
+
+}  // namespace
+
+TEST_F(AttentionOpTest, SimpleCPU) {
+  OpsTestNet net;
+  net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "Query", {1, 2, 2}, {1, 0, 0, 1});
+  net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "Key", {1, 2, 2}, {1, 0, 0, 1});
+  net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "Value", {1, 2, 1}, {1, 3});
+  OpDefBuilder("Attention", "AttentionTest")
+      .Input("Query")
+      .Input("Key")
+      .Input("Value")
+      .AddFloatArg("scale", std::log(3.f))
+      .AddIntArg("transpose_k", 1)
+      .Output("Output")
+      .Finalize(net.NewOperatorDef());
+  net.RunOp(RuntimeType::RT_CPU);
+
+  // the weights of the rows are [3/4, 1/4] and [1/4, 3/4]
+  auto expected = net.CreateTensor<float>({1, 2, 1}, {1.5f, 2.5f});
+  ExpectTensorNear<float>(*expected, *net.GetOutput("Output"), 1e-5);
+}
+
+TEST_F(AttentionOpTest, RandomCPU) {
+  RandomAttention({2, 3}, 5, 7, 4, 6, {}, false, true);
+  RandomAttention({2}, 9, 9, 8, 8, {}, false, false);
+  RandomAttention({}, 1, 33, 16, 16, {}, false, true);
+}
+
+TEST_F(AttentionOpTest, MultipleTilesCPU) {
+  RandomAttention({2}, 130, 300, 16, 8, {}, false, true);
+  RandomAttention({1, 2}, 257, 129, 8, 12, {}, false, false);
+}
+
+TEST_F(AttentionOpTest, MaskCPU) {
+  RandomAttention({2, 3}, 5, 7, 4, 6, {5, 7}, false, true);
+  RandomAttention({2, 3}, 5, 7, 4, 6, {2, 1, 1, 7}, false, false);
+  RandomAttention({2, 3}, 150, 140, 8, 8, {2, 3, 150, 140}, false, true);
+}
+
+TEST_F(AttentionOpTest, CausalCPU) {
+  RandomAttention({2}, 9, 9, 4, 4, {}, true, true);
+  RandomAttention({3}, 1, 17, 8, 8, {}, true, false);
+  RandomAttention({1}, 200, 300, 8, 8, {1, 300}, true, true);
+  // the first queries see no key
+  RandomAttention({2}, 7, 4, 4, 4, {}, true, true);
+}
+
+}  // namespace test
+}  // namespace ops
+}  // namespace mace
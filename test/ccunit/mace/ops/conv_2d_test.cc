@@ -1282,7 +1282,8 @@ void TestQuant(const index_t batch,
                const index_t k_height,
                const index_t k_width,
                enum Padding padding_type,
-               const std::vector<int> &strides) {
+               const std::vector<int> &strides,
+               const std::vector<int> &dilations = {1, 1}) {
   OpsTestNet net;
   net.AddRandomInput<RuntimeType::RT_CPU, float>(
       "Input", {batch, in_height, in_width, in_channels});
@@ -1301,7 +1302,7 @@ void TestQuant(const index_t batch,
       .Output("OutputNCHW")
       .AddIntsArg("strides", strides)
       .AddIntArg("padding", padding_type)
-      .AddIntsArg("dilations", {1, 1})
+      .AddIntsArg("dilations", dilations)
       .AddIntArg("T", static_cast<int>(DT_FLOAT))
       .Finalize(net.NewOperatorDef());
   net.RunOp(RuntimeType::RT_CPU);
@@ -1355,7 +1356,102 @@ void TestQuant(const index_t batch,
       .Output("QuantizedOutput")
       .AddIntsArg("strides", strides)
       .AddIntArg("padding", padding_type)
-      .AddIntsArg("dilations", {1, 1})
+      .AddIntsArg("dilations", dilations)
+      .AddIntArg("T", static_cast<int>(DT_UINT8))
+      .Finalize(net.NewOperatorDef());
+  net.Setup(RuntimeType::RT_CPU);
+  Tensor *eq_output = net.GetTensor("ExpectedQuantizedOutput");
+  Tensor *q_output = net.GetTensor("QuantizedOutput");
+  q_output->SetScale(eq_output->scale());
+  q_output->SetZeroPoint(eq_output->zero_point());
+  net.Run();
+
+  OpDefBuilder("Dequantize", "DeQuantizeTest")
+      .Input("QuantizedOutput")
+      .Output("DequantizedOutput")
+      .OutputType({DT_FLOAT})
+      .AddIntArg("T", DT_UINT8)
+      .Finalize(net.NewOperatorDef());
+  net.RunOp();
+
+  // Check
+  ExpectTensorSimilar<float>(*net.GetOutput("Output"),
+                             *net.GetTensor("DequantizedOutput"), 0.01);
+}
+
+void TestQuantPerChannel(const index_t batch,
+                         const index_t out_channels,
+                         const index_t in_channels,
+                         const index_t in_height,
+                         const index_t in_width,
+                         const index_t k_height,
+                         const index_t k_width,
+                         enum Padding padding_type,
+                         const std::vector<int> &strides,
+                         const std::vector<int> &dilations = {1, 1}) {
+  OpsTestNet net;
+  net.AddRandomInput<RuntimeType::RT_CPU, float>(
+      "Input", {batch, in_height, in_width, in_channels});
+  net.AddRandomInput<RuntimeType::RT_CPU, float>(
+      "Filter", {out_channels, k_height, k_width, in_channels}, true);
+  net.AddRandomInput<RuntimeType::RT_CPU, float>("Bias", {out_channels}, true);
+  // give the output channels different ranges
+  Tensor *filter = net.GetTensor("Filter");
+  float *filter_data = filter->mutable_data<float>();
+  const index_t filter_inner = filter->size() / out_channels;
+  for (index_t i = 0; i < filter->size(); ++i) {
+    filter_data[i] *= 1 + (i / filter_inner) % 8;
+  }
+  net.TransformDataFormat<RuntimeType::RT_CPU, float>(
+      "Input", DataFormat::NHWC, "InputNCHW", DataFormat::NCHW);
+  net.TransformFilterDataFormat<RuntimeType::RT_CPU, float>(
+      "Filter", DataFormat::OHWI, "FilterOIHW", DataFormat::OIHW);
+
+  OpDefBuilder("Conv2D", "Conv2dTest")
+      .Input("InputNCHW")
+      .Input("FilterOIHW")
+      .Input("Bias")
+      .Output("OutputNCHW")
+      .AddIntsArg("strides", strides)
+      .AddIntArg("padding", padding_type)
+      .AddIntsArg("dilations", dilations)
+      .AddIntArg("T", static_cast<int>(DT_FLOAT))
+      .Finalize(net.NewOperatorDef());
+  net.RunOp(RuntimeType::RT_CPU);
+  net.TransformDataFormat<RuntimeType::RT_CPU, float>(
+      "OutputNCHW", DataFormat::NCHW, "Output", DataFormat::NHWC);
+
+  OpDefBuilder("Quantize", "QuantizeInput")
+      .Input("Input")
+      .Output("QuantizedInput")
+      .OutputType({DT_UINT8})
+      .AddIntArg("T", DT_UINT8)
+      .AddIntArg("non_zero", true)
+      .Finalize(net.NewOperatorDef());
+  net.RunOp();
+
+  OpDefBuilder("Quantize", "QuantizeOutput")
+      .Input("Output")
+      .Output("ExpectedQuantizedOutput")
+      .OutputType({DT_UINT8})
+      .AddIntArg("T", DT_UINT8)
+      .AddIntArg("non_zero", true)
+      .Finalize(net.NewOperatorDef());
+  net.RunOp();
+
+  net.QuantizePerChannel("Filter", "QuantizedFilter", out_channels, false);
+  net.QuantizeBiasPerChannel("Bias", "QuantizedFilter",
+                             net.GetTensor("QuantizedInput")->scale(),
+                             "QuantizedBias");
+
+  OpDefBuilder("Conv2D", "QuantizeConv2dTest")
+      .Input("QuantizedInput")
+      .Input("QuantizedFilter")
+      .Input("QuantizedBias")
+      .Output("QuantizedOutput")
+      .AddIntsArg("strides", strides)
+      .AddIntArg("padding", padding_type)
+      .AddIntsArg("dilations", dilations)
       .AddIntArg("T", static_cast<int>(DT_UINT8))
       .Finalize(net.NewOperatorDef());
   net.Setup(RuntimeType::RT_CPU);
@@ -1379,6 +1475,14 @@ void TestQuant(const index_t batch,
 }
 }  // namespace
 
+TEST_F(Conv2dOpTest, QuantPerChannel) {
+  TestQuantPerChannel(1, 128, 64, 32, 32, 1, 1, VALID, {1, 1});
+  TestQuantPerChannel(1, 128, 64, 32, 32, 3, 3, SAME, {1, 1});
+  TestQuantPerChannel(1, 129, 63, 33, 31, 3, 3, SAME, {2, 2});
+  TestQuantPerChannel(3, 37, 17, 15, 13, 5, 5, VALID, {1, 1});
+  TestQuantPerChannel(1, 37, 17, 15, 13, 3, 3, SAME, {1, 1}, {2, 2});
+}
+
 TEST_F(Conv2dOpTest, Quant) {
   TestQuantSimple3x3();
   TestQuant(1, 128, 64, 32, 32, 1, 1, VALID, {1, 1});
@@ -1394,6 +1498,9 @@ TEST_F(Conv2dOpTest, Quant) {
   TestQuant(1, 128, 64, 32, 32, 7, 7, SAME, {1, 1});
   TestQuant(1, 128, 64, 32, 32, 7, 7, SAME, {2, 2});
   TestQuant(1, 128, 64, 32, 32, 7, 7, SAME, {3, 3});
+  TestQuant(1, 128, 64, 32, 32, 3, 3, SAME, {1, 1}, {2, 2});
+  TestQuant(2, 37, 17, 15, 13, 3, 3, VALID, {1, 1}, {2, 3});
+  TestQuant(1, 65, 33, 31, 33, 3, 3, SAME, {1, 1}, {4, 4});
 }
 
 #ifdef MACE_ENABLE_BFLOAT16
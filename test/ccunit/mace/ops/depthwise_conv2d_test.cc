@@ -475,8 +475,110 @@ void TestQuant(const index_t batch,
   ExpectTensorSimilar<float>(*net.GetOutput("Output"),
                              *net.GetTensor("DequantizedOutput"), 0.01);
 }
+
+void TestQuantPerChannel(const index_t batch,
+                         const index_t multiplier,
+                         const index_t in_channels,
+                         const index_t in_height,
+                         const index_t in_width,
+                         const index_t k_height,
+                         const index_t k_width,
+                         enum Padding padding_type,
+                         const std::vector<int> &strides,
+                         const std::vector<int> &dilations) {
+  OpsTestNet net;
+  const index_t out_channels = multiplier * in_channels;
+  net.AddRandomInput<RuntimeType::RT_CPU, float>(
+      "Input", {batch, in_height, in_width, in_channels}, false, false);
+  net.AddRandomInput<RuntimeType::RT_CPU, float>(
+      "Filter", {k_height, k_width, in_channels, multiplier}, true, false);
+  net.AddRandomInput<RuntimeType::RT_CPU, float>("Bias", {out_channels}, true);
+  // give the output channels different ranges
+  Tensor *filter = net.GetTensor("Filter");
+  float *filter_data = filter->mutable_data<float>();
+  for (index_t i = 0; i < filter->size(); ++i) {
+    filter_data[i] *= 1 + (i % out_channels) % 8;
+  }
+  net.TransformDataFormat<RuntimeType::RT_CPU, float>(
+      "Input", DataFormat::NHWC, "InputNCHW", DataFormat::NCHW);
+  net.TransformFilterDataFormat<RuntimeType::RT_CPU, float>(
+      "Filter", DataFormat::HWIO, "FilterOIHW", DataFormat::OIHW);
+
+  OpDefBuilder("DepthwiseConv2d", "DepthwiseConv2DTest")
+      .Input("InputNCHW")
+      .Input("FilterOIHW")
+      .Input("Bias")
+      .Output("OutputNCHW")
+      .AddIntsArg("strides", strides)
+      .AddIntArg("padding", padding_type)
+      .AddIntsArg("dilations", dilations)
+      .AddIntArg("T", static_cast<int>(DT_FLOAT))
+      .Finalize(net.NewOperatorDef());
+  net.RunOp(RuntimeType::RT_CPU);
+  net.TransformDataFormat<RuntimeType::RT_CPU, float>(
+      "OutputNCHW", DataFormat::NCHW, "Output", DataFormat::NHWC);
+
+  OpDefBuilder("Quantize", "QuantizeInput")
+      .Input("Input")
+      .Output("QuantizedInput")
+      .OutputType({DT_UINT8})
+      .AddIntArg("T", DT_UINT8)
+      .AddIntArg("non_zero", true)
+      .Finalize(net.NewOperatorDef());
+  net.RunOp();
+
+  OpDefBuilder("Quantize", "QuantizeOutput")
+      .Input("Output")
+      .Output("ExpectedQuantizedOutput")
+      .OutputType({DT_UINT8})
+      .AddIntArg("T", DT_UINT8)
+      .AddIntArg("non_zero", true)
+      .Finalize(net.NewOperatorDef());
+  net.RunOp();
+
+  net.QuantizePerChannel("Filter", "QuantizedFilter", out_channels, true);
+  net.QuantizeBiasPerChannel("Bias", "QuantizedFilter",
+                             net.GetTensor("QuantizedInput")->scale(),
+                             "QuantizedBias");
+
+  OpDefBuilder("DepthwiseConv2d", "QuantizedDepthwiseConv2DTest")
+      .Input("QuantizedInput")
+      .Input("QuantizedFilter")
+      .Input("QuantizedBias")
+      .Output("QuantizedOutput")
+      .AddIntsArg("strides", strides)
+      .AddIntArg("padding", padding_type)
+      .AddIntsArg("dilations", dilations)
+      .AddIntArg("T", static_cast<int>(DT_UINT8))
+      .Finalize(net.NewOperatorDef());
+  net.Setup(RuntimeType::RT_CPU);
+  Tensor *eq_output = net.GetTensor("ExpectedQuantizedOutput");
+  Tensor *q_output = net.GetTensor("QuantizedOutput");
+  q_output->SetScale(eq_output->scale());
+  q_output->SetZeroPoint(eq_output->zero_point());
+  net.Run();
+
+  OpDefBuilder("Dequantize", "DeQuantizeTest")
+      .Input("QuantizedOutput")
+      .Output("DequantizedOutput")
+      .OutputType({DT_FLOAT})
+      .AddIntArg("T", DT_UINT8)
+      .Finalize(net.NewOperatorDef());
+  net.RunOp();
+
+  // Check
+  ExpectTensorSimilar<float>(*net.GetOutput("Output"),
+                             *net.GetTensor("DequantizedOutput"), 0.01);
+}
 }  // namespace
 
+TEST_F(DepthwiseConv2dOpTest, QuantPerChannel) {
+  TestQuantPerChannel(1, 1, 1024, 7, 7, 3, 3, VALID, {1, 1}, {1, 1});
+  TestQuantPerChannel(1, 1, 512, 14, 13, 5, 5, SAME, {2, 2}, {1, 1});
+  TestQuantPerChannel(1, 2, 256, 14, 14, 3, 3, SAME, {1, 1}, {1, 1});
+  TestQuantPerChannel(3, 1, 128, 28, 28, 3, 3, SAME, {1, 1}, {2, 2});
+}
+
 TEST_F(DepthwiseConv2dOpTest, Quant) {
   QuantSimpleValidTest();
   TestQuant(1, 1, 1024, 7, 7, 3, 3, VALID, {1, 1});
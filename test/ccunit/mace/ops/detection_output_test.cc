@@ -0,0 +1,213 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "mace/ops/ops_test_util.h"
+
+namespace mace {
+namespace ops {
+namespace test {
+
+class DetectionOutputOpTest : public OpsTestBase {};
+
+namespace {
+
+void RunDetectionOutput(const int num_prior,
+                        const int num_classes,
+                        const std::vector<float> &loc,
+                        const std::vector<float> &conf,
+                        const std::vector<float> &pbox,
+                        const int nms_top_k,
+                        const int keep_top_k,
+                        OpsTestNet *net) {
+  net->AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "Loc", {1, num_prior * 4}, loc);
+  net->AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "Conf", {1, num_prior * num_classes}, conf);
+  net->AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "PriorBox", {1, 2, num_prior * 4}, pbox);
+  OpDefBuilder("DetectionOutput", "DetectionOutputTest")
+      .Input("Loc")
+      .Input("Conf")
+      .Input("PriorBox")
+      .Output("Output")
+      .AddIntArg("num_classes", num_classes)
+      .AddFloatArg("nms_threshold", 0.45f)
+      .AddIntArg("nms_top_k", nms_top_k)
+      .AddIntArg("keep_top_k", keep_top_k)
+      .AddFloatArg("confidence_threshold", 0.05f)
+      .Finalize(net->NewOperatorDef());
+  net->RunOp(RuntimeType::RT_CPU);
+}
+
+// Decodes every prior, then sorts and suppresses class by class.
+std::vector<float> ReferenceDetectionOutput(const int num_prior,
+                                            const int num_classes,
+                                            const std::vector<float> &loc,
+                                            const std::vector<float> &conf,
+                                            const std::vector<float> &pbox,
+                                            const int nms_top_k,
+                                            const int keep_top_k) {
+  std::vector<float> boxes(num_prior * 4);
+  for (int i = 0; i < num_prior; ++i) {
+    const float *lc = loc.data() + i * 4;
+    const float *pb = pbox.data() + i * 4;
+    const float *var = pb + num_prior * 4;
+    const float pb_w = pb[2] - pb[0];
+    const float pb_h = pb[3] - pb[1];
+    const float cx = var[0] * lc[0] * pb_w + (pb[0] + pb[2]) * 0.5f;
+    const float cy = var[1] * lc[1] * pb_h + (pb[1] + pb[3]) * 0.5f;
+    const float w = std::exp(var[2] * lc[2]) * pb_w;
+    const float h = std::exp(var[3] * lc[3]) * pb_h;
+    boxes[i * 4] = cx - w * 0.5f;
+    boxes[i * 4 + 1] = cy - h * 0.5f;
+    boxes[i * 4 + 2] = cx + w * 0.5f;
+    boxes[i * 4 + 3] = cy + h * 0.5f;
+  }
+  auto area = [&](int i) {
+    return std::max(0.f, boxes[i * 4 + 2] - boxes[i * 4]) *
+        std::max(0.f, boxes[i * 4 + 3] - boxes[i * 4 + 1]);
+  };
+  auto iou = [&](int i, int j) {
+    const float w = std::min(boxes[i * 4 + 2], boxes[j * 4 + 2]) -
+        std::max(boxes[i * 4], boxes[j * 4]);
+    const float h = std::min(boxes[i * 4 + 3], boxes[j * 4 + 3]) -
+        std::max(boxes[i * 4 + 1], boxes[j * 4 + 1]);
+    const float inter = std::max(0.f, w) * std::max(0.f, h);
+    return inter / (area(i) + area(j) - inter);
+  };
+
+  // confidence, label, prior
+  std::vector<std::vector<float>> detections;
+  for (int c = 1; c < num_classes; ++c) {
+    std::vector<std::pair<float, int>> candidates;
+    for (int i = 0; i < num_prior; ++i) {
+      if (conf[i * num_classes + c] > 0.05f) {
+        candidates.emplace_back(conf[i * num_classes + c], i);
+      }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const std::pair<float, int> &a,
+                 const std::pair<float, int> &b) {
+                return a.first > b.first;
+              });
+    if (static_cast<int>(candidates.size()) > nms_top_k) {
+      candidates.resize(nms_top_k);
+    }
+    std::vector<int> picked;
+    for (auto &candidate : candidates) {
+      bool keep = true;
+      for (int p : picked) {
+        if (iou(candidate.second, p) > 0.45f) {
+          keep = false;
+          break;
+        }
+      }
+      if (keep) {
+        picked.push_back(candidate.second);
+        detections.push_back({candidate.first, static_cast<float>(c),
+                              static_cast<float>(candidate.second)});
+      }
+    }
+  }
+  std::sort(detections.begin(), detections.end(),
+            [](const std::vector<float> &a, const std::vector<float> &b) {
+              return a[0] > b[0];
+            });
+  if (static_cast<int>(detections.size()) > keep_top_k) {
+    detections.resize(keep_top_k);
+  }
+
+  std::vector<float> output;
+  for (auto &d : detections) {
+    const int p = static_cast<int>(d[2]);
+    output.insert(output.end(), {0.f, d[1], d[0], boxes[p * 4],
+                                 boxes[p * 4 + 1], boxes[p * 4 + 2],
+                                 boxes[p * 4 + 3]});
+  }
+  return output;
+}
+
+}  // namespace
+
+TEST_F(DetectionOutputOpTest, Simple) {
+  // prior 1 mostly overlaps prior 0, prior 2 is apart
+  const std::vector<float> pbox = {
+      0, 0, 1, 1, 0.05, 0, 1.05, 1, 2, 2, 3, 3,
+      0.1, 0.1, 0.2, 0.2, 0.1, 0.1, 0.2, 0.2, 0.1, 0.1, 0.2, 0.2};
+  const std::vector<float> loc(12, 0.f);
+  const std::vector<float> conf = {0.1, 0.9, 0.02,
+                                   0.1, 0.8, 0.6,
+                                   0.1, 0.01, 0.7};
+  OpsTestNet net;
+  RunDetectionOutput(3, 3, loc, conf, pbox, 100, 100, &net);
+
+  auto expected = net.CreateTensor<float>(
+      {1, 1, 3, 7}, {0, 1, 0.9, 0, 0, 1, 1,
+                     0, 2, 0.7, 2, 2, 3, 3,
+                     0, 2, 0.6, 0.05, 0, 1.05, 1});
+  ExpectTensorNear<float>(*expected, *net.GetOutput("Output"), 1e-5);
+}
+
+TEST_F(DetectionOutputOpTest, Random) {
+  const int num_prior = 1917;
+  const int num_classes = 21;
+  std::mt19937 gen(1);
+  std::uniform_real_distribution<float> unit(0.f, 1.f);
+  std::uniform_real_distribution<float> offset(-1.f, 1.f);
+  std::vector<float> pbox(num_prior * 8);
+  for (int i = 0; i < num_prior; ++i) {
+    const float cx = unit(gen);
+    const float cy = unit(gen);
+    const float half = 0.05f + 0.2f * unit(gen);
+    float *pb = pbox.data() + i * 4;
+    pb[0] = cx - half;
+    pb[1] = cy - half;
+    pb[2] = cx + half;
+    pb[3] = cy + half;
+    float *var = pbox.data() + (num_prior + i) * 4;
+    var[0] = var[1] = 0.1f;
+    var[2] = var[3] = 0.2f;
+  }
+  std::vector<float> loc(num_prior * 4);
+  for (auto &v : loc) {
+    v = offset(gen);
+  }
+  // sparse scores like the ones of a softmax
+  std::vector<float> conf(num_prior * num_classes);
+  for (auto &v : conf) {
+    const float u = unit(gen);
+    v = u * u * u;
+  }
+
+  for (int nms_top_k : {50, 400}) {
+    OpsTestNet net;
+    RunDetectionOutput(num_prior, num_classes, loc, conf, pbox,
+                       nms_top_k, 200, &net);
+    const std::vector<float> expected_data = ReferenceDetectionOutput(
+        num_prior, num_classes, loc, conf, pbox, nms_top_k, 200);
+    auto expected = net.CreateTensor<float>(
+        {1, 1, static_cast<index_t>(expected_data.size() / 7), 7},
+        expected_data);
+    ExpectTensorNear<float>(*expected, *net.GetOutput("Output"), 1e-5);
+  }
+}
+
+}  // namespace test
+}  // namespace ops
+}  // namespace mace
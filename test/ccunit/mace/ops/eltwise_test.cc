@@ -12,6 +12,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <functional>
+#include <numeric>
 #include <vector>
 
 #include "mace/ops/common/conv_pool_2d_util.h"
@@ -748,15 +751,79 @@ void RandomTensorEltwise(const ops::EltwiseType type,
   }
 }
 
-void Quantized(const std::vector<index_t> &shape,
+// Compares the CPU broadcast of NHWC inputs of the same rank with a loop
+// over the output elements.
+void RandomGeneralBroadcast(const ops::EltwiseType type,
+                            const std::vector<index_t> &shape0,
+                            const std::vector<index_t> &shape1,
+                            const std::vector<float> &coeff = {}) {
+  OpsTestNet net;
+  net.AddRandomInput<RuntimeType::RT_CPU, float>("Input0", shape0,
+                                                 false, false, true);
+  net.AddRandomInput<RuntimeType::RT_CPU, float>("Input1", shape1,
+                                                 false, false, true);
+  OpDefBuilder("Eltwise", "EltwiseTest")
+      .Input("Input0")
+      .Input("Input1")
+      .AddIntArg("type", static_cast<int>(type))
+      .AddFloatsArg("coeff", coeff)
+      .Output("Output")
+      .Finalize(net.NewOperatorDef());
+  net.RunOp(RuntimeType::RT_CPU);
+
+  std::vector<index_t> output_shape(shape0.size());
+  for (size_t i = 0; i < shape0.size(); ++i) {
+    output_shape[i] = std::max(shape0[i], shape1[i]);
+  }
+  auto input0 = net.GetTensor("Input0")->data<float>();
+  auto input1 = net.GetTensor("Input1")->data<float>();
+  std::vector<float> expected_data;
+  std::vector<index_t> index(output_shape.size(), 0);
+  const index_t output_size = std::accumulate(
+      output_shape.begin(), output_shape.end(), 1, std::multiplies<index_t>());
+  for (index_t i = 0; i < output_size; ++i) {
+    index_t offset0 = 0;
+    index_t offset1 = 0;
+    for (size_t d = 0; d < output_shape.size(); ++d) {
+      offset0 = offset0 * shape0[d] + (shape0[d] == 1 ? 0 : index[d]);
+      offset1 = offset1 * shape1[d] + (shape1[d] == 1 ? 0 : index[d]);
+    }
+    const float a = input0[offset0];
+    const float b = input1[offset1];
+    switch (type) {
+      case ops::EltwiseType::SUM:
+        expected_data.push_back(
+            coeff.empty() ? a + b : a * coeff[0] + b * coeff[1]);
+        break;
+      case ops::EltwiseType::SUB: expected_data.push_back(a - b); break;
+      case ops::EltwiseType::PROD: expected_data.push_back(a * b); break;
+      case ops::EltwiseType::MAX:
+        expected_data.push_back(std::max(a, b));
+        break;
+      default: MACE_NOT_IMPLEMENTED;
+    }
+    for (index_t d = static_cast<index_t>(index.size()) - 1; d >= 0; --d) {
+      if (++index[d] < output_shape[d]) {
+        break;
+      }
+      index[d] = 0;
+    }
+  }
+
+  auto expected = net.CreateTensor<float>(output_shape, expected_data);
+  ExpectTensorNear<float>(*expected, *net.GetOutput("Output"), 1e-5);
+}
+
+void Quantized(const std::vector<index_t> &shape0,
+               const std::vector<index_t> &shape1,
                const ops::EltwiseType type) {
   // Construct graph
   OpsTestNet net;
 
   // Add input data
-  net.AddRandomInput<RuntimeType::RT_CPU, float>("Input0", shape,
+  net.AddRandomInput<RuntimeType::RT_CPU, float>("Input0", shape0,
                                                  false, true, true);
-  net.AddRandomInput<RuntimeType::RT_CPU, float>("Input1", shape,
+  net.AddRandomInput<RuntimeType::RT_CPU, float>("Input1", shape1,
                                                  false, true, true);
 
   net.TransformDataFormat<RuntimeType::RT_CPU, float>(
@@ -830,6 +897,11 @@ void Quantized(const std::vector<index_t> &shape,
   ExpectTensorSimilar<float>(*net.GetOutput("Output"),
                              *net.GetTensor("DequantizedOutput"), 0.01);
 }
+
+void Quantized(const std::vector<index_t> &shape,
+               const ops::EltwiseType type) {
+  Quantized(shape, shape, type);
+}
 }  // namespace
 
 TEST_F(EltwiseOpTest, RandomTensorScalarFloat) {
@@ -977,6 +1049,17 @@ TEST_F(EltwiseOpTest, TensorGeneralBroadcastCPU) {
       {1, 1, 2, 1}, {1, 2}, {1, 1, 2, 3}, {1, 0, 0, 0, 0, 0});
 }
 
+TEST_F(EltwiseOpTest, RandomGeneralBroadcastCPU) {
+  RandomGeneralBroadcast(ops::EltwiseType::SUM, {2, 1, 9, 5}, {1, 7, 1, 5});
+  RandomGeneralBroadcast(ops::EltwiseType::SUM, {2, 1, 9, 5}, {1, 7, 1, 5},
+                         {0.5f, 2.f});
+  RandomGeneralBroadcast(ops::EltwiseType::SUB, {2, 7, 9, 1}, {1, 7, 9, 5});
+  RandomGeneralBroadcast(ops::EltwiseType::PROD, {3, 1, 1, 64},
+                         {1, 16, 16, 64});
+  RandomGeneralBroadcast(ops::EltwiseType::MAX, {1, 13, 1, 1},
+                         {4, 1, 11, 3});
+}
+
 TEST_F(EltwiseOpTest, TensorGeneralBroadcastGPU) {
   TensorGeneralBroadcastEltwise<RuntimeType::RT_OPENCL, float, float>(
       ops::EltwiseType::SUM, {1, 1, 2, 3}, {1, 2, 3, 4, 5, 6}, {1, 1, 2, 1},
@@ -1034,6 +1117,8 @@ TEST_F(EltwiseOpTest, Quantized) {
   Quantized({1, 31, 31, 17}, ops::EltwiseType::SUM);
   Quantized({1, 32, 32, 16}, ops::EltwiseType::SUB);
   Quantized({1, 31, 31, 17}, ops::EltwiseType::SUB);
+  Quantized({1, 16, 16, 8}, {1, 1, 16, 8}, ops::EltwiseType::SUM);
+  Quantized({1, 1, 15, 8}, {1, 15, 15, 8}, ops::EltwiseType::SUB);
 }
 
 }  // namespace test
@@ -92,6 +92,88 @@ TEST_F(FullyConnectedOpTest, SimpleCPUWithBatch) {
       {1, 2, 3, 4}, {1}, {2}, {2, 1, 1, 1}, {32, 72});
 }
 
+TEST_F(FullyConnectedOpTest, FusedActivationCPU) {
+  OpsTestNet net;
+  net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "Input", {2, 3, 1, 1}, {1, 2, 3, -1, -2, -3});
+  net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "Weight", {2, 3, 1, 1}, {1, 1, 1, -2, 0, 1}, true);
+  net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "Bias", {2}, {0.5f, 1.5f}, true);
+
+  OpDefBuilder("FullyConnected", "FullyConnectedTest")
+      .Input("Input")
+      .Input("Weight")
+      .Input("Bias")
+      .Output("Output")
+      .AddStringArg("activation", "RELUX")
+      .AddFloatArg("max_limit", 4.f)
+      .Finalize(net.NewOperatorDef());
+  net.RunOp(RuntimeType::RT_CPU);
+
+  auto expected = net.CreateTensor<float>({2, 2, 1, 1}, {4, 2.5f, 0, 0.5f});
+  ExpectTensorNear<float>(*expected, *net.GetOutput("Output"), 1e-5);
+}
+
+namespace {
+void CompressedWeight(const index_t batch,
+                      const index_t channels,
+                      const index_t out_channel) {
+  OpsTestNet net;
+
+  std::vector<index_t> weight_shape = {out_channel, channels, 1, 1};
+  const index_t weight_size = out_channel * channels;
+  // the float weights hold the exact values of the compressed ones, so only
+  // the accumulation differs
+  std::vector<float> half_weight_values(weight_size);
+  std::vector<float> uint8_weight_values(weight_size);
+  std::vector<half> half_weight_data(weight_size);
+  std::vector<uint8_t> uint8_weight_data(weight_size);
+  const float scale = 0.05f;
+  const int32_t zero_point = 128;
+  for (index_t i = 0; i < weight_size; ++i) {
+    uint8_weight_data[i] = static_cast<uint8_t>(rand() % 256);
+    uint8_weight_values[i] = scale * (uint8_weight_data[i] - zero_point);
+    half_weight_data[i] = half_float::half_cast<half>(uint8_weight_values[i]);
+    half_weight_values[i] = half_float::half_cast<float>(half_weight_data[i]);
+  }
+
+  net.AddRandomInput<RuntimeType::RT_CPU, float>(
+      "Input", {batch, channels, 1, 1});
+  net.AddRandomInput<RuntimeType::RT_CPU, float>("Bias", {out_channel}, true);
+  net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "HalfWeightValues", weight_shape, half_weight_values, true);
+  net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "Uint8WeightValues", weight_shape, uint8_weight_values, true);
+  net.AddInputFromArray<RuntimeType::RT_CPU, half>(
+      "HalfWeight", weight_shape, half_weight_data, true);
+  net.AddInputFromArray<RuntimeType::RT_CPU, uint8_t>(
+      "Uint8Weight", weight_shape, uint8_weight_data, true, scale, zero_point);
+
+  for (const std::string weight : {"HalfWeightValues", "HalfWeight",
+                                   "Uint8WeightValues", "Uint8Weight"}) {
+    OpDefBuilder("FullyConnected", "FullyConnectedTest")
+        .Input("Input")
+        .Input(weight)
+        .Input("Bias")
+        .Output(weight + "Output")
+        .Finalize(net.NewOperatorDef());
+    net.RunOp();
+  }
+
+  ExpectTensorNear<float>(*net.GetOutput("HalfWeightValuesOutput"),
+                          *net.GetOutput("HalfWeightOutput"), 1e-5, 1e-4);
+  ExpectTensorNear<float>(*net.GetOutput("Uint8WeightValuesOutput"),
+                          *net.GetOutput("Uint8WeightOutput"), 1e-5, 1e-4);
+}
+}  // namespace
+
+TEST_F(FullyConnectedOpTest, CompressedWeightCPU) {
+  CompressedWeight(1, 16, 8);
+  CompressedWeight(1, 513, 65);
+  CompressedWeight(3, 1024, 130);
+}
+
 TEST_F(FullyConnectedOpTest, SimpleOPENCL) {
   Simple<RuntimeType::RT_OPENCL>(
       {1, 2, 2, 2}, {1, 2, 3, 4, 5, 6, 7, 8}, {1, 2, 2, 2},
@@ -304,6 +386,93 @@ void QuantRandom(const index_t batch,
   ExpectTensorSimilar<float>(*net.GetOutput("Output"),
                              *net.GetTensor("DequantizedOutput"), 0.01);
 }
+
+void QuantPerChannelRandom(const index_t batch,
+                           const index_t height,
+                           const index_t width,
+                           const index_t channels,
+                           const index_t out_channel) {
+  // Construct graph
+  OpsTestNet net;
+
+  // Add input data
+  net.AddRandomInput<RuntimeType::RT_CPU, float>(
+      "Input", {batch, height, width, channels});
+  net.AddRandomInput<RuntimeType::RT_CPU, float>(
+      "Weight", {out_channel, height, width, channels}, true);
+  net.AddRandomInput<RuntimeType::RT_CPU, float>("Bias", {out_channel}, true);
+  // give the output channels different ranges
+  Tensor *weight = net.GetTensor("Weight");
+  float *weight_data = weight->mutable_data<float>();
+  const index_t weight_inner = weight->size() / out_channel;
+  for (index_t i = 0; i < weight->size(); ++i) {
+    weight_data[i] *= 1 + (i / weight_inner) % 8;
+  }
+  net.TransformDataFormat<RuntimeType::RT_CPU, float>(
+      "Input", DataFormat::NHWC, "InputNCHW", DataFormat::NCHW);
+  net.TransformFilterDataFormat<RuntimeType::RT_CPU, float>(
+      "Weight", DataFormat::OHWI, "WeightOIHW", DataFormat::OIHW);
+
+  OpDefBuilder("FullyConnected", "FullyConnectedTest")
+      .Input("InputNCHW")
+      .Input("WeightOIHW")
+      .Input("Bias")
+      .Output("OutputNCHW")
+      .AddIntArg("T", DT_FLOAT)
+      .Finalize(net.NewOperatorDef());
+  net.RunOp();
+  net.TransformDataFormat<RuntimeType::RT_CPU, float>(
+      "OutputNCHW", DataFormat::NCHW, "Output", DataFormat::NHWC);
+
+  OpDefBuilder("Quantize", "QuantizeInput")
+      .Input("Input")
+      .Output("QuantizedInput")
+      .OutputType({DT_UINT8})
+      .AddIntArg("T", DT_UINT8)
+      .AddIntArg("non_zero", true)
+      .Finalize(net.NewOperatorDef());
+  net.RunOp();
+
+  OpDefBuilder("Quantize", "QuantizeOutput")
+      .Input("Output")
+      .Output("ExpectedQuantizedOutput")
+      .OutputType({DT_UINT8})
+      .AddIntArg("T", DT_UINT8)
+      .AddIntArg("non_zero", true)
+      .Finalize(net.NewOperatorDef());
+  net.RunOp();
+
+  net.QuantizePerChannel("Weight", "QuantizedWeight", out_channel, false);
+  net.QuantizeBiasPerChannel("Bias", "QuantizedWeight",
+                             net.GetTensor("QuantizedInput")->scale(),
+                             "QuantizedBias");
+
+  OpDefBuilder("FullyConnected", "QuantizeFullyConnectedTest")
+      .Input("QuantizedInput")
+      .Input("QuantizedWeight")
+      .Input("QuantizedBias")
+      .Output("QuantizedOutput")
+      .AddIntArg("T", DT_UINT8)
+      .Finalize(net.NewOperatorDef());
+  net.Setup(RuntimeType::RT_CPU);
+  Tensor *eq_output = net.GetTensor("ExpectedQuantizedOutput");
+  Tensor *q_output = net.GetTensor("QuantizedOutput");
+  q_output->SetScale(eq_output->scale());
+  q_output->SetZeroPoint(eq_output->zero_point());
+  net.Run();
+
+  OpDefBuilder("Dequantize", "DeQuantizeTest")
+      .Input("QuantizedOutput")
+      .Output("DequantizedOutput")
+      .OutputType({DT_FLOAT})
+      .AddIntArg("T", DT_UINT8)
+      .Finalize(net.NewOperatorDef());
+  net.RunOp();
+
+  // Check
+  ExpectTensorSimilar<float>(*net.GetOutput("Output"),
+                             *net.GetTensor("DequantizedOutput"), 0.01);
+}
 }  // namespace
 
 TEST_F(FullyConnectedOpTest, Quant) {
@@ -313,6 +482,12 @@ TEST_F(FullyConnectedOpTest, Quant) {
   QuantRandom(1, 1, 1, 2048, 1024);
 }
 
+TEST_F(FullyConnectedOpTest, QuantPerChannel) {
+  QuantPerChannelRandom(1, 16, 16, 32, 16);
+  QuantPerChannelRandom(3, 7, 7, 32, 17);
+  QuantPerChannelRandom(1, 1, 1, 2048, 1024);
+}
+
 }  // namespace test
 }  // namespace ops
 }  // namespace mace
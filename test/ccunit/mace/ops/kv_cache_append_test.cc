@@ -0,0 +1,269 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include "mace/ops/ops_test_util.h"
+
+namespace mace {
+namespace ops {
+namespace test {
+
+class KVCacheAppendOpTest : public OpsTestBase {};
+
+namespace {
+void AddKVCacheAppend(const std::string &input, const std::string &cache,
+                      const int axis, const int capacity, OpsTestNet *net) {
+  OpDefBuilder("KVCacheAppend", cache + "Append")
+      .Input(input)
+      .AddIntArg("axis", axis)
+      .AddIntArg("capacity", capacity)
+      .Output(cache)
+      .Finalize(net->AddNewOperatorDef());
+}
+
+// Returns the live entries of the state `name`, packed.
+std::unique_ptr<Tensor> LiveEntries(OpsTestNet *net, const std::string &name) {
+  const std::vector<index_t> shape = net->ws()->ReadState(name, nullptr);
+  std::vector<float> data(std::accumulate(shape.begin(), shape.end(), 1,
+                                          std::multiplies<index_t>()));
+  net->ws()->ReadState(name, data.data());
+  return net->CreateTensor<float>(shape, data);
+}
+
+// Concatenates `tail` of `tail_shape` to `head` of `head_shape` along `axis`.
+std::vector<float> Concat(const std::vector<float> &head,
+                          const std::vector<index_t> &head_shape,
+                          const std::vector<float> &tail,
+                          const std::vector<index_t> &tail_shape,
+                          const index_t axis) {
+  const index_t outer = std::accumulate(
+      tail_shape.begin(), tail_shape.begin() + axis, 1,
+      std::multiplies<index_t>());
+  const index_t head_block = head.size() / outer;
+  const index_t tail_block = tail.size() / outer;
+  MACE_CHECK(head.empty() || head_shape.size() == tail_shape.size());
+  std::vector<float> result;
+  for (index_t o = 0; o < outer; ++o) {
+    result.insert(result.end(), head.begin() + o * head_block,
+                  head.begin() + (o + 1) * head_block);
+    result.insert(result.end(), tail.begin() + o * tail_block,
+                  tail.begin() + (o + 1) * tail_block);
+  }
+  return result;
+}
+
+void RandomAppend(const std::vector<index_t> &shape, const int axis,
+                  const std::vector<index_t> &lengths) {
+  const index_t rank = static_cast<index_t>(shape.size());
+  const index_t real_axis = axis < 0 ? axis + rank : axis;
+  const index_t capacity = std::accumulate(lengths.begin(), lengths.end(), 0);
+
+  OpsTestNet net;
+  AddKVCacheAppend("Input", "Cache", axis, capacity, &net);
+  std::vector<float> expected;
+  std::vector<index_t> expected_shape(shape);
+  expected_shape[real_axis] = 0;
+  for (index_t length : lengths) {
+    std::vector<index_t> input_shape(shape);
+    input_shape[real_axis] = length;
+    std::vector<float> input;
+    GenerateRandomRealTypeData<float>(input_shape, &input);
+    net.AddInputFromArray<RuntimeType::RT_CPU, float>("Input", input_shape,
+                                                      input);
+    net.RunOp(RuntimeType::RT_CPU);
+
+    expected = Concat(expected, expected_shape, input, input_shape,
+                      real_axis);
+    expected_shape[real_axis] += length;
+    auto expected_tensor = net.CreateTensor<float>(expected_shape, expected);
+    ExpectTensorNear<float>(*expected_tensor, *LiveEntries(&net, "Cache"));
+  }
+}
+}  // namespace
+
+TEST_F(KVCacheAppendOpTest, SimpleCPU) {
+  OpsTestNet net;
+  AddKVCacheAppend("Input", "Cache", -2, 4, &net);
+  net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "Input", {2, 2, 2}, {1, 2, 3, 4, 5, 6, 7, 8});
+  net.RunOp(RuntimeType::RT_CPU);
+  net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "Input", {2, 1, 2}, {10, 20, 30, 40});
+  net.RunOp(RuntimeType::RT_CPU);
+
+  auto expected = net.CreateTensor<float>(
+      {2, 3, 2}, {1, 2, 3, 4, 10, 20, 5, 6, 7, 8, 30, 40});
+  ExpectTensorNear<float>(*expected, *LiveEntries(&net, "Cache"));
+  // each block keeps room for the capacity, the entries not appended are 0
+  auto expected_cache = net.CreateTensor<float>(
+      {2, 4, 2}, {1, 2, 3, 4, 10, 20, 0, 0, 5, 6, 7, 8, 30, 40, 0, 0});
+  ExpectTensorNear<float>(*expected_cache, *net.GetOutput("Cache"));
+
+  // the capacity is 4 entries
+  net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "Input", {2, 2, 2}, {0, 0, 0, 0, 0, 0, 0, 0});
+  EXPECT_EQ(net.RunOp(RuntimeType::RT_CPU),
+            MaceStatus::MACE_OUT_OF_RESOURCES);
+  ExpectTensorNear<float>(*expected, *LiveEntries(&net, "Cache"));
+}
+
+TEST_F(KVCacheAppendOpTest, RandomCPU) {
+  RandomAppend({1, 4, 1, 16}, -2, {7, 1, 1, 1, 1});
+  RandomAppend({2, 3, 1, 5}, -2, {3, 1, 2, 1});
+  RandomAppend({1, 8}, 0, {5, 1, 1});
+  RandomAppend({3, 2, 4}, -1, {1, 2, 3});
+  RandomAppend({2, 3, 4}, 1, {2, 2, 2});
+}
+
+TEST_F(KVCacheAppendOpTest, InPlaceCPU) {
+  OpsTestNet net;
+  AddKVCacheAppend("Input", "Cache", -2, 64, &net);
+  net.AddRandomInput<RuntimeType::RT_CPU, float>("Input", {1, 2, 8, 4});
+  net.RunOp(RuntimeType::RT_CPU);
+  const float *data = net.GetOutput("Cache")->data<float>();
+  for (int i = 0; i < 8; ++i) {
+    net.AddRandomInput<RuntimeType::RT_CPU, float>("Input", {1, 2, 1, 4});
+    net.RunOp(RuntimeType::RT_CPU);
+    // the cache is appended to in the buffer reserved for its capacity
+    EXPECT_EQ(data, net.GetOutput("Cache")->data<float>());
+  }
+  EXPECT_EQ(16, net.ws()->StateLength("Cache"));
+  EXPECT_EQ(64, net.GetOutput("Cache")->dim(2));
+}
+
+TEST_F(KVCacheAppendOpTest, ResetCPU) {
+  OpsTestNet net;
+  AddKVCacheAppend("Input", "Cache", -2, 4, &net);
+  net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "Input", {1, 3, 2}, {1, 2, 3, 4, 5, 6});
+  net.RunOp(RuntimeType::RT_CPU);
+  net.ws()->ResetStates();
+  EXPECT_EQ(0, net.ws()->StateLength("Cache"));
+
+  // a new sequence may also have entries of another shape
+  net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "Input", {1, 4, 3}, {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12});
+  net.RunOp(RuntimeType::RT_CPU);
+  auto expected = net.CreateTensor<float>(
+      {1, 4, 3}, {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12});
+  ExpectTensorNear<float>(*expected, *LiveEntries(&net, "Cache"));
+}
+
+TEST_F(KVCacheAppendOpTest, DecodeAttentionCPU) {
+  const index_t heads = 2;
+  const index_t depth = 8;
+  const index_t steps = 6;
+
+  OpsTestNet net;
+  // attention skips the entries of the capacity not appended yet
+  AddKVCacheAppend("Key", "KeyCache", -2, steps + 2, &net);
+  AddKVCacheAppend("Value", "ValueCache", -2, steps + 2, &net);
+  OpDefBuilder("Attention", "DecodeAttention")
+      .Input("Query")
+      .Input("KeyCache")
+      .Input("ValueCache")
+      .AddIntArg("transpose_k", 1)
+      .Output("Output")
+      .Finalize(net.AddNewOperatorDef());
+
+  std::vector<float> keys;
+  std::vector<float> values;
+  std::vector<index_t> cache_shape = {1, heads, 0, depth};
+  const std::vector<index_t> step_shape = {1, heads, 1, depth};
+  for (index_t t = 0; t < steps; ++t) {
+    std::vector<float> query;
+    std::vector<float> key;
+    std::vector<float> value;
+    GenerateRandomRealTypeData<float>(step_shape, &query);
+    GenerateRandomRealTypeData<float>(step_shape, &key);
+    GenerateRandomRealTypeData<float>(step_shape, &value);
+    net.AddInputFromArray<RuntimeType::RT_CPU, float>("Query", step_shape,
+                                                      query);
+    net.AddInputFromArray<RuntimeType::RT_CPU, float>("Key", step_shape, key);
+    net.AddInputFromArray<RuntimeType::RT_CPU, float>("Value", step_shape,
+                                                      value);
+    net.RunOp(RuntimeType::RT_CPU);
+
+    // attend to the keys and values of all the steps so far at once
+    keys = Concat(keys, cache_shape, key, step_shape, 2);
+    values = Concat(values, cache_shape, value, step_shape, 2);
+    cache_shape[2] += 1;
+    OpsTestNet expected_net;
+    expected_net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+        "Query", step_shape, query);
+    expected_net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+        "Key", cache_shape, keys);
+    expected_net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+        "Value", cache_shape, values);
+    OpDefBuilder("Attention", "Attention")
+        .Input("Query")
+        .Input("Key")
+        .Input("Value")
+        .AddIntArg("transpose_k", 1)
+        .Output("Output")
+        .Finalize(expected_net.NewOperatorDef());
+    expected_net.RunOp(RuntimeType::RT_CPU);
+    ExpectTensorNear<float>(*expected_net.GetOutput("Output"),
+                            *net.GetOutput("Output"), 1e-5, 1e-4);
+  }
+}
+
+TEST_F(KVCacheAppendOpTest, NonAttentionConsumerCPU) {
+  OpsTestNet net;
+  // MatMul would read the capacity of the cache past its live entries
+  AddKVCacheAppend("Key", "KeyCache", -2, 8, &net);
+  OpDefBuilder("MatMul", "Scores")
+      .Input("Query")
+      .Input("KeyCache")
+      .AddIntArg("transpose_b", 1)
+      .Output("Output")
+      .Finalize(net.AddNewOperatorDef());
+  net.AddRandomInput<RuntimeType::RT_CPU, float>("Query", {1, 2, 1, 4});
+  net.AddRandomInput<RuntimeType::RT_CPU, float>("Key", {1, 2, 1, 4});
+  EXPECT_FALSE(net.Setup(RuntimeType::RT_CPU));
+}
+
+#ifdef MACE_ENABLE_BFLOAT16
+TEST_F(KVCacheAppendOpTest, BFloat16) {
+  OpsTestNet net;
+  OpDefBuilder("KVCacheAppend", "BF16KVCacheAppendTest")
+      .Input("BF16Input")
+      .AddIntArg("capacity", 8)
+      .AddIntArg("T", static_cast<int>(DT_BFLOAT16))
+      .Output("BF16Cache")
+      .Finalize(net.NewOperatorDef());
+  net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "Input", {2, 1, 2}, {1, 2, 3, 4});
+  net.Cast<RuntimeType::RT_CPU, float, BFloat16>("Input", "BF16Input");
+  net.RunOp(RuntimeType::RT_CPU);
+  net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "Input", {2, 1, 2}, {5, 6, 7, 8});
+  net.Cast<RuntimeType::RT_CPU, float, BFloat16>("Input", "BF16Input");
+  net.RunOp(RuntimeType::RT_CPU);
+
+  net.Cast<RuntimeType::RT_CPU, BFloat16, float>("BF16Cache", "Cache");
+  auto expected = net.CreateTensor<float>(
+      {2, 8, 2}, {1, 2, 5, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                  3, 4, 7, 8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0});
+  ExpectTensorNear<float>(*expected, *net.GetTensor("Cache"));
+}
+#endif  // MACE_ENABLE_BFLOAT16
+
+}  // namespace test
+}  // namespace ops
+}  // namespace mace
@@ -0,0 +1,204 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <functional>
+#include <numeric>
+#include <vector>
+
+#include "mace/ops/ops_test_util.h"
+
+namespace mace {
+namespace ops {
+namespace test {
+
+class LayerNormOpTest : public OpsTestBase {};
+
+namespace {
+
+// Normalizes the rows of `size` elements in two passes.
+std::vector<float> ReferenceLayerNorm(const std::vector<float> &input,
+                                      const std::vector<float> &gamma,
+                                      const std::vector<float> &beta,
+                                      const index_t size,
+                                      const float epsilon,
+                                      const bool rms) {
+  std::vector<float> output(input.size());
+  const index_t rows = static_cast<index_t>(input.size()) / size;
+  for (index_t r = 0; r < rows; ++r) {
+    const float *row = input.data() + r * size;
+    double mean = 0;
+    if (!rms) {
+      for (index_t i = 0; i < size; ++i) {
+        mean += row[i];
+      }
+      mean /= size;
+    }
+    double variance = 0;
+    for (index_t i = 0; i < size; ++i) {
+      variance += (row[i] - mean) * (row[i] - mean);
+    }
+    variance /= size;
+    const double rstd = 1 / std::sqrt(variance + epsilon);
+    for (index_t i = 0; i < size; ++i) {
+      float value = static_cast<float>((row[i] - mean) * rstd);
+      if (!gamma.empty()) {
+        value *= gamma[i];
+      }
+      if (!beta.empty()) {
+        value += beta[i];
+      }
+      output[r * size + i] = value;
+    }
+  }
+  return output;
+}
+
+void RandomLayerNorm(const std::vector<index_t> &shape,
+                     const int axis,
+                     const bool with_gamma,
+                     const bool with_beta,
+                     const bool rms,
+                     const float offset = 0.f) {
+  const index_t rank = static_cast<index_t>(shape.size());
+  const index_t begin = axis < 0 ? axis + rank : axis;
+  const std::vector<index_t> norm_shape(shape.begin() + begin, shape.end());
+  const index_t size = std::accumulate(norm_shape.begin(), norm_shape.end(),
+                                       1, std::multiplies<index_t>());
+  std::vector<float> input;
+  GenerateRandomRealTypeData<float>(shape, &input);
+  for (auto &value : input) {
+    value += offset;
+  }
+  std::vector<float> gamma;
+  std::vector<float> beta;
+
+  OpsTestNet net;
+  net.AddInputFromArray<RuntimeType::RT_CPU, float>("Input", shape, input);
+  OpDefBuilder builder("LayerNorm", "LayerNormTest");
+  builder.Input("Input");
+  if (with_gamma || with_beta) {
+    GenerateRandomRealTypeData<float>(norm_shape, &gamma);
+    net.AddInputFromArray<RuntimeType::RT_CPU, float>("Gamma", norm_shape,
+                                                      gamma, true);
+    builder.Input("Gamma");
+  }
+  if (with_beta) {
+    GenerateRandomRealTypeData<float>(norm_shape, &beta);
+    net.AddInputFromArray<RuntimeType::RT_CPU, float>("Beta", norm_shape,
+                                                      beta, true);
+    builder.Input("Beta");
+  }
+  builder.AddIntArg("axis", axis)
+      .AddFloatArg("epsilon", 1e-5)
+      .AddIntArg("rms", rms)
+      .Output("Output")
+      .Finalize(net.NewOperatorDef());
+  net.RunOp(RuntimeType::RT_CPU);
+
+  net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "Expected", shape,
+      ReferenceLayerNorm(input, gamma, beta, size, 1e-5, rms));
+  ExpectTensorNear<float>(*net.GetOutput("Expected"),
+                          *net.GetOutput("Output"), 1e-4, 1e-4);
+}
+
+}  // namespace
+
+TEST_F(LayerNormOpTest, SimpleCPU) {
+  OpsTestNet net;
+  net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "Input", {2, 4}, {1, 2, 3, 4, -2, -2, 2, 2});
+  net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "Gamma", {4}, {1, 1, 2, 2}, true);
+  net.AddInputFromArray<RuntimeType::RT_CPU, float>(
+      "Beta", {4}, {0, 1, 0, 1}, true);
+  OpDefBuilder("LayerNorm", "LayerNormTest")
+      .Input("Input")
+      .Input("Gamma")
+      .Input("Beta")
+      .AddFloatArg("epsilon", 0)
+      .Output("Output")
+      .Finalize(net.NewOperatorDef());
+  net.RunOp(RuntimeType::RT_CPU);
+
+  // the rows have the means 2.5 and 0, and the variances 1.25 and 4
+  const float a = 1.5f / std::sqrt(1.25f);
+  const float b = 0.5f / std::sqrt(1.25f);
+  auto expected = net.CreateTensor<float>(
+      {2, 4}, {-a, 1 - b, 2 * b, 2 * a + 1, -1, 0, 2, 3});
+  ExpectTensorNear<float>(*expected, *net.GetOutput("Output"), 1e-5, 1e-5);
+}
+
+TEST_F(LayerNormOpTest, RandomCPU) {
+  RandomLayerNorm({3, 5, 64}, -1, true, true, false);
+  RandomLayerNorm({2, 7, 13}, -1, true, true, false);
+  RandomLayerNorm({4, 3}, 1, false, false, false);
+  RandomLayerNorm({2, 3, 4, 5}, 2, true, false, false);
+  RandomLayerNorm({2, 3, 4, 5}, 1, true, true, false);
+  RandomLayerNorm({1, 3, 768}, -1, true, true, false);
+}
+
+TEST_F(LayerNormOpTest, LargeMeanCPU) {
+  // mean(x^2) - mean(x)^2 would lose the variance to cancellation here
+  RandomLayerNorm({4, 1000}, -1, true, true, false, 100.f);
+  RandomLayerNorm({4, 37}, -1, false, false, false, 100.f);
+}
+
+TEST_F(LayerNormOpTest, RMSCPU) {
+  RandomLayerNorm({3, 5, 64}, -1, true, false, true);
+  RandomLayerNorm({2, 7, 13}, -1, true, true, true);
+  RandomLayerNorm({2, 3, 4, 5}, 2, false, false, true);
+}
+
+#ifdef MACE_ENABLE_BFLOAT16
+TEST_F(LayerNormOpTest, BFloat16) {
+  OpsTestNet net;
+  net.AddRandomInput<RuntimeType::RT_CPU, float>("Input", {3, 4, 64});
+  net.AddRandomInput<RuntimeType::RT_CPU, float>("Gamma", {64}, true);
+  net.AddRandomInput<RuntimeType::RT_CPU, float>("Beta", {64}, true);
+  net.Cast<RuntimeType::RT_CPU, float, BFloat16>("Input", "BF16Input");
+  net.Cast<RuntimeType::RT_CPU, float, BFloat16>("Gamma", "BF16Gamma");
+  net.Cast<RuntimeType::RT_CPU, float, BFloat16>("Beta", "BF16Beta");
+  net.Cast<RuntimeType::RT_CPU, BFloat16, float>("BF16Input", "CastInput");
+  net.Cast<RuntimeType::RT_CPU, BFloat16, float>("BF16Gamma", "CastGamma");
+  net.Cast<RuntimeType::RT_CPU, BFloat16, float>("BF16Beta", "CastBeta");
+
+  OpDefBuilder("LayerNorm", "LayerNormTest")
+      .Input("CastInput")
+      .Input("CastGamma")
+      .Input("CastBeta")
+      .Output("Output")
+      .AddIntArg("T", static_cast<int>(DT_FLOAT))
+      .Finalize(net.NewOperatorDef());
+  net.RunOp(RuntimeType::RT_CPU);
+
+  OpDefBuilder("LayerNorm", "BF16LayerNormTest")
+      .Input("BF16Input")
+      .Input("BF16Gamma")
+      .Input("BF16Beta")
+      .Output("BF16Output")
+      .AddIntArg("T", static_cast<int>(DT_BFLOAT16))
+      .Finalize(net.NewOperatorDef());
+  net.RunOp(RuntimeType::RT_CPU);
+
+  net.Cast<RuntimeType::RT_CPU, BFloat16, float>("BF16Output", "CastOutput");
+  ExpectTensorNear<float>(*net.GetOutput("Output"),
+                          *net.GetTensor("CastOutput"), 1e-2, 1e-2);
+}
+#endif  // MACE_ENABLE_BFLOAT16
+
+}  // namespace test
+}  // namespace ops
+}  // namespace mace
@@ -253,6 +253,92 @@ void QuantOutputUint8(const std::vector<index_t> &batch,
                              *net.GetTensor("DequantizedOutput"), 0.01);
 }
 
+void QuantPerChannel(const std::vector<index_t> &batch,
+                     const index_t rows,
+                     const index_t depth,
+                     const index_t cols,
+                     const bool transpose_lhs,
+                     const bool transpose_rhs) {
+  // Construct graph
+  OpsTestNet net;
+
+  // Add input data, rhs is a weight quantized per output column
+  index_t lhs_rows = transpose_lhs ? depth : rows;
+  index_t lhs_cols = transpose_lhs ? rows : depth;
+  index_t rhs_rows = transpose_rhs ? cols : depth;
+  index_t rhs_cols = transpose_rhs ? depth : cols;
+  std::vector<index_t> lhs_shape = {lhs_rows, lhs_cols};
+  lhs_shape.insert(lhs_shape.begin(), batch.begin(), batch.end());
+  net.AddRandomInput<RuntimeType::RT_CPU, float>("A", lhs_shape, false, false);
+  net.AddRandomInput<RuntimeType::RT_CPU, float>(
+      "B", {rhs_rows, rhs_cols}, true, false);
+  // give the output columns different ranges
+  Tensor *rhs = net.GetTensor("B");
+  float *rhs_data = rhs->mutable_data<float>();
+  for (index_t i = 0; i < rhs->size(); ++i) {
+    const index_t col = transpose_rhs ? i / depth : i % cols;
+    rhs_data[i] *= 1 + col % 8;
+  }
+
+  OpDefBuilder("MatMul", "MatMulTest")
+      .Input("A")
+      .AddIntArg("transpose_a", transpose_lhs ? 1 : 0)
+      .Input("B")
+      .AddIntArg("transpose_b", transpose_rhs ? 1 : 0)
+      .Output("Output")
+      .AddIntArg("T", DT_FLOAT)
+      .Finalize(net.NewOperatorDef());
+  net.RunOp(RuntimeType::RT_CPU);
+
+  OpDefBuilder("Quantize", "QuantizeA")
+      .Input("A")
+      .Output("QuantizedA")
+      .OutputType({DT_UINT8})
+      .AddIntArg("T", DT_UINT8)
+      .AddIntArg("non_zero", true)
+      .Finalize(net.NewOperatorDef());
+  net.RunOp();
+
+  OpDefBuilder("Quantize", "QuantizeOutput")
+      .Input("Output")
+      .Output("ExpectedQuantizedOutput")
+      .OutputType({DT_UINT8})
+      .AddIntArg("T", DT_UINT8)
+      .AddIntArg("non_zero", true)
+      .Finalize(net.NewOperatorDef());
+  net.RunOp();
+
+  net.QuantizePerChannel("B", "QuantizedB", cols, !transpose_rhs);
+
+  OpDefBuilder("MatMul", "QuantizeMatMulTest")
+      .Input("QuantizedA")
+      .AddIntArg("transpose_a", transpose_lhs ? 1 : 0)
+      .Input("QuantizedB")
+      .AddIntArg("transpose_b", transpose_rhs ? 1 : 0)
+      .Output("QuantizedOutput")
+      .AddIntArg("T", DT_UINT8)
+      .OutputType({DT_UINT8})
+      .Finalize(net.NewOperatorDef());
+  net.Setup(RuntimeType::RT_CPU);
+  Tensor *eq_output = net.GetTensor("ExpectedQuantizedOutput");
+  Tensor *q_output = net.GetTensor("QuantizedOutput");
+  q_output->SetScale(eq_output->scale());
+  q_output->SetZeroPoint(eq_output->zero_point());
+  net.Run();
+
+  OpDefBuilder("Dequantize", "DeQuantizeTest")
+      .Input("QuantizedOutput")
+      .Output("DequantizedOutput")
+      .OutputType({DT_FLOAT})
+      .AddIntArg("T", DT_UINT8)
+      .Finalize(net.NewOperatorDef());
+  net.RunOp();
+
+  // Check
+  ExpectTensorSimilar<float>(*net.GetOutput("Output"),
+                             *net.GetTensor("DequantizedOutput"), 0.01);
+}
+
 void QuantOutputInt32(const std::vector<index_t> &batch,
                       const index_t rows,
                       const index_t depth,
@@ -425,6 +511,13 @@ TEST_F(MatMulOpTest, QuantOutputUint8) {
   QuantOutputUint8({2, 3}, 31, 61, 67, true, true, false, true);
 }
 
+TEST_F(MatMulOpTest, QuantPerChannel) {
+  QuantPerChannel({1}, 64, 128, 32, false, false);
+  QuantPerChannel({1}, 64, 128, 32, false, true);
+  QuantPerChannel({2, 3}, 31, 61, 67, true, false);
+  QuantPerChannel({2}, 1, 256, 128, true, true);
+}
+
 TEST_F(MatMulOpTest, QuantOutputInt32) {
   QuantOutputInt32({1}, 64, 128, 32, false, false);
   QuantOutputInt32({1}, 64, 32, 128, false, false);
@@ -0,0 +1,177 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mace/ops/delegator/vector_math.h"
+#include "mace/ops/ops_test_util.h"
+
+#ifdef MACE_ENABLE_X86
+#include "mace/ops/x86/cpu_isa_test_util.h"
+#endif  // MACE_ENABLE_X86
+
+namespace mace {
+namespace ops {
+namespace test {
+
+namespace {
+
+const float kEluAlpha = 1.5f;
+
+// Distance between two floats in units in the last place, 0 for two NaNs.
+int64_t UlpDistance(const float a, const float b) {
+  if (std::isnan(a) || std::isnan(b)) {
+    return std::isnan(a) && std::isnan(b) ? 0
+                                          : std::numeric_limits<int64_t>::max();
+  }
+  int32_t ia, ib;
+  memcpy(&ia, &a, sizeof(ia));
+  memcpy(&ib, &b, sizeof(ib));
+  // two's complement order for the sign-magnitude floats
+  const int64_t oa = ia < 0 ? -static_cast<int64_t>(ia & 0x7fffffff) : ia;
+  const int64_t ob = ib < 0 ? -static_cast<int64_t>(ib & 0x7fffffff) : ib;
+  return oa > ob ? oa - ob : ob - oa;
+}
+
+// Samples all the float magnitudes with a fixed stride, of both signs, plus
+// special values.
+std::vector<float> SampleInputs() {
+  std::vector<float> inputs;
+  for (uint32_t bits = 0; bits < 0x7f800000u; bits += 9973) {
+    float x;
+    memcpy(&x, &bits, sizeof(x));
+    inputs.push_back(x);
+    inputs.push_back(-x);
+  }
+  for (float x : {0.f, -0.f, 1.f, -1.f, 0.5f, -0.5f, 88.72f, 89.f, -104.f,
+                  std::numeric_limits<float>::min(),
+                  std::numeric_limits<float>::denorm_min(),
+                  std::numeric_limits<float>::max(),
+                  std::numeric_limits<float>::infinity(),
+                  -std::numeric_limits<float>::infinity(),
+                  std::numeric_limits<float>::quiet_NaN()}) {
+    inputs.push_back(x);
+  }
+  return inputs;
+}
+
+template<typename Compute, typename Reference>
+void CheckUlp(const std::string &name,
+              const std::vector<float> &inputs,
+              const int64_t max_ulp,
+              Compute compute,
+              Reference reference) {
+  std::vector<float> outputs(inputs.size());
+  compute(inputs.data(), static_cast<index_t>(inputs.size()), outputs.data());
+  int64_t worst = 0;
+  float worst_input = 0;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    const float expected =
+        static_cast<float>(reference(static_cast<double>(inputs[i])));
+    const int64_t ulp = UlpDistance(outputs[i], expected);
+    if (ulp > worst) {
+      worst = ulp;
+      worst_input = inputs[i];
+    }
+  }
+  EXPECT_LE(worst, max_ulp) << name << " at " << worst_input;
+}
+
+void TestVectorMath(delegator::VectorMath *vector_math) {
+  using namespace std::placeholders;  // NOLINT(build/namespaces)
+  const std::vector<float> inputs = SampleInputs();
+
+  CheckUlp("Exp", inputs, 2,
+           std::bind(&delegator::VectorMath::Exp, vector_math, _1, _2, _3),
+           [](double x) { return std::exp(x); });
+  CheckUlp("Log", inputs, 2,
+           std::bind(&delegator::VectorMath::Log, vector_math, _1, _2, _3),
+           [](double x) { return std::log(x); });
+  CheckUlp("Tanh", inputs, 3,
+           std::bind(&delegator::VectorMath::Tanh, vector_math, _1, _2, _3),
+           [](double x) { return std::tanh(x); });
+  CheckUlp("Sigmoid", inputs, 3,
+           std::bind(&delegator::VectorMath::Sigmoid, vector_math,
+                     _1, _2, _3),
+           [](double x) { return 1 / (1 + std::exp(-x)); });
+  CheckUlp("Erf", inputs, 8,
+           std::bind(&delegator::VectorMath::Erf, vector_math, _1, _2, _3),
+           [](double x) { return std::erf(x); });
+  CheckUlp("Elu", inputs, 3,
+           std::bind(&delegator::VectorMath::Elu, vector_math,
+                     _1, _2, kEluAlpha, _3),
+           [](double x) { return x < 0 ? kEluAlpha * std::expm1(x) : x; });
+
+  // tails and in-place computation give the same results
+  std::vector<float> outputs(inputs.size());
+  vector_math->Tanh(inputs.data(), static_cast<index_t>(inputs.size()),
+                    outputs.data());
+  for (index_t size = 1; size < 40; size += 3) {
+    std::vector<float> data(inputs.end() - size, inputs.end());
+    vector_math->Tanh(data.data(), size, data.data());
+    for (index_t i = 0; i < size; ++i) {
+      EXPECT_EQ(0, UlpDistance(outputs[inputs.size() - size + i], data[i]));
+    }
+  }
+}
+
+}  // namespace
+
+class VectorMathTest : public OpsTestBase {};
+
+TEST_F(VectorMathTest, Ref) {
+  OpsTestNet net;
+  std::unique_ptr<delegator::VectorMath> vector_math =
+      delegator::VectorMath::Create(
+          net.ws(), MACE_DELEGATOR_KEY(VectorMath, RuntimeType::RT_CPU,
+                                       float, ImplType::REF),
+          DelegatorParam());
+  TestVectorMath(vector_math.get());
+}
+
+TEST_F(VectorMathTest, Cpu) {
+  OpsTestNet net;
+  std::unique_ptr<delegator::VectorMath> vector_math =
+      delegator::VectorMath::Create(
+          net.ws(), MACE_DELEGATOR_KEY(VectorMath, RuntimeType::RT_CPU,
+                                       float, kCpuImplType),
+          DelegatorParam());
+  TestVectorMath(vector_math.get());
+}
+
+#ifdef MACE_ENABLE_X86
+TEST_F(VectorMathTest, X86Isas) {
+  for (CPUIsa isa : HostX86Isas()) {
+    CPUIsaWorkspace isa_ws(isa);
+    std::unique_ptr<delegator::VectorMath> vector_math =
+        delegator::VectorMath::Create(
+            isa_ws.ws(), MACE_DELEGATOR_KEY(VectorMath, RuntimeType::RT_CPU,
+                                            float, ImplType::X86),
+            DelegatorParam());
+    TestVectorMath(vector_math.get());
+  }
+}
+#endif  // MACE_ENABLE_X86
+
+}  // namespace test
+}  // namespace ops
+}  // namespace mace
@@ -0,0 +1,178 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "mace/core/ops/op_context.h"
+#include "mace/core/tensor.h"
+#include "mace/ops/common/epilogue.h"
+#include "mace/ops/delegator/conv_2d.h"
+#include "mace/ops/ops_test_util.h"
+#include "mace/ops/testing/test_utils.h"
+#include "mace/ops/x86/cpu_isa_test_util.h"
+
+namespace mace {
+namespace ops {
+namespace test {
+
+void TestConv2dFloat32(const DelegatorInfo &key,
+                       const index_t batch,
+                       const index_t in_channels,
+                       const index_t height,
+                       const index_t width,
+                       const index_t out_channels,
+                       const index_t kernel_h,
+                       const index_t kernel_w,
+                       const int stride,
+                       const int dilation,
+                       const Padding padding) {
+  auto *cpu_runtime = OpTestContext::Get()->GetRuntime(RuntimeType::RT_CPU);
+  Tensor input(cpu_runtime, DataType::DT_FLOAT);
+  Tensor filter(cpu_runtime, DataType::DT_FLOAT);
+  Tensor bias(cpu_runtime, DataType::DT_FLOAT);
+  Tensor output(cpu_runtime, DataType::DT_FLOAT);
+  Tensor expected_output(cpu_runtime, DataType::DT_FLOAT);
+  input.Resize({batch, in_channels, height, width});
+  filter.Resize({out_channels, in_channels, kernel_h, kernel_w});
+  bias.Resize({out_channels});
+  {
+    Tensor::MappingGuard input_guard(&input);
+    Tensor::MappingGuard filter_guard(&filter);
+    Tensor::MappingGuard bias_guard(&bias);
+    float *input_data = input.mutable_data<float>();
+    float *filter_data = filter.mutable_data<float>();
+    float *bias_data = bias.mutable_data<float>();
+    GenerateRandomRealTypeData<float>(input.shape(), input_data);
+    GenerateRandomRealTypeData<float>(filter.shape(), filter_data);
+    GenerateRandomRealTypeData<float>(bias.shape(), bias_data);
+  }
+
+  const std::vector<int> strides = {stride, stride};
+  const std::vector<int> dilations = {dilation, dilation};
+  const std::vector<int> paddings;
+  delegator::Conv2dParam param(strides, dilations, paddings, padding);
+
+  OpsTestNet net;
+  OpContext ref_context(net.ws(), cpu_runtime);
+  std::unique_ptr<delegator::Conv2d> conv2d_ref = delegator::Conv2d::Create(
+      ref_context.workspace(), MACE_DELEGATOR_KEY(
+      Conv2d, RuntimeType::RT_CPU, float, ImplType::REF), param);
+  conv2d_ref->Compute(&ref_context, &input, &filter, &expected_output);
+
+  for (CPUIsa isa : HostX86Isas()) {
+    CPUIsaWorkspace isa_ws(isa);
+    OpContext context(isa_ws.ws(), cpu_runtime);
+    std::unique_ptr<delegator::Conv2d> conv2d =
+        delegator::Conv2d::Create(context.workspace(), key, param);
+    conv2d->Compute(&context, &input, &filter, &output);
+
+    ExpectTensorNear<float>(expected_output, output, 1e-4, 1e-3);
+  }
+
+  // bias and relux fused into the output stage
+  Epilogue epilogue;
+  epilogue.bias = &bias;
+  epilogue.activation = RELUX;
+  epilogue.max_limit = 0.5f;
+  delegator::Conv2dParam fused_param(strides, dilations, paddings, padding,
+                                     epilogue);
+  {
+    const float *bias_data = bias.data<float>();
+    float *expected_data = expected_output.mutable_data<float>();
+    const index_t image_size = expected_output.dim(2) * expected_output.dim(3);
+    for (index_t i = 0; i < expected_output.size(); ++i) {
+      const float value =
+          expected_data[i] + bias_data[(i / image_size) % out_channels];
+      expected_data[i] = std::max(0.f, std::min(0.5f, value));
+    }
+  }
+
+  std::unique_ptr<delegator::Conv2d> fused_ref = delegator::Conv2d::Create(
+      ref_context.workspace(), MACE_DELEGATOR_KEY(
+      Conv2d, RuntimeType::RT_CPU, float, ImplType::REF), fused_param);
+  EXPECT_TRUE(fused_ref->FusesEpilogue());
+  fused_ref->Compute(&ref_context, &input, &filter, &output);
+  ExpectTensorNear<float>(expected_output, output, 1e-4, 1e-3);
+
+  for (CPUIsa isa : HostX86Isas()) {
+    CPUIsaWorkspace isa_ws(isa);
+    OpContext context(isa_ws.ws(), cpu_runtime);
+    std::unique_ptr<delegator::Conv2d> conv2d =
+        delegator::Conv2d::Create(context.workspace(), key, fused_param);
+    EXPECT_TRUE(conv2d->FusesEpilogue());
+    conv2d->Compute(&context, &input, &filter, &output);
+
+    ExpectTensorNear<float>(expected_output, output, 1e-4, 1e-3);
+  }
+}
+
+#define MACE_X86_CONV_KEY(tag)                                 \
+  MACE_DELEGATOR_KEY_EX(Conv2d, RuntimeType::RT_CPU, float,    \
+                        ImplType::X86, tag)
+
+TEST(X86Conv2d, TestConv2dK1x1) {
+  const DelegatorInfo key = MACE_X86_CONV_KEY(K1x1);
+  TestConv2dFloat32(key, 1, 3, 16, 16, 8, 1, 1, 1, 1, VALID);
+  TestConv2dFloat32(key, 2, 64, 28, 28, 128, 1, 1, 1, 1, SAME);
+  TestConv2dFloat32(key, 1, 31, 7, 9, 33, 1, 1, 1, 1, VALID);
+}
+
+TEST(X86Conv2d, TestConv2dK3x3Winograd) {
+  const DelegatorInfo key = MACE_X86_CONV_KEY(K3x3Winograd);
+  TestConv2dFloat32(key, 1, 8, 16, 16, 8, 3, 3, 1, 1, VALID);
+  TestConv2dFloat32(key, 1, 8, 16, 16, 8, 3, 3, 1, 1, SAME);
+  TestConv2dFloat32(key, 2, 32, 57, 43, 35, 3, 3, 1, 1, SAME);
+  TestConv2dFloat32(key, 1, 16, 71, 69, 16, 3, 3, 1, 1, VALID);
+}
+
+TEST(X86Conv2d, TestConv2dKMxN) {
+  TestConv2dFloat32(MACE_X86_CONV_KEY(K3x3S1),
+                    1, 3, 32, 32, 16, 3, 3, 1, 1, SAME);
+  TestConv2dFloat32(MACE_X86_CONV_KEY(K3x3S2),
+                    2, 16, 33, 31, 30, 3, 3, 2, 1, SAME);
+  TestConv2dFloat32(MACE_X86_CONV_KEY(K5x5S1),
+                    1, 7, 23, 29, 9, 5, 5, 1, 1, VALID);
+  TestConv2dFloat32(MACE_X86_CONV_KEY(K7x7S1),
+                    1, 5, 37, 41, 6, 7, 7, 1, 1, SAME);
+  TestConv2dFloat32(MACE_X86_CONV_KEY(K7x7S2),
+                    1, 3, 224, 224, 64, 7, 7, 2, 1, SAME);
+  TestConv2dFloat32(MACE_X86_CONV_KEY(K7x7S3),
+                    1, 4, 45, 47, 5, 7, 7, 3, 1, VALID);
+  TestConv2dFloat32(MACE_X86_CONV_KEY(K1x7S1),
+                    1, 6, 17, 35, 7, 1, 7, 1, 1, SAME);
+  TestConv2dFloat32(MACE_X86_CONV_KEY(K7x1S1),
+                    1, 6, 35, 17, 7, 7, 1, 1, 1, SAME);
+  TestConv2dFloat32(MACE_X86_CONV_KEY(K1x15S1),
+                    1, 4, 19, 40, 5, 1, 15, 1, 1, SAME);
+  TestConv2dFloat32(MACE_X86_CONV_KEY(K15x1S1),
+                    1, 4, 40, 19, 5, 15, 1, 1, 1, SAME);
+}
+
+TEST(X86Conv2d, TestConv2dGeneral) {
+  const DelegatorInfo key =
+      MACE_DELEGATOR_KEY(Conv2d, RuntimeType::RT_CPU, float, ImplType::X86);
+  TestConv2dFloat32(key, 1, 3, 32, 32, 16, 3, 3, 1, 2, SAME);
+  TestConv2dFloat32(key, 2, 8, 31, 29, 12, 3, 3, 2, 1, VALID);
+  TestConv2dFloat32(key, 1, 5, 20, 20, 7, 4, 4, 3, 1, SAME);
+  TestConv2dFloat32(key, 1, 6, 25, 27, 9, 5, 3, 1, 3, VALID);
+}
+
+#undef MACE_X86_CONV_KEY
+
+}  // namespace test
+}  // namespace ops
+}  // namespace mace
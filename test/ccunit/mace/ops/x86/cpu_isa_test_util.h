@@ -0,0 +1,62 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MACE_OPS_X86_CPU_ISA_TEST_UTIL_H_
+#define MACE_OPS_X86_CPU_ISA_TEST_UTIL_H_
+
+#include <vector>
+
+#include "mace/core/registry/op_delegator_registry.h"
+#include "mace/core/workspace.h"
+#include "mace/ops/registry/registry.h"
+#include "mace/public/mace.h"
+#include "mace/utils/cpu_isa.h"
+
+namespace mace {
+namespace ops {
+namespace test {
+
+// Workspace whose delegator registry is pinned to one CPU ISA, so that the
+// kernels of every ISA the host supports get tested.
+class CPUIsaWorkspace {
+ public:
+  explicit CPUIsaWorkspace(CPUIsa isa) : ws_(&registry_, nullptr) {
+    RegisterAllOpDelegators(&registry_);
+    registry_.SetCPUIsa(isa);
+  }
+
+  Workspace *ws() { return &ws_; }
+
+ private:
+  OpDelegatorRegistry registry_;
+  Workspace ws_;
+};
+
+// The x86 ISAs with kernels, up to the best one supported by the host.
+inline std::vector<CPUIsa> HostX86Isas() {
+  std::vector<CPUIsa> isas;
+  for (CPUIsa isa : {CPUIsa::CPU_ISA_SSE42, CPUIsa::CPU_ISA_AVX2,
+                     CPUIsa::CPU_ISA_AVX512, CPUIsa::CPU_ISA_AVX512_VNNI}) {
+    if (isa <= utils::GetHostCPUIsa()) {
+      isas.push_back(isa);
+    }
+  }
+  return isas;
+}
+
+}  // namespace test
+}  // namespace ops
+}  // namespace mace
+
+#endif  // MACE_OPS_X86_CPU_ISA_TEST_UTIL_H_
@@ -0,0 +1,123 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+
+#include "mace/core/ops/op_context.h"
+#include "mace/core/tensor.h"
+#include "mace/ops/delegator/gemv.h"
+#include "mace/ops/ops_test_util.h"
+#include "mace/ops/testing/test_utils.h"
+#include "mace/ops/x86/cpu_isa_test_util.h"
+
+namespace mace {
+namespace ops {
+namespace test {
+
+// A DT_HALF lhs is a compressed weight, converted by the gemv as it reads it.
+void TestGemvFloat32(const index_t batch,
+                     const index_t height,
+                     const index_t width,
+                     const bool lhs_batched,
+                     const bool rhs_batched,
+                     const DataType lhs_type = DataType::DT_FLOAT) {
+  auto *cpu_runtime = OpTestContext::Get()->GetRuntime(RuntimeType::RT_CPU);
+  Tensor lhs(cpu_runtime, lhs_type, {}, lhs_type == DataType::DT_HALF);
+  Tensor rhs(cpu_runtime, DataType::DT_FLOAT);
+  Tensor bias(cpu_runtime, DataType::DT_FLOAT);
+  Tensor output(cpu_runtime, DataType::DT_FLOAT);
+  lhs.Resize({lhs_batched ? batch : 1, height, width});
+  rhs.Resize({rhs_batched ? batch : 1, width});
+  bias.Resize({height});
+  output.Resize({batch, height});
+  {
+    Tensor::MappingGuard lhs_guard(&lhs);
+    Tensor::MappingGuard rhs_guard(&rhs);
+    Tensor::MappingGuard bias_guard(&bias);
+    float *rhs_data = rhs.mutable_data<float>();
+    float *bias_data = bias.mutable_data<float>();
+    if (lhs_type == DataType::DT_HALF) {
+      GenerateRandomRealTypeData<half>(lhs.shape(), lhs.mutable_data<half>());
+    } else {
+      GenerateRandomRealTypeData<float>(lhs.shape(),
+                                        lhs.mutable_data<float>());
+    }
+    GenerateRandomRealTypeData<float>(rhs.shape(), rhs_data);
+    GenerateRandomRealTypeData<float>(bias.shape(), bias_data);
+  }
+
+  OpsTestNet net;
+  OpContext ref_context(net.ws(), cpu_runtime);
+  Tensor expected_output(cpu_runtime, DataType::DT_FLOAT);
+  expected_output.Resize({batch, height});
+  std::unique_ptr<delegator::Gemv> gemv_ref = delegator::Gemv::Create(
+      ref_context.workspace(), MACE_DELEGATOR_KEY(
+      Gemv, RuntimeType::RT_CPU, float, ImplType::REF), delegator::GemvParam());
+  gemv_ref->Compute(&ref_context,
+                    &lhs,
+                    &rhs,
+                    &bias,
+                    batch,
+                    height,
+                    width,
+                    lhs_batched,
+                    rhs_batched,
+                    &expected_output);
+
+  for (CPUIsa isa : HostX86Isas()) {
+    CPUIsaWorkspace isa_ws(isa);
+    OpContext context(isa_ws.ws(), cpu_runtime);
+    std::unique_ptr<delegator::Gemv> gemv = delegator::Gemv::Create(
+        context.workspace(),
+        MACE_DELEGATOR_KEY(Gemv, RuntimeType::RT_CPU, float, ImplType::X86),
+        delegator::GemvParam());
+    gemv->Compute(&context,
+                  &lhs,
+                  &rhs,
+                  &bias,
+                  batch,
+                  height,
+                  width,
+                  lhs_batched,
+                  rhs_batched,
+                  &output);
+
+    ExpectTensorNear<float>(expected_output, output);
+  }
+}
+
+TEST(X86Gemv, TestGemvFloat32) {
+  TestGemvFloat32(1, 16, 4, true, true);
+  TestGemvFloat32(1, 16, 256, true, true);
+  TestGemvFloat32(2, 16, 256, true, true);
+  TestGemvFloat32(3, 63, 257, true, true);
+
+  TestGemvFloat32(2, 16, 256, false, true);
+  TestGemvFloat32(3, 63, 257, false, true);
+  TestGemvFloat32(2, 16, 256, true, false);
+  TestGemvFloat32(3, 63, 257, true, false);
+  TestGemvFloat32(1, 1000, 2048, true, true);
+}
+
+TEST(X86Gemv, TestGemvHalfWeight) {
+  TestGemvFloat32(1, 16, 256, false, true, DataType::DT_HALF);
+  TestGemvFloat32(3, 63, 257, false, true, DataType::DT_HALF);
+  TestGemvFloat32(3, 63, 257, true, true, DataType::DT_HALF);
+  TestGemvFloat32(4, 1000, 1027, false, true, DataType::DT_HALF);
+}
+
+}  // namespace test
+}  // namespace ops
+}  // namespace mace
@@ -0,0 +1,333 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifdef MACE_ENABLE_QUANTIZE
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "mace/core/ops/op_context.h"
+#include "mace/core/tensor.h"
+#include "mace/ops/common/conv_pool_2d_util.h"
+#include "mace/ops/delegator/conv_2d.h"
+#include "mace/ops/delegator/gemm.h"
+#include "mace/ops/ops_test_util.h"
+#include "mace/ops/testing/test_utils.h"
+#include "mace/ops/x86/cpu_isa_test_util.h"
+
+namespace mace {
+namespace ops {
+namespace test {
+
+namespace {
+
+// Element (r, c) of the [rows, cols] matrix `data` stored in `major`.
+uint8_t At(const uint8_t *data, const index_t rows, const index_t cols,
+           const MatrixMajor major, const index_t r, const index_t c) {
+  return major == RowMajor ? data[r * cols + c] : data[c * rows + r];
+}
+
+// int32 accumulators of the quantized product, bias included, in row major.
+std::vector<int32_t> NaiveGemm(const Tensor &lhs,
+                               const Tensor &rhs,
+                               const Tensor *bias,
+                               const index_t batch,
+                               const index_t rows,
+                               const index_t cols,
+                               const index_t depth,
+                               const MatrixMajor lhs_major,
+                               const MatrixMajor rhs_major,
+                               const bool lhs_batched,
+                               const bool rhs_batched) {
+  std::vector<int32_t> result(batch * rows * cols);
+  for (index_t b = 0; b < batch; ++b) {
+    const uint8_t *lhs_data =
+        lhs.data<uint8_t>() + (lhs_batched ? b : 0) * rows * depth;
+    const uint8_t *rhs_data =
+        rhs.data<uint8_t>() + (rhs_batched ? b : 0) * depth * cols;
+    for (index_t r = 0; r < rows; ++r) {
+      for (index_t c = 0; c < cols; ++c) {
+        int32_t sum = bias == nullptr ? 0 : bias->data<int32_t>()[r];
+        for (index_t d = 0; d < depth; ++d) {
+          sum += (At(lhs_data, rows, depth, lhs_major, r, d)
+              - lhs.zero_point())
+              * (At(rhs_data, depth, cols, rhs_major, d, c)
+                  - rhs.zero_point());
+        }
+        result[(b * rows + r) * cols + c] = sum;
+      }
+    }
+  }
+  return result;
+}
+
+// uint8 value of the accumulator `acc` after the epilogue's activation.
+int32_t Requantize(const int32_t acc,
+                   const float acc_scale,
+                   const Epilogue &epilogue,
+                   const float output_scale,
+                   const int32_t output_zero) {
+  float real = acc * acc_scale;
+  if (epilogue.activation == RELU || epilogue.activation == RELUX) {
+    real = std::max(0.f, real);
+  }
+  if (epilogue.activation == RELUX) {
+    real = std::min(epilogue.max_limit, real);
+  }
+  return std::max(0, std::min(255, output_zero + static_cast<int32_t>(
+      std::roundf(real / output_scale))));
+}
+
+template<typename OUTPUT_TYPE>
+void TestQ8Gemm(const index_t batch,
+                const index_t rows,
+                const index_t cols,
+                const index_t depth,
+                const MatrixMajor lhs_major,
+                const MatrixMajor rhs_major,
+                const MatrixMajor output_major,
+                const bool lhs_batched,
+                const bool rhs_batched,
+                const bool with_bias,
+                const ActivationType activation = NOOP) {
+  auto *cpu_runtime = OpTestContext::Get()->GetRuntime(RuntimeType::RT_CPU);
+  Tensor lhs(cpu_runtime, DataType::DT_UINT8);
+  Tensor rhs(cpu_runtime, DataType::DT_UINT8);
+  Tensor bias(cpu_runtime, DataType::DT_INT32);
+  lhs.SetScale(0.05f);
+  lhs.SetZeroPoint(121);
+  rhs.SetScale(0.02f);
+  rhs.SetZeroPoint(135);
+  bias.SetScale(lhs.scale() * rhs.scale());
+  lhs.Resize({lhs_batched ? batch : 1, rows, depth});
+  rhs.Resize({rhs_batched ? batch : 1, depth, cols});
+  bias.Resize({rows});
+  GenerateRandomIntTypeData<uint8_t>(lhs.shape(), lhs.mutable_data<uint8_t>());
+  GenerateRandomIntTypeData<uint8_t>(rhs.shape(), rhs.mutable_data<uint8_t>());
+  GenerateRandomIntTypeData<int32_t>(bias.shape(), bias.mutable_data<int32_t>(),
+                                     -10000, 10000);
+
+  Epilogue epilogue;
+  epilogue.bias = with_bias ? &bias : nullptr;
+  epilogue.activation = activation;
+  epilogue.max_limit = 6.f;
+  const std::vector<int32_t> acc =
+      NaiveGemm(lhs, rhs, epilogue.bias, batch, rows, cols, depth, lhs_major,
+                rhs_major, lhs_batched, rhs_batched);
+
+  const bool requantize = DataTypeToEnum<OUTPUT_TYPE>::value == DT_UINT8;
+  const float output_scale = 0.15f;
+  const int32_t output_zero = requantize ? 97 : 0;
+  auto check = [&](OpContext *context, const ImplType impl_type) {
+    Tensor output(cpu_runtime, DataTypeToEnum<OUTPUT_TYPE>::value);
+    output.SetScale(output_scale);
+    output.SetZeroPoint(output_zero);
+    output.Resize({batch, rows, cols});
+    std::unique_ptr<delegator::Gemm> gemm = delegator::Gemm::Create(
+        context->workspace(),
+        MACE_DELEGATOR_KEY(Gemm, RuntimeType::RT_CPU, OUTPUT_TYPE, impl_type),
+        delegator::GemmParam(false, epilogue));
+    gemm->Compute(context, &lhs, &rhs, batch, rows, cols, depth, lhs_major,
+                  rhs_major, output_major, lhs_batched, rhs_batched, &output);
+
+    const OUTPUT_TYPE *output_data = output.data<OUTPUT_TYPE>();
+    for (index_t b = 0; b < batch; ++b) {
+      for (index_t r = 0; r < rows; ++r) {
+        for (index_t c = 0; c < cols; ++c) {
+          const index_t i = b * rows * cols + (output_major == RowMajor ?
+                                               r * cols + c : c * rows + r);
+          const int32_t value = acc[(b * rows + r) * cols + c];
+          if (!requantize) {
+            ASSERT_EQ(value, static_cast<int32_t>(output_data[i]));
+            continue;
+          }
+          const int32_t expected = Requantize(
+              value, lhs.scale() * rhs.scale(), epilogue, output_scale,
+              output_zero);
+          ASSERT_NEAR(expected, static_cast<int32_t>(output_data[i]), 1)
+              << "at " << b << ", " << r << ", " << c;
+        }
+      }
+    }
+  };
+
+  OpsTestNet net;
+  OpContext ref_context(net.ws(), cpu_runtime);
+  check(&ref_context, ImplType::REF);
+  for (CPUIsa isa : HostX86Isas()) {
+    CPUIsaWorkspace isa_ws(isa);
+    OpContext context(isa_ws.ws(), cpu_runtime);
+    check(&context, ImplType::X86);
+  }
+}
+
+void TestQ8Conv2d(const index_t batch,
+                  const index_t in_channels,
+                  const index_t height,
+                  const index_t width,
+                  const index_t out_channels,
+                  const index_t kernel_h,
+                  const index_t kernel_w,
+                  const int stride,
+                  const int dilation,
+                  const Padding padding,
+                  const ActivationType activation = NOOP) {
+  auto *cpu_runtime = OpTestContext::Get()->GetRuntime(RuntimeType::RT_CPU);
+  Tensor input(cpu_runtime, DataType::DT_UINT8);
+  Tensor filter(cpu_runtime, DataType::DT_UINT8);
+  Tensor bias(cpu_runtime, DataType::DT_INT32);
+  input.SetScale(0.05f);
+  input.SetZeroPoint(121);
+  filter.SetScale(0.02f);
+  filter.SetZeroPoint(135);
+  bias.SetScale(input.scale() * filter.scale());
+  input.Resize({batch, height, width, in_channels});
+  filter.Resize({out_channels, kernel_h, kernel_w, in_channels});
+  bias.Resize({out_channels});
+  GenerateRandomIntTypeData<uint8_t>(input.shape(),
+                                     input.mutable_data<uint8_t>());
+  GenerateRandomIntTypeData<uint8_t>(filter.shape(),
+                                     filter.mutable_data<uint8_t>());
+  GenerateRandomIntTypeData<int32_t>(bias.shape(), bias.mutable_data<int32_t>(),
+                                     -10000, 10000);
+
+  const std::vector<int> strides = {stride, stride};
+  const std::vector<int> dilations = {dilation, dilation};
+  const std::vector<int> paddings;
+  std::vector<index_t> out_shape(4);
+  std::vector<int> pad_sizes(2);
+  CalcPaddingAndOutputSize(input.shape().data(), DataFormat::NHWC,
+                           filter.shape().data(), DataFormat::OHWI,
+                           dilations.data(), strides.data(), padding,
+                           out_shape.data(), pad_sizes.data());
+  Epilogue epilogue;
+  epilogue.bias = &bias;
+  epilogue.activation = activation;
+  epilogue.max_limit = 6.f;
+  delegator::Conv2dParam param(strides, dilations, paddings, padding,
+                               epilogue);
+
+  const float output_scale = 0.15f;
+  const int32_t output_zero = 97;
+  const uint8_t *input_data = input.data<uint8_t>();
+  const uint8_t *filter_data = filter.data<uint8_t>();
+  std::vector<uint8_t> expected(out_shape[0] * out_shape[1] * out_shape[2]
+                                    * out_shape[3]);
+  for (index_t b = 0; b < out_shape[0]; ++b) {
+    for (index_t h = 0; h < out_shape[1]; ++h) {
+      for (index_t w = 0; w < out_shape[2]; ++w) {
+        for (index_t o = 0; o < out_channels; ++o) {
+          int32_t sum = bias.data<int32_t>()[o];
+          for (index_t kh = 0; kh < kernel_h; ++kh) {
+            for (index_t kw = 0; kw < kernel_w; ++kw) {
+              const index_t ih = h * stride - pad_sizes[0] / 2 + kh * dilation;
+              const index_t iw = w * stride - pad_sizes[1] / 2 + kw * dilation;
+              if (ih < 0 || ih >= height || iw < 0 || iw >= width) {
+                continue;
+              }
+              for (index_t i = 0; i < in_channels; ++i) {
+                sum += (input_data[((b * height + ih) * width + iw)
+                    * in_channels + i] - input.zero_point())
+                    * (filter_data[((o * kernel_h + kh) * kernel_w + kw)
+                        * in_channels + i] - filter.zero_point());
+              }
+            }
+          }
+          expected[((b * out_shape[1] + h) * out_shape[2] + w) * out_channels
+              + o] = static_cast<uint8_t>(Requantize(
+                  sum, input.scale() * filter.scale(), epilogue,
+                  output_scale, output_zero));
+        }
+      }
+    }
+  }
+
+  auto check = [&](OpContext *context, const ImplType impl_type) {
+    Tensor output(cpu_runtime, DataType::DT_UINT8);
+    output.SetScale(output_scale);
+    output.SetZeroPoint(output_zero);
+    std::unique_ptr<delegator::Conv2d> conv2d = delegator::Conv2d::Create(
+        context->workspace(),
+        MACE_DELEGATOR_KEY(Conv2d, RuntimeType::RT_CPU, uint8_t, impl_type),
+        param);
+    conv2d->Compute(context, &input, &filter, &output);
+    ASSERT_EQ(out_shape, output.shape());
+    const uint8_t *output_data = output.data<uint8_t>();
+    for (size_t i = 0; i < expected.size(); ++i) {
+      ASSERT_NEAR(expected[i], output_data[i], 1) << "at " << i;
+    }
+  };
+
+  OpsTestNet net;
+  OpContext ref_context(net.ws(), cpu_runtime);
+  check(&ref_context, ImplType::REF);
+  for (CPUIsa isa : HostX86Isas()) {
+    CPUIsaWorkspace isa_ws(isa);
+    OpContext context(isa_ws.ws(), cpu_runtime);
+    check(&context, ImplType::X86);
+  }
+}
+
+}  // namespace
+
+TEST(X86Q8Gemm, TestGemmInt32) {
+  TestQ8Gemm<int32_t>(1, 47, 69, 37, RowMajor, RowMajor, RowMajor, true, true,
+                      false);
+  TestQ8Gemm<int32_t>(1, 47, 69, 37, ColMajor, ColMajor, ColMajor, true, true,
+                      true);
+  TestQ8Gemm<int32_t>(3, 47, 69, 37, RowMajor, ColMajor, RowMajor, true, false,
+                      true);
+  TestQ8Gemm<int32_t>(3, 47, 69, 37, ColMajor, RowMajor, ColMajor, false, true,
+                      false);
+  TestQ8Gemm<int32_t>(2, 1, 129, 515, RowMajor, ColMajor, RowMajor, true, true,
+                      true);
+}
+
+TEST(X86Q8Gemm, TestGemmUint8) {
+  TestQ8Gemm<uint8_t>(1, 47, 69, 37, RowMajor, RowMajor, RowMajor, true, true,
+                      true);
+  TestQ8Gemm<uint8_t>(1, 47, 69, 37, RowMajor, ColMajor, ColMajor, true, true,
+                      true);
+  TestQ8Gemm<uint8_t>(1, 47, 69, 37, ColMajor, RowMajor, RowMajor, true, true,
+                      false);
+  TestQ8Gemm<uint8_t>(3, 64, 33, 96, RowMajor, ColMajor, ColMajor, true, false,
+                      true);
+  TestQ8Gemm<uint8_t>(2, 130, 7, 259, RowMajor, RowMajor, RowMajor, false, true,
+                      true);
+}
+
+TEST(X86Q8Gemm, TestGemmUint8Activation) {
+  TestQ8Gemm<uint8_t>(1, 37, 45, 61, RowMajor, ColMajor, ColMajor, true, true,
+                      true, RELU);
+  TestQ8Gemm<uint8_t>(1, 37, 45, 61, RowMajor, ColMajor, ColMajor, true, true,
+                      true, RELUX);
+}
+
+TEST(X86Q8Gemm, TestConv2dUint8) {
+  TestQ8Conv2d(1, 17, 15, 13, 37, 1, 1, 1, 1, VALID);
+  TestQ8Conv2d(2, 17, 15, 13, 37, 3, 3, 1, 1, SAME);
+  TestQ8Conv2d(1, 33, 16, 17, 9, 3, 3, 2, 1, SAME, RELU);
+  TestQ8Conv2d(1, 5, 21, 19, 64, 5, 3, 1, 2, SAME, RELUX);
+  TestQ8Conv2d(2, 8, 20, 20, 16, 3, 3, 1, 3, VALID);
+  TestQ8Conv2d(1, 3, 9, 9, 8, 7, 7, 1, 1, FULL);
+}
+
+}  // namespace test
+}  // namespace ops
+}  // namespace mace
+
+#endif  // MACE_ENABLE_QUANTIZE
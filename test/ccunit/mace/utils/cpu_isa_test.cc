@@ -0,0 +1,111 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mace/utils/cpu_isa.h"
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <memory>
+
+#include "mace/core/registry/op_delegator_registry.h"
+
+namespace mace {
+namespace {
+
+class CPUIsaTest : public ::testing::Test {
+ protected:
+  void TearDown() override {
+    unsetenv("MACE_CPU_ISA");
+  }
+};
+
+class IsaDelegatorBase : public OpDelegator {
+ public:
+  explicit IsaDelegatorBase(const DelegatorParam &param)
+      : OpDelegator(param) {}
+  virtual CPUIsa isa() const = 0;
+};
+
+template<CPUIsa Isa>
+class IsaDelegator : public IsaDelegatorBase {
+ public:
+  explicit IsaDelegator(const DelegatorParam &param)
+      : IsaDelegatorBase(param) {}
+  CPUIsa isa() const override { return Isa; }
+};
+
+template<CPUIsa Isa>
+void RegisterIsaDelegator(OpDelegatorRegistry *registry,
+                          const DelegatorInfo &key) {
+  MACE_REGISTER_ISA_DELEGATOR(registry, IsaDelegator<Isa>, DelegatorParam,
+                              key, Isa);
+}
+
+template<CPUIsa Isa>
+bool CreatedBy(const OpDelegatorRegistry &registry,
+               const DelegatorInfo &key) {
+  std::unique_ptr<OpDelegator> delegator =
+      registry.GetCreator(key)(DelegatorParam());
+  // built without rtti in optimized builds
+  return static_cast<IsaDelegatorBase *>(delegator.get())->isa() == Isa;
+}
+
+TEST_F(CPUIsaTest, Resolve) {
+  const CPUIsa host = utils::GetHostCPUIsa();
+  EXPECT_NE(CPUIsa::CPU_ISA_AUTO, host);
+  EXPECT_EQ(host, utils::ResolveCPUIsa(CPUIsa::CPU_ISA_AUTO));
+  EXPECT_EQ(CPUIsa::CPU_ISA_NONE, utils::ResolveCPUIsa(CPUIsa::CPU_ISA_NONE));
+  // never above what the host supports
+  EXPECT_EQ(host, utils::ResolveCPUIsa(CPUIsa::CPU_ISA_AVX512_VNNI));
+  EXPECT_EQ(std::min(host, CPUIsa::CPU_ISA_SSE42),
+            utils::ResolveCPUIsa(CPUIsa::CPU_ISA_SSE42));
+}
+
+TEST_F(CPUIsaTest, EnvOverride) {
+  const CPUIsa host = utils::GetHostCPUIsa();
+  setenv("MACE_CPU_ISA", "none", 1);
+  EXPECT_EQ(CPUIsa::CPU_ISA_NONE, utils::ResolveCPUIsa(CPUIsa::CPU_ISA_AUTO));
+  setenv("MACE_CPU_ISA", "AVX2", 1);
+  EXPECT_EQ(std::min(host, CPUIsa::CPU_ISA_AVX2),
+            utils::ResolveCPUIsa(CPUIsa::CPU_ISA_NONE));
+  setenv("MACE_CPU_ISA", "auto", 1);
+  EXPECT_EQ(host, utils::ResolveCPUIsa(CPUIsa::CPU_ISA_NONE));
+  // unknown values leave the requested ISA alone
+  setenv("MACE_CPU_ISA", "mmx", 1);
+  EXPECT_EQ(CPUIsa::CPU_ISA_NONE, utils::ResolveCPUIsa(CPUIsa::CPU_ISA_NONE));
+}
+
+TEST_F(CPUIsaTest, RegistryPicksBestIsa) {
+  OpDelegatorRegistry registry;
+  const DelegatorInfo key =
+      MACE_DELEGATOR_KEY(Gemm, RuntimeType::RT_CPU, float, ImplType::X86);
+  RegisterIsaDelegator<CPUIsa::CPU_ISA_NONE>(&registry, key);
+  RegisterIsaDelegator<CPUIsa::CPU_ISA_SSE42>(&registry, key);
+  RegisterIsaDelegator<CPUIsa::CPU_ISA_AVX512>(&registry, key);
+
+  registry.SetCPUIsa(CPUIsa::CPU_ISA_NONE);
+  EXPECT_TRUE(CreatedBy<CPUIsa::CPU_ISA_NONE>(registry, key));
+  registry.SetCPUIsa(CPUIsa::CPU_ISA_SSE42);
+  EXPECT_TRUE(CreatedBy<CPUIsa::CPU_ISA_SSE42>(registry, key));
+  // no AVX2 implementation, falls back to the best one below it
+  registry.SetCPUIsa(CPUIsa::CPU_ISA_AVX2);
+  EXPECT_TRUE(CreatedBy<CPUIsa::CPU_ISA_SSE42>(registry, key));
+  registry.SetCPUIsa(CPUIsa::CPU_ISA_AVX512);
+  EXPECT_TRUE(CreatedBy<CPUIsa::CPU_ISA_AVX512>(registry, key));
+}
+
+}  // namespace
+}  // namespace mace
@@ -13,7 +13,13 @@
 // limitations under the License.
 
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT(build/c++11)
 #include <cstdlib>
+#include <mutex>  // NOLINT(build/c++11)
+#include <set>
+#include <thread>  // NOLINT(build/c++11)
 #include <vector>
 #include "mace/utils/thread_pool.h"
 
@@ -105,6 +111,143 @@ TEST_F(ThreadPoolTest, Compute3D) {
   }
 }
 
+TEST_F(ThreadPoolTest, RunEachIterationOnce) {
+  // the split of later runs follows the speeds measured in earlier ones
+  for (int64_t iterations : {1, 3, 17, 1000, 12345}) {
+    std::vector<std::atomic<int>> counts(iterations);
+    for (auto &count : counts) {
+      count = 0;
+    }
+    thread_pool.Run([&](int64_t i) {
+      ++counts[i];
+    }, iterations);
+    for (int64_t i = 0; i < iterations; ++i) {
+      EXPECT_EQ(1, counts[i]) << i;
+    }
+  }
+}
+
+TEST_F(ThreadPoolTest, ImbalancedCompute1D) {
+  const int64_t test_size = 512;
+  std::vector<int> actual(test_size, 0);
+  std::vector<float> sums(test_size, 0.f);
+  for (int round = 0; round < 4; ++round) {
+    // the cost of item i grows with i
+    thread_pool.Compute1D([&](int64_t start, int64_t end, int64_t step) {
+      for (int64_t i = start; i < end; i += step) {
+        for (int64_t k = 0; k < i * 100; ++k) {
+          sums[i] += 1.f;
+        }
+        ++actual[i];
+      }
+    }, 0, test_size, 1, 0, 100);
+  }
+
+  for (int64_t i = 0; i < test_size; ++i) {
+    EXPECT_EQ(4, actual[i]);
+    EXPECT_EQ(4.f * i * 100, sums[i]);
+  }
+}
+
+TEST_F(ThreadPoolTest, ConcurrentCallers) {
+  const int caller_count = 4;
+  const int64_t test_size = 1000;
+  std::vector<std::vector<int>> actual(caller_count,
+                                       std::vector<int>(test_size, 0));
+  std::vector<std::thread> callers;
+  for (int c = 0; c < caller_count; ++c) {
+    callers.emplace_back([&, c]() {
+      for (int round = 0; round < 10; ++round) {
+        thread_pool.Compute1D([&, c](int64_t start, int64_t end,
+                                     int64_t step) {
+          Test1D(start, end, step, &actual[c]);
+        }, 0, test_size, 1);
+      }
+    });
+  }
+  for (auto &caller : callers) {
+    caller.join();
+  }
+
+  for (int c = 0; c < caller_count; ++c) {
+    for (int64_t i = 0; i < test_size; ++i) {
+      EXPECT_EQ(10, actual[c][i]);
+    }
+  }
+}
+
+TEST_F(ThreadPoolTest, ConcurrentJobsOverlap) {
+  // the first job only ends once the second one ran, which it must not wait
+  // for
+  std::atomic<bool> first_started(false);
+  std::atomic<bool> second_ran(false);
+  bool overlapped = false;
+  std::thread first([&]() {
+    thread_pool.Run([&](int64_t i) {
+      if (i == 0) {
+        first_started = true;
+        const auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!second_ran && std::chrono::steady_clock::now() < deadline) {
+          std::this_thread::yield();
+        }
+        overlapped = second_ran;
+      }
+    }, 8);
+  });
+  while (!first_started) {
+    std::this_thread::yield();
+  }
+  thread_pool.Run([&](int64_t) { second_ran = true; }, 8);
+  first.join();
+  EXPECT_TRUE(overlapped);
+}
+
+TEST_F(ThreadPoolTest, NestedCompute1D) {
+  const int64_t test_size = 64;
+  std::vector<int> actual(test_size * test_size, 0);
+  thread_pool.Compute1D([&](int64_t start0, int64_t end0, int64_t step0) {
+    for (int64_t i = start0; i < end0; i += step0) {
+      thread_pool.Compute1D([&, i](int64_t start1, int64_t end1,
+                                   int64_t step1) {
+        for (int64_t j = start1; j < end1; j += step1) {
+          ++actual[i * test_size + j];
+        }
+      }, 0, test_size, 1);
+    }
+  }, 0, test_size, 1);
+
+  for (int64_t i = 0; i < test_size * test_size; ++i) {
+    EXPECT_EQ(1, actual[i]);
+  }
+}
+
+TEST_F(ThreadPoolTest, JobLimits) {
+  const int64_t test_size = 100;
+  std::vector<int> actual(test_size, 0);
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+  int calls = 0;
+  {
+    ScopedJobLimits job_limits(2, 1);
+    thread_pool.Compute1D([&](int64_t start, int64_t end, int64_t step) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.insert(std::this_thread::get_id());
+        ++calls;
+      }
+      Test1D(start, end, step, &actual);
+    }, 0, test_size, 1);
+  }
+
+  const int max_threads = std::min(2, thread_pool.thread_count());
+  EXPECT_EQ(max_threads, calls);
+  EXPECT_LE(static_cast<int>(threads.size()), max_threads);
+  for (int64_t i = 0; i < test_size; ++i) {
+    EXPECT_EQ(1, actual[i]);
+  }
+}
+
 }  // namespace
 }  // namespace utils
 }  // namespace mace
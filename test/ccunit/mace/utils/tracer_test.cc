@@ -0,0 +1,140 @@
+// Copyright 2020 The MACE Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "mace/utils/string_util.h"
+#include "mace/utils/thread_pool.h"
+#include "mace/utils/tracer.h"
+
+namespace mace {
+namespace utils {
+
+namespace {
+
+const char kTraceFile[] = "mace_tracer_test.json";
+
+class TracerTest : public ::testing::Test {
+ protected:
+  void TearDown() override {
+    Tracer::Stop();
+    remove(kTraceFile);
+  }
+
+  std::string WriteTrace() {
+    Tracer::Stop();
+    EXPECT_EQ(Tracer::WriteChromeTrace(kTraceFile), MaceStatus::MACE_SUCCESS);
+    std::ifstream in(kTraceFile);
+    std::stringstream trace;
+    trace << in.rdbuf();
+    return trace.str();
+  }
+};
+
+int CountOf(const std::string &text, const std::string &pattern) {
+  int count = 0;
+  for (size_t pos = text.find(pattern); pos != std::string::npos;
+       pos = text.find(pattern, pos + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+}  // namespace
+
+TEST_F(TracerTest, RecordOnlyWhileStarted) {
+  { TraceSpan span("test", "before"); }
+  Tracer::Start();
+  {
+    TraceSpan span("test", "during", "kind", "text");
+    EXPECT_TRUE(span.active());
+    span.AddArg("value", 7);
+  }
+  Tracer::Stop();
+  {
+    TraceSpan span("test", "after");
+    EXPECT_FALSE(span.active());
+  }
+  const std::string trace = WriteTrace();
+  EXPECT_EQ(CountOf(trace, "\"ph\":\"X\""), 1);
+  EXPECT_EQ(CountOf(trace, "\"name\":\"during\""), 1);
+  EXPECT_EQ(CountOf(trace, "\"value\":7"), 1);
+  EXPECT_EQ(CountOf(trace, "\"kind\":\"text\""), 1);
+  EXPECT_EQ(trace.find("before"), std::string::npos);
+  EXPECT_EQ(trace.find("after"), std::string::npos);
+}
+
+TEST_F(TracerTest, KeepLatestSpans) {
+  Tracer::Start(4);
+  std::vector<std::string> names;
+  for (int i = 0; i < 10; ++i) {
+    names.push_back(MakeString("span", i));
+  }
+  for (auto &name : names) {
+    TraceSpan span("test", name.c_str());
+  }
+  const std::string trace = WriteTrace();
+  EXPECT_EQ(CountOf(trace, "\"ph\":\"X\""), 4);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(CountOf(trace, "\"span" + MakeString(i) + "\""), i >= 6 ? 1 : 0);
+  }
+}
+
+TEST_F(TracerTest, EscapeNames) {
+  Tracer::Start();
+  { TraceSpan span("test", "a\"b\\c\n"); }
+  const std::string trace = WriteTrace();
+  EXPECT_EQ(CountOf(trace, "\"a\\\"b\\\\c\\n\""), 1);
+}
+
+TEST_F(TracerTest, SpansPerThread) {
+  Tracer::Start();
+  std::thread thread([] {
+    Tracer::SetThreadName("named");
+    TraceSpan span("test", "in thread");
+  });
+  thread.join();
+  { TraceSpan span("test", "in main"); }
+  const std::string trace = WriteTrace();
+  EXPECT_EQ(CountOf(trace, "\"thread_name\""), 2);
+  EXPECT_EQ(CountOf(trace, "\"name\":\"named\""), 1);
+  EXPECT_EQ(CountOf(trace, "\"name\":\"in thread\""), 1);
+  EXPECT_EQ(CountOf(trace, "\"name\":\"in main\""), 1);
+}
+
+TEST_F(TracerTest, ThreadPoolTiles) {
+  ThreadPool thread_pool(4, CPUAffinityPolicy::AFFINITY_NONE);
+  thread_pool.Init();
+  Tracer::Start();
+  thread_pool.Compute1D([](int64_t start, int64_t end, int64_t step) {
+    volatile int64_t sum = 0;
+    for (int64_t i = start; i < end; i += step) {
+      sum += i;
+    }
+  }, 0, 1024, 1);
+  const std::string trace = WriteTrace();
+  // a pool of a single thread runs the tiles on the caller without tasks
+  const int threads = CountOf(trace, "\"thread_name\"");
+  EXPECT_EQ(CountOf(trace, "\"name\":\"Run tiles\""), threads);
+  EXPECT_EQ(CountOf(trace, "\"tiles\":"), threads);
+}
+
+}  // namespace utils
+}  // namespace mace
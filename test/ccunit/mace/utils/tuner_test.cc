@@ -99,6 +99,11 @@ TEST_F(TunerTest, SimpleTune) {
   res = tuner.template TuneOrRun<unsigned int>(
       "SimpleRun", default_params, nullptr, TunerFunc, &timer);
   EXPECT_EQ(expect, res);
+
+  const std::vector<unsigned int> *params = tuner.Find("SimpleRun");
+  ASSERT_NE(nullptr, params);
+  EXPECT_EQ(std::vector<unsigned int>({expect}), *params);
+  EXPECT_EQ(nullptr, tuner.Find("NotTuned"));
 }
 
 }  // namespace mace
@@ -236,7 +236,8 @@ bool OpsTestNet::Setup(mace::RuntimeType runtime_type) {
         == static_cast<int>(DT_UINT8);
     for (auto input : op_def.input()) {
       if (ws_.GetTensor(input) != nullptr &&
-          !ws_.GetTensor(input)->is_weight()) {
+          !ws_.GetTensor(input)->is_weight() &&
+          !ws_.GetTensor(input)->is_state()) {
         auto input_info = net_def.add_input_info();
         input_info->set_name(input);
         if (has_data_format) {
@@ -262,7 +263,11 @@ bool OpsTestNet::Setup(mace::RuntimeType runtime_type) {
   if (!op_defs_.empty()) {
     auto op_def = op_defs_.back();
     for (int i = 0; i < op_def.output_size(); ++i) {
-      ws_.RemoveTensor(op_def.output(i));
+      // states keep their content between the runs
+      if (!ws_.HasTensor(op_def.output(i)) ||
+          !ws_.GetTensor(op_def.output(i))->is_state()) {
+        ws_.RemoveTensor(op_def.output(i));
+      }
       auto output_info = net_def.add_output_info();
       output_info->set_name(op_def.output(i));
       if (op_def.output_type_size() == op_def.output_size()) {
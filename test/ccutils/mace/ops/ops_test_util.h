@@ -414,6 +414,56 @@ class OpsTestNet {
     }
   }
 
+  // Quantizes float weight `src_name` to symmetric int8 with one scale per
+  // output channel. The `channels` are the outermost values, or the
+  // innermost ones if `channel_last`, e.g., I * M of HWIM filters.
+  void QuantizePerChannel(const std::string &src_name,
+                          const std::string &dst_name,
+                          const index_t channels,
+                          const bool channel_last) {
+    Tensor *input = ws_.GetTensor(src_name);
+    const index_t size = input->size();
+    const index_t inner = channel_last ? 1 : size / channels;
+    auto input_data = input->data<float>();
+    std::vector<float> scales(channels, 0.f);
+    for (index_t i = 0; i < size; ++i) {
+      const index_t c = (i / inner) % channels;
+      scales[c] = std::max(scales[c], std::fabs(input_data[i]) / 127.f);
+    }
+    std::vector<int8_t> data(size);
+    for (index_t i = 0; i < size; ++i) {
+      const float scale = scales[(i / inner) % channels];
+      data[i] = static_cast<int8_t>(scale > 0.f ?
+          std::roundf(input_data[i] / scale) : 0);
+    }
+    AddInputFromArray<RuntimeType::RT_CPU, int8_t>(
+        dst_name, input->shape(), data, true);
+    ws_.GetTensor(dst_name)->SetScales(scales);
+  }
+
+  // Quantizes float bias `src_name` to int32 with the per channel scales of
+  // `input_scale` times the scales of int8 weight `weight_name`.
+  void QuantizeBiasPerChannel(const std::string &src_name,
+                              const std::string &weight_name,
+                              const float input_scale,
+                              const std::string &dst_name) {
+    Tensor *input = ws_.GetTensor(src_name);
+    const std::vector<float> &weight_scales =
+        ws_.GetTensor(weight_name)->scales();
+    MACE_CHECK(static_cast<index_t>(weight_scales.size()) == input->size());
+    auto input_data = input->data<float>();
+    std::vector<float> scales(weight_scales.size());
+    std::vector<int32_t> data(weight_scales.size());
+    for (size_t c = 0; c < scales.size(); ++c) {
+      scales[c] = input_scale * weight_scales[c];
+      data[c] = static_cast<int32_t>(scales[c] > 0.f ?
+          std::roundf(input_data[c] / scales[c]) : 0);
+    }
+    AddInputFromArray<RuntimeType::RT_CPU, int32_t>(
+        dst_name, input->shape(), data, true);
+    ws_.GetTensor(dst_name)->SetScales(scales);
+  }
+
   // Create standalone tensor on runtime D with T type.
   template<typename T, RuntimeType D = RuntimeType::RT_CPU>
   std::unique_ptr<Tensor> CreateTensor(
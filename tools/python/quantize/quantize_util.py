@@ -204,6 +204,39 @@ def quantize_int8(data):
     return quantized_data
 
 
+def quantize_int8_per_channel(data, dims, channel_axis):
+    """Symmetric int8 with one scale per slice along `channel_axis`,
+    returns the quantized data and the list of scales."""
+    np_data = np.array(data).astype(float).reshape(dims)
+    reduce_axes = tuple(i for i in range(len(dims)) if i != channel_axis)
+    scales = np.abs(np_data).max(axis=reduce_axes, keepdims=True) / 127
+    safe_scales = np.where(scales > 0, scales, 1.0)
+    output = np.clip(np.round(np_data / safe_scales).astype(np.int32),
+                     -127, 127)
+
+    quantized_data = QuantizedData()
+    quantized_data.data = output.flatten()
+    quantized_data.scale = 0.0
+    quantized_data.zero = 0
+    quantized_data.minval = -127 * scales.max()
+    quantized_data.maxval = 127 * scales.max()
+    return quantized_data, scales.flatten().tolist()
+
+
+def quantize_with_scales(data, scales):
+    """int32 bias of per channel weights, scales[c] is the input scale times
+    the weight scale of channel c."""
+    np_data = np.array(data).astype(float)
+    np_scales = np.array(scales).astype(float)
+    safe_scales = np.where(np_scales > 0, np_scales, 1.0)
+    output = np.round(np_data / safe_scales).astype(np.int32)
+    quantized_data = QuantizedData()
+    quantized_data.data = output
+    quantized_data.scale = 0.0
+    quantized_data.zero = 0
+    return quantized_data
+
+
 def quantize_with_min_and_max(data, device, non_zero, in_min, in_max):
     np_data = np.array(data).astype(float)
     scale, zero, out_min, out_max = adjust_range(in_min, in_max, device,
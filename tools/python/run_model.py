@@ -196,6 +196,8 @@ def run_model_for_device(flags, args, dev, model_name, model_conf):
     if flags.tune:
         envs += ["MACE_TUNING=1",
                  "MACE_RUN_PARAMETER_PATH=%s/interior/tune_params"
+                 % install_dir,
+                 "MACE_CPU_RUN_PARAMETER_PATH=%s/interior/cpu_tune_params"
                  % install_dir]
         opts += ["--round=0"]
 
@@ -246,6 +248,15 @@ def run_model_for_device(flags, args, dev, model_name, model_conf):
                          dev.info()["ro.product.model"].replace(' ', ''),
                          dev.info()["ro.board.platform"]))
 
+    if DeviceType.CPU in runtime_list and flags.tune:
+        cpu_dir = workdir + "/cpu"
+        util.mkdir_p(cpu_dir)
+        dev.pull(Target(install_dir + "/interior/cpu_tune_params"),
+                 "%s/%s_tuned_cpu_parameter.%s.%s.bin" % (
+                     cpu_dir, model_name,
+                     dev.info()["ro.product.model"].replace(' ', ''),
+                     dev.info()["ro.board.platform"]))
+
     if flags.validate:
         validate_model_file = util.download_or_get_model(
             model_conf[ModelKeys.model_file_path],
@@ -106,6 +106,7 @@ MaceSupportedOps = [
     'Activation',
     'AddN',
     'ArgMax',
+    'Attention',
     'BatchNorm',
     'BatchToSpaceND',
     'BiasAdd',
@@ -133,6 +134,8 @@ MaceSupportedOps = [
     'InferConv2dShape',
     'InstanceNorm',
     'KaldiBatchNorm',
+    'KVCacheAppend',
+    'LayerNorm',
     'LocalResponseNorm',
     'LpNorm',
     'LSTMCell',
@@ -279,6 +282,9 @@ class MaceKeyword(object):
     mace_shrink_axis_mask_str = 'shrink_axis_mask'
     mace_transpose_a_str = 'transpose_a'
     mace_transpose_b_str = 'transpose_b'
+    mace_transpose_k_str = 'transpose_k'
+    mace_causal_str = 'causal'
+    mace_scale_str = 'scale'
     mace_op_data_type_str = 'T'
     mace_offset_str = 'offset'
     mace_opencl_max_image_size = "opencl_max_image_size"
@@ -292,6 +298,7 @@ class MaceKeyword(object):
     mace_wino_arg_str = "wino_block_size"
     mace_quantize_flag_arg_str = "quantize_flag"
     mace_epsilon_str = 'epsilon'
+    mace_rms_str = 'rms'
     mace_reduce_type_str = 'reduce_type'
     mace_argmin_str = 'argmin'
     mace_out_val_str = 'out_val'
@@ -326,6 +333,7 @@ class MaceKeyword(object):
     mace_nms_top_k = 'nms_top_k'
     mace_keep_top_k = 'keep_top_k'
     mace_htp_u16a_s8w = 'mace_htp_u16a_s8w'
+    mace_u8a_s8w_per_channel = 'u8a_s8w_per_channel'
 
 
 class QatType(Enum):
@@ -395,6 +403,8 @@ class TransformerRule(Enum):
     FOLD_INSTANCE_NORM = 54
     FOLD_MOMENTS = 55
     UPDATE_FC_OUTPUT_SHAPE = 56
+    FOLD_ATTENTION = 57
+    FOLD_LAYER_NORM = 58
 
 
 class ConverterInterface(object):
@@ -694,6 +704,8 @@ class ConverterOption(object):
                 # FOLD_INSTANCE_NORM depends on FOLD_SQRDIFF_MEAN
                 TransformerRule.FOLD_INSTANCE_NORM,
                 TransformerRule.FOLD_MOMENTS,
+                TransformerRule.FOLD_ATTENTION,
+                TransformerRule.FOLD_LAYER_NORM,
                 TransformerRule.TRANSFORM_GLOBAL_CONV_TO_FC,
                 TransformerRule.RESHAPE_FC_WEIGHT,
                 TransformerRule.FOLD_FC_RESHAPE,
@@ -114,6 +114,7 @@ OnnxSupportedOps = [
     'IfDefined',
     'ImageScaler',
     'InstanceNormalization',
+    'LayerNormalization',
     # 'LRN',
     'Linear',
     'LSTM',
@@ -173,6 +174,7 @@ OnnxSupportedOps = [
     # 'Selu',
     'Shape',
     'Sigmoid',
+    'SimplifiedLayerNormalization',
     # 'Sin',
     # 'Sinh',
     # 'Size',
@@ -376,6 +378,7 @@ class OnnxConverter(base_converter.ConverterInterface):
             OnnxOpType.IfDefined.name: self.convert_ifdefined,
             OnnxOpType.ImageScaler.name: self.convert_imagescaler,
             OnnxOpType.InstanceNormalization.name: self.convert_instance_norm,
+            OnnxOpType.LayerNormalization.name: self.convert_layer_norm,
             OnnxOpType.LeakyRelu.name: self.convert_activation,
             OnnxOpType.Linear.name: self.convert_affine,
             OnnxOpType.LogSoftmax.name: self.convert_softmax,
@@ -410,6 +413,8 @@ class OnnxConverter(base_converter.ConverterInterface):
             OnnxOpType.Scale.name: self.convert_eltwise,
             OnnxOpType.Shape.name: self.convert_shape,
             OnnxOpType.Sigmoid.name: self.convert_activation,
+            OnnxOpType.SimplifiedLayerNormalization.name:
+                self.convert_layer_norm,
             OnnxOpType.Slice.name: self.convert_slice,
             OnnxOpType.Softmax.name: self.convert_softmax,
             OnnxOpType.SpaceToDepth.name: self.convert_depth_space,
@@ -1352,6 +1357,27 @@ class OnnxConverter(base_converter.ConverterInterface):
         affine_arg.name = MaceKeyword.mace_affine_str
         affine_arg.i = int(affine)
 
+    def convert_layer_norm(self, node):
+        mace_check(len(node.outputs) == 1,
+                   "%s with mean or inv_std_dev outputs is not supported."
+                   % node.op_type)
+        op = self.convert_general_op(node)
+        op.type = MaceOp.LayerNorm.name
+
+        axis_arg = op.arg.add()
+        axis_arg.name = MaceKeyword.mace_axis_str
+        axis_arg.i = node.attrs.get('axis', -1)
+
+        epsilon_arg = op.arg.add()
+        epsilon_arg.name = MaceKeyword.mace_epsilon_str
+        epsilon_arg.f = node.attrs.get('epsilon', 1e-5)
+
+        # SimplifiedLayerNormalization is RMSNorm
+        rms_arg = op.arg.add()
+        rms_arg.name = MaceKeyword.mace_rms_str
+        rms_arg.i = int(
+            node.op_type == OnnxOpType.SimplifiedLayerNormalization.name)
+
     def convert_gather(self, node):
         op = self.convert_general_op(node)
         op.type = MaceOp.Gather.name
@@ -87,6 +87,8 @@ class Transformer(base_converter.ConverterInterface):
             # fold_instance_norm depends on fold_squared_diff_mean
             TransformerRule.FOLD_INSTANCE_NORM: self.fold_instance_norm,
             TransformerRule.FOLD_MOMENTS: self.fold_moments,
+            TransformerRule.FOLD_ATTENTION: self.fold_attention,
+            TransformerRule.FOLD_LAYER_NORM: self.fold_layer_norm,
             TransformerRule.FOLD_EMBEDDING_LOOKUP: self.fold_embedding_lookup,
             TransformerRule.TRANSPOSE_FILTERS: self.transpose_filters,
             TransformerRule.TRANSPOSE_MATMUL_WEIGHT:
@@ -574,6 +576,294 @@ class Transformer(base_converter.ConverterInterface):
                                     return True
         return False
 
+    def fold_attention(self):
+        """MatMul(Q, K) -> [scale] -> [Add(mask)] -> Softmax -> MatMul(V)
+        to Attention, which does not keep the whole scores"""
+        if self._option.device != DeviceType.CPU.value or \
+                self._option.quantize:
+            return False
+        net = self._model
+
+        def arg_i(op, name):
+            arg = ConverterUtil.get_arg(op, name)
+            return arg.i if arg is not None else 0
+
+        def only_consumer(op):
+            if len(op.output) != 1 or \
+                    self.consumer_count(op.output[0]) != 1 or \
+                    op.output[0] in self._option.output_nodes:
+                return None
+            return self._consumers[op.output[0]][0]
+
+        def elt_type(op):
+            if op.type != MaceOp.Eltwise.name:
+                return None
+            return ConverterUtil.get_arg(
+                op, MaceKeyword.mace_element_type_str).i
+
+        for op in net.op:
+            if op.type != MaceOp.MatMul.name or len(op.input) != 2 or \
+                    len(op.output_shape) != 1 or \
+                    arg_i(op, MaceKeyword.mace_transpose_a_str) != 0:
+                continue
+            scores_rank = len(op.output_shape[0].dims)
+            fused_ops = []
+            scale = 1.0
+            mask = None
+            next_op = only_consumer(op)
+            # scale * scores or scores / scale
+            if next_op is not None and len(next_op.input) == 1:
+                scalar_arg = ConverterUtil.get_arg(
+                    next_op, MaceKeyword.mace_scalar_input_str)
+                scalar_index = arg_i(
+                    next_op, MaceKeyword.mace_scalar_input_index_str)
+                if scalar_arg is not None and \
+                        elt_type(next_op) == EltwiseType.PROD.value:
+                    scale = scalar_arg.f
+                elif scalar_arg is not None and scalar_arg.f != 0 and \
+                        elt_type(next_op) == EltwiseType.DIV.value and \
+                        scalar_index == 1:
+                    scale = 1.0 / scalar_arg.f
+                else:
+                    continue
+                fused_ops.append(next_op)
+                next_op = only_consumer(next_op)
+            # scores + mask
+            if next_op is not None and len(next_op.input) == 2 and \
+                    elt_type(next_op) == EltwiseType.SUM.value and \
+                    ConverterUtil.get_arg(
+                        next_op, MaceKeyword.mace_coeff_str) is None:
+                scores = fused_ops[-1].output[0] if fused_ops \
+                    else op.output[0]
+                mask = next_op.input[1] if next_op.input[0] == scores \
+                    else next_op.input[0]
+                if mask == scores:
+                    continue
+                fused_ops.append(next_op)
+                next_op = only_consumer(next_op)
+            if next_op is None or next_op.type != MaceOp.Softmax.name or \
+                    arg_i(next_op, 'use_log') != 0 or \
+                    arg_i(next_op, MaceKeyword.mace_axis_str) not in \
+                    [-1, scores_rank - 1]:
+                continue
+            fused_ops.append(next_op)
+            value_op = only_consumer(next_op)
+            if value_op is None or value_op.type != MaceOp.MatMul.name or \
+                    len(value_op.input) != 2 or \
+                    len(value_op.output_shape) != 1 or \
+                    value_op.input[0] != next_op.output[0] or \
+                    arg_i(value_op, MaceKeyword.mace_transpose_a_str) != 0 \
+                    or arg_i(value_op, MaceKeyword.mace_transpose_b_str) != 0:
+                continue
+
+            print("Fold attention: %s" % op.name)
+            transpose_k = arg_i(op, MaceKeyword.mace_transpose_b_str)
+            op.type = MaceOp.Attention.name
+            op.input.append(value_op.input[1])
+            if mask is not None:
+                op.input.append(mask)
+            for name in [MaceKeyword.mace_transpose_a_str,
+                         MaceKeyword.mace_transpose_b_str]:
+                arg = ConverterUtil.get_arg(op, name)
+                if arg is not None:
+                    op.arg.remove(arg)
+            transpose_k_arg = op.arg.add()
+            transpose_k_arg.name = MaceKeyword.mace_transpose_k_str
+            transpose_k_arg.i = transpose_k
+            scale_arg = op.arg.add()
+            scale_arg.name = MaceKeyword.mace_scale_str
+            scale_arg.f = scale
+            op.output[0] = value_op.output[0]
+            del op.output_shape[0].dims[:]
+            op.output_shape[0].dims.extend(value_op.output_shape[0].dims)
+            for fused_op in fused_ops + [value_op]:
+                net.op.remove(fused_op)
+            return True
+
+        return False
+
+    def fold_layer_norm(self):
+        """Reduce(mean) -> Sub -> Pow(2) -> Reduce(mean) -> Add(epsilon)
+        -> Sqrt -> Div [-> Mul(gamma) [-> Add(beta)]] over the last axis to
+        LayerNorm, and the same without the centering to it with rms"""
+        if self._option.device != DeviceType.CPU.value or \
+                self._option.quantize:
+            return False
+        net = self._model
+
+        def arg_i(op, name, default=0):
+            arg = ConverterUtil.get_arg(op, name)
+            return arg.i if arg is not None else default
+
+        def elt_type(op):
+            if op is None or op.type != MaceOp.Eltwise.name:
+                return None
+            return ConverterUtil.get_arg(
+                op, MaceKeyword.mace_element_type_str).i
+
+        def scalar(op, index=None):
+            if len(op.input) != 1:
+                return None
+            arg = ConverterUtil.get_arg(op, MaceKeyword.mace_scalar_input_str)
+            if arg is None or index is not None and arg_i(
+                    op, MaceKeyword.mace_scalar_input_index_str, 1) != index:
+                return None
+            return arg.f
+
+        def consumers(name):
+            if name in self._option.output_nodes:
+                return None
+            ops = {}
+            for op in self._consumers.get(name, []):
+                ops[op.name] = op
+            return list(ops.values())
+
+        def only_consumer(op):
+            ops = consumers(op.output[0])
+            return ops[0] if ops is not None and len(ops) == 1 else None
+
+        def is_last_axis_mean(op):
+            if op is None or op.type != MaceOp.Reduce.name or \
+                    len(op.input) != 1 or len(op.output_shape) != 1 or \
+                    arg_i(op, MaceKeyword.mace_reduce_type_str) != \
+                    ReduceType.MEAN.value or \
+                    arg_i(op, MaceKeyword.mace_keepdims_str) == 0:
+                return False
+            axis = ConverterUtil.get_arg(op, MaceKeyword.mace_axis_str)
+            rank = len(op.output_shape[0].dims)
+            return axis is not None and len(axis.ints) == 1 and \
+                axis.ints[0] in [-1, rank - 1]
+
+        def row_const(op, other, size):
+            if op is None or len(op.input) != 2 or other not in op.input or \
+                    ConverterUtil.get_arg(
+                        op, MaceKeyword.mace_coeff_str) is not None:
+                return None
+            name = op.input[1] if op.input[0] == other else op.input[0]
+            if name not in self._consts or \
+                    self._consts[name].data_type != mace_pb2.DT_FLOAT:
+                return None
+            dims = list(self._consts[name].dims)
+            if len(dims) == 0 or dims[-1] != size or \
+                    np.prod(dims) != size:
+                return None
+            return name
+
+        for var_op in net.op:
+            if not is_last_axis_mean(var_op) or \
+                    var_op.input[0] not in self._producer:
+                continue
+            # (x - mean)^2 as a power or as a product
+            sqr_op = self._producer[var_op.input[0]]
+            if elt_type(sqr_op) == EltwiseType.POW.value and \
+                    scalar(sqr_op, 1) == 2:
+                centered = sqr_op.input[0]
+            elif elt_type(sqr_op) == EltwiseType.PROD.value and \
+                    len(sqr_op.input) == 2 and \
+                    sqr_op.input[0] == sqr_op.input[1]:
+                centered = sqr_op.input[0]
+            else:
+                continue
+            if only_consumer(sqr_op) is not var_op:
+                continue
+            # variance + epsilon
+            eps_op = only_consumer(var_op)
+            if elt_type(eps_op) != EltwiseType.SUM.value or \
+                    scalar(eps_op) is None:
+                continue
+            epsilon = scalar(eps_op)
+            # (x - mean) / sqrt(...) or (x - mean) * pow(..., -0.5)
+            std_op = only_consumer(eps_op)
+            if elt_type(std_op) != EltwiseType.POW.value:
+                continue
+            norm_op = only_consumer(std_op)
+            if scalar(std_op, 1) == 0.5 and \
+                    elt_type(norm_op) == EltwiseType.DIV.value and \
+                    list(norm_op.input) == [centered, std_op.output[0]]:
+                pass
+            elif scalar(std_op, 1) == -0.5 and \
+                    elt_type(norm_op) == EltwiseType.PROD.value and \
+                    len(norm_op.input) == 2 and \
+                    set(norm_op.input) == {centered, std_op.output[0]}:
+                pass
+            else:
+                continue
+            centered_consumers = consumers(centered)
+            if centered_consumers is None or \
+                    set([op.name for op in centered_consumers]) != \
+                    set([sqr_op.name, norm_op.name]):
+                continue
+
+            # x - mean, or RMSNorm of the input
+            fused_ops = [sqr_op, var_op, eps_op, std_op, norm_op]
+            rms = True
+            head_op = sqr_op
+            x = centered
+            sub_op = self._producer.get(centered, None)
+            if elt_type(sub_op) == EltwiseType.SUB.value and \
+                    len(sub_op.input) == 2 and \
+                    ConverterUtil.get_arg(
+                        sub_op, MaceKeyword.mace_coeff_str) is None and \
+                    sub_op.input[1] in self._producer:
+                mean_op = self._producer[sub_op.input[1]]
+                if is_last_axis_mean(mean_op) and \
+                        mean_op.input[0] == sub_op.input[0] and \
+                        only_consumer(mean_op) is sub_op:
+                    fused_ops = [mean_op, sub_op] + fused_ops
+                    rms = False
+                    head_op = mean_op
+                    x = sub_op.input[0]
+
+            # gamma and beta
+            if len(norm_op.output_shape) != 1 or \
+                    len(norm_op.output_shape[0].dims) == 0:
+                continue
+            size = norm_op.output_shape[0].dims[-1]
+            affine = []
+            tail_op = norm_op
+            gamma_op = only_consumer(tail_op)
+            if elt_type(gamma_op) == EltwiseType.PROD.value:
+                gamma = row_const(gamma_op, tail_op.output[0], size)
+                if gamma is not None:
+                    affine.append(gamma)
+                    fused_ops.append(gamma_op)
+                    tail_op = gamma_op
+                    beta_op = only_consumer(tail_op)
+                    if elt_type(beta_op) == EltwiseType.SUM.value:
+                        beta = row_const(beta_op, tail_op.output[0], size)
+                        if beta is not None:
+                            affine.append(beta)
+                            fused_ops.append(beta_op)
+                            tail_op = beta_op
+
+            print("Fold layer norm: %s" % head_op.name)
+            data_type_arg = ConverterUtil.get_arg(
+                head_op, MaceKeyword.mace_op_data_type_str)
+            data_type = data_type_arg.i if data_type_arg is not None \
+                else self._option.data_type
+            del head_op.arg[:]
+            head_op.type = MaceOp.LayerNorm.name
+            head_op.input[:] = [x] + affine
+            head_op.output[:] = [tail_op.output[0]]
+            del head_op.output_shape[:]
+            head_op.output_shape.extend(tail_op.output_shape)
+            ConverterUtil.add_data_type_arg(head_op, data_type)
+            axis_arg = head_op.arg.add()
+            axis_arg.name = MaceKeyword.mace_axis_str
+            axis_arg.i = -1
+            epsilon_arg = head_op.arg.add()
+            epsilon_arg.name = MaceKeyword.mace_epsilon_str
+            epsilon_arg.f = epsilon
+            rms_arg = head_op.arg.add()
+            rms_arg.name = MaceKeyword.mace_rms_str
+            rms_arg.i = int(rms)
+            for fused_op in fused_ops:
+                if fused_op is not head_op:
+                    net.op.remove(fused_op)
+            return True
+
+        return False
+
     def fold_embedding_lookup(self):
         net = self._model
         for op in net.op:
@@ -2036,6 +2326,7 @@ class Transformer(base_converter.ConverterInterface):
                     else:
                         if len(ops[0].input) >= 4:
                             check_deconv = ops[0].input[3] == tensor.name
+            per_channel = self.int8_per_channel_dims(tensor)
             if check_conv or check_deconv:
                 conv_op = ops[0]
                 scale_input = self._quantize_activation_info[
@@ -2044,14 +2335,28 @@ class Transformer(base_converter.ConverterInterface):
                     self.quantize_tensor(self._consts[conv_op.input[1]])
                 scale_filter = self._consts[conv_op.input[1]].scale
                 scale = scale_input * scale_filter
-                quantized_tensor = \
-                    quantize_util.quantize_with_scale_and_zero(
-                        tensor.float_data, scale, 0)
+                filter_scales = self._consts[conv_op.input[1]].scales
+                if check_conv and len(filter_scales) > 0:
+                    scales = [scale_input * s for s in filter_scales]
+                    quantized_tensor = quantize_util.quantize_with_scales(
+                        tensor.float_data, scales)
+                    tensor.scales[:] = scales
+                else:
+                    quantized_tensor = \
+                        quantize_util.quantize_with_scale_and_zero(
+                            tensor.float_data, scale, 0)
                 if self._option.device == DeviceType.HEXAGON.value or \
                         self._option.device == DeviceType.HTA.value:
                     quantized_tensor.minval = scale * (-2**31)
                     quantized_tensor.maxval = scale * (2**31 - 1)
                 tensor.data_type = mace_pb2.DT_INT32
+            elif per_channel is not None:
+                dims, channel_axis = per_channel
+                quantized_tensor, scales = \
+                    quantize_util.quantize_int8_per_channel(
+                        tensor.float_data, dims, channel_axis)
+                tensor.scales[:] = scales
+                tensor.data_type = mace_pb2.DT_INT8
             elif self._option.quantize_schema == \
                     MaceKeyword.mace_apu_16bit_per_tensor:
                 quantized_tensor = \
@@ -2110,6 +2415,32 @@ class Transformer(base_converter.ConverterInterface):
 
         return False
 
+    def int8_per_channel_dims(self, tensor):
+        """Returns the dims and the output channel axis to quantize `tensor`
+        with, if it is the weight of an op with int8 per channel kernels on
+        CPU, otherwise None."""
+        if self._option.quantize_schema != \
+                MaceKeyword.mace_u8a_s8w_per_channel:
+            return None
+        ops = self._consumers.get(tensor.name, None)
+        if ops is None or len(ops) != 1 or len(ops[0].input) < 2 or \
+                ops[0].input[1] != tensor.name:
+            return None
+        op = ops[0]
+        dims = list(tensor.dims)
+        if op.type in [MaceOp.Conv2D.name, MaceOp.FullyConnected.name]:
+            return dims, 0
+        elif op.type == MaceOp.DepthwiseConv2d.name:
+            # HWIM, output channel is i * M + m
+            return dims[:2] + [dims[2] * dims[3]], 2
+        elif op.type == MaceOp.MatMul.name and len(dims) == 2:
+            transpose_b = ConverterUtil.get_arg(
+                op, MaceKeyword.mace_transpose_b_str)
+            if transpose_b is not None and transpose_b.i == 1:
+                return dims, 0
+            return dims, 1
+        return None
+
     def quantize_weights(self):
         print("Quantize weights")
         net = self._model